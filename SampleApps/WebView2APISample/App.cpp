@@ -6,24 +6,18 @@
 
 #include "App.h"
 
-#include <map>
 #include <shellapi.h>
 #include <shellscalingapi.h>
 #include <shobjidl.h>
 #include <string.h>
-#include <vector>
 
 #include "AppWindow.h"
 #include "DpiUtil.h"
+#include "UiThreadPool.h"
 
 HINSTANCE g_hInstance;
 int g_nCmdShow;
 bool g_autoTabHandle = true;
-static std::map<DWORD, HANDLE> s_threads;
-
-static int RunMessagePump();
-static DWORD WINAPI ThreadProc(void* pvParam);
-static void WaitForOtherThreads();
 
 #define NEXT_PARAM_CONTAINS(command)                                                           \
     _wcsnicmp(nextParam.c_str(), command, ARRAYSIZE(command) - 1) == 0
@@ -90,6 +84,11 @@ wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmd
             {
                 initialUri = nextParam.substr(nextParam.find(L'=') + 1);
             }
+            else if (NEXT_PARAM_CONTAINS(L"uithreads="))
+            {
+                UiThreadPool::Get().SetThreadCount(
+                    _wtoi(nextParam.substr(nextParam.find(L'=') + 1).c_str()));
+            }
             else if (NEXT_PARAM_CONTAINS(L"userdatafolder="))
             {
                 userDataFolder = nextParam.substr(nextParam.find(L'=') + 1);
@@ -129,13 +128,13 @@ wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmd
 
     int retVal = RunMessagePump();
 
-    WaitForOtherThreads();
+    UiThreadPool::Get().Shutdown();
 
     return retVal;
 }
 
 // Run the message pump for one thread.
-static int RunMessagePump()
+int RunMessagePump()
 {
     HACCEL hAccelTable = LoadAccelerators(g_hInstance, MAKEINTRESOURCE(IDC_WEBVIEW2APISAMPLE));
 
@@ -161,61 +160,11 @@ static int RunMessagePump()
     }
     //! [MoveFocus0]
 
-    DWORD threadId = GetCurrentThreadId();
-    auto it = s_threads.find(threadId);
-    if (it != s_threads.end())
-    {
-        CloseHandle(it->second);
-        s_threads.erase(threadId);
-    }
-
     return (int)msg.wParam;
 }
 
-// Make a new thread.
+// Open a copy of the app window on a thread of the UI thread pool.
 void CreateNewThread(AppWindow* app)
 {
-    DWORD threadId;
-    app->AddRef();
-    HANDLE thread = CreateThread(
-        nullptr, 0, ThreadProc, reinterpret_cast<LPVOID>(app),
-        STACK_SIZE_PARAM_IS_A_RESERVATION, &threadId);
-    s_threads.insert(std::pair<DWORD, HANDLE>(threadId, thread));
-}
-
-// This function is the starting point for new threads. It will open a new app window.
-static DWORD WINAPI ThreadProc(void* pvParam)
-{
-    AppWindow* app = static_cast<AppWindow*>(pvParam);
-    new AppWindow(app->GetCreationModeId(), app->GetWebViewOption());
-    app->Release();
-    return RunMessagePump();
-}
-
-// Called on the main thread.  Wait for all other threads to complete before exiting.
-static void WaitForOtherThreads()
-{
-    while (!s_threads.empty())
-    {
-        std::vector<HANDLE> threadHandles;
-        for (auto it = s_threads.begin(); it != s_threads.end(); ++it)
-        {
-            threadHandles.push_back(it->second);
-        }
-
-        HANDLE* handleArray = threadHandles.data();
-        DWORD dwIndex = MsgWaitForMultipleObjects(
-            static_cast<DWORD>(threadHandles.size()), threadHandles.data(), FALSE, INFINITE,
-            QS_ALLEVENTS);
-
-        if (dwIndex == WAIT_OBJECT_0 + threadHandles.size())
-        {
-            MSG msg;
-            while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
-            {
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
-            }
-        }
-    }
+    UiThreadPool::Get().OpenWindow(app);
 }
@@ -10,4 +10,5 @@ extern HINSTANCE g_hInstance;
 extern int g_nCmdShow;
 extern bool g_autoTabHandle;
 class AppWindow;
+int RunMessagePump();
 void CreateNewThread(AppWindow* app);
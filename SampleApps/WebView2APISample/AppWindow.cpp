@@ -10,6 +10,7 @@
 #include <ShObjIdl_core.h>
 #include <Shellapi.h>
 #include <ShlObj_core.h>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <regex>
@@ -25,7 +26,10 @@
 #include "ControlComponent.h"
 #include "DpiUtil.h"
 #include "FileComponent.h"
+#include "NavigationTimingComponent.h"
+#include "PdfExportQueue.h"
 #include "ProcessComponent.h"
+#include "ProfileComponent.h"
 #include "Resource.h"
 #include "ScenarioAcceleratorKeyPressed.h"
 #include "ScenarioAddHostObject.h"
@@ -46,13 +50,16 @@
 #include "ScenarioFileSystemHandleShare.h"
 #include "ScenarioSharedBuffer.h"
 #include "ScenarioSharedWorkerWRR.h"
+#include "ScenarioThrottlingControl.h"
 #include "ScenarioVirtualHostMappingForPopUpWindow.h"
 #include "ScenarioVirtualHostMappingForSW.h"
 #include "ScenarioWebMessage.h"
 #include "ScenarioWebViewEventMonitor.h"
 #include "ScriptComponent.h"
 #include "SettingsComponent.h"
+#include "StringConversion.h"
 #include "TextInputDialog.h"
+#include "UiThreadPool.h"
 #include "ViewComponent.h"
 using namespace Microsoft::WRL;
 static constexpr size_t s_maxLoadString = 100;
@@ -62,6 +69,12 @@ static thread_local size_t s_appInstances = 0;
 // The minimum height and width for Window Features.
 // See https://developer.mozilla.org/docs/Web/API/Window/open#Size
 static constexpr int s_minNewWindowSize = 100;
+// Used when assets\AcceleratorKeys.txt is missing.
+static constexpr char s_defaultAcceleratorKeys[] = "Ctrl+N = new-window\n"
+                                                   "Ctrl+Q = close-window\n"
+                                                   "Ctrl+S = screenshot\n"
+                                                   "Ctrl+T = new-thread\n"
+                                                   "Ctrl+W = close-webview\n";
 
 // Run Download and Install in another thread so we don't block the UI thread
 DWORD WINAPI DownloadAndInstallWV2RT(_In_ LPVOID lpParameter)
@@ -193,6 +206,7 @@ AppWindow::AppWindow(
     CHECK_FAILURE(OleInitialize(NULL));
 
     ++s_appInstances;
+    UiThreadPool::OnWindowOpened();
 
     WCHAR szTitle[s_maxLoadString]; // The title bar text
     LoadStringW(g_hInstance, IDS_APP_TITLE, szTitle, s_maxLoadString);
@@ -225,6 +239,7 @@ AppWindow::AppWindow(
     SelectObject(m_memHdc, m_appBackgroundImageHandle);
 
     SetWindowLongPtr(m_mainWindow, GWLP_USERDATA, (LONG_PTR)this);
+    LoadAcceleratorKeys();
 
     //! [TextScaleChanged1]
     if (winrt::try_get_activation_factory<winrt::Windows::UI::ViewManagement::UISettings>())
@@ -389,11 +404,22 @@ bool AppWindow::HandleWindowMessage(
         return true;
     }
     break;
+    case WM_ACTIVATE:
+    {
+        if (LOWORD(wParam) != WA_INACTIVE && m_isEvicted)
+        {
+            InitializeWebView();
+        }
+    }
+    break;
     case WM_NCDESTROY:
     {
         int retValue = 0;
         SetWindowLongPtr(hWnd, GWLP_USERDATA, NULL);
+        ProfileComponent::OnWindowClosed(hWnd);
+        PdfExportQueue::GetInstance().OnWindowClosed(this);
         NotifyClosed();
+        UiThreadPool::OnWindowClosed();
         if (--s_appInstances == 0)
         {
             PostQuitMessage(retValue);
@@ -425,14 +451,16 @@ bool AppWindow::HandleWindowMessage(
     case WM_KEYDOWN:
     {
         // If bit 30 is set, it means the WM_KEYDOWN message is autorepeated.
-        // We want to ignore it in that case.
-        if (!(lParam & (1 << 30)))
+        // The key map still sees it, so that holding the first key of a chord
+        // doesn't end the chord, but the action only runs once.
+        bool isRepeat = (lParam & 0x40000000) != 0;
+        if (auto action = GetAcceleratorKeyFunction((UINT)wParam, isRepeat))
         {
-            if (auto action = GetAcceleratorKeyFunction((UINT)wParam))
+            if (!isRepeat)
             {
                 action();
-                return true;
             }
+            return true;
         }
     }
     break;
@@ -496,6 +524,11 @@ bool AppWindow::ExecuteWebViewCommands(WPARAM wParam, LPARAM lParam)
         CloseWebView(true);
         return true;
     }
+    case IDM_SHOW_USER_DATA_FOLDER_SIZES:
+    {
+        ShowUserDataFolderSizes();
+        return true;
+    }
     case IDM_SCENARIO_POST_WEB_MESSAGE:
     {
         NewComponent<ScenarioWebMessage>(this);
@@ -609,6 +642,11 @@ bool AppWindow::ExecuteWebViewCommands(WPARAM wParam, LPARAM lParam)
         CHECK_FAILURE(m_webView->Navigate(testingFocusUri.c_str()));
         return true;
     }
+    case IDM_SCENARIO_THROTTLING_CONTROL:
+    {
+        NewComponent<ScenarioThrottlingControl>(this);
+        return true;
+    }
     case IDM_SCENARIO_USE_DEFERRED_DOWNLOAD:
     {
         NewComponent<ScenarioCustomDownloadExperience>(this);
@@ -654,6 +692,10 @@ bool AppWindow::ExecuteWebViewCommands(WPARAM wParam, LPARAM lParam)
     {
         return PrintToPdfStream();
     }
+    case IDM_SCENARIO_QUEUE_PDF_STREAM_EXPORT:
+    {
+        return QueuePdfStreamExport();
+    }
     case IDM_SCENARIO_NON_CLIENT_REGION_SUPPORT:
     {
         NewComponent<ScenarioNonClientRegionSupport>(this);
@@ -746,6 +788,18 @@ bool AppWindow::ExecuteAppCommands(WPARAM wParam, LPARAM lParam)
     case IDM_NEW_THREAD:
         CreateNewThread(this);
         return true;
+    case IDM_UI_THREAD_POOL_METRICS:
+        MessageBox(
+            m_mainWindow, UiThreadPool::Get().GetMetricsReport().c_str(),
+            L"UI Thread Pool", MB_OK);
+        return true;
+    case IDM_WEB_RESOURCE_ROUTE_METRICS:
+        MessageBox(
+            m_mainWindow,
+            m_webResourceDispatcher ? m_webResourceDispatcher->GetMetricsReport().c_str()
+                                    : L"There is no WebView.",
+            L"Web Resource Routes", MB_OK);
+        return true;
     case IDM_SET_LANGUAGE:
         ChangeLanguage();
         return true;
@@ -1190,6 +1244,29 @@ bool AppWindow::PrintToPdfStream()
 }
 //! [PrintToPdfStream]
 
+// Queues this window's document for export to the PdfExports folder next to the
+// executable. Jobs from all windows share one queue, see PdfExportQueue.
+bool AppWindow::QueuePdfStreamExport()
+{
+    std::wstring folder = GetLocalPath(L"PdfExports", false);
+    CreateDirectory(folder.c_str(), nullptr);
+
+    wil::unique_cotaskmem_string title;
+    CHECK_FAILURE(m_webView->get_DocumentTitle(&title));
+    std::wstring fileName = title.get();
+    for (auto& c : fileName)
+    {
+        if (wcschr(L"\\/:*?\"<>|", c))
+        {
+            c = L'_';
+        }
+    }
+    fileName = fileName.substr(0, 64) + L"_" + std::to_wstring(GetTickCount64()) + L".pdf";
+
+    PdfExportQueue::GetInstance().Enqueue(this, folder + L"\\" + fileName);
+    return true;
+}
+
 // Message handler for about dialog.
 INT_PTR CALLBACK AppWindow::About(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
 {
@@ -1209,34 +1286,86 @@ INT_PTR CALLBACK AppWindow::About(HWND hDlg, UINT message, WPARAM wParam, LPARAM
     return (INT_PTR)FALSE;
 }
 
+// Loads the key map and maps the actions it names to functions, so that
+// keystrokes are resolved with table lookups.
+void AppWindow::LoadAcceleratorKeys()
+{
+    std::ifstream config(GetLocalPath(L"assets\\AcceleratorKeys.txt", false));
+    if (!config || m_keyMap.Load(config) == 0)
+    {
+        std::istringstream defaults(s_defaultAcceleratorKeys);
+        m_keyMap.Load(defaults);
+    }
+    const std::pair<const char*, std::function<void()>> actions[] = {
+        {"new-window", [this] { new AppWindow(m_creationModeId, GetWebViewOption()); }},
+        {"close-window", [this] { CloseAppWindow(); }},
+        {"screenshot",
+         [this]
+         {
+             if (auto file = GetComponent<FileComponent>())
+             {
+                 file->SaveScreenshot();
+             }
+         }},
+        {"new-thread", [this] { CreateNewThread(this); }},
+        {"close-webview", [this] { CloseWebView(); }},
+    };
+    m_acceleratorKeyActions.resize(m_keyMap.GetActionCount());
+    for (const auto& action : actions)
+    {
+        KeyMap::ActionId id = m_keyMap.GetActionId(action.first);
+        if (id != KeyMap::c_noAction)
+        {
+            m_acceleratorKeyActions[id] = action.second;
+        }
+    }
+    m_keyLayout = &m_keyMap.GetLayout("");
+}
+
 // Decide what to do when an accelerator key is pressed. Instead of immediately performing
 // the action, we hand it to the caller so they can decide whether to run it right away
 // or running it asynchronously. Will return nullptr if there is no action for the key.
-std::function<void()> AppWindow::GetAcceleratorKeyFunction(UINT key)
+std::function<void()> AppWindow::GetAcceleratorKeyFunction(UINT key, bool isRepeat)
+{
+    if (key >= KeyMap::c_keyCount)
+    {
+        return nullptr;
+    }
+    // Holding the first key of a chord doesn't end it.
+    if (isRepeat && m_keyChord.prefix != KeyMap::c_noAction)
+    {
+        return [] {};
+    }
+    KeyMap::ActionId action = KeyMap::Press(
+        *m_keyLayout, &m_keyChord, static_cast<uint8_t>(key), GetAcceleratorKeyModifiers());
+    if (action == KeyMap::c_chordPending)
+    {
+        return [] {};
+    }
+    // Actions the app doesn't know are left to the browser.
+    if (action >= m_acceleratorKeyActions.size() || !m_acceleratorKeyActions[action])
+    {
+        return nullptr;
+    }
+    return m_acceleratorKeyActions[action];
+}
+
+uint8_t AppWindow::GetAcceleratorKeyModifiers()
 {
+    uint8_t modifiers = KeyMap::None;
     if (GetKeyState(VK_CONTROL) < 0)
     {
-        switch (key)
-        {
-        case 'N':
-            return [this] { new AppWindow(m_creationModeId, GetWebViewOption()); };
-        case 'Q':
-            return [this] { CloseAppWindow(); };
-        case 'S':
-            return [this]
-            {
-                if (auto file = GetComponent<FileComponent>())
-                {
-                    file->SaveScreenshot();
-                }
-            };
-        case 'T':
-            return [this] { CreateNewThread(this); };
-        case 'W':
-            return [this] { CloseWebView(); };
-        }
+        modifiers |= KeyMap::Control;
     }
-    return nullptr;
+    if (GetKeyState(VK_SHIFT) < 0)
+    {
+        modifiers |= KeyMap::Shift;
+    }
+    if (GetKeyState(VK_MENU) < 0)
+    {
+        modifiers |= KeyMap::Alt;
+    }
+    return modifiers;
 }
 
 //! [CreateCoreWebView2Controller]
@@ -1247,6 +1376,7 @@ void AppWindow::InitializeWebView()
     // the existing WebView. This will result in a new browser process
     // getting created which will apply the browser switches.
     CloseWebView();
+    m_isEvicted = false;
     m_dcompDevice = nullptr;
     m_wincompCompositor = nullptr;
     LPCWSTR subFolder = nullptr;
@@ -1561,6 +1691,7 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
         // available.
         CHECK_FAILURE(m_webView->get_BrowserProcessId(&m_newestBrowserPid));
         //! [CoreWebView2Profile]
+        BOOL inPrivate = FALSE;
         auto webView2_13 = coreWebView2.try_query<ICoreWebView2_13>();
         if (webView2_13)
         {
@@ -1569,7 +1700,6 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
             wil::unique_cotaskmem_string profile_name;
             CHECK_FAILURE(profile->get_ProfileName(&profile_name));
             m_profileName = profile_name.get();
-            BOOL inPrivate = FALSE;
             CHECK_FAILURE(profile->get_IsInPrivateModeEnabled(&inPrivate));
             if (!m_webviewOption.downloadPath.empty())
             {
@@ -1584,6 +1714,7 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
             SetAppIcon(inPrivate);
         }
         //! [CoreWebView2Profile]
+        m_webResourceDispatcher = std::make_unique<WebResourceDispatcher>(m_webView.get());
         // Create components. These will be deleted when the WebView is closed.
         NewComponent<FileComponent>(this);
         NewComponent<ProcessComponent>(this);
@@ -1596,6 +1727,8 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
             m_creationModeId == IDM_CREATION_MODE_TARGET_DCOMP);
         NewComponent<AudioComponent>(this);
         NewComponent<ControlComponent>(this, &m_toolbar);
+        NewComponent<NavigationTimingComponent>(this);
+        NewComponent<ProfileComponent>(this, m_profileName, !!inPrivate);
 
         m_webView3 = coreWebView2.try_query<ICoreWebView2_3>();
         if (m_webView3)
@@ -1621,10 +1754,26 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
             m_onWebViewFirstInitialized = nullptr;
         }
 
-        if (m_initialUri != L"none")
+        std::wstring evictedUri = std::move(m_evictedUri);
+        m_evictedUri.clear();
+        bool isRecovering = m_recoveryOrchestrator.IsRecovering();
+        if (isRecovering && !m_recoveryOrchestrator.GetRecoveringUri().empty())
+        {
+            // The WebView was recreated to recover from a process failure.
+            CHECK_FAILURE(m_webView->Navigate(
+                ToUtf16(m_recoveryOrchestrator.GetRecoveringUri()).c_str()));
+        }
+        else if (!evictedUri.empty())
         {
-            std::wstring initialUri =
-                m_initialUri.empty() ? AppStartPage::GetUri(this) : m_initialUri;
+            // The WebView was recreated after EvictWebView closed it.
+            CHECK_FAILURE(m_webView->Navigate(evictedUri.c_str()));
+        }
+        else if (isRecovering || m_initialUri != L"none")
+        {
+            // A recovery from a failure before any page loaded starts over.
+            std::wstring initialUri = m_initialUri.empty() || m_initialUri == L"none"
+                                          ? AppStartPage::GetUri(this)
+                                          : m_initialUri;
             CHECK_FAILURE(m_webView->Navigate(initialUri.c_str()));
         }
     }
@@ -1660,6 +1809,31 @@ void AppWindow::ReinitializeWebView()
     InitializeWebView();
 }
 
+bool AppWindow::EvictWebView()
+{
+    if (!m_webView)
+    {
+        return false;
+    }
+    // CloseWebView would ask whether to stop printing.
+    auto file = GetComponent<FileComponent>();
+    if (file && file->IsPrintToPdfInProgress())
+    {
+        return false;
+    }
+    wil::unique_cotaskmem_string source;
+    CHECK_FAILURE(m_webView->get_Source(&source));
+    std::wstring title = m_documentTitle;
+    // Keep the settings for the WebView that replaces this one, as
+    // ReinitializeWebView does.
+    m_oldSettingsComponent = MoveComponent<SettingsComponent>();
+    CloseWebView();
+    m_isEvicted = true;
+    m_evictedUri = source.get();
+    SetDocumentTitle((title + L" (unloaded to save memory)").c_str());
+    return true;
+}
+
 void AppWindow::ReinitializeWebViewWithNewBrowser()
 {
     if (!m_webView)
@@ -1724,6 +1898,21 @@ void AppWindow::RestartApp()
 
 void AppWindow::RegisterEventHandlers()
 {
+    // Resolve the accelerator keys of the page's origin when the page changes
+    // rather than on each keystroke.
+    CHECK_FAILURE(m_webView->add_SourceChanged(
+        Callback<ICoreWebView2SourceChangedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs* args) -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(sender->get_Source(&uri));
+                m_keyLayout = &m_keyMap.GetLayout(ToUtf8(uri.get()));
+                m_keyChord = KeyMap::ChordState();
+                return S_OK;
+            })
+            .Get(),
+        nullptr));
+
     //! [ContainsFullScreenElementChanged]
     // Register a handler for the ContainsFullScreenChanged event.
     CHECK_FAILURE(m_webView->add_ContainsFullScreenElementChanged(
@@ -1973,8 +2162,9 @@ bool AppWindow::CloseWebView(bool cleanupUserDataFolder)
             }
         }
     }
-    // 1. Delete components.
+    // 1. Delete components, and then the dispatcher they added routes to.
     DeleteAllComponents();
+    m_webResourceDispatcher = nullptr;
 
     // 2. If cleanup needed and BrowserProcessExited event interface available,
     // register to cleanup upon browser exit.
@@ -2071,7 +2261,7 @@ bool AppWindow::CloseWebView(bool cleanupUserDataFolder)
 }
 //! [Close]
 
-void AppWindow::CleanupUserDataFolder()
+std::wstring AppWindow::GetDefaultUserDataFolderPath()
 {
     // For non-UWP apps, the default user data folder {Executable File Name}.WebView2
     // is in the same directory next to the app executable. If end
@@ -2082,43 +2272,114 @@ void AppWindow::CleanupUserDataFolder()
     WCHAR userDataFolder[MAX_PATH] = L"";
     // Obtain the absolute path for relative paths that include "./" or "../"
     _wfullpath(userDataFolder, GetLocalPath(L".WebView2", true).c_str(), MAX_PATH);
-    std::wstring userDataFolderPath(userDataFolder);
+    return userDataFolder;
+}
+
+void AppWindow::CleanupUserDataFolder()
+{
+    std::wstring userDataFolderPath = GetDefaultUserDataFolderPath();
 
     std::wstring message = L"Are you sure you want to clean up the user data folder at\n";
     message += userDataFolderPath;
     message += L"\n?\nWarning: This action is not reversible.\n\n";
     message += L"Click No if there are other open WebView instances.\n";
 
-    if (MessageBox(m_mainWindow, message.c_str(), L"Cleanup User Data Folder", MB_YESNO) ==
+    if (MessageBox(m_mainWindow, message.c_str(), L"Cleanup User Data Folder", MB_YESNO) !=
         IDYES)
     {
-        CHECK_FAILURE(DeleteFileRecursive(userDataFolderPath));
+        return;
+    }
+    if (!m_folderCleaner)
+    {
+        m_folderCleaner = std::make_unique<FolderCleaner>();
+    }
+    // The folder is renamed aside first, so that a new WebView can use the
+    // user data folder while the old contents are deleted in the background.
+    // Progress is reported on the cleaner's thread and shown from the UI
+    // thread.
+    bool started = m_folderCleaner->StartDelete(
+        userDataFolderPath, true,
+        [this](const FolderCleaner::Progress& progress)
+        { RunAsync([this, progress] { OnUserDataFolderCleanupProgress(progress); }); });
+    if (!started)
+    {
+        MessageBox(
+            m_mainWindow, L"The user data folder is already being cleaned up or measured.",
+            L"Cleanup User Data Folder", MB_OK);
     }
 }
 
-HRESULT AppWindow::DeleteFileRecursive(std::wstring path)
+void AppWindow::OnUserDataFolderCleanupProgress(const FolderCleaner::Progress& progress)
 {
-    wil::com_ptr<IFileOperation> fileOperation;
-    CHECK_FAILURE(
-        CoCreateInstance(CLSID_FileOperation, NULL, CLSCTX_ALL, IID_PPV_ARGS(&fileOperation)));
-
-    // Turn off all UI from being shown to the user during the operation.
-    CHECK_FAILURE(fileOperation->SetOperationFlags(FOF_NO_UI));
-
-    wil::com_ptr<IShellItem> userDataFolder;
-    CHECK_FAILURE(
-        SHCreateItemFromParsingName(path.c_str(), NULL, IID_PPV_ARGS(&userDataFolder)));
-
-    // Add the operation
-    CHECK_FAILURE(fileOperation->DeleteItem(userDataFolder.get(), NULL));
-    userDataFolder.reset();
+    std::wstringstream status;
+    status << progress.files << L" files, " << progress.bytes / (1024 * 1024) << L" MB";
+    if (!progress.done)
+    {
+        m_cleanupStatus = L"Deleting user data folder: " + status.str();
+        UpdateAppTitle();
+        return;
+    }
+    m_cleanupStatus.clear();
+    UpdateAppTitle();
 
-    // Perform the operation to delete the directory
-    CHECK_FAILURE(fileOperation->PerformOperations());
+    std::wstringstream message;
+    message << (progress.cancelled ? L"Cleanup was cancelled after deleting "
+                                   : L"Deleted ")
+            << status.str() << L" and " << progress.directories << L" folders in "
+            << int64_t(progress.seconds * 1000) << L" ms.";
+    if (progress.failures)
+    {
+        message << L"\n" << progress.failures
+                << L" files or folders could not be deleted. They may be in use.";
+    }
+    MessageBox(m_mainWindow, message.str().c_str(), L"Cleanup User Data Folder", MB_OK);
+}
 
-    CHECK_FAILURE(fileOperation->Release());
-    OleUninitialize();
-    return S_OK;
+void AppWindow::ShowUserDataFolderSizes()
+{
+    std::wstring userDataFolderPath = m_userDataFolder;
+    if (auto environment7 = m_webViewEnvironment.try_query<ICoreWebView2Environment7>())
+    {
+        wil::unique_cotaskmem_string userDataFolder;
+        CHECK_FAILURE(environment7->get_UserDataFolder(&userDataFolder));
+        userDataFolderPath = userDataFolder.get();
+    }
+    if (userDataFolderPath.empty())
+    {
+        userDataFolderPath = GetDefaultUserDataFolderPath();
+    }
+    if (!m_folderCleaner)
+    {
+        m_folderCleaner = std::make_unique<FolderCleaner>();
+    }
+    // Three levels down reaches the folders of each profile, such as
+    // EBWebView\Default\Cache and EBWebView\Default\IndexedDB.
+    bool started = m_folderCleaner->StartMeasure(
+        userDataFolderPath, 3,
+        [this, userDataFolderPath](const std::vector<FolderCleaner::FolderSize>& sizes)
+        {
+            std::wstringstream message;
+            uint64_t totalBytes = sizes.empty() ? 0 : sizes.front().bytes;
+            message << userDataFolderPath << L"\n";
+            for (const FolderCleaner::FolderSize& size : sizes)
+            {
+                // Skip folders under 1% of the total to keep the list short.
+                if (size.depth > 0 && size.bytes * 100 < totalBytes)
+                {
+                    continue;
+                }
+                message << L"\n" << std::wstring(size.depth * 4, L' ')
+                        << (size.depth ? size.path.filename().wstring() : L"Total") << L": "
+                        << size.bytes / (1024 * 1024) << L" MB, " << size.files << L" files";
+            }
+            AsyncMessageBox(message.str(), L"User Data Folder Sizes");
+        });
+    if (!started)
+    {
+        MessageBox(
+            m_mainWindow, L"The user data folder is already being cleaned up or measured.",
+            L"User Data Folder Sizes", MB_OK);
+    }
 }
 
 void AppWindow::CloseAppWindow()
@@ -2192,6 +2453,10 @@ void AppWindow::UpdateAppTitle()
     {
         str += L" - " + m_documentTitle;
     }
+    if (!m_cleanupStatus.empty())
+    {
+        str += L" - " + m_cleanupStatus;
+    }
     SetWindowText(m_mainWindow, str.c_str());
 }
 
@@ -7,7 +7,11 @@
 #include "stdafx.h"
 
 #include "ComponentBase.h"
+#include "FolderCleaner.h"
+#include "KeyMap.h"
+#include "RecoveryOrchestrator.h"
 #include "Toolbar.h"
+#include "WebResourceDispatcher.h"
 #include "resource.h"
 #include <dcomp.h>
 #include <functional>
@@ -107,6 +111,18 @@ public:
     {
         return m_webViewEnvironment.get();
     }
+    // Components intercept web resource requests through the dispatcher
+    // rather than handling WebResourceRequested themselves. Null when there
+    // is no WebView.
+    WebResourceDispatcher* GetWebResourceDispatcher()
+    {
+        return m_webResourceDispatcher.get();
+    }
+    // Kept across recreations of the WebView, which it may ask for.
+    RecoveryOrchestrator& GetRecoveryOrchestrator()
+    {
+        return m_recoveryOrchestrator;
+    }
     HWND GetMainWindow()
     {
         return m_mainWindow;
@@ -115,11 +131,22 @@ public:
     std::wstring GetDocumentTitle();
     RECT GetWindowBounds();
     std::wstring GetLocalUri(std::wstring path, bool useVirtualHostName = true);
-    std::function<void()> GetAcceleratorKeyFunction(UINT key);
+    std::wstring GetLocalPath(std::wstring path, bool keep_exe_path);
+    // Returns the action bound to the key with the modifiers held now, or
+    // nullptr. Keystrokes that start a chord return an action that does
+    // nothing, so that they are handled as well.
+    std::function<void()> GetAcceleratorKeyFunction(UINT key, bool isRepeat = false);
+    // The KeyMap::Modifiers held now.
+    static uint8_t GetAcceleratorKeyModifiers();
     double GetDpiScale();
     double GetTextScale();
 
     void ReinitializeWebView();
+    void ReinitializeWebViewWithNewBrowser();
+    // Closes the WebView to free its processes, and recreates it at the same
+    // URI when the window is next activated. Returns false if the WebView is
+    // busy printing.
+    bool EvictWebView();
 
     template <class ComponentType, class... Args> void NewComponent(Args&&... args);
 
@@ -185,12 +212,14 @@ private:
 
     HRESULT OnCreateEnvironmentCompleted(HRESULT result, ICoreWebView2Environment* environment);
     HRESULT OnCreateCoreWebView2ControllerCompleted(HRESULT result, ICoreWebView2Controller* controller);
-    HRESULT DeleteFileRecursive(std::wstring path);
     void RegisterEventHandlers();
-    void ReinitializeWebViewWithNewBrowser();
+    void LoadAcceleratorKeys();
     void RestartApp();
     bool CloseWebView(bool cleanupUserDataFolder = false);
     void CleanupUserDataFolder();
+    std::wstring GetDefaultUserDataFolderPath();
+    void OnUserDataFolderCleanupProgress(const FolderCleaner::Progress& progress);
+    void ShowUserDataFolderSizes();
     void CloseAppWindow();
     void ChangeLanguage();
     void UpdateCreationModeMenu();
@@ -209,9 +238,9 @@ private:
     std::wstring GetPrinterName();
     SamplePrintSettings GetSelectedPrinterPrintSettings(std::wstring printerName);
     bool PrintToPdfStream();
+    bool QueuePdfStreamExport();
     void ToggleTrackingPrevention();
 
-    std::wstring GetLocalPath(std::wstring path, bool keep_exe_path);
     void DeleteAllComponents();
 
     template <class ComponentType> std::unique_ptr<ComponentType> MoveComponent();
@@ -243,6 +272,13 @@ private:
     EventRegistrationToken m_browserExitedEventToken = {};
     UINT32 m_newestBrowserPid = 0;
 
+    RecoveryOrchestrator m_recoveryOrchestrator;
+    // Set by EvictWebView until the window is activated and the WebView is
+    // recreated, which then navigates to m_evictedUri.
+    bool m_isEvicted = false;
+    std::wstring m_evictedUri;
+    // Declared before the components so that it outlives them.
+    std::unique_ptr<WebResourceDispatcher> m_webResourceDispatcher;
     // All components are deleted when the WebView is closed.
     std::vector<std::unique_ptr<ComponentBase>> m_components;
     // options for creation of webview controller
@@ -260,6 +296,21 @@ private:
     // document title from web page that wants to show in window title bar
     std::wstring m_documentTitle;
 
+    // Accelerator keys, from assets\AcceleratorKeys.txt. The layout is the one
+    // of the current page's origin, resolved when the page changes.
+    KeyMap m_keyMap;
+    const KeyMap::Layout* m_keyLayout = nullptr;
+    KeyMap::ChordState m_keyChord;
+    // By action ID.
+    std::vector<std::function<void()>> m_acceleratorKeyActions;
+
+    // Deletes and measures user data folders in the background. Created on
+    // first use; destroying it cancels a cleanup in progress, whose leftovers
+    // are deleted by the next cleanup.
+    std::unique_ptr<FolderCleaner> m_folderCleaner;
+    // Shown in the title bar while a cleanup is in progress.
+    std::wstring m_cleanupStatus;
+
     bool m_AADSSOEnabled = false;
     bool m_ExclusiveUserDataFolderAccess = false;
 
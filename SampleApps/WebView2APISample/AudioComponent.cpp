@@ -5,38 +5,95 @@
 #include "stdafx.h"
 
 #include "AudioComponent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
 #include "CheckFailure.h"
 
 using namespace Microsoft::WRL;
 
+namespace
+{
+// The sessions of the AudioComponents of every thread.
+struct AudioSessions
+{
+    std::mutex mutex;
+    AudioSessionRegistry registry;
+    std::unordered_map<AudioSessionRegistry::SessionId, AudioComponent*> components;
+};
+
+AudioSessions& GetAudioSessions()
+{
+    static AudioSessions s_sessions;
+    return s_sessions;
+}
+
+int64_t GetNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace
+
 //! [IsDocumentPlayingAudioChanged] [IsDocumentPlayingAudio] [IsMutedChanged] [ToggleIsMuted]
 AudioComponent::AudioComponent(AppWindow* appWindow)
     : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
 {
-    auto webview2_8 = m_webView.try_query<ICoreWebView2_8>();
-    if (webview2_8)
+    m_webView8 = m_webView.try_query<ICoreWebView2_8>();
+    if (m_webView8)
     {
+        BOOL isDocumentPlayingAudio;
+        CHECK_FAILURE(m_webView8->get_IsDocumentPlayingAudio(&isDocumentPlayingAudio));
+        BOOL isMuted;
+        CHECK_FAILURE(m_webView8->get_IsMuted(&isMuted));
+        bool active = GetForegroundWindow() == m_appWindow->GetMainWindow();
+        UpdateSessions(
+            [&](AudioSessionRegistry& registry)
+            {
+                m_sessionId =
+                    registry.Add(!!isDocumentPlayingAudio, !!isMuted, active, GetNowUs());
+                GetAudioSessions().components[m_sessionId] = this;
+            });
+
         // Register a handler for the IsDocumentPlayingAudioChanged event.
-        CHECK_FAILURE(webview2_8->add_IsDocumentPlayingAudioChanged(
+        CHECK_FAILURE(m_webView8->add_IsDocumentPlayingAudioChanged(
             Callback<ICoreWebView2IsDocumentPlayingAudioChangedEventHandler>(
-                [this, webview2_8](ICoreWebView2* sender, IUnknown* args) -> HRESULT
+                [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT
                 {
-                    UpdateTitleWithMuteState(webview2_8);
+                    BOOL isDocumentPlayingAudio;
+                    CHECK_FAILURE(
+                        m_webView8->get_IsDocumentPlayingAudio(&isDocumentPlayingAudio));
+                    UpdateSessions(
+                        [&](AudioSessionRegistry& registry) {
+                            registry.OnPlayingChanged(
+                                m_sessionId, !!isDocumentPlayingAudio, GetNowUs());
+                        });
+                    ScheduleTitleUpdate();
                     return S_OK;
                 })
                 .Get(),
             &m_isDocumentPlayingAudioChangedToken));
 
         // Register a handler for the IsMutedChanged event.
-        CHECK_FAILURE(webview2_8->add_IsMutedChanged(
+        CHECK_FAILURE(m_webView8->add_IsMutedChanged(
             Callback<ICoreWebView2IsMutedChangedEventHandler>(
-                [this, webview2_8](ICoreWebView2* sender, IUnknown* args) -> HRESULT
+                [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT
                 {
-                    UpdateTitleWithMuteState(webview2_8);
+                    BOOL isMuted;
+                    CHECK_FAILURE(m_webView8->get_IsMuted(&isMuted));
+                    UpdateSessions(
+                        [&](AudioSessionRegistry& registry)
+                        { registry.OnMutedChanged(m_sessionId, !!isMuted, GetNowUs()); });
+                    ScheduleTitleUpdate();
                     return S_OK;
                 })
                 .Get(),
             &m_isMutedChangedToken));
+        ScheduleTitleUpdate();
     }
 }
 
@@ -50,64 +107,168 @@ bool AudioComponent::HandleWindowMessage(
         case IDM_TOGGLE_MUTE_STATE:
             ToggleMuteState();
             return true;
+        case IDM_AUDIO_POLICY_ALLOW_ALL:
+            UpdateSessions([](AudioSessionRegistry& registry)
+                           { registry.SetPolicy(AudioSessionRegistry::Policy::AllowAll); });
+            return true;
+        case IDM_AUDIO_POLICY_FOCUSED_ONLY:
+            UpdateSessions([](AudioSessionRegistry& registry)
+                           { registry.SetPolicy(AudioSessionRegistry::Policy::FocusedOnly); });
+            return true;
+        case IDM_AUDIO_POLICY_MUTE_BACKGROUND:
+            UpdateSessions(
+                [](AudioSessionRegistry& registry)
+                { registry.SetPolicy(AudioSessionRegistry::Policy::MuteBackground); });
+            return true;
+        case IDM_AUDIO_SESSION_REPORT:
+            ShowReport();
+            return true;
         }
     }
+    else if (message == WM_ACTIVATE && LOWORD(wParam) != WA_INACTIVE && m_webView8)
+    {
+        // Other components and the AppWindow handle activation too.
+        UpdateSessions([this](AudioSessionRegistry& registry)
+                       { registry.OnActivated(m_sessionId); });
+    }
+    else if (message == WM_TIMER && wParam == c_titleTimerId)
+    {
+        OnTitleTimer();
+        return true;
+    }
     return false;
 }
 
 // Toggle the mute state of the current window and show a mute or unmute icon on the title bar
 void AudioComponent::ToggleMuteState()
 {
-    auto webview2_8 = m_webView.try_query<ICoreWebView2_8>();
-    if (webview2_8)
-     {
-         BOOL isMuted;
-         CHECK_FAILURE(webview2_8->get_IsMuted(&isMuted));
-         CHECK_FAILURE(webview2_8->put_IsMuted(!isMuted));
-         std::wstring result = !isMuted ? L"WebView is Now Muted" : L"WebView is Now Unmuted";
-         MessageBox(nullptr, result.c_str(), L"Mute State Changed", MB_OK);
-     }
- }
-
- void AudioComponent::UpdateTitleWithMuteState(wil::com_ptr<ICoreWebView2_8> webview2_8)
- {
-     BOOL isDocumentPlayingAudio;
-     CHECK_FAILURE(webview2_8->get_IsDocumentPlayingAudio(&isDocumentPlayingAudio));
-
-     BOOL isMuted;
-     CHECK_FAILURE(webview2_8->get_IsMuted(&isMuted));
-
-     wil::unique_cotaskmem_string title;
-     CHECK_FAILURE(m_webView->get_DocumentTitle(&title));
-     std::wstring result = L"";
-
-     if (isDocumentPlayingAudio)
-     {
-         if (isMuted)
-         {
-             result = L"🔇 " + std::wstring(title.get());
-         }
-         else
-         {
-             result = L"🔊 " + std::wstring(title.get());
-         }
-     }
-     else
-     {
-         result = std::wstring(title.get());
-     }
-
-     m_appWindow->SetDocumentTitle(result.c_str());
- }
- //! [IsDocumentPlayingAudioChanged] [IsDocumentPlayingAudio] [IsMutedChanged] [ToggleIsMuted]
-
- AudioComponent::~AudioComponent()
- {
-     auto webview2_8 = m_webView.try_query<ICoreWebView2_8>();
-     if (webview2_8)
-     {
-         CHECK_FAILURE(webview2_8->remove_IsDocumentPlayingAudioChanged(
-             m_isDocumentPlayingAudioChangedToken));
-         CHECK_FAILURE(webview2_8->remove_IsMutedChanged(m_isMutedChangedToken));
+    if (m_webView8)
+    {
+        BOOL isMuted;
+        CHECK_FAILURE(m_webView8->get_IsMuted(&isMuted));
+        CHECK_FAILURE(m_webView8->put_IsMuted(!isMuted));
+        std::wstring result = !isMuted ? L"WebView is Now Muted" : L"WebView is Now Unmuted";
+        MessageBox(nullptr, result.c_str(), L"Mute State Changed", MB_OK);
+    }
+}
+
+void AudioComponent::UpdateTitleWithMuteState(AudioSessionRegistry::Indicator indicator)
+{
+    wil::unique_cotaskmem_string title;
+    CHECK_FAILURE(m_webView->get_DocumentTitle(&title));
+    std::wstring result = L"";
+
+    switch (indicator)
+    {
+    case AudioSessionRegistry::Indicator::Muted:
+        result = L"🔇 " + std::wstring(title.get());
+        break;
+    case AudioSessionRegistry::Indicator::Playing:
+        result = L"🔊 " + std::wstring(title.get());
+        break;
+    case AudioSessionRegistry::Indicator::None:
+        result = std::wstring(title.get());
+        break;
+    }
+
+    m_appWindow->SetDocumentTitle(result.c_str());
+}
+//! [IsDocumentPlayingAudioChanged] [IsDocumentPlayingAudio] [IsMutedChanged] [ToggleIsMuted]
+
+void AudioComponent::UpdateSessions(const std::function<void(AudioSessionRegistry&)>& update)
+{
+    AudioSessions& sessions = GetAudioSessions();
+    std::lock_guard<std::mutex> lock(sessions.mutex);
+    update(sessions.registry);
+    for (const AudioSessionRegistry::Action& action : sessions.registry.TakeActions())
+    {
+        // The lock keeps the component, and so its AppWindow, from going away.
+        auto component = sessions.components.find(action.id);
+        if (component != sessions.components.end())
+        {
+            component->second->m_appWindow->RunAsync(
+                [id = action.id, muted = action.muted] { ApplyMute(id, muted); });
+        }
+    }
+}
+
+// Runs on the thread of the session's AppWindow, where its component is
+// created and deleted.
+void AudioComponent::ApplyMute(AudioSessionRegistry::SessionId id, bool muted)
+{
+    AudioComponent* component = nullptr;
+    {
+        AudioSessions& sessions = GetAudioSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        auto entry = sessions.components.find(id);
+        if (entry == sessions.components.end())
+        {
+            return;
+        }
+        component = entry->second;
+    }
+    // Not under the lock, as the WebView may raise IsMutedChanged right away.
+    CHECK_FAILURE(component->m_webView8->put_IsMuted(muted));
+}
+
+void AudioComponent::ScheduleTitleUpdate()
+{
+    int64_t dueUs;
+    {
+        AudioSessions& sessions = GetAudioSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        dueUs = sessions.registry.GetTitleDueUs(m_sessionId);
+    }
+    if (dueUs >= 0)
+    {
+        int64_t delayMs = (std::max)((dueUs - GetNowUs() + 999) / 1000, int64_t(1));
+        SetTimer(
+            m_appWindow->GetMainWindow(), c_titleTimerId, static_cast<UINT>(delayMs), nullptr);
+    }
+}
+
+void AudioComponent::OnTitleTimer()
+{
+    KillTimer(m_appWindow->GetMainWindow(), c_titleTimerId);
+    AudioSessionRegistry::Indicator indicator;
+    bool update;
+    {
+        AudioSessions& sessions = GetAudioSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        update = sessions.registry.TakeTitleUpdate(m_sessionId, GetNowUs(), &indicator);
     }
-}
\ No newline at end of file
+    if (update)
+    {
+        UpdateTitleWithMuteState(indicator);
+    }
+    // In case the timer fired early.
+    ScheduleTitleUpdate();
+}
+
+void AudioComponent::ShowReport()
+{
+    std::string report;
+    {
+        AudioSessions& sessions = GetAudioSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        report = sessions.registry.GetReport();
+    }
+    MessageBox(
+        m_appWindow->GetMainWindow(), std::wstring(report.begin(), report.end()).c_str(),
+        L"Audio Sessions", MB_OK);
+}
+
+AudioComponent::~AudioComponent()
+{
+    if (m_webView8)
+    {
+        CHECK_FAILURE(m_webView8->remove_IsDocumentPlayingAudioChanged(
+            m_isDocumentPlayingAudioChangedToken));
+        CHECK_FAILURE(m_webView8->remove_IsMutedChanged(m_isMutedChangedToken));
+        KillTimer(m_appWindow->GetMainWindow(), c_titleTimerId);
+        AudioSessions& sessions = GetAudioSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        sessions.registry.Remove(m_sessionId);
+        sessions.components.erase(m_sessionId);
+    }
+}
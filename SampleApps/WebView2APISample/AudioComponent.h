@@ -5,9 +5,14 @@
 #pragma once
 
 #include "AppWindow.h"
+#include "AudioSessionRegistry.h"
 #include "ComponentBase.h"
 
 // This component handles commands from the Audio menu.
+//
+// The audio state of the WebViews of all app windows, on whatever thread, is
+// kept in one AudioSessionRegistry, which debounces the audio indicator in the
+// title and applies the audio policy chosen from the menu.
 class AudioComponent : public ComponentBase
 {
 public:
@@ -21,13 +26,25 @@ public:
         LRESULT* result) override;
 
     void ToggleMuteState();
-    void UpdateTitleWithMuteState(wil::com_ptr<ICoreWebView2_8> webview2_8);
+    void UpdateTitleWithMuteState(AudioSessionRegistry::Indicator indicator);
 
     ~AudioComponent() override;
 
 private:
+    static constexpr UINT_PTR c_titleTimerId = 0x4155;
+
+    // Applies `update` to the registry, then the mute changes the policy asks
+    // for, which may be for the WebViews of other threads.
+    void UpdateSessions(const std::function<void(AudioSessionRegistry&)>& update);
+    static void ApplyMute(AudioSessionRegistry::SessionId id, bool muted);
+    void ScheduleTitleUpdate();
+    void OnTitleTimer();
+    void ShowReport();
+
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2_8> m_webView8;
+    AudioSessionRegistry::SessionId m_sessionId = AudioSessionRegistry::c_noSession;
 
     EventRegistrationToken m_isDocumentPlayingAudioChangedToken = {};
     EventRegistrationToken m_isMutedChangedToken = {};
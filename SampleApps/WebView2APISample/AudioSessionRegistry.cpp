@@ -0,0 +1,230 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AudioSessionRegistry.h"
+
+#include <algorithm>
+#include <sstream>
+
+AudioSessionRegistry::SessionId AudioSessionRegistry::Add(
+    bool playing, bool muted, bool active, int64_t nowUs)
+{
+    SessionId id = m_nextId++;
+    Session& session = m_sessions[id];
+    session.playing = playing;
+    session.muted = muted;
+    if (active)
+    {
+        m_activeId = id;
+    }
+    if (GetIndicator(session) != session.shown)
+    {
+        ScheduleTitleUpdate(&session, nowUs);
+    }
+    Enforce(id, &session);
+    return id;
+}
+
+void AudioSessionRegistry::Remove(SessionId id)
+{
+    m_sessions.erase(id);
+    if (m_activeId == id)
+    {
+        m_activeId = c_noSession;
+    }
+    m_actions.erase(
+        std::remove_if(
+            m_actions.begin(), m_actions.end(), [id](const Action& action)
+            { return action.id == id; }),
+        m_actions.end());
+}
+
+void AudioSessionRegistry::SetPolicy(Policy policy)
+{
+    m_policy = policy;
+    for (auto& entry : m_sessions)
+    {
+        entry.second.userOverride = false;
+        Enforce(entry.first, &entry.second);
+    }
+}
+
+void AudioSessionRegistry::OnPlayingChanged(SessionId id, bool playing, int64_t nowUs)
+{
+    auto session = m_sessions.find(id);
+    if (session == m_sessions.end() || session->second.playing == playing)
+    {
+        m_redundantEvents++;
+        return;
+    }
+    m_playingTransitions++;
+    session->second.playing = playing;
+    ScheduleTitleUpdate(&session->second, nowUs);
+    Enforce(id, &session->second);
+}
+
+void AudioSessionRegistry::OnMutedChanged(SessionId id, bool muted, int64_t nowUs)
+{
+    auto entry = m_sessions.find(id);
+    if (entry == m_sessions.end() || entry->second.muted == muted)
+    {
+        m_redundantEvents++;
+        return;
+    }
+    m_mutedTransitions++;
+    Session& session = entry->second;
+    session.muted = muted;
+    if (session.requestedMute != static_cast<int8_t>(muted))
+    {
+        // Changed by the user, whose choice stands over the policy's.
+        session.mutedByPolicy = false;
+        if (!muted && id != m_activeId)
+        {
+            session.userOverride = true;
+            m_userOverrides++;
+        }
+    }
+    session.requestedMute = -1;
+    ScheduleTitleUpdate(&session, nowUs);
+    Enforce(id, &session);
+}
+
+void AudioSessionRegistry::OnActivated(SessionId id)
+{
+    if (id == m_activeId)
+    {
+        return;
+    }
+    m_activations++;
+    SessionId previous = m_activeId;
+    m_activeId = id;
+    auto session = m_sessions.find(previous);
+    if (session != m_sessions.end())
+    {
+        Enforce(previous, &session->second);
+    }
+    session = m_sessions.find(id);
+    if (session != m_sessions.end())
+    {
+        session->second.userOverride = false;
+        Enforce(id, &session->second);
+    }
+}
+
+std::vector<AudioSessionRegistry::Action> AudioSessionRegistry::TakeActions()
+{
+    std::vector<Action> actions;
+    actions.swap(m_actions);
+    return actions;
+}
+
+int64_t AudioSessionRegistry::GetTitleDueUs(SessionId id) const
+{
+    auto session = m_sessions.find(id);
+    return session == m_sessions.end() ? -1 : session->second.titleDueUs;
+}
+
+bool AudioSessionRegistry::TakeTitleUpdate(SessionId id, int64_t nowUs, Indicator* indicator)
+{
+    auto entry = m_sessions.find(id);
+    if (entry == m_sessions.end() || entry->second.titleDueUs < 0 ||
+        nowUs < entry->second.titleDueUs)
+    {
+        return false;
+    }
+    Session& session = entry->second;
+    session.titleDueUs = -1;
+    *indicator = GetIndicator(session);
+    if (*indicator == session.shown)
+    {
+        m_skippedTitleUpdates++;
+        return false;
+    }
+    session.shown = *indicator;
+    m_titleUpdates++;
+    return true;
+}
+
+size_t AudioSessionRegistry::GetPlayingCount() const
+{
+    return std::count_if(
+        m_sessions.begin(), m_sessions.end(),
+        [](const auto& entry) { return entry.second.playing; });
+}
+
+std::string AudioSessionRegistry::GetReport() const
+{
+    static const char* const c_policyNames[] = {
+        "allow all", "only the focused window plays", "mute background windows"};
+    size_t muted = std::count_if(
+        m_sessions.begin(), m_sessions.end(),
+        [](const auto& entry) { return entry.second.muted; });
+    std::ostringstream report;
+    report << "Policy: " << c_policyNames[static_cast<int>(m_policy)] << "\n"
+           << m_sessions.size() << " WebViews, " << GetPlayingCount() << " playing, "
+           << muted << " muted\n\n"
+           << "Playing transitions: " << m_playingTransitions << "\n"
+           << "Muted transitions: " << m_mutedTransitions << "\n"
+           << "Events without a change: " << m_redundantEvents << "\n"
+           << "Window activations: " << m_activations << "\n"
+           << "Muted by the policy: " << m_policyMutes << ", unmuted: " << m_policyUnmutes
+           << "\n"
+           << "Unmuted by the user in the background: " << m_userOverrides << "\n"
+           << "Title updates: " << m_titleUpdates << ", skipped as unchanged: "
+           << m_skippedTitleUpdates << "\n";
+    return report.str();
+}
+
+AudioSessionRegistry::Indicator AudioSessionRegistry::GetIndicator(const Session& session)
+{
+    if (!session.playing)
+    {
+        return Indicator::None;
+    }
+    return session.muted ? Indicator::Muted : Indicator::Playing;
+}
+
+void AudioSessionRegistry::ScheduleTitleUpdate(Session* session, int64_t nowUs)
+{
+    // The first change sets the time, so that changes that keep coming don't
+    // hold the title back.
+    if (session->titleDueUs < 0)
+    {
+        session->titleDueUs = nowUs + c_titleDebounceUs;
+    }
+}
+
+void AudioSessionRegistry::Enforce(SessionId id, Session* session)
+{
+    bool muted = session->requestedMute >= 0 ? session->requestedMute != 0 : session->muted;
+    bool background = id != m_activeId;
+    bool muteWanted = false;
+    switch (m_policy)
+    {
+    case Policy::AllowAll:
+        break;
+    case Policy::FocusedOnly:
+        muteWanted = background && session->playing;
+        break;
+    case Policy::MuteBackground:
+        muteWanted = background;
+        break;
+    }
+    if (muteWanted && !muted && !session->userOverride)
+    {
+        RequestMute(id, session, true);
+    }
+    else if (session->mutedByPolicy && muted && (!background || m_policy == Policy::AllowAll))
+    {
+        RequestMute(id, session, false);
+    }
+}
+
+void AudioSessionRegistry::RequestMute(SessionId id, Session* session, bool muted)
+{
+    session->requestedMute = muted ? 1 : 0;
+    session->mutedByPolicy = muted;
+    m_actions.push_back({id, muted});
+    (muted ? m_policyMutes : m_policyUnmutes)++;
+}
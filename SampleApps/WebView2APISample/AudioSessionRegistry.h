@@ -0,0 +1,124 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// AudioSessionRegistry tracks the audio state of the WebViews of every app
+// window, one session per WebView, and applies an app-wide audio policy.
+//
+// The host reports the IsDocumentPlayingAudioChanged and IsMutedChanged
+// events of each WebView and the activation of its window. Events that don't
+// change the state are counted and otherwise ignored.
+//
+// The audio indicator in a window's title is debounced: the first change of
+// a session's indicator schedules a title update c_titleDebounceUs later, and
+// TakeTitleUpdate only asks for one if the indicator then differs from the
+// one shown. Audio that stops and starts again within that time, as it does
+// between tracks, leaves the title alone.
+//
+// Under a policy other than AllowAll, the registry asks the host to mute the
+// sessions of the windows other than the one last activated, and to unmute
+// them when their window is activated again. A session the user unmutes
+// while in the background is left alone until its window is next activated.
+//
+// Times are in microseconds on any monotonic clock. Not thread-safe. Has no
+// dependency on Win32.
+class AudioSessionRegistry
+{
+public:
+    using SessionId = uint32_t;
+
+    enum class Policy
+    {
+        AllowAll,
+        // Mutes the background windows that play audio.
+        FocusedOnly,
+        // Mutes every background window, playing or not.
+        MuteBackground,
+    };
+
+    enum class Indicator
+    {
+        None,
+        Playing,
+        Muted,
+    };
+
+    // A change of mute state for the host to apply to a session.
+    struct Action
+    {
+        SessionId id;
+        bool muted;
+    };
+
+    static constexpr SessionId c_noSession = 0;
+    static constexpr int64_t c_titleDebounceUs = 250000;
+
+    SessionId Add(bool playing, bool muted, bool active, int64_t nowUs);
+    void Remove(SessionId id);
+
+    void SetPolicy(Policy policy);
+    Policy GetPolicy() const
+    {
+        return m_policy;
+    }
+
+    void OnPlayingChanged(SessionId id, bool playing, int64_t nowUs);
+    void OnMutedChanged(SessionId id, bool muted, int64_t nowUs);
+    void OnActivated(SessionId id);
+
+    // Returns and forgets the mute changes the policy asks for.
+    std::vector<Action> TakeActions();
+
+    // Returns -1 if no title update is scheduled for the session.
+    int64_t GetTitleDueUs(SessionId id) const;
+    // Returns true if the title of the session's window should now show
+    // `indicator`.
+    bool TakeTitleUpdate(SessionId id, int64_t nowUs, Indicator* indicator);
+
+    size_t GetPlayingCount() const;
+    std::string GetReport() const;
+
+private:
+    struct Session
+    {
+        bool playing = false;
+        bool muted = false;
+        // The mute state last asked for by the policy, until it's reported.
+        int8_t requestedMute = -1;
+        // Muted by the policy rather than by the user.
+        bool mutedByPolicy = false;
+        // Unmuted by the user in the background.
+        bool userOverride = false;
+        Indicator shown = Indicator::None;
+        int64_t titleDueUs = -1;
+    };
+
+    static Indicator GetIndicator(const Session& session);
+    void ScheduleTitleUpdate(Session* session, int64_t nowUs);
+    void Enforce(SessionId id, Session* session);
+    void RequestMute(SessionId id, Session* session, bool muted);
+
+    std::unordered_map<SessionId, Session> m_sessions;
+    SessionId m_nextId = 1;
+    SessionId m_activeId = c_noSession;
+    Policy m_policy = Policy::AllowAll;
+    std::vector<Action> m_actions;
+
+    uint64_t m_redundantEvents = 0;
+    uint64_t m_playingTransitions = 0;
+    uint64_t m_mutedTransitions = 0;
+    uint64_t m_activations = 0;
+    uint64_t m_policyMutes = 0;
+    uint64_t m_policyUnmutes = 0;
+    uint64_t m_userOverrides = 0;
+    uint64_t m_titleUpdates = 0;
+    uint64_t m_skippedTitleUpdates = 0;
+};
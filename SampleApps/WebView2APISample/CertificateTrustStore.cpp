@@ -0,0 +1,145 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CertificateTrustStore.h"
+
+#include <iterator>
+
+#include "PemCertificateScanner.h"
+
+CertificateTrustStore::CertificateTrustStore(Clock::duration verdictLifetime)
+    : m_verdictLifetime(verdictLifetime)
+{
+}
+
+size_t CertificateTrustStore::AddPemBundle(std::string_view pem)
+{
+    PemCertificateScanner scanner(pem);
+    std::vector<uint8_t> der;
+    size_t added = 0;
+    while (scanner.Next(&der))
+    {
+        Thumbprint thumbprint = Sha256::Hash(der.data(), der.size());
+        PemCertificateScanner::Names names;
+        bool hasNames = PemCertificateScanner::ParseNames(der.data(), der.size(), &names);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        added += m_pinned.insert(thumbprint).second ? 1 : 0;
+        if (hasNames)
+        {
+            m_pinnedSubjects.insert(Sha256::Hash(names.subject.data, names.subject.size));
+        }
+    }
+    if (added)
+    {
+        ClearVerdicts();
+    }
+    return added;
+}
+
+void CertificateTrustStore::AddThumbprint(const Thumbprint& thumbprint)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pinned.insert(thumbprint);
+    }
+    ClearVerdicts();
+}
+
+bool CertificateTrustStore::IsPinned(const Thumbprint& thumbprint) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pinned.count(thumbprint) != 0;
+}
+
+size_t CertificateTrustStore::GetPinnedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pinned.size();
+}
+
+bool CertificateTrustStore::IsTrusted(
+    const std::string& host, std::string_view leafPem, Clock::time_point now)
+{
+    // Comparing the PEM text is much cheaper than decoding and SHA-256 hashing
+    // the certificate.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_counters.evaluations++;
+        auto cached = m_verdicts.find(host);
+        if (cached != m_verdicts.end() && cached->second.leafPem == leafPem &&
+            cached->second.expires > now)
+        {
+            m_counters.cacheHits++;
+            return cached->second.trusted;
+        }
+    }
+
+    bool trusted = IsFirstPinned(leafPem);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_verdicts.size() >= c_maxCachedVerdicts && m_verdicts.count(host) == 0)
+    {
+        for (auto it = m_verdicts.begin(); it != m_verdicts.end();)
+        {
+            it = it->second.expires > now ? std::next(it) : m_verdicts.erase(it);
+        }
+        if (m_verdicts.size() >= c_maxCachedVerdicts)
+        {
+            m_verdicts.clear();
+        }
+    }
+    CachedVerdict& verdict = m_verdicts[host];
+    verdict.leafPem.assign(leafPem.data(), leafPem.size());
+    verdict.trusted = trusted;
+    verdict.expires = now + m_verdictLifetime;
+    return trusted;
+}
+
+bool CertificateTrustStore::HasTrustedIssuer(std::string_view pem)
+{
+    PemCertificateScanner scanner(pem);
+    std::vector<uint8_t> der;
+    PemCertificateScanner::Names names;
+    if (!scanner.Next(&der) ||
+        !PemCertificateScanner::ParseNames(der.data(), der.size(), &names))
+    {
+        return false;
+    }
+    Thumbprint issuer = Sha256::Hash(names.issuer.data, names.issuer.size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pinnedSubjects.count(issuer) != 0;
+}
+
+void CertificateTrustStore::ClearVerdicts()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_verdicts.clear();
+}
+
+size_t CertificateTrustStore::GetCachedVerdictCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_verdicts.size();
+}
+
+CertificateTrustStore::Counters CertificateTrustStore::GetCounters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+bool CertificateTrustStore::IsFirstPinned(std::string_view pem)
+{
+    PemCertificateScanner scanner(pem);
+    std::vector<uint8_t> der;
+    if (!scanner.Next(&der))
+    {
+        return false;
+    }
+    Thumbprint thumbprint = Sha256::Hash(der.data(), der.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_counters.certificatesHashed++;
+    return m_pinned.count(thumbprint) != 0;
+}
@@ -0,0 +1,106 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Sha256.h"
+
+// CertificateTrustStore holds the certificates the app trusts even though
+// WebView2 does not, e.g. a self-signed development server. Certificates are
+// pinned by the SHA-256 thumbprint of their DER encoding, and the subject
+// names of pinned certificates form an issuer index used to pick client
+// certificates.
+//
+// Only a server's own certificate is checked against the pins. The issuer
+// chain a server sends is not validated here, so anyone could append a pinned
+// certificate to it. Verdicts are cached per host, so repeated certificate
+// errors from the same host cost a comparison of the PEM text until the
+// verdict expires or the host presents a different certificate. At most
+// c_maxCachedVerdicts hosts are cached; when a new host finds the cache full,
+// expired verdicts are dropped, and if none had expired it is started over.
+//
+// Safe to use from several threads. Has no dependency on Win32; certificates
+// are passed in as PEM text.
+class CertificateTrustStore
+{
+public:
+    using Thumbprint = Sha256::Digest;
+    using Clock = std::chrono::steady_clock;
+
+    struct Counters
+    {
+        uint64_t evaluations = 0;
+        uint64_t cacheHits = 0;
+        uint64_t certificatesHashed = 0;
+    };
+
+    static constexpr std::chrono::seconds c_defaultVerdictLifetime{300};
+    static constexpr size_t c_maxCachedVerdicts = 4096;
+
+    explicit CertificateTrustStore(
+        Clock::duration verdictLifetime = c_defaultVerdictLifetime);
+
+    // Pins every certificate in a PEM bundle. Returns how many were added.
+    size_t AddPemBundle(std::string_view pem);
+    void AddThumbprint(const Thumbprint& thumbprint);
+    bool IsPinned(const Thumbprint& thumbprint) const;
+    size_t GetPinnedCount() const;
+
+    // Returns true if the certificate in `leafPem` is pinned. The verdict is
+    // cached for `host`.
+    bool IsTrusted(
+        const std::string& host, std::string_view leafPem,
+        Clock::time_point now = Clock::now());
+
+    // Returns true if the certificate in `pem` was issued by the subject of a
+    // pinned certificate.
+    bool HasTrustedIssuer(std::string_view pem);
+
+    void ClearVerdicts();
+    size_t GetCachedVerdictCount() const;
+    Counters GetCounters() const;
+
+private:
+    struct DigestHash
+    {
+        size_t operator()(const Thumbprint& digest) const
+        {
+            // The digest is already uniformly distributed.
+            size_t value;
+            memcpy(&value, digest.data(), sizeof(value));
+            return value;
+        }
+    };
+
+    struct CachedVerdict
+    {
+        // Compared in full: a hash of it could collide with another
+        // certificate's and answer with that certificate's verdict.
+        std::string leafPem;
+        bool trusted = false;
+        Clock::time_point expires;
+    };
+
+    // Hashes the first certificate in `pem` and checks it against the pinned
+    // set. Call without holding m_mutex.
+    bool IsFirstPinned(std::string_view pem);
+
+    Clock::duration m_verdictLifetime;
+    mutable std::mutex m_mutex;
+    std::unordered_set<Thumbprint, DigestHash> m_pinned;
+    // SHA-256 of the DER subject Name of each pinned certificate.
+    std::unordered_set<Thumbprint, DigestHash> m_pinnedSubjects;
+    std::unordered_map<std::string, CachedVerdict> m_verdicts;
+    Counters m_counters;
+};
@@ -0,0 +1,472 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ConsoleLogBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+// Formats microseconds since the Unix epoch as an ISO 8601 UTC time. Unlike
+// gmtime, this is safe to call from any thread.
+std::string FormatTime(int64_t timeMicros)
+{
+    int64_t seconds = timeMicros / 1000000;
+    int64_t micros = timeMicros % 1000000;
+    if (micros < 0)
+    {
+        micros += 1000000;
+        seconds--;
+    }
+    int64_t days = seconds / 86400;
+    int64_t secondOfDay = seconds % 86400;
+    if (secondOfDay < 0)
+    {
+        secondOfDay += 86400;
+        days--;
+    }
+    // Converts days since 1970-01-01 to a civil date; see
+    // http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    char buffer[64];
+    snprintf(
+        buffer, sizeof(buffer), "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%06lldZ",
+        static_cast<long long>(year), static_cast<long long>(month),
+        static_cast<long long>(day), static_cast<long long>(secondOfDay / 3600),
+        static_cast<long long>(secondOfDay / 60 % 60), static_cast<long long>(secondOfDay % 60),
+        static_cast<long long>(micros));
+    return buffer;
+}
+
+std::filesystem::path GetRotatedPath(const std::filesystem::path& path, size_t index)
+{
+    std::filesystem::path rotated = path;
+    rotated += "." + std::to_string(index);
+    return rotated;
+}
+} // namespace
+
+ConsoleLogBuffer::ConsoleLogBuffer(const Options& options)
+    : m_options(options), m_slots(new Slot[c_capacity])
+{
+    if (m_options.path.empty())
+    {
+        return;
+    }
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(m_options.path, error);
+    m_fileBytes = error ? 0 : size;
+    m_file.open(m_options.path, std::ios::binary | std::ios::app);
+    m_drainThread = std::thread([this] { DrainLoop(); });
+}
+
+ConsoleLogBuffer::~ConsoleLogBuffer()
+{
+    if (m_drainThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stopMutex);
+            m_stop = true;
+        }
+        m_stopCondition.notify_one();
+        m_drainThread.join();
+    }
+    Flush();
+}
+
+uint32_t ConsoleLogBuffer::InternTarget(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_targetMutex);
+    auto it = m_targetIds.find(name);
+    if (it != m_targetIds.end())
+    {
+        m_targets[it->second].references++;
+        return it->second;
+    }
+    // Reuse the oldest released target once no slot can hold its messages.
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    while (!m_releasedTargets.empty())
+    {
+        auto [id, releasedAt] = m_releasedTargets.front();
+        Target& target = m_targets[id];
+        if (target.references == 0 && target.releasedAt == releasedAt)
+        {
+            if (head - releasedAt < c_capacity)
+            {
+                break;
+            }
+            m_releasedTargets.pop_front();
+            m_targetIds.erase(target.name);
+            target.name = name;
+            target.references = 1;
+            m_targetIds.emplace(name, id);
+            return id;
+        }
+        m_releasedTargets.pop_front();
+    }
+    uint32_t id = static_cast<uint32_t>(m_targets.size());
+    m_targets.push_back({name, 1});
+    m_targetIds.emplace(name, id);
+    return id;
+}
+
+void ConsoleLogBuffer::ReleaseTarget(uint32_t target)
+{
+    std::lock_guard<std::mutex> lock(m_targetMutex);
+    if (target >= m_targets.size() || m_targets[target].references == 0)
+    {
+        return;
+    }
+    if (--m_targets[target].references == 0)
+    {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        m_targets[target].releasedAt = head;
+        m_releasedTargets.emplace_back(target, head);
+    }
+}
+
+std::string ConsoleLogBuffer::GetTargetName(uint32_t target) const
+{
+    std::lock_guard<std::mutex> lock(m_targetMutex);
+    return target < m_targets.size() ? m_targets[target].name : std::string();
+}
+
+void ConsoleLogBuffer::Push(
+    int64_t timeMicros, uint32_t target, Level level, std::string_view args)
+{
+    uint64_t index = m_head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[index % c_capacity];
+    // Mark the slot as being written before touching its contents.
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    size_t length = (std::min)(args.size(), c_maxArgsBytes);
+    slot.timeMicros = timeMicros;
+    slot.target = target;
+    slot.level = level;
+    slot.truncated = length < args.size();
+    slot.length = static_cast<uint16_t>(length);
+    memcpy(slot.args, args.data(), length);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void ConsoleLogBuffer::PushConsoleApiCalled(
+    int64_t timeMicros, uint32_t target, std::string_view json)
+{
+    std::string_view type = FindJsonValue(json, "type");
+    if (type.size() >= 2 && type.front() == '"')
+    {
+        type = type.substr(1, type.size() - 2);
+    }
+    Push(timeMicros, target, ParseLevel(type), FindJsonValue(json, "args"));
+}
+
+bool ConsoleLogBuffer::ReadSlot(uint64_t index, Record* record, bool* overwritten) const
+{
+    const Slot& slot = m_slots[index % c_capacity];
+    uint64_t complete = 2 * index + 2;
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != complete)
+    {
+        if (overwritten)
+        {
+            *overwritten = before > complete;
+        }
+        return false;
+    }
+    record->sequence = index;
+    record->timeMicros = slot.timeMicros;
+    record->target = slot.target;
+    record->level = slot.level;
+    record->truncated = slot.truncated;
+    record->args.assign(slot.args, (std::min)(size_t(slot.length), c_maxArgsBytes));
+    // A writer that claimed the slot meanwhile has changed the sequence.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != complete)
+    {
+        if (overwritten)
+        {
+            *overwritten = true;
+        }
+        return false;
+    }
+    return true;
+}
+
+std::vector<ConsoleLogBuffer::Record> ConsoleLogBuffer::Query(
+    uint32_t target, Level minLevel, size_t maxCount) const
+{
+    std::vector<Record> records;
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t oldest = head > c_capacity ? head - c_capacity : 0;
+    Record record;
+    for (uint64_t index = head; index > oldest && records.size() < maxCount; index--)
+    {
+        if (ReadSlot(index - 1, &record) && record.level >= minLevel &&
+            (target == c_anyTarget || record.target == target))
+        {
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+void ConsoleLogBuffer::DrainLoop()
+{
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    while (!m_stop)
+    {
+        m_stopCondition.wait_for(lock, m_options.drainInterval);
+        lock.unlock();
+        Drain();
+        lock.lock();
+    }
+}
+
+void ConsoleLogBuffer::Flush()
+{
+    Drain();
+}
+
+void ConsoleLogBuffer::Drain()
+{
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+    if (!m_file.is_open())
+    {
+        return;
+    }
+    // The names are copied after the head is read: the targets of the records
+    // before it were interned before they were pushed, and a reused target's
+    // old records are all overwritten.
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    std::vector<std::string> targets;
+    {
+        std::lock_guard<std::mutex> targetLock(m_targetMutex);
+        for (const Target& target : m_targets)
+        {
+            targets.push_back(target.name);
+        }
+    }
+    if (head - m_drainPosition > c_capacity)
+    {
+        m_dropped += head - c_capacity - m_drainPosition;
+        m_drainPosition = head - c_capacity;
+    }
+    Record record;
+    while (m_drainPosition < head)
+    {
+        bool overwritten = false;
+        if (ReadSlot(m_drainPosition, &record, &overwritten))
+        {
+            WriteLine(record, targets);
+        }
+        else if (overwritten)
+        {
+            m_dropped++;
+        }
+        else
+        {
+            // Still being written, or written by a writer that was lapped and
+            // stored an older record. A push takes far less than a drain
+            // interval, so a slot that stays incomplete that long is skipped.
+            auto now = std::chrono::steady_clock::now();
+            if (m_stalledPosition != m_drainPosition)
+            {
+                m_stalledPosition = m_drainPosition;
+                m_stalledSince = now;
+                break;
+            }
+            if (now - m_stalledSince < m_options.drainInterval)
+            {
+                break;
+            }
+            m_dropped++;
+        }
+        m_drainPosition++;
+    }
+    m_file.flush();
+}
+
+void ConsoleLogBuffer::WriteLine(const Record& record, const std::vector<std::string>& targets)
+{
+    std::string line = FormatTime(record.timeMicros);
+    line += '\t';
+    line += GetLevelName(record.level);
+    line += '\t';
+    if (record.target < targets.size())
+    {
+        line += targets[record.target];
+    }
+    line += '\t';
+    line += record.args;
+    if (record.truncated)
+    {
+        line += "...";
+    }
+    line += '\n';
+
+    if (m_fileBytes && m_fileBytes + line.size() > m_options.maxFileBytes)
+    {
+        Rotate();
+    }
+    m_file.write(line.data(), line.size());
+    m_fileBytes += line.size();
+    m_written++;
+}
+
+void ConsoleLogBuffer::Rotate()
+{
+    m_file.close();
+    std::error_code error;
+    if (m_options.maxFiles > 1)
+    {
+        std::filesystem::remove(GetRotatedPath(m_options.path, m_options.maxFiles - 1), error);
+        for (size_t i = m_options.maxFiles - 1; i > 1; i--)
+        {
+            std::filesystem::rename(
+                GetRotatedPath(m_options.path, i - 1), GetRotatedPath(m_options.path, i),
+                error);
+        }
+        std::filesystem::rename(m_options.path, GetRotatedPath(m_options.path, 1), error);
+    }
+    m_file.open(m_options.path, std::ios::binary | std::ios::trunc);
+    m_fileBytes = 0;
+}
+
+ConsoleLogBuffer::Counters ConsoleLogBuffer::GetCounters() const
+{
+    Counters counters;
+    counters.pushed = m_head.load(std::memory_order_relaxed);
+    counters.written = m_written.load(std::memory_order_relaxed);
+    counters.dropped = m_dropped.load(std::memory_order_relaxed);
+    return counters;
+}
+
+ConsoleLogBuffer::Level ConsoleLogBuffer::ParseLevel(std::string_view type)
+{
+    if (type == "error" || type == "assert")
+    {
+        return Level::Error;
+    }
+    if (type == "warning")
+    {
+        return Level::Warning;
+    }
+    if (type == "info")
+    {
+        return Level::Info;
+    }
+    if (type == "debug" || type == "trace")
+    {
+        return Level::Debug;
+    }
+    return Level::Log;
+}
+
+const char* ConsoleLogBuffer::GetLevelName(Level level)
+{
+    switch (level)
+    {
+    case Level::Debug:
+        return "DEBUG";
+    case Level::Info:
+        return "INFO";
+    case Level::Warning:
+        return "WARNING";
+    case Level::Error:
+        return "ERROR";
+    default:
+        return "LOG";
+    }
+}
+
+std::string_view ConsoleLogBuffer::FindJsonValue(std::string_view json, std::string_view key)
+{
+    // Finds the key without building a quoted copy of it, so that pushing does
+    // not allocate.
+    size_t position = 0;
+    while (true)
+    {
+        position = json.find(key, position);
+        if (position == std::string_view::npos)
+        {
+            return {};
+        }
+        if (position > 0 && json[position - 1] == '"' &&
+            position + key.size() < json.size() && json[position + key.size()] == '"')
+        {
+            break;
+        }
+        position++;
+    }
+    position = json.find_first_not_of(" \t\r\n", position + key.size() + 1);
+    if (position == std::string_view::npos || json[position] != ':')
+    {
+        return {};
+    }
+    size_t start = json.find_first_not_of(" \t\r\n", position + 1);
+    if (start == std::string_view::npos)
+    {
+        return {};
+    }
+    // Scan to the end of the value, skipping over strings so that brackets
+    // and commas inside them do not count.
+    int depth = 0;
+    bool inString = false;
+    for (size_t i = start; i < json.size(); i++)
+    {
+        char c = json[i];
+        if (inString)
+        {
+            if (c == '\\')
+            {
+                i++;
+            }
+            else if (c == '"')
+            {
+                inString = false;
+                if (depth == 0)
+                {
+                    return json.substr(start, i + 1 - start);
+                }
+            }
+            continue;
+        }
+        if (c == '"')
+        {
+            inString = true;
+        }
+        else if (c == '[' || c == '{')
+        {
+            depth++;
+        }
+        else if (c == ']' || c == '}')
+        {
+            if (depth == 0)
+            {
+                return json.substr(start, i - start);
+            }
+            if (--depth == 0)
+            {
+                return json.substr(start, i + 1 - start);
+            }
+        }
+        else if (depth == 0 && c == ',')
+        {
+            return json.substr(start, i - start);
+        }
+    }
+    return json.substr(start);
+}
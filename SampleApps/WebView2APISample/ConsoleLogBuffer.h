@@ -0,0 +1,173 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ConsoleLogBuffer keeps the latest c_capacity console messages of web pages
+// in a fixed ring of slots, and a background thread appends them to a log file
+// that is rotated by size.
+//
+// Pushing is lock-free and does not allocate: a writer claims the next slot
+// with an atomic increment and publishes it with a sequence number, so
+// chatty pages only cost a copy per message. Readers, the drain thread and
+// Query, check the sequence number before and after copying a slot and skip
+// it if a writer got there meanwhile. When writers get more than c_capacity
+// messages ahead of the drain thread, the oldest ones are counted as dropped.
+//
+// A writer that is preempted long enough to be lapped leaves its slot with an
+// older sequence number. The drain thread waits up to one drain interval for
+// an incomplete slot, then counts it as dropped and moves on.
+//
+// Targets, such as the DevTools sessions messages come from, are interned
+// into small integers so that records stay fixed-size. They are reference
+// counted, and the integer of a released target is reused once the ring has
+// wrapped past its last message, so the table only grows with the targets in
+// use. Strings are UTF-8. Has no dependency on Win32.
+class ConsoleLogBuffer
+{
+public:
+    static constexpr size_t c_capacity = 4096;
+    // Longer arguments are truncated.
+    static constexpr size_t c_maxArgsBytes = 480;
+
+    // In the order of severity, as named by Runtime.consoleAPICalled.
+    enum class Level : uint8_t
+    {
+        Debug,
+        Log,
+        Info,
+        Warning,
+        Error,
+    };
+
+    struct Record
+    {
+        uint64_t sequence = 0;
+        // Microseconds since the Unix epoch.
+        int64_t timeMicros = 0;
+        uint32_t target = 0;
+        Level level = Level::Log;
+        bool truncated = false;
+        // The JSON array of the console call's arguments.
+        std::string args;
+    };
+
+    struct Options
+    {
+        // No file is written if empty.
+        std::filesystem::path path;
+        uint64_t maxFileBytes = 4 * 1024 * 1024;
+        // Including the current file: path, path.1, ... path.(maxFiles - 1).
+        size_t maxFiles = 3;
+        std::chrono::milliseconds drainInterval{250};
+    };
+
+    struct Counters
+    {
+        uint64_t pushed = 0;
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+    };
+
+    static constexpr uint32_t c_anyTarget = UINT32_MAX;
+
+    explicit ConsoleLogBuffer(const Options& options);
+    ~ConsoleLogBuffer();
+
+    // Returns the integer of `name`, and adds a reference to it that
+    // ReleaseTarget removes. Messages can't be pushed for a released target.
+    uint32_t InternTarget(const std::string& name);
+    void ReleaseTarget(uint32_t target);
+    std::string GetTargetName(uint32_t target) const;
+
+    void Push(int64_t timeMicros, uint32_t target, Level level, std::string_view args);
+    // Pushes the parameters of a Runtime.consoleAPICalled event.
+    void PushConsoleApiCalled(int64_t timeMicros, uint32_t target, std::string_view json);
+
+    // Returns up to `maxCount` of the buffered records of `target`, or of all
+    // targets for c_anyTarget, at `minLevel` or above, newest first.
+    std::vector<Record> Query(uint32_t target, Level minLevel, size_t maxCount) const;
+    // Writes the records not written yet, without waiting for the drain thread.
+    void Flush();
+    Counters GetCounters() const;
+
+    static Level ParseLevel(std::string_view type);
+    static const char* GetLevelName(Level level);
+    // Returns the value of the first "key" in `json`, or an empty view.
+    static std::string_view FindJsonValue(std::string_view json, std::string_view key);
+
+private:
+    struct Slot
+    {
+        // 2 * index + 1 while the record at `index` is written, 2 * index + 2
+        // once it is complete.
+        std::atomic<uint64_t> sequence{0};
+        int64_t timeMicros;
+        uint32_t target;
+        Level level;
+        bool truncated;
+        uint16_t length;
+        char args[c_maxArgsBytes];
+    };
+
+    // Returns false if the record at `index` is not complete or was
+    // overwritten; sets `overwritten` in the latter case.
+    bool ReadSlot(uint64_t index, Record* record, bool* overwritten = nullptr) const;
+    void DrainLoop();
+    void Drain();
+    void WriteLine(const Record& record, const std::vector<std::string>& targets);
+    void Rotate();
+
+    Options m_options;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_head{0};
+
+    struct Target
+    {
+        std::string name;
+        size_t references = 0;
+        // The head when the last reference was released.
+        uint64_t releasedAt = 0;
+    };
+
+    mutable std::mutex m_targetMutex;
+    std::vector<Target> m_targets;
+    std::unordered_map<std::string, uint32_t> m_targetIds;
+    // Released targets with the head they were released at, oldest first.
+    // Entries whose target was interned again meanwhile are skipped.
+    std::deque<std::pair<uint32_t, uint64_t>> m_releasedTargets;
+
+    // Guards the file and the drain position.
+    std::mutex m_drainMutex;
+    uint64_t m_drainPosition = 0;
+    // The incomplete slot the drain stopped at, and since when.
+    uint64_t m_stalledPosition = UINT64_MAX;
+    std::chrono::steady_clock::time_point m_stalledSince;
+    std::ofstream m_file;
+    uint64_t m_fileBytes = 0;
+    std::atomic<uint64_t> m_written{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stop = false;
+    std::thread m_drainThread;
+};
@@ -9,7 +9,7 @@
 
 #include "App.h"
 #include "CheckFailure.h"
-#include <regex>
+#include "HistoryAutoComplete.h"
 #include <shlwapi.h>
 
 using namespace Microsoft::WRL;
@@ -21,6 +21,13 @@ ControlComponent::ControlComponent(AppWindow* appWindow, Toolbar* toolbar)
     m_toolbar->SetItemEnabled(Toolbar::Item_AddressBar, true);
     m_toolbar->SetItemEnabled(Toolbar::Item_GoButton, true);
 
+    // Suggest previously visited pages while the user types in the address bar.
+    m_historyAutoComplete = HistoryAutoComplete::GetForAddressBar(GetAddressBar());
+    if (m_historyAutoComplete)
+    {
+        m_historyAutoComplete->SetEnabled(true);
+    }
+
     // Register a handler for the NavigationStarting event.
     // This handler just enables the Cancel button.
     CHECK_FAILURE(m_webView->add_NavigationStarting(
@@ -95,6 +102,17 @@ ControlComponent::ControlComponent(AppWindow* appWindow, Toolbar* toolbar)
                         // display its own error page automatically.
                     }
                 }
+                else
+                {
+                    // Feed the address bar suggestions.
+                    wil::unique_cotaskmem_string uri;
+                    wil::unique_cotaskmem_string title;
+                    CHECK_FAILURE(sender->get_Source(&uri));
+                    CHECK_FAILURE(sender->get_DocumentTitle(&title));
+                    HistoryAutoComplete::RecordVisit(
+                        uri.get(), title.get(), m_typedUri == uri.get());
+                }
+                m_typedUri.clear();
                 m_toolbar->SetItemEnabled(Toolbar::Item_CancelButton, false);
                 m_toolbar->SetItemEnabled(Toolbar::Item_ReloadButton, true);
                 return S_OK;
@@ -186,8 +204,11 @@ ControlComponent::ControlComponent(AppWindow* appWindow, Toolbar* toolbar)
                 {
                     UINT key;
                     CHECK_FAILURE(args->get_VirtualKey(&key));
+                    COREWEBVIEW2_PHYSICAL_KEY_STATUS status;
+                    CHECK_FAILURE(args->get_PhysicalKeyStatus(&status));
                     // Check if the key is one we want to handle.
-                    std::function<void()> action = m_appWindow->GetAcceleratorKeyFunction(key);
+                    std::function<void()> action =
+                        m_appWindow->GetAcceleratorKeyFunction(key, status.WasKeyDown);
                     if (action)
                     {
                         // Keep the browser from handling this key, whether it's autorepeated or
@@ -195,8 +216,6 @@ ControlComponent::ControlComponent(AppWindow* appWindow, Toolbar* toolbar)
                         CHECK_FAILURE(args->put_Handled(TRUE));
 
                         // Filter out autorepeated keys.
-                        COREWEBVIEW2_PHYSICAL_KEY_STATUS status;
-                        CHECK_FAILURE(args->get_PhysicalKeyStatus(&status));
                         if (!status.WasKeyDown)
                         {
                             // Perform the action asynchronously to avoid blocking the
@@ -237,6 +256,12 @@ bool ControlComponent::HandleWindowMessage(
                 .c_str(),
                 L"", MB_OK);
             return true;
+        case IDE_ADDRESSBAR:
+            if (HIWORD(wParam) == EN_CHANGE && m_historyAutoComplete)
+            {
+                m_historyAutoComplete->OnTextChanged();
+            }
+            return true;
         case IDE_ADDRESSBAR_GO:
             if (HIWORD(wParam) == BN_CLICKED)
             {
@@ -323,14 +348,15 @@ bool ControlComponent::HandleChildWindowMessage(
         else
         {
             // If bit 30 is set, it means the WM_KEYDOWN message is autorepeated.
-            // We want to ignore it in that case.
-            if (!(lParam & (1 << 30)))
+            // The action only runs for the first one.
+            bool isRepeat = (lParam & 0x40000000) != 0;
+            if (auto action = m_appWindow->GetAcceleratorKeyFunction((UINT)wParam, isRepeat))
             {
-                if (auto action = m_appWindow->GetAcceleratorKeyFunction((UINT)wParam))
+                if (!isRepeat)
                 {
                     action();
-                    return true;
                 }
+                return true;
             }
         }
     }
@@ -350,6 +376,76 @@ bool ControlComponent::HandleChildWindowMessage(
     return false;
 }
 
+// Percent-encodes `query` as UTF-8 for a search URL in a single pass. Runs of
+// spaces become a single '+'.
+static std::wstring EncodeSearchQuery(const std::wstring& query)
+{
+    static constexpr wchar_t c_hex[] = L"0123456789ABCDEF";
+    std::wstring encoded;
+    encoded.reserve(query.size() * 3);
+    for (size_t i = 0; i < query.size(); i++)
+    {
+        wchar_t c = query[i];
+        if ((c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z') || (c >= L'0' && c <= L'9') ||
+            c == L'-' || c == L'.' || c == L'_' || c == L'~')
+        {
+            encoded.push_back(c);
+            continue;
+        }
+        if (c == L' ')
+        {
+            // A literal '+' is encoded, so this only merges spaces.
+            if (encoded.empty() || encoded.back() != L'+')
+            {
+                encoded.push_back(L'+');
+            }
+            continue;
+        }
+
+        uint32_t codePoint = c;
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < query.size() && query[i + 1] >= 0xDC00 &&
+            query[i + 1] <= 0xDFFF)
+        {
+            codePoint = 0x10000 + ((c - 0xD800) << 10) + (query[++i] - 0xDC00);
+        }
+        else if (c >= 0xD800 && c <= 0xDFFF)
+        {
+            codePoint = 0xFFFD;
+        }
+        uint8_t utf8[4];
+        size_t length = 0;
+        if (codePoint < 0x80)
+        {
+            utf8[length++] = static_cast<uint8_t>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            utf8[length++] = static_cast<uint8_t>(0xC0 | codePoint >> 6);
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            utf8[length++] = static_cast<uint8_t>(0xE0 | codePoint >> 12);
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint >> 6 & 0x3F));
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            utf8[length++] = static_cast<uint8_t>(0xF0 | codePoint >> 18);
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint >> 12 & 0x3F));
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint >> 6 & 0x3F));
+            utf8[length++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+        }
+        for (size_t b = 0; b < length; b++)
+        {
+            encoded.push_back(L'%');
+            encoded.push_back(c_hex[utf8[b] >> 4]);
+            encoded.push_back(c_hex[utf8[b] & 0xF]);
+        }
+    }
+    return encoded;
+}
+
 //! [Navigate]
 void ControlComponent::NavigateToAddressBar()
 {
@@ -358,6 +454,7 @@ void ControlComponent::NavigateToAddressBar()
     PWSTR buffer = const_cast<PWSTR>(uri.data());
     GetWindowText(GetAddressBar(), buffer, length + 1);
 
+    m_typedUri = uri;
     HRESULT hr = m_webView->Navigate(uri.c_str());
     if (hr == E_INVALIDARG)
     {
@@ -366,19 +463,14 @@ void ControlComponent::NavigateToAddressBar()
             && uri.find(L'.') != std::wstring::npos)
         {
             // If it contains a dot and no spaces, try tacking http:// on the front.
-            hr = m_webView->Navigate((L"http://" + uri).c_str());
+            m_typedUri = L"http://" + uri;
         }
         else
         {
             // Otherwise treat it as a web search.
-            std::wstring urlEscaped(2048, ' ');
-            DWORD dwEscaped = (DWORD)urlEscaped.length();
-            UrlEscapeW(uri.c_str(), &urlEscaped[0], &dwEscaped, URL_ESCAPE_ASCII_URI_COMPONENT);
-            hr = m_webView->Navigate(
-                (L"https://bing.com/search?q=" +
-                 std::regex_replace(urlEscaped, std::wregex(L"(?:%20)+"), L"+"))
-                    .c_str());
+            m_typedUri = L"https://bing.com/search?q=" + EncodeSearchQuery(uri);
         }
+        hr = m_webView->Navigate(m_typedUri.c_str());
     }
     if (hr != E_INVALIDARG) {
         CHECK_FAILURE(hr);
@@ -436,6 +528,12 @@ ControlComponent::~ControlComponent()
         SetWindowLongPtr(pair.first, GWLP_WNDPROC, (LONG_PTR)pair.second);
     }
 
+    if (m_historyAutoComplete)
+    {
+        m_historyAutoComplete->SetEnabled(false);
+    }
+    HistoryAutoComplete::SaveHistory();
+
     SetWindowText(GetAddressBar(), L"");
     m_toolbar->DisableAllItems();
 }
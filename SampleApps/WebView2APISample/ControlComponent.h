@@ -6,11 +6,14 @@
 
 #include "stdafx.h"
 
+#include <string>
 #include <vector>
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
 
+class HistoryAutoComplete;
+
 // This component handles commands from the buttons and address bar, as well as keyboard
 // input, tabbing, focus changing, and related events.
 class ControlComponent : public ComponentBase
@@ -41,6 +44,9 @@ private:
     wil::com_ptr<ICoreWebView2> m_webView;
     Toolbar* m_toolbar;
     std::vector<std::pair<HWND, WNDPROC>> m_tabbableWindows;
+    HistoryAutoComplete* m_historyAutoComplete = nullptr;
+    // The URI last navigated to from the address bar, until it completes.
+    std::wstring m_typedUri;
 
     EventRegistrationToken m_navigationStartingToken = {};
     EventRegistrationToken m_sourceChangedToken = {};
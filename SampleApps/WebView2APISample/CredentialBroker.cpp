@@ -0,0 +1,253 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CredentialBroker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <initializer_list>
+
+namespace
+{
+constexpr char c_separator = '\t';
+constexpr std::string_view c_anyRealm = "*";
+
+bool IsValidField(std::string_view field)
+{
+    return !field.empty() && field.find_first_of("\t\r\n") == std::string_view::npos;
+}
+
+void AppendLowerCase(std::string* text, std::string_view value)
+{
+    for (char c : value)
+    {
+        text->push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+    }
+}
+} // namespace
+
+size_t CredentialBroker::Load(std::istream& store)
+{
+    size_t count = 0;
+    std::string line;
+    while (std::getline(store, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::string_view fields[4];
+        std::string_view rest = line;
+        size_t i = 0;
+        for (; i < 3; i++)
+        {
+            size_t end = rest.find(c_separator);
+            if (end == std::string_view::npos)
+            {
+                break;
+            }
+            fields[i] = rest.substr(0, end);
+            rest.remove_prefix(end + 1);
+        }
+        fields[3] = rest;
+        if (i == 3 &&
+            Add(fields[0], fields[1], {std::string(fields[2]), std::string(fields[3])}))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::string CredentialBroker::Save() const
+{
+    std::string store;
+    for (const auto& entry : m_credentials)
+    {
+        // The key is already "host\trealm".
+        store += entry.first;
+        store += c_separator;
+        store += entry.second.userName;
+        store += c_separator;
+        store += entry.second.password;
+        store += '\n';
+    }
+    return store;
+}
+
+bool CredentialBroker::Add(std::string_view host, std::string_view realm, Credential credential)
+{
+    if (!IsValidField(host) || !IsValidField(realm) || !IsValidField(credential.userName) ||
+        !IsValidField(credential.password))
+    {
+        return false;
+    }
+    std::string key;
+    AppendLowerCase(&key, host);
+    key += c_separator;
+    key += realm;
+    m_credentials[std::move(key)] = std::move(credential);
+    m_answers.clear();
+    return true;
+}
+
+std::string CredentialBroker::GetHost(std::string_view uri)
+{
+    size_t scheme = uri.find("://");
+    if (scheme == std::string_view::npos || scheme == 0)
+    {
+        return std::string();
+    }
+    uri.remove_prefix(scheme + 3);
+    std::string_view authority = uri.substr(0, uri.find_first_of("/?#"));
+    // Drop any user info.
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos)
+    {
+        authority.remove_prefix(at + 1);
+    }
+    std::string host;
+    AppendLowerCase(&host, authority);
+    return host;
+}
+
+std::string CredentialBroker::GetRealm(std::string_view challenge)
+{
+    constexpr std::string_view c_realm = "realm=";
+    auto match = std::search(
+        challenge.begin(), challenge.end(), c_realm.begin(), c_realm.end(),
+        [](char a, char b)
+        { return tolower(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b); });
+    if (match == challenge.end())
+    {
+        return std::string();
+    }
+    challenge.remove_prefix(match - challenge.begin() + c_realm.size());
+    if (challenge.empty() || challenge[0] != '"')
+    {
+        return std::string(challenge.substr(0, challenge.find_first_of(", \t")));
+    }
+    std::string realm;
+    for (size_t i = 1; i < challenge.size() && challenge[i] != '"'; i++)
+    {
+        if (challenge[i] == '\\' && i + 1 < challenge.size())
+        {
+            i++;
+        }
+        realm.push_back(challenge[i]);
+    }
+    return realm;
+}
+
+CredentialBroker::Answer CredentialBroker::Resolve(
+    std::string_view host, std::string_view realm, int64_t nowMs)
+{
+    const Credential* credential = nullptr;
+    auto cached = m_answers.find(MakeKey(host, realm));
+    if (cached != m_answers.end())
+    {
+        m_cacheHits++;
+        credential = cached->second;
+    }
+    else
+    {
+        m_cacheMisses++;
+        credential = Find(host, realm);
+        if (m_answers.size() >= c_maxCachedAnswers)
+        {
+            m_answers.clear();
+        }
+        m_answers.emplace(MakeKey(host, realm), credential);
+    }
+    if (!credential)
+    {
+        return Answer();
+    }
+
+    auto attempts = m_attempts.find(m_key);
+    if (attempts == m_attempts.end())
+    {
+        attempts = m_attempts.emplace(m_key, Attempts()).first;
+    }
+    else if (nowMs - attempts->second.firstMs > c_retryWindowMs)
+    {
+        attempts->second = Attempts();
+    }
+    if (attempts->second.count >= c_maxAttempts)
+    {
+        return {Outcome::RetryLimit, nullptr};
+    }
+    if (attempts->second.count++ == 0)
+    {
+        attempts->second.firstMs = nowMs;
+    }
+    return {Outcome::Supply, credential};
+}
+
+bool CredentialBroker::IsAwaitingResponse(std::string_view host) const
+{
+    std::string prefix(host);
+    prefix += c_separator;
+    auto attempts = m_attempts.lower_bound(prefix);
+    return attempts != m_attempts.end() &&
+           attempts->first.compare(0, prefix.size(), prefix) == 0;
+}
+
+void CredentialBroker::RecordResponse(std::string_view host, int statusCode)
+{
+    if (statusCode == 401)
+    {
+        return;
+    }
+    std::string prefix(host);
+    prefix += c_separator;
+    auto begin = m_attempts.lower_bound(prefix);
+    auto end = begin;
+    while (end != m_attempts.end() && end->first.compare(0, prefix.size(), prefix) == 0)
+    {
+        ++end;
+    }
+    m_attempts.erase(begin, end);
+}
+
+const std::string& CredentialBroker::MakeKey(std::string_view host, std::string_view realm)
+{
+    m_key.assign(host);
+    m_key += c_separator;
+    m_key += realm;
+    return m_key;
+}
+
+const CredentialBroker::Credential* CredentialBroker::Find(
+    std::string_view host, std::string_view realm)
+{
+    std::string_view domain = host;
+    bool wildcard = false;
+    while (true)
+    {
+        for (std::string_view candidate : {realm, c_anyRealm})
+        {
+            m_key.assign(wildcard ? "*." : "");
+            m_key += domain;
+            m_key += c_separator;
+            m_key += candidate;
+            auto credential = m_credentials.find(m_key);
+            if (credential != m_credentials.end())
+            {
+                return &credential->second;
+            }
+        }
+        size_t dot = domain.find('.');
+        if (dot == std::string_view::npos)
+        {
+            return nullptr;
+        }
+        domain.remove_prefix(dot + 1);
+        wildcard = true;
+    }
+}
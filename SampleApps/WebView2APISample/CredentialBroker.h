@@ -0,0 +1,122 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// CredentialBroker answers the BasicAuthenticationRequested events of the
+// Authentication scenario from a store of credentials.
+//
+// Credentials are indexed by host and realm in a hash table. A host of
+// "*.example.com" covers the subdomains of example.com, and a realm of "*"
+// covers every realm of the host. Resolve looks for the exact host and realm
+// first, then for any realm of the host, then for the wildcard hosts of each
+// parent domain in turn. The answer, including that there is no credential,
+// is cached by host and realm, so that further requests take one lookup. The
+// cache is started over when it reaches c_maxCachedAnswers or the store
+// changes.
+//
+// Resolve also detects retry loops: a server that rejects the credentials
+// requests them again, so once credentials have been supplied c_maxAttempts
+// times for a host and realm within c_retryWindowMs, with no accepted
+// response in between, the answer is RetryLimit and the host should cancel
+// the request rather than supply them again.
+//
+// The store's text format is one "host\trealm\tuser name\tpassword" line per
+// credential. The host encrypts it at rest and loads it once. Times are in
+// milliseconds on any monotonic clock. Not thread-safe. Has no dependency on
+// Win32.
+class CredentialBroker
+{
+public:
+    struct Credential
+    {
+        std::string userName;
+        std::string password;
+    };
+
+    enum class Outcome
+    {
+        Supply,
+        NoCredential,
+        RetryLimit,
+    };
+
+    struct Answer
+    {
+        Outcome outcome = Outcome::NoCredential;
+        // Set for Supply. Valid until the store changes.
+        const Credential* credential = nullptr;
+    };
+
+    static constexpr size_t c_maxCachedAnswers = 4096;
+    static constexpr uint32_t c_maxAttempts = 2;
+    static constexpr int64_t c_retryWindowMs = 30 * 1000;
+
+    // Returns the number of credentials added. Malformed lines and lines
+    // starting with '#' are skipped.
+    size_t Load(std::istream& store);
+    std::string Save() const;
+    // Returns false if a field is empty or contains a tab or line break.
+    bool Add(std::string_view host, std::string_view realm, Credential credential);
+    size_t GetCount() const
+    {
+        return m_credentials.size();
+    }
+
+    // Returns "host[:port]" in lower case, or an empty string.
+    static std::string GetHost(std::string_view uri);
+    // Returns the realm of a "Basic realm=..." challenge, or an empty string.
+    static std::string GetRealm(std::string_view challenge);
+
+    // `host` is as returned by GetHost.
+    Answer Resolve(std::string_view host, std::string_view realm, int64_t nowMs);
+    // Whether credentials were supplied for the host and no response has
+    // been recorded since, so that its responses are worth looking at.
+    bool IsAwaitingResponse(std::string_view host) const;
+    bool IsAwaitingAnyResponse() const
+    {
+        return !m_attempts.empty();
+    }
+    // Any status but 401 means the server accepted the credentials, which
+    // ends the attempts for the host.
+    void RecordResponse(std::string_view host, int statusCode);
+
+    uint64_t GetCacheHits() const
+    {
+        return m_cacheHits;
+    }
+    uint64_t GetCacheMisses() const
+    {
+        return m_cacheMisses;
+    }
+
+private:
+    struct Attempts
+    {
+        uint32_t count = 0;
+        int64_t firstMs = 0;
+    };
+
+    // Builds the key of `host` and `realm` in m_key.
+    const std::string& MakeKey(std::string_view host, std::string_view realm);
+    const Credential* Find(std::string_view host, std::string_view realm);
+
+    std::unordered_map<std::string, Credential> m_credentials;
+    // Null for hosts and realms without a credential.
+    std::unordered_map<std::string, const Credential*> m_answers;
+    // By host and realm, so that the attempts of a host are adjacent.
+    std::map<std::string, Attempts, std::less<>> m_attempts;
+    // Reused to avoid allocating a key for each lookup.
+    std::string m_key;
+    uint64_t m_cacheHits = 0;
+    uint64_t m_cacheMisses = 0;
+};
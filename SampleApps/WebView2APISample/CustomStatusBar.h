@@ -16,6 +16,10 @@ public:
     void Initialize(AppWindow* appWindow);
     void Show(std::wstring value);
     void Hide();
+    HWND GetWindow()
+    {
+        return m_statusBarWindow;
+    }
 
 private:
     AppWindow* m_appWindow = nullptr;
@@ -0,0 +1,267 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DownloadTracker.h"
+
+#include <algorithm>
+
+namespace
+{
+// Bytes still to come for a download that knows its size.
+int64_t Remaining(const DownloadTracker::Download& download)
+{
+    if (download.totalBytes < 0)
+    {
+        return 0;
+    }
+    return (std::max)(int64_t(0), download.totalBytes - download.bytesReceived);
+}
+} // namespace
+
+DownloadTracker::DownloadTracker() : DownloadTracker(Options())
+{
+}
+
+DownloadTracker::DownloadTracker(const Options& options) : m_options(options)
+{
+}
+
+bool DownloadTracker::Add(uint64_t id, int64_t totalBytes, uint64_t nowMs)
+{
+    if (m_index.count(id))
+    {
+        return FindMutable(id)->state == State::Active;
+    }
+    Download download;
+    download.id = id;
+    download.totalBytes = totalBytes;
+    download.lastSampleMs = nowMs;
+    m_index[id] = m_downloads.size();
+    m_downloads.push_back(download);
+    m_stateCounts[static_cast<size_t>(State::Queued)]++;
+    m_bytesRemaining += Remaining(download);
+
+    Download& added = m_downloads.back();
+    if (m_stateCounts[static_cast<size_t>(State::Active)] < m_options.maxConcurrent)
+    {
+        SetState(added, State::Active);
+        return true;
+    }
+    m_queue.push_back(id);
+    return false;
+}
+
+void DownloadTracker::UpdateBytes(uint64_t id, int64_t bytesReceived, uint64_t nowMs)
+{
+    Download* download = FindMutable(id);
+    if (!download)
+    {
+        return;
+    }
+    m_bytesRemaining -= Remaining(*download);
+    m_bytesReceived += bytesReceived - download->bytesReceived;
+    download->bytesReceived = bytesReceived;
+    m_bytesRemaining += Remaining(*download);
+
+    // Progress events for several chunks can arrive within the same clock
+    // tick; fold them into the next sample rather than dividing by zero.
+    if (download->state != State::Active || nowMs <= download->lastSampleMs)
+    {
+        return;
+    }
+    double seconds = (nowMs - download->lastSampleMs) / 1000.0;
+    double instant = (bytesReceived - download->lastSampleBytes) / seconds;
+    double alpha = m_options.smoothingFactor;
+    double smoothed = download->bytesPerSecond == 0
+                          ? instant
+                          : alpha * instant + (1 - alpha) * download->bytesPerSecond;
+    SetRate(*download, (std::max)(0.0, smoothed));
+    download->lastSampleMs = nowMs;
+    download->lastSampleBytes = bytesReceived;
+}
+
+void DownloadTracker::Finish(
+    uint64_t id, bool completed, uint64_t nowMs, std::vector<uint64_t>* toResume)
+{
+    if (!m_index.count(id))
+    {
+        return;
+    }
+    (completed ? m_completedCount : m_interruptedCount)++;
+    // Finished downloads aren't kept, so the table only grows with the
+    // downloads in flight.
+    Remove(id, toResume, nowMs);
+}
+
+void DownloadTracker::Pause(uint64_t id, std::vector<uint64_t>* toResume)
+{
+    Download* download = FindMutable(id);
+    if (!download || download->state == State::Paused)
+    {
+        return;
+    }
+    if (download->state == State::Queued)
+    {
+        m_queue.erase(std::find(m_queue.begin(), m_queue.end(), id));
+    }
+    SetState(*download, State::Paused);
+    PromoteQueued(download->lastSampleMs, toResume);
+}
+
+bool DownloadTracker::Resume(uint64_t id, uint64_t nowMs)
+{
+    Download* download = FindMutable(id);
+    if (!download)
+    {
+        return false;
+    }
+    if (download->state != State::Paused)
+    {
+        return download->state == State::Active;
+    }
+    if (m_stateCounts[static_cast<size_t>(State::Active)] < m_options.maxConcurrent)
+    {
+        Restart(*download, nowMs);
+        return true;
+    }
+    SetState(*download, State::Queued);
+    m_queue.push_back(id);
+    return false;
+}
+
+void DownloadTracker::Remove(uint64_t id, std::vector<uint64_t>* toResume)
+{
+    auto it = m_index.find(id);
+    if (it != m_index.end())
+    {
+        Remove(id, toResume, m_downloads[it->second].lastSampleMs);
+    }
+}
+
+void DownloadTracker::Remove(uint64_t id, std::vector<uint64_t>* toResume, uint64_t nowMs)
+{
+    auto it = m_index.find(id);
+    if (it == m_index.end())
+    {
+        return;
+    }
+    size_t slot = it->second;
+    Download& download = m_downloads[slot];
+    bool freedSlot = download.state == State::Active;
+    if (download.state == State::Queued)
+    {
+        m_queue.erase(std::find(m_queue.begin(), m_queue.end(), id));
+    }
+    SetRate(download, 0);
+    m_bytesRemaining -= Remaining(download);
+    m_bytesReceived -= download.bytesReceived;
+    m_stateCounts[static_cast<size_t>(download.state)]--;
+
+    // Swap with the last row to keep the table dense.
+    if (slot != m_downloads.size() - 1)
+    {
+        m_downloads[slot] = m_downloads.back();
+        m_index[m_downloads[slot].id] = slot;
+    }
+    m_downloads.pop_back();
+    m_index.erase(id);
+
+    if (freedSlot)
+    {
+        PromoteQueued(nowMs, toResume);
+    }
+}
+
+bool DownloadTracker::ShouldPublish(uint64_t nowMs)
+{
+    if (m_published && nowMs - m_lastPublishMs < m_options.publishIntervalMs)
+    {
+        return false;
+    }
+    m_published = true;
+    m_lastPublishMs = nowMs;
+    return true;
+}
+
+const DownloadTracker::Download* DownloadTracker::Find(uint64_t id) const
+{
+    auto it = m_index.find(id);
+    return it == m_index.end() ? nullptr : &m_downloads[it->second];
+}
+
+double DownloadTracker::GetEtaSeconds(uint64_t id) const
+{
+    const Download* download = Find(id);
+    if (!download || download->totalBytes < 0 || download->bytesPerSecond <= 0)
+    {
+        return -1;
+    }
+    return Remaining(*download) / download->bytesPerSecond;
+}
+
+DownloadTracker::Summary DownloadTracker::GetSummary() const
+{
+    Summary summary;
+    summary.active = m_stateCounts[static_cast<size_t>(State::Active)];
+    summary.queued = m_stateCounts[static_cast<size_t>(State::Queued)];
+    summary.paused = m_stateCounts[static_cast<size_t>(State::Paused)];
+    summary.completed = m_completedCount;
+    summary.interrupted = m_interruptedCount;
+    summary.bytesReceived = m_bytesReceived;
+    summary.bytesRemaining = m_bytesRemaining;
+    summary.bytesPerSecond = (std::max)(0.0, m_bytesPerSecond);
+    if (summary.bytesPerSecond > 0)
+    {
+        summary.etaSeconds = m_bytesRemaining / summary.bytesPerSecond;
+    }
+    return summary;
+}
+
+DownloadTracker::Download* DownloadTracker::FindMutable(uint64_t id)
+{
+    auto it = m_index.find(id);
+    return it == m_index.end() ? nullptr : &m_downloads[it->second];
+}
+
+void DownloadTracker::SetState(Download& download, State state)
+{
+    if (state != State::Active)
+    {
+        SetRate(download, 0);
+    }
+    m_bytesRemaining -= Remaining(download);
+    m_stateCounts[static_cast<size_t>(download.state)]--;
+    download.state = state;
+    m_stateCounts[static_cast<size_t>(download.state)]++;
+    m_bytesRemaining += Remaining(download);
+}
+
+void DownloadTracker::SetRate(Download& download, double bytesPerSecond)
+{
+    m_bytesPerSecond += bytesPerSecond - download.bytesPerSecond;
+    download.bytesPerSecond = bytesPerSecond;
+}
+
+void DownloadTracker::PromoteQueued(uint64_t nowMs, std::vector<uint64_t>* toResume)
+{
+    while (!m_queue.empty() &&
+           m_stateCounts[static_cast<size_t>(State::Active)] < m_options.maxConcurrent)
+    {
+        uint64_t id = m_queue.front();
+        m_queue.pop_front();
+        Restart(*FindMutable(id), nowMs);
+        if (toResume)
+        {
+            toResume->push_back(id);
+        }
+    }
+}
+
+void DownloadTracker::Restart(Download& download, uint64_t nowMs)
+{
+    // Time spent waiting mustn't count against the throughput.
+    SetState(download, State::Active);
+    download.lastSampleMs = nowMs;
+    download.lastSampleBytes = download.bytesReceived;
+}
@@ -0,0 +1,133 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// DownloadTracker keeps the progress of many concurrent downloads in a flat
+// table and turns raw byte counts into smoothed throughput and ETA figures. It
+// also decides which downloads may run, so that no more than a fixed number of
+// downloads are active at once; the rest wait in a FIFO queue.
+//
+// It has no dependency on WebView2 or Win32. Times are passed in by the caller
+// in milliseconds, so it can be driven by a simulated clock.
+class DownloadTracker
+{
+public:
+    struct Options
+    {
+        // Downloads allowed to transfer at the same time.
+        size_t maxConcurrent = 3;
+        // Weight of the newest throughput sample in the moving average.
+        double smoothingFactor = 0.3;
+        // Minimum time between two UI updates.
+        uint64_t publishIntervalMs = 250;
+    };
+
+    enum class State
+    {
+        // Waiting for a free slot.
+        Queued,
+        Active,
+        // Paused by the user. Doesn't hold a slot.
+        Paused,
+    };
+
+    struct Download
+    {
+        uint64_t id = 0;
+        State state = State::Queued;
+        int64_t bytesReceived = 0;
+        // Negative if the server didn't report a size.
+        int64_t totalBytes = -1;
+        double bytesPerSecond = 0;
+        uint64_t lastSampleMs = 0;
+        int64_t lastSampleBytes = 0;
+    };
+
+    struct Summary
+    {
+        size_t active = 0;
+        size_t queued = 0;
+        size_t paused = 0;
+        // Every download that has finished, though the tracker no longer
+        // keeps them.
+        size_t completed = 0;
+        size_t interrupted = 0;
+        // Only counts downloads that haven't finished.
+        int64_t bytesReceived = 0;
+        // Only counts downloads whose size is known.
+        int64_t bytesRemaining = 0;
+        double bytesPerSecond = 0;
+        // Negative if it can't be estimated.
+        double etaSeconds = -1;
+    };
+
+    DownloadTracker();
+    explicit DownloadTracker(const Options& options);
+
+    // Starts tracking a download. Returns true if it may transfer now, or false
+    // if the caller should pause it until it's returned by a later call.
+    bool Add(uint64_t id, int64_t totalBytes, uint64_t nowMs);
+
+    // Records a new byte count for a download.
+    void UpdateBytes(uint64_t id, int64_t bytesReceived, uint64_t nowMs);
+
+    // Counts a download as completed or interrupted and stops tracking it.
+    // Downloads promoted from the queue into the freed slot are appended to
+    // `toResume`.
+    void Finish(uint64_t id, bool completed, uint64_t nowMs, std::vector<uint64_t>* toResume);
+
+    // User-initiated pause. Frees the download's slot like Finish does.
+    void Pause(uint64_t id, std::vector<uint64_t>* toResume);
+
+    // User-initiated resume. Returns true if the download may transfer now, or
+    // false if it was queued behind other downloads.
+    bool Resume(uint64_t id, uint64_t nowMs);
+
+    // Stops tracking a download without counting it as finished.
+    void Remove(uint64_t id, std::vector<uint64_t>* toResume);
+
+    // Returns true at most once per publish interval, so progress events that
+    // arrive for every received chunk can be coalesced into one UI update.
+    bool ShouldPublish(uint64_t nowMs);
+
+    const Download* Find(uint64_t id) const;
+    // Negative if the ETA can't be estimated.
+    double GetEtaSeconds(uint64_t id) const;
+    Summary GetSummary() const;
+
+    size_t GetCount() const
+    {
+        return m_downloads.size();
+    }
+
+private:
+    Download* FindMutable(uint64_t id);
+    // Remove, with the time the freed slot is handed over at.
+    void Remove(uint64_t id, std::vector<uint64_t>* toResume, uint64_t nowMs);
+    void SetState(Download& download, State state);
+    void SetRate(Download& download, double bytesPerSecond);
+    void PromoteQueued(uint64_t nowMs, std::vector<uint64_t>* toResume);
+    void Restart(Download& download, uint64_t nowMs);
+
+    Options m_options;
+    std::vector<Download> m_downloads;
+    std::unordered_map<uint64_t, size_t> m_index;
+    std::deque<uint64_t> m_queue;
+    size_t m_stateCounts[3] = {};
+    size_t m_completedCount = 0;
+    size_t m_interruptedCount = 0;
+    // Running totals so a summary doesn't have to walk the table.
+    int64_t m_bytesReceived = 0;
+    int64_t m_bytesRemaining = 0;
+    double m_bytesPerSecond = 0;
+    uint64_t m_lastPublishMs = 0;
+    bool m_published = false;
+};
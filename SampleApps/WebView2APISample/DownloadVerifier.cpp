@@ -0,0 +1,182 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DownloadVerifier.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+// Large enough that per-read overhead is negligible next to hashing, small
+// enough to stay in L2 while the hash consumes it.
+constexpr size_t c_readSize = 1024 * 1024;
+
+bool IsHexDigest(const std::string& value)
+{
+    return value.size() == 64 &&
+           std::all_of(
+               value.begin(), value.end(),
+               [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); });
+}
+} // namespace
+
+DownloadVerifier::DownloadVerifier(size_t threadCount, ResultCallback callback)
+    : m_callback(std::move(callback))
+{
+    threadCount = (std::max)(threadCount, size_t(1));
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        m_threads.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+DownloadVerifier::~DownloadVerifier()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_jobAvailable.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+size_t DownloadVerifier::LoadManifest(std::istream& manifest)
+{
+    size_t count = 0;
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        std::string digest = line.substr(0, line.find_first_of(" \t\r"));
+        if (!IsHexDigest(digest))
+        {
+            continue;
+        }
+        AddTrustedDigest(digest);
+        count++;
+    }
+    return count;
+}
+
+size_t DownloadVerifier::LoadManifestFile(const std::filesystem::path& path)
+{
+    std::ifstream manifest(path);
+    return manifest ? LoadManifest(manifest) : 0;
+}
+
+void DownloadVerifier::AddTrustedDigest(const std::string& sha256)
+{
+    std::string digest = sha256;
+    std::transform(digest.begin(), digest.end(), digest.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_trustedDigests.insert(std::move(digest));
+}
+
+void DownloadVerifier::Enqueue(uint64_t id, std::filesystem::path path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({id, std::move(path)});
+    }
+    m_jobAvailable.notify_one();
+}
+
+bool DownloadVerifier::HashFile(
+    const std::filesystem::path& path, Sha256::Digest* digest, uint64_t* bytes,
+    const std::atomic<bool>* cancel)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    // Read straight into our buffer rather than through the stream's own.
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    std::unique_ptr<char[]> buffer(new char[c_readSize]);
+    Sha256 sha;
+    uint64_t total = 0;
+    while (file)
+    {
+        // Checked once per read, so a multi-GB file doesn't hold up shutdown.
+        if (cancel && cancel->load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        file.read(buffer.get(), c_readSize);
+        std::streamsize read = file.gcount();
+        if (read <= 0)
+        {
+            break;
+        }
+        sha.Update(buffer.get(), static_cast<size_t>(read));
+        total += static_cast<uint64_t>(read);
+    }
+    if (file.bad())
+    {
+        return false;
+    }
+    *digest = sha.Finish();
+    *bytes = total;
+    return true;
+}
+
+void DownloadVerifier::WorkerLoop()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping)
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        Result result = Verify(job);
+        if (m_stopping)
+        {
+            // The job was cancelled.
+            return;
+        }
+        if (m_callback)
+        {
+            m_callback(result);
+        }
+    }
+}
+
+DownloadVerifier::Result DownloadVerifier::Verify(const Job& job)
+{
+    Result result;
+    result.id = job.id;
+    result.path = job.path;
+
+    auto start = std::chrono::steady_clock::now();
+    Sha256::Digest digest;
+    if (!HashFile(job.path, &digest, &result.bytes, &m_stopping))
+    {
+        result.verdict = Verdict::Error;
+        return result;
+    }
+    result.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.sha256 = Sha256::ToHex(digest);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.verdict =
+        m_trustedDigests.count(result.sha256) ? Verdict::Trusted : Verdict::Untrusted;
+    return result;
+}
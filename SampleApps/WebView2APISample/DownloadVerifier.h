@@ -0,0 +1,91 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Sha256.h"
+
+// DownloadVerifier hashes finished downloads on a small pool of background
+// threads and checks the SHA-256 against an allowlist of trusted digests.
+//
+// Results are delivered through the callback on the worker thread that
+// produced them. Callers that need to touch UI should marshal the result to
+// their own thread, e.g. with AppWindow::RunAsync. Destroying the verifier
+// cancels the job in progress on each thread, without a result, and drops
+// the rest.
+class DownloadVerifier
+{
+public:
+    enum class Verdict
+    {
+        // The digest is in the allowlist.
+        Trusted,
+        // The file was hashed but its digest isn't in the allowlist.
+        Untrusted,
+        // The file couldn't be read.
+        Error,
+    };
+
+    struct Result
+    {
+        uint64_t id = 0;
+        std::filesystem::path path;
+        Verdict verdict = Verdict::Error;
+        std::string sha256;
+        uint64_t bytes = 0;
+        double seconds = 0;
+    };
+
+    using ResultCallback = std::function<void(const Result&)>;
+
+    DownloadVerifier(size_t threadCount, ResultCallback callback);
+    ~DownloadVerifier();
+
+    // Reads an allowlist in the format written by sha256sum: one hex digest
+    // per line, optionally followed by a file name. Returns the number of
+    // digests added.
+    size_t LoadManifest(std::istream& manifest);
+    size_t LoadManifestFile(const std::filesystem::path& path);
+    void AddTrustedDigest(const std::string& sha256);
+
+    void Enqueue(uint64_t id, std::filesystem::path path);
+
+    // Streams a file through SHA-256 using large sequential reads. Returns
+    // false if the file can't be read, or if `cancel` is set before the end.
+    static bool HashFile(
+        const std::filesystem::path& path, Sha256::Digest* digest, uint64_t* bytes,
+        const std::atomic<bool>* cancel = nullptr);
+
+private:
+    struct Job
+    {
+        uint64_t id;
+        std::filesystem::path path;
+    };
+
+    void WorkerLoop();
+    Result Verify(const Job& job);
+
+    ResultCallback m_callback;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::deque<Job> m_jobs;
+    std::unordered_set<std::string> m_trustedDigests;
+    // Also read without the lock, by the hashing loop.
+    std::atomic<bool> m_stopping{false};
+};
@@ -0,0 +1,111 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DragSession.h"
+
+#include <algorithm>
+#include <sstream>
+
+bool DragSession::Enter(
+    uintptr_t data, Point offset, uint32_t keyState, int64_t frameIntervalUs, int64_t nowUs)
+{
+    m_active = true;
+    m_offset = offset;
+    m_frameIntervalUs = frameIntervalUs > 0 ? frameIntervalUs : c_defaultFrameIntervalUs;
+    m_enterUs = nowUs;
+    m_lastForwardUs = nowUs;
+    m_lastKeyState = keyState;
+    m_sessionCount++;
+    if (data == m_data && data != 0)
+    {
+        return false;
+    }
+    m_data = data;
+    m_formats.clear();
+    m_snapshotCount++;
+    return true;
+}
+
+void DragSession::SetFormats(std::vector<Format> formats)
+{
+    m_formats = std::move(formats);
+}
+
+bool DragSession::ShouldForwardOver(uint32_t keyState, int64_t nowUs)
+{
+    m_overCount++;
+    if (keyState == m_lastKeyState && nowUs - m_lastForwardUs < m_frameIntervalUs)
+    {
+        return false;
+    }
+    m_lastKeyState = keyState;
+    m_lastForwardUs = nowUs;
+    m_forwardedOverCount++;
+    return true;
+}
+
+void DragSession::RecordForwarded(uint32_t effect, int64_t durationUs)
+{
+    m_lastEffect = effect;
+    m_forwardLatency.Record(static_cast<uint64_t>((std::max)(durationUs, int64_t(0))));
+}
+
+void DragSession::Leave(int64_t nowUs)
+{
+    if (m_active)
+    {
+        m_sessionDuration.Record(
+            static_cast<uint64_t>((std::max)(nowUs - m_enterUs, int64_t(0))));
+        m_active = false;
+    }
+}
+
+void DragSession::Drop(size_t fileCount, int64_t durationUs, int64_t nowUs)
+{
+    Leave(nowUs);
+    m_dropCount++;
+    m_lastDropFileCount = fileCount;
+    m_dropLatency.Record(static_cast<uint64_t>((std::max)(durationUs, int64_t(0))));
+}
+
+void DragSession::Reset()
+{
+    m_data = 0;
+}
+
+std::string DragSession::GetReport() const
+{
+    std::ostringstream report;
+    report << m_sessionCount << " drag enters, " << m_snapshotCount << " format snapshots, "
+           << m_dropCount << " drops\n"
+           << "DragOver: " << m_overCount << " received, " << m_forwardedOverCount
+           << " forwarded at most every " << m_frameIntervalUs << " us\n"
+           << "Forwarded DragEnter and DragOver: p50 "
+           << m_forwardLatency.GetValueAtPercentile(50) << " us, p99 "
+           << m_forwardLatency.GetValueAtPercentile(99) << " us\n"
+           << "Drop: p50 " << m_dropLatency.GetValueAtPercentile(50) << " us, max "
+           << m_dropLatency.GetMax() << " us\n"
+           << "Drag duration: p50 " << m_sessionDuration.GetValueAtPercentile(50) / 1000
+           << " ms, max " << m_sessionDuration.GetMax() / 1000 << " ms\n";
+    if (m_formats.empty())
+    {
+        return report.str();
+    }
+    report << "\nFormats of the last drag";
+    if (m_dropCount > 0)
+    {
+        report << ", " << m_lastDropFileCount << " files at the last drop";
+    }
+    report << ":\n";
+    for (const Format& format : m_formats)
+    {
+        report << "  " << format.name << " (" << format.id << ", media " << format.media << ")";
+        if (format.droppedBytes >= 0)
+        {
+            report << ": " << format.droppedBytes << " bytes";
+        }
+        report << "\n";
+    }
+    return report.str();
+}
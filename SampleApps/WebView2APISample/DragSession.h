@@ -0,0 +1,119 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "HdrHistogram.h"
+
+// DragSession holds what DropTarget learns about a drag over the WebView in
+// the visual hosting modes, so that it is worked out once per drag rather
+// than on each of the drag's events.
+//
+// Enter starts a session for a DragEnter. The offset from screen to WebView
+// coordinates is taken then and kept for the session, since the window does
+// not move while the user drags. The formats of the dragged data are
+// snapshotted by the host when Enter returns true, which it does unless the
+// data is that of the session, which lasts until Reset. The host identifies
+// the data by a pointer it holds until then, so that the pointer isn't reused
+// by other data.
+//
+// OLE calls DragOver for every mouse move, which can be far more often than
+// the display refreshes. ShouldForwardOver forwards a DragOver to the WebView
+// when the key state changed or a frame interval has passed since the last
+// one forwarded; the host answers the others with the last effect. As OLE
+// keeps calling DragOver while the mouse is still, the last position reaches
+// the WebView within about a frame.
+//
+// Times are in microseconds on any monotonic clock. Not thread-safe. Has no
+// dependency on Win32.
+class DragSession
+{
+public:
+    struct Point
+    {
+        int32_t x;
+        int32_t y;
+    };
+
+    struct Format
+    {
+        // The clipboard format and the storage media it comes on.
+        uint32_t id = 0;
+        uint32_t media = 0;
+        std::string name;
+        // The size of the data at the last drop, or -1 if not measured. The
+        // host only measures the file list.
+        int64_t droppedBytes = -1;
+    };
+
+    // Used if the host doesn't know the refresh rate: 60 Hz.
+    static constexpr int64_t c_defaultFrameIntervalUs = 16667;
+
+    // Returns true if the host should snapshot the formats of `data`, which
+    // only identifies the data object.
+    bool Enter(
+        uintptr_t data, Point offset, uint32_t keyState, int64_t frameIntervalUs,
+        int64_t nowUs);
+    void SetFormats(std::vector<Format> formats);
+    std::vector<Format>& GetFormats()
+    {
+        return m_formats;
+    }
+
+    Point ToWebView(Point screen) const
+    {
+        return {screen.x + m_offset.x, screen.y + m_offset.y};
+    }
+
+    bool ShouldForwardOver(uint32_t keyState, int64_t nowUs);
+    // Records the effect the WebView returned for DragEnter or DragOver.
+    void RecordForwarded(uint32_t effect, int64_t durationUs);
+    uint32_t GetLastEffect() const
+    {
+        return m_lastEffect;
+    }
+
+    void Leave(int64_t nowUs);
+    // Ends the session. The sizes of the formats were measured by the host.
+    void Drop(size_t fileCount, int64_t durationUs, int64_t nowUs);
+    // Forgets the data, so that the next Enter snapshots again.
+    void Reset();
+
+    uint64_t GetOverCount() const
+    {
+        return m_overCount;
+    }
+    uint64_t GetForwardedOverCount() const
+    {
+        return m_forwardedOverCount;
+    }
+    std::string GetReport() const;
+
+private:
+    uintptr_t m_data = 0;
+    bool m_active = false;
+    Point m_offset = {0, 0};
+    int64_t m_frameIntervalUs = c_defaultFrameIntervalUs;
+    int64_t m_enterUs = 0;
+    int64_t m_lastForwardUs = 0;
+    uint32_t m_lastKeyState = 0;
+    uint32_t m_lastEffect = 0;
+    std::vector<Format> m_formats;
+
+    uint64_t m_sessionCount = 0;
+    uint64_t m_snapshotCount = 0;
+    uint64_t m_overCount = 0;
+    uint64_t m_forwardedOverCount = 0;
+    uint64_t m_dropCount = 0;
+    size_t m_lastDropFileCount = 0;
+    // Microseconds.
+    HdrHistogram m_forwardLatency;
+    HdrHistogram m_dropLatency;
+    HdrHistogram m_sessionDuration;
+};
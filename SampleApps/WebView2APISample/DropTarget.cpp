@@ -8,6 +8,79 @@
 #include "ViewComponent.h"
 #include <ShlGuid.h>
 #include <Shobjidl.h>
+#include <shellapi.h>
+
+#include <chrono>
+
+#include "StringConversion.h"
+
+namespace
+{
+int64_t GetNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string GetFormatName(CLIPFORMAT format)
+{
+    switch (format)
+    {
+    case CF_TEXT:
+        return "CF_TEXT";
+    case CF_BITMAP:
+        return "CF_BITMAP";
+    case CF_DIB:
+        return "CF_DIB";
+    case CF_UNICODETEXT:
+        return "CF_UNICODETEXT";
+    case CF_HDROP:
+        return "CF_HDROP";
+    case CF_LOCALE:
+        return "CF_LOCALE";
+    case CF_DIBV5:
+        return "CF_DIBV5";
+    }
+    WCHAR name[128];
+    if (GetClipboardFormatNameW(format, name, ARRAYSIZE(name)) > 0)
+    {
+        return ToUtf8(name);
+    }
+    return "Format " + std::to_string(format);
+}
+
+// Whether two interface pointers are of the same COM object, which is the
+// case if they give the same IUnknown.
+bool IsEqualObject(IUnknown* first, IUnknown* second)
+{
+    if (!first || !second)
+    {
+        return first == second;
+    }
+    wil::com_ptr<IUnknown> firstIdentity;
+    wil::com_ptr<IUnknown> secondIdentity;
+    return SUCCEEDED(first->QueryInterface(IID_PPV_ARGS(&firstIdentity))) &&
+           SUCCEEDED(second->QueryInterface(IID_PPV_ARGS(&secondIdentity))) &&
+           firstIdentity == secondIdentity;
+}
+
+// DragOver is forwarded at most once per refresh of the window's monitor.
+int64_t GetFrameIntervalUs(HWND window)
+{
+    MONITORINFOEXW monitorInfo = {};
+    monitorInfo.cbSize = sizeof(monitorInfo);
+    DEVMODEW mode = {};
+    mode.dmSize = sizeof(mode);
+    if (GetMonitorInfoW(MonitorFromWindow(window, MONITOR_DEFAULTTONEAREST), &monitorInfo) &&
+        EnumDisplaySettingsW(monitorInfo.szDevice, ENUM_CURRENT_SETTINGS, &mode) &&
+        mode.dmDisplayFrequency > 1)
+    {
+        return 1000000 / mode.dmDisplayFrequency;
+    }
+    return DragSession::c_defaultFrameIntervalUs;
+}
+} // namespace
 
 DropTarget::DropTarget() : m_window(nullptr) {}
 
@@ -29,27 +102,58 @@ void DropTarget::Init(
 HRESULT DropTarget::DragEnter(
     IDataObject* dataObject, DWORD keyState, POINTL cursorPosition, DWORD* effect)
 {
-    POINT point = {cursorPosition.x, cursorPosition.y};
-    // Convert the screen point to client coordinates add the WebView's offset.
-    m_viewComponent->OffsetPointToWebView(&point);
-    return m_webViewCompositionController3->DragEnter(dataObject, keyState, point, effect);
+    int64_t now = GetNowUs();
+    // Screen points are converted to client coordinates and offset by the
+    // WebView's position. The window doesn't move during the drag, so the
+    // offset is taken once.
+    POINT offset = {0, 0};
+    m_viewComponent->OffsetPointToWebView(&offset);
+    m_isMirrored = (GetWindowLong(m_window, GWL_EXSTYLE) & WS_EX_LAYOUTRTL) != 0;
+    // The session knows the data by the pointer held in m_dataObject, which
+    // can't be reused for other data while it is held.
+    if (!IsEqualObject(m_dataObject.get(), dataObject))
+    {
+        m_session.Reset();
+        m_dataObject = dataObject;
+    }
+    if (m_session.Enter(
+            reinterpret_cast<uintptr_t>(m_dataObject.get()), {offset.x, offset.y}, keyState,
+            GetFrameIntervalUs(m_window), now))
+    {
+        SnapshotFormats(dataObject);
+    }
+    HRESULT hr = m_webViewCompositionController3->DragEnter(
+        dataObject, keyState, ToWebView(cursorPosition), effect);
+    m_session.RecordForwarded(*effect, GetNowUs() - now);
+    return hr;
 }
 //! [DragEnter]
 
 //! [DragOver]
 HRESULT DropTarget::DragOver(DWORD keyState, POINTL cursorPosition, DWORD* effect)
 {
-    POINT point = {cursorPosition.x, cursorPosition.y};
-    // Convert the screen point to client coordinates add the WebView's offset.
-    // This returns whether the resultant point is over the WebView visual.
-    m_viewComponent->OffsetPointToWebView(&point);
-    return m_webViewCompositionController3->DragOver(keyState, point, effect);
+    int64_t now = GetNowUs();
+    // Mouse moves within a frame of the last forwarded one get the same effect.
+    if (!m_session.ShouldForwardOver(keyState, now))
+    {
+        *effect = m_session.GetLastEffect();
+        return S_OK;
+    }
+    HRESULT hr =
+        m_webViewCompositionController3->DragOver(keyState, ToWebView(cursorPosition), effect);
+    m_session.RecordForwarded(*effect, GetNowUs() - now);
+    return hr;
 }
 //! [DragOver]
 
 //! [DragLeave]
 HRESULT DropTarget::DragLeave()
 {
+    m_session.Leave(GetNowUs());
+    // The drag may end anywhere once it has left, so the source's data isn't
+    // held any longer. Coming back snapshots the formats again.
+    m_session.Reset();
+    m_dataObject = nullptr;
     return m_webViewCompositionController3->DragLeave();
 }
 //! [DragLeave]
@@ -57,11 +161,92 @@ HRESULT DropTarget::DragLeave()
 //! [Drop]
 HRESULT DropTarget::Drop(
     IDataObject* dataObject, DWORD keyState, POINTL cursorPosition, DWORD* effect)
+{
+    int64_t now = GetNowUs();
+    HRESULT hr = m_webViewCompositionController3->Drop(
+        dataObject, keyState, ToWebView(cursorPosition), effect);
+    int64_t dropped = GetNowUs();
+    // Without a DragEnter for this data, the formats are of other data.
+    if (!IsEqualObject(m_dataObject.get(), dataObject))
+    {
+        SnapshotFormats(dataObject);
+    }
+    // Measured once the WebView has the data, so as not to delay it.
+    size_t fileCount = MeasureDrop(dataObject);
+    m_session.Drop(fileCount, dropped - now, dropped);
+    m_session.Reset();
+    m_dataObject = nullptr;
+    return hr;
+}
+//! [Drop]
+
+std::wstring DropTarget::GetReport() const
+{
+    return ToUtf16(m_session.GetReport());
+}
+
+POINT DropTarget::ToWebView(POINTL cursorPosition)
 {
     POINT point = {cursorPosition.x, cursorPosition.y};
-    // Convert the screen point to client coordinates add the WebView's offset.
-    // This returns whether the resultant point is over the WebView visual.
-    m_viewComponent->OffsetPointToWebView(&point);
-    return m_webViewCompositionController3->Drop(dataObject, keyState, point, effect);
+    if (m_isMirrored)
+    {
+        m_viewComponent->OffsetPointToWebView(&point);
+        return point;
+    }
+    DragSession::Point webViewPoint = m_session.ToWebView({point.x, point.y});
+    return {webViewPoint.x, webViewPoint.y};
+}
+
+void DropTarget::SnapshotFormats(IDataObject* dataObject)
+{
+    std::vector<DragSession::Format> snapshot;
+    wil::com_ptr<IEnumFORMATETC> formats;
+    if (SUCCEEDED(dataObject->EnumFormatEtc(DATADIR_GET, &formats)) && formats)
+    {
+        FORMATETC format;
+        while (formats->Next(1, &format, nullptr) == S_OK)
+        {
+            if (format.ptd)
+            {
+                CoTaskMemFree(format.ptd);
+            }
+            DragSession::Format entry;
+            entry.id = format.cfFormat;
+            entry.media = format.tymed;
+            entry.name = GetFormatName(format.cfFormat);
+            snapshot.push_back(std::move(entry));
+        }
+    }
+    m_session.SetFormats(std::move(snapshot));
+}
+
+size_t DropTarget::MeasureDrop(IDataObject* dataObject)
+{
+    for (DragSession::Format& format : m_session.GetFormats())
+    {
+        format.droppedBytes = -1;
+    }
+    // Only the file list is read. Getting other formats can make the source
+    // render them, which for images and virtual files costs more than the
+    // drop did.
+    FORMATETC formatEtc = {CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+    STGMEDIUM medium = {};
+    if (FAILED(dataObject->GetData(&formatEtc, &medium)))
+    {
+        return 0;
+    }
+    size_t fileCount = 0;
+    if (medium.tymed == TYMED_HGLOBAL)
+    {
+        fileCount = DragQueryFileW(static_cast<HDROP>(medium.hGlobal), 0xFFFFFFFF, nullptr, 0);
+        for (DragSession::Format& format : m_session.GetFormats())
+        {
+            if (format.id == CF_HDROP)
+            {
+                format.droppedBytes = static_cast<int64_t>(GlobalSize(medium.hGlobal));
+            }
+        }
+    }
+    ReleaseStgMedium(&medium);
+    return fileCount;
 }
-//! [Drop]
\ No newline at end of file
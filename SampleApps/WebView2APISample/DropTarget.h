@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <string>
+
+#include "DragSession.h"
+
 struct IDropTargetHelper;
 class ViewComponent;
 
@@ -35,6 +39,9 @@ public:
         POINTL cursorPosition,
         DWORD* effect) override;
 
+    // Counts and timings of the drags so far, and the formats of the last one.
+    std::wstring GetReport() const;
+
 private:
     ViewComponent* m_viewComponent = nullptr;
 
@@ -46,4 +53,17 @@ private:
     HWND m_window;
 
     wil::com_ptr<ICoreWebView2CompositionController3> m_webViewCompositionController3;
+
+    POINT ToWebView(POINTL cursorPosition);
+    void SnapshotFormats(IDataObject* dataObject);
+    // Measures the dropped file list and returns the number of files.
+    size_t MeasureDrop(IDataObject* dataObject);
+
+    DragSession m_session;
+    // The data of the drag over the window, held from DragEnter until the
+    // drag leaves or drops.
+    wil::com_ptr<IDataObject> m_dataObject;
+    // ScreenToClient mirrors x in right-to-left windows, where the offset
+    // can't be cached.
+    bool m_isMirrored = false;
 };
\ No newline at end of file
@@ -0,0 +1,343 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FailureLog.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr size_t c_headerSize = 8;
+// Time, kind, reason, exit code and the two string lengths.
+constexpr size_t c_fixedPayloadSize = 8 + 3 * 4 + 2 * 2;
+constexpr size_t c_maxStringSize = 0xFFFF;
+constexpr size_t c_maxPayloadSize = c_fixedPayloadSize + 2 * c_maxStringSize;
+
+uint32_t HashPayload(const char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void Put(std::string* out, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        out->push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+uint64_t Get(const char* in, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        value |= uint64_t(static_cast<uint8_t>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+int64_t GetBucketStart(int64_t timeMs)
+{
+    int64_t bucket = timeMs / FailureLog::c_bucketMs;
+    if (timeMs % FailureLog::c_bucketMs < 0)
+    {
+        bucket--;
+    }
+    return bucket * FailureLog::c_bucketMs;
+}
+} // namespace
+
+FailureLog::FailureLog(const std::filesystem::path& path, uint64_t maxFileSize)
+    : m_path(path), m_previousPath(path), m_maxFileSize(maxFileSize)
+{
+    m_previousPath += ".1";
+    Load();
+}
+
+void FailureLog::Load()
+{
+    LoadFile(m_previousPath);
+    uint64_t validSize = LoadFile(m_path);
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(m_path, error);
+    if (!error && fileSize != validSize)
+    {
+        // Drop a torn record so new records follow the last intact one.
+        std::filesystem::resize_file(m_path, validSize, error);
+    }
+    m_fileSize = validSize;
+    m_file.open(m_path, std::ios::binary | std::ios::app);
+}
+
+uint64_t FailureLog::LoadFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    uint64_t validSize = 0;
+    char header[c_headerSize];
+    std::string payload;
+    Failure failure;
+    while (in.read(header, c_headerSize))
+    {
+        size_t size = static_cast<size_t>(Get(header, 4));
+        if (size < c_fixedPayloadSize || size > c_maxPayloadSize)
+        {
+            break;
+        }
+        payload.resize(size);
+        if (!in.read(&payload[0], size) ||
+            HashPayload(payload.data(), size) != static_cast<uint32_t>(Get(header + 4, 4)))
+        {
+            break;
+        }
+        const char* field = payload.data();
+        failure.timeMs = static_cast<int64_t>(Get(field, 8));
+        failure.kind = static_cast<int32_t>(Get(field + 8, 4));
+        failure.reason = static_cast<int32_t>(Get(field + 12, 4));
+        failure.exitCode = static_cast<int32_t>(Get(field + 16, 4));
+        size_t moduleSize = static_cast<size_t>(Get(field + 20, 2));
+        size_t descriptionSize = static_cast<size_t>(Get(field + 22, 2));
+        if (c_fixedPayloadSize + moduleSize + descriptionSize != size)
+        {
+            break;
+        }
+        failure.module.assign(field + c_fixedPayloadSize, moduleSize);
+        failure.description.assign(field + c_fixedPayloadSize + moduleSize, descriptionSize);
+        Index(failure);
+        validSize += c_headerSize + size;
+    }
+    return validSize;
+}
+
+bool FailureLog::Rotate()
+{
+    m_file.close();
+    std::error_code error;
+    std::filesystem::rename(m_path, m_previousPath, error);
+    if (error)
+    {
+        // Keep the cap even if the generation can't be kept.
+        std::filesystem::resize_file(m_path, 0, error);
+    }
+    m_fileSize = 0;
+    m_rotationCount++;
+    m_file.open(m_path, std::ios::binary | std::ios::app);
+    return m_file.is_open();
+}
+
+uint64_t FailureLog::Append(const Failure& failure)
+{
+    std::string_view module(failure.module);
+    std::string_view description(failure.description);
+    module = module.substr(0, c_maxStringSize);
+    description = description.substr(0, c_maxStringSize);
+    size_t size = c_fixedPayloadSize + module.size() + description.size();
+    size_t start = m_pending.size();
+    m_pending.resize(start + c_headerSize);
+    Put(&m_pending, static_cast<uint64_t>(failure.timeMs), 8);
+    Put(&m_pending, static_cast<uint32_t>(failure.kind), 4);
+    Put(&m_pending, static_cast<uint32_t>(failure.reason), 4);
+    Put(&m_pending, static_cast<uint32_t>(failure.exitCode), 4);
+    Put(&m_pending, module.size(), 2);
+    Put(&m_pending, description.size(), 2);
+    m_pending.append(module);
+    m_pending.append(description);
+    std::string header;
+    Put(&header, size, 4);
+    Put(&header, HashPayload(m_pending.data() + start + c_headerSize, size), 4);
+    m_pending.replace(start, c_headerSize, header);
+
+    if (m_pendingCount++ == 0)
+    {
+        m_firstPendingMs = failure.timeMs;
+    }
+    return Index(failure);
+}
+
+bool FailureLog::ShouldFlush(int64_t nowMs) const
+{
+    return m_pendingCount > 0 &&
+           (m_pendingCount >= c_batchRecords || nowMs - m_firstPendingMs >= c_batchIntervalMs);
+}
+
+bool FailureLog::Flush()
+{
+    if (m_pendingCount == 0)
+    {
+        return true;
+    }
+    if (m_fileSize > 0 && m_fileSize + m_pending.size() > m_maxFileSize && !Rotate())
+    {
+        return false;
+    }
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+    m_file.write(m_pending.data(), static_cast<std::streamsize>(m_pending.size()));
+    m_file.flush();
+    if (!m_file)
+    {
+        // Cut off what was written of the batch, which would otherwise end the
+        // log when it is next opened.
+        m_file.close();
+        std::error_code error;
+        std::filesystem::resize_file(m_path, m_fileSize, error);
+        m_file.open(m_path, std::ios::binary | std::ios::app);
+        return false;
+    }
+    m_fileSize += m_pending.size();
+    m_pending.clear();
+    m_pendingCount = 0;
+    return true;
+}
+
+const FailureLog::Signature* FailureLog::FindSignature(uint64_t hash) const
+{
+    auto signature = m_signatures.find(hash);
+    return signature == m_signatures.end() ? nullptr : &signature->second;
+}
+
+std::vector<const FailureLog::Signature*> FailureLog::GetTopSignatures(size_t count) const
+{
+    std::vector<const Signature*> signatures;
+    signatures.reserve(m_signatures.size());
+    for (const auto& entry : m_signatures)
+    {
+        signatures.push_back(&entry.second);
+    }
+    count = (std::min)(count, signatures.size());
+    std::partial_sort(
+        signatures.begin(), signatures.begin() + count, signatures.end(),
+        [](const Signature* a, const Signature* b)
+        { return a->count != b->count ? a->count > b->count : a->lastSeenMs > b->lastSeenMs; });
+    signatures.resize(count);
+    return signatures;
+}
+
+std::vector<FailureLog::ModuleCount> FailureLog::GetTopModules(
+    int64_t sinceMs, size_t count) const
+{
+    std::vector<uint64_t> counts(m_moduleNames.size());
+    // The records of the first hour are counted one by one, as only some of
+    // them may be recent enough, and those of the later hours by bucket.
+    int64_t firstBucketEndMs = GetBucketStart(sinceMs) + c_bucketMs;
+    size_t index = std::lower_bound(m_times.begin(), m_times.end(), sinceMs) - m_times.begin();
+    for (; index < m_times.size() && m_times[index] < firstBucketEndMs; index++)
+    {
+        counts[m_modules[index]]++;
+    }
+    auto bucket = std::lower_bound(
+        m_buckets.begin(), m_buckets.end(), firstBucketEndMs,
+        [](const Bucket& entry, int64_t startMs) { return entry.startMs < startMs; });
+    for (; bucket != m_buckets.end(); ++bucket)
+    {
+        for (const auto& moduleCount : bucket->moduleCounts)
+        {
+            counts[moduleCount.first] += moduleCount.second;
+        }
+    }
+
+    std::vector<ModuleCount> modules;
+    for (uint32_t id = 1; id < counts.size(); id++)
+    {
+        if (counts[id])
+        {
+            modules.push_back({m_moduleNames[id], counts[id]});
+        }
+    }
+    count = (std::min)(count, modules.size());
+    std::partial_sort(
+        modules.begin(), modules.begin() + count, modules.end(),
+        [](const ModuleCount& a, const ModuleCount& b) { return a.count > b.count; });
+    modules.resize(count);
+    return modules;
+}
+
+uint64_t FailureLog::GetSignatureHash(
+    int32_t kind, int32_t reason, int32_t exitCode, std::string_view moduleName)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+    for (int32_t value : {kind, reason, exitCode})
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            add(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i)));
+        }
+    }
+    for (char c : moduleName)
+    {
+        add(static_cast<uint8_t>(c));
+    }
+    return hash;
+}
+
+std::string FailureLog::GetModuleName(std::string_view path)
+{
+    size_t separator = path.find_last_of("\\/");
+    std::string name(separator == std::string_view::npos ? path : path.substr(separator + 1));
+    for (char& c : name)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return name;
+}
+
+uint64_t FailureLog::Index(const Failure& failure)
+{
+    std::string moduleName = GetModuleName(failure.module);
+    uint64_t hash =
+        GetSignatureHash(failure.kind, failure.reason, failure.exitCode, moduleName);
+    Signature& signature = m_signatures[hash];
+    if (signature.count++ == 0)
+    {
+        signature.hash = hash;
+        signature.kind = failure.kind;
+        signature.reason = failure.reason;
+        signature.exitCode = failure.exitCode;
+        signature.module = moduleName;
+        signature.firstSeenMs = failure.timeMs;
+        signature.lastSeenMs = failure.timeMs;
+    }
+    signature.firstSeenMs = (std::min)(signature.firstSeenMs, failure.timeMs);
+    signature.lastSeenMs = (std::max)(signature.lastSeenMs, failure.timeMs);
+
+    uint32_t moduleId = InternModule(moduleName);
+    int64_t timeMs =
+        m_times.empty() ? failure.timeMs : (std::max)(failure.timeMs, m_times.back());
+    m_times.push_back(timeMs);
+    m_modules.push_back(moduleId);
+    int64_t bucketStartMs = GetBucketStart(timeMs);
+    if (m_buckets.empty() || m_buckets.back().startMs != bucketStartMs)
+    {
+        m_buckets.push_back({bucketStartMs, {}});
+    }
+    m_buckets.back().moduleCounts[moduleId]++;
+    return hash;
+}
+
+uint32_t FailureLog::InternModule(const std::string& name)
+{
+    if (name.empty())
+    {
+        return 0;
+    }
+    auto id = m_moduleIds.find(name);
+    if (id != m_moduleIds.end())
+    {
+        return id->second;
+    }
+    uint32_t newId = static_cast<uint32_t>(m_moduleNames.size());
+    m_moduleNames.push_back(name);
+    m_moduleIds.emplace(name, newId);
+    return newId;
+}
@@ -0,0 +1,168 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// FailureLog records the ProcessFailed events of the WebViews in an
+// append-only file, and keeps the aggregates that failure analysis needs in
+// memory: a failure signature, the hash of its kind, reason, exit code and
+// failing module, with its count and first and last times, and failure counts
+// by module and hour for "top failing modules of the last N hours".
+//
+// Append buffers records in memory. The host calls Flush once ShouldFlush
+// says a batch is due, c_batchRecords records or c_batchIntervalMs after the
+// first buffered one, and then makes the file durable, e.g. with
+// FlushFileBuffers, so a burst of failures costs one sync rather than one per
+// record.
+//
+// The file is kept under c_maxFileSize by rotation: when a batch would take
+// it over, it is renamed to the previous generation, `<path>.1`, replacing the
+// one before, and a new file is started. Opening the log reads the previous
+// generation, then the current one, so the aggregates cover at most twice
+// c_maxFileSize of records when the log is opened. Until it is next opened,
+// they also keep the records of the generation that rotation removed.
+//
+// Each record is: payload length (u32), FNV-1a hash of the payload (u32), and
+// the payload: time (i64), kind, reason and exit code (i32), module and
+// process description (u16 length and UTF-8 bytes). Records are checked when
+// the log is opened, and the file is truncated after the last intact one, so a
+// record torn by a crash is dropped rather than read. Integers are
+// little-endian.
+//
+// Times are in milliseconds since the Unix epoch. Not thread-safe. Has no
+// dependency on Win32.
+class FailureLog
+{
+public:
+    struct Failure
+    {
+        int64_t timeMs = 0;
+        int32_t kind = 0;
+        int32_t reason = 0;
+        int32_t exitCode = 0;
+        // The path of the failing module, which may be empty.
+        std::string module;
+        std::string description;
+    };
+
+    struct Signature
+    {
+        uint64_t hash = 0;
+        int32_t kind = 0;
+        int32_t reason = 0;
+        int32_t exitCode = 0;
+        // The file name of the module, in lower case.
+        std::string module;
+        uint64_t count = 0;
+        int64_t firstSeenMs = 0;
+        int64_t lastSeenMs = 0;
+    };
+
+    struct ModuleCount
+    {
+        std::string module;
+        uint64_t count = 0;
+    };
+
+    static constexpr size_t c_batchRecords = 64;
+    static constexpr int64_t c_batchIntervalMs = 1000;
+    static constexpr int64_t c_bucketMs = 60 * 60 * 1000;
+    // Some 200000 records with a module path.
+    static constexpr uint64_t c_maxFileSize = 16 * 1024 * 1024;
+
+    // Opening reads and checks the whole log, which takes a while for a large
+    // one, so hosts open it off the UI thread.
+    explicit FailureLog(
+        const std::filesystem::path& path, uint64_t maxFileSize = c_maxFileSize);
+
+    // Returns the failure's signature hash.
+    uint64_t Append(const Failure& failure);
+    bool ShouldFlush(int64_t nowMs) const;
+    // Writes the buffered records. Returns false if they could not be
+    // written, in which case they are kept for the next Flush.
+    bool Flush();
+    size_t GetPendingCount() const
+    {
+        return m_pendingCount;
+    }
+
+    const Signature* FindSignature(uint64_t hash) const;
+    // The `count` signatures seen most often, most frequent first.
+    std::vector<const Signature*> GetTopSignatures(size_t count) const;
+    // The `count` modules that failed most often since `sinceMs`, failures
+    // without a module excluded.
+    std::vector<ModuleCount> GetTopModules(int64_t sinceMs, size_t count) const;
+
+    uint64_t GetRecordCount() const
+    {
+        return m_times.size();
+    }
+    size_t GetSignatureCount() const
+    {
+        return m_signatures.size();
+    }
+    // The size of the current generation.
+    uint64_t GetFileSize() const
+    {
+        return m_fileSize;
+    }
+    uint64_t GetRotationCount() const
+    {
+        return m_rotationCount;
+    }
+
+    static uint64_t GetSignatureHash(
+        int32_t kind, int32_t reason, int32_t exitCode, std::string_view moduleName);
+    // Returns the file name of `path` in lower case.
+    static std::string GetModuleName(std::string_view path);
+
+private:
+    struct Bucket
+    {
+        int64_t startMs = 0;
+        // By module ID.
+        std::unordered_map<uint32_t, uint32_t> moduleCounts;
+    };
+
+    void Load();
+    // Indexes the intact records of the file at `path` and returns their size.
+    uint64_t LoadFile(const std::filesystem::path& path);
+    // Starts a new generation. Returns false if the file could not be
+    // reopened.
+    bool Rotate();
+    // Adds a failure to the aggregates.
+    uint64_t Index(const Failure& failure);
+    uint32_t InternModule(const std::string& name);
+
+    std::filesystem::path m_path;
+    std::filesystem::path m_previousPath;
+    uint64_t m_maxFileSize;
+    std::ofstream m_file;
+    uint64_t m_fileSize = 0;
+    uint64_t m_rotationCount = 0;
+    std::string m_pending;
+    size_t m_pendingCount = 0;
+    int64_t m_firstPendingMs = 0;
+
+    std::unordered_map<uint64_t, Signature> m_signatures;
+    // Module IDs index m_moduleNames. ID 0 is the empty name.
+    std::vector<std::string> m_moduleNames = {std::string()};
+    std::unordered_map<std::string, uint32_t> m_moduleIds;
+    // The time and module ID of each record, in order. Times never decrease:
+    // a record older than the one before it, as after a clock change, is
+    // indexed at the earlier record's time.
+    std::vector<int64_t> m_times;
+    std::vector<uint32_t> m_modules;
+    // Module counts by hour, for the hours that have records.
+    std::vector<Bucket> m_buckets;
+};
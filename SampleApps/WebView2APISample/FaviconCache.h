@@ -0,0 +1,196 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FaviconStore.h"
+
+// FaviconCache returns decoded favicons by favicon URI so a page that was
+// seen before does not have to fetch and decode its icon again. It has two
+// tiers: a small LRU of decoded images in memory, and a FaviconStore of PNG
+// bytes on disk. Both are keyed by the content of the icon, so URIs that
+// serve identical icons share one decoded image.
+//
+// A site can change the icon behind a URI, so an icon that hasn't been
+// fetched within the revalidation interval is reported stale: the caller
+// shows it right away, fetches it again and passes the result to Add, which
+// only decodes and stores it if its content changed.
+//
+// `Image` is whatever the caller decodes PNGs into, e.g. an HICON wrapper;
+// the cache only holds shared_ptrs to it. Safe to use from several threads.
+// Has no dependency on Win32.
+template <typename Image> class FaviconCache
+{
+public:
+    // Returns null if the PNG cannot be decoded.
+    using DecodeFunction =
+        std::function<std::shared_ptr<Image>(const uint8_t* png, size_t size)>;
+
+    struct Counters
+    {
+        uint64_t memoryHits = 0;
+        uint64_t diskHits = 0;
+        uint64_t misses = 0;
+        uint64_t decodes = 0;
+        uint64_t deduplicatedIcons = 0;
+        // Icons a URI was fetched again with different content.
+        uint64_t changedIcons = 0;
+        double decodeMilliseconds = 0;
+
+        double GetHitRate() const
+        {
+            uint64_t lookups = memoryHits + diskHits + misses;
+            return lookups ? double(memoryHits + diskHits) / lookups : 0;
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t c_defaultCapacity = 128;
+    static constexpr std::chrono::minutes c_defaultRevalidateInterval{60};
+
+    FaviconCache(
+        const std::filesystem::path& storePath, DecodeFunction decode,
+        size_t capacity = c_defaultCapacity,
+        Clock::duration revalidateInterval = c_defaultRevalidateInterval)
+        : m_store(storePath), m_decode(std::move(decode)), m_capacity(capacity),
+          m_revalidateInterval(revalidateInterval)
+    {
+    }
+
+    // Returns the icon last stored for `uri`, or null if there is none.
+    // `*stale` is set if the icon wasn't fetched within the revalidation
+    // interval, which is always the case for icons stored by an earlier run.
+    std::shared_ptr<Image> Find(
+        const std::string& uri, bool* stale = nullptr, Clock::time_point now = Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        FaviconStore::Digest digest;
+        if (!m_store.Find(uri, &digest))
+        {
+            m_counters.misses++;
+            return nullptr;
+        }
+        if (stale)
+        {
+            auto fetched = m_fetched.find(uri);
+            *stale = fetched == m_fetched.end() ||
+                     now - fetched->second >= m_revalidateInterval;
+        }
+        if (auto image = FindInMemory(digest))
+        {
+            m_counters.memoryHits++;
+            return image;
+        }
+        std::vector<uint8_t> png;
+        std::shared_ptr<Image> image;
+        if (m_store.ReadPng(digest, &png) && (image = Decode(png.data(), png.size())))
+        {
+            m_counters.diskHits++;
+            AddToMemory(digest, image);
+            return image;
+        }
+        m_counters.misses++;
+        return nullptr;
+    }
+
+    // Stores a freshly fetched icon for `uri` and returns it decoded. Decoding
+    // is skipped if the same icon is already in memory, for this URI or
+    // another.
+    std::shared_ptr<Image> Add(
+        const std::string& uri, const uint8_t* png, size_t size,
+        Clock::time_point now = Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        FaviconStore::Digest previous;
+        bool hadIcon = m_store.Find(uri, &previous);
+        bool deduplicated = false;
+        FaviconStore::Digest digest = m_store.Put(uri, png, size, &deduplicated);
+        bool unchanged = hadIcon && previous == digest;
+        if (hadIcon && !unchanged)
+        {
+            m_counters.changedIcons++;
+        }
+        if (deduplicated && !unchanged)
+        {
+            m_counters.deduplicatedIcons++;
+        }
+        m_fetched[uri] = now;
+        if (auto image = FindInMemory(digest))
+        {
+            return image;
+        }
+        std::shared_ptr<Image> image = Decode(png, size);
+        if (image)
+        {
+            AddToMemory(digest, image);
+        }
+        return image;
+    }
+
+    Counters GetCounters() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_counters;
+    }
+
+private:
+    using LruList = std::list<std::pair<FaviconStore::Digest, std::shared_ptr<Image>>>;
+
+    std::shared_ptr<Image> FindInMemory(const FaviconStore::Digest& digest)
+    {
+        auto it = m_memory.find(digest);
+        if (it == m_memory.end())
+        {
+            return nullptr;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second;
+    }
+
+    void AddToMemory(const FaviconStore::Digest& digest, std::shared_ptr<Image> image)
+    {
+        m_lru.emplace_front(digest, std::move(image));
+        m_memory[digest] = m_lru.begin();
+        if (m_lru.size() > m_capacity)
+        {
+            m_memory.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    std::shared_ptr<Image> Decode(const uint8_t* png, size_t size)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Image> image = m_decode(png, size);
+        m_counters.decodes++;
+        m_counters.decodeMilliseconds += std::chrono::duration<double, std::milli>(
+                                             std::chrono::steady_clock::now() - start)
+                                             .count();
+        return image;
+    }
+
+    mutable std::mutex m_mutex;
+    FaviconStore m_store;
+    DecodeFunction m_decode;
+    size_t m_capacity;
+    Clock::duration m_revalidateInterval;
+    // When each URI's icon was last fetched in this run.
+    std::unordered_map<std::string, Clock::time_point> m_fetched;
+    LruList m_lru;
+    std::unordered_map<
+        FaviconStore::Digest, typename LruList::iterator, FaviconStore::DigestHash>
+        m_memory;
+    Counters m_counters;
+};
@@ -0,0 +1,241 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FaviconStore.h"
+
+#include <cstring>
+#include <unordered_set>
+
+namespace
+{
+// Favicons are small; anything larger is treated as corruption.
+constexpr uint32_t c_maxRecordField = 16 * 1024 * 1024;
+
+bool ReadUint32(std::istream& in, uint32_t* value)
+{
+    uint8_t bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+    {
+        return false;
+    }
+    *value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+    return true;
+}
+
+void WriteUint32(std::ostream& out, uint32_t value)
+{
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+// Writes a record and returns the offset of its PNG bytes from the start of
+// the record.
+uint64_t WriteRecord(
+    std::ostream& out, const std::string& uri, const FaviconStore::Digest& digest,
+    const uint8_t* png, uint32_t pngSize)
+{
+    WriteUint32(out, static_cast<uint32_t>(uri.size()));
+    out.write(uri.data(), uri.size());
+    out.write(reinterpret_cast<const char*>(digest.data()), digest.size());
+    WriteUint32(out, pngSize);
+    out.write(reinterpret_cast<const char*>(png), pngSize);
+    return 4 + uri.size() + digest.size() + 4;
+}
+} // namespace
+
+size_t FaviconStore::DigestHash::operator()(const Digest& digest) const
+{
+    size_t value;
+    memcpy(&value, digest.data(), sizeof(value));
+    return value;
+}
+
+FaviconStore::FaviconStore(const std::filesystem::path& path) : m_path(path)
+{
+    Load();
+}
+
+void FaviconStore::Load()
+{
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(m_path, error);
+    if (error)
+    {
+        fileSize = 0;
+    }
+
+    std::ifstream in(m_path, std::ios::binary);
+    uint64_t validSize = 0;
+    std::string uri;
+    while (in)
+    {
+        uint32_t uriSize = 0;
+        uint32_t pngSize = 0;
+        Digest digest;
+        if (!ReadUint32(in, &uriSize) || uriSize > c_maxRecordField)
+        {
+            break;
+        }
+        uri.resize(uriSize);
+        if (!in.read(&uri[0], uriSize) ||
+            !in.read(reinterpret_cast<char*>(digest.data()), digest.size()) ||
+            !ReadUint32(in, &pngSize))
+        {
+            break;
+        }
+        uint64_t pngOffset = static_cast<uint64_t>(in.tellg());
+        if (pngOffset + pngSize > fileSize || !in.seekg(pngSize, std::ios::cur))
+        {
+            break;
+        }
+        validSize = pngOffset + pngSize;
+        if (pngSize)
+        {
+            m_images[digest] = {pngOffset, pngSize};
+        }
+        m_uris[uri] = digest;
+    }
+    in.close();
+
+    if (fileSize != validSize)
+    {
+        // Drop a partly written record so new records follow the last good one.
+        std::filesystem::resize_file(m_path, validSize, error);
+    }
+    m_fileSize = validSize;
+
+    // The size of the pack with one record per URI and only the icons in use.
+    uint64_t liveSize = 0;
+    std::unordered_set<Digest, DigestHash> used;
+    for (const auto& [liveUri, digest] : m_uris)
+    {
+        liveSize += 4 + liveUri.size() + digest.size() + 4;
+        auto image = m_images.find(digest);
+        if (image != m_images.end() && used.insert(digest).second)
+        {
+            liveSize += image->second.size;
+        }
+    }
+    if (m_fileSize >= c_minCompactSize && m_fileSize > 2 * liveSize)
+    {
+        Compact();
+    }
+    m_file.open(m_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::app);
+}
+
+void FaviconStore::Compact()
+{
+    std::filesystem::path compactPath = m_path;
+    compactPath += ".compact";
+    std::ifstream in(m_path, std::ios::binary);
+    std::ofstream out(compactPath, std::ios::binary | std::ios::trunc);
+    std::unordered_map<std::string, Digest> uris;
+    std::unordered_map<Digest, ImageLocation, DigestHash> images;
+    uint64_t size = 0;
+    std::vector<uint8_t> png;
+    for (const auto& [uri, digest] : m_uris)
+    {
+        auto image = m_images.find(digest);
+        if (image == m_images.end())
+        {
+            continue;
+        }
+        bool haveContent = images.count(digest) != 0;
+        uint32_t pngSize = haveContent ? 0 : image->second.size;
+        png.resize(pngSize);
+        if (pngSize)
+        {
+            in.seekg(static_cast<std::streamoff>(image->second.offset));
+            in.read(reinterpret_cast<char*>(png.data()), pngSize);
+        }
+        uint64_t pngOffset = size + WriteRecord(out, uri, digest, png.data(), pngSize);
+        if (!haveContent)
+        {
+            images[digest] = {pngOffset, pngSize};
+        }
+        uris[uri] = digest;
+        size = pngOffset + pngSize;
+    }
+    out.close();
+    std::error_code error;
+    if (!in || !out)
+    {
+        std::filesystem::remove(compactPath, error);
+        return;
+    }
+    in.close();
+    std::filesystem::rename(compactPath, m_path, error);
+    if (error)
+    {
+        // Keep using the old pack; it is still complete.
+        std::filesystem::remove(compactPath, error);
+        return;
+    }
+    m_uris.swap(uris);
+    m_images.swap(images);
+    m_fileSize = size;
+}
+
+bool FaviconStore::Find(const std::string& uri, Digest* digest) const
+{
+    auto it = m_uris.find(uri);
+    if (it == m_uris.end() || !m_images.count(it->second))
+    {
+        return false;
+    }
+    *digest = it->second;
+    return true;
+}
+
+bool FaviconStore::ReadPng(const Digest& digest, std::vector<uint8_t>* png)
+{
+    auto it = m_images.find(digest);
+    if (it == m_images.end() || !m_file.is_open())
+    {
+        return false;
+    }
+    png->resize(it->second.size);
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(it->second.offset));
+    return static_cast<bool>(m_file.read(
+        reinterpret_cast<char*>(png->data()), static_cast<std::streamsize>(png->size())));
+}
+
+FaviconStore::Digest FaviconStore::Put(
+    const std::string& uri, const uint8_t* png, size_t size, bool* deduplicated)
+{
+    Digest digest = Sha256::Hash(png, size);
+    bool haveContent = m_images.count(digest) != 0;
+    if (deduplicated)
+    {
+        *deduplicated = haveContent;
+    }
+    auto existing = m_uris.find(uri);
+    if (existing != m_uris.end() && existing->second == digest)
+    {
+        return digest;
+    }
+    if (!m_file.is_open() || uri.size() > c_maxRecordField || size > c_maxRecordField)
+    {
+        return digest;
+    }
+
+    uint32_t pngSize = haveContent ? 0 : static_cast<uint32_t>(size);
+    m_file.clear();
+    uint64_t pngOffset = m_fileSize + WriteRecord(m_file, uri, digest, png, pngSize);
+    m_file.flush();
+    if (!m_file)
+    {
+        return digest;
+    }
+    m_fileSize = pngOffset + pngSize;
+    if (!haveContent)
+    {
+        m_images[digest] = {pngOffset, pngSize};
+    }
+    m_uris[uri] = digest;
+    return digest;
+}
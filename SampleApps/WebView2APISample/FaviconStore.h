@@ -0,0 +1,87 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Sha256.h"
+
+// FaviconStore keeps favicon PNGs on disk in a single append-only pack file.
+// Icons are stored once per distinct content, identified by the SHA-256 of
+// the PNG, so sites that share an icon share its bytes. The index from
+// favicon URI to content is rebuilt from the pack when the store is opened.
+// A URI whose icon changes gets a new record, so when most of the pack is
+// records that later ones superseded, it is rewritten with only the live ones
+// as it is opened.
+//
+// Each record is: URI length (u32), URI (UTF-8), content digest (32 bytes),
+// PNG length (u32), PNG bytes. The PNG length is 0 when the content is
+// already in the pack. A truncated last record, e.g. after a crash, is
+// ignored. Integers are little-endian.
+//
+// Not thread-safe. Has no dependency on Win32.
+class FaviconStore
+{
+public:
+    using Digest = Sha256::Digest;
+
+    struct DigestHash
+    {
+        size_t operator()(const Digest& digest) const;
+    };
+
+    // Packs smaller than this aren't worth compacting.
+    static constexpr uint64_t c_minCompactSize = 64 * 1024;
+
+    explicit FaviconStore(const std::filesystem::path& path);
+
+    // Looks up the content stored for `uri`.
+    bool Find(const std::string& uri, Digest* digest) const;
+    // Reads the PNG with the given digest. Returns false if it is not stored
+    // or cannot be read.
+    bool ReadPng(const Digest& digest, std::vector<uint8_t>* png);
+    // Records `png` as the icon of `uri` and returns its digest. The bytes are
+    // only written if no other URI has the same content. `*deduplicated` is
+    // set to true in that case.
+    Digest Put(
+        const std::string& uri, const uint8_t* png, size_t size, bool* deduplicated = nullptr);
+
+    size_t GetUriCount() const
+    {
+        return m_uris.size();
+    }
+    size_t GetImageCount() const
+    {
+        return m_images.size();
+    }
+    uint64_t GetFileSize() const
+    {
+        return m_fileSize;
+    }
+
+private:
+    struct ImageLocation
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    void Load();
+    // Rewrites the pack with one record per URI and drops the icons no URI
+    // uses. Call before m_file is opened.
+    void Compact();
+
+    std::filesystem::path m_path;
+    std::fstream m_file;
+    uint64_t m_fileSize = 0;
+    std::unordered_map<std::string, Digest> m_uris;
+    std::unordered_map<Digest, ImageLocation, DigestHash> m_images;
+};
@@ -7,6 +7,8 @@
 #include "FileComponent.h"
 
 #include "CheckFailure.h"
+#include <gdiplus.h>
+#include <iomanip>
 #include <shlwapi.h>
 #include <sstream>
 
@@ -41,6 +43,9 @@ bool FileComponent::HandleWindowMessage(
         case IDM_SAVE_SCREENSHOT:
             SaveScreenshot();
             return true;
+        case IDM_MONITOR_SCREENSHOTS:
+            ToggleScreenshotMonitor();
+            return true;
         case IDM_PRINT_TO_PDF_LANDSCAPE:
             m_enableLandscape = true;
         case IDM_PRINT_TO_PDF_PORTRAIT:
@@ -65,6 +70,11 @@ bool FileComponent::HandleWindowMessage(
         }
         }
     }
+    else if (message == WM_TIMER && wParam == c_monitorTimerId)
+    {
+        CaptureMonitorFrame();
+        return true;
+    }
     return false;
 }
 
@@ -95,6 +105,156 @@ void FileComponent::SaveScreenshot()
 }
 //! [CapturePreview]
 
+// Starts or stops capturing the WebView every c_monitorIntervalMs. Frames are
+// written to a Screenshots folder next to the executable, one subfolder per
+// window, but only when FrameDiffer finds a changed tile.
+void FileComponent::ToggleScreenshotMonitor()
+{
+    HWND mainWindow = m_appWindow->GetMainWindow();
+    if (m_monitoring)
+    {
+        KillTimer(mainWindow, c_monitorTimerId);
+        m_monitoring = false;
+
+        uint32_t captures = m_monitorCaptures;
+        std::wstringstream message;
+        message << m_monitorCaptures << L" frames captured, " << m_monitorFramesSaved
+                << L" saved, " << m_monitorCapturesSkipped
+                << L" skipped while a capture was pending.\r\n"
+                << std::fixed << std::setprecision(1) << L"Average capture: "
+                << (captures ? m_monitorTotalCaptureMs / captures : 0)
+                << L" ms\r\nAverage capture to hash: "
+                << (captures ? m_monitorTotalHashedMs / captures : 0)
+                << L" ms\r\nMax capture to hash: " << m_monitorMaxHashedMs << L" ms\r\n"
+                << L"Tile hashing: "
+                << (FrameDiffer::IsSimdAccelerated() ? L"SIMD" : L"scalar");
+        MessageBox(mainWindow, message.str().c_str(), L"Screenshot Monitor Stopped", MB_OK);
+        return;
+    }
+
+    if (!m_gdiplusToken)
+    {
+        Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+        Gdiplus::GdiplusStartup(&m_gdiplusToken, &gdiplusStartupInput, nullptr);
+    }
+    std::wstringstream folder;
+    folder << m_appWindow->GetLocalPath(L"Screenshots", false);
+    CreateDirectory(folder.str().c_str(), nullptr);
+    folder << L"\\Window_" << std::hex << reinterpret_cast<UINT_PTR>(mainWindow);
+    m_monitorFolder = folder.str();
+    CreateDirectory(m_monitorFolder.c_str(), nullptr);
+
+    m_frameDiffer.Reset();
+    m_monitorCaptures = 0;
+    m_monitorFramesSaved = 0;
+    m_monitorCapturesSkipped = 0;
+    m_monitorTotalCaptureMs = 0;
+    m_monitorTotalHashedMs = 0;
+    m_monitorMaxHashedMs = 0;
+    m_monitoring = true;
+    SetTimer(mainWindow, c_monitorTimerId, c_monitorIntervalMs, nullptr);
+    CaptureMonitorFrame();
+    MessageBox(
+        mainWindow, (L"Saving changed frames to " + m_monitorFolder).c_str(),
+        L"Screenshot Monitor Started", MB_OK);
+}
+
+// Captures into memory so the PNG is decoded once and only written to disk if
+// the frame changed.
+void FileComponent::CaptureMonitorFrame()
+{
+    if (m_monitorCaptureInProgress)
+    {
+        m_monitorCapturesSkipped++;
+        return;
+    }
+    wil::com_ptr<IStream> stream;
+    CHECK_FAILURE(CreateStreamOnHGlobal(nullptr, TRUE, &stream));
+    m_monitorCaptureInProgress = true;
+    auto captureStart = std::chrono::steady_clock::now();
+    CHECK_FAILURE(m_webView->CapturePreview(
+        COREWEBVIEW2_CAPTURE_PREVIEW_IMAGE_FORMAT_PNG, stream.get(),
+        Callback<ICoreWebView2CapturePreviewCompletedHandler>(
+            [this, stream, captureStart](HRESULT errorCode) -> HRESULT
+            {
+                m_monitorCaptureInProgress = false;
+                if (SUCCEEDED(errorCode) && m_monitoring)
+                {
+                    OnMonitorFrameCaptured(stream.get(), captureStart);
+                }
+                return S_OK;
+            })
+            .Get()));
+}
+
+void FileComponent::OnMonitorFrameCaptured(
+    IStream* stream, std::chrono::steady_clock::time_point captureStart)
+{
+    auto decodeStart = std::chrono::steady_clock::now();
+    FrameDiffer::Diff diff;
+    std::chrono::steady_clock::time_point hashStart;
+    {
+        CHECK_FAILURE(stream->Seek({}, STREAM_SEEK_SET, nullptr));
+        Gdiplus::Bitmap bitmap(stream);
+        Gdiplus::Rect rect(0, 0, bitmap.GetWidth(), bitmap.GetHeight());
+        Gdiplus::BitmapData pixels;
+        if (bitmap.GetLastStatus() != Gdiplus::Ok ||
+            bitmap.LockBits(
+                &rect, Gdiplus::ImageLockModeRead, PixelFormat32bppARGB, &pixels) !=
+                Gdiplus::Ok)
+        {
+            return;
+        }
+        hashStart = std::chrono::steady_clock::now();
+        FrameDiffer::Frame frame;
+        frame.pixels = static_cast<const uint8_t*>(pixels.Scan0);
+        frame.width = pixels.Width;
+        frame.height = pixels.Height;
+        frame.stride = pixels.Stride;
+        diff = m_frameDiffer.Update(frame);
+        bitmap.UnlockBits(&pixels);
+    }
+    auto hashEnd = std::chrono::steady_clock::now();
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    double captureMs = Milliseconds(decodeStart - captureStart).count();
+    double decodeMs = Milliseconds(hashStart - decodeStart).count();
+    double hashMs = Milliseconds(hashEnd - hashStart).count();
+    double hashedMs = Milliseconds(hashEnd - captureStart).count();
+
+    m_monitorCaptures++;
+    m_monitorTotalCaptureMs += captureMs;
+    m_monitorTotalHashedMs += hashedMs;
+    m_monitorMaxHashedMs = (std::max)(m_monitorMaxHashedMs, hashedMs);
+
+    std::wstringstream message;
+    message << L"Screenshot monitor: frame " << m_monitorCaptures << L", "
+            << diff.changedTiles.size() << L"/" << diff.tilesX * diff.tilesY
+            << L" tiles changed, capture " << std::fixed << std::setprecision(1) << captureMs
+            << L" ms, decode " << decodeMs << L" ms, hash " << hashMs << L" ms";
+    if (diff.HasChanges())
+    {
+        // The PNG is already in memory; copy it out as is.
+        std::wstringstream path;
+        path << m_monitorFolder << L"\\" << std::setw(6) << std::setfill(L'0')
+             << m_monitorCaptures << L".png";
+        wil::com_ptr<IStream> file;
+        ULARGE_INTEGER size = {};
+        size.QuadPart = ULLONG_MAX;
+        if (SUCCEEDED(SHCreateStreamOnFileEx(
+                path.str().c_str(), STGM_WRITE | STGM_CREATE, FILE_ATTRIBUTE_NORMAL, TRUE,
+                nullptr, &file)) &&
+            SUCCEEDED(stream->Seek({}, STREAM_SEEK_SET, nullptr)) &&
+            SUCCEEDED(stream->CopyTo(file.get(), size, nullptr, nullptr)))
+        {
+            m_monitorFramesSaved++;
+            message << L", saved, changed region " << diff.left << L"," << diff.top << L" - "
+                    << diff.right << L"," << diff.bottom;
+        }
+    }
+    message << L"\n";
+    OutputDebugString(message.str().c_str());
+}
+
 //! [PrintToPdf]
 // Shows the user a file selection dialog, then uses the selected path when
 // printing to PDF. If `enableLandscape` is true, the page is printed
@@ -163,4 +323,12 @@ OPENFILENAME FileComponent::CreateOpenFileName(LPWSTR defaultName, LPCWSTR filte
 FileComponent::~FileComponent()
 {
     m_webView->remove_DocumentTitleChanged(m_documentTitleChangedToken);
+    if (m_monitoring)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_monitorTimerId);
+    }
+    if (m_gdiplusToken)
+    {
+        Gdiplus::GdiplusShutdown(m_gdiplusToken);
+    }
 }
@@ -8,10 +8,14 @@
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "FrameDiffer.h"
+#include <chrono>
 #include <commdlg.h>
 
 // This component handles commands from the File menu, except for Exit.
 // It also handles the DocumentTitleChanged event.
+// "Monitor Screenshots" captures the WebView periodically and keeps only the
+// frames in which some part of the page changed, see FrameDiffer.
 class FileComponent : public ComponentBase
 {
 public:
@@ -25,6 +29,7 @@ public:
         LRESULT* result) override;
 
     void SaveScreenshot();
+    void ToggleScreenshotMonitor();
     void PrintToPdf(bool enableLandscape);
     bool IsPrintToPdfInProgress();
 
@@ -32,6 +37,9 @@ public:
 
 private:
     OPENFILENAME CreateOpenFileName(LPWSTR defaultName, LPCWSTR filter);
+    void CaptureMonitorFrame();
+    void OnMonitorFrameCaptured(
+        IStream* stream, std::chrono::steady_clock::time_point captureStart);
 
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
@@ -39,5 +47,21 @@ private:
     bool m_enableLandscape = false;
 
     EventRegistrationToken m_documentTitleChangedToken = {};
+
+    static constexpr UINT_PTR c_monitorTimerId = 0x5343;
+    static constexpr UINT c_monitorIntervalMs = 2000;
+
+    bool m_monitoring = false;
+    bool m_monitorCaptureInProgress = false;
+    ULONG_PTR m_gdiplusToken = 0;
+    std::wstring m_monitorFolder;
+    FrameDiffer m_frameDiffer;
+    // Since monitoring started. Latencies are from the CapturePreview call.
+    uint32_t m_monitorCaptures = 0;
+    uint32_t m_monitorFramesSaved = 0;
+    uint32_t m_monitorCapturesSkipped = 0;
+    double m_monitorTotalCaptureMs = 0;
+    double m_monitorTotalHashedMs = 0;
+    double m_monitorMaxHashedMs = 0;
 };
 
@@ -0,0 +1,368 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FolderCleaner.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace fs = std::filesystem;
+
+FolderCleaner::FolderCleaner(size_t threadCount, std::chrono::milliseconds progressInterval)
+    : m_threadCount(threadCount), m_progressInterval(progressInterval)
+{
+    if (m_threadCount == 0)
+    {
+        // Deleting is bound by the file system rather than the processors, but
+        // more threads than this mostly contend on the same directories.
+        m_threadCount = (std::min)((std::max)(std::thread::hardware_concurrency(), 2u), 8u);
+    }
+}
+
+FolderCleaner::~FolderCleaner()
+{
+    Cancel();
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    if (m_job.joinable())
+    {
+        m_job.join();
+    }
+}
+
+bool FolderCleaner::StartDelete(
+    const fs::path& folder, bool moveAside, ProgressCallback onProgress)
+{
+    if (IsBusy())
+    {
+        return false;
+    }
+    // Renamed here rather than on the job, so that the path is free by the
+    // time this returns. Should another thread start a job meanwhile, the
+    // renamed folder is left for the next StartDelete to find.
+    std::vector<fs::path> folders = FindMovedAside(folder);
+    fs::path movedAside = moveAside ? MoveAside(folder) : fs::path();
+    folders.push_back(movedAside.empty() ? folder : movedAside);
+    return StartJob(
+        [this, folders = std::move(folders), onProgress = std::move(onProgress)]
+        { DeleteTrees(folders, onProgress); });
+}
+
+bool FolderCleaner::StartMeasure(const fs::path& folder, size_t maxDepth, SizesCallback onDone)
+{
+    return StartJob(
+        [this, folder, maxDepth, onDone = std::move(onDone)]
+        {
+            std::vector<FolderSize> sizes = MeasureTree(folder, maxDepth);
+            if (onDone)
+            {
+                onDone(sizes);
+            }
+        });
+}
+
+bool FolderCleaner::StartJob(std::function<void()> job)
+{
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    if (m_busy)
+    {
+        return false;
+    }
+    if (m_job.joinable())
+    {
+        m_job.join();
+    }
+    m_cancel = false;
+    m_busy = true;
+    m_job = std::thread(
+        [this, job = std::move(job)]
+        {
+            job();
+            m_busy = false;
+        });
+    return true;
+}
+
+bool FolderCleaner::IsBusy() const
+{
+    return m_busy;
+}
+
+void FolderCleaner::Cancel()
+{
+    m_cancel = true;
+}
+
+FolderCleaner::Progress FolderCleaner::DeleteTree(
+    const fs::path& folder, const ProgressCallback& onProgress)
+{
+    return DeleteTrees({folder}, onProgress);
+}
+
+FolderCleaner::Progress FolderCleaner::DeleteTrees(
+    const std::vector<fs::path>& folders, const ProgressCallback& onProgress)
+{
+    ResetCounters();
+    for (const fs::path& folder : folders)
+    {
+        std::error_code error;
+        if (m_cancel || !fs::exists(fs::symlink_status(folder, error)))
+        {
+            continue;
+        }
+        std::vector<Directory> directories = Walk(folder, true, onProgress);
+        if (m_cancel)
+        {
+            break;
+        }
+        // Children before their parents, so that each directory is empty by
+        // the time it is removed.
+        std::sort(
+            directories.begin(), directories.end(),
+            [](const Directory& a, const Directory& b) { return a.depth > b.depth; });
+        for (const Directory& directory : directories)
+        {
+            if (RemoveEntry(directory.path))
+            {
+                m_directories++;
+            }
+            else
+            {
+                m_failures++;
+            }
+        }
+    }
+    Progress progress = GetProgress();
+    progress.done = true;
+    progress.cancelled = m_cancel;
+    if (onProgress)
+    {
+        onProgress(progress);
+    }
+    return progress;
+}
+
+std::vector<FolderCleaner::FolderSize> FolderCleaner::MeasureTree(
+    const fs::path& folder, size_t maxDepth)
+{
+    ResetCounters();
+    std::vector<Directory> directories = Walk(folder, false, nullptr);
+
+    // Adds each directory's own files to itself and its ancestors, down to
+    // `maxDepth`.
+    std::map<fs::path, FolderSize> sizes;
+    for (const Directory& directory : directories)
+    {
+        fs::path prefix;
+        size_t depth = 0;
+        auto component = directory.relative.begin();
+        while (true)
+        {
+            FolderSize& size = sizes[prefix];
+            size.path = prefix;
+            size.depth = depth;
+            size.files += directory.files;
+            size.bytes += directory.bytes;
+            if (depth == maxDepth || component == directory.relative.end())
+            {
+                break;
+            }
+            prefix /= *component++;
+            depth++;
+        }
+    }
+    std::vector<FolderSize> result;
+    result.reserve(sizes.size());
+    for (auto& entry : sizes)
+    {
+        result.push_back(std::move(entry.second));
+    }
+    return result;
+}
+
+std::vector<FolderCleaner::Directory> FolderCleaner::Walk(
+    const fs::path& root, bool removeFiles, const ProgressCallback& onProgress)
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Directory> pending;
+    std::vector<Directory> visited;
+    size_t busy = 0;
+    pending.push_back({root, fs::path(), 0});
+    // Done when no directory is queued or being listed, which can add more.
+    auto isDone = [&] { return m_cancel || (pending.empty() && busy == 0); };
+
+    auto worker = [&]
+    {
+        std::vector<Directory> subdirectories;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            condition.wait(lock, [&] { return !pending.empty() || isDone(); });
+            if (isDone())
+            {
+                condition.notify_all();
+                return;
+            }
+            Directory directory = std::move(pending.front());
+            pending.pop_front();
+            busy++;
+            lock.unlock();
+
+            subdirectories.clear();
+            ScanDirectory(directory, removeFiles, &subdirectories);
+
+            lock.lock();
+            for (Directory& subdirectory : subdirectories)
+            {
+                pending.push_back(std::move(subdirectory));
+            }
+            visited.push_back(std::move(directory));
+            busy--;
+            condition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < m_threadCount; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!condition.wait_for(lock, m_progressInterval, isDone))
+        {
+            if (onProgress)
+            {
+                lock.unlock();
+                onProgress(GetProgress());
+                lock.lock();
+            }
+        }
+    }
+    condition.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    return visited;
+}
+
+void FolderCleaner::ScanDirectory(
+    Directory& directory, bool removeFiles, std::vector<Directory>* subdirectories)
+{
+    std::error_code error;
+    fs::directory_iterator it(directory.path, error);
+    for (; !error && it != fs::directory_iterator(); it.increment(error))
+    {
+        if (m_cancel)
+        {
+            return;
+        }
+        const fs::directory_entry& entry = *it;
+        std::error_code statusError;
+        // Links and junctions are removed, not followed.
+        fs::file_status status = entry.symlink_status(statusError);
+        if (fs::is_directory(status))
+        {
+            subdirectories->push_back(
+                {entry.path(), directory.relative / entry.path().filename(),
+                 directory.depth + 1});
+            continue;
+        }
+        uint64_t size = fs::is_regular_file(status) ? entry.file_size(statusError) : 0;
+        if (statusError)
+        {
+            size = 0;
+        }
+        if (removeFiles && !RemoveEntry(entry.path()))
+        {
+            m_failures++;
+            continue;
+        }
+        directory.files++;
+        directory.bytes += size;
+        m_files++;
+        m_bytes += size;
+    }
+    if (error)
+    {
+        m_failures++;
+    }
+    if (!removeFiles)
+    {
+        m_directories++;
+    }
+}
+
+bool FolderCleaner::RemoveEntry(const fs::path& path)
+{
+    std::error_code error;
+    if (fs::remove(path, error))
+    {
+        return true;
+    }
+    // Read-only entries cannot be removed on Windows until they are writable.
+    fs::permissions(path, fs::perms::owner_write, fs::perm_options::add, error);
+    return fs::remove(path, error);
+}
+
+void FolderCleaner::ResetCounters()
+{
+    m_files = 0;
+    m_directories = 0;
+    m_bytes = 0;
+    m_failures = 0;
+    m_start = std::chrono::steady_clock::now();
+}
+
+FolderCleaner::Progress FolderCleaner::GetProgress() const
+{
+    Progress progress;
+    progress.files = m_files;
+    progress.directories = m_directories;
+    progress.bytes = m_bytes;
+    progress.failures = m_failures;
+    progress.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    return progress;
+}
+
+fs::path FolderCleaner::MoveAside(const fs::path& folder)
+{
+    for (int i = 1; i < 1000; i++)
+    {
+        fs::path sibling = folder;
+        sibling += ".deleting." + std::to_string(i);
+        std::error_code error;
+        if (fs::exists(fs::symlink_status(sibling, error)))
+        {
+            continue;
+        }
+        fs::rename(folder, sibling, error);
+        return error ? fs::path() : sibling;
+    }
+    return fs::path();
+}
+
+std::vector<fs::path> FolderCleaner::FindMovedAside(const fs::path& folder)
+{
+    std::vector<fs::path> found;
+    fs::path::string_type prefix = folder.filename().native();
+    prefix += fs::path(".deleting.").native();
+    fs::path parent = folder.parent_path();
+    std::error_code error;
+    fs::directory_iterator it(parent.empty() ? fs::path(".") : parent, error);
+    for (; !error && it != fs::directory_iterator(); it.increment(error))
+    {
+        fs::path::string_type name = it->path().filename().native();
+        if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0)
+        {
+            found.push_back(it->path());
+        }
+    }
+    return found;
+}
@@ -0,0 +1,133 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// FolderCleaner deletes or measures large folder trees, such as user data
+// folders, on background threads.
+//
+// The tree is walked by a pool of threads that share a queue of directories:
+// each thread lists one directory at a time, deleting or counting its files
+// and queueing its subdirectories. Deleting removes the emptied directories
+// deepest first once the walk is done.
+//
+// StartDelete can first rename the folder to a sibling, so that the original
+// path is free at once and the deletion only has to finish eventually.
+// Folders left over from earlier runs, e.g. if the app exited meanwhile, are
+// deleted along with it.
+//
+// One job runs at a time. Callbacks are called on the job's thread; callers
+// that need to touch UI should marshal them to their own thread, e.g. with
+// AppWindow::RunAsync. Destroying the cleaner cancels the job and waits for
+// it. Has no dependency on Win32.
+class FolderCleaner
+{
+public:
+    struct Progress
+    {
+        uint64_t files = 0;
+        uint64_t directories = 0;
+        uint64_t bytes = 0;
+        // Entries that could not be listed or deleted.
+        uint64_t failures = 0;
+        double seconds = 0;
+        bool done = false;
+        bool cancelled = false;
+    };
+
+    struct FolderSize
+    {
+        // Relative to the measured folder, which is the empty path.
+        std::filesystem::path path;
+        size_t depth = 0;
+        // Including subfolders.
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+    };
+
+    using ProgressCallback = std::function<void(const Progress&)>;
+    using SizesCallback = std::function<void(const std::vector<FolderSize>&)>;
+
+    // A `threadCount` of 0 picks one from the number of processors.
+    explicit FolderCleaner(
+        size_t threadCount = 0,
+        std::chrono::milliseconds progressInterval = std::chrono::milliseconds(250));
+    ~FolderCleaner();
+
+    // Deletes `folder` in the background. If `moveAside` is set, it is first
+    // renamed aside on the calling thread, so that its path is free when this
+    // returns. `onProgress` is called periodically and once more with
+    // Progress::done set. Returns false if a job is running.
+    bool StartDelete(
+        const std::filesystem::path& folder, bool moveAside, ProgressCallback onProgress);
+    // Measures `folder` and its subfolders up to `maxDepth` levels down, in
+    // the background. Returns false if a job is running.
+    bool StartMeasure(
+        const std::filesystem::path& folder, size_t maxDepth, SizesCallback onDone);
+    bool IsBusy() const;
+    void Cancel();
+
+    // Blocking versions of the jobs, run on the calling thread and the pool.
+    Progress DeleteTree(
+        const std::filesystem::path& folder, const ProgressCallback& onProgress);
+    // Sorted by path, so that each folder is followed by its subfolders.
+    std::vector<FolderSize> MeasureTree(const std::filesystem::path& folder, size_t maxDepth);
+
+    // Renames `folder` to an unused "<name>.deleting.<n>" sibling and returns
+    // the new path, or returns an empty path if it cannot be renamed.
+    static std::filesystem::path MoveAside(const std::filesystem::path& folder);
+    // Returns the siblings that MoveAside made of `folder`.
+    static std::vector<std::filesystem::path> FindMovedAside(
+        const std::filesystem::path& folder);
+
+private:
+    struct Directory
+    {
+        std::filesystem::path path;
+        std::filesystem::path relative;
+        size_t depth = 0;
+        // Files directly in the directory.
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Walks the tree on the pool and returns every directory in it, reporting
+    // progress from the calling thread. Deletes the files if `removeFiles`.
+    std::vector<Directory> Walk(
+        const std::filesystem::path& root,
+        bool removeFiles,
+        const ProgressCallback& onProgress);
+    void ScanDirectory(
+        Directory& directory, bool removeFiles, std::vector<Directory>* subdirectories);
+    Progress DeleteTrees(
+        const std::vector<std::filesystem::path>& folders, const ProgressCallback& onProgress);
+    bool RemoveEntry(const std::filesystem::path& path);
+    void ResetCounters();
+    Progress GetProgress() const;
+    bool StartJob(std::function<void()> job);
+
+    size_t m_threadCount;
+    std::chrono::milliseconds m_progressInterval;
+
+    std::atomic<bool> m_cancel{false};
+    std::atomic<uint64_t> m_files{0};
+    std::atomic<uint64_t> m_directories{0};
+    std::atomic<uint64_t> m_bytes{0};
+    std::atomic<uint64_t> m_failures{0};
+    std::chrono::steady_clock::time_point m_start;
+
+    mutable std::mutex m_jobMutex;
+    std::thread m_job;
+    std::atomic<bool> m_busy{false};
+};
@@ -0,0 +1,242 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FrameDiffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRAME_DIFFER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr uint32_t c_bytesPerPixel = 4;
+constexpr uint32_t c_blockSize = 16;
+constexpr uint32_t c_blocksPerRow = FrameDiffer::c_tileSize * c_bytesPerPixel / c_blockSize;
+constexpr uint64_t c_rowPrime = 0x9E3779B97F4A7C15ull;
+
+constexpr uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Two 64-bit keys per 16-byte block of a tile row.
+constexpr std::array<uint64_t, c_blocksPerRow * 2> MakeKeys()
+{
+    std::array<uint64_t, c_blocksPerRow * 2> keys = {};
+    uint64_t state = 0x5C4E3A2B1D0F9687ull;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        keys[i] = SplitMix64(state);
+    }
+    return keys;
+}
+
+constexpr std::array<uint64_t, c_blocksPerRow * 2> c_keys = MakeKeys();
+
+uint64_t Avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// Mixes one 16-byte block into the two accumulator lanes: each lane adds the
+// product of the halves of (data ^ key) plus the other lane's raw data, so
+// every input bit reaches the result even when the key cancels it out.
+inline void AccumulateScalar(
+    uint64_t acc[2], const uint8_t* block, const uint64_t* key, uint64_t rowKey)
+{
+    uint64_t data[2];
+    memcpy(data, block, sizeof(data));
+    for (int lane = 0; lane < 2; lane++)
+    {
+        uint64_t keyed = data[lane] ^ (key[lane] + rowKey);
+        acc[lane] += (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+        acc[lane] += data[lane ^ 1];
+    }
+}
+
+uint64_t HashTileScalar(const uint8_t* origin, size_t stride, uint32_t width, uint32_t height)
+{
+    uint64_t acc[2] = {0, 0};
+    uint32_t rowBytes = width * c_bytesPerPixel;
+    uint32_t fullBlocks = rowBytes / c_blockSize;
+    uint32_t tailBytes = rowBytes % c_blockSize;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = origin + y * stride;
+        uint64_t rowKey = y * c_rowPrime;
+        for (uint32_t b = 0; b < fullBlocks; b++)
+        {
+            AccumulateScalar(acc, row + b * c_blockSize, &c_keys[b * 2], rowKey);
+        }
+        if (tailBytes)
+        {
+            uint8_t padded[c_blockSize] = {};
+            memcpy(padded, row + fullBlocks * c_blockSize, tailBytes);
+            AccumulateScalar(acc, padded, &c_keys[fullBlocks * 2], rowKey);
+        }
+    }
+    return Avalanche(acc[0] ^ Avalanche(acc[1] + (uint64_t(width) << 32 | height)));
+}
+
+#ifdef FRAME_DIFFER_SSE2
+// Same as AccumulateScalar, two lanes at a time.
+inline __m128i AccumulateSse2(__m128i acc, __m128i data, __m128i key)
+{
+    __m128i keyed = _mm_xor_si128(data, key);
+    __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+    __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_add_epi64(acc, _mm_add_epi64(product, swapped));
+}
+
+uint64_t HashTileSse2(const uint8_t* origin, size_t stride, uint32_t width, uint32_t height)
+{
+    __m128i keys[c_blocksPerRow];
+    for (uint32_t b = 0; b < c_blocksPerRow; b++)
+    {
+        keys[b] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&c_keys[b * 2]));
+    }
+    __m128i acc = _mm_setzero_si128();
+    uint32_t rowBytes = width * c_bytesPerPixel;
+    uint32_t fullBlocks = rowBytes / c_blockSize;
+    uint32_t tailBytes = rowBytes % c_blockSize;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = origin + y * stride;
+        uint64_t rowKeyScalar = y * c_rowPrime;
+        __m128i rowKey = _mm_set_epi64x(
+            static_cast<long long>(rowKeyScalar), static_cast<long long>(rowKeyScalar));
+        uint32_t b = 0;
+        // Full 64 pixel rows are the common case; unrolling by four keeps
+        // the loads ahead of the multiplies.
+        for (; b + 4 <= fullBlocks; b += 4)
+        {
+            const __m128i* p = reinterpret_cast<const __m128i*>(row + b * c_blockSize);
+            acc = AccumulateSse2(
+                acc, _mm_loadu_si128(p), _mm_add_epi64(keys[b], rowKey));
+            acc = AccumulateSse2(
+                acc, _mm_loadu_si128(p + 1), _mm_add_epi64(keys[b + 1], rowKey));
+            acc = AccumulateSse2(
+                acc, _mm_loadu_si128(p + 2), _mm_add_epi64(keys[b + 2], rowKey));
+            acc = AccumulateSse2(
+                acc, _mm_loadu_si128(p + 3), _mm_add_epi64(keys[b + 3], rowKey));
+        }
+        for (; b < fullBlocks; b++)
+        {
+            const __m128i* p = reinterpret_cast<const __m128i*>(row + b * c_blockSize);
+            acc = AccumulateSse2(acc, _mm_loadu_si128(p), _mm_add_epi64(keys[b], rowKey));
+        }
+        if (tailBytes)
+        {
+            alignas(16) uint8_t padded[c_blockSize] = {};
+            memcpy(padded, row + fullBlocks * c_blockSize, tailBytes);
+            acc = AccumulateSse2(
+                acc, _mm_load_si128(reinterpret_cast<const __m128i*>(padded)),
+                _mm_add_epi64(keys[fullBlocks], rowKey));
+        }
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return Avalanche(lanes[0] ^ Avalanche(lanes[1] + (uint64_t(width) << 32 | height)));
+}
+#endif
+
+uint64_t HashTile(
+    const uint8_t* origin, size_t stride, uint32_t width, uint32_t height, bool useSimd)
+{
+#ifdef FRAME_DIFFER_SSE2
+    if (useSimd)
+    {
+        return HashTileSse2(origin, stride, width, height);
+    }
+#else
+    (void)useSimd;
+#endif
+    return HashTileScalar(origin, stride, width, height);
+}
+} // namespace
+
+bool FrameDiffer::IsSimdAccelerated()
+{
+#ifdef FRAME_DIFFER_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FrameDiffer::HashTiles(const Frame& frame, std::vector<uint64_t>* hashes, bool useSimd)
+{
+    uint32_t tilesX = (frame.width + c_tileSize - 1) / c_tileSize;
+    uint32_t tilesY = (frame.height + c_tileSize - 1) / c_tileSize;
+    hashes->resize(size_t(tilesX) * tilesY);
+    for (uint32_t ty = 0; ty < tilesY; ty++)
+    {
+        uint32_t top = ty * c_tileSize;
+        uint32_t height = std::min(c_tileSize, frame.height - top);
+        for (uint32_t tx = 0; tx < tilesX; tx++)
+        {
+            uint32_t left = tx * c_tileSize;
+            uint32_t width = std::min(c_tileSize, frame.width - left);
+            const uint8_t* origin = frame.pixels + top * frame.stride + left * c_bytesPerPixel;
+            (*hashes)[size_t(ty) * tilesX + tx] =
+                HashTile(origin, frame.stride, width, height, useSimd);
+        }
+    }
+}
+
+FrameDiffer::Diff FrameDiffer::Update(const Frame& frame)
+{
+    Diff diff;
+    diff.tilesX = (frame.width + c_tileSize - 1) / c_tileSize;
+    diff.tilesY = (frame.height + c_tileSize - 1) / c_tileSize;
+    HashTiles(frame, &m_currentHashes);
+
+    bool sameSize = frame.width == m_previousWidth && frame.height == m_previousHeight &&
+                    m_previousHashes.size() == m_currentHashes.size();
+    uint32_t minX = UINT32_MAX, minY = UINT32_MAX, maxX = 0, maxY = 0;
+    for (uint32_t i = 0; i < m_currentHashes.size(); i++)
+    {
+        if (sameSize && m_currentHashes[i] == m_previousHashes[i])
+        {
+            continue;
+        }
+        diff.changedTiles.push_back(i);
+        uint32_t tx = i % diff.tilesX;
+        uint32_t ty = i / diff.tilesX;
+        minX = std::min(minX, tx);
+        minY = std::min(minY, ty);
+        maxX = std::max(maxX, tx);
+        maxY = std::max(maxY, ty);
+    }
+    if (diff.HasChanges())
+    {
+        diff.left = minX * c_tileSize;
+        diff.top = minY * c_tileSize;
+        diff.right = std::min(frame.width, (maxX + 1) * c_tileSize);
+        diff.bottom = std::min(frame.height, (maxY + 1) * c_tileSize);
+    }
+
+    m_previousHashes.swap(m_currentHashes);
+    m_previousWidth = frame.width;
+    m_previousHeight = frame.height;
+    return diff;
+}
+
+void FrameDiffer::Reset()
+{
+    m_previousHashes.clear();
+    m_previousWidth = 0;
+    m_previousHeight = 0;
+}
@@ -0,0 +1,70 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// FrameDiffer detects which parts of a sequence of screenshots changed. Each
+// frame is split into square tiles and every tile is reduced to a 64-bit hash,
+// so only the hashes of the previous frame are kept rather than its pixels.
+//
+// Hashing uses SSE2 on x86 and x64 and an equivalent scalar loop elsewhere;
+// both produce the same hashes. Has no dependency on Win32 so it can be built
+// and measured on any platform.
+class FrameDiffer
+{
+public:
+    static constexpr uint32_t c_tileSize = 64;
+
+    // 32 bits per pixel, rows `stride` bytes apart.
+    struct Frame
+    {
+        const uint8_t* pixels = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t stride = 0;
+    };
+
+    struct Diff
+    {
+        uint32_t tilesX = 0;
+        uint32_t tilesY = 0;
+        // Row-major indices of tiles whose hash changed.
+        std::vector<uint32_t> changedTiles;
+        // Pixel bounds of the changed tiles, right and bottom exclusive. Empty
+        // if nothing changed.
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t right = 0;
+        uint32_t bottom = 0;
+
+        bool HasChanges() const
+        {
+            return !changedTiles.empty();
+        }
+    };
+
+    // Hashes `frame` and compares it with the previous frame. The first frame,
+    // and any frame whose size differs from the previous one, is reported as
+    // entirely changed.
+    Diff Update(const Frame& frame);
+
+    // Forgets the previous frame.
+    void Reset();
+
+    // Hashes every tile of `frame` into `hashes`, row-major. `useSimd` false
+    // forces the scalar loop, so the two can be compared.
+    static void HashTiles(
+        const Frame& frame, std::vector<uint64_t>* hashes, bool useSimd = true);
+    static bool IsSimdAccelerated();
+
+private:
+    std::vector<uint64_t> m_previousHashes;
+    std::vector<uint64_t> m_currentHashes;
+    uint32_t m_previousWidth = 0;
+    uint32_t m_previousHeight = 0;
+};
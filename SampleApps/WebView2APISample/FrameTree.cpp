@@ -0,0 +1,302 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FrameTree.h"
+
+void FrameTree::Insert(uint32_t id, uint32_t parentId)
+{
+    if (id == c_noFrame || id == parentId)
+    {
+        return;
+    }
+    auto inserted = m_frames.try_emplace(id);
+    Node& node = inserted.first->second;
+    node.snapshot = m_snapshot;
+    if (!inserted.second)
+    {
+        // A frame keeps its parent for its life, so this is rare, and the walk
+        // up from the new parent is only paid here.
+        if (node.frame.parentId == parentId || IsAncestor(id, parentId))
+        {
+            return;
+        }
+        Unlink(&node);
+    }
+    node.frame.id = id;
+    node.frame.parentId = parentId;
+    Link(&node);
+    UpdateDescendants(node);
+}
+
+void FrameTree::SetProcess(uint32_t id, int32_t processId)
+{
+    auto node = m_frames.find(id);
+    if (node == m_frames.end() || node->second.frame.processId == processId)
+    {
+        return;
+    }
+    RemoveFromProcess(&node->second);
+    node->second.frame.processId = processId;
+    AddToProcess(&node->second);
+}
+
+void FrameTree::SetDetails(uint32_t id, int32_t kind, std::string name, std::string source)
+{
+    auto node = m_frames.find(id);
+    if (node != m_frames.end())
+    {
+        Frame& frame = node->second.frame;
+        frame.kind = kind;
+        frame.name = std::move(name);
+        frame.source = std::move(source);
+    }
+}
+
+void FrameTree::Remove(uint32_t id)
+{
+    auto root = m_frames.find(id);
+    if (root == m_frames.end())
+    {
+        return;
+    }
+    Unlink(&root->second);
+    std::vector<uint32_t> pending = {id};
+    while (!pending.empty())
+    {
+        uint32_t frameId = pending.back();
+        pending.pop_back();
+        auto children = m_children.find(frameId);
+        if (children != m_children.end())
+        {
+            pending.insert(pending.end(), children->second.begin(), children->second.end());
+            m_children.erase(children);
+        }
+        auto node = m_frames.find(frameId);
+        RemoveFromProcess(&node->second);
+        m_frames.erase(node);
+    }
+}
+
+void FrameTree::RemoveProcess(int32_t processId)
+{
+    auto frames = m_processFrames.find(processId);
+    if (frames == m_processFrames.end())
+    {
+        return;
+    }
+    // Removing a frame also removes the frames under it, which may be in this
+    // process as well.
+    std::vector<uint32_t> ids = frames->second;
+    for (uint32_t id : ids)
+    {
+        Remove(id);
+    }
+}
+
+void FrameTree::BeginSnapshot()
+{
+    m_snapshot++;
+}
+
+void FrameTree::EndSnapshot()
+{
+    std::vector<uint32_t> stale;
+    for (const auto& entry : m_frames)
+    {
+        if (entry.second.snapshot != m_snapshot)
+        {
+            stale.push_back(entry.first);
+        }
+    }
+    for (uint32_t id : stale)
+    {
+        Remove(id);
+    }
+}
+
+bool FrameTree::IsInSnapshot(uint32_t id) const
+{
+    auto node = m_frames.find(id);
+    return node != m_frames.end() && node->second.snapshot == m_snapshot;
+}
+
+const FrameTree::Frame* FrameTree::Find(uint32_t id) const
+{
+    auto node = m_frames.find(id);
+    return node == m_frames.end() ? nullptr : &node->second.frame;
+}
+
+const std::vector<uint32_t>& FrameTree::GetProcessFrames(int32_t processId) const
+{
+    static const std::vector<uint32_t> s_noFrames;
+    auto frames = m_processFrames.find(processId);
+    return frames == m_processFrames.end() ? s_noFrames : frames->second;
+}
+
+std::vector<int32_t> FrameTree::GetProcessIds() const
+{
+    std::vector<int32_t> processIds;
+    processIds.reserve(m_processFrames.size());
+    for (const auto& entry : m_processFrames)
+    {
+        processIds.push_back(entry.first);
+    }
+    return processIds;
+}
+
+std::vector<int32_t> FrameTree::GetMainFrameProcessIds(uint32_t mainFrameId) const
+{
+    std::vector<int32_t> processIds;
+    if (mainFrameId == c_noFrame)
+    {
+        return processIds;
+    }
+    for (const auto& entry : m_processFrames)
+    {
+        for (uint32_t id : entry.second)
+        {
+            if (m_frames.find(id)->second.frame.mainFrameId == mainFrameId)
+            {
+                processIds.push_back(entry.first);
+                break;
+            }
+        }
+    }
+    return processIds;
+}
+
+void FrameTree::SetAncestors(Frame* frame) const
+{
+    frame->mainFrameId = c_noFrame;
+    frame->firstLevelFrameId = c_noFrame;
+    frame->depth = 0;
+    if (frame->parentId == c_noFrame)
+    {
+        frame->mainFrameId = frame->id;
+        return;
+    }
+    auto parent = m_frames.find(frame->parentId);
+    if (parent == m_frames.end() || parent->second.frame.mainFrameId == c_noFrame)
+    {
+        return;
+    }
+    const Frame& parentFrame = parent->second.frame;
+    frame->mainFrameId = parentFrame.mainFrameId;
+    frame->firstLevelFrameId =
+        parentFrame.parentId == c_noFrame ? frame->id : parentFrame.firstLevelFrameId;
+    frame->depth = parentFrame.depth + 1;
+}
+
+void FrameTree::UpdateDescendants(const Node& node)
+{
+    // Only frames inserted before their parents, or moved, have frames under
+    // them here, so a new frame costs one lookup. The walk stops at the frames
+    // whose ancestors stay the same, such as those under a frame that is still
+    // waiting for its parent.
+    auto children = m_children.find(node.frame.id);
+    if (children == m_children.end())
+    {
+        return;
+    }
+    std::vector<uint32_t> pending = children->second;
+    while (!pending.empty())
+    {
+        Frame& frame = m_frames.find(pending.back())->second.frame;
+        pending.pop_back();
+        uint32_t mainFrameId = frame.mainFrameId;
+        uint32_t firstLevelFrameId = frame.firstLevelFrameId;
+        uint32_t depth = frame.depth;
+        SetAncestors(&frame);
+        if (frame.mainFrameId == mainFrameId && frame.firstLevelFrameId == firstLevelFrameId &&
+            frame.depth == depth)
+        {
+            continue;
+        }
+        children = m_children.find(frame.id);
+        if (children != m_children.end())
+        {
+            pending.insert(pending.end(), children->second.begin(), children->second.end());
+        }
+    }
+}
+
+bool FrameTree::IsAncestor(uint32_t ancestorId, uint32_t id) const
+{
+    while (id != c_noFrame)
+    {
+        if (id == ancestorId)
+        {
+            return true;
+        }
+        auto node = m_frames.find(id);
+        if (node == m_frames.end())
+        {
+            return false;
+        }
+        id = node->second.frame.parentId;
+    }
+    return false;
+}
+
+void FrameTree::Link(Node* node)
+{
+    Frame& frame = node->frame;
+    if (frame.parentId != c_noFrame)
+    {
+        std::vector<uint32_t>& siblings = m_children[frame.parentId];
+        node->childIndex = siblings.size();
+        siblings.push_back(frame.id);
+    }
+    SetAncestors(&frame);
+}
+
+void FrameTree::Unlink(Node* node)
+{
+    if (node->frame.parentId == c_noFrame)
+    {
+        return;
+    }
+    auto siblings = m_children.find(node->frame.parentId);
+    RemoveAt(&siblings->second, node->childIndex, &Node::childIndex);
+    if (siblings->second.empty())
+    {
+        m_children.erase(siblings);
+    }
+}
+
+void FrameTree::AddToProcess(Node* node)
+{
+    if (node->frame.processId == c_noProcess)
+    {
+        return;
+    }
+    std::vector<uint32_t>& frames = m_processFrames[node->frame.processId];
+    node->processIndex = frames.size();
+    frames.push_back(node->frame.id);
+}
+
+void FrameTree::RemoveFromProcess(Node* node)
+{
+    if (node->frame.processId == c_noProcess)
+    {
+        return;
+    }
+    auto frames = m_processFrames.find(node->frame.processId);
+    RemoveAt(&frames->second, node->processIndex, &Node::processIndex);
+    if (frames->second.empty())
+    {
+        m_processFrames.erase(frames);
+    }
+}
+
+void FrameTree::RemoveAt(std::vector<uint32_t>* ids, size_t index, size_t Node::*position)
+{
+    uint32_t last = ids->back();
+    ids->pop_back();
+    if (index < ids->size())
+    {
+        (*ids)[index] = last;
+        m_frames.find(last)->second.*position = index;
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// FrameTree indexes the frames of the WebViews of an environment by frame ID,
+// for the frame-by-frame views of the processes, so that finding a frame's
+// main frame, or the main frame's child it is in, takes one lookup rather
+// than a walk up its parents.
+//
+// Each frame keeps its parent, its depth, and those two ancestors, which are
+// set from its parent's when it is inserted. A frame may be inserted before
+// its parent: its ancestors are unknown until the parent is, and are then set
+// for it and the frames under it. Frames are also grouped by the render
+// process that hosts them.
+//
+// The host inserts frames as they are created and removes them as they are
+// destroyed. A snapshot of all frames, between BeginSnapshot and EndSnapshot,
+// brings the tree up to date: frames that are already indexed under the same
+// parent cost one lookup, and those not in the snapshot are removed.
+//
+// Strings are UTF-8. Not thread-safe. Has no dependency on Win32.
+class FrameTree
+{
+public:
+    static constexpr uint32_t c_noFrame = 0;
+    static constexpr int32_t c_noProcess = 0;
+
+    struct Frame
+    {
+        uint32_t id = c_noFrame;
+        // c_noFrame for a main frame.
+        uint32_t parentId = c_noFrame;
+        // The main frame the frame is in, which is the frame itself for a main
+        // frame, or c_noFrame while one of its ancestors isn't indexed.
+        uint32_t mainFrameId = c_noFrame;
+        // The main frame's child the frame is in, which is the frame itself for
+        // a child of a main frame, or c_noFrame for a main frame.
+        uint32_t firstLevelFrameId = c_noFrame;
+        // 0 for a main frame. Only set once mainFrameId is.
+        uint32_t depth = 0;
+        int32_t processId = c_noProcess;
+        // As the host defines it, e.g. COREWEBVIEW2_FRAME_KIND.
+        int32_t kind = 0;
+        std::string name;
+        std::string source;
+    };
+
+    // Inserts a frame, or moves it under `parentId` if it is already indexed
+    // under another parent.
+    void Insert(uint32_t id, uint32_t parentId);
+    void SetProcess(uint32_t id, int32_t processId);
+    void SetDetails(uint32_t id, int32_t kind, std::string name, std::string source);
+    // Removes a frame and the frames under it.
+    void Remove(uint32_t id);
+    // Removes the frames of a process that exited.
+    void RemoveProcess(int32_t processId);
+
+    // The frames inserted from here to EndSnapshot are the snapshot.
+    void BeginSnapshot();
+    // Removes the frames that were not in the snapshot.
+    void EndSnapshot();
+    bool IsInSnapshot(uint32_t id) const;
+
+    // Returns nullptr if the frame isn't indexed.
+    const Frame* Find(uint32_t id) const;
+    // The IDs of the frames of a process, in no particular order.
+    const std::vector<uint32_t>& GetProcessFrames(int32_t processId) const;
+    std::vector<int32_t> GetProcessIds() const;
+    // The processes that host a frame in the main frame, i.e. in one WebView.
+    std::vector<int32_t> GetMainFrameProcessIds(uint32_t mainFrameId) const;
+    size_t GetFrameCount() const
+    {
+        return m_frames.size();
+    }
+
+private:
+    struct Node
+    {
+        Frame frame;
+        // The indexes of the frame in its parent's and its process's lists.
+        size_t childIndex = 0;
+        size_t processIndex = 0;
+        uint64_t snapshot = 0;
+    };
+
+    // Sets a frame's ancestors from its parent's.
+    void SetAncestors(Frame* frame) const;
+    // Sets the ancestors of the frames under `node`.
+    void UpdateDescendants(const Node& node);
+    // Returns true if `ancestorId` is `id` or one of its ancestors.
+    bool IsAncestor(uint32_t ancestorId, uint32_t id) const;
+    void Link(Node* node);
+    void Unlink(Node* node);
+    void AddToProcess(Node* node);
+    void RemoveFromProcess(Node* node);
+    // Removes the ID at `index` of a list of frame IDs by moving the last one
+    // there, which updates that frame's `position` in the list.
+    void RemoveAt(std::vector<uint32_t>* ids, size_t index, size_t Node::*position);
+
+    std::unordered_map<uint32_t, Node> m_frames;
+    // By parent frame ID, which need not be indexed yet.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_children;
+    std::unordered_map<int32_t, std::vector<uint32_t>> m_processFrames;
+    uint64_t m_snapshot = 0;
+};
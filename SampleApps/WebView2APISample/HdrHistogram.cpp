@@ -0,0 +1,114 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr uint32_t c_halfCount = HdrHistogram::c_subBucketCount / 2;
+
+uint32_t HighestBit(uint64_t value)
+{
+    uint32_t bit = 0;
+    while (value >>= 1)
+    {
+        bit++;
+    }
+    return bit;
+}
+} // namespace
+
+// Values below c_subBucketCount get an index each. Above that, a value whose
+// highest bit is b keeps its top c_subBucketBits bits: `shift` drops the rest,
+// and each shift has c_halfCount indices because the top bit is always set.
+size_t HdrHistogram::GetIndex(uint64_t value)
+{
+    if (value < c_subBucketCount)
+    {
+        return static_cast<size_t>(value);
+    }
+    uint32_t shift = HighestBit(value) - c_subBucketBits + 1;
+    uint64_t top = value >> shift;
+    return c_subBucketCount + (shift - 1) * c_halfCount +
+           static_cast<size_t>(top - c_halfCount);
+}
+
+uint64_t HdrHistogram::GetHighestValue(size_t index)
+{
+    if (index < c_subBucketCount)
+    {
+        return index;
+    }
+    size_t shift = (index - c_subBucketCount) / c_halfCount + 1;
+    uint64_t top = (index - c_subBucketCount) % c_halfCount + c_halfCount;
+    return ((top + 1) << shift) - 1;
+}
+
+size_t HdrHistogram::GetIndexCount()
+{
+    return GetIndex(c_maxValue) + 1;
+}
+
+void HdrHistogram::Record(uint64_t value)
+{
+    value = (std::min)(value, c_maxValue);
+    if (m_counts.empty())
+    {
+        m_counts.resize(GetIndexCount());
+    }
+    m_counts[GetIndex(value)]++;
+    m_count++;
+    m_sum += value;
+    m_min = (std::min)(m_min, value);
+    m_max = (std::max)(m_max, value);
+}
+
+void HdrHistogram::Merge(const HdrHistogram& other)
+{
+    if (!other.m_count)
+    {
+        return;
+    }
+    if (m_counts.empty())
+    {
+        m_counts.resize(GetIndexCount());
+    }
+    for (size_t i = 0; i < m_counts.size(); i++)
+    {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = (std::min)(m_min, other.m_min);
+    m_max = (std::max)(m_max, other.m_max);
+}
+
+void HdrHistogram::Reset()
+{
+    *this = HdrHistogram();
+}
+
+uint64_t HdrHistogram::GetValueAtPercentile(double percentile) const
+{
+    if (!m_count)
+    {
+        return 0;
+    }
+    double clamped = (std::min)((std::max)(percentile, 0.0), 100.0);
+    uint64_t rank = (std::max)(
+        uint64_t(1), static_cast<uint64_t>(std::ceil(clamped / 100 * m_count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size(); i++)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            return (std::min)(GetHighestValue(i), m_max);
+        }
+    }
+    return m_max;
+}
@@ -0,0 +1,62 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// HdrHistogram records non-negative integer values, such as durations in
+// microseconds, with a fixed relative precision over a wide range. Values are
+// grouped into power-of-two buckets, each split into c_subBucketCount linear
+// sub-buckets, so every recorded value is known to within 1/64 (about 1.6%)
+// of itself. Recording is O(1) and memory is fixed regardless of how many
+// values are recorded; counters are only allocated once a value is recorded.
+//
+// Has no dependency on Win32.
+class HdrHistogram
+{
+public:
+    static constexpr uint32_t c_subBucketBits = 7;
+    static constexpr uint32_t c_subBucketCount = 1u << c_subBucketBits;
+    // Larger values are recorded as this value.
+    static constexpr uint64_t c_maxValue = (uint64_t(1) << 36) - 1;
+
+    void Record(uint64_t value);
+    void Merge(const HdrHistogram& other);
+    void Reset();
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+    uint64_t GetMin() const
+    {
+        return m_count ? m_min : 0;
+    }
+    uint64_t GetMax() const
+    {
+        return m_max;
+    }
+    double GetMean() const
+    {
+        return m_count ? double(m_sum) / m_count : 0;
+    }
+    // Returns the smallest value such that `percentile` percent of the
+    // recorded values are at or below it, within the histogram's precision.
+    uint64_t GetValueAtPercentile(double percentile) const;
+
+private:
+    static size_t GetIndex(uint64_t value);
+    // The largest value that maps to `index`.
+    static uint64_t GetHighestValue(size_t index);
+    static size_t GetIndexCount();
+
+    std::vector<uint32_t> m_counts;
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_min = UINT64_MAX;
+    uint64_t m_max = 0;
+};
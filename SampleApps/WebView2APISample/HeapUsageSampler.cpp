@@ -0,0 +1,246 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapUsageSampler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+void AppendJsonString(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void AppendNumber(std::string& out, double value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.6g", value);
+    out += buffer;
+}
+} // namespace
+
+HeapUsageSampler::HeapUsageSampler(const Options& options) : m_options(options)
+{
+}
+
+void HeapUsageSampler::AddTarget(const std::string& target, const std::string& label)
+{
+    Target& entry = m_targets[target];
+    entry.label = label;
+    entry.trend.target = target;
+    entry.trend.label = label;
+}
+
+void HeapUsageSampler::RemoveTarget(const std::string& target)
+{
+    m_targets.erase(target);
+}
+
+void HeapUsageSampler::Clear()
+{
+    m_targets.clear();
+}
+
+std::vector<std::string> HeapUsageSampler::GetDueTargets(int64_t nowMs)
+{
+    std::vector<std::string> due;
+    for (auto& entry : m_targets)
+    {
+        Target& target = entry.second;
+        int64_t lostAfterMs = m_options.lostAfterIntervals * m_options.intervalMs;
+        if (target.inFlightSinceMs >= 0 && nowMs - target.inFlightSinceMs > lostAfterMs)
+        {
+            target.inFlightSinceMs = -1;
+        }
+        if (target.inFlightSinceMs < 0 && nowMs >= target.nextDueMs)
+        {
+            target.inFlightSinceMs = nowMs;
+            target.nextDueMs = nowMs + m_options.intervalMs;
+            due.push_back(entry.first);
+        }
+    }
+    return due;
+}
+
+bool HeapUsageSampler::OnSample(
+    const std::string& target, int64_t nowMs, double usedSize, double totalSize)
+{
+    auto it = m_targets.find(target);
+    if (it == m_targets.end())
+    {
+        return false;
+    }
+    Target& entry = it->second;
+    entry.inFlightSinceMs = -1;
+    Sample sample = {nowMs, usedSize, totalSize};
+    if (entry.samples.size() < m_options.windowSize)
+    {
+        entry.samples.push_back(sample);
+    }
+    else
+    {
+        entry.samples[entry.next] = sample;
+        entry.next = (entry.next + 1) % entry.samples.size();
+    }
+    bool wasLeak = entry.trend.likelyLeak;
+    UpdateTrend(it->first, entry);
+    return entry.trend.likelyLeak && !wasLeak;
+}
+
+void HeapUsageSampler::OnSampleFailed(const std::string& target)
+{
+    auto it = m_targets.find(target);
+    if (it != m_targets.end())
+    {
+        it->second.inFlightSinceMs = -1;
+    }
+}
+
+std::vector<HeapUsageSampler::Sample> HeapUsageSampler::GetOrderedSamples(
+    const Target& target) const
+{
+    std::vector<Sample> ordered(target.samples.begin() + target.next, target.samples.end());
+    ordered.insert(ordered.end(), target.samples.begin(), target.samples.begin() + target.next);
+    return ordered;
+}
+
+double HeapUsageSampler::FitSlope(
+    const std::vector<double>& x, const std::vector<double>& y, double* rSquared)
+{
+    *rSquared = 0;
+    size_t count = (std::min)(x.size(), y.size());
+    if (count < 2)
+    {
+        return 0;
+    }
+    double meanX = 0;
+    double meanY = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        meanX += x[i];
+        meanY += y[i];
+    }
+    meanX /= count;
+    meanY /= count;
+    // Centered sums keep the precision that large heap sizes would lose.
+    double sxx = 0;
+    double sxy = 0;
+    double syy = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double dx = x[i] - meanX;
+        double dy = y[i] - meanY;
+        sxx += dx * dx;
+        sxy += dx * dy;
+        syy += dy * dy;
+    }
+    if (sxx <= 0)
+    {
+        return 0;
+    }
+    if (syy > 0)
+    {
+        *rSquared = sxy * sxy / (sxx * syy);
+    }
+    return sxy / sxx;
+}
+
+void HeapUsageSampler::UpdateTrend(const std::string& id, Target& target)
+{
+    std::vector<Sample> samples = GetOrderedSamples(target);
+    std::vector<double> seconds;
+    std::vector<double> used;
+    for (const Sample& sample : samples)
+    {
+        seconds.push_back((sample.timeMs - samples.front().timeMs) / 1000.0);
+        used.push_back(sample.usedSize);
+    }
+    Trend& trend = target.trend;
+    trend.target = id;
+    trend.label = target.label;
+    trend.sampleCount = samples.size();
+    trend.usedSize = samples.back().usedSize;
+    trend.totalSize = samples.back().totalSize;
+    trend.bytesPerSecond = FitSlope(seconds, used, &trend.rSquared);
+    trend.likelyLeak = trend.sampleCount >= m_options.minSamples &&
+                       trend.bytesPerSecond >= m_options.leakBytesPerSecond &&
+                       trend.rSquared >= m_options.minRSquared;
+}
+
+HeapUsageSampler::Trend HeapUsageSampler::GetTrend(const std::string& target) const
+{
+    auto it = m_targets.find(target);
+    return it != m_targets.end() ? it->second.trend : Trend();
+}
+
+std::vector<HeapUsageSampler::Trend> HeapUsageSampler::GetTrends() const
+{
+    std::vector<Trend> trends;
+    for (const auto& entry : m_targets)
+    {
+        trends.push_back(entry.second.trend);
+    }
+    std::sort(
+        trends.begin(), trends.end(),
+        [](const Trend& a, const Trend& b) { return a.target < b.target; });
+    return trends;
+}
+
+std::string HeapUsageSampler::ExportJson() const
+{
+    std::string out = "{\"targets\":[";
+    bool first = true;
+    for (const Trend& trend : GetTrends())
+    {
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"target\":";
+        AppendJsonString(out, trend.target);
+        out += ",\"label\":";
+        AppendJsonString(out, trend.label);
+        out += ",\"usedSize\":" + std::to_string(int64_t(trend.usedSize));
+        out += ",\"totalSize\":" + std::to_string(int64_t(trend.totalSize));
+        out += ",\"bytesPerSecond\":";
+        AppendNumber(out, trend.bytesPerSecond);
+        out += ",\"rSquared\":";
+        AppendNumber(out, trend.rSquared);
+        out += ",\"likelyLeak\":";
+        out += trend.likelyLeak ? "true" : "false";
+        // Each sample is [timeMs, usedSize, totalSize], oldest first.
+        out += ",\"samples\":[";
+        bool firstSample = true;
+        for (const Sample& sample : GetOrderedSamples(m_targets.at(trend.target)))
+        {
+            out += firstSample ? "[" : ",[";
+            firstSample = false;
+            out += std::to_string(sample.timeMs) + "," +
+                   std::to_string(int64_t(sample.usedSize)) + "," +
+                   std::to_string(int64_t(sample.totalSize)) + "]";
+        }
+        out += "]}";
+    }
+    out += "\n]}\n";
+    return out;
+}
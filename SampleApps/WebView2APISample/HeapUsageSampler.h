@@ -0,0 +1,104 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// HeapUsageSampler schedules periodic JavaScript heap usage samples of a set of
+// targets, such as the DevTools sessions of a WebView, and flags targets whose
+// heap keeps growing.
+//
+// Each target keeps its last Options::windowSize samples in a ring buffer.
+// After every sample, a least-squares line is fitted to the used size over
+// that window. A target is flagged as a likely leak when the line rises
+// faster than Options::leakBytesPerSecond and fits well enough, so that
+// sawtooth garbage collection patterns are not flagged.
+//
+// The caller owns the clock and the transport: it asks GetDueTargets which
+// targets to sample now, and reports each result with OnSample. A target has
+// at most one sample in flight. Not thread-safe. Strings are UTF-8. Has no
+// dependency on Win32.
+class HeapUsageSampler
+{
+public:
+    struct Options
+    {
+        int64_t intervalMs = 5000;
+        size_t windowSize = 60;
+        // Fewer samples than this never flag a leak.
+        size_t minSamples = 12;
+        double leakBytesPerSecond = 16 * 1024;
+        // The coefficient of determination the fit needs to flag a leak.
+        double minRSquared = 0.6;
+        // Samples in flight for longer than this many intervals are
+        // considered lost.
+        int64_t lostAfterIntervals = 4;
+    };
+
+    struct Trend
+    {
+        std::string target;
+        std::string label;
+        size_t sampleCount = 0;
+        double usedSize = 0;
+        double totalSize = 0;
+        double bytesPerSecond = 0;
+        double rSquared = 0;
+        bool likelyLeak = false;
+    };
+
+    HeapUsageSampler() = default;
+    explicit HeapUsageSampler(const Options& options);
+
+    // Adds a target, or updates its label. Its samples are kept.
+    void AddTarget(const std::string& target, const std::string& label);
+    void RemoveTarget(const std::string& target);
+    void Clear();
+
+    // Returns the targets to sample now, and marks them in flight.
+    std::vector<std::string> GetDueTargets(int64_t nowMs);
+    // Returns true if the target became a likely leak with this sample.
+    bool OnSample(const std::string& target, int64_t nowMs, double usedSize, double totalSize);
+    void OnSampleFailed(const std::string& target);
+
+    Trend GetTrend(const std::string& target) const;
+    std::vector<Trend> GetTrends() const;
+    // An object per target with its trend and samples.
+    std::string ExportJson() const;
+
+    // Fits y = a + b * x by least squares. Returns the slope b and sets
+    // `rSquared`, which is 0 when the points do not vary.
+    static double FitSlope(
+        const std::vector<double>& x, const std::vector<double>& y, double* rSquared);
+
+private:
+    struct Sample
+    {
+        int64_t timeMs;
+        double usedSize;
+        double totalSize;
+    };
+
+    struct Target
+    {
+        std::string label;
+        // A ring buffer of the latest samples; `next` is the oldest once full.
+        std::vector<Sample> samples;
+        size_t next = 0;
+        int64_t nextDueMs = 0;
+        int64_t inFlightSinceMs = -1;
+        Trend trend;
+    };
+
+    void UpdateTrend(const std::string& id, Target& target);
+    std::vector<Sample> GetOrderedSamples(const Target& target) const;
+
+    Options m_options;
+    std::unordered_map<std::string, Target> m_targets;
+};
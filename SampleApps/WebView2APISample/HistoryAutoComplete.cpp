@@ -0,0 +1,218 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "HistoryAutoComplete.h"
+
+#include <ctime>
+#include <mutex>
+#include <shlwapi.h>
+#include <thread>
+
+#include "HistoryIndex.h"
+#include "StringConversion.h"
+
+namespace
+{
+constexpr wchar_t c_addressBarProperty[] = L"HistoryAutoComplete";
+
+struct PendingVisit
+{
+    std::string url;
+    std::string title;
+    int64_t time;
+    bool typed;
+};
+
+// The history shared by all windows.
+struct SharedHistory
+{
+    std::mutex mutex;
+    HistoryIndex index;
+    bool loadStarted = false;
+    bool loaded = false;
+    // Visits recorded while the saved history is still loading.
+    std::vector<PendingVisit> pendingVisits;
+};
+
+SharedHistory& GetSharedHistory()
+{
+    static SharedHistory s_history;
+    return s_history;
+}
+
+std::wstring GetHistoryPath()
+{
+    WCHAR path[MAX_PATH];
+    GetModuleFileName(nullptr, path, ARRAYSIZE(path));
+    PathRemoveFileSpec(path);
+    PathAppend(path, L"History.bin");
+    return path;
+}
+
+void StartLoadingHistory()
+{
+    SharedHistory& history = GetSharedHistory();
+    {
+        std::lock_guard<std::mutex> lock(history.mutex);
+        if (history.loadStarted)
+        {
+            return;
+        }
+        history.loadStarted = true;
+    }
+    // Rebuilding a large index takes a while, so keep it off the UI thread.
+    std::thread(
+        [&history]
+        {
+            HistoryIndex loaded;
+            loaded.Load(GetHistoryPath());
+            std::lock_guard<std::mutex> lock(history.mutex);
+            history.index = std::move(loaded);
+            for (const auto& visit : history.pendingVisits)
+            {
+                history.index.AddVisit(visit.url, visit.title, visit.time, visit.typed);
+            }
+            history.pendingVisits.clear();
+            history.loaded = true;
+        })
+        .detach();
+}
+} // namespace
+
+HistoryAutoComplete::HistoryAutoComplete(HWND addressBar) : m_addressBar(addressBar)
+{
+}
+
+HistoryAutoComplete* HistoryAutoComplete::GetForAddressBar(HWND addressBar)
+{
+    if (auto existing =
+            static_cast<HistoryAutoComplete*>(GetProp(addressBar, c_addressBarProperty)))
+    {
+        return existing;
+    }
+    auto source = Microsoft::WRL::Make<HistoryAutoComplete>(addressBar);
+    if (!source || FAILED(source->Attach()))
+    {
+        return nullptr;
+    }
+    SetProp(addressBar, c_addressBarProperty, source.Get());
+    return source.Get();
+}
+
+HRESULT HistoryAutoComplete::Attach()
+{
+    StartLoadingHistory();
+    HRESULT hr = CoCreateInstance(
+        CLSID_AutoComplete, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&m_autoComplete));
+    if (SUCCEEDED(hr))
+    {
+        hr = m_autoComplete->Init(m_addressBar, this, nullptr, nullptr);
+    }
+    if (SUCCEEDED(hr))
+    {
+        // The index already matched the text against titles as well as URLs,
+        // so show its results as they are.
+        hr = m_autoComplete->SetOptions(
+            ACO_AUTOSUGGEST | ACO_UPDOWNKEYDROPSLIST | ACO_NOPREFIXFILTERING);
+    }
+    return hr;
+}
+
+void HistoryAutoComplete::SetEnabled(bool enabled)
+{
+    m_autoComplete->Enable(enabled);
+}
+
+void HistoryAutoComplete::OnTextChanged()
+{
+    if (auto dropDown = m_autoComplete.try_query<IAutoCompleteDropDown>())
+    {
+        dropDown->ResetEnumerator();
+    }
+}
+
+void HistoryAutoComplete::RecordVisit(
+    const std::wstring& uri, const std::wstring& title, bool typed)
+{
+    if (uri.compare(0, 7, L"http://") != 0 && uri.compare(0, 8, L"https://") != 0)
+    {
+        return;
+    }
+    PendingVisit visit = {ToUtf8(uri), ToUtf8(title), std::time(nullptr), typed};
+    SharedHistory& history = GetSharedHistory();
+    std::lock_guard<std::mutex> lock(history.mutex);
+    if (history.loaded)
+    {
+        history.index.AddVisit(visit.url, visit.title, visit.time, visit.typed);
+    }
+    else
+    {
+        history.pendingVisits.push_back(std::move(visit));
+    }
+}
+
+void HistoryAutoComplete::SaveHistory()
+{
+    SharedHistory& history = GetSharedHistory();
+    std::lock_guard<std::mutex> lock(history.mutex);
+    // Saving before the load finishes would drop the saved history.
+    if (history.loaded)
+    {
+        history.index.Save(GetHistoryPath());
+    }
+}
+
+HRESULT HistoryAutoComplete::Next(ULONG count, LPOLESTR* strings, ULONG* fetched)
+{
+    ULONG copied = 0;
+    for (; copied < count && m_position < m_suggestions.size(); copied++, m_position++)
+    {
+        HRESULT hr = SHStrDup(m_suggestions[m_position].c_str(), &strings[copied]);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+    if (fetched)
+    {
+        *fetched = copied;
+    }
+    return copied == count ? S_OK : S_FALSE;
+}
+
+HRESULT HistoryAutoComplete::Skip(ULONG count)
+{
+    m_position = (std::min)(m_suggestions.size(), m_position + count);
+    return m_position < m_suggestions.size() ? S_OK : S_FALSE;
+}
+
+// AutoComplete resets the enumerator before showing the drop down, so this is
+// where the index is queried for the current text.
+HRESULT HistoryAutoComplete::Reset()
+{
+    int length = GetWindowTextLength(m_addressBar);
+    std::wstring text(length, 0);
+    GetWindowText(m_addressBar, &text[0], length + 1);
+
+    std::vector<HistoryIndex::Suggestion> suggestions;
+    {
+        SharedHistory& history = GetSharedHistory();
+        std::lock_guard<std::mutex> lock(history.mutex);
+        suggestions = history.index.Query(ToUtf8(text), c_suggestionCount);
+    }
+    m_suggestions.clear();
+    for (const auto& suggestion : suggestions)
+    {
+        m_suggestions.push_back(ToUtf16(suggestion.url));
+    }
+    m_position = 0;
+    return S_OK;
+}
+
+HRESULT HistoryAutoComplete::Clone(IEnumString** enumerator)
+{
+    return E_NOTIMPL;
+}
@@ -0,0 +1,57 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <ShlObj.h>
+#include <string>
+#include <vector>
+
+// HistoryAutoComplete shows address bar suggestions from the pages the user
+// visited, ranked by HistoryIndex. It is the string source of a shell
+// AutoComplete object attached to the address bar edit control, and queries
+// the index again for the current text each time the drop down is reset.
+//
+// There is one history for the process, shared by every window. It is loaded
+// from History.bin next to the executable on a background thread when the
+// first address bar is attached, and saved by SaveHistory.
+class HistoryAutoComplete : public Microsoft::WRL::RuntimeClass<
+                                Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>,
+                                IEnumString>
+{
+public:
+    HistoryAutoComplete(HWND addressBar);
+
+    // Returns the source for `addressBar`, attaching one the first time. The
+    // AutoComplete object keeps it alive for as long as the address bar
+    // exists, so it survives the WebView being recreated. Returns null if
+    // AutoComplete is not available.
+    static HistoryAutoComplete* GetForAddressBar(HWND addressBar);
+    void SetEnabled(bool enabled);
+    // Call when the address bar text changes so that suggestions are queried
+    // again for the new text.
+    void OnTextChanged();
+
+    // Records a completed navigation. Typed visits rank higher.
+    static void RecordVisit(const std::wstring& uri, const std::wstring& title, bool typed);
+    static void SaveHistory();
+
+    // IEnumString implementation:
+    HRESULT __stdcall Next(ULONG count, LPOLESTR* strings, ULONG* fetched) override;
+    HRESULT __stdcall Skip(ULONG count) override;
+    HRESULT __stdcall Reset() override;
+    HRESULT __stdcall Clone(IEnumString** enumerator) override;
+
+private:
+    static constexpr size_t c_suggestionCount = 8;
+
+    HRESULT Attach();
+
+    HWND m_addressBar;
+    wil::com_ptr<IAutoComplete2> m_autoComplete;
+    std::vector<std::wstring> m_suggestions;
+    size_t m_position = 0;
+};
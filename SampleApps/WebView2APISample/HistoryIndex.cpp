@@ -0,0 +1,424 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HistoryIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+
+namespace
+{
+constexpr char c_fileMagic[8] = {'W', 'V', '2', 'H', 'I', 'S', 'T', '1'};
+constexpr size_t c_maxTitleWords = 16;
+constexpr size_t c_minWordLength = 2;
+
+char ToLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool IsWordChar(char c)
+{
+    // Bytes of multi-byte UTF-8 sequences are kept inside words.
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
+}
+
+bool StartsWith(std::string_view text, std::string_view prefix)
+{
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Calls `function` with each lower-cased word of `title`, up to the limit.
+void ForEachTitleWord(
+    const std::string& title, const std::function<void(std::string&)>& function)
+{
+    std::string word;
+    size_t words = 0;
+    for (size_t i = 0; i <= title.size() && words < c_maxTitleWords; i++)
+    {
+        if (i < title.size() && IsWordChar(title[i]))
+        {
+            word.push_back(ToLowerAscii(title[i]));
+            continue;
+        }
+        if (word.size() >= c_minWordLength)
+        {
+            function(word);
+            words++;
+        }
+        word.clear();
+    }
+}
+
+// log(exp(a) + exp(b)) without overflow.
+double LogAddExp(double a, double b)
+{
+    double high = (std::max)(a, b);
+    double low = (std::min)(a, b);
+    return high + std::log1p(std::exp(low - high));
+}
+
+void WriteUint32(std::ostream& out, uint32_t value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteString(std::ostream& out, const std::string& text)
+{
+    WriteUint32(out, static_cast<uint32_t>(text.size()));
+    out.write(text.data(), text.size());
+}
+
+// Reads fields from an in-memory copy of the saved file.
+class Reader
+{
+public:
+    Reader(const char* data, size_t size) : m_data(data), m_size(size)
+    {
+    }
+    template <typename T> bool Read(T* value)
+    {
+        if (m_size - m_position < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(value, m_data + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return true;
+    }
+    bool ReadString(std::string* text)
+    {
+        uint32_t size = 0;
+        if (!Read(&size) || m_size - m_position < size)
+        {
+            return false;
+        }
+        text->assign(m_data + m_position, size);
+        m_position += size;
+        return true;
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+};
+} // namespace
+
+std::string HistoryIndex::NormalizeUrl(std::string_view url)
+{
+    std::string result(url.size(), '\0');
+    std::transform(url.begin(), url.end(), result.begin(), ToLowerAscii);
+    for (std::string_view scheme : {"https://", "http://"})
+    {
+        if (StartsWith(result, scheme))
+        {
+            result.erase(0, scheme.size());
+            break;
+        }
+    }
+    if (StartsWith(result, "www."))
+    {
+        result.erase(0, 4);
+    }
+    return result;
+}
+
+void HistoryIndex::AddVisit(
+    const std::string& url, const std::string& title, int64_t nowSeconds, bool typed)
+{
+    uint32_t entryId = GetOrAddEntry(url);
+    Entry& entry = m_entries[entryId];
+    // A visit's weight halves every c_halfLifeSeconds relative to later
+    // visits, i.e. weight * 2^(now / halfLife), kept as a logarithm.
+    double visit = std::log(typed ? c_typedVisitWeight : 1.0) +
+                   nowSeconds * (std::log(2.0) / c_halfLifeSeconds);
+    entry.score = entry.visits == 0 ? visit : LogAddExp(entry.score, visit);
+    entry.visits++;
+    if (!title.empty())
+    {
+        entry.title = title;
+    }
+    IndexEntry(entryId);
+}
+
+uint32_t HistoryIndex::GetOrAddEntry(const std::string& url)
+{
+    auto it = m_entryByUrl.find(url);
+    if (it != m_entryByUrl.end())
+    {
+        return it->second;
+    }
+    uint32_t entryId = static_cast<uint32_t>(m_entries.size());
+    m_entries.emplace_back();
+    m_entries.back().url = url;
+    m_entryByUrl.emplace(url, entryId);
+    return entryId;
+}
+
+// Inserts every key of the entry, or moves it up if it is already listed, so
+// the scores along each path reflect its current score.
+void HistoryIndex::IndexEntry(uint32_t entryId)
+{
+    InsertKey(NormalizeUrl(m_entries[entryId].url), entryId);
+    ForEachTitleWord(
+        m_entries[entryId].title, [this, entryId](std::string& word)
+        { InsertKey(word, entryId); });
+}
+
+void HistoryIndex::InsertKey(std::string_view key, uint32_t entryId)
+{
+    double score = m_entries[entryId].score;
+    uint32_t node = 0;
+    size_t position = 0;
+    while (true)
+    {
+        m_nodes[node].maxScore = (std::max)(m_nodes[node].maxScore, score);
+        if (position == key.size())
+        {
+            break;
+        }
+        std::string_view rest = key.substr(position);
+        auto& children = m_nodes[node].children;
+        auto child = std::lower_bound(
+            children.begin(), children.end(), rest[0],
+            [this](uint32_t id, char c) { return m_nodes[id].label[0] < c; });
+        if (child == children.end() || m_nodes[*child].label[0] != rest[0])
+        {
+            uint32_t leaf = static_cast<uint32_t>(m_nodes.size());
+            children.insert(child, leaf);
+            m_nodes.emplace_back();
+            m_nodes[leaf].label = std::string(rest);
+            node = leaf;
+            position = key.size();
+            continue;
+        }
+
+        uint32_t childId = *child;
+        const std::string& label = m_nodes[childId].label;
+        size_t common = 0;
+        while (common < label.size() && common < rest.size() && label[common] == rest[common])
+        {
+            common++;
+        }
+        if (common < label.size())
+        {
+            // Split the edge. The new node goes above the existing child so
+            // that nodes listing entries keep their numbers.
+            uint32_t middle = static_cast<uint32_t>(m_nodes.size());
+            *child = middle;
+            m_nodes.emplace_back();
+            Node& split = m_nodes[middle];
+            split.label = m_nodes[childId].label.substr(0, common);
+            split.children.push_back(childId);
+            split.maxScore = m_nodes[childId].maxScore;
+            m_nodes[childId].label.erase(0, common);
+            childId = middle;
+        }
+        node = childId;
+        position += common;
+    }
+
+    Entry& entry = m_entries[entryId];
+    auto& entries = m_nodes[node].entries;
+    auto byScore = [this](uint32_t a, uint32_t b)
+    { return m_entries[a].score > m_entries[b].score; };
+    if (std::find(entry.terminals.begin(), entry.terminals.end(), node) ==
+        entry.terminals.end())
+    {
+        if (entries.size() == c_maxEntriesPerNode && !byScore(entryId, entries.back()))
+        {
+            return;
+        }
+        entry.terminals.push_back(node);
+        entries.insert(
+            std::upper_bound(entries.begin(), entries.end(), entryId, byScore), entryId);
+        if (entries.size() > c_maxEntriesPerNode)
+        {
+            auto& droppedTerminals = m_entries[entries.back()].terminals;
+            droppedTerminals.erase(
+                std::find(droppedTerminals.begin(), droppedTerminals.end(), node));
+            entries.pop_back();
+        }
+        return;
+    }
+    // Scores only grow, so the entry can only move towards the front.
+    auto it = std::find(entries.begin(), entries.end(), entryId);
+    while (it != entries.begin() && byScore(*it, *(it - 1)))
+    {
+        std::iter_swap(it, it - 1);
+        --it;
+    }
+}
+
+int64_t HistoryIndex::FindPrefix(std::string_view prefix) const
+{
+    uint32_t node = 0;
+    size_t position = 0;
+    while (position < prefix.size())
+    {
+        std::string_view rest = prefix.substr(position);
+        const auto& children = m_nodes[node].children;
+        auto child = std::lower_bound(
+            children.begin(), children.end(), rest[0],
+            [this](uint32_t id, char c) { return m_nodes[id].label[0] < c; });
+        if (child == children.end() || m_nodes[*child].label[0] != rest[0])
+        {
+            return -1;
+        }
+        const std::string& label = m_nodes[*child].label;
+        if (StartsWith(label, rest))
+        {
+            return *child;
+        }
+        if (!StartsWith(rest, label))
+        {
+            return -1;
+        }
+        node = *child;
+        position += label.size();
+    }
+    return node;
+}
+
+// Titles change, and keys of an old title are not removed from the trie, so
+// check candidates against the entry's current keys.
+bool HistoryIndex::Matches(const Entry& entry, std::string_view normalizedText) const
+{
+    if (StartsWith(NormalizeUrl(entry.url), normalizedText))
+    {
+        return true;
+    }
+    bool found = false;
+    ForEachTitleWord(
+        entry.title, [&found, normalizedText](std::string& word)
+        { found = found || StartsWith(word, normalizedText); });
+    return found;
+}
+
+std::vector<HistoryIndex::Suggestion> HistoryIndex::Query(
+    std::string_view text, size_t count) const
+{
+    count = (std::min)(count, c_maxEntriesPerNode);
+    std::string normalized = NormalizeUrl(text);
+    int64_t start = normalized.empty() ? -1 : FindPrefix(normalized);
+    if (start < 0 || count == 0)
+    {
+        return {};
+    }
+
+    using Scored = std::pair<double, uint32_t>;
+    // Best results so far, worst on top.
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> best;
+    // Subtrees still to visit, most promising on top.
+    std::priority_queue<Scored> frontier;
+    std::unordered_set<uint32_t> considered;
+    frontier.emplace(m_nodes[start].maxScore, static_cast<uint32_t>(start));
+    while (!frontier.empty())
+    {
+        if (best.size() == count && best.top().first >= frontier.top().first)
+        {
+            break;
+        }
+        const Node& node = m_nodes[frontier.top().second];
+        frontier.pop();
+        for (uint32_t entryId : node.entries)
+        {
+            const Entry& entry = m_entries[entryId];
+            if (best.size() == count && entry.score <= best.top().first)
+            {
+                break;
+            }
+            if (considered.insert(entryId).second && Matches(entry, normalized))
+            {
+                best.emplace(entry.score, entryId);
+                if (best.size() > count)
+                {
+                    best.pop();
+                }
+            }
+        }
+        for (uint32_t child : node.children)
+        {
+            frontier.emplace(m_nodes[child].maxScore, child);
+        }
+    }
+
+    std::vector<Suggestion> suggestions(best.size());
+    for (size_t i = suggestions.size(); i-- > 0; best.pop())
+    {
+        const Entry& entry = m_entries[best.top().second];
+        suggestions[i] = {entry.url, entry.title, entry.score};
+    }
+    return suggestions;
+}
+
+bool HistoryIndex::Save(const std::filesystem::path& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(c_fileMagic, sizeof(c_fileMagic));
+    WriteUint32(out, static_cast<uint32_t>(m_entries.size()));
+    for (const Entry& entry : m_entries)
+    {
+        WriteString(out, entry.url);
+        WriteString(out, entry.title);
+        WriteUint32(out, entry.visits);
+        out.write(reinterpret_cast<const char*>(&entry.score), sizeof(entry.score));
+    }
+    out.close();
+    return !out.fail();
+}
+
+bool HistoryIndex::Load(const std::filesystem::path& path)
+{
+    // Read the file with one call and parse it in memory.
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    std::ifstream in(path, std::ios::binary);
+    if (error || !in)
+    {
+        return false;
+    }
+    std::vector<char> data(static_cast<size_t>(size));
+    if (!in.read(data.data(), data.size()))
+    {
+        return false;
+    }
+
+    Reader reader(data.data(), data.size());
+    char magic[sizeof(c_fileMagic)];
+    uint32_t count = 0;
+    if (!reader.Read(&magic) || memcmp(magic, c_fileMagic, sizeof(magic)) != 0 ||
+        !reader.Read(&count))
+    {
+        return false;
+    }
+    *this = HistoryIndex();
+    m_entries.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string url;
+        std::string title;
+        uint32_t visits = 0;
+        double score = 0;
+        if (!reader.ReadString(&url) || !reader.ReadString(&title) || !reader.Read(&visits) ||
+            !reader.Read(&score))
+        {
+            return false;
+        }
+        uint32_t entryId = GetOrAddEntry(url);
+        m_entries[entryId].title = std::move(title);
+        m_entries[entryId].visits = visits;
+        m_entries[entryId].score = score;
+        IndexEntry(entryId);
+    }
+    return true;
+}
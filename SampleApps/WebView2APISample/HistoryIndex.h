@@ -0,0 +1,106 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// HistoryIndex ranks visited pages for address bar suggestions. Every page is
+// indexed in a compressed prefix trie under its URL, without the scheme and
+// "www.", and under each word of its title, so typing "git" finds both
+// https://github.com/ and a page titled "Git branching".
+//
+// Pages are ranked by frecency: each visit adds a weight that decays with a
+// fixed half-life. Scores are kept in the log domain relative to a fixed
+// epoch, so a new visit only ever increases a page's score and the maximum
+// score kept at each trie node stays an upper bound for its subtree. Queries
+// walk the trie best-first and stop as soon as no unvisited subtree can beat
+// the results they already have.
+//
+// A node lists only the c_maxEntriesPerNode best pages ending there, which
+// keeps common title words cheap to update. That is still exact for queries
+// of up to that many results: a page's score only changes when it is visited,
+// and a visit re-inserts it wherever it now makes the cut.
+//
+// Not thread-safe. Strings are UTF-8. Has no dependency on Win32.
+class HistoryIndex
+{
+public:
+    struct Suggestion
+    {
+        std::string url;
+        std::string title;
+        double score = 0;
+    };
+
+    static constexpr double c_halfLifeSeconds = 30 * 24 * 60 * 60;
+    static constexpr double c_typedVisitWeight = 2;
+    static constexpr size_t c_maxEntriesPerNode = 32;
+
+    // Records a visit at `nowSeconds` (any fixed epoch). An empty `title`
+    // keeps the page's previous title.
+    void AddVisit(
+        const std::string& url, const std::string& title, int64_t nowSeconds,
+        bool typed = false);
+
+    // Returns up to `count` pages whose URL or a title word starts with `text`,
+    // highest frecency first. `count` is limited to c_maxEntriesPerNode.
+    std::vector<Suggestion> Query(std::string_view text, size_t count) const;
+
+    size_t GetEntryCount() const
+    {
+        return m_entries.size();
+    }
+    size_t GetNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    // The saved form holds only the pages and their scores; the trie is
+    // rebuilt on load, which is faster than reading it from disk.
+    bool Save(const std::filesystem::path& path) const;
+    bool Load(const std::filesystem::path& path);
+
+    // Lower case, without scheme and "www.", as used for trie keys.
+    static std::string NormalizeUrl(std::string_view url);
+
+private:
+    struct Entry
+    {
+        std::string url;
+        std::string title;
+        uint32_t visits = 0;
+        double score = 0;
+        // Trie nodes that list this entry. Nodes are never renumbered.
+        std::vector<uint32_t> terminals;
+    };
+
+    struct Node
+    {
+        std::string label;
+        std::vector<uint32_t> children;
+        // The best entries ending here, by descending score.
+        std::vector<uint32_t> entries;
+        double maxScore = -std::numeric_limits<double>::infinity();
+    };
+
+    uint32_t GetOrAddEntry(const std::string& url);
+    void IndexEntry(uint32_t entryId);
+    void InsertKey(std::string_view key, uint32_t entryId);
+    // Returns the node whose subtree holds every key starting with `prefix`,
+    // or -1 if there is none.
+    int64_t FindPrefix(std::string_view prefix) const;
+    bool Matches(const Entry& entry, std::string_view normalizedText) const;
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, uint32_t> m_entryByUrl;
+    std::vector<Node> m_nodes = std::vector<Node>(1);
+};
@@ -0,0 +1,315 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "KeyMap.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace
+{
+// Set on the entries of chord prefixes, whose other bits are the index of the
+// prefix's table.
+constexpr KeyMap::ActionId c_chordFlag = 0x8000;
+constexpr size_t c_maxActions = KeyMap::c_chordPending;
+
+struct KeyName
+{
+    const char* name;
+    uint8_t key;
+};
+
+constexpr KeyName c_keyNames[] = {
+    {"Backspace", 0x08}, {"Tab", 0x09},          {"Enter", 0x0D},          {"Pause", 0x13},
+    {"Esc", 0x1B},       {"Escape", 0x1B},       {"Space", 0x20},          {"PageUp", 0x21},
+    {"PageDown", 0x22},  {"End", 0x23},          {"Home", 0x24},           {"Left", 0x25},
+    {"Up", 0x26},        {"Right", 0x27},        {"Down", 0x28},           {"Insert", 0x2D},
+    {"Delete", 0x2E},    {"BrowserBack", 0xA6},  {"BrowserForward", 0xA7}, {"Plus", 0xBB},
+    {"Comma", 0xBC},     {"Minus", 0xBD},        {"Period", 0xBE},
+};
+
+bool EqualsIgnoringCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+           std::equal(
+               a.begin(), a.end(), b.begin(),
+               [](char x, char y)
+               {
+                   return tolower(static_cast<unsigned char>(x)) ==
+                          tolower(static_cast<unsigned char>(y));
+               });
+}
+
+std::string_view Trim(std::string_view text)
+{
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+bool IsModifierKey(uint8_t key)
+{
+    // VK_SHIFT, VK_CONTROL, VK_MENU and their left and right variants.
+    return (key >= 0x10 && key <= 0x12) || (key >= 0xA0 && key <= 0xA5);
+}
+} // namespace
+
+size_t KeyMap::Load(std::istream& config, std::vector<size_t>* badLines)
+{
+    size_t count = 0;
+    size_t lineNumber = 0;
+    std::string origin;
+    std::string line;
+    while (std::getline(config, line))
+    {
+        lineNumber++;
+        std::string_view text = Trim(line);
+        if (text.empty() || text[0] == '#')
+        {
+            continue;
+        }
+        bool parsed = false;
+        if (text.front() == '[' && text.back() == ']')
+        {
+            std::string_view section = Trim(text.substr(1, text.size() - 2));
+            origin = section == "*" ? std::string() : GetOrigin(section);
+            parsed = section == "*" || !origin.empty();
+        }
+        else
+        {
+            size_t equals = text.find('=');
+            parsed = equals != std::string_view::npos &&
+                     Bind(origin, Trim(text.substr(0, equals)), Trim(text.substr(equals + 1)));
+            count += parsed ? 1 : 0;
+        }
+        if (!parsed && badLines)
+        {
+            badLines->push_back(lineNumber);
+        }
+    }
+    return count;
+}
+
+bool KeyMap::Bind(std::string_view origin, std::string_view keys, std::string_view action)
+{
+    Binding binding;
+    while (!keys.empty())
+    {
+        size_t end = keys.find(' ');
+        uint16_t keystroke = 0;
+        if (binding.keystrokes.size() == 2 || !ParseKeystroke(keys.substr(0, end), &keystroke))
+        {
+            return false;
+        }
+        binding.keystrokes.push_back(keystroke);
+        keys = end == std::string_view::npos ? std::string_view() : Trim(keys.substr(end));
+    }
+    binding.action = InternAction(action);
+    if (binding.keystrokes.empty() || (binding.action == c_noAction && action != "none"))
+    {
+        return false;
+    }
+    m_layers[std::string(origin)].push_back(std::move(binding));
+    m_layouts.clear();
+    return true;
+}
+
+KeyMap::ActionId KeyMap::GetActionId(std::string_view name) const
+{
+    auto id = m_actionIds.find(std::string(name));
+    return id == m_actionIds.end() ? c_noAction : id->second;
+}
+
+const std::string& KeyMap::GetActionName(ActionId id) const
+{
+    return m_actionNames[id < m_actionNames.size() ? id : c_noAction];
+}
+
+const KeyMap::Layout& KeyMap::GetLayout(std::string_view uri)
+{
+    std::string origin = GetOrigin(uri);
+    auto layer = origin.empty() ? m_layers.end() : m_layers.find(origin);
+    if (layer == m_layers.end())
+    {
+        // Pages of origins without a layer share the default layout.
+        origin.clear();
+    }
+    auto cached = m_layouts.find(origin);
+    if (cached != m_layouts.end())
+    {
+        return cached->second;
+    }
+    Layout& layout = m_layouts[origin];
+    layout.actions.assign(c_tableSize, c_noAction);
+    auto defaultLayer = m_layers.find(std::string_view());
+    if (defaultLayer != m_layers.end())
+    {
+        Apply(defaultLayer->second, &layout);
+    }
+    if (layer != m_layers.end())
+    {
+        Apply(layer->second, &layout);
+    }
+    return layout;
+}
+
+KeyMap::ActionId KeyMap::Press(
+    const Layout& layout, ChordState* chord, uint8_t key, uint8_t modifiers)
+{
+    if (IsModifierKey(key))
+    {
+        return chord->prefix == c_noAction ? c_noAction : c_chordPending;
+    }
+    size_t keystroke = key * 8 + (modifiers & 7);
+    if (chord->prefix != c_noAction)
+    {
+        size_t table = (chord->prefix & ~c_chordFlag) + 1;
+        chord->prefix = c_noAction;
+        size_t index = table * c_tableSize + keystroke;
+        // The layout may have changed since the chord started.
+        if (index >= layout.actions.size() || (layout.actions[index] & c_chordFlag))
+        {
+            return c_noAction;
+        }
+        return layout.actions[index];
+    }
+    ActionId action = layout.actions[keystroke];
+    if (action & c_chordFlag)
+    {
+        chord->prefix = action;
+        return c_chordPending;
+    }
+    return action;
+}
+
+std::string KeyMap::GetOrigin(std::string_view uri)
+{
+    size_t scheme = uri.find("://");
+    if (scheme == std::string_view::npos || scheme == 0)
+    {
+        return std::string();
+    }
+    size_t end = uri.find_first_of("/?#", scheme + 3);
+    std::string origin(uri.substr(0, end));
+    if (origin.size() == scheme + 3)
+    {
+        return std::string();
+    }
+    std::transform(
+        origin.begin(), origin.end(), origin.begin(),
+        [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return origin;
+}
+
+uint8_t KeyMap::ParseKey(std::string_view name)
+{
+    if (name.size() == 1 && isalnum(static_cast<unsigned char>(name[0])))
+    {
+        return static_cast<uint8_t>(toupper(static_cast<unsigned char>(name[0])));
+    }
+    if (name.size() >= 2 && (name[0] == 'F' || name[0] == 'f') &&
+        isdigit(static_cast<unsigned char>(name[1])))
+    {
+        int number = atoi(std::string(name.substr(1)).c_str());
+        bool digits = name.substr(1).find_first_not_of("0123456789") == std::string_view::npos;
+        // VK_F1 is 0x70.
+        return digits && number >= 1 && number <= 24 ? static_cast<uint8_t>(0x6F + number) : 0;
+    }
+    if (name.size() > 2 && name[0] == '0' && (name[1] == 'x' || name[1] == 'X'))
+    {
+        char* end = nullptr;
+        std::string hex(name.substr(2));
+        unsigned long key = strtoul(hex.c_str(), &end, 16);
+        return *end == '\0' && key > 0 && key < c_keyCount ? static_cast<uint8_t>(key) : 0;
+    }
+    for (const KeyName& keyName : c_keyNames)
+    {
+        if (EqualsIgnoringCase(name, keyName.name))
+        {
+            return keyName.key;
+        }
+    }
+    return 0;
+}
+
+bool KeyMap::ParseKeystroke(std::string_view text, uint16_t* keystroke)
+{
+    uint8_t modifiers = None;
+    size_t plus;
+    while ((plus = text.find('+')) != std::string_view::npos)
+    {
+        std::string_view modifier = text.substr(0, plus);
+        if (EqualsIgnoringCase(modifier, "Ctrl") || EqualsIgnoringCase(modifier, "Control"))
+        {
+            modifiers |= Control;
+        }
+        else if (EqualsIgnoringCase(modifier, "Shift"))
+        {
+            modifiers |= Shift;
+        }
+        else if (EqualsIgnoringCase(modifier, "Alt"))
+        {
+            modifiers |= Alt;
+        }
+        else
+        {
+            return false;
+        }
+        text.remove_prefix(plus + 1);
+    }
+    uint8_t key = ParseKey(text);
+    if (key == 0 || IsModifierKey(key))
+    {
+        return false;
+    }
+    *keystroke = static_cast<uint16_t>(key * 8 + modifiers);
+    return true;
+}
+
+KeyMap::ActionId KeyMap::InternAction(std::string_view name)
+{
+    if (name.empty() || name == "none")
+    {
+        return c_noAction;
+    }
+    std::string key(name);
+    auto id = m_actionIds.find(key);
+    if (id != m_actionIds.end())
+    {
+        return id->second;
+    }
+    if (m_actionNames.size() >= c_maxActions)
+    {
+        return c_noAction;
+    }
+    ActionId newId = static_cast<ActionId>(m_actionNames.size());
+    m_actionNames.push_back(key);
+    m_actionIds.emplace(std::move(key), newId);
+    return newId;
+}
+
+void KeyMap::Apply(const std::vector<Binding>& bindings, Layout* layout)
+{
+    for (const Binding& binding : bindings)
+    {
+        size_t first = binding.keystrokes[0];
+        if (binding.keystrokes.size() == 1)
+        {
+            layout->actions[first] = binding.action;
+            continue;
+        }
+        if (!(layout->actions[first] & c_chordFlag))
+        {
+            size_t table = layout->actions.size() / c_tableSize - 1;
+            layout->actions[first] = static_cast<ActionId>(c_chordFlag | table);
+            layout->actions.resize(layout->actions.size() + c_tableSize, c_noAction);
+        }
+        size_t table = (layout->actions[first] & ~c_chordFlag) + 1;
+        layout->actions[table * c_tableSize + binding.keystrokes[1]] = binding.action;
+    }
+}
@@ -0,0 +1,117 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// KeyMap binds accelerator keys to named actions, such as "Ctrl+W =
+// close-webview", and resolves each keystroke with one table lookup.
+//
+// Bindings form layers: the default layer applies to every page, and a layer
+// for an origin overrides it for that origin's pages, where binding a key to
+// "none" unbinds it. GetLayout merges the layers for a URI into a Layout once,
+// typically per navigation, and caches it by origin. A Layout is a table of
+// action IDs indexed by virtual-key code and modifiers. A chord, such as
+// "Ctrl+K Ctrl+D", is two keystrokes: the first one's entry refers to a
+// second table for the keystroke that follows it.
+//
+// The config format is one "keys = action" binding per line, with "[origin]"
+// starting the bindings of an origin and "[*]" going back to the default
+// layer. Keys are modifiers and a key name joined by '+', such as "Ctrl+Shift+
+// F5". Key names are letters, digits, F1 to F24, names such as Tab, Esc, Left
+// or Plus, and hexadecimal virtual-key codes such as "0x7B". '#' starts a
+// comment line.
+//
+// Virtual-key codes are those of Win32, as numbers. Not thread-safe. Has no
+// dependency on Win32.
+class KeyMap
+{
+public:
+    using ActionId = uint16_t;
+
+    enum Modifiers : uint8_t
+    {
+        None = 0,
+        Control = 1,
+        Shift = 2,
+        Alt = 4,
+    };
+
+    static constexpr ActionId c_noAction = 0;
+    // Returned by Press for the first keystroke of a chord.
+    static constexpr ActionId c_chordPending = 0x7FFF;
+    static constexpr size_t c_keyCount = 256;
+    static constexpr size_t c_tableSize = c_keyCount * 8;
+
+    struct Layout
+    {
+        // c_tableSize entries for single keystrokes, followed by a table of
+        // c_tableSize entries for each chord prefix.
+        std::vector<ActionId> actions;
+    };
+
+    // The prefix of a chord in progress. One per keyboard focus.
+    struct ChordState
+    {
+        ActionId prefix = c_noAction;
+    };
+
+    // Returns the number of bindings added. The numbers of the lines that
+    // could not be parsed are added to `badLines`, if given.
+    size_t Load(std::istream& config, std::vector<size_t>* badLines = nullptr);
+    // `origin` is empty for the default layer. Returns false if `keys` or
+    // `action` cannot be parsed.
+    bool Bind(std::string_view origin, std::string_view keys, std::string_view action);
+
+    // IDs start at 1 and are never reused. c_noAction if unknown.
+    ActionId GetActionId(std::string_view name) const;
+    const std::string& GetActionName(ActionId id) const;
+    size_t GetActionCount() const
+    {
+        return m_actionNames.size();
+    }
+
+    // Returns the layout for pages at `uri`. Valid until the map changes.
+    const Layout& GetLayout(std::string_view uri);
+
+    // Returns the action of the keystroke, c_chordPending or c_noAction.
+    // Presses of the modifier keys themselves keep a chord pending, and any
+    // other keystroke ends it.
+    static ActionId Press(
+        const Layout& layout, ChordState* chord, uint8_t key, uint8_t modifiers);
+
+    // Returns "scheme://host[:port]" in lower case, or an empty string.
+    static std::string GetOrigin(std::string_view uri);
+    // Returns 0 if `name` is not a key name.
+    static uint8_t ParseKey(std::string_view name);
+
+private:
+    struct Binding
+    {
+        // One keystroke, or two for a chord. A keystroke is the virtual-key
+        // code times 8 plus the modifiers.
+        std::vector<uint16_t> keystrokes;
+        ActionId action;
+    };
+
+    static bool ParseKeystroke(std::string_view text, uint16_t* keystroke);
+    ActionId InternAction(std::string_view name);
+    static void Apply(const std::vector<Binding>& bindings, Layout* layout);
+
+    // By origin, with the default layer under "".
+    std::map<std::string, std::vector<Binding>, std::less<>> m_layers;
+    // Index 0 is c_noAction, named "none".
+    std::vector<std::string> m_actionNames = {"none"};
+    std::unordered_map<std::string, ActionId> m_actionIds;
+    // By origin, for the origins that have a layer, and under "" for the rest.
+    std::unordered_map<std::string, Layout> m_layouts;
+};
@@ -0,0 +1,350 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "NavigationTimingCollector.h"
+
+#include <cstdio>
+
+namespace
+{
+constexpr char c_otherOrigin[] = "(other)";
+constexpr double c_percentiles[] = {50, 90, 99};
+
+char ToLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+void AppendMilliseconds(std::string& out, double micros)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", micros / 1000);
+    out += buffer;
+}
+
+void AppendJsonString(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void AppendCsvField(std::string& out, const std::string& text)
+{
+    if (text.find_first_of(",\"\r\n") == std::string::npos)
+    {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"')
+        {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+} // namespace
+
+NavigationTimingCollector::NavigationTimingCollector(const Limits& limits) : m_limits(limits)
+{
+}
+
+std::string NavigationTimingCollector::GetOrigin(std::string_view uri)
+{
+    size_t schemeEnd = uri.find(':');
+    if (schemeEnd == std::string_view::npos)
+    {
+        return c_otherOrigin;
+    }
+    std::string origin;
+    for (char c : uri.substr(0, schemeEnd))
+    {
+        origin += ToLower(c);
+    }
+    origin += ':';
+    // URIs without an authority, such as data: URIs, would make an origin of
+    // every document, so only their scheme is kept.
+    if (uri.compare(schemeEnd, 3, "://") != 0)
+    {
+        return origin;
+    }
+    origin += "//";
+    size_t hostStart = schemeEnd + 3;
+    size_t hostEnd = uri.find_first_of("/?#", hostStart);
+    std::string_view authority = uri.substr(hostStart, hostEnd - hostStart);
+    size_t userInfoEnd = authority.rfind('@');
+    if (userInfoEnd != std::string_view::npos)
+    {
+        authority.remove_prefix(userInfoEnd + 1);
+    }
+    for (char c : authority)
+    {
+        origin += ToLower(c);
+    }
+    return origin;
+}
+
+const char* NavigationTimingCollector::GetPhaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::StartToContentLoading:
+        return "startToContentLoading";
+    case Phase::ContentLoadingToDOMContentLoaded:
+        return "contentLoadingToDOMContentLoaded";
+    case Phase::DOMContentLoadedToCompleted:
+        return "domContentLoadedToCompleted";
+    case Phase::Total:
+        return "total";
+    case Phase::FrameTotal:
+        return "frameTotal";
+    default:
+        return "unknown";
+    }
+}
+
+NavigationTimingCollector::OriginStats* NavigationTimingCollector::GetOriginStats(
+    std::string_view uri)
+{
+    std::string origin = GetOrigin(uri);
+    auto it = m_origins.find(origin);
+    if (it != m_origins.end())
+    {
+        return &it->second;
+    }
+    if (m_origins.size() >= m_limits.maxOrigins)
+    {
+        origin = c_otherOrigin;
+    }
+    return &m_origins[origin];
+}
+
+NavigationTimingCollector::Pending* NavigationTimingCollector::Find(
+    uint64_t source, uint64_t navigationId)
+{
+    auto it = m_pending.find(Key{source, navigationId});
+    if (it == m_pending.end())
+    {
+        m_counters.unmatched++;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void NavigationTimingCollector::DropExpired(uint64_t nowMicros)
+{
+    while (!m_startOrder.empty())
+    {
+        const auto& front = m_startOrder.front();
+        auto it = m_pending.find(front.first);
+        bool live = it != m_pending.end() && it->second.start == front.second;
+        if (live)
+        {
+            bool expired = nowMicros - front.second > m_limits.pendingTimeoutMicros;
+            if (!expired && m_pending.size() <= m_limits.maxPending)
+            {
+                break;
+            }
+            m_pending.erase(it);
+            m_counters.dropped++;
+        }
+        m_startOrder.pop_front();
+    }
+}
+
+void NavigationTimingCollector::OnStarting(
+    uint64_t source, uint64_t navigationId, std::string_view uri, bool isFrame,
+    uint64_t nowMicros)
+{
+    Key key{source, navigationId};
+    // A redirect starts the same navigation again; keep its first start.
+    if (m_pending.find(key) == m_pending.end())
+    {
+        m_pending.emplace(key, Pending{GetOriginStats(uri), isFrame, nowMicros});
+        m_startOrder.emplace_back(key, nowMicros);
+    }
+    DropExpired(nowMicros);
+}
+
+void NavigationTimingCollector::OnContentLoading(
+    uint64_t source, uint64_t navigationId, uint64_t nowMicros)
+{
+    if (Pending* pending = Find(source, navigationId))
+    {
+        pending->contentLoading = nowMicros;
+    }
+}
+
+void NavigationTimingCollector::OnDOMContentLoaded(
+    uint64_t source, uint64_t navigationId, uint64_t nowMicros)
+{
+    if (Pending* pending = Find(source, navigationId))
+    {
+        pending->domContentLoaded = nowMicros;
+    }
+}
+
+void NavigationTimingCollector::OnCompleted(
+    uint64_t source, uint64_t navigationId, bool success, uint64_t nowMicros)
+{
+    auto it = m_pending.find(Key{source, navigationId});
+    if (it == m_pending.end())
+    {
+        m_counters.unmatched++;
+        return;
+    }
+    const Pending& pending = it->second;
+    OriginStats& origin = *pending.origin;
+    origin.navigations++;
+    if (!success)
+    {
+        origin.failed++;
+        m_counters.failed++;
+        m_pending.erase(it);
+        return;
+    }
+    auto record = [&origin](Phase phase, uint64_t from, uint64_t to)
+    {
+        // A zero time means the event was not seen, for example because the
+        // navigation was served from the back/forward cache.
+        if (from && to >= from)
+        {
+            origin.phases[static_cast<size_t>(phase)].Record(to - from);
+        }
+    };
+    if (pending.isFrame)
+    {
+        record(Phase::FrameTotal, pending.start, nowMicros);
+    }
+    else
+    {
+        record(Phase::StartToContentLoading, pending.start, pending.contentLoading);
+        record(
+            Phase::ContentLoadingToDOMContentLoaded, pending.contentLoading,
+            pending.domContentLoaded);
+        record(Phase::DOMContentLoadedToCompleted, pending.domContentLoaded, nowMicros);
+        record(Phase::Total, pending.start, nowMicros);
+    }
+    m_counters.completed++;
+    m_pending.erase(it);
+}
+
+void NavigationTimingCollector::RemoveSource(uint64_t source)
+{
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        it = it->first.source == source ? m_pending.erase(it) : std::next(it);
+    }
+}
+
+void NavigationTimingCollector::Reset()
+{
+    m_counters = Counters();
+    m_pending.clear();
+    m_startOrder.clear();
+    m_origins.clear();
+}
+
+std::string NavigationTimingCollector::ExportJson() const
+{
+    std::string out = "{\"origins\":[";
+    bool firstOrigin = true;
+    for (const auto& origin : m_origins)
+    {
+        out += firstOrigin ? "\n" : ",\n";
+        firstOrigin = false;
+        out += "{\"origin\":";
+        AppendJsonString(out, origin.first);
+        out += ",\"navigations\":" + std::to_string(origin.second.navigations);
+        out += ",\"failed\":" + std::to_string(origin.second.failed);
+        out += ",\"phases\":{";
+        bool firstPhase = true;
+        for (size_t i = 0; i < origin.second.phases.size(); i++)
+        {
+            const HdrHistogram& histogram = origin.second.phases[i];
+            if (!histogram.GetCount())
+            {
+                continue;
+            }
+            out += firstPhase ? "" : ",";
+            firstPhase = false;
+            out += '"';
+            out += GetPhaseName(static_cast<Phase>(i));
+            out += "\":{\"count\":" + std::to_string(histogram.GetCount());
+            out += ",\"minMs\":";
+            AppendMilliseconds(out, double(histogram.GetMin()));
+            out += ",\"meanMs\":";
+            AppendMilliseconds(out, histogram.GetMean());
+            for (double percentile : c_percentiles)
+            {
+                out += ",\"p" + std::to_string(int(percentile)) + "Ms\":";
+                AppendMilliseconds(out, double(histogram.GetValueAtPercentile(percentile)));
+            }
+            out += ",\"maxMs\":";
+            AppendMilliseconds(out, double(histogram.GetMax()));
+            out += '}';
+        }
+        out += "}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+std::string NavigationTimingCollector::ExportCsv() const
+{
+    std::string out = "origin,phase,count,minMs,meanMs";
+    for (double percentile : c_percentiles)
+    {
+        out += ",p" + std::to_string(int(percentile)) + "Ms";
+    }
+    out += ",maxMs\n";
+    for (const auto& origin : m_origins)
+    {
+        for (size_t i = 0; i < origin.second.phases.size(); i++)
+        {
+            const HdrHistogram& histogram = origin.second.phases[i];
+            if (!histogram.GetCount())
+            {
+                continue;
+            }
+            AppendCsvField(out, origin.first);
+            out += ',';
+            out += GetPhaseName(static_cast<Phase>(i));
+            out += ',' + std::to_string(histogram.GetCount()) + ',';
+            AppendMilliseconds(out, double(histogram.GetMin()));
+            out += ',';
+            AppendMilliseconds(out, histogram.GetMean());
+            for (double percentile : c_percentiles)
+            {
+                out += ',';
+                AppendMilliseconds(out, double(histogram.GetValueAtPercentile(percentile)));
+            }
+            out += ',';
+            AppendMilliseconds(out, double(histogram.GetMax()));
+            out += '\n';
+        }
+    }
+    return out;
+}
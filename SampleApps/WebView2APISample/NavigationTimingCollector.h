@@ -0,0 +1,153 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "HdrHistogram.h"
+
+// NavigationTimingCollector joins the navigation events of WebViews by their
+// navigation ID and aggregates the time between them per origin. A main frame
+// navigation goes through Starting, ContentLoading, DOMContentLoaded and
+// Completed; a frame navigation only through Starting and Completed. Redirects
+// raise Starting again with the same ID, and the first start is kept.
+//
+// Memory stays bounded for long sessions: at most Limits::maxPending
+// navigations are tracked at once, the oldest being dropped first, and after
+// Limits::maxOrigins origins further origins are aggregated as "(other)".
+//
+// Times are in microseconds, above zero, on any monotonic clock. Navigation
+// IDs only need to be unique per source, such as a WebView. Not thread-safe.
+// Strings are UTF-8. Has no dependency on Win32.
+class NavigationTimingCollector
+{
+public:
+    enum class Phase
+    {
+        // Main frame: from Starting to ContentLoading, roughly the time until
+        // the response started to arrive.
+        StartToContentLoading,
+        ContentLoadingToDOMContentLoaded,
+        DOMContentLoadedToCompleted,
+        // Main frame: from Starting to Completed.
+        Total,
+        // Frames: from Starting to Completed.
+        FrameTotal,
+        Count
+    };
+
+    struct Limits
+    {
+        size_t maxPending = 1024;
+        size_t maxOrigins = 64;
+        // Navigations pending for longer than this are dropped.
+        uint64_t pendingTimeoutMicros = 10ull * 60 * 1000 * 1000;
+    };
+
+    struct Counters
+    {
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        // Events for navigations that were not started or already dropped.
+        uint64_t unmatched = 0;
+        uint64_t dropped = 0;
+    };
+
+    NavigationTimingCollector() = default;
+    explicit NavigationTimingCollector(const Limits& limits);
+
+    void OnStarting(
+        uint64_t source, uint64_t navigationId, std::string_view uri, bool isFrame,
+        uint64_t nowMicros);
+    void OnContentLoading(uint64_t source, uint64_t navigationId, uint64_t nowMicros);
+    void OnDOMContentLoaded(uint64_t source, uint64_t navigationId, uint64_t nowMicros);
+    // Failed navigations are counted for their origin but not timed.
+    void OnCompleted(uint64_t source, uint64_t navigationId, bool success, uint64_t nowMicros);
+
+    // Drops the pending navigations of `source`, such as a closed WebView.
+    void RemoveSource(uint64_t source);
+    void Reset();
+
+    const Counters& GetCounters() const
+    {
+        return m_counters;
+    }
+    size_t GetPendingCount() const
+    {
+        return m_pending.size();
+    }
+    size_t GetOriginCount() const
+    {
+        return m_origins.size();
+    }
+
+    // One object per origin with the count, min, mean, percentiles and max of
+    // each phase, in milliseconds.
+    std::string ExportJson() const;
+    // One row per origin and phase, with the same columns as ExportJson.
+    std::string ExportCsv() const;
+
+    // "scheme://host[:port]" of `uri`, lower case, or only "scheme:" if it has
+    // no authority, such as "about:blank".
+    static std::string GetOrigin(std::string_view uri);
+    static const char* GetPhaseName(Phase phase);
+
+private:
+    struct Key
+    {
+        uint64_t source;
+        uint64_t navigationId;
+        bool operator==(const Key& other) const
+        {
+            return source == other.source && navigationId == other.navigationId;
+        }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<uint64_t>()(
+                key.source * 0x9E3779B97F4A7C15ull ^ key.navigationId);
+        }
+    };
+
+    struct OriginStats
+    {
+        uint64_t navigations = 0;
+        uint64_t failed = 0;
+        std::array<HdrHistogram, static_cast<size_t>(Phase::Count)> phases;
+    };
+
+    struct Pending
+    {
+        OriginStats* origin;
+        bool isFrame;
+        uint64_t start;
+        uint64_t contentLoading = 0;
+        uint64_t domContentLoaded = 0;
+    };
+
+    OriginStats* GetOriginStats(std::string_view uri);
+    Pending* Find(uint64_t source, uint64_t navigationId);
+    void DropExpired(uint64_t nowMicros);
+
+    Limits m_limits;
+    Counters m_counters;
+    std::unordered_map<Key, Pending, KeyHash> m_pending;
+    // Pending navigations by start time. Entries whose navigation completed
+    // are skipped when they reach the front.
+    std::deque<std::pair<Key, uint64_t>> m_startOrder;
+    // Sorted, so that exports are stable. Nodes are never moved, so pending
+    // navigations can point at their origin.
+    std::map<std::string, OriginStats, std::less<>> m_origins;
+};
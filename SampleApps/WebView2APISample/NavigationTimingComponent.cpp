@@ -0,0 +1,214 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "NavigationTimingComponent.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "CheckFailure.h"
+#include "NavigationTimingCollector.h"
+#include "StringConversion.h"
+#include "resource.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+// The timings of all windows, which may run on different threads.
+struct SharedTimings
+{
+    std::mutex mutex;
+    NavigationTimingCollector collector;
+};
+
+SharedTimings& GetSharedTimings()
+{
+    static SharedTimings s_timings;
+    return s_timings;
+}
+
+uint64_t GetNowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+HRESULT OnNavigationStarting(
+    uint64_t source, ICoreWebView2NavigationStartingEventArgs* args, bool isFrame)
+{
+    // Read the clock first so that the time does not include the calls below.
+    uint64_t now = GetNowMicros();
+    UINT64 navigationId = 0;
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+    CHECK_FAILURE(args->get_Uri(&uri));
+    SharedTimings& timings = GetSharedTimings();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    timings.collector.OnStarting(source, navigationId, ToUtf8(uri.get()), isFrame, now);
+    return S_OK;
+}
+
+HRESULT OnNavigationCompleted(uint64_t source, ICoreWebView2NavigationCompletedEventArgs* args)
+{
+    uint64_t now = GetNowMicros();
+    UINT64 navigationId = 0;
+    BOOL success = FALSE;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+    CHECK_FAILURE(args->get_IsSuccess(&success));
+    SharedTimings& timings = GetSharedTimings();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    timings.collector.OnCompleted(source, navigationId, !!success, now);
+    return S_OK;
+}
+} // namespace
+
+NavigationTimingComponent::NavigationTimingComponent(AppWindow* appWindow)
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
+{
+    uint64_t source = reinterpret_cast<uint64_t>(this);
+    CHECK_FAILURE(m_webView->add_NavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [source](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT { return OnNavigationStarting(source, args, false); })
+            .Get(),
+        &m_navigationStartingToken));
+
+    CHECK_FAILURE(m_webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [source](ICoreWebView2* sender, ICoreWebView2ContentLoadingEventArgs* args)
+                -> HRESULT
+            {
+                uint64_t now = GetNowMicros();
+                UINT64 navigationId = 0;
+                CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                SharedTimings& timings = GetSharedTimings();
+                std::lock_guard<std::mutex> lock(timings.mutex);
+                timings.collector.OnContentLoading(source, navigationId, now);
+                return S_OK;
+            })
+            .Get(),
+        &m_contentLoadingToken));
+
+    m_webView2 = m_webView.try_query<ICoreWebView2_2>();
+    if (m_webView2)
+    {
+        CHECK_FAILURE(m_webView2->add_DOMContentLoaded(
+            Callback<ICoreWebView2DOMContentLoadedEventHandler>(
+                [source](ICoreWebView2* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
+                    -> HRESULT
+                {
+                    uint64_t now = GetNowMicros();
+                    UINT64 navigationId = 0;
+                    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                    SharedTimings& timings = GetSharedTimings();
+                    std::lock_guard<std::mutex> lock(timings.mutex);
+                    timings.collector.OnDOMContentLoaded(source, navigationId, now);
+                    return S_OK;
+                })
+                .Get(),
+            &m_DOMContentLoadedToken));
+    }
+
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [source](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT { return OnNavigationCompleted(source, args); })
+            .Get(),
+        &m_navigationCompletedToken));
+
+    CHECK_FAILURE(m_webView->add_FrameNavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [source](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT { return OnNavigationStarting(source, args, true); })
+            .Get(),
+        &m_frameNavigationStartingToken));
+
+    CHECK_FAILURE(m_webView->add_FrameNavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [source](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT { return OnNavigationCompleted(source, args); })
+            .Get(),
+        &m_frameNavigationCompletedToken));
+}
+
+bool NavigationTimingComponent::HandleWindowMessage(
+    HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result)
+{
+    if (message == WM_COMMAND)
+    {
+        switch (LOWORD(wParam))
+        {
+        case IDM_SCENARIO_NAVIGATION_TIMING_EXPORT_JSON:
+            Export(true);
+            return true;
+        case IDM_SCENARIO_NAVIGATION_TIMING_EXPORT_CSV:
+            Export(false);
+            return true;
+        case IDM_SCENARIO_NAVIGATION_TIMING_RESET:
+        {
+            SharedTimings& timings = GetSharedTimings();
+            std::lock_guard<std::mutex> lock(timings.mutex);
+            timings.collector.Reset();
+            return true;
+        }
+        }
+    }
+    return false;
+}
+
+void NavigationTimingComponent::Export(bool json)
+{
+    std::wstring path = m_appWindow->GetLocalPath(
+        json ? L"NavigationTimings.json" : L"NavigationTimings.csv", false);
+    std::string text;
+    NavigationTimingCollector::Counters counters;
+    size_t originCount = 0;
+    {
+        SharedTimings& timings = GetSharedTimings();
+        std::lock_guard<std::mutex> lock(timings.mutex);
+        text = json ? timings.collector.ExportJson() : timings.collector.ExportCsv();
+        counters = timings.collector.GetCounters();
+        originCount = timings.collector.GetOriginCount();
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(text.data(), text.size());
+    out.close();
+
+    std::wstringstream message;
+    if (!out)
+    {
+        message << L"Failed to write " << path;
+    }
+    else
+    {
+        message << L"Exported the timings of " << counters.completed << L" navigations across "
+                << originCount << L" origins to " << path << L"\n\nFailed: " << counters.failed
+                << L"\nDropped before completing: " << counters.dropped;
+    }
+    m_appWindow->AsyncMessageBox(message.str(), L"Navigation Timing");
+}
+
+NavigationTimingComponent::~NavigationTimingComponent()
+{
+    m_webView->remove_NavigationStarting(m_navigationStartingToken);
+    m_webView->remove_ContentLoading(m_contentLoadingToken);
+    if (m_webView2)
+    {
+        m_webView2->remove_DOMContentLoaded(m_DOMContentLoadedToken);
+    }
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+    m_webView->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
+    m_webView->remove_FrameNavigationCompleted(m_frameNavigationCompletedToken);
+
+    SharedTimings& timings = GetSharedTimings();
+    std::lock_guard<std::mutex> lock(timings.mutex);
+    timings.collector.RemoveSource(reinterpret_cast<uint64_t>(this));
+}
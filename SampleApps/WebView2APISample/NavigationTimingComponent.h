@@ -0,0 +1,39 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include "AppWindow.h"
+#include "ComponentBase.h"
+
+// NavigationTimingComponent times the navigations of its WebView, from
+// NavigationStarting through ContentLoading and DOMContentLoaded to
+// NavigationCompleted, and of its frames. The timings of all windows are
+// aggregated per origin by one NavigationTimingCollector, which the
+// Scenario > Navigation Timing menu exports as JSON or CSV.
+class NavigationTimingComponent : public ComponentBase
+{
+public:
+    NavigationTimingComponent(AppWindow* appWindow);
+    ~NavigationTimingComponent() override;
+
+    bool HandleWindowMessage(
+        HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result) override;
+
+private:
+    void Export(bool json);
+
+    AppWindow* m_appWindow = nullptr;
+    wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2_2> m_webView2;
+
+    EventRegistrationToken m_navigationStartingToken = {};
+    EventRegistrationToken m_contentLoadingToken = {};
+    EventRegistrationToken m_DOMContentLoadedToken = {};
+    EventRegistrationToken m_navigationCompletedToken = {};
+    EventRegistrationToken m_frameNavigationStartingToken = {};
+    EventRegistrationToken m_frameNavigationCompletedToken = {};
+};
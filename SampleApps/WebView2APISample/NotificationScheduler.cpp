@@ -0,0 +1,185 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "NotificationScheduler.h"
+
+#include <algorithm>
+
+NotificationScheduler::NotificationScheduler() : NotificationScheduler(Limits())
+{
+}
+
+NotificationScheduler::NotificationScheduler(const Limits& limits) : m_limits(limits)
+{
+}
+
+NotificationScheduler::SubmitResult NotificationScheduler::Submit(
+    uint64_t id, const std::wstring& origin, const std::wstring& tag, bool renotify,
+    uint64_t nowMs)
+{
+    SubmitResult result;
+    m_counters.received++;
+
+    // Notifications without a tag never replace each other.
+    std::wstring tagKey = tag.empty() ? std::wstring() : MakeTagKey(origin, tag);
+    if (!tagKey.empty())
+    {
+        // A pending notification with the same tag hasn't been seen yet, so
+        // swapping it in place costs the user nothing and keeps its position.
+        auto queued = m_queuedTags.find(tagKey);
+        if (queued != m_queuedTags.end())
+        {
+            for (auto& entry : m_queue)
+            {
+                if (entry.id == queued->second)
+                {
+                    entry.id = id;
+                    break;
+                }
+            }
+            result.disposition = Disposition::ReplacedQueued;
+            result.replacedId = queued->second;
+            queued->second = id;
+            m_counters.merged++;
+            return result;
+        }
+        // Without renotify the replacement updates the notification on screen
+        // silently, which is how browsers treat a repeated tag.
+        if (m_activeId != 0 && m_activeTagKey == tagKey && !renotify)
+        {
+            result.disposition = Disposition::ReplacedActive;
+            result.replacedId = m_activeId;
+            m_activeId = id;
+            m_counters.merged++;
+            return result;
+        }
+    }
+
+    if (m_queue.size() >= m_limits.maxQueued)
+    {
+        result.disposition = Disposition::QueueFull;
+        m_counters.droppedQueueFull++;
+        return result;
+    }
+    if (!TryConsumeToken(origin, nowMs))
+    {
+        result.disposition = Disposition::RateLimited;
+        m_counters.droppedRateLimited++;
+        return result;
+    }
+
+    // A renotify of the active tag is queued as a fresh notification; the one
+    // on screen is retired once the new one is presented.
+    m_queue.push_back({id, tagKey});
+    if (!tagKey.empty())
+    {
+        m_queuedTags[tagKey] = id;
+    }
+    result.disposition = Disposition::Queued;
+    return result;
+}
+
+bool NotificationScheduler::PresentNext(uint64_t* id)
+{
+    if (m_activeId != 0 || m_queue.empty())
+    {
+        return false;
+    }
+    Entry entry = std::move(m_queue.front());
+    m_queue.pop_front();
+    if (!entry.tagKey.empty())
+    {
+        m_queuedTags.erase(entry.tagKey);
+    }
+    m_activeId = entry.id;
+    m_activeTagKey = std::move(entry.tagKey);
+    m_counters.presented++;
+    *id = m_activeId;
+    return true;
+}
+
+bool NotificationScheduler::Remove(uint64_t id)
+{
+    if (id == 0)
+    {
+        return false;
+    }
+    if (id == m_activeId)
+    {
+        m_activeId = 0;
+        m_activeTagKey.clear();
+        return true;
+    }
+    auto it = std::find_if(
+        m_queue.begin(), m_queue.end(), [id](const Entry& entry) { return entry.id == id; });
+    if (it == m_queue.end())
+    {
+        return false;
+    }
+    if (!it->tagKey.empty())
+    {
+        m_queuedTags.erase(it->tagKey);
+    }
+    m_queue.erase(it);
+    return true;
+}
+
+bool NotificationScheduler::TryConsumeToken(const std::wstring& origin, uint64_t nowMs)
+{
+    if (m_buckets.size() >= m_sweepBucketCount)
+    {
+        SweepBuckets(nowMs);
+    }
+    auto inserted = m_buckets.try_emplace(origin);
+    Bucket& bucket = inserted.first->second;
+    if (inserted.second)
+    {
+        bucket.tokens = m_limits.burstSize;
+        bucket.lastRefillMs = nowMs;
+    }
+    else if (nowMs > bucket.lastRefillMs)
+    {
+        double elapsedSeconds = (nowMs - bucket.lastRefillMs) / 1000.0;
+        bucket.tokens = (std::min)(
+            m_limits.burstSize, bucket.tokens + elapsedSeconds * m_limits.tokensPerSecond);
+        bucket.lastRefillMs = nowMs;
+    }
+    if (bucket.tokens < 1.0)
+    {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+void NotificationScheduler::SweepBuckets(uint64_t nowMs)
+{
+    for (auto it = m_buckets.begin(); it != m_buckets.end();)
+    {
+        const Bucket& bucket = it->second;
+        double elapsedSeconds =
+            nowMs > bucket.lastRefillMs ? (nowMs - bucket.lastRefillMs) / 1000.0 : 0;
+        if (bucket.tokens + elapsedSeconds * m_limits.tokensPerSecond >= m_limits.burstSize)
+        {
+            it = m_buckets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    m_sweepBucketCount = (std::max)(c_minSweepBuckets, m_buckets.size() * 2);
+}
+
+std::wstring NotificationScheduler::MakeTagKey(
+    const std::wstring& origin, const std::wstring& tag)
+{
+    // Origins can't contain a newline, so this can't collide across origins.
+    std::wstring key;
+    key.reserve(origin.size() + 1 + tag.size());
+    key.append(origin);
+    key.push_back(L'\n');
+    key.append(tag);
+    return key;
+}
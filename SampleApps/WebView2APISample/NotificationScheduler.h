@@ -0,0 +1,133 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// NotificationScheduler decides which web notifications get presented and in
+// which order. It has no dependency on WebView2 or Win32 so it can be driven by
+// a simulated clock: every call that depends on time takes the current time in
+// milliseconds from the caller.
+//
+// Notifications are identified by a caller-assigned id. The scheduler applies
+// a token bucket per sender origin, coalesces notifications that share an
+// origin and tag, and keeps a bounded FIFO of notifications waiting to be
+// shown. At most one notification is considered "active" (on screen) at a
+// time. The bucket of an origin that has been idle long enough to refill is
+// dropped, as a new one would be the same, so senders that come and go don't
+// grow the scheduler.
+class NotificationScheduler
+{
+public:
+    struct Limits
+    {
+        // Sustained number of notifications per second accepted per origin.
+        double tokensPerSecond = 1.0;
+        // Number of notifications an origin may send in a burst.
+        double burstSize = 5.0;
+        // Maximum number of notifications waiting to be presented.
+        size_t maxQueued = 32;
+    };
+
+    enum class Disposition
+    {
+        // Added to the end of the queue.
+        Queued,
+        // Replaced a queued notification with the same tag in place.
+        ReplacedQueued,
+        // Replaced the active notification with the same tag without
+        // re-alerting the user (ShouldRenotify is false).
+        ReplacedActive,
+        // Dropped because the origin exceeded its rate limit.
+        RateLimited,
+        // Dropped because the queue is full.
+        QueueFull,
+    };
+
+    struct SubmitResult
+    {
+        Disposition disposition = Disposition::Queued;
+        // Id of the notification that was superseded, or 0.
+        uint64_t replacedId = 0;
+    };
+
+    struct Counters
+    {
+        uint64_t received = 0;
+        uint64_t presented = 0;
+        uint64_t merged = 0;
+        uint64_t droppedRateLimited = 0;
+        uint64_t droppedQueueFull = 0;
+    };
+
+    NotificationScheduler();
+    explicit NotificationScheduler(const Limits& limits);
+
+    // Offers a new notification. `id` must be non-zero and unique.
+    SubmitResult Submit(
+        uint64_t id, const std::wstring& origin, const std::wstring& tag, bool renotify,
+        uint64_t nowMs);
+
+    // Moves the next queued notification to the active slot. Returns false if
+    // a notification is already active or the queue is empty.
+    bool PresentNext(uint64_t* id);
+
+    // Removes a notification, whether it is queued or active. Returns true if
+    // the notification was known to the scheduler.
+    bool Remove(uint64_t id);
+
+    uint64_t GetActiveId() const
+    {
+        return m_activeId;
+    }
+    size_t GetQueuedCount() const
+    {
+        return m_queue.size();
+    }
+    const Counters& GetCounters() const
+    {
+        return m_counters;
+    }
+    size_t GetBucketCount() const
+    {
+        return m_buckets.size();
+    }
+
+private:
+    // The fewest buckets at which full ones are dropped.
+    static constexpr size_t c_minSweepBuckets = 64;
+
+    struct Bucket
+    {
+        double tokens = 0;
+        uint64_t lastRefillMs = 0;
+    };
+
+    struct Entry
+    {
+        uint64_t id = 0;
+        std::wstring tagKey;
+    };
+
+    bool TryConsumeToken(const std::wstring& origin, uint64_t nowMs);
+    // Drops the buckets that would be full by `nowMs`.
+    void SweepBuckets(uint64_t nowMs);
+    static std::wstring MakeTagKey(const std::wstring& origin, const std::wstring& tag);
+
+    Limits m_limits;
+    Counters m_counters;
+    std::unordered_map<std::wstring, Bucket> m_buckets;
+    // Sweeping when the buckets double keeps the cost per Submit constant.
+    size_t m_sweepBucketCount = c_minSweepBuckets;
+    std::deque<Entry> m_queue;
+    // Maps origin + tag to the id of the queued notification carrying it.
+    std::unordered_map<std::wstring, uint64_t> m_queuedTags;
+    uint64_t m_activeId = 0;
+    std::wstring m_activeTagKey;
+};
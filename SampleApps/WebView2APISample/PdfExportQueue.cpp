@@ -0,0 +1,249 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "PdfExportQueue.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "AppWindow.h"
+#include "CheckFailure.h"
+#include "PdfStreamSink.h"
+
+using namespace Microsoft::WRL;
+
+struct PdfExportQueue::Job
+{
+    AppWindow* appWindow = nullptr;
+    std::wstring path;
+    wil::com_ptr<IStream> pdfData;
+    std::unique_ptr<PdfStreamSink> sink;
+    // Set once the job is done, or failed because its window closed. Only
+    // used on the window's thread.
+    bool finished = false;
+};
+
+PdfExportQueue& PdfExportQueue::GetInstance()
+{
+    static PdfExportQueue s_instance;
+    return s_instance;
+}
+
+void PdfExportQueue::Enqueue(AppWindow* appWindow, const std::wstring& path)
+{
+    auto job = std::make_shared<Job>();
+    job->appWindow = appWindow;
+    job->path = path;
+    appWindow->AddRef();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running.empty() && m_pending.empty())
+        {
+            m_jobsSucceeded = 0;
+            m_jobsFailed = 0;
+            m_bytesWritten = 0;
+            m_pagesWritten = 0;
+            m_batchStartTick = GetTickCount64();
+        }
+        m_pending.push_back(std::move(job));
+    }
+    StartJobs();
+}
+
+void PdfExportQueue::StartJobs()
+{
+    std::vector<std::shared_ptr<Job>> jobsToStart;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_running.size() < c_maxConcurrentJobs && !m_pending.empty())
+        {
+            m_running.push_back(m_pending.front());
+            jobsToStart.push_back(std::move(m_pending.front()));
+            m_pending.pop_front();
+        }
+    }
+    for (auto& job : jobsToStart)
+    {
+        job->appWindow->RunAsync([job] { RunJob(job); });
+    }
+}
+
+// Runs on the thread of the job's AppWindow.
+void PdfExportQueue::RunJob(std::shared_ptr<Job> job)
+{
+    if (job->finished)
+    {
+        return;
+    }
+    ICoreWebView2* webView = job->appWindow->GetWebView();
+    wil::com_ptr<ICoreWebView2_16> webView2_16 =
+        webView ? wil::try_com_query<ICoreWebView2_16>(webView) : nullptr;
+    if (!webView2_16)
+    {
+        GetInstance().OnJobFinished(job, nullptr);
+        return;
+    }
+
+    CHECK_FAILURE(webView2_16->PrintToPdfStream(
+        nullptr, Callback<ICoreWebView2PrintToPdfStreamCompletedHandler>(
+                     [job](HRESULT errorCode, IStream* pdfData) -> HRESULT
+                     {
+                         if (job->finished)
+                         {
+                             return S_OK;
+                         }
+                         if (FAILED(errorCode) || !pdfData)
+                         {
+                             GetInstance().OnJobFinished(job, nullptr);
+                             return S_OK;
+                         }
+                         job->pdfData = pdfData;
+                         job->sink = std::make_unique<PdfStreamSink>(
+                             [stream = pdfData](void* buffer, size_t size) -> int64_t
+                             {
+                                 ULONG read = 0;
+                                 HRESULT hr =
+                                     stream->Read(buffer, static_cast<ULONG>(size), &read);
+                                 return FAILED(hr) ? -1 : static_cast<int64_t>(read);
+                             },
+                             job->path);
+                         // Copy on a later message loop iteration, not inside the
+                         // completion handler.
+                         job->appWindow->RunAsync([job] { WriteNextChunk(job); });
+                         return S_OK;
+                     })
+                     .Get()));
+}
+
+// Copies one chunk per posted task so the window keeps handling input while a
+// large PDF is written.
+void PdfExportQueue::WriteNextChunk(std::shared_ptr<Job> job)
+{
+    if (job->finished)
+    {
+        return;
+    }
+    if (job->sink->WriteChunk())
+    {
+        job->appWindow->RunAsync([job] { WriteNextChunk(job); });
+        return;
+    }
+    PdfStreamSink::Result result = job->sink->Finish();
+    job->sink.reset();
+    job->pdfData.reset();
+    GetInstance().OnJobFinished(job, &result);
+}
+
+void PdfExportQueue::OnJobFinished(
+    std::shared_ptr<Job> job, const PdfStreamSink::Result* result)
+{
+    std::wstring batchMessage;
+    if (FinishJob(job.get(), result, &batchMessage))
+    {
+        job->appWindow->AsyncMessageBox(batchMessage, L"PDF Export Completed");
+    }
+    // Dropping the reference may delete the window, so do it last.
+    job->appWindow->Release();
+    StartJobs();
+}
+
+void PdfExportQueue::OnWindowClosed(AppWindow* appWindow)
+{
+    std::vector<std::shared_ptr<Job>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& job : m_running)
+        {
+            if (job->appWindow == appWindow)
+            {
+                jobs.push_back(job);
+            }
+        }
+        for (auto job = m_pending.begin(); job != m_pending.end();)
+        {
+            if ((*job)->appWindow == appWindow)
+            {
+                jobs.push_back(std::move(*job));
+                job = m_pending.erase(job);
+            }
+            else
+            {
+                ++job;
+            }
+        }
+    }
+    for (const auto& job : jobs)
+    {
+        // The window can't show the batch's summary anymore.
+        std::wstring batchMessage;
+        FinishJob(job.get(), nullptr, &batchMessage);
+        // Don't leave a partly written PDF behind.
+        if (job->sink)
+        {
+            job->sink->Discard();
+        }
+        job->sink.reset();
+        job->pdfData.reset();
+        // The window itself still holds a reference.
+        appWindow->Release();
+    }
+    StartJobs();
+}
+
+bool PdfExportQueue::FinishJob(
+    Job* job, const PdfStreamSink::Result* result, std::wstring* batchMessage)
+{
+    job->finished = true;
+    bool succeeded = result && result->succeeded;
+
+    std::wstringstream jobMessage;
+    jobMessage << L"PdfExportQueue: " << job->path << L" "
+               << (succeeded ? L"written" : L"failed");
+    if (succeeded)
+    {
+        jobMessage << L", " << result->bytes << L" bytes, " << result->index.pageCount
+                   << L" pages, " << result->index.xrefOffsets.size()
+                   << L" xref sections, startxref " << result->index.startXref << L", "
+                   << std::fixed << std::setprecision(1)
+                   << (result->seconds > 0 ? result->bytes / result->seconds / (1024 * 1024)
+                                           : 0)
+                   << L" MB/s";
+    }
+    jobMessage << L"\n";
+    OutputDebugString(jobMessage.str().c_str());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto running = std::find_if(
+        m_running.begin(), m_running.end(),
+        [job](const std::shared_ptr<Job>& entry) { return entry.get() == job; });
+    if (running != m_running.end())
+    {
+        m_running.erase(running);
+    }
+    if (succeeded)
+    {
+        m_jobsSucceeded++;
+        m_bytesWritten += result->bytes;
+        m_pagesWritten += result->index.pageCount;
+    }
+    else
+    {
+        m_jobsFailed++;
+    }
+    if (!m_running.empty() || !m_pending.empty())
+    {
+        return false;
+    }
+    double seconds = (GetTickCount64() - m_batchStartTick) / 1000.0;
+    std::wstringstream message;
+    message << m_jobsSucceeded << L" PDFs written, " << m_jobsFailed << L" failed.\r\n"
+            << m_pagesWritten << L" pages, " << m_bytesWritten << L" bytes in " << std::fixed
+            << std::setprecision(2) << seconds << L" s.";
+    *batchMessage = message.str();
+    return true;
+}
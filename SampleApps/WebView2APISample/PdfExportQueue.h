@@ -0,0 +1,65 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PdfStreamSink.h"
+
+class AppWindow;
+
+// PdfExportQueue runs PrintToPdfStream jobs for any number of AppWindows, a
+// few at a time, and streams each result to disk with PdfStreamSink.
+//
+// There is one queue per process. Windows may live on different threads, so
+// each job runs on the thread of the AppWindow that queued it, through
+// AppWindow::RunAsync; the copy is done one chunk per posted task so the
+// window stays responsive while large PDFs are written. A window that closes
+// must call OnWindowClosed, as the tasks posted to it are never run.
+class PdfExportQueue
+{
+public:
+    static PdfExportQueue& GetInstance();
+
+    // Call on the thread of `appWindow`. Keeps a reference on the window until
+    // the job is done.
+    void Enqueue(AppWindow* appWindow, const std::wstring& path);
+    // Call on the thread of `appWindow` as it is destroyed. Fails the window's
+    // jobs, running or not, deletes their partly written files, and hands
+    // their slots to other windows' jobs.
+    void OnWindowClosed(AppWindow* appWindow);
+
+private:
+    struct Job;
+
+    PdfExportQueue() = default;
+
+    void StartJobs();
+    static void RunJob(std::shared_ptr<Job> job);
+    static void WriteNextChunk(std::shared_ptr<Job> job);
+    // `result` is null if the job failed before anything was written.
+    void OnJobFinished(std::shared_ptr<Job> job, const PdfStreamSink::Result* result);
+    // Logs the job and frees its slot. Returns true, with the batch's summary,
+    // if it was the last job of the batch.
+    bool FinishJob(Job* job, const PdfStreamSink::Result* result, std::wstring* batchMessage);
+
+    static constexpr size_t c_maxConcurrentJobs = 2;
+
+    std::mutex m_mutex;
+    std::deque<std::shared_ptr<Job>> m_pending;
+    std::vector<std::shared_ptr<Job>> m_running;
+    // Totals since the queue last drained.
+    size_t m_jobsSucceeded = 0;
+    size_t m_jobsFailed = 0;
+    uint64_t m_bytesWritten = 0;
+    uint64_t m_pagesWritten = 0;
+    ULONGLONG m_batchStartTick = 0;
+};
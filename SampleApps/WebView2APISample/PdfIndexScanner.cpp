@@ -0,0 +1,115 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PdfIndexScanner.h"
+
+#include <cstring>
+
+namespace
+{
+// Longest thing we match: "startxref", whitespace and a 20 digit offset.
+constexpr size_t c_lookahead = 64;
+
+bool IsWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\0';
+}
+
+bool IsDelimiter(char c)
+{
+    return std::strchr("()<>[]{}/%", c) != nullptr && c != '\0';
+}
+
+// True if `text` appears at `position` of `buffer`.
+bool MatchAt(const std::string& buffer, size_t position, const char* text, size_t length)
+{
+    return position + length <= buffer.size() &&
+           std::memcmp(buffer.data() + position, text, length) == 0;
+}
+
+size_t SkipWhitespace(const std::string& buffer, size_t position)
+{
+    while (position < buffer.size() && IsWhitespace(buffer[position]))
+    {
+        position++;
+    }
+    return position;
+}
+} // namespace
+
+void PdfIndexScanner::Feed(const void* data, size_t size)
+{
+    m_pending.append(static_cast<const char*>(data), size);
+    m_index.bytes += size;
+    if (m_pending.size() > c_lookahead)
+    {
+        Scan(false);
+    }
+}
+
+const PdfIndexScanner::Index& PdfIndexScanner::Finish()
+{
+    Scan(true);
+    return m_index;
+}
+
+void PdfIndexScanner::Scan(bool final)
+{
+    const std::string& buffer = m_pending;
+    size_t limit = final ? buffer.size() : buffer.size() - c_lookahead;
+    char previous = m_previous;
+    for (size_t i = 0; i < limit; previous = buffer[i], i++)
+    {
+        switch (buffer[i])
+        {
+        case '/':
+            // "/Type /Page" but not "/Type /Pages".
+            if (MatchAt(buffer, i, "/Type", 5))
+            {
+                size_t value = SkipWhitespace(buffer, i + 5);
+                if (MatchAt(buffer, value, "/Page", 5) &&
+                    (value + 5 == buffer.size() || IsWhitespace(buffer[value + 5]) ||
+                     IsDelimiter(buffer[value + 5])))
+                {
+                    m_index.pageCount++;
+                }
+            }
+            break;
+        case 'x':
+            if ((previous == '\n' || previous == '\r') && MatchAt(buffer, i, "xref", 4) &&
+                (i + 4 == buffer.size() || IsWhitespace(buffer[i + 4])))
+            {
+                m_index.xrefOffsets.push_back(m_pendingOffset + i);
+            }
+            break;
+        case 's':
+            if (MatchAt(buffer, i, "startxref", 9))
+            {
+                size_t digit = SkipWhitespace(buffer, i + 9);
+                int64_t offset = 0;
+                bool any = false;
+                while (digit < buffer.size() && buffer[digit] >= '0' && buffer[digit] <= '9')
+                {
+                    offset = offset * 10 + (buffer[digit] - '0');
+                    digit++;
+                    any = true;
+                }
+                if (any)
+                {
+                    m_index.startXref = offset;
+                }
+            }
+            break;
+        case '%':
+            if (MatchAt(buffer, i, "%%EOF", 5))
+            {
+                m_index.hasEofMarker = true;
+            }
+            break;
+        }
+    }
+    m_previous = previous;
+    m_pending.erase(0, limit);
+    m_pendingOffset += limit;
+}
@@ -0,0 +1,54 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PdfIndexScanner extracts indexing information from a PDF while it is being
+// written, one chunk at a time, without ever holding the whole document. It
+// doesn't parse the object graph: it counts page objects and records where
+// cross-reference data lives by looking for the relevant keywords. That is
+// exact for the PDFs WebView2 produces, which don't put page objects inside
+// compressed object streams.
+//
+// Has no dependency on Win32 so it can be built and measured on any platform.
+class PdfIndexScanner
+{
+public:
+    struct Index
+    {
+        uint64_t bytes = 0;
+        // Number of `/Type /Page` objects.
+        uint64_t pageCount = 0;
+        // File offsets of classic `xref` tables, in file order.
+        std::vector<uint64_t> xrefOffsets;
+        // Value of the last `startxref`, or -1 if there was none.
+        int64_t startXref = -1;
+        bool hasEofMarker = false;
+    };
+
+    void Feed(const void* data, size_t size);
+    // Scans whatever is left at the end of the document.
+    const Index& Finish();
+
+    const Index& GetIndex() const
+    {
+        return m_index;
+    }
+
+private:
+    void Scan(bool final);
+
+    // Bytes received but not scanned yet. Only the lookahead needed to match
+    // a keyword that straddles two chunks is carried over between calls.
+    std::string m_pending;
+    uint64_t m_pendingOffset = 0;
+    // The byte before m_pending, for keywords that must start a line.
+    char m_previous = '\n';
+    Index m_index;
+};
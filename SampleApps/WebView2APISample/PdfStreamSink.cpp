@@ -0,0 +1,67 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PdfStreamSink.h"
+
+PdfStreamSink::PdfStreamSink(
+    ReadFunction read, const std::filesystem::path& path, size_t chunkSize)
+    : m_read(std::move(read)), m_path(path), m_buffer(new char[chunkSize]),
+      m_chunkSize(chunkSize), m_start(std::chrono::steady_clock::now())
+{
+    // We already write in large chunks, so skip the stream's own buffering.
+    m_file.rdbuf()->pubsetbuf(nullptr, 0);
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    m_failed = !m_file;
+}
+
+bool PdfStreamSink::WriteChunk()
+{
+    if (m_failed || m_done)
+    {
+        return false;
+    }
+    int64_t read = m_read(m_buffer.get(), m_chunkSize);
+    if (read < 0)
+    {
+        m_failed = true;
+        return false;
+    }
+    if (read == 0)
+    {
+        m_done = true;
+        return false;
+    }
+    m_file.write(m_buffer.get(), read);
+    if (!m_file)
+    {
+        m_failed = true;
+        return false;
+    }
+    m_scanner.Feed(m_buffer.get(), static_cast<size_t>(read));
+    return true;
+}
+
+PdfStreamSink::Result PdfStreamSink::Finish()
+{
+    m_file.close();
+    Result result;
+    result.succeeded = m_done && !m_failed && !m_file.fail();
+    result.index = m_scanner.Finish();
+    result.bytes = result.index.bytes;
+    result.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    if (!result.succeeded)
+    {
+        Discard();
+    }
+    return result;
+}
+
+void PdfStreamSink::Discard()
+{
+    m_file.close();
+    m_failed = true;
+    std::error_code error;
+    std::filesystem::remove(m_path, error);
+}
@@ -0,0 +1,66 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+
+#include "PdfIndexScanner.h"
+
+// PdfStreamSink copies a PDF from a pull-style source to a file in fixed-size
+// chunks, indexing it with PdfIndexScanner on the way. Only one chunk is held
+// in memory at a time. Callers drive it with WriteChunk so they can interleave
+// the copy with other work, e.g. one chunk per message loop iteration.
+//
+// Has no dependency on Win32 or COM; the source is any function that reads.
+class PdfStreamSink
+{
+public:
+    // Reads up to `size` bytes into `buffer`. Returns the number of bytes read,
+    // 0 at the end of the stream, or a negative value on error.
+    using ReadFunction = std::function<int64_t(void* buffer, size_t size)>;
+
+    struct Result
+    {
+        bool succeeded = false;
+        uint64_t bytes = 0;
+        double seconds = 0;
+        PdfIndexScanner::Index index;
+    };
+
+    static constexpr size_t c_defaultChunkSize = 256 * 1024;
+
+    PdfStreamSink(
+        ReadFunction read, const std::filesystem::path& path,
+        size_t chunkSize = c_defaultChunkSize);
+
+    // Copies one chunk. Returns true if there is more to copy.
+    bool WriteChunk();
+    bool HasFailed() const
+    {
+        return m_failed;
+    }
+    // Closes the file and returns what was written. Call once WriteChunk has
+    // returned false. A file that wasn't written in full is deleted.
+    Result Finish();
+    // Closes and deletes the file, for a copy that won't be finished.
+    void Discard();
+
+private:
+    ReadFunction m_read;
+    std::filesystem::path m_path;
+    std::ofstream m_file;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_chunkSize;
+    PdfIndexScanner m_scanner;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_failed = false;
+    bool m_done = false;
+};
@@ -0,0 +1,183 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PemCertificateScanner.h"
+
+#include <array>
+
+namespace
+{
+constexpr std::string_view c_beginMarker = "-----BEGIN CERTIFICATE-----";
+constexpr std::string_view c_endMarker = "-----END CERTIFICATE-----";
+
+constexpr uint8_t c_invalid = 0xFF;
+constexpr uint8_t c_skip = 0xFE;
+
+constexpr std::array<uint8_t, 256> MakeBase64Table()
+{
+    std::array<uint8_t, 256> table = {};
+    for (auto& entry : table)
+    {
+        entry = c_invalid;
+    }
+    constexpr char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        table[static_cast<uint8_t>(alphabet[i])] = i;
+    }
+    table[' '] = c_skip;
+    table['\t'] = c_skip;
+    table['\r'] = c_skip;
+    table['\n'] = c_skip;
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> c_base64 = MakeBase64Table();
+
+// Decodes `text` into `out`, ignoring whitespace. Padding ends the data.
+bool DecodeBase64(std::string_view text, std::vector<uint8_t>* out)
+{
+    out->clear();
+    out->reserve(text.size() * 3 / 4);
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (char c : text)
+    {
+        if (c == '=')
+        {
+            break;
+        }
+        uint8_t value = c_base64[static_cast<uint8_t>(c)];
+        if (value == c_skip)
+        {
+            continue;
+        }
+        if (value == c_invalid)
+        {
+            return false;
+        }
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            out->push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    return !out->empty();
+}
+
+// Reads the tag and length of the DER element at `*position` and moves past
+// them. Only definite lengths of up to four bytes are accepted, which covers
+// any certificate.
+bool ReadHeader(
+    const uint8_t* der, size_t size, size_t* position, uint8_t* tag, size_t* length)
+{
+    if (*position + 2 > size)
+    {
+        return false;
+    }
+    *tag = der[(*position)++];
+    uint8_t first = der[(*position)++];
+    if (first < 0x80)
+    {
+        *length = first;
+    }
+    else
+    {
+        size_t lengthBytes = first & 0x7F;
+        if (lengthBytes == 0 || lengthBytes > 4 || *position + lengthBytes > size)
+        {
+            return false;
+        }
+        *length = 0;
+        for (size_t i = 0; i < lengthBytes; i++)
+        {
+            *length = (*length << 8) | der[(*position)++];
+        }
+    }
+    return *length <= size - *position;
+}
+
+// Reads one element with the expected tag. `span` covers the whole element.
+bool ReadElement(
+    const uint8_t* der, size_t size, size_t* position, uint8_t expectedTag,
+    PemCertificateScanner::DerSpan* span)
+{
+    size_t start = *position;
+    uint8_t tag = 0;
+    size_t length = 0;
+    if (!ReadHeader(der, size, position, &tag, &length) || tag != expectedTag)
+    {
+        return false;
+    }
+    *position += length;
+    span->data = der + start;
+    span->size = *position - start;
+    return true;
+}
+} // namespace
+
+PemCertificateScanner::PemCertificateScanner(std::string_view pem) : m_pem(pem)
+{
+}
+
+bool PemCertificateScanner::Next(std::vector<uint8_t>* der)
+{
+    if (m_error)
+    {
+        return false;
+    }
+    size_t begin = m_pem.find(c_beginMarker, m_position);
+    if (begin == std::string_view::npos)
+    {
+        m_position = m_pem.size();
+        return false;
+    }
+    size_t payload = begin + c_beginMarker.size();
+    size_t end = m_pem.find(c_endMarker, payload);
+    if (end == std::string_view::npos ||
+        !DecodeBase64(m_pem.substr(payload, end - payload), der))
+    {
+        m_error = true;
+        return false;
+    }
+    m_position = end + c_endMarker.size();
+    return true;
+}
+
+bool PemCertificateScanner::ParseNames(const uint8_t* der, size_t size, Names* names)
+{
+    constexpr uint8_t c_sequence = 0x30;
+    constexpr uint8_t c_integer = 0x02;
+    constexpr uint8_t c_explicitVersion = 0xA0;
+
+    // Certificate ::= SEQUENCE { tbsCertificate, signatureAlgorithm, signature }
+    size_t position = 0;
+    uint8_t tag = 0;
+    size_t length = 0;
+    if (!ReadHeader(der, size, &position, &tag, &length) || tag != c_sequence)
+    {
+        return false;
+    }
+    // TBSCertificate ::= SEQUENCE { [0] version OPTIONAL, serialNumber, signature,
+    //     issuer, validity, subject, ... }
+    if (!ReadHeader(der, size, &position, &tag, &length) || tag != c_sequence)
+    {
+        return false;
+    }
+    size_t tbsEnd = position + length;
+    DerSpan skipped;
+    if (position < tbsEnd && der[position] == c_explicitVersion &&
+        !ReadElement(der, tbsEnd, &position, c_explicitVersion, &skipped))
+    {
+        return false;
+    }
+    return ReadElement(der, tbsEnd, &position, c_integer, &skipped) &&
+           ReadElement(der, tbsEnd, &position, c_sequence, &skipped) &&
+           ReadElement(der, tbsEnd, &position, c_sequence, &names->issuer) &&
+           ReadElement(der, tbsEnd, &position, c_sequence, &skipped) &&
+           ReadElement(der, tbsEnd, &position, c_sequence, &names->subject);
+}
@@ -0,0 +1,57 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// PemCertificateScanner walks the CERTIFICATE blocks of a PEM bundle, such as
+// the chain returned by get_PemEncodedIssuerCertificateChain, without copying
+// the text: each block is base64-decoded straight from the input into a buffer
+// the caller reuses for every certificate.
+//
+// It also locates the issuer and subject names in a DER certificate, which is
+// all the trust store needs, without building a full X.509 parse tree. Has no
+// dependency on Win32 or CryptoAPI.
+class PemCertificateScanner
+{
+public:
+    // A view into a DER buffer, including the tag and length bytes.
+    struct DerSpan
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct Names
+    {
+        DerSpan issuer;
+        DerSpan subject;
+    };
+
+    // `pem` must outlive the scanner.
+    explicit PemCertificateScanner(std::string_view pem);
+
+    // Decodes the next certificate into `der`, replacing its contents. Returns
+    // false when there are no more certificates or the next one is malformed.
+    bool Next(std::vector<uint8_t>* der);
+    // True if Next stopped because of a malformed block rather than the end of
+    // the input.
+    bool HasError() const
+    {
+        return m_error;
+    }
+
+    // Finds the issuer and subject Name fields of a DER certificate. Returns
+    // false if the certificate is not well formed up to the subject.
+    static bool ParseNames(const uint8_t* der, size_t size, Names* names);
+
+private:
+    std::string_view m_pem;
+    size_t m_position = 0;
+    bool m_error = false;
+};
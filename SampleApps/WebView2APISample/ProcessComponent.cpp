@@ -6,23 +6,198 @@
 
 #include "psapi.h"
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "ProcessComponent.h"
 #include "CheckFailure.h"
+#include "StringConversion.h"
 
 using namespace Microsoft::WRL;
 
+static constexpr WCHAR c_failureLogFileName[] = L"ProcessFailures.log";
+static constexpr WCHAR c_recoveryStateMessage[] = L"RecoveryState ";
+
+// Posts the scroll position and the form field values of the top-level page to
+// the host, half a second after they last changed, so that they can be
+// restored if the page is recovered from a process failure. Password, hidden
+// and file fields are left out.
+static constexpr WCHAR c_saveStateScript[] = LR"js(
+(() => {
+  if (window !== window.top || !window.chrome || !chrome.webview) return;
+  let timer = 0;
+  const save = () => {
+    timer = 0;
+    const fields = [];
+    document.querySelectorAll('input, textarea, select').forEach((element, index) => {
+      if (['password', 'hidden', 'file'].includes(element.type)) return;
+      const checkable = element.type === 'checkbox' || element.type === 'radio';
+      fields.push([index, element.name || '', checkable ? element.checked : element.value]);
+    });
+    chrome.webview.postMessage(
+      'RecoveryState ' + JSON.stringify({x: scrollX, y: scrollY, fields}));
+  };
+  const schedule = () => { if (!timer) timer = setTimeout(save, 500); };
+  addEventListener('scroll', schedule, {passive: true});
+  addEventListener('input', schedule, true);
+  addEventListener('change', schedule, true);
+})();
+)js";
+
+// Takes the state saved by c_saveStateScript as a JSON string. A field is only
+// restored if the field at its index still has the same name.
+static constexpr WCHAR c_restoreStateScript[] = LR"js(
+((json) => {
+  const state = JSON.parse(json);
+  const elements = document.querySelectorAll('input, textarea, select');
+  for (const [index, name, value] of state.fields) {
+    const element = elements[index];
+    if (!element || (element.name || '') !== name) continue;
+    if (typeof value === 'boolean') element.checked = value; else element.value = value;
+  }
+  scrollTo(state.x, state.y);
+})
+)js";
+
+namespace
+{
+// The failure log of the ProcessComponents of every thread, opened off the UI
+// thread when the first one is created.
+struct FailureTelemetry
+{
+    std::mutex mutex;
+    bool loadStarted = false;
+    // Set once the log is open.
+    std::unique_ptr<FailureLog> log;
+    std::wstring path;
+    // The failures recorded while the log was opening.
+    std::vector<FailureLog::Failure> pendingFailures;
+};
+
+FailureTelemetry& GetFailureTelemetry()
+{
+    static FailureTelemetry s_telemetry;
+    return s_telemetry;
+}
+
+int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int64_t GetWallClockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Quotes `text` as a JavaScript string literal.
+std::wstring ToScriptString(const std::wstring& text)
+{
+    std::wstring literal = L"\"";
+    for (wchar_t c : text)
+    {
+        if (c == L'"' || c == L'\\')
+        {
+            literal += L'\\';
+            literal += c;
+        }
+        else if (c < 0x20 || c == 0x2028 || c == 0x2029)
+        {
+            WCHAR escape[7];
+            StringCchPrintf(escape, ARRAYSIZE(escape), L"\\u%04x", c);
+            literal += escape;
+        }
+        else
+        {
+            literal += c;
+        }
+    }
+    return literal + L"\"";
+}
+
+std::wstring FormatAge(int64_t ageMs)
+{
+    int64_t minutes = (std::max)(ageMs, int64_t(0)) / 60000;
+    if (minutes < 120)
+    {
+        return std::to_wstring(minutes) + L" min";
+    }
+    if (minutes < 48 * 60)
+    {
+        return std::to_wstring(minutes / 60) + L" h";
+    }
+    return std::to_wstring(minutes / (24 * 60)) + L" days";
+}
+
+// Writes the log's batch, then has the file system write it to disk, once
+// for the batch.
+void FlushFailureLog(FailureTelemetry& telemetry)
+{
+    if (!telemetry.log || telemetry.log->GetPendingCount() == 0 || !telemetry.log->Flush())
+    {
+        return;
+    }
+    wil::unique_hfile file(CreateFileW(
+        telemetry.path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file)
+    {
+        FlushFileBuffers(file.get());
+    }
+}
+
+void StartLoadingFailureLog(const std::wstring& path)
+{
+    FailureTelemetry& telemetry = GetFailureTelemetry();
+    {
+        std::lock_guard<std::mutex> lock(telemetry.mutex);
+        if (telemetry.loadStarted)
+        {
+            return;
+        }
+        telemetry.loadStarted = true;
+        telemetry.path = path;
+    }
+    // Opening checks and indexes every record, which takes a while for a large
+    // log, so keep it off the UI thread.
+    std::thread(
+        [&telemetry, path]
+        {
+            auto log = std::make_unique<FailureLog>(path);
+            std::lock_guard<std::mutex> lock(telemetry.mutex);
+            for (const FailureLog::Failure& failure : telemetry.pendingFailures)
+            {
+                log->Append(failure);
+            }
+            telemetry.pendingFailures.clear();
+            telemetry.log = std::move(log);
+            FlushFailureLog(telemetry);
+        })
+        .detach();
+}
+} // namespace
+
 ProcessComponent::ProcessComponent(AppWindow* appWindow)
     : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
 {
+    StartLoadingFailureLog(m_appWindow->GetLocalPath(c_failureLogFileName, false));
+
     //! [ProcessFailed]
     // Register a handler for the ProcessFailed event.
-    // This handler checks the failure kind and tries to:
-    //   * Recreate the webview for browser failure and render unresponsive.
-    //   * Reload the webview for render failure.
-    //   * Reload the webview for frame-only render failure impacting app content.
-    //   * Log information about the failure for other failures.
+    // This handler checks the failure kind and has the RecoveryOrchestrator
+    // recover, without asking the user, from:
+    //   * Browser failure and render unresponsive, by recreating the webview.
+    //   * Render failure, by reloading the webview.
+    //   * Frame-only render failure impacting app content, by reloading.
+    // Repeated failures escalate the recovery, and a crash loop suspends it.
+    // Information about the failure is logged for other failures.
     CHECK_FAILURE(m_webView->add_ProcessFailed(
         Callback<ICoreWebView2ProcessFailedEventHandler>(
             [this](ICoreWebView2* sender, ICoreWebView2ProcessFailedEventArgs* argsRaw)
@@ -32,28 +207,21 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
                 CHECK_FAILURE(args->get_ProcessFailedKind(&kind));
                 if (kind == COREWEBVIEW2_PROCESS_FAILED_KIND_BROWSER_PROCESS_EXITED)
                 {
-                    // Do not run a message loop from within the event handler
-                    // as that could lead to reentrancy and leave the event
-                    // handler in stack indefinitely. Instead, schedule the
-                    // appropriate work to take place after completion of the
-                    // event handler.
-                    ScheduleReinitIfSelectedByUser(
-                        L"Browser process exited unexpectedly.  Recreate webview?",
-                        L"Browser process exited");
+                    // Do not recreate the webview from within the event
+                    // handler as that could lead to reentrancy. Instead,
+                    // schedule the appropriate work to take place after
+                    // completion of the event handler.
+                    ScheduleRecovery(RecoveryOrchestrator::Failure::BrowserExited);
                 }
                 else if (kind == COREWEBVIEW2_PROCESS_FAILED_KIND_RENDER_PROCESS_UNRESPONSIVE)
                 {
-                    ScheduleReinitIfSelectedByUser(
-                        L"Browser render process has stopped responding.  Recreate webview?",
-                        L"Web page unresponsive");
+                    ScheduleRecovery(RecoveryOrchestrator::Failure::RenderUnresponsive);
                 }
                 else if (kind == COREWEBVIEW2_PROCESS_FAILED_KIND_RENDER_PROCESS_EXITED)
                 {
                     // Reloading the page will start a new render process if
                     // needed.
-                    ScheduleReloadIfSelectedByUser(
-                        L"Browser render process exited unexpectedly. Reload page?",
-                        L"Render process exited");
+                    ScheduleRecovery(RecoveryOrchestrator::Failure::RenderExited);
                 }
                 // Check the runtime event args implements the newer interface.
                 auto args2 = args.try_query<ICoreWebView2ProcessFailedEventArgs2>();
@@ -61,6 +229,31 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
                 {
                     return S_OK;
                 }
+                COREWEBVIEW2_PROCESS_FAILED_REASON reason;
+                wil::unique_cotaskmem_string processDescription;
+                int exitCode;
+                wil::unique_cotaskmem_string failedModule;
+
+                CHECK_FAILURE(args2->get_Reason(&reason));
+                CHECK_FAILURE(args2->get_ProcessDescription(&processDescription));
+                CHECK_FAILURE(args2->get_ExitCode(&exitCode));
+
+                auto argFailedModule = args.try_query<ICoreWebView2ProcessFailedEventArgs3>();
+                if (argFailedModule)
+                {
+                    CHECK_FAILURE(argFailedModule->get_FailureSourceModulePath(&failedModule));
+                }
+
+                // Record every failure for later analysis.
+                FailureLog::Failure failure;
+                failure.timeMs = GetWallClockMs();
+                failure.kind = kind;
+                failure.reason = reason;
+                failure.exitCode = exitCode;
+                failure.module = failedModule ? ToUtf8(failedModule.get()) : std::string();
+                failure.description = ToUtf8(processDescription.get());
+                RecordFailure(failure);
+
                 if (kind == COREWEBVIEW2_PROCESS_FAILED_KIND_FRAME_RENDER_PROCESS_EXITED)
                 {
                     // A frame-only renderer has exited unexpectedly. Check if
@@ -82,10 +275,8 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
                         CHECK_FAILURE(frameInfo->get_Source(&sourceRaw));
                         if (IsAppContentUri(sourceRaw.get()))
                         {
-                            ScheduleReloadIfSelectedByUser(
-                                L"Browser render process for app frame exited unexpectedly. "
-                                L"Reload page?",
-                                L"App content frame unresponsive");
+                            ScheduleRecovery(
+                                RecoveryOrchestrator::Failure::FrameRenderExited);
                             break;
                         }
 
@@ -97,23 +288,6 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
                 {
                     // Show the process failure details. Apps can collect info for their logging
                     // purposes.
-                    COREWEBVIEW2_PROCESS_FAILED_REASON reason;
-                    wil::unique_cotaskmem_string processDescription;
-                    int exitCode;
-                    wil::unique_cotaskmem_string failedModule;
-
-                    CHECK_FAILURE(args2->get_Reason(&reason));
-                    CHECK_FAILURE(args2->get_ProcessDescription(&processDescription));
-                    CHECK_FAILURE(args2->get_ExitCode(&exitCode));
-
-                    auto argFailedModule =
-                        args.try_query<ICoreWebView2ProcessFailedEventArgs3>();
-                    if (argFailedModule)
-                    {
-                        CHECK_FAILURE(
-                            argFailedModule->get_FailureSourceModulePath(&failedModule));
-                    }
-
                     std::wstringstream message;
                     message << L"Kind: " << ProcessFailedKindToString(kind) << L"\n"
                             << L"Reason: " << ProcessFailedReasonToString(reason) << L"\n"
@@ -129,7 +303,90 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
         &m_processFailedToken));
     //! [ProcessFailed]
 
+    // Keep the state of each page, to restore it after a recovery.
+    CHECK_FAILURE(m_webView->AddScriptToExecuteOnDocumentCreated(
+        c_saveStateScript,
+        Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
+            [this](HRESULT error, PCWSTR id) -> HRESULT
+            {
+                if (SUCCEEDED(error))
+                {
+                    m_saveStateScriptId = id;
+                }
+                return S_OK;
+            })
+            .Get()));
+    CHECK_FAILURE(m_webView->add_WebMessageReceived(
+        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string messageRaw;
+                if (args->TryGetWebMessageAsString(&messageRaw) != S_OK ||
+                    wcsncmp(
+                        messageRaw.get(), c_recoveryStateMessage,
+                        ARRAYSIZE(c_recoveryStateMessage) - 1) != 0)
+                {
+                    return S_OK;
+                }
+                wil::unique_cotaskmem_string source;
+                CHECK_FAILURE(args->get_Source(&source));
+                m_appWindow->GetRecoveryOrchestrator().SaveState(
+                    ToUtf8(source.get()),
+                    ToUtf8(messageRaw.get() + ARRAYSIZE(c_recoveryStateMessage) - 1));
+                return S_OK;
+            })
+            .Get(),
+        &m_webMessageReceivedToken));
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                BOOL isSuccess = FALSE;
+                CHECK_FAILURE(args->get_IsSuccess(&isSuccess));
+                wil::unique_cotaskmem_string source;
+                if (!isSuccess || FAILED(sender->get_Source(&source)))
+                {
+                    return S_OK;
+                }
+                RecoveryOrchestrator& orchestrator = m_appWindow->GetRecoveryOrchestrator();
+                std::string uri = ToUtf8(source.get());
+                if (!orchestrator.OnNavigationSucceeded(uri, GetNowMs()))
+                {
+                    return S_OK;
+                }
+                if (const std::string* state = orchestrator.FindState(uri))
+                {
+                    std::wstring script = c_restoreStateScript;
+                    script += L"(" + ToScriptString(ToUtf16(*state)) + L");";
+                    CHECK_FAILURE(sender->ExecuteScript(script.c_str(), nullptr));
+                }
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken));
+
+    // Keep the frame tree up to date between snapshots of the frames.
+    auto webView4 = m_webView.try_query<ICoreWebView2_4>();
+    if (webView4)
+    {
+        CHECK_FAILURE(webView4->add_FrameCreated(
+            Callback<ICoreWebView2FrameCreatedEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2FrameCreatedEventArgs* args)
+                    -> HRESULT
+                {
+                    wil::com_ptr<ICoreWebView2Frame> frame;
+                    CHECK_FAILURE(args->get_Frame(&frame));
+                    OnFrameCreated(frame.get());
+                    return S_OK;
+                })
+                .Get(),
+            &m_frameCreatedToken));
+    }
+
     m_webViewEnvironment = appWindow->GetWebViewEnvironment();
+    m_frames = GetEnvironmentFrames(m_webViewEnvironment.get());
     auto environment8 = m_webViewEnvironment.try_query<ICoreWebView2Environment8>();
     if (environment8)
     {
@@ -143,6 +400,7 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
                     sender->QueryInterface(IID_PPV_ARGS(&webviewEnvironment));
                     CHECK_FAILURE(
                         webviewEnvironment->GetProcessInfos(&m_processCollection));
+                    RemoveExitedProcessFrames();
                     return S_OK;
                 })
                 .Get(),
@@ -190,11 +448,115 @@ bool ProcessComponent::HandleWindowMessage(
         case IDM_PROCESS_EXTENDED_INFO:
             ShowProcessExtendedInfo();
             return true;
+        case IDM_PROCESS_FAILURE_REPORT:
+            ShowFailureReport();
+            return true;
+        case IDM_PROCESS_RECOVERY_REPORT:
+            ShowRecoveryReport();
+            return true;
         }
     }
+    else if (message == WM_TIMER && wParam == c_recoveryTimerId)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_recoveryTimerId);
+        RunRecovery();
+        return true;
+    }
+    else if (message == WM_TIMER && wParam == c_cooldownTimerId)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_cooldownTimerId);
+        RecoveryOrchestrator::Decision decision =
+            m_appWindow->GetRecoveryOrchestrator().OnCooldownEnded(GetNowMs());
+        if (decision.action != RecoveryOrchestrator::Action::None)
+        {
+            m_pendingRecovery = decision.action;
+            RunRecovery();
+        }
+        return true;
+    }
+    else if (message == WM_TIMER && wParam == c_failureLogTimerId)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_failureLogTimerId);
+        FailureTelemetry& telemetry = GetFailureTelemetry();
+        std::lock_guard<std::mutex> lock(telemetry.mutex);
+        FlushFailureLog(telemetry);
+        return true;
+    }
     return false;
 }
 
+void ProcessComponent::RecordFailure(const FailureLog::Failure& failure)
+{
+    FailureTelemetry& telemetry = GetFailureTelemetry();
+    std::lock_guard<std::mutex> lock(telemetry.mutex);
+    if (!telemetry.log)
+    {
+        // Appended and flushed once the log is open.
+        telemetry.pendingFailures.push_back(failure);
+        return;
+    }
+    FailureLog& log = *telemetry.log;
+    log.Append(failure);
+    if (log.ShouldFlush(failure.timeMs))
+    {
+        FlushFailureLog(telemetry);
+    }
+    else
+    {
+        // Flushed with the failures that follow within the interval.
+        SetTimer(
+            m_appWindow->GetMainWindow(), c_failureLogTimerId,
+            static_cast<UINT>(FailureLog::c_batchIntervalMs), nullptr);
+    }
+}
+
+void ProcessComponent::ShowFailureReport()
+{
+    std::wstringstream report;
+    {
+        FailureTelemetry& telemetry = GetFailureTelemetry();
+        std::lock_guard<std::mutex> lock(telemetry.mutex);
+        if (!telemetry.log)
+        {
+            report << L"The failure log is still being opened.";
+        }
+        else
+        {
+            FailureLog& log = *telemetry.log;
+            int64_t nowMs = GetWallClockMs();
+            report << log.GetRecordCount() << L" failures recorded, " << log.GetSignatureCount()
+                   << L" distinct signatures\n\nMost frequent:\n";
+            for (const FailureLog::Signature* signature : log.GetTopSignatures(c_reportCount))
+            {
+                report << signature->count << L" x "
+                       << ProcessFailedKindToString(
+                              static_cast<COREWEBVIEW2_PROCESS_FAILED_KIND>(signature->kind))
+                       << L", "
+                       << ProcessFailedReasonToString(
+                              static_cast<COREWEBVIEW2_PROCESS_FAILED_REASON>(
+                                  signature->reason))
+                       << L", exit code " << signature->exitCode;
+                if (!signature->module.empty())
+                {
+                    report << L", " << ToUtf16(signature->module);
+                }
+                report << L"\n    first seen " << FormatAge(nowMs - signature->firstSeenMs)
+                       << L" ago, last seen " << FormatAge(nowMs - signature->lastSeenMs)
+                       << L" ago\n";
+            }
+            report << L"\nFailing modules, last " << c_reportHours << L" hours:\n";
+            int64_t sinceMs = nowMs - c_reportHours * FailureLog::c_bucketMs;
+            for (const FailureLog::ModuleCount& module :
+                 log.GetTopModules(sinceMs, c_reportCount))
+            {
+                report << ToUtf16(module.module) << L": " << module.count << L"\n";
+            }
+        }
+    }
+    MessageBox(
+        m_appWindow->GetMainWindow(), report.str().c_str(), L"Process Failures", MB_OK);
+}
+
 // Show the WebView's PID to the user.
 void ProcessComponent::ShowBrowserProcessInfo()
 {
@@ -227,83 +589,104 @@ std::wstring ProcessComponent::FrameKindToString(const COREWEBVIEW2_FRAME_KIND k
     return std::to_wstring(static_cast<uint32_t>(kind));
 }
 
-void ProcessComponent::AppendFrameInfo(
-    wil::com_ptr<ICoreWebView2FrameInfo> frameInfo, std::wstringstream& result)
+// FrameCreated is only raised for the main frame's children, which are
+// inserted under the main frame. Frames further down are inserted by the
+// snapshots.
+void ProcessComponent::OnFrameCreated(ICoreWebView2Frame* frame)
 {
+    wil::com_ptr<ICoreWebView2Frame> framePtr = frame;
+    auto frame5 = framePtr.try_query<ICoreWebView2Frame5>();
+    auto webView20 = m_webView.try_query<ICoreWebView2_20>();
+    if (!frame5 || !webView20)
+    {
+        return;
+    }
     UINT32 frameId = 0;
-    UINT32 parentFrameId = 0;
     UINT32 mainFrameId = 0;
-    UINT32 childFrameId = 0;
-    std::wstring type = L"other child frame";
-    wil::unique_cotaskmem_string nameRaw;
-    wil::unique_cotaskmem_string sourceRaw;
-    COREWEBVIEW2_FRAME_KIND frameKind = COREWEBVIEW2_FRAME_KIND_UNKNOWN;
-
-    CHECK_FAILURE(frameInfo->get_Name(&nameRaw));
-    std::wstring name = nameRaw.get()[0] ? nameRaw.get() : L"none";
-    CHECK_FAILURE(frameInfo->get_Source(&sourceRaw));
-    std::wstring source = sourceRaw.get()[0] ? sourceRaw.get() : L"none";
-
-    wil::com_ptr<ICoreWebView2FrameInfo2> frameInfo2;
-    CHECK_FAILURE(frameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-    frameInfo2->get_FrameId(&frameId);
-    frameInfo2->get_FrameKind(&frameKind);
-
-    wil::com_ptr<ICoreWebView2FrameInfo> parentFrameInfo;
-    CHECK_FAILURE(frameInfo2->get_ParentFrameInfo(&parentFrameInfo));
-    if (parentFrameInfo)
+    CHECK_FAILURE(frame5->get_FrameId(&frameId));
+    CHECK_FAILURE(webView20->get_FrameId(&mainFrameId));
+    if (!m_frames->tree.Find(mainFrameId))
     {
-        CHECK_FAILURE(parentFrameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-        CHECK_FAILURE(frameInfo2->get_FrameId(&parentFrameId));
+        m_frames->tree.Insert(mainFrameId, FrameTree::c_noFrame);
     }
+    m_frames->tree.Insert(frameId, mainFrameId);
 
-    wil::com_ptr<ICoreWebView2FrameInfo> mainFrameInfo = GetAncestorMainFrameInfo(frameInfo);
-    if (mainFrameInfo == frameInfo)
-    {
-        type = L"main frame";
-    }
-    CHECK_FAILURE(mainFrameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-    CHECK_FAILURE(frameInfo2->get_FrameId(&mainFrameId));
+    CreatedFrame& entry = m_createdFrames[frameId];
+    entry.frame = framePtr;
+    CHECK_FAILURE(frame->add_Destroyed(
+        Callback<ICoreWebView2FrameDestroyedEventHandler>(
+            [this, frameId](ICoreWebView2Frame* sender, IUnknown* args) -> HRESULT
+            {
+                m_frames->tree.Remove(frameId);
+                m_createdFrames.erase(frameId);
+                return S_OK;
+            })
+            .Get(),
+        &entry.destroyedToken));
+}
 
-    wil::com_ptr<ICoreWebView2FrameInfo> childFrameInfo =
-        GetAncestorMainFrameDirectChildFrameInfo(frameInfo);
-    if (childFrameInfo == frameInfo)
+// Remove the frames of the render processes that are no longer running.
+void ProcessComponent::RemoveExitedProcessFrames()
+{
+    UINT32 processCount = 0;
+    CHECK_FAILURE(m_processCollection->get_Count(&processCount));
+    std::vector<INT32> runningProcessIds;
+    for (UINT32 i = 0; i < processCount; i++)
     {
-        type = L"first level frame";
+        wil::com_ptr<ICoreWebView2ProcessInfo> processInfo;
+        CHECK_FAILURE(m_processCollection->GetValueAtIndex(i, &processInfo));
+        INT32 processId = 0;
+        CHECK_FAILURE(processInfo->get_ProcessId(&processId));
+        runningProcessIds.push_back(processId);
     }
-    if (childFrameInfo)
+    for (int32_t processId : m_frames->tree.GetProcessIds())
     {
-        CHECK_FAILURE(childFrameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-        CHECK_FAILURE(frameInfo2->get_FrameId(&childFrameId));
+        if (std::find(runningProcessIds.begin(), runningProcessIds.end(), processId) ==
+            runningProcessIds.end())
+        {
+            m_frames->tree.RemoveProcess(processId);
+        }
     }
-
-    result << L"{frame name:" << name << L" | frame Id:" << frameId << L" | parent frame Id:"
-           << ((parentFrameId == 0) ? L"none" : std::to_wstring(parentFrameId))
-           << L" | frame type:" << type << L"\n"
-           << L" | ancestor main frame Id:" << mainFrameId
-           << L" | ancestor main frame's direct child frame Id:"
-           << ((childFrameId == 0) ? L"none" : std::to_wstring(childFrameId)) << L"\n"
-           << L" | frame kind:" << FrameKindToString(frameKind) << L"\n"
-           << L" | frame source:" << source << L"}," << std::endl;
 }
 
-// Get the ancestor main frameInfo.
-// Return itself if it's a main frame.
-wil::com_ptr<ICoreWebView2FrameInfo> ProcessComponent::GetAncestorMainFrameInfo(
-    wil::com_ptr<ICoreWebView2FrameInfo> frameInfo)
+// Add a frame of a snapshot to the frame tree. A frame keeps its parent for its
+// life, so the parent is only read for a frame the tree doesn't have yet, and
+// the frame's ancestors are never walked.
+void ProcessComponent::IndexFrameInfo(
+    FrameTree& tree, ICoreWebView2FrameInfo* frameInfo, INT32 processId)
 {
-    wil::com_ptr<ICoreWebView2FrameInfo> mainFrameInfo;
+    UINT32 frameId = 0;
+    wil::unique_cotaskmem_string nameRaw;
+    wil::unique_cotaskmem_string sourceRaw;
+    COREWEBVIEW2_FRAME_KIND frameKind = COREWEBVIEW2_FRAME_KIND_UNKNOWN;
+
     wil::com_ptr<ICoreWebView2FrameInfo2> frameInfo2;
-    while (frameInfo)
+    CHECK_FAILURE(frameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
+    CHECK_FAILURE(frameInfo2->get_FrameId(&frameId));
+    const FrameTree::Frame* frame = tree.Find(frameId);
+    UINT32 parentFrameId = frame ? frame->parentId : FrameTree::c_noFrame;
+    if (!frame)
     {
-        mainFrameInfo = frameInfo;
-        CHECK_FAILURE(frameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-        CHECK_FAILURE(frameInfo2->get_ParentFrameInfo(&frameInfo));
+        wil::com_ptr<ICoreWebView2FrameInfo> parentFrameInfo;
+        CHECK_FAILURE(frameInfo2->get_ParentFrameInfo(&parentFrameInfo));
+        if (parentFrameInfo)
+        {
+            wil::com_ptr<ICoreWebView2FrameInfo2> parentFrameInfo2;
+            CHECK_FAILURE(parentFrameInfo->QueryInterface(IID_PPV_ARGS(&parentFrameInfo2)));
+            CHECK_FAILURE(parentFrameInfo2->get_FrameId(&parentFrameId));
+        }
     }
-    return mainFrameInfo;
+    tree.Insert(frameId, parentFrameId);
+    tree.SetProcess(frameId, processId);
+
+    // The name and source change as the frame navigates.
+    CHECK_FAILURE(frameInfo->get_Name(&nameRaw));
+    CHECK_FAILURE(frameInfo->get_Source(&sourceRaw));
+    CHECK_FAILURE(frameInfo2->get_FrameKind(&frameKind));
+    tree.SetDetails(
+        frameId, frameKind, ToUtf8(nameRaw.get()), ToUtf8(sourceRaw.get()));
 }
 
-// Get the frame's corresponding main frame's direct child frameInfo.
 // Example:
 //         A (main frame/CoreWebView2)
 //         | \
@@ -312,105 +695,202 @@ wil::com_ptr<ICoreWebView2FrameInfo> ProcessComponent::GetAncestorMainFrameInfo(
 // (frame) D  E (frame)
 //            |
 //            F (frame)
-// C GetAncestorMainFrameDirectChildFrameInfo returns C.
-// D GetAncestorMainFrameDirectChildFrameInfo returns B.
-// F GetAncestorMainFrameDirectChildFrameInfo returns C.
-wil::com_ptr<ICoreWebView2FrameInfo> ProcessComponent::GetAncestorMainFrameDirectChildFrameInfo(
-    wil::com_ptr<ICoreWebView2FrameInfo> frameInfo)
-{
-    wil::com_ptr<ICoreWebView2FrameInfo> mainFrameInfo;
-    wil::com_ptr<ICoreWebView2FrameInfo> childFrameInfo;
-    wil::com_ptr<ICoreWebView2FrameInfo2> frameInfo2;
-    while (frameInfo)
+// The ancestor main frame of all the frames is A. The ancestor main frame's
+// direct child of C is C, of D is B, and of F is C.
+void ProcessComponent::AppendFrameInfo(
+    const FrameTree::Frame& frame, std::wstringstream& result)
+{
+    std::wstring type = L"other child frame";
+    if (frame.parentId == FrameTree::c_noFrame)
+    {
+        type = L"main frame";
+    }
+    else if (frame.firstLevelFrameId == frame.id)
     {
-        childFrameInfo = mainFrameInfo;
-        mainFrameInfo = frameInfo;
-        CHECK_FAILURE(frameInfo->QueryInterface(IID_PPV_ARGS(&frameInfo2)));
-        CHECK_FAILURE(frameInfo2->get_ParentFrameInfo(&frameInfo));
+        type = L"first level frame";
     }
-    return childFrameInfo;
+    std::wstring name = frame.name.empty() ? L"none" : ToUtf16(frame.name);
+    std::wstring source = frame.source.empty() ? L"none" : ToUtf16(frame.source);
+
+    result << L"{frame name:" << name << L" | frame Id:" << frame.id << L" | parent frame Id:"
+           << ((frame.parentId == 0) ? L"none" : std::to_wstring(frame.parentId))
+           << L" | frame type:" << type << L"\n"
+           << L" | ancestor main frame Id:"
+           << ((frame.mainFrameId == 0) ? L"unknown" : std::to_wstring(frame.mainFrameId))
+           << L" | ancestor main frame's direct child frame Id:"
+           << ((frame.firstLevelFrameId == 0) ? L"none"
+                                                : std::to_wstring(frame.firstLevelFrameId))
+           << L"\n"
+           << L" | frame kind:"
+           << FrameKindToString(static_cast<COREWEBVIEW2_FRAME_KIND>(frame.kind)) << L"\n"
+           << L" | frame source:" << source << L"}," << std::endl;
 }
 
-void ProcessComponent::ShowProcessExtendedInfo()
+void ProcessComponent::UpdateFrameTree(int64_t maxAgeMs, FrameTreeCallback done)
 {
     auto environment13 = m_webViewEnvironment.try_query<ICoreWebView2Environment13>();
-    if (environment13)
-    {
-        //! [GetProcessExtendedInfos]
-        CHECK_FAILURE(environment13->GetProcessExtendedInfos(
-            Callback<ICoreWebView2GetProcessExtendedInfosCompletedHandler>(
-                [this](
-                    HRESULT error,
-                    ICoreWebView2ProcessExtendedInfoCollection* processCollection) -> HRESULT
+    if (!environment13)
+    {
+        return;
+    }
+    // The windows of the environment share a recent snapshot, or the one
+    // being taken.
+    std::shared_ptr<EnvironmentFrames> frames = m_frames;
+    if (frames->snapshot && !frames->snapshotPending &&
+        GetNowMs() - frames->snapshotMs <= maxAgeMs)
+    {
+        done(frames->tree, frames->snapshot.get());
+        return;
+    }
+    frames->waiting.push_back(std::move(done));
+    if (frames->snapshotPending)
+    {
+        return;
+    }
+    frames->snapshotPending = true;
+    //! [GetProcessExtendedInfos]
+    CHECK_FAILURE(environment13->GetProcessExtendedInfos(
+        Callback<ICoreWebView2GetProcessExtendedInfosCompletedHandler>(
+            [frames](
+                HRESULT error,
+                ICoreWebView2ProcessExtendedInfoCollection* processCollection) -> HRESULT
+            {
+                frames->snapshotPending = false;
+                std::vector<FrameTreeCallback> waiting;
+                waiting.swap(frames->waiting);
+                if (FAILED(error))
                 {
-                    UINT32 processCount = 0;
-                    UINT32 rendererProcessCount = 0;
-                    CHECK_FAILURE(processCollection->get_Count(&processCount));
-                    std::wstringstream otherProcessInfos;
-                    std::wstringstream rendererProcessInfos;
-                    for (UINT32 i = 0; i < processCount; i++)
+                    return S_OK;
+                }
+                UINT32 processCount = 0;
+                CHECK_FAILURE(processCollection->get_Count(&processCount));
+                frames->tree.BeginSnapshot();
+                for (UINT32 i = 0; i < processCount; i++)
+                {
+                    Microsoft::WRL::ComPtr<ICoreWebView2ProcessExtendedInfo>
+                        processExtendedInfo;
+                    CHECK_FAILURE(processCollection->GetValueAtIndex(i, &processExtendedInfo));
+                    Microsoft::WRL::ComPtr<ICoreWebView2ProcessInfo> processInfo;
+                    CHECK_FAILURE(processExtendedInfo->get_ProcessInfo(&processInfo));
+                    COREWEBVIEW2_PROCESS_KIND kind;
+                    CHECK_FAILURE(processInfo->get_Kind(&kind));
+                    if (kind != COREWEBVIEW2_PROCESS_KIND_RENDERER)
                     {
-                        Microsoft::WRL::ComPtr<ICoreWebView2ProcessExtendedInfo>
-                            processExtendedInfo;
-                        CHECK_FAILURE(
-                            processCollection->GetValueAtIndex(i, &processExtendedInfo));
-                        Microsoft::WRL::ComPtr<ICoreWebView2ProcessInfo> processInfo;
-                        CHECK_FAILURE(processExtendedInfo->get_ProcessInfo(&processInfo));
-                        COREWEBVIEW2_PROCESS_KIND kind;
-                        CHECK_FAILURE(processInfo->get_Kind(&kind));
-                        INT32 processId = 0;
-                        CHECK_FAILURE(processInfo->get_ProcessId(&processId));
-                        if (kind == COREWEBVIEW2_PROCESS_KIND_RENDERER)
-                        {
-                            //! [AssociatedFrameInfos]
-                            std::wstringstream rendererProcess;
-                            wil::com_ptr<ICoreWebView2FrameInfoCollection> frameInfoCollection;
-                            CHECK_FAILURE(processExtendedInfo->get_AssociatedFrameInfos(
-                                &frameInfoCollection));
-                            wil::com_ptr<ICoreWebView2FrameInfoCollectionIterator> iterator;
-                            CHECK_FAILURE(frameInfoCollection->GetIterator(&iterator));
-                            BOOL hasCurrent = FALSE;
-                            UINT32 frameInfoCount = 0;
-                            while (SUCCEEDED(iterator->get_HasCurrent(&hasCurrent)) &&
-                                   hasCurrent)
-                            {
-                                wil::com_ptr<ICoreWebView2FrameInfo> frameInfo;
-                                CHECK_FAILURE(iterator->GetCurrent(&frameInfo));
-
-                                AppendFrameInfo(frameInfo, rendererProcess);
-
-                                BOOL hasNext = FALSE;
-                                CHECK_FAILURE(iterator->MoveNext(&hasNext));
-                                frameInfoCount++;
-                            }
-                            rendererProcessInfos
-                                << frameInfoCount
-                                << L" frameInfo(s) found in Renderer Process ID:" << processId
-                                << L"\n"
-                                << rendererProcess.str() << std::endl;
-                            //! [AssociatedFrameInfos]
-                            rendererProcessCount++;
-                        }
-                        else
-                        {
-                            otherProcessInfos << L"Process Id:" << processId
-                                              << L" | Process Kind:"
-                                              << ProcessKindToString(kind) << std::endl;
-                        }
+                        continue;
                     }
-                    std::wstringstream message;
-                    message << processCount << L" process(es) found, from which "
-                            << rendererProcessCount << L" renderer process(es) found\n\n"
-                            << rendererProcessInfos.str() << L"Remaining Process(es) Infos:\n"
-                            << otherProcessInfos.str();
+                    INT32 processId = 0;
+                    CHECK_FAILURE(processInfo->get_ProcessId(&processId));
+                    //! [AssociatedFrameInfos]
+                    wil::com_ptr<ICoreWebView2FrameInfoCollection> frameInfoCollection;
+                    CHECK_FAILURE(
+                        processExtendedInfo->get_AssociatedFrameInfos(&frameInfoCollection));
+                    wil::com_ptr<ICoreWebView2FrameInfoCollectionIterator> iterator;
+                    CHECK_FAILURE(frameInfoCollection->GetIterator(&iterator));
+                    BOOL hasCurrent = FALSE;
+                    while (SUCCEEDED(iterator->get_HasCurrent(&hasCurrent)) && hasCurrent)
+                    {
+                        wil::com_ptr<ICoreWebView2FrameInfo> frameInfo;
+                        CHECK_FAILURE(iterator->GetCurrent(&frameInfo));
 
-                    m_appWindow->AsyncMessageBox(
-                        std::move(message.str()), L"Process Extended Info");
-                    return S_OK;
-                })
-                .Get()));
-        //! [GetProcessExtendedInfos]
+                        IndexFrameInfo(frames->tree, frameInfo.get(), processId);
+
+                        BOOL hasNext = FALSE;
+                        CHECK_FAILURE(iterator->MoveNext(&hasNext));
+                    }
+                    //! [AssociatedFrameInfos]
+                }
+                frames->tree.EndSnapshot();
+                frames->snapshot = processCollection;
+                frames->snapshotMs = GetNowMs();
+                for (const FrameTreeCallback& callback : waiting)
+                {
+                    callback(frames->tree, processCollection);
+                }
+                return S_OK;
+            })
+            .Get()));
+    //! [GetProcessExtendedInfos]
+}
+
+// static
+std::shared_ptr<ProcessComponent::EnvironmentFrames> ProcessComponent::GetEnvironmentFrames(
+    ICoreWebView2Environment* environment)
+{
+    // An environment is only used on the thread that created it. Its pointer
+    // isn't reused while a component holds the environment and its frames.
+    static thread_local std::unordered_map<
+        ICoreWebView2Environment*, std::weak_ptr<EnvironmentFrames>>
+        s_environmentFrames;
+    std::weak_ptr<EnvironmentFrames>& entry = s_environmentFrames[environment];
+    std::shared_ptr<EnvironmentFrames> frames = entry.lock();
+    if (!frames)
+    {
+        frames = std::make_shared<EnvironmentFrames>();
+        entry = frames;
     }
+    return frames;
+}
+
+void ProcessComponent::ShowProcessExtendedInfo()
+{
+    UpdateFrameTree(
+        0,
+        [this, alive = std::weak_ptr<bool>(m_alive)](
+            const FrameTree& frameTree,
+            ICoreWebView2ProcessExtendedInfoCollection* processCollection)
+        {
+            if (alive.expired())
+            {
+                return;
+            }
+            UINT32 processCount = 0;
+            CHECK_FAILURE(processCollection->get_Count(&processCount));
+            std::vector<INT32> rendererProcessIds;
+            std::wstringstream otherProcessInfos;
+            for (UINT32 i = 0; i < processCount; i++)
+            {
+                Microsoft::WRL::ComPtr<ICoreWebView2ProcessExtendedInfo> processExtendedInfo;
+                CHECK_FAILURE(processCollection->GetValueAtIndex(i, &processExtendedInfo));
+                Microsoft::WRL::ComPtr<ICoreWebView2ProcessInfo> processInfo;
+                CHECK_FAILURE(processExtendedInfo->get_ProcessInfo(&processInfo));
+                COREWEBVIEW2_PROCESS_KIND kind;
+                CHECK_FAILURE(processInfo->get_Kind(&kind));
+                INT32 processId = 0;
+                CHECK_FAILURE(processInfo->get_ProcessId(&processId));
+                if (kind == COREWEBVIEW2_PROCESS_KIND_RENDERER)
+                {
+                    rendererProcessIds.push_back(processId);
+                }
+                else
+                {
+                    otherProcessInfos << L"Process Id:" << processId << L" | Process Kind:"
+                                      << ProcessKindToString(kind) << std::endl;
+                }
+            }
+
+            // The frames are listed by process, in the order of their IDs.
+            std::wstringstream rendererProcessInfos;
+            for (INT32 processId : rendererProcessIds)
+            {
+                std::vector<uint32_t> frameIds = frameTree.GetProcessFrames(processId);
+                std::sort(frameIds.begin(), frameIds.end());
+                rendererProcessInfos << frameIds.size()
+                                     << L" frameInfo(s) found in Renderer Process ID:"
+                                     << processId << L"\n";
+                for (uint32_t frameId : frameIds)
+                {
+                    AppendFrameInfo(*frameTree.Find(frameId), rendererProcessInfos);
+                }
+                rendererProcessInfos << std::endl;
+            }
+            std::wstringstream message;
+            message << processCount << L" process(es) found, from which "
+                    << rendererProcessIds.size() << L" renderer process(es) found\n\n"
+                    << rendererProcessInfos.str() << L"Remaining Process(es) Infos:\n"
+                    << otherProcessInfos.str();
+
+            m_appWindow->AsyncMessageBox(std::move(message.str()), L"Process Extended Info");
+        });
 }
 
 // Get a string for the failure kind enum value.
@@ -561,37 +1041,105 @@ void ProcessComponent::PerformanceInfo()
     }
 }
 
-void ProcessComponent::ScheduleReinitIfSelectedByUser(
-    const std::wstring& message, const std::wstring& caption)
+void ProcessComponent::ScheduleRecovery(RecoveryOrchestrator::Failure failure)
 {
-    // Do not block from event handler
-    m_appWindow->RunAsync([this, message, caption]() {
-        int selection = MessageBox(
-            m_appWindow->GetMainWindow(), message.c_str(), caption.c_str(), MB_YESNO);
-        if (selection == IDYES)
-        {
-            m_appWindow->ReinitializeWebView();
-        }
-    });
+    // The source can't be read once the browser process is gone, in which
+    // case the failure counts for no origin.
+    wil::unique_cotaskmem_string source;
+    std::string uri;
+    if (SUCCEEDED(m_webView->get_Source(&source)))
+    {
+        uri = ToUtf8(source.get());
+    }
+    RecoveryOrchestrator::Decision decision =
+        m_appWindow->GetRecoveryOrchestrator().OnFailure(uri, failure, GetNowMs());
+    switch (decision.action)
+    {
+    case RecoveryOrchestrator::Action::None:
+        break;
+    case RecoveryOrchestrator::Action::Suspend:
+        KillTimer(m_appWindow->GetMainWindow(), c_recoveryTimerId);
+        m_pendingRecovery = RecoveryOrchestrator::Action::None;
+        // Fails if the browser process is gone, leaving the page blank.
+        m_webView->NavigateToString(
+            L"<h1>This page keeps failing</h1>"
+            L"<p>It will not be reloaded automatically for a while.</p>");
+        // The orchestrator keeps the failed page and recovers it once more
+        // when the cooldown ends.
+        SetTimer(
+            m_appWindow->GetMainWindow(), c_cooldownTimerId,
+            (std::max)(static_cast<UINT>(decision.delayMs), UINT(USER_TIMER_MINIMUM)), nullptr);
+        break;
+    default:
+        // Even without a delay, the timer runs the recovery after the event
+        // handler has completed.
+        m_pendingRecovery = decision.action;
+        SetTimer(
+            m_appWindow->GetMainWindow(), c_recoveryTimerId,
+            (std::max)(static_cast<UINT>(decision.delayMs), UINT(USER_TIMER_MINIMUM)), nullptr);
+        break;
+    }
 }
 
-void ProcessComponent::ScheduleReloadIfSelectedByUser(
-    const std::wstring& message, const std::wstring& caption)
+void ProcessComponent::RunRecovery()
 {
-    // Do not block from event handler
-    m_appWindow->RunAsync([this, message, caption]() {
-        int selection = MessageBox(
-            m_appWindow->GetMainWindow(), message.c_str(), caption.c_str(), MB_YESNO);
-        if (selection == IDYES)
-        {
-            CHECK_FAILURE(m_webView->Reload());
-        }
-    });
+    RecoveryOrchestrator::Action action = m_pendingRecovery;
+    m_pendingRecovery = RecoveryOrchestrator::Action::None;
+    m_appWindow->GetRecoveryOrchestrator().OnActionRun();
+    AppWindow* appWindow = m_appWindow;
+    switch (action)
+    {
+    case RecoveryOrchestrator::Action::Reload:
+        CHECK_FAILURE(m_webView->Reload());
+        break;
+    case RecoveryOrchestrator::Action::Reinitialize:
+        // This component is deleted with the WebView, so not from within its
+        // own message handler.
+        m_appWindow->RunAsync([appWindow] { appWindow->ReinitializeWebView(); });
+        break;
+    case RecoveryOrchestrator::Action::ReinitializeWithNewBrowser:
+        m_appWindow->RunAsync([appWindow] { appWindow->ReinitializeWebViewWithNewBrowser(); });
+        break;
+    default:
+        break;
+    }
+}
+
+void ProcessComponent::ShowRecoveryReport()
+{
+    std::string report = m_appWindow->GetRecoveryOrchestrator().GetReport(GetNowMs());
+    MessageBox(
+        m_appWindow->GetMainWindow(), ToUtf16(report).c_str(), L"Process Recovery", MB_OK);
 }
 
 ProcessComponent::~ProcessComponent()
 {
     m_webView->remove_ProcessFailed(m_processFailedToken);
+    m_webView->remove_WebMessageReceived(m_webMessageReceivedToken);
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+    if (!m_saveStateScriptId.empty())
+    {
+        m_webView->RemoveScriptToExecuteOnDocumentCreated(m_saveStateScriptId.c_str());
+    }
+    KillTimer(m_appWindow->GetMainWindow(), c_failureLogTimerId);
+    KillTimer(m_appWindow->GetMainWindow(), c_recoveryTimerId);
+    // The cooldown timer is left to the window, whose recreated WebView's
+    // component runs the trial.
+    {
+        // The batch may have been waiting for this window's timer.
+        FailureTelemetry& telemetry = GetFailureTelemetry();
+        std::lock_guard<std::mutex> lock(telemetry.mutex);
+        FlushFailureLog(telemetry);
+    }
+    auto webView4 = m_webView.try_query<ICoreWebView2_4>();
+    if (webView4)
+    {
+        webView4->remove_FrameCreated(m_frameCreatedToken);
+    }
+    for (auto& entry : m_createdFrames)
+    {
+        entry.second.frame->remove_Destroyed(entry.second.destroyedToken);
+    }
     auto environment8 = m_webViewEnvironment.try_query<ICoreWebView2Environment8>();
     if (environment8)
     {
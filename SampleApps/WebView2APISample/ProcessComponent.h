@@ -8,9 +8,25 @@
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "FailureLog.h"
+#include "FrameTree.h"
+#include "RecoveryOrchestrator.h"
 
 // This component handles commands from the Process menu, as well as some miscellaneous
 // functions for managing the browser process.
+//
+// Every ProcessFailed event is recorded in a FailureLog shared by the windows
+// of all threads, in ProcessFailures.log next to the executable. The log is
+// opened on a worker thread, and failures recorded before it is open are
+// appended once it is. The failures of the render and browser processes are
+// recovered from as the AppWindow's RecoveryOrchestrator decides.
+//
+// The frames shown by ShowProcessExtendedInfo are kept in a FrameTree, which
+// the component updates as the main frame's children are created and
+// destroyed and as render processes exit, so each snapshot of the frames only
+// reads what changed. The tree and its last snapshot are shared by the
+// components of the WebViews of an environment, which all run on the
+// environment's thread.
 class ProcessComponent : public ComponentBase
 {
 public:
@@ -33,6 +49,20 @@ public:
     void CrashRenderProcess();
     void PerformanceInfo();
     void ShowProcessExtendedInfo();
+    using FrameTreeCallback =
+        std::function<void(const FrameTree&, ICoreWebView2ProcessExtendedInfoCollection*)>;
+    // Calls `done` with the frame tree and the snapshot of the processes it
+    // was brought up to date with, once the environment has one taken within
+    // `maxAgeMs`. A snapshot is taken once for all the callers that wait for
+    // it, which may outlive this component. Does nothing on runtimes without
+    // GetProcessExtendedInfos.
+    void UpdateFrameTree(int64_t maxAgeMs, FrameTreeCallback done);
+    const FrameTree& GetFrameTree() const
+    {
+        return m_frames->tree;
+    }
+    void ShowFailureReport();
+    void ShowRecoveryReport();
 
     ~ProcessComponent() override;
 
@@ -40,10 +70,40 @@ public:
     static void EnsureProcessIsClosed(UINT processId, int timeoutMs);
 
 private:
-    void ScheduleReinitIfSelectedByUser(
-        const std::wstring& message, const std::wstring& caption);
-    void ScheduleReloadIfSelectedByUser(
-        const std::wstring& message, const std::wstring& caption);
+    static constexpr UINT_PTR c_failureLogTimerId = 0x5046;
+    static constexpr UINT_PTR c_recoveryTimerId = 0x5052;
+    static constexpr UINT_PTR c_cooldownTimerId = 0x5043;
+    static constexpr size_t c_reportCount = 10;
+    static constexpr int64_t c_reportHours = 24;
+
+    void RecordFailure(const FailureLog::Failure& failure);
+    void ScheduleRecovery(RecoveryOrchestrator::Failure failure);
+    void RunRecovery();
+    void OnFrameCreated(ICoreWebView2Frame* frame);
+    void RemoveExitedProcessFrames();
+    static void IndexFrameInfo(
+        FrameTree& tree, ICoreWebView2FrameInfo* frameInfo, INT32 processId);
+    void AppendFrameInfo(const FrameTree::Frame& frame, std::wstringstream& result);
+    std::wstring FrameKindToString(const COREWEBVIEW2_FRAME_KIND kind);
+
+    struct EnvironmentFrames
+    {
+        FrameTree tree;
+        wil::com_ptr<ICoreWebView2ProcessExtendedInfoCollection> snapshot;
+        int64_t snapshotMs = 0;
+        bool snapshotPending = false;
+        // The callers waiting for the pending snapshot.
+        std::vector<FrameTreeCallback> waiting;
+    };
+
+    static std::shared_ptr<EnvironmentFrames> GetEnvironmentFrames(
+        ICoreWebView2Environment* environment);
+
+    struct CreatedFrame
+    {
+        wil::com_ptr<ICoreWebView2Frame> frame;
+        EventRegistrationToken destroyedToken = {};
+    };
 
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
@@ -53,11 +113,15 @@ private:
     wil::com_ptr<ICoreWebView2ProcessInfoCollection> m_processCollection;
     EventRegistrationToken m_processFailedToken = {};
     EventRegistrationToken m_processInfosChangedToken = {};
-    void AppendFrameInfo(
-        wil::com_ptr<ICoreWebView2FrameInfo> frameInfo, std::wstringstream& result);
-    wil::com_ptr<ICoreWebView2FrameInfo> GetAncestorMainFrameDirectChildFrameInfo(
-        wil::com_ptr<ICoreWebView2FrameInfo> frameInfo);
-    wil::com_ptr<ICoreWebView2FrameInfo> GetAncestorMainFrameInfo(
-        wil::com_ptr<ICoreWebView2FrameInfo> frameInfo);
-    std::wstring FrameKindToString(const COREWEBVIEW2_FRAME_KIND kind);
+    EventRegistrationToken m_webMessageReceivedToken = {};
+    EventRegistrationToken m_navigationCompletedToken = {};
+    std::wstring m_saveStateScriptId;
+    RecoveryOrchestrator::Action m_pendingRecovery = RecoveryOrchestrator::Action::None;
+    std::shared_ptr<EnvironmentFrames> m_frames;
+    EventRegistrationToken m_frameCreatedToken = {};
+    // By frame ID.
+    std::unordered_map<UINT32, CreatedFrame> m_createdFrames;
+    // Expires when the component is deleted, for the callbacks that may
+    // outlive it.
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
 };
@@ -0,0 +1,323 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "ProfileComponent.h"
+
+#include "psapi.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "CheckFailure.h"
+#include "ProcessComponent.h"
+#include "StringConversion.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+constexpr uint64_t c_bytesPerMB = 1024 * 1024;
+
+// The profiles of the ProfileComponents of every thread.
+struct ProfileSessions
+{
+    std::mutex mutex;
+    ProfileSessionManager manager;
+    std::unordered_map<ProfileSessionManager::WindowId, ProfileComponent*> components;
+};
+
+ProfileSessions& GetProfileSessions()
+{
+    static ProfileSessions s_sessions;
+    return s_sessions;
+}
+
+int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+ProfileSessionManager::WindowId GetWindowId(HWND window)
+{
+    return reinterpret_cast<uintptr_t>(window);
+}
+
+// The private bytes of a process, or 0 if it has exited.
+uint64_t GetPrivateBytes(int32_t processId)
+{
+    wil::unique_handle process(
+        OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+    PROCESS_MEMORY_COUNTERS_EX counters = {};
+    if (!process || !GetProcessMemoryInfo(
+                        process.get(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters),
+                        sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PrivateUsage;
+}
+} // namespace
+
+ProfileComponent::ProfileComponent(
+    AppWindow* appWindow, const std::wstring& profileName, bool inPrivate)
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView()),
+      m_windowId(GetWindowId(appWindow->GetMainWindow())), m_profileName(ToUtf8(profileName)),
+      m_inPrivate(inPrivate)
+{
+    Register();
+
+    auto webView4 = m_webView.try_query<ICoreWebView2_4>();
+    if (webView4)
+    {
+        CHECK_FAILURE(webView4->add_DownloadStarting(
+            Callback<ICoreWebView2DownloadStartingEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2DownloadStartingEventArgs* args)
+                    -> HRESULT
+                {
+                    wil::com_ptr<ICoreWebView2DownloadOperation> operation;
+                    CHECK_FAILURE(args->get_DownloadOperation(&operation));
+                    OnDownloadStarting(operation.get());
+                    return S_OK;
+                })
+                .Get(),
+            &m_downloadStartingToken));
+    }
+    SetTimer(m_appWindow->GetMainWindow(), c_sampleTimerId, c_sampleIntervalMs, nullptr);
+}
+
+bool ProfileComponent::HandleWindowMessage(
+    HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result)
+{
+    if (message == WM_COMMAND)
+    {
+        switch (LOWORD(wParam))
+        {
+        case IDM_PROFILE_SESSION_REPORT:
+            ShowReport();
+            return true;
+        case IDM_PROFILE_BUDGET_UNLIMITED:
+            UpdateSessions([](ProfileSessionManager& manager)
+                           { manager.SetBudget(ProfileSessionManager::c_unlimited); });
+            return true;
+        case IDM_PROFILE_BUDGET_512MB:
+            UpdateSessions([](ProfileSessionManager& manager)
+                           { manager.SetBudget(512 * c_bytesPerMB); });
+            return true;
+        case IDM_PROFILE_BUDGET_1GB:
+            UpdateSessions([](ProfileSessionManager& manager)
+                           { manager.SetBudget(1024 * c_bytesPerMB); });
+            return true;
+        case IDM_PROFILE_BUDGET_2GB:
+            UpdateSessions([](ProfileSessionManager& manager)
+                           { manager.SetBudget(2048 * c_bytesPerMB); });
+            return true;
+        }
+    }
+    else if (message == WM_ACTIVATE && LOWORD(wParam) != WA_INACTIVE)
+    {
+        // Other components and the AppWindow handle activation too.
+        UpdateSessions([this](ProfileSessionManager& manager)
+                       { manager.OnActivated(m_windowId, GetNowMs()); });
+    }
+    else if (message == WM_TIMER && wParam == c_sampleTimerId)
+    {
+        Sample();
+        return true;
+    }
+    return false;
+}
+
+void ProfileComponent::ShowReport()
+{
+    std::string report;
+    {
+        ProfileSessions& sessions = GetProfileSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        report = sessions.manager.GetReport(GetNowMs());
+    }
+    MessageBox(
+        m_appWindow->GetMainWindow(), ToUtf16(report).c_str(), L"Profile Sessions", MB_OK);
+}
+
+void ProfileComponent::OnWindowClosed(HWND window)
+{
+    ProfileSessions& sessions = GetProfileSessions();
+    std::lock_guard<std::mutex> lock(sessions.mutex);
+    sessions.manager.OnWindowClosed(GetWindowId(window));
+}
+
+void ProfileComponent::UpdateSessions(
+    const std::function<void(ProfileSessionManager&)>& update)
+{
+    ProfileSessions& sessions = GetProfileSessions();
+    std::lock_guard<std::mutex> lock(sessions.mutex);
+    update(sessions.manager);
+    for (ProfileSessionManager::WindowId id : sessions.manager.TakeEvictions(GetNowMs()))
+    {
+        // The lock keeps the component, and so its AppWindow, from going away.
+        auto component = sessions.components.find(id);
+        if (component != sessions.components.end())
+        {
+            component->second->m_appWindow->RunAsync([id] { Evict(id); });
+        }
+    }
+}
+
+// Runs on the thread of the window's AppWindow, where its component is
+// created and deleted.
+void ProfileComponent::Evict(ProfileSessionManager::WindowId id)
+{
+    ProfileComponent* component = nullptr;
+    {
+        ProfileSessions& sessions = GetProfileSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        auto entry = sessions.components.find(id);
+        if (entry == sessions.components.end() || !sessions.manager.IsEvicted(id))
+        {
+            return;
+        }
+        component = entry->second;
+    }
+    // Not under the lock, as closing the WebView deletes the component. If the
+    // WebView is busy it is kept, and accounted for again.
+    if (!component->m_appWindow->EvictWebView())
+    {
+        component->Register();
+    }
+}
+
+void ProfileComponent::Register()
+{
+    bool active = GetForegroundWindow() == m_appWindow->GetMainWindow();
+    UpdateSessions(
+        [this, active](ProfileSessionManager& manager)
+        {
+            int64_t nowMs = GetNowMs();
+            manager.OnWebViewCreated(m_windowId, m_profileName, m_inPrivate, nowMs);
+            if (active)
+            {
+                manager.OnActivated(m_windowId, nowMs);
+            }
+            GetProfileSessions().components[m_windowId] = this;
+        });
+}
+
+void ProfileComponent::Sample()
+{
+    // The render processes of the WebView are those with a frame in its main
+    // frame, which the ProcessComponent's frame tree knows. The windows of an
+    // environment share a snapshot taken within half an interval. The window
+    // may be closed by the time it is taken, so the callback only holds IDs.
+    auto process = m_appWindow->GetComponent<ProcessComponent>();
+    auto webView20 = m_webView.try_query<ICoreWebView2_20>();
+    ProfileSessionManager::WindowId windowId = m_windowId;
+    if (process && webView20)
+    {
+        UINT32 mainFrameId = 0;
+        CHECK_FAILURE(webView20->get_FrameId(&mainFrameId));
+        process->UpdateFrameTree(
+            c_sampleIntervalMs / 2,
+            [windowId, mainFrameId](
+                const FrameTree& frameTree, ICoreWebView2ProcessExtendedInfoCollection*)
+            {
+                std::vector<ProfileSessionManager::ProcessUsage> processes;
+                for (int32_t processId : frameTree.GetMainFrameProcessIds(mainFrameId))
+                {
+                    processes.push_back({processId, GetPrivateBytes(processId)});
+                }
+                UpdateSessions([&](ProfileSessionManager& manager)
+                               { manager.SetProcesses(windowId, std::move(processes)); });
+            });
+    }
+
+    bool countCookies;
+    {
+        ProfileSessions& sessions = GetProfileSessions();
+        std::lock_guard<std::mutex> lock(sessions.mutex);
+        countCookies = sessions.manager.StartCookieSample(m_windowId, GetNowMs());
+    }
+    auto webView2 = m_webView.try_query<ICoreWebView2_2>();
+    if (countCookies && webView2)
+    {
+        wil::com_ptr<ICoreWebView2CookieManager> cookieManager;
+        CHECK_FAILURE(webView2->get_CookieManager(&cookieManager));
+        // An empty URI gets the cookies of the whole profile.
+        CHECK_FAILURE(cookieManager->GetCookies(
+            L"", Callback<ICoreWebView2GetCookiesCompletedHandler>(
+                     [windowId](HRESULT error, ICoreWebView2CookieList* list) -> HRESULT
+                     {
+                         if (FAILED(error))
+                         {
+                             return S_OK;
+                         }
+                         UINT count = 0;
+                         CHECK_FAILURE(list->get_Count(&count));
+                         UpdateSessions([&](ProfileSessionManager& manager)
+                                        { manager.SetCookieCount(windowId, count); });
+                         return S_OK;
+                     })
+                     .Get()));
+    }
+}
+
+void ProfileComponent::OnDownloadStarting(ICoreWebView2DownloadOperation* operation)
+{
+    UpdateSessions([this](ProfileSessionManager& manager)
+                   { manager.OnDownloadStarted(m_windowId); });
+    Download& download = m_downloads[operation];
+    download.operation = operation;
+    CHECK_FAILURE(operation->add_StateChanged(
+        Callback<ICoreWebView2StateChangedEventHandler>(
+            [this](ICoreWebView2DownloadOperation* sender, IUnknown* args) -> HRESULT
+            {
+                COREWEBVIEW2_DOWNLOAD_STATE state;
+                CHECK_FAILURE(sender->get_State(&state));
+                if (state == COREWEBVIEW2_DOWNLOAD_STATE_IN_PROGRESS)
+                {
+                    return S_OK;
+                }
+                INT64 bytesReceived = 0;
+                CHECK_FAILURE(sender->get_BytesReceived(&bytesReceived));
+                UpdateSessions(
+                    [&](ProfileSessionManager& manager)
+                    {
+                        manager.OnDownloadEnded(
+                            m_windowId, state == COREWEBVIEW2_DOWNLOAD_STATE_COMPLETED,
+                            static_cast<uint64_t>((std::max)(bytesReceived, INT64(0))));
+                    });
+                auto download = m_downloads.find(sender);
+                if (download != m_downloads.end())
+                {
+                    CHECK_FAILURE(
+                        sender->remove_StateChanged(download->second.stateChangedToken));
+                    m_downloads.erase(download);
+                }
+                return S_OK;
+            })
+            .Get(),
+        &download.stateChangedToken));
+}
+
+ProfileComponent::~ProfileComponent()
+{
+    KillTimer(m_appWindow->GetMainWindow(), c_sampleTimerId);
+    auto webView4 = m_webView.try_query<ICoreWebView2_4>();
+    if (webView4)
+    {
+        CHECK_FAILURE(webView4->remove_DownloadStarting(m_downloadStartingToken));
+    }
+    for (auto& download : m_downloads)
+    {
+        download.second.operation->remove_StateChanged(download.second.stateChangedToken);
+    }
+    ProfileSessions& sessions = GetProfileSessions();
+    std::lock_guard<std::mutex> lock(sessions.mutex);
+    sessions.manager.OnWebViewClosed(m_windowId);
+    sessions.components.erase(m_windowId);
+}
@@ -0,0 +1,73 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <unordered_map>
+
+#include "AppWindow.h"
+#include "ComponentBase.h"
+#include "ProfileSessionManager.h"
+
+// This component keeps account of the window's profile in a
+// ProfileSessionManager shared by the app windows of all threads, and handles
+// the profile commands of the Window menu.
+//
+// Every c_sampleIntervalMs it reports the render processes of its WebView,
+// found through the ProcessComponent's FrameTree, with their private memory.
+// The windows of an environment share the snapshot of its processes. One
+// window of each profile counts the profile's cookies. When the
+// render processes take more than the budget chosen from the menu, the
+// WebViews of the least recently used idle profiles are closed, and each is
+// recreated when its window is next activated.
+class ProfileComponent : public ComponentBase
+{
+public:
+    ProfileComponent(AppWindow* appWindow, const std::wstring& profileName, bool inPrivate);
+
+    bool HandleWindowMessage(
+        HWND hWnd,
+        UINT message,
+        WPARAM wParam,
+        LPARAM lParam,
+        LRESULT* result) override;
+
+    void ShowReport();
+
+    // Called when an app window is destroyed, whether or not it has a WebView,
+    // as an evicted window has no component.
+    static void OnWindowClosed(HWND window);
+
+    ~ProfileComponent() override;
+
+private:
+    static constexpr UINT_PTR c_sampleTimerId = 0x5053;
+    static constexpr UINT c_sampleIntervalMs = 10000;
+
+    struct Download
+    {
+        wil::com_ptr<ICoreWebView2DownloadOperation> operation;
+        EventRegistrationToken stateChangedToken = {};
+    };
+
+    // Applies `update` to the manager, then closes the WebViews it evicts,
+    // which may be on other threads.
+    static void UpdateSessions(const std::function<void(ProfileSessionManager&)>& update);
+    static void Evict(ProfileSessionManager::WindowId id);
+    void Register();
+    void Sample();
+    void OnDownloadStarting(ICoreWebView2DownloadOperation* operation);
+
+    AppWindow* m_appWindow = nullptr;
+    wil::com_ptr<ICoreWebView2> m_webView;
+    ProfileSessionManager::WindowId m_windowId = ProfileSessionManager::c_noWindow;
+    std::string m_profileName;
+    bool m_inPrivate = false;
+
+    EventRegistrationToken m_downloadStartingToken = {};
+    // The downloads in progress.
+    std::unordered_map<ICoreWebView2DownloadOperation*, Download> m_downloads;
+};
@@ -0,0 +1,360 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProfileSessionManager.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+constexpr uint64_t c_bytesPerMB = 1024 * 1024;
+} // namespace
+
+void ProfileSessionManager::OnWebViewCreated(
+    WindowId id, const std::string& profile, bool inPrivate, int64_t nowMs)
+{
+    ProfileId profileId = GetProfileId(profile, inPrivate, nowMs);
+    auto inserted = m_windows.try_emplace(id);
+    Window& window = inserted.first->second;
+    if (!inserted.second)
+    {
+        Profile& previous = m_profiles[window.profileId];
+        if (window.evicted)
+        {
+            window.evicted = false;
+            previous.evictedWindows--;
+            if (window.profileId == profileId)
+            {
+                previous.restores++;
+            }
+        }
+        if (window.profileId != profileId)
+        {
+            SetProcesses(id, {});
+            previous.activeDownloads -= window.activeDownloads;
+            window.activeDownloads = 0;
+            previous.windows.erase(id);
+        }
+    }
+    window.profileId = profileId;
+    m_profiles[profileId].windows.insert(id);
+    Touch(profileId, nowMs);
+}
+
+void ProfileSessionManager::OnWebViewClosed(WindowId id)
+{
+    auto window = m_windows.find(id);
+    if (window != m_windows.end() && !window->second.evicted)
+    {
+        RemoveWindow(window);
+    }
+}
+
+void ProfileSessionManager::OnWindowClosed(WindowId id)
+{
+    auto window = m_windows.find(id);
+    if (window != m_windows.end())
+    {
+        RemoveWindow(window);
+    }
+}
+
+void ProfileSessionManager::OnActivated(WindowId id, int64_t nowMs)
+{
+    auto window = m_windows.find(id);
+    if (window != m_windows.end())
+    {
+        m_activeWindow = id;
+        Touch(window->second.profileId, nowMs);
+    }
+}
+
+void ProfileSessionManager::SetProcesses(WindowId id, std::vector<ProcessUsage> processes)
+{
+    auto entry = m_windows.find(id);
+    if (entry == m_windows.end() || (entry->second.evicted && !processes.empty()))
+    {
+        // A sample taken before the window was evicted.
+        return;
+    }
+    Window& window = entry->second;
+    std::sort(
+        processes.begin(), processes.end(), [](const ProcessUsage& a, const ProcessUsage& b)
+        { return a.processId < b.processId; });
+    processes.erase(
+        std::unique(
+            processes.begin(), processes.end(), [](const ProcessUsage& a, const ProcessUsage& b)
+            { return a.processId == b.processId; }),
+        processes.end());
+
+    // Both lists are sorted, so one pass finds the processes no longer used.
+    size_t next = 0;
+    for (int32_t processId : window.processIds)
+    {
+        while (next < processes.size() && processes[next].processId < processId)
+        {
+            next++;
+        }
+        if (next == processes.size() || processes[next].processId != processId)
+        {
+            Detach(processId, window.profileId);
+        }
+    }
+    std::vector<int32_t> processIds;
+    processIds.reserve(processes.size());
+    for (const ProcessUsage& usage : processes)
+    {
+        Process& process = m_processes[usage.processId];
+        Attribute(process, false);
+        if (!std::binary_search(
+                window.processIds.begin(), window.processIds.end(), usage.processId))
+        {
+            process.profiles[window.profileId]++;
+        }
+        m_memoryBytes = m_memoryBytes - process.memoryBytes + usage.memoryBytes;
+        process.memoryBytes = usage.memoryBytes;
+        Attribute(process, true);
+        processIds.push_back(usage.processId);
+    }
+    window.processIds = std::move(processIds);
+}
+
+bool ProfileSessionManager::StartCookieSample(WindowId id, int64_t nowMs)
+{
+    auto window = m_windows.find(id);
+    if (window == m_windows.end() || window->second.evicted)
+    {
+        return false;
+    }
+    Profile& profile = m_profiles[window->second.profileId];
+    if (profile.cookieSampleStarted &&
+        nowMs - profile.cookieSampleMs < c_cookieSampleIntervalMs)
+    {
+        return false;
+    }
+    profile.cookieSampleStarted = true;
+    profile.cookieSampleMs = nowMs;
+    return true;
+}
+
+void ProfileSessionManager::SetCookieCount(WindowId id, uint64_t count)
+{
+    auto window = m_windows.find(id);
+    if (window != m_windows.end())
+    {
+        Profile& profile = m_profiles[window->second.profileId];
+        profile.cookieCount = count;
+        profile.cookiesCounted = true;
+    }
+}
+
+void ProfileSessionManager::OnDownloadStarted(WindowId id)
+{
+    auto window = m_windows.find(id);
+    if (window != m_windows.end())
+    {
+        window->second.activeDownloads++;
+        m_profiles[window->second.profileId].activeDownloads++;
+    }
+}
+
+void ProfileSessionManager::OnDownloadEnded(WindowId id, bool completed, uint64_t bytes)
+{
+    auto window = m_windows.find(id);
+    if (window == m_windows.end() || window->second.activeDownloads == 0)
+    {
+        return;
+    }
+    window->second.activeDownloads--;
+    Profile& profile = m_profiles[window->second.profileId];
+    profile.activeDownloads--;
+    (completed ? profile.completedDownloads : profile.interruptedDownloads)++;
+    profile.downloadedBytes += bytes;
+}
+
+std::vector<ProfileSessionManager::WindowId> ProfileSessionManager::TakeEvictions(
+    int64_t nowMs)
+{
+    std::vector<WindowId> evicted;
+    if (m_memoryBytes <= m_budgetBytes)
+    {
+        return evicted;
+    }
+    auto activeWindow = m_windows.find(m_activeWindow);
+    for (auto lru = m_lru.rbegin(); lru != m_lru.rend() && m_memoryBytes > m_budgetBytes;
+         ++lru)
+    {
+        Profile& profile = m_profiles[*lru];
+        if (nowMs - profile.lastActiveMs < c_idleMs)
+        {
+            // So are all the profiles used after it.
+            break;
+        }
+        if (profile.windows.size() == profile.evictedWindows || profile.activeDownloads > 0 ||
+            (activeWindow != m_windows.end() && activeWindow->second.profileId == *lru))
+        {
+            continue;
+        }
+        for (WindowId windowId : profile.windows)
+        {
+            Window& window = m_windows[windowId];
+            if (!window.evicted)
+            {
+                SetProcesses(windowId, {});
+                window.evicted = true;
+                profile.evictedWindows++;
+                evicted.push_back(windowId);
+            }
+        }
+        profile.evictions++;
+    }
+    return evicted;
+}
+
+bool ProfileSessionManager::IsEvicted(WindowId id) const
+{
+    auto window = m_windows.find(id);
+    return window != m_windows.end() && window->second.evicted;
+}
+
+uint64_t ProfileSessionManager::GetProfileMemoryBytes(
+    const std::string& profile, bool inPrivate) const
+{
+    auto id = m_profileIds.find({profile, inPrivate});
+    return id == m_profileIds.end() ? 0 : m_profiles[id->second].memoryBytes;
+}
+
+std::string ProfileSessionManager::GetReport(int64_t nowMs) const
+{
+    std::unordered_map<ProfileId, size_t> processCounts;
+    for (const auto& process : m_processes)
+    {
+        for (const auto& profile : process.second.profiles)
+        {
+            processCounts[profile.first]++;
+        }
+    }
+    std::ostringstream report;
+    report << "Render processes: " << m_processes.size() << ", "
+           << m_memoryBytes / c_bytesPerMB << " MB of a budget of ";
+    if (m_budgetBytes == c_unlimited)
+    {
+        report << "unlimited";
+    }
+    else
+    {
+        report << m_budgetBytes / c_bytesPerMB << " MB";
+    }
+    report << "\nWindows: " << m_windows.size() << "\n";
+    // Most recently used first.
+    for (ProfileId id : m_lru)
+    {
+        const Profile& profile = m_profiles[id];
+        if (profile.windows.empty() && profile.evictions == 0)
+        {
+            continue;
+        }
+        report << "\n"
+               << (profile.name.empty() ? "(default)" : profile.name)
+               << (profile.inPrivate ? " (InPrivate)" : "") << ": "
+               << profile.windows.size() - profile.evictedWindows << " windows, "
+               << profile.evictedWindows << " evicted, " << processCounts[id]
+               << " render processes, " << profile.memoryBytes / c_bytesPerMB << " MB\n"
+               << "    last used "
+               << (std::max)(nowMs - profile.lastActiveMs, int64_t(0)) / 1000
+               << " s ago, evicted " << profile.evictions << " times, restored "
+               << profile.restores << " windows\n"
+               << "    cookies: ";
+        if (profile.cookiesCounted)
+        {
+            report << profile.cookieCount;
+        }
+        else
+        {
+            report << "not counted yet";
+        }
+        report << ", downloads: " << profile.activeDownloads << " in progress, "
+               << profile.completedDownloads << " completed, " << profile.interruptedDownloads
+               << " interrupted, " << profile.downloadedBytes / c_bytesPerMB << " MB\n";
+    }
+    return report.str();
+}
+
+ProfileSessionManager::ProfileId ProfileSessionManager::GetProfileId(
+    const std::string& name, bool inPrivate, int64_t nowMs)
+{
+    auto id = m_profileIds.find({name, inPrivate});
+    if (id != m_profileIds.end())
+    {
+        return id->second;
+    }
+    ProfileId newId = static_cast<ProfileId>(m_profiles.size());
+    m_profiles.emplace_back();
+    Profile& profile = m_profiles.back();
+    profile.name = name;
+    profile.inPrivate = inPrivate;
+    profile.lastActiveMs = nowMs;
+    m_lru.push_front(newId);
+    profile.lruPosition = m_lru.begin();
+    m_profileIds.emplace(std::make_pair(name, inPrivate), newId);
+    return newId;
+}
+
+void ProfileSessionManager::Touch(ProfileId id, int64_t nowMs)
+{
+    Profile& profile = m_profiles[id];
+    profile.lastActiveMs = (std::max)(profile.lastActiveMs, nowMs);
+    m_lru.splice(m_lru.begin(), m_lru, profile.lruPosition);
+}
+
+void ProfileSessionManager::RemoveWindow(std::unordered_map<WindowId, Window>::iterator window)
+{
+    WindowId id = window->first;
+    SetProcesses(id, {});
+    Profile& profile = m_profiles[window->second.profileId];
+    profile.activeDownloads -= window->second.activeDownloads;
+    if (window->second.evicted)
+    {
+        profile.evictedWindows--;
+    }
+    profile.windows.erase(id);
+    if (m_activeWindow == id)
+    {
+        m_activeWindow = c_noWindow;
+    }
+    m_windows.erase(window);
+}
+
+void ProfileSessionManager::Detach(int32_t processId, ProfileId profileId)
+{
+    auto process = m_processes.find(processId);
+    Attribute(process->second, false);
+    auto profile = process->second.profiles.find(profileId);
+    if (--profile->second == 0)
+    {
+        process->second.profiles.erase(profile);
+    }
+    if (process->second.profiles.empty())
+    {
+        m_memoryBytes -= process->second.memoryBytes;
+        m_processes.erase(process);
+        return;
+    }
+    Attribute(process->second, true);
+}
+
+void ProfileSessionManager::Attribute(const Process& process, bool add)
+{
+    if (process.profiles.empty())
+    {
+        return;
+    }
+    uint64_t share = process.memoryBytes / process.profiles.size();
+    for (const auto& profile : process.profiles)
+    {
+        uint64_t& memoryBytes = m_profiles[profile.first].memoryBytes;
+        memoryBytes = add ? memoryBytes + share : memoryBytes - share;
+    }
+}
@@ -0,0 +1,153 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ProfileSessionManager keeps account of the profiles that the WebViews of the
+// app windows use: the windows and render processes attached to each live
+// profile, and what each profile costs: the memory of its processes, its
+// cookies, and its downloads.
+//
+// A render process's memory is split evenly among the profiles whose windows
+// use it. The browser, GPU and utility processes serve every profile and are
+// left out. While the render processes take more memory than the budget,
+// TakeEvictions picks WebViews to close, all of a profile's at once, least
+// recently used profile first. A profile is only evicted once none of its
+// windows has been activated for c_idleMs, and while it has no downloads in
+// progress and isn't the active window's. An evicted window stays accounted
+// for, and its WebView is recreated when the window is next activated.
+//
+// Times are in milliseconds on any monotonic clock. Profile names are UTF-8.
+// Not thread-safe. Has no dependency on Win32.
+class ProfileSessionManager
+{
+public:
+    using WindowId = uint64_t;
+    static constexpr WindowId c_noWindow = 0;
+
+    struct ProcessUsage
+    {
+        int32_t processId = 0;
+        uint64_t memoryBytes = 0;
+    };
+
+    static constexpr uint64_t c_unlimited = UINT64_MAX;
+    static constexpr int64_t c_idleMs = 5 * 60 * 1000;
+    static constexpr int64_t c_cookieSampleIntervalMs = 60 * 1000;
+
+    // A WebView was created in the window, which may move the window to
+    // another profile, or restore it after an eviction.
+    void OnWebViewCreated(
+        WindowId id, const std::string& profile, bool inPrivate, int64_t nowMs);
+    // The window's WebView was closed. Unless it was evicted, the window is no
+    // longer accounted for.
+    void OnWebViewClosed(WindowId id);
+    void OnWindowClosed(WindowId id);
+    void OnActivated(WindowId id, int64_t nowMs);
+    // The render processes that the window's WebView uses now.
+    void SetProcesses(WindowId id, std::vector<ProcessUsage> processes);
+    // Returns true if the window should count its profile's cookies, which
+    // one window of the profile does every c_cookieSampleIntervalMs.
+    bool StartCookieSample(WindowId id, int64_t nowMs);
+    void SetCookieCount(WindowId id, uint64_t count);
+    void OnDownloadStarted(WindowId id);
+    void OnDownloadEnded(WindowId id, bool completed, uint64_t bytes);
+
+    void SetBudget(uint64_t bytes)
+    {
+        m_budgetBytes = bytes;
+    }
+    uint64_t GetBudget() const
+    {
+        return m_budgetBytes;
+    }
+    // Evicts windows until the processes are within the budget, and returns
+    // them for the host to close their WebViews.
+    std::vector<WindowId> TakeEvictions(int64_t nowMs);
+    bool IsEvicted(WindowId id) const;
+
+    uint64_t GetMemoryBytes() const
+    {
+        return m_memoryBytes;
+    }
+    size_t GetWindowCount() const
+    {
+        return m_windows.size();
+    }
+    size_t GetProcessCount() const
+    {
+        return m_processes.size();
+    }
+    // The memory attributed to a profile, or 0 if it has never been used.
+    uint64_t GetProfileMemoryBytes(const std::string& profile, bool inPrivate) const;
+    std::string GetReport(int64_t nowMs) const;
+
+private:
+    using ProfileId = uint32_t;
+
+    struct Profile
+    {
+        std::string name;
+        bool inPrivate = false;
+        std::unordered_set<WindowId> windows;
+        size_t evictedWindows = 0;
+        uint64_t memoryBytes = 0;
+        int64_t lastActiveMs = 0;
+        // The profile's place in m_lru.
+        std::list<ProfileId>::iterator lruPosition;
+        uint64_t cookieCount = 0;
+        bool cookiesCounted = false;
+        bool cookieSampleStarted = false;
+        int64_t cookieSampleMs = 0;
+        uint32_t activeDownloads = 0;
+        uint64_t completedDownloads = 0;
+        uint64_t interruptedDownloads = 0;
+        uint64_t downloadedBytes = 0;
+        uint64_t evictions = 0;
+        uint64_t restores = 0;
+    };
+
+    struct Window
+    {
+        ProfileId profileId = 0;
+        bool evicted = false;
+        uint32_t activeDownloads = 0;
+        // Sorted.
+        std::vector<int32_t> processIds;
+    };
+
+    struct Process
+    {
+        uint64_t memoryBytes = 0;
+        // The number of windows of each profile that use the process.
+        std::unordered_map<ProfileId, uint32_t> profiles;
+    };
+
+    ProfileId GetProfileId(const std::string& name, bool inPrivate, int64_t nowMs);
+    void Touch(ProfileId id, int64_t nowMs);
+    void RemoveWindow(std::unordered_map<WindowId, Window>::iterator window);
+    void Detach(int32_t processId, ProfileId profileId);
+    // Adds or takes away the process's memory from the profiles that use it.
+    void Attribute(const Process& process, bool add);
+
+    std::unordered_map<WindowId, Window> m_windows;
+    std::vector<Profile> m_profiles;
+    std::map<std::pair<std::string, bool>, ProfileId> m_profileIds;
+    // Most recently used first.
+    std::list<ProfileId> m_lru;
+    std::unordered_map<int32_t, Process> m_processes;
+    WindowId m_activeWindow = c_noWindow;
+    uint64_t m_memoryBytes = 0;
+    uint64_t m_budgetBytes = c_unlimited;
+};
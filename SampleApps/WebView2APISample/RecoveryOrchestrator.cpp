@@ -0,0 +1,248 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "RecoveryOrchestrator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+RecoveryOrchestrator::Decision RecoveryOrchestrator::OnFailure(
+    const std::string& reportedUri, Failure failure, int64_t nowMs)
+{
+    Decision decision;
+    const std::string& uri = reportedUri.empty() ? m_lastGoodUri : reportedUri;
+    std::string origin = GetOrigin(uri);
+    OriginState& state = m_origins[origin];
+    state.failureCount++;
+    if (m_recovering && m_actionPending && origin == m_recoveringOrigin)
+    {
+        m_foldedFailures++;
+        return decision;
+    }
+
+    while (!state.failures.empty() && nowMs - state.failures.front() >= c_failureWindowMs)
+    {
+        state.failures.pop_front();
+    }
+    if (state.circuitOpenedMs >= 0)
+    {
+        if (nowMs - state.circuitOpenedMs < c_cooldownMs)
+        {
+            decision.action = Action::Suspend;
+            decision.delayMs = state.circuitOpenedMs + c_cooldownMs - nowMs;
+            m_actionCounts[static_cast<int>(decision.action)]++;
+            return decision;
+        }
+        state.circuitOpenedMs = -1;
+        state.halfOpen = true;
+        state.failures.clear();
+        state.attempts = 0;
+        state.level = 0;
+    }
+    else if (nowMs - state.lastFailureMs >= c_stableMs)
+    {
+        state.halfOpen = false;
+        state.attempts = 0;
+        state.level = 0;
+    }
+    state.lastFailureMs = nowMs;
+    state.failures.push_back(nowMs);
+
+    if (state.failures.size() >= c_maxFailures || (state.halfOpen && state.attempts > 0))
+    {
+        state.circuitOpenedMs = nowMs;
+        state.halfOpen = false;
+        state.failures.clear();
+        state.trips++;
+        if (origin == m_recoveringOrigin)
+        {
+            m_recovering = false;
+            m_actionPending = false;
+        }
+        m_suspendedUri = uri;
+        m_trialPending = true;
+        decision.action = Action::Suspend;
+        decision.delayMs = c_cooldownMs;
+        m_actionCounts[static_cast<int>(decision.action)]++;
+        return decision;
+    }
+
+    int level =
+        failure == Failure::RenderUnresponsive || failure == Failure::BrowserExited ? 1 : 0;
+    if (state.attempts > 0)
+    {
+        // The last recovery didn't hold.
+        level = (std::max)(level, state.level + 1);
+    }
+    state.level = (std::min)(level, 2);
+    state.attempts++;
+    decision.action = static_cast<Action>(static_cast<int>(Action::Reload) + state.level);
+    decision.attempt = state.attempts;
+    if (state.attempts > 1)
+    {
+        uint32_t doublings = (std::min)(state.attempts - 2, 16u);
+        decision.delayMs = (std::min)(c_baseDelayMs << doublings, c_maxDelayMs);
+    }
+    m_actionCounts[static_cast<int>(decision.action)]++;
+
+    if (!m_recovering || origin != m_recoveringOrigin)
+    {
+        m_incidentStartMs = nowMs;
+    }
+    m_recovering = true;
+    m_actionPending = true;
+    m_recoveringUri = uri;
+    m_recoveringOrigin = origin;
+    return decision;
+}
+
+RecoveryOrchestrator::Decision RecoveryOrchestrator::OnCooldownEnded(int64_t nowMs)
+{
+    Decision decision;
+    if (!m_trialPending)
+    {
+        return decision;
+    }
+    std::string origin = GetOrigin(m_suspendedUri);
+    OriginState& state = m_origins[origin];
+    if (state.circuitOpenedMs < 0)
+    {
+        // A failure after the cooldown already put the page on trial.
+        m_trialPending = false;
+        return decision;
+    }
+    if (nowMs - state.circuitOpenedMs < c_cooldownMs)
+    {
+        return decision;
+    }
+    // Recreating the WebView recovers from any failure, and loads the page in
+    // place of the one that says recovery stopped. One failure within
+    // c_stableMs opens the circuit again.
+    state.circuitOpenedMs = -1;
+    state.halfOpen = true;
+    state.failures.clear();
+    state.lastFailureMs = nowMs;
+    state.attempts = 1;
+    state.level = 1;
+    m_trials++;
+    decision.action = Action::Reinitialize;
+    decision.attempt = state.attempts;
+    m_actionCounts[static_cast<int>(decision.action)]++;
+
+    m_recovering = true;
+    m_actionPending = true;
+    m_recoveringUri = std::move(m_suspendedUri);
+    m_recoveringOrigin = std::move(origin);
+    m_incidentStartMs = nowMs;
+    m_trialPending = false;
+    return decision;
+}
+
+void RecoveryOrchestrator::OnActionRun()
+{
+    m_actionPending = false;
+}
+
+bool RecoveryOrchestrator::OnNavigationSucceeded(const std::string& uri, int64_t nowMs)
+{
+    std::string origin = GetOrigin(uri);
+    if (!origin.empty())
+    {
+        m_lastGoodUri = uri;
+    }
+    if (!m_recovering || m_actionPending ||
+        (!m_recoveringOrigin.empty() && origin != m_recoveringOrigin))
+    {
+        return false;
+    }
+    m_recovering = false;
+    m_recoveries++;
+    m_timeToRecovery.Record(
+        static_cast<uint64_t>((std::max)(nowMs - m_incidentStartMs, int64_t(0))));
+    return true;
+}
+
+void RecoveryOrchestrator::SaveState(const std::string& uri, std::string state)
+{
+    std::string key = StripFragment(uri);
+    auto existing = m_states.find(key);
+    if (existing != m_states.end())
+    {
+        existing->second = std::move(state);
+        return;
+    }
+    if (m_stateOrder.size() == c_maxSavedStates)
+    {
+        m_states.erase(m_stateOrder.front());
+        m_stateOrder.pop_front();
+    }
+    m_stateOrder.push_back(key);
+    m_states.emplace(std::move(key), std::move(state));
+}
+
+const std::string* RecoveryOrchestrator::FindState(const std::string& uri) const
+{
+    auto state = m_states.find(StripFragment(uri));
+    return state == m_states.end() ? nullptr : &state->second;
+}
+
+std::string RecoveryOrchestrator::GetReport(int64_t nowMs) const
+{
+    std::ostringstream report;
+    report << m_recoveries << " recoveries, time to recovery: p50 "
+           << m_timeToRecovery.GetValueAtPercentile(50) << " ms, p99 "
+           << m_timeToRecovery.GetValueAtPercentile(99) << " ms, max "
+           << m_timeToRecovery.GetMax() << " ms\n"
+           << "Reloads: " << m_actionCounts[static_cast<int>(Action::Reload)]
+           << ", recreated WebViews: " << m_actionCounts[static_cast<int>(Action::Reinitialize)]
+           << ", with a new browser: "
+           << m_actionCounts[static_cast<int>(Action::ReinitializeWithNewBrowser)]
+           << ", suspended: " << m_actionCounts[static_cast<int>(Action::Suspend)] << "\n"
+           << "Failures folded into a waiting recovery: " << m_foldedFailures
+           << ", trials after a cooldown: " << m_trials << "\n";
+    if (m_recovering)
+    {
+        report << "Recovering " << m_recoveringUri << "\n";
+    }
+    for (const auto& entry : m_origins)
+    {
+        const OriginState& state = entry.second;
+        report << "\n"
+               << (entry.first.empty() ? "(no origin)" : entry.first) << ": "
+               << state.failureCount << " failures, " << state.trips << " circuit trips, ";
+        if (state.circuitOpenedMs >= 0)
+        {
+            int64_t remainingMs = state.circuitOpenedMs + c_cooldownMs - nowMs;
+            report << "suspended for " << (std::max)(remainingMs, int64_t(0)) / 1000
+                   << " s more";
+        }
+        else
+        {
+            report << (state.halfOpen ? "on trial" : "recovering automatically");
+        }
+    }
+    report << "\n";
+    return report.str();
+}
+
+std::string RecoveryOrchestrator::GetOrigin(const std::string& uri)
+{
+    size_t scheme = uri.find("://");
+    if (scheme == std::string::npos || scheme == 0)
+    {
+        return std::string();
+    }
+    size_t end = uri.find_first_of("/?#", scheme + 3);
+    std::string origin = uri.substr(0, end);
+    std::transform(
+        origin.begin(), origin.end(), origin.begin(),
+        [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return origin;
+}
+
+std::string RecoveryOrchestrator::StripFragment(const std::string& uri)
+{
+    return uri.substr(0, uri.find('#'));
+}
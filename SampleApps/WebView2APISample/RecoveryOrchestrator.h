@@ -0,0 +1,156 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "HdrHistogram.h"
+
+// RecoveryOrchestrator decides how a WebView recovers from the failure of its
+// render or browser process, without asking the user, as in a kiosk.
+//
+// A render process that exited is recovered by reloading the page, and one
+// that stopped responding, or a browser process that exited, by recreating
+// the WebView. If the page's origin fails again before it has run for
+// c_stableMs, the recovery escalates a level, up to recreating the WebView
+// with a new browser process, and is delayed by an exponential backoff from
+// c_baseDelayMs up to c_maxDelayMs. Once an origin has failed
+// c_maxFailures times within c_failureWindowMs, its circuit opens: recovery
+// is suspended for c_cooldownMs. The Suspend decision's delay is the time
+// left until then, when the host calls OnCooldownEnded, which recovers the
+// failed page once more on trial. If the page fails again within c_stableMs,
+// the circuit opens again.
+//
+// The URI of each page that loads with an origin is kept, and a failure
+// reported without a URI, as when the browser process is gone, is taken for
+// a failure of that page. A recovery ends when the page of the failed origin
+// next loads, or any page if the failure had no origin, which gives the time
+// to recovery. Failures reported while a recovery waits to run are
+// folded into it. The host may also keep a snapshot of each page's state,
+// such as its scroll position and form fields, to restore once it loads.
+//
+// Times are in milliseconds on any monotonic clock. URIs are UTF-8. Not
+// thread-safe. Has no dependency on Win32.
+class RecoveryOrchestrator
+{
+public:
+    enum class Failure
+    {
+        RenderExited,
+        // A render process that only hosted frames of the page exited.
+        FrameRenderExited,
+        RenderUnresponsive,
+        BrowserExited,
+    };
+
+    enum class Action
+    {
+        None,
+        Reload,
+        Reinitialize,
+        ReinitializeWithNewBrowser,
+        // The circuit is open. The host shows the user that recovery stopped,
+        // and calls OnCooldownEnded after the decision's delay.
+        Suspend,
+    };
+
+    struct Decision
+    {
+        Action action = Action::None;
+        // The time before the host runs the action, or, for Suspend, before
+        // it calls OnCooldownEnded.
+        int64_t delayMs = 0;
+        // The number of recoveries of the origin since it last ran stably.
+        uint32_t attempt = 0;
+    };
+
+    static constexpr int64_t c_baseDelayMs = 1000;
+    static constexpr int64_t c_maxDelayMs = 60 * 1000;
+    static constexpr int64_t c_stableMs = 2 * 60 * 1000;
+    static constexpr size_t c_maxFailures = 5;
+    static constexpr int64_t c_failureWindowMs = 5 * 60 * 1000;
+    static constexpr int64_t c_cooldownMs = 10 * 60 * 1000;
+    static constexpr size_t c_maxSavedStates = 64;
+
+    // `uri` is empty if the host could not read the page's URI.
+    Decision OnFailure(const std::string& uri, Failure failure, int64_t nowMs);
+    // Returns the trial recovery of the page whose circuit opened last, or
+    // Action::None if its cooldown hasn't passed or a failure already ended
+    // it.
+    Decision OnCooldownEnded(int64_t nowMs);
+    // The host ran the action of the last decision.
+    void OnActionRun();
+    // Returns true if the load ends a recovery, in which case the host
+    // restores the page's state.
+    bool OnNavigationSucceeded(const std::string& uri, int64_t nowMs);
+
+    bool IsRecovering() const
+    {
+        return m_recovering;
+    }
+    // The page to load in a recreated WebView, which is empty if no page has
+    // loaded with an origin.
+    const std::string& GetRecoveringUri() const
+    {
+        return m_recoveringUri;
+    }
+    const std::string& GetLastGoodUri() const
+    {
+        return m_lastGoodUri;
+    }
+
+    void SaveState(const std::string& uri, std::string state);
+    // Returns nullptr if no state was saved for the page.
+    const std::string* FindState(const std::string& uri) const;
+
+    std::string GetReport(int64_t nowMs) const;
+
+    // Returns "scheme://host[:port]" in lower case, or an empty string.
+    static std::string GetOrigin(const std::string& uri);
+
+private:
+    struct OriginState
+    {
+        // The times of the failures within c_failureWindowMs.
+        std::deque<int64_t> failures;
+        int64_t lastFailureMs = 0;
+        uint32_t attempts = 0;
+        // The index of the last action taken: 0 for Reload.
+        int level = 0;
+        int64_t circuitOpenedMs = -1;
+        // The cooldown passed, and the next failure opens the circuit again.
+        bool halfOpen = false;
+        uint64_t failureCount = 0;
+        uint64_t trips = 0;
+    };
+
+    static std::string StripFragment(const std::string& uri);
+
+    std::unordered_map<std::string, OriginState> m_origins;
+    bool m_recovering = false;
+    bool m_actionPending = false;
+    std::string m_recoveringUri;
+    std::string m_recoveringOrigin;
+    int64_t m_incidentStartMs = 0;
+    std::string m_lastGoodUri;
+    // The page whose circuit opened last, until its trial.
+    std::string m_suspendedUri;
+    bool m_trialPending = false;
+
+    // Saved page states, oldest first.
+    std::deque<std::string> m_stateOrder;
+    std::unordered_map<std::string, std::string> m_states;
+
+    uint64_t m_actionCounts[5] = {};
+    uint64_t m_foldedFailures = 0;
+    uint64_t m_trials = 0;
+    uint64_t m_recoveries = 0;
+    // Milliseconds.
+    HdrHistogram m_timeToRecovery;
+};
@@ -6,12 +6,19 @@
 
 #include "ScenarioAcceleratorKeyPressed.h"
 
+#include <sstream>
+
 #include "AppWindow.h"
 #include "CheckFailure.h"
 
 using namespace Microsoft::WRL;
 
 static constexpr WCHAR c_samplePath[] = L"ScenarioAcceleratorKeyPressed.html";
+// Ctrl+P stays disabled when browser keys are enabled, and F7 stays enabled
+// when they are disabled.
+static constexpr char c_browserKeys[] = "Ctrl+P = disable-browser-key\n"
+                                        "F7 = enable-browser-key\n";
+
 ScenarioAcceleratorKeyPressed::ScenarioAcceleratorKeyPressed(AppWindow* appWindow)
     : m_appWindow(appWindow), m_controller(appWindow->GetWebViewController()),
       m_webView(appWindow->GetWebView())
@@ -20,6 +27,11 @@ ScenarioAcceleratorKeyPressed::ScenarioAcceleratorKeyPressed(AppWindow* appWindo
     wil::com_ptr<ICoreWebView2Settings> settings;
     CHECK_FAILURE(m_webView->get_Settings(&settings));
     m_settings3 = settings.try_query<ICoreWebView2Settings3>();
+    std::istringstream browserKeys(c_browserKeys);
+    m_keyMap.Load(browserKeys);
+    m_enableBrowserKeyAction = m_keyMap.GetActionId("enable-browser-key");
+    // The map has no origin layers, so one layout serves the whole scenario.
+    m_keyLayout = &m_keyMap.GetLayout("");
     // Setup the web message received event handler before navigating to
     // ensure we don't miss any messages.
     CHECK_FAILURE(m_webView->add_WebMessageReceived(
@@ -37,9 +49,8 @@ ScenarioAcceleratorKeyPressed::ScenarioAcceleratorKeyPressed(AppWindow* appWindo
                 wil::unique_cotaskmem_string messageRaw;
                 CHECK_FAILURE(args->TryGetWebMessageAsString(&messageRaw));
                 std::wstring message = messageRaw.get();
-                std::wstring reply;
 
-                if (message.compare(0, 26, L"DisableBrowserAccelerators") == 0)
+                if (message == L"DisableBrowserAccelerators")
                 {
                     CHECK_FAILURE(m_settings3->put_AreBrowserAcceleratorKeysEnabled(FALSE));
                     MessageBox(
@@ -55,7 +66,7 @@ ScenarioAcceleratorKeyPressed::ScenarioAcceleratorKeyPressed(AppWindow* appWindo
                         L"will be disabled after the next navigation except for F7.",
                         L"Settings change", MB_OK);
                 }
-                else if (message.compare(0, 25, L"EnableBrowserAccelerators") == 0)
+                else if (message == L"EnableBrowserAccelerators")
                 {
                     CHECK_FAILURE(m_settings3->put_AreBrowserAcceleratorKeysEnabled(TRUE));
                     MessageBox(
@@ -93,22 +104,26 @@ ScenarioAcceleratorKeyPressed::ScenarioAcceleratorKeyPressed(AppWindow* appWindo
                     {
                         UINT key;
                         CHECK_FAILURE(args->get_VirtualKey(&key));
+                        if (key >= KeyMap::c_keyCount)
+                        {
+                            return S_OK;
+                        }
+                        KeyMap::ActionId action = KeyMap::Press(
+                            *m_keyLayout, &m_keyChord, static_cast<uint8_t>(key),
+                            AppWindow::GetAcceleratorKeyModifiers());
+                        if (action == KeyMap::c_noAction || action == KeyMap::c_chordPending)
+                        {
+                            return S_OK;
+                        }
 
+                        // Only the keys in the map need the newer interface.
                         wil::com_ptr<ICoreWebView2AcceleratorKeyPressedEventArgs2> args2;
-
                         args->QueryInterface(IID_PPV_ARGS(&args2));
                         if (args2)
                         {
-                            if (key == 'P' && (GetKeyState(VK_CONTROL) < 0))
-                            {
-                                // tell the browser to skip the key
-                                CHECK_FAILURE(args2->put_IsBrowserAcceleratorKeyEnabled(FALSE));
-                            }
-                            if (key == VK_F7)
-                            {
-                                // tell the browser to process the key
-                                CHECK_FAILURE(args2->put_IsBrowserAcceleratorKeyEnabled(TRUE));
-                            }
+                            // Tell the browser to process or skip the key.
+                            CHECK_FAILURE(args2->put_IsBrowserAcceleratorKeyEnabled(
+                                action == m_enableBrowserKeyAction));
                         }
                     }
                     return S_OK;
@@ -9,6 +9,7 @@
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "KeyMap.h"
 
 class ScenarioAcceleratorKeyPressed : public ComponentBase
 {
@@ -26,4 +27,10 @@ private:
     wil::com_ptr<ICoreWebView2Controller> m_controller;
     wil::com_ptr<ICoreWebView2> m_webView;
     wil::com_ptr<ICoreWebView2Settings3> m_settings3;
+
+    // Keys whose browser handling the sample page overrides.
+    KeyMap m_keyMap;
+    const KeyMap::Layout* m_keyLayout = nullptr;
+    KeyMap::ChordState m_keyChord;
+    KeyMap::ActionId m_enableBrowserKeyAction = KeyMap::c_noAction;
 };
\ No newline at end of file
@@ -5,39 +5,125 @@
 
 #include "ScenarioAuthentication.h"
 
+#include <wincrypt.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
 #include "AppWindow.h"
 #include "CheckFailure.h"
+#include "StringConversion.h"
 
 using namespace Microsoft::WRL;
 
+static constexpr WCHAR c_sampleUri[] = L"https://authenticationtest.com/HTTPAuth/";
+static constexpr WCHAR c_storeFileName[] = L"Credentials.dat";
+
+namespace
+{
+int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The store is encrypted with DPAPI, so that only the current user can read it.
+void SaveStore(const std::wstring& path, const CredentialBroker& broker)
+{
+    std::string store = broker.Save();
+    DATA_BLOB input = {static_cast<DWORD>(store.size()), reinterpret_cast<BYTE*>(&store[0])};
+    DATA_BLOB output = {};
+    BOOL encrypted = CryptProtectData(
+        &input, L"WebView2APISample credentials", nullptr, nullptr, nullptr,
+        CRYPTPROTECT_UI_FORBIDDEN, &output);
+    SecureZeroMemory(&store[0], store.size());
+    if (!encrypted)
+    {
+        return;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(output.pbData), output.cbData);
+    LocalFree(output.pbData);
+}
+
+// Runs on the loader thread. The first time, the store is created with the
+// credentials of the sample page.
+std::unique_ptr<CredentialBroker> LoadStore(const std::wstring& path)
+{
+    auto broker = std::make_unique<CredentialBroker>();
+    std::ifstream file(path, std::ios::binary);
+    std::string encrypted(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    DATA_BLOB input = {
+        static_cast<DWORD>(encrypted.size()), reinterpret_cast<BYTE*>(&encrypted[0])};
+    DATA_BLOB output = {};
+    if (!encrypted.empty() &&
+        CryptUnprotectData(
+            &input, nullptr, nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output))
+    {
+        std::istringstream store(
+            std::string(reinterpret_cast<const char*>(output.pbData), output.cbData));
+        SecureZeroMemory(output.pbData, output.cbData);
+        LocalFree(output.pbData);
+        broker->Load(store);
+    }
+    if (broker->GetCount() == 0)
+    {
+        broker->Add("authenticationtest.com", "*", {"user", "pass"});
+        SaveStore(path, *broker);
+    }
+    return broker;
+}
+} // namespace
+
 ScenarioAuthentication::ScenarioAuthentication(AppWindow* appWindow) :
     m_appWindow(appWindow)
 {
     m_webView = wil::com_ptr<ICoreWebView2>(m_appWindow->GetWebView()).query<ICoreWebView2_2>();
 
     //! [WebResourceResponseReceived]
+    // Only responses from hosts that were just given credentials are looked
+    // at, which tells the broker whether the credentials were accepted.
     CHECK_FAILURE(m_webView->add_WebResourceResponseReceived(
         Callback<ICoreWebView2WebResourceResponseReceivedEventHandler>(
             [this](
                 ICoreWebView2* sender,
                 ICoreWebView2WebResourceResponseReceivedEventArgs* args) {
+                if (!m_broker || !m_broker->IsAwaitingAnyResponse())
+                {
+                    return S_OK;
+                }
                 wil::com_ptr<ICoreWebView2WebResourceRequest> request;
                 CHECK_FAILURE(args->get_Request(&request));
                 wil::unique_cotaskmem_string uri;
                 CHECK_FAILURE(request->get_Uri(&uri));
-                if (wcscmp(uri.get(), L"https://authenticationtest.com/HTTPAuth/") == 0)
+                std::string host = CredentialBroker::GetHost(ToUtf8(uri.get()));
+                if (!m_broker->IsAwaitingResponse(host))
+                {
+                    return S_OK;
+                }
+                wil::com_ptr<ICoreWebView2WebResourceResponseView> response;
+                CHECK_FAILURE(args->get_Response(&response));
+                int statusCode = 0;
+                CHECK_FAILURE(response->get_StatusCode(&statusCode));
+                m_broker->RecordResponse(host, statusCode);
+                if (statusCode == 401)
                 {
-                    wil::com_ptr<ICoreWebView2HttpRequestHeaders> requestHeaders;
-                    CHECK_FAILURE(request->get_Headers(&requestHeaders));
+                    return S_OK;
+                }
 
-                    wil::unique_cotaskmem_string authHeaderValue;
-                    if (requestHeaders->GetHeader(L"Authorization", &authHeaderValue) == S_OK)
-                    {
-                        m_appWindow->AsyncMessageBox(
-                            std::wstring(L"Authorization: ") + authHeaderValue.get(),
-                            L"Authentication result");
-                        m_appWindow->DeleteComponent(this);
-                    }
+                wil::com_ptr<ICoreWebView2HttpRequestHeaders> requestHeaders;
+                CHECK_FAILURE(request->get_Headers(&requestHeaders));
+                wil::unique_cotaskmem_string authHeaderValue;
+                if (requestHeaders->GetHeader(L"Authorization", &authHeaderValue) == S_OK)
+                {
+                    m_appWindow->AsyncMessageBox(
+                        std::wstring(L"Authorization: ") + authHeaderValue.get(),
+                        L"Authentication result");
+                    m_appWindow->DeleteComponent(this);
                 }
 
                 return S_OK;
@@ -54,10 +140,22 @@ ScenarioAuthentication::ScenarioAuthentication(AppWindow* appWindow) :
                 [this](
                     ICoreWebView2* sender,
                     ICoreWebView2BasicAuthenticationRequestedEventArgs* args) {
-                    wil::com_ptr<ICoreWebView2BasicAuthenticationResponse> basicAuthenticationResponse;
-                    CHECK_FAILURE(args->get_Response(&basicAuthenticationResponse));
-                    CHECK_FAILURE(basicAuthenticationResponse->put_UserName(L"user"));
-                    CHECK_FAILURE(basicAuthenticationResponse->put_Password(L"pass"));
+                    wil::unique_cotaskmem_string uri;
+                    CHECK_FAILURE(args->get_Uri(&uri));
+                    wil::unique_cotaskmem_string challenge;
+                    CHECK_FAILURE(args->get_Challenge(&challenge));
+                    std::string host = CredentialBroker::GetHost(ToUtf8(uri.get()));
+                    std::string realm = CredentialBroker::GetRealm(ToUtf8(challenge.get()));
+                    if (!m_broker)
+                    {
+                        // Answer once the store is loaded.
+                        wil::com_ptr<ICoreWebView2Deferral> deferral;
+                        CHECK_FAILURE(args->GetDeferral(&deferral));
+                        m_pendingRequests.push_back(
+                            {args, deferral, std::move(host), std::move(realm)});
+                        return S_OK;
+                    }
+                    AnswerRequest(args, host, realm);
 
                     return S_OK;
                 })
@@ -68,7 +166,22 @@ ScenarioAuthentication::ScenarioAuthentication(AppWindow* appWindow) :
         FeatureNotAvailable();
     }
     //! [BasicAuthenticationRequested]
-    CHECK_FAILURE(m_webView->Navigate(L"https://authenticationtest.com/HTTPAuth/"));
+
+    m_storeLoader = std::thread(
+        [this, path = m_appWindow->GetLocalPath(c_storeFileName, false),
+         alive = std::weak_ptr<bool>(m_alive)]
+        {
+            std::shared_ptr<CredentialBroker> broker = LoadStore(path);
+            m_appWindow->RunAsync(
+                [this, alive, broker]
+                {
+                    if (!alive.expired())
+                    {
+                        OnStoreLoaded(std::make_unique<CredentialBroker>(std::move(*broker)));
+                    }
+                });
+        });
+    CHECK_FAILURE(m_webView->Navigate(c_sampleUri));
 }
 
 ScenarioAuthentication::~ScenarioAuthentication() {
@@ -79,4 +192,53 @@ ScenarioAuthentication::~ScenarioAuthentication() {
         CHECK_FAILURE(webView10->remove_BasicAuthenticationRequested(
             m_basicAuthenticationRequestedToken));
     }
+    m_storeLoader.join();
+    // Leave the requests still waiting for the store to the WebView's prompt.
+    for (auto& pending : m_pendingRequests)
+    {
+        pending.deferral->Complete();
+    }
+}
+
+void ScenarioAuthentication::OnStoreLoaded(std::unique_ptr<CredentialBroker> broker)
+{
+    m_broker = std::move(broker);
+    std::vector<PendingRequest> pendingRequests;
+    pendingRequests.swap(m_pendingRequests);
+    for (auto& pending : pendingRequests)
+    {
+        AnswerRequest(pending.args.get(), pending.host, pending.realm);
+        CHECK_FAILURE(pending.deferral->Complete());
+    }
+}
+
+void ScenarioAuthentication::AnswerRequest(
+    ICoreWebView2BasicAuthenticationRequestedEventArgs* args, const std::string& host,
+    const std::string& realm)
+{
+    CredentialBroker::Answer answer = m_broker->Resolve(host, realm, GetNowMs());
+    switch (answer.outcome)
+    {
+    case CredentialBroker::Outcome::Supply:
+    {
+        wil::com_ptr<ICoreWebView2BasicAuthenticationResponse> basicAuthenticationResponse;
+        CHECK_FAILURE(args->get_Response(&basicAuthenticationResponse));
+        CHECK_FAILURE(basicAuthenticationResponse->put_UserName(
+            ToUtf16(answer.credential->userName).c_str()));
+        CHECK_FAILURE(basicAuthenticationResponse->put_Password(
+            ToUtf16(answer.credential->password).c_str()));
+        break;
+    }
+    case CredentialBroker::Outcome::NoCredential:
+        // The WebView prompts the user.
+        break;
+    case CredentialBroker::Outcome::RetryLimit:
+        // The server keeps rejecting the stored credentials. Cancel rather
+        // than supply them again or prompt in a loop.
+        CHECK_FAILURE(args->put_Cancel(TRUE));
+        m_appWindow->AsyncMessageBox(
+            L"The credentials stored for " + ToUtf16(host) + L" were rejected.",
+            L"Authentication result");
+        break;
+    }
 }
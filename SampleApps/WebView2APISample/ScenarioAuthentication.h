@@ -5,11 +5,19 @@
 #pragma once
 #include "stdafx.h"
 
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "CredentialBroker.h"
 
+// Answers basic authentication requests from a credential store, which is
+// encrypted for the current user and kept next to the executable. The store
+// is loaded on a background thread; requests that arrive before it is loaded
+// are deferred rather than blocking the UI thread.
 class ScenarioAuthentication : public ComponentBase
 {
 public:
@@ -17,9 +25,30 @@ public:
     ~ScenarioAuthentication() override;
 
 private:
+    struct PendingRequest
+    {
+        wil::com_ptr<ICoreWebView2BasicAuthenticationRequestedEventArgs> args;
+        wil::com_ptr<ICoreWebView2Deferral> deferral;
+        std::string host;
+        std::string realm;
+    };
+
+    void OnStoreLoaded(std::unique_ptr<CredentialBroker> broker);
+    void AnswerRequest(
+        ICoreWebView2BasicAuthenticationRequestedEventArgs* args, const std::string& host,
+        const std::string& realm);
+
     EventRegistrationToken m_webResourceResponseReceivedToken = {};
     EventRegistrationToken m_basicAuthenticationRequestedToken = {};
 
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2_2> m_webView = nullptr;
+
+    // Null until the store is loaded.
+    std::unique_ptr<CredentialBroker> m_broker;
+    std::vector<PendingRequest> m_pendingRequests;
+    std::thread m_storeLoader;
+    // Lets the callback posted by the loader tell whether the scenario still
+    // exists.
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
 };
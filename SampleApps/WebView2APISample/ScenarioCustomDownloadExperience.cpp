@@ -3,6 +3,9 @@
 // found in the LICENSE file.
 #include "stdafx.h"
 
+#include <iomanip>
+#include <sstream>
+
 #include "ScenarioCustomDownloadExperience.h"
 
 #include "AppWindow.h"
@@ -11,6 +14,12 @@
 
 using namespace Microsoft::WRL;
 
+// Allowlist of trusted SHA-256 digests, in sha256sum format, next to the exe.
+static constexpr WCHAR c_allowlistFileName[] = L"DownloadAllowlist.sha256";
+// Downloads are written under their chosen path with this suffix, and only
+// renamed to that path once their digest is found in the allowlist.
+static constexpr WCHAR c_unverifiedSuffix[] = L".unverified";
+
 ScenarioCustomDownloadExperience::ScenarioCustomDownloadExperience(AppWindow* appWindow)
     : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
 {
@@ -24,6 +33,25 @@ ScenarioCustomDownloadExperience::ScenarioCustomDownloadExperience(AppWindow* ap
 
     m_webView2_4 = m_webView.try_query<ICoreWebView2_4>();
     if (m_webView2_4) {
+        m_progressBar.Initialize(m_appWindow);
+
+        // Results arrive on a worker thread. Post them to the UI thread, and
+        // look the component up again there since it may be gone by then.
+        m_verifier = std::make_unique<DownloadVerifier>(
+            (std::min)(std::thread::hardware_concurrency() / 2, 4u),
+            [appWindow](const DownloadVerifier::Result& result)
+            {
+                appWindow->RunAsync(
+                    [appWindow, result]
+                    {
+                        if (auto scenario =
+                                appWindow->GetComponent<ScenarioCustomDownloadExperience>())
+                        {
+                            scenario->OnDownloadVerified(result);
+                        }
+                    });
+            });
+        m_verifier->LoadManifestFile(m_appWindow->GetLocalPath(c_allowlistFileName, false));
         CHECK_FAILURE(m_webView2_4->add_DownloadStarting(
             Callback<ICoreWebView2DownloadStartingEventHandler>(
                 [this](
@@ -79,8 +107,10 @@ ScenarioCustomDownloadExperience::ScenarioCustomDownloadExperience(AppWindow* ap
                         {
                             // If user selects `OK`, the download will complete normally.
                             // Result file path will be updated if a new one was provided.
-                            CHECK_FAILURE(args->put_ResultFilePath(dialog.input.c_str()));
-                            UpdateProgress(download.get());
+                            // It can't be opened by its extension until it's verified.
+                            CHECK_FAILURE(args->put_ResultFilePath(
+                                (dialog.input + c_unverifiedSuffix).c_str()));
+                            UpdateProgress(download.get(), dialog.input);
                         }
                         else
                         {
@@ -135,62 +165,232 @@ ScenarioCustomDownloadExperience::ScenarioCustomDownloadExperience(AppWindow* ap
     CHECK_FAILURE(m_appWindow->GetWebView()->Navigate(m_demoUri.c_str()));
 }
 
-void ScenarioCustomDownloadExperience::UpdateProgress(ICoreWebView2DownloadOperation* download)
+void ScenarioCustomDownloadExperience::UpdateProgress(
+    ICoreWebView2DownloadOperation* download, const std::wstring& verifiedPath)
 {
+    uint64_t id = m_nextDownloadId++;
+    DownloadEntry& entry = m_downloads[id];
+    entry.download = download;
+    entry.verifiedPath = verifiedPath;
+
+    INT64 totalBytesToReceive = 0;
+    CHECK_FAILURE(download->get_TotalBytesToReceive(&totalBytesToReceive));
+    // Downloads beyond the concurrency limit wait in the tracker's queue. They
+    // are paused as soon as they start receiving bytes.
+    m_tracker.Add(id, totalBytesToReceive, GetTickCount64());
+
     //! [BytesReceivedChanged]
     CHECK_FAILURE(download->add_BytesReceivedChanged(
         Callback<ICoreWebView2BytesReceivedChangedEventHandler>(
-            [this](ICoreWebView2DownloadOperation* download, IUnknown* args) -> HRESULT {
-                // Here developer can update UI to show progress of a download using
-                // `download->get_BytesReceived` and
-                // `download->get_TotalBytesToReceive`.
+            [this, id](ICoreWebView2DownloadOperation* download, IUnknown* args) -> HRESULT {
+                // This fires for every received chunk, so only record the
+                // byte count here and let the tracker throttle UI updates.
+                INT64 bytesReceived = 0;
+                CHECK_FAILURE(download->get_BytesReceived(&bytesReceived));
+                m_tracker.UpdateBytes(id, bytesReceived, GetTickCount64());
+
+                const DownloadTracker::Download* tracked = m_tracker.Find(id);
+                if (tracked && tracked->state == DownloadTracker::State::Queued)
+                {
+                    download->Pause();
+                }
+                PublishProgress(false);
                 return S_OK;
             })
             .Get(),
-        &m_bytesReceivedChangedToken));
+        &entry.bytesReceivedChangedToken));
     //! [BytesReceivedChanged]
 
     //! [StateChanged]
     CHECK_FAILURE(download->add_StateChanged(
         Callback<ICoreWebView2StateChangedEventHandler>(
-          [this](ICoreWebView2DownloadOperation* download,
+          [this, id](ICoreWebView2DownloadOperation* download,
             IUnknown* args) -> HRESULT {
                 COREWEBVIEW2_DOWNLOAD_STATE downloadState;
                 CHECK_FAILURE(download->get_State(&downloadState));
                 switch (downloadState)
                 {
                 case COREWEBVIEW2_DOWNLOAD_STATE_IN_PROGRESS:
+                    // A download resumed from the page or the download dialog
+                    // takes a slot again, or waits paused for one.
+                    if (!m_tracker.Resume(id, GetTickCount64()))
+                    {
+                        download->Pause();
+                    }
+                    PublishProgress(true);
                     break;
                 case COREWEBVIEW2_DOWNLOAD_STATE_INTERRUPTED:
+                {
                     // Here developer can take different actions based on `download->InterruptReason`.
                     // For example, show an error message to the end user.
-                    CompleteDownload(download);
+                    COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON reason;
+                    CHECK_FAILURE(download->get_InterruptReason(&reason));
+                    if (reason == COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_PAUSED)
+                    {
+                        // Queued downloads are paused by us and resumed when
+                        // a slot frees up. Any other pause frees its slot.
+                        PauseDownload(id);
+                        break;
+                    }
+                    CompleteDownload(id, false);
                     break;
+                }
                 case COREWEBVIEW2_DOWNLOAD_STATE_COMPLETED:
-                    CompleteDownload(download);
+                    CompleteDownload(id, true);
                     break;
                 }
                 return S_OK;
           })
           .Get(),
-        &m_stateChangedToken));
+        &entry.stateChangedToken));
     //! [StateChanged]
 }
 
-void ScenarioCustomDownloadExperience::CompleteDownload(ICoreWebView2DownloadOperation* download)
+void ScenarioCustomDownloadExperience::CompleteDownload(uint64_t id, bool completed)
 {
-    // Close download progress dialog here.
+    auto it = m_downloads.find(id);
+    if (it == m_downloads.end())
+    {
+        return;
+    }
 
     // Unsubscribe from download events.
-    CHECK_FAILURE(download->remove_BytesReceivedChanged(
-        m_bytesReceivedChangedToken));
-    CHECK_FAILURE(download->remove_StateChanged(m_stateChangedToken));
+    CHECK_FAILURE(it->second.download->remove_BytesReceivedChanged(
+        it->second.bytesReceivedChangedToken));
+    CHECK_FAILURE(it->second.download->remove_StateChanged(it->second.stateChangedToken));
+    if (completed)
+    {
+        wil::unique_cotaskmem_string resultFilePath;
+        CHECK_FAILURE(it->second.download->get_ResultFilePath(&resultFilePath));
+        m_verifiedPaths[id] = it->second.verifiedPath;
+        m_verifier->Enqueue(id, resultFilePath.get());
+    }
+    m_downloads.erase(it);
+
+    // Hand the freed slot to the next queued download.
+    std::vector<uint64_t> toResume;
+    m_tracker.Finish(id, completed, GetTickCount64(), &toResume);
+    ResumeDownloads(toResume);
+    PublishProgress(true);
+}
+
+void ScenarioCustomDownloadExperience::PauseDownload(uint64_t id)
+{
+    const DownloadTracker::Download* tracked = m_tracker.Find(id);
+    if (!tracked || tracked->state == DownloadTracker::State::Queued)
+    {
+        return;
+    }
+    std::vector<uint64_t> toResume;
+    m_tracker.Pause(id, &toResume);
+    ResumeDownloads(toResume);
+    PublishProgress(true);
+}
+
+void ScenarioCustomDownloadExperience::OnDownloadVerified(
+    const DownloadVerifier::Result& result)
+{
+    auto verifiedPath = m_verifiedPaths.find(result.id);
+    if (verifiedPath == m_verifiedPaths.end())
+    {
+        return;
+    }
+    // The file stays under its quarantine name unless it's trusted.
+    std::wstring quarantinePath = result.path.wstring();
+    std::wstring path = std::move(verifiedPath->second);
+    m_verifiedPaths.erase(verifiedPath);
+    std::wstring sha256(result.sha256.begin(), result.sha256.end());
+    switch (result.verdict)
+    {
+    case DownloadVerifier::Verdict::Trusted:
+        if (!MoveFileEx(quarantinePath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            MessageBox(
+                m_appWindow->GetMainWindow(),
+                (L"Couldn't move the verified download to " + path + L".").c_str(),
+                L"Download verified", MB_OK | MB_ICONWARNING);
+            break;
+        }
+        m_progressBar.Show(L"Verified " + path + L" (SHA-256 " + sha256 + L")");
+        break;
+    case DownloadVerifier::Verdict::Untrusted:
+        MessageBox(
+            m_appWindow->GetMainWindow(),
+            (L"The download's SHA-256 is not in " + std::wstring(c_allowlistFileName) +
+             L".\r\n\r\nSHA-256: " + sha256 + L"\r\nKept as: " + quarantinePath)
+                .c_str(),
+            L"Download not verified", MB_OK | MB_ICONWARNING);
+        break;
+    case DownloadVerifier::Verdict::Error:
+        MessageBox(
+            m_appWindow->GetMainWindow(),
+            (L"Couldn't read " + quarantinePath + L" to verify it.").c_str(),
+            L"Download not verified", MB_OK | MB_ICONWARNING);
+        break;
+    }
+}
+
+void ScenarioCustomDownloadExperience::ResumeDownloads(const std::vector<uint64_t>& ids)
+{
+    for (uint64_t id : ids)
+    {
+        auto it = m_downloads.find(id);
+        if (it == m_downloads.end())
+        {
+            continue;
+        }
+        BOOL canResume = FALSE;
+        CHECK_FAILURE(it->second.download->get_CanResume(&canResume));
+        if (canResume)
+        {
+            CHECK_FAILURE(it->second.download->Resume());
+        }
+        else
+        {
+            // The tracker gave it a slot it can't use. Count it interrupted,
+            // which hands the slot to the next download.
+            CompleteDownload(id, false);
+        }
+    }
+}
+
+void ScenarioCustomDownloadExperience::PublishProgress(bool force)
+{
+    if (!m_tracker.ShouldPublish(GetTickCount64()) && !force)
+    {
+        return;
+    }
+    DownloadTracker::Summary summary = m_tracker.GetSummary();
+    if (summary.active == 0 && summary.queued == 0)
+    {
+        // Close download progress bar here.
+        m_progressBar.Hide();
+        return;
+    }
+
+    std::wstringstream message;
+    message << L"Downloads: " << summary.active << L" active, " << summary.queued
+            << L" queued, " << summary.completed << L" completed, " << summary.interrupted
+            << L" interrupted. " << std::fixed << std::setprecision(1)
+            << summary.bytesPerSecond / (1024 * 1024) << L" MB/s";
+    if (summary.etaSeconds >= 0)
+    {
+        message << L", ETA " << static_cast<int64_t>(summary.etaSeconds) << L" s";
+    }
+    m_progressBar.Show(message.str());
 }
 
 ScenarioCustomDownloadExperience::~ScenarioCustomDownloadExperience()
 {
+    for (auto& pair : m_downloads)
+    {
+        pair.second.download->remove_BytesReceivedChanged(
+            pair.second.bytesReceivedChangedToken);
+        pair.second.download->remove_StateChanged(pair.second.stateChangedToken);
+    }
     if (m_webView2_4)
     {
+        m_progressBar.Hide();
         CHECK_FAILURE(m_webView2_4->remove_DownloadStarting(m_downloadStartingToken));
     }
     CHECK_FAILURE(m_webView->remove_ContentLoading(m_contentLoadingToken));
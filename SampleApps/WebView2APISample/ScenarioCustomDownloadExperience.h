@@ -5,26 +5,57 @@
 #pragma once
 #include "stdafx.h"
 
+#include <map>
+#include <memory>
 #include <string>
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "CustomStatusBar.h"
+#include "DownloadTracker.h"
+#include "DownloadVerifier.h"
 
 class ScenarioCustomDownloadExperience : public ComponentBase
 {
 public:
     ScenarioCustomDownloadExperience(AppWindow* appWindow);
-    void UpdateProgress(ICoreWebView2DownloadOperation* download);
-    void CompleteDownload(ICoreWebView2DownloadOperation* download);
+    // Tracks a download written under a quarantine name, which is renamed to
+    // `verifiedPath` once its digest is trusted.
+    void UpdateProgress(
+        ICoreWebView2DownloadOperation* download, const std::wstring& verifiedPath);
+    void CompleteDownload(uint64_t id, bool completed);
+    void OnDownloadVerified(const DownloadVerifier::Result& result);
     ~ScenarioCustomDownloadExperience() override;
 
 private:
+    struct DownloadEntry
+    {
+        wil::com_ptr<ICoreWebView2DownloadOperation> download;
+        EventRegistrationToken bytesReceivedChangedToken = {};
+        EventRegistrationToken stateChangedToken = {};
+        std::wstring verifiedPath;
+    };
+
+    // Frees the slot of a download paused by other than the tracker's queue.
+    void PauseDownload(uint64_t id);
+    void ResumeDownloads(const std::vector<uint64_t>& ids);
+    void PublishProgress(bool force);
+
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
     wil::com_ptr<ICoreWebView2_4> m_webView2_4;
     std::wstring m_demoUri;
     EventRegistrationToken m_downloadStartingToken = {};
     EventRegistrationToken m_contentLoadingToken = {};
-    EventRegistrationToken m_bytesReceivedChangedToken = {};
-    EventRegistrationToken m_stateChangedToken = {};
+    // Each download keeps its own event registrations so concurrent downloads
+    // don't overwrite each other's tokens.
+    std::map<uint64_t, DownloadEntry> m_downloads;
+    uint64_t m_nextDownloadId = 1;
+    DownloadTracker m_tracker;
+    CustomStatusBar m_progressBar;
+    // Hashes completed downloads off the UI thread and checks them against
+    // the allowlist before they are released to the user.
+    std::unique_ptr<DownloadVerifier> m_verifier;
+    // The paths completed downloads are moved to once verified, by id.
+    std::map<uint64_t, std::wstring> m_verifiedPaths;
 };
\ No newline at end of file
@@ -14,49 +14,34 @@ using namespace Microsoft::WRL;
 
 ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow) : m_appWindow(appWindow)
 {
-    CHECK_FAILURE(m_appWindow->GetWebView()->AddWebResourceRequestedFilter(
-        L"custom-scheme*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL));
-    CHECK_FAILURE(m_appWindow->GetWebView()->add_WebResourceRequested(
-        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+    // The dispatcher only calls the handler for URIs matching the pattern.
+    m_webResourceRouteId = m_appWindow->GetWebResourceDispatcher()->AddRoute(
+        L"custom-scheme*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
+        [this](const WebResourceDispatcher::Request& request)
+        {
+            wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+            std::wstring assetsFilePath = L"assets/";
+            assetsFilePath += wcsstr(request.uri, L":") + 1;
+            wil::com_ptr<IStream> stream;
+            SHCreateStreamOnFileEx(
+                assetsFilePath.c_str(), STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE, nullptr,
+                &stream);
+            if (stream)
             {
-                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
-                wil::com_ptr<ICoreWebView2WebResourceResponse> response;
-                CHECK_FAILURE(args->get_Request(&request));
-                wil::unique_cotaskmem_string uri;
-                CHECK_FAILURE(request->get_Uri(&uri));
-                if (wcsncmp(uri.get(), L"custom-scheme", ARRAYSIZE(L"custom-scheme") - 1) == 0)
-                {
-                    std::wstring assetsFilePath = L"assets/";
-                    assetsFilePath += wcsstr(uri.get(), L":") + 1;
-                    wil::com_ptr<IStream> stream;
-                    SHCreateStreamOnFileEx(
-                        assetsFilePath.c_str(), STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE,
-                        nullptr, &stream);
-                    if (stream)
-                    {
-                        CHECK_FAILURE(
-                            m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
-                                stream.get(), 200, L"OK",
-                                L"Content-Type: application/json\nAccess-Control-Allow-Origin: "
-                                L"*",
-                                &response));
-                        CHECK_FAILURE(args->put_Response(response.get()));
-                    }
-                    else
-                    {
-                        CHECK_FAILURE(
-                            m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
-                                nullptr, 404, L"Not Found", L"", &response));
-                        CHECK_FAILURE(args->put_Response(response.get()));
-                    }
-                    return S_OK;
-                }
-
-                return S_OK;
-            })
-            .Get(),
-        &m_webResourceRequestedToken));
+                CHECK_FAILURE(m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
+                    stream.get(), 200, L"OK",
+                    L"Content-Type: application/json\nAccess-Control-Allow-Origin: *",
+                    &response));
+                CHECK_FAILURE(request.args->put_Response(response.get()));
+            }
+            else
+            {
+                CHECK_FAILURE(m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
+                    nullptr, 404, L"Not Found", L"", &response));
+                CHECK_FAILURE(request.args->put_Response(response.get()));
+            }
+            return S_OK;
+        });
 
     m_appWindow->GetWebView()->add_NavigationCompleted(
         Callback<ICoreWebView2NavigationCompletedEventHandler>(
@@ -104,6 +89,5 @@ ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow) : m_appWindow(a
 
 ScenarioCustomScheme::~ScenarioCustomScheme()
 {
-    CHECK_FAILURE(
-        m_appWindow->GetWebView()->remove_WebResourceRequested(m_webResourceRequestedToken));
+    m_appWindow->GetWebResourceDispatcher()->RemoveRoute(m_webResourceRouteId);
 }
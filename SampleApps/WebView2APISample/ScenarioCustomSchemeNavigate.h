@@ -17,7 +17,7 @@ public:
     ~ScenarioCustomSchemeNavigate() override;
 
 private:
-    EventRegistrationToken m_webResourceRequestedToken = {};
+    uint32_t m_webResourceRouteId = WebResourceDispatcher::c_noRoute;
     EventRegistrationToken m_navigationCompletedToken = {};
 
     AppWindow* m_appWindow = nullptr;
@@ -13,12 +13,14 @@
 
 #include "App.h"
 #include "CheckFailure.h"
-#include "Util.h"
 #include "resource.h"
 
 using namespace Microsoft::WRL;
 
 static constexpr WCHAR c_samplePath[] = L"ScenarioNotificationReceived.html";
+// Timer used to dismiss the active notification.
+static constexpr UINT_PTR c_dismissTimerId = 0x4E54;
+static constexpr UINT c_displayTimeMs = 5000;
 
 ScenarioNotificationReceived::ScenarioNotificationReceived(AppWindow* appWindow)
     : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
@@ -27,6 +29,13 @@ ScenarioNotificationReceived::ScenarioNotificationReceived(AppWindow* appWindow)
     m_webView2Experimental22 = m_webView.try_query<ICoreWebView2Experimental22>();
     if (!m_webView2Experimental22)
         return;
+    m_presenter.Initialize(m_appWindow);
+    // Replace the presenter's window proc to see clicks on it. Focus alone
+    // doesn't count, as the keyboard or the app can move it there too.
+    HWND presenter = m_presenter.GetWindow();
+    SetWindowLongPtr(presenter, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+    m_presenterWndProc =
+        (WNDPROC)SetWindowLongPtr(presenter, GWLP_WNDPROC, (LONG_PTR)PresenterWndProcStatic);
     //! [NotificationReceived]
     // Register a handler for the NotificationReceived event.
     CHECK_FAILURE(m_webView2Experimental22->add_NotificationReceived(
@@ -35,43 +44,64 @@ ScenarioNotificationReceived::ScenarioNotificationReceived(AppWindow* appWindow)
                 ICoreWebView2* sender,
                 ICoreWebView2ExperimentalNotificationReceivedEventArgs* args) -> HRESULT
             {
-                // Block notifications from specific URIs and set Handled to
-                // true so the the default notification UI will not be
-                // shown by WebView2 either.
+                // Set Handled to true so the the default notification UI will
+                // not be shown by WebView2; the scheduler decides whether and
+                // when we show it ourselves.
                 CHECK_FAILURE(args->put_Handled(TRUE));
 
-                Microsoft::WRL::ComPtr<ICoreWebView2Deferral> deferral;
-                CHECK_FAILURE(args->GetDeferral(&deferral));
                 wil::unique_cotaskmem_string origin;
                 CHECK_FAILURE(args->get_SenderOrigin(&origin));
-                std::wstring originString = origin.get();
-                Microsoft::WRL::ComPtr<ICoreWebView2ExperimentalNotification> notification;
+                wil::com_ptr<ICoreWebView2ExperimentalNotification> notification;
                 CHECK_FAILURE(args->get_Notification(&notification));
+                wil::unique_cotaskmem_string tag;
+                CHECK_FAILURE(notification->get_Tag(&tag));
+                BOOL renotify;
+                CHECK_FAILURE(notification->get_ShouldRenotify(&renotify));
 
-                notification->add_CloseRequested(
+                uint64_t id = m_nextNotificationId++;
+                NotificationEntry& entry = m_notifications[id];
+                entry.notification = notification;
+                entry.origin = origin.get();
+                CHECK_FAILURE(notification->add_CloseRequested(
                     Callback<ICoreWebView2ExperimentalNotificationCloseRequestedEventHandler>(
-                        [this, &sender](
+                        [this, id](
                             ICoreWebView2ExperimentalNotification* notification,
                             IUnknown* args) -> HRESULT
                         {
                             // Remove the notification from the list of active
                             // notifications.
-                            RemoveNotification(notification);
+                            RemoveNotification(id);
                             return S_OK;
                         })
                         .Get(),
-                    &m_notificationCloseRequestedToken);
-
-                m_appWindow->RunAsync(
-                    [this,
-                     notificationCom = wil::make_com_ptr<ICoreWebView2ExperimentalNotification>(
-                         notification.Get()),
-                     deferral, originString]()
-                    {
-                        ShowNotification(notificationCom.get(), originString);
-                        deferral->Complete();
-                    });
+                    &entry.closeRequestedToken));
 
+                NotificationScheduler::SubmitResult result = m_scheduler.Submit(
+                    id, entry.origin, tag.get(), !!renotify, GetTickCount64());
+                switch (result.disposition)
+                {
+                case NotificationScheduler::Disposition::RateLimited:
+                case NotificationScheduler::Disposition::QueueFull:
+                    CloseNotification(id);
+                    break;
+                case NotificationScheduler::Disposition::ReplacedQueued:
+                    // The page gets a close event for the notification it
+                    // replaced.
+                    CloseNotification(result.replacedId);
+                    break;
+                case NotificationScheduler::Disposition::ReplacedActive:
+                    // Update the text in place without re-alerting the user,
+                    // and give the replacement its own display time.
+                    CloseNotification(result.replacedId);
+                    ShowNotification(id);
+                    notification->ReportShown();
+                    StartDismissTimer(id);
+                    break;
+                case NotificationScheduler::Disposition::Queued:
+                    break;
+                }
+
+                m_appWindow->RunAsync([this] { PresentNextNotification(); });
                 return S_OK;
             })
             .Get(),
@@ -91,61 +121,130 @@ bool ScenarioNotificationReceived::HandleWindowMessage(
             return true;
         }
     }
+    else if (message == WM_TIMER && wParam == c_dismissTimerId)
+    {
+        DismissActiveNotification(false);
+        return true;
+    }
     return false;
 }
 
-void ScenarioNotificationReceived::ShowNotification(
-    ICoreWebView2ExperimentalNotification* notification, std::wstring origin)
+void ScenarioNotificationReceived::PresentNextNotification()
+{
+    uint64_t id = 0;
+    if (!m_scheduler.PresentNext(&id))
+    {
+        return;
+    }
+    ShowNotification(id);
+    m_notifications[id].notification->ReportShown();
+    StartDismissTimer(id);
+}
+
+void ScenarioNotificationReceived::StartDismissTimer(uint64_t id)
+{
+    BOOL requireInteraction;
+    CHECK_FAILURE(
+        m_notifications[id].notification->get_RequiresInteraction(&requireInteraction));
+    if (requireInteraction)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_dismissTimerId);
+    }
+    else
+    {
+        // Replaces the timer of the notification shown before, if any.
+        SetTimer(m_appWindow->GetMainWindow(), c_dismissTimerId, c_displayTimeMs, nullptr);
+    }
+}
+
+// We replace the presenter's wndproc with this.
+LRESULT CALLBACK ScenarioNotificationReceived::PresenterWndProcStatic(
+    HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    auto self =
+        reinterpret_cast<ScenarioNotificationReceived*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    if (!self)
+    {
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    LRESULT result = CallWindowProc(self->m_presenterWndProc, hWnd, message, wParam, lParam);
+    // Clicking the presenter counts as clicking the notification.
+    if (message == WM_LBUTTONUP && self->m_scheduler.GetActiveId() != 0)
+    {
+        self->DismissActiveNotification(true);
+    }
+    return result;
+}
+
+void ScenarioNotificationReceived::ShowNotification(uint64_t id)
 {
-    ICoreWebView2* webView = m_webView.get();
+    NotificationEntry& entry = m_notifications[id];
+    ICoreWebView2ExperimentalNotification* notification = entry.notification.get();
     wil::unique_cotaskmem_string title;
     CHECK_FAILURE(notification->get_Title(&title));
     wil::unique_cotaskmem_string body;
     CHECK_FAILURE(notification->get_Body(&body));
-    wil::unique_cotaskmem_string language;
-    CHECK_FAILURE(notification->get_Language(&language));
     wil::unique_cotaskmem_string tag;
     CHECK_FAILURE(notification->get_Tag(&tag));
-    wil::unique_cotaskmem_string iconUri;
-    CHECK_FAILURE(notification->get_IconUri(&iconUri));
-    wil::unique_cotaskmem_string badgeUri;
-    CHECK_FAILURE(notification->get_BadgeUri(&badgeUri));
-    wil::unique_cotaskmem_string imageUri;
-    CHECK_FAILURE(notification->get_BodyImageUri(&imageUri));
-    double timestamp;
-    CHECK_FAILURE(notification->get_Timestamp(&timestamp));
-    BOOL requireInteraction;
-    CHECK_FAILURE(notification->get_RequiresInteraction(&requireInteraction));
-    BOOL silent;
-    CHECK_FAILURE(notification->get_IsSilent(&silent));
-    BOOL renotify;
-    CHECK_FAILURE(notification->get_ShouldRenotify(&renotify));
 
+    // The presenter is a single line, so keep everything on one line.
+    const NotificationScheduler::Counters& counters = m_scheduler.GetCounters();
     std::wstringstream message;
-    message << L"WebView2 has received an Notification: " << L"\n\t" << L"Sender origin: "
-            << origin << L"\n\t" << L"Title: " << title.get() << L"\n\t" << L"Body: "
-            << body.get() << L"\n\t" << L"Language: " << language.get() << L"\n\t" << L"Tag: "
-            << tag.get() << L"\n\t" << L"IconUri: " << iconUri.get() << L"\n\t" << L"BadgeUri: "
-            << badgeUri.get() << L"\n\t" << L"ImageUri: " << imageUri.get() << L"\n\t"
-            << L"Timestamp: " << Util::UnixEpochToDateTime(timestamp) << L"\n\t"
-            << L"RequireInteraction: " << ((!!requireInteraction) ? L"true" : L"false")
-            << L"\n\t" << L"Silent: " << ((!!silent) ? L"true" : L"false") << L"\n\t"
-            << L"Renotify: " << ((!!renotify) ? L"true" : L"false");
-
-    message << std::endl;
-
-    int response = MessageBox(nullptr, message.str().c_str(), title.get(), MB_OKCANCEL);
-    notification->ReportShown();
-    (response == IDOK) ? notification->ReportClicked() : notification->ReportClosed();
+    message << title.get() << L" (" << entry.origin << L"): " << body.get() << L"  [Tag: "
+            << tag.get() << L"  Pending: " << m_scheduler.GetQueuedCount() << L"  Merged: "
+            << counters.merged << L"  Dropped: "
+            << counters.droppedRateLimited + counters.droppedQueueFull << L"]";
+    m_presenter.Show(message.str());
 }
 
-void ScenarioNotificationReceived::RemoveNotification(
-    ICoreWebView2ExperimentalNotification* notification)
+void ScenarioNotificationReceived::DismissActiveNotification(bool clicked)
+{
+    KillTimer(m_appWindow->GetMainWindow(), c_dismissTimerId);
+    uint64_t id = m_scheduler.GetActiveId();
+    auto it = m_notifications.find(id);
+    if (it != m_notifications.end())
+    {
+        clicked ? it->second.notification->ReportClicked()
+                : it->second.notification->ReportClosed();
+    }
+    RemoveNotification(id);
+}
+
+void ScenarioNotificationReceived::RemoveNotification(uint64_t id)
 {
     // Close custom notification.
+    bool wasActive = id == m_scheduler.GetActiveId();
+    m_scheduler.Remove(id);
+    ReleaseNotification(id);
+    if (wasActive)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_dismissTimerId);
+        m_presenter.Hide();
+        PresentNextNotification();
+    }
+}
 
+void ScenarioNotificationReceived::CloseNotification(uint64_t id)
+{
+    auto it = m_notifications.find(id);
+    if (it != m_notifications.end())
+    {
+        it->second.notification->ReportClosed();
+    }
+    ReleaseNotification(id);
+}
+
+void ScenarioNotificationReceived::ReleaseNotification(uint64_t id)
+{
+    auto it = m_notifications.find(id);
+    if (it == m_notifications.end())
+    {
+        return;
+    }
     // Unsubscribe from notification event.
-    CHECK_FAILURE(notification->remove_CloseRequested(m_notificationCloseRequestedToken));
+    CHECK_FAILURE(
+        it->second.notification->remove_CloseRequested(it->second.closeRequestedToken));
+    m_notifications.erase(it);
 }
 
 void ScenarioNotificationReceived::NavigateToNotificationPage()
@@ -157,6 +256,16 @@ ScenarioNotificationReceived::~ScenarioNotificationReceived()
 {
     if (m_webView2Experimental22)
     {
+        KillTimer(m_appWindow->GetMainWindow(), c_dismissTimerId);
+        // Undo our modification to the presenter.
+        HWND presenter = m_presenter.GetWindow();
+        SetWindowLongPtr(presenter, GWLP_USERDATA, (LONG_PTR)nullptr);
+        SetWindowLongPtr(presenter, GWLP_WNDPROC, (LONG_PTR)m_presenterWndProc);
+        for (auto& pair : m_notifications)
+        {
+            pair.second.notification->remove_CloseRequested(
+                pair.second.closeRequestedToken);
+        }
         CHECK_FAILURE(
             m_webView2Experimental22->remove_NotificationReceived(m_notificationReceivedToken));
     }
@@ -5,10 +5,13 @@
 #pragma once
 #include "stdafx.h"
 
+#include <map>
 #include <string>
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "CustomStatusBar.h"
+#include "NotificationScheduler.h"
 
 class ScenarioNotificationReceived : public ComponentBase
 {
@@ -20,15 +23,39 @@ public:
         HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result) override;
 
 private:
+    struct NotificationEntry
+    {
+        wil::com_ptr<ICoreWebView2ExperimentalNotification> notification;
+        std::wstring origin;
+        EventRegistrationToken closeRequestedToken = {};
+    };
+
     void NavigateToNotificationPage();
-    void ShowNotification(
-        ICoreWebView2ExperimentalNotification* notification, std::wstring origin);
-    void RemoveNotification(ICoreWebView2ExperimentalNotification* notification);
+    void PresentNextNotification();
+    // Dismisses the active notification after c_displayTimeMs, unless it
+    // requires interaction.
+    void StartDismissTimer(uint64_t id);
+    static LRESULT CALLBACK
+    PresenterWndProcStatic(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+    void ShowNotification(uint64_t id);
+    void DismissActiveNotification(bool clicked);
+    void RemoveNotification(uint64_t id);
+    // Tells the page the notification was closed, then releases it.
+    void CloseNotification(uint64_t id);
+    void ReleaseNotification(uint64_t id);
 
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
     wil::com_ptr<ICoreWebView2Experimental22> m_webView2Experimental22;
     std::wstring m_sampleUri;
     EventRegistrationToken m_notificationReceivedToken = {};
-    EventRegistrationToken m_notificationCloseRequestedToken = {};
+
+    // Every notification we've accepted and not yet released, with its own
+    // CloseRequested registration.
+    std::map<uint64_t, NotificationEntry> m_notifications;
+    uint64_t m_nextNotificationId = 1;
+    NotificationScheduler m_scheduler;
+    // Shows the active notification without blocking the UI thread.
+    CustomStatusBar m_presenter;
+    WNDPROC m_presenterWndProc = nullptr;
 };
@@ -13,54 +13,42 @@
 using namespace Microsoft::WRL;
 
 ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
-    : m_webView(appWindow->GetWebView())
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
 {
     //! [WebResourceRequested2]
     wil::com_ptr<ICoreWebView2_22> webView = m_webView.try_query<ICoreWebView2_22>();
     if (webView)
     {
-        // Filter must be added for application to receive any WebResourceRequested event
-        CHECK_FAILURE(webView->AddWebResourceRequestedFilterWithRequestSourceKinds(
+        // The dispatcher adds the filter with the source kinds, which needs
+        // ICoreWebView2_22, and gets the request's source kind.
+        m_webResourceRouteId = m_appWindow->GetWebResourceDispatcher()->AddRoute(
             L"*worker.js", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL));
-        CHECK_FAILURE(m_webView->add_WebResourceRequested(
-            Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+            [this](const WebResourceDispatcher::Request& request)
+            {
+                // Ensure that script is from shared worker source
+                if (request.sourceKind ==
+                    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SHARED_WORKER)
                 {
-                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2>
-                        webResourceRequestArgs;
-                    if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&webResourceRequestArgs))))
-                    {
-                        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS requestSourceKind =
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL;
-                        CHECK_FAILURE(webResourceRequestArgs->get_RequestedSourceKind(
-                            &requestSourceKind));
-                        // Ensure that script is from shared worker source
-                        if (requestSourceKind ==
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SHARED_WORKER)
-                        {
-                            Microsoft::WRL::ComPtr<IStream> response_stream;
-                            CHECK_FAILURE(SHCreateStreamOnFileEx(
-                                L"assets/DemoWorker.js", STGM_READ, FILE_ATTRIBUTE_NORMAL,
-                                FALSE, nullptr, &response_stream));
-
-                            Microsoft::WRL::ComPtr<ICoreWebView2WebResourceResponse> response;
-                            // Get the default webview environment
-                            Microsoft::WRL::ComPtr<ICoreWebView2_2> webview2;
-                            CHECK_FAILURE(sender->QueryInterface(IID_PPV_ARGS(&webview2)));
-
-                            Microsoft::WRL::ComPtr<ICoreWebView2Environment> environment;
-                            CHECK_FAILURE(webview2->get_Environment(&environment));
-                            CHECK_FAILURE(environment->CreateWebResourceResponse(
-                                response_stream.Get(), 200, L"OK", L"", &response));
-
-                            CHECK_FAILURE(args->put_Response(response.Get()));
-                        }
-                    }
-                    return S_OK;
-                })
-                .Get(),
-            &m_webResourceRequestedToken));
+                    Microsoft::WRL::ComPtr<IStream> response_stream;
+                    CHECK_FAILURE(SHCreateStreamOnFileEx(
+                        L"assets/DemoWorker.js", STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE,
+                        nullptr, &response_stream));
+
+                    Microsoft::WRL::ComPtr<ICoreWebView2WebResourceResponse> response;
+                    // Get the default webview environment
+                    Microsoft::WRL::ComPtr<ICoreWebView2_2> webview2;
+                    CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
+
+                    Microsoft::WRL::ComPtr<ICoreWebView2Environment> environment;
+                    CHECK_FAILURE(webview2->get_Environment(&environment));
+                    CHECK_FAILURE(environment->CreateWebResourceResponse(
+                        response_stream.Get(), 200, L"OK", L"", &response));
+
+                    CHECK_FAILURE(request.args->put_Response(response.Get()));
+                }
+                return S_OK;
+            },
+            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL);
     }
     //! [WebResourceRequested2]
 
@@ -70,12 +58,5 @@ ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
 
 ScenarioSharedWorkerWRR::~ScenarioSharedWorkerWRR()
 {
-    wil::com_ptr<ICoreWebView2_22> webView = m_webView.try_query<ICoreWebView2_22>();
-    if (webView)
-    {
-        CHECK_FAILURE(webView->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
-            L"*worker.js", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL));
-    }
-    CHECK_FAILURE(m_webView->remove_WebResourceRequested(m_webResourceRequestedToken));
+    m_appWindow->GetWebResourceDispatcher()->RemoveRoute(m_webResourceRouteId);
 }
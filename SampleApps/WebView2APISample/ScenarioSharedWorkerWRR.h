@@ -17,7 +17,8 @@ public:
     ~ScenarioSharedWorkerWRR() override;
 
 private:
-    EventRegistrationToken m_webResourceRequestedToken = {};
+    uint32_t m_webResourceRouteId = WebResourceDispatcher::c_noRoute;
 
+    AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
 };
@@ -6,7 +6,294 @@
 
 #include "ScenarioThrottlingControl.h"
 
+#include <chrono>
+
 #include "CheckFailure.h"
 #include "ScriptComponent.h"
+#include "StringConversion.h"
 
 using namespace Microsoft::WRL;
+
+static constexpr WCHAR c_samplePath[] = L"ScenarioThrottlingControl.html";
+static constexpr WCHAR c_monitorPath[] = L"ScenarioThrottlingControlMonitor.html";
+// Serves the untrusted frame from the assets folder as another origin.
+static constexpr WCHAR c_untrustedHostName[] = L"untrusted.example";
+
+namespace
+{
+int64_t GetNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace
+
+ScenarioThrottlingControl::ScenarioThrottlingControl(AppWindow* appWindow)
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
+{
+    wil::com_ptr<ICoreWebView2Settings> settings;
+    CHECK_FAILURE(m_webView->get_Settings(&settings));
+    m_settings = settings.try_query<ICoreWebView2ExperimentalSettings9>();
+    auto webView2_3 = m_webView.try_query<ICoreWebView2_3>();
+    auto webView2_4 = m_webView.try_query<ICoreWebView2_4>();
+    if (!m_settings || !webView2_3 || !webView2_4)
+    {
+        FeatureNotAvailable();
+        return;
+    }
+    m_sampleUri = m_appWindow->GetLocalUri(c_samplePath);
+    m_controller.SetTopLevelUri(ToUtf8(m_sampleUri.c_str()), GetNowMs());
+    m_controller.UpdateFrame("main", ToUtf8(m_sampleUri.c_str()), GetNowMs());
+    CHECK_FAILURE(webView2_3->SetVirtualHostNameToFolderMapping(
+        c_untrustedHostName, L"assets", COREWEBVIEW2_HOST_RESOURCE_ACCESS_KIND_ALLOW));
+
+    //! [ThrottlingControl]
+    // Untrusted frames use the override interval rather than the foreground or
+    // background one. Whether a frame is untrusted depends on its origin, so
+    // the frames are classified again whenever they navigate.
+    CHECK_FAILURE(webView2_4->add_FrameCreated(
+        Callback<ICoreWebView2FrameCreatedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2FrameCreatedEventArgs* args) -> HRESULT
+            {
+                wil::com_ptr<ICoreWebView2Frame> frame;
+                CHECK_FAILURE(args->get_Frame(&frame));
+                OnFrameCreated(frame.get());
+                return S_OK;
+            })
+            .Get(),
+        &m_frameCreatedToken));
+    //! [ThrottlingControl]
+
+    // The sample page opens the monitor in a popup, whose commands this
+    // scenario handles. Other popups are left to the WebView.
+    m_appWindow->EnableHandlingNewWindowRequest(false);
+    CHECK_FAILURE(m_webView->add_NewWindowRequested(
+        Callback<ICoreWebView2NewWindowRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NewWindowRequestedEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(args->get_Uri(&uri));
+                std::wstring monitorUri = m_appWindow->GetLocalUri(c_monitorPath);
+                if (m_monitorAppWindow || uri.get() != monitorUri)
+                {
+                    return S_OK;
+                }
+                wil::com_ptr<ICoreWebView2NewWindowRequestedEventArgs> argsPtr = args;
+                wil::com_ptr<ICoreWebView2Deferral> deferral;
+                CHECK_FAILURE(args->GetDeferral(&deferral));
+                m_monitorAppWindow = new AppWindow(
+                    m_appWindow->GetCreationModeId(), m_appWindow->GetWebViewOption(),
+                    L"none", m_appWindow->GetUserDataFolder(), false,
+                    [this, argsPtr, deferral]()
+                    {
+                        CHECK_FAILURE(
+                            argsPtr->put_NewWindow(m_monitorAppWindow->GetWebView()));
+                        CHECK_FAILURE(argsPtr->put_Handled(TRUE));
+                        CHECK_FAILURE(deferral->Complete());
+                        OnMonitorCreated();
+                    },
+                    false, {0}, true, true);
+                m_monitorAppWindow->SetOnAppWindowClosing(
+                    [this]
+                    {
+                        m_monitorAppWindow = nullptr;
+                        m_monitorWebView = nullptr;
+                    });
+                return S_OK;
+            })
+            .Get(),
+        &m_newWindowRequestedToken));
+
+    // Turn off this scenario if we navigate away from the sample page
+    CHECK_FAILURE(m_webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2ContentLoadingEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                sender->get_Source(&uri);
+                if (uri.get() != m_sampleUri)
+                {
+                    m_appWindow->DeleteComponent(this);
+                }
+                return S_OK;
+            })
+            .Get(),
+        &m_contentLoadingToken));
+
+    ApplyIntervals();
+    CHECK_FAILURE(m_webView->Navigate(m_sampleUri.c_str()));
+}
+
+ScenarioThrottlingControl::~ScenarioThrottlingControl()
+{
+    if (!m_settings)
+    {
+        return;
+    }
+    for (auto& entry : m_frames)
+    {
+        entry.second.frame->remove_NavigationStarting(entry.second.navigationStartingToken);
+        entry.second.frame->remove_Destroyed(entry.second.destroyedToken);
+    }
+    if (m_monitorWebView)
+    {
+        m_monitorWebView->remove_WebMessageReceived(m_monitorWebMessageReceivedToken);
+        m_monitorAppWindow->SetOnAppWindowClosing(nullptr);
+    }
+    m_webView.query<ICoreWebView2_4>()->remove_FrameCreated(m_frameCreatedToken);
+    m_webView->remove_NewWindowRequested(m_newWindowRequestedToken);
+    m_webView->remove_ContentLoading(m_contentLoadingToken);
+    m_webView.query<ICoreWebView2_3>()->ClearVirtualHostNameToFolderMapping(
+        c_untrustedHostName);
+    m_appWindow->EnableHandlingNewWindowRequest(true);
+}
+
+void ScenarioThrottlingControl::OnFrameCreated(ICoreWebView2Frame* frame)
+{
+    wil::unique_cotaskmem_string name;
+    CHECK_FAILURE(frame->get_Name(&name));
+    std::string frameName = ToUtf8(name.get());
+    wil::com_ptr<ICoreWebView2Frame> framePtr = frame;
+    auto frame2 = framePtr.try_query<ICoreWebView2Frame2>();
+    auto frame5 = framePtr.try_query<ICoreWebView2Frame5>();
+    if (!frame2 || !frame5)
+    {
+        return;
+    }
+    UINT32 frameId = 0;
+    CHECK_FAILURE(frame5->get_FrameId(&frameId));
+    Frame& entry = m_frames[frameId];
+    entry.frame = frame2;
+    entry.name = frameName;
+    CHECK_FAILURE(entry.frame->add_NavigationStarting(
+        Callback<ICoreWebView2FrameNavigationStartingEventHandler>(
+            [this, frameName](
+                ICoreWebView2Frame* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(args->get_Uri(&uri));
+                bool untrusted =
+                    m_controller.UpdateFrame(frameName, ToUtf8(uri.get()), GetNowMs());
+                wil::com_ptr<ICoreWebView2Frame> senderPtr = sender;
+                auto frame6 = senderPtr.try_query<ICoreWebView2ExperimentalFrame6>();
+                if (frame6)
+                {
+                    CHECK_FAILURE(frame6->put_UseOverrideTimerWakeInterval(untrusted));
+                }
+                return S_OK;
+            })
+            .Get(),
+        &entry.navigationStartingToken));
+    CHECK_FAILURE(entry.frame->add_Destroyed(
+        Callback<ICoreWebView2FrameDestroyedEventHandler>(
+            [this, frameId](ICoreWebView2Frame* sender, IUnknown* args) -> HRESULT
+            {
+                OnFrameDestroyed(frameId);
+                return S_OK;
+            })
+            .Get(),
+        &entry.destroyedToken));
+}
+
+void ScenarioThrottlingControl::OnFrameDestroyed(UINT32 frameId)
+{
+    auto it = m_frames.find(frameId);
+    if (it == m_frames.end())
+    {
+        return;
+    }
+    std::string frameName = it->second.name;
+    m_frames.erase(it);
+    // The controller knows frames by the name they report their delays under,
+    // so keep its entry while another frame of the same name is alive.
+    for (const auto& entry : m_frames)
+    {
+        if (entry.second.name == frameName)
+        {
+            return;
+        }
+    }
+    m_controller.RemoveFrame(frameName);
+}
+
+void ScenarioThrottlingControl::OnMonitorCreated()
+{
+    m_monitorWebView = m_monitorAppWindow->GetWebView();
+    CHECK_FAILURE(m_monitorWebView->add_WebMessageReceived(
+        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
+                -> HRESULT
+            {
+                OnMonitorMessage(args);
+                return S_OK;
+            })
+            .Get(),
+        &m_monitorWebMessageReceivedToken));
+}
+
+void ScenarioThrottlingControl::OnMonitorMessage(ICoreWebView2WebMessageReceivedEventArgs* args)
+{
+    wil::unique_cotaskmem_string json;
+    CHECK_FAILURE(args->get_WebMessageAsJson(&json));
+    ThrottlingController::Command command;
+    if (!ThrottlingController::ParseCommand(ToUtf8(json.get()), &command))
+    {
+        return;
+    }
+    int64_t now = GetNowMs();
+    switch (command.kind)
+    {
+    case ThrottlingController::Command::Kind::SetInterval:
+        m_controller.SetInterval(command.priority, command.intervalMs, now);
+        ApplyIntervals();
+        break;
+    case ThrottlingController::Command::Kind::ToggleVisibility:
+        m_controller.SetVisible(!m_controller.IsVisible(), now);
+        CHECK_FAILURE(m_appWindow->GetWebViewController()->put_IsVisible(
+            m_controller.IsVisible()));
+        break;
+    case ThrottlingController::Command::Kind::Scenario:
+        if (m_controller.ApplyScenario(command.label, now))
+        {
+            ApplyIntervals();
+        }
+        break;
+    case ThrottlingController::Command::Kind::ReportDelay:
+        m_controller.RecordDelay(command.frameName, command.delayMs, now);
+        break;
+    }
+}
+
+void ScenarioThrottlingControl::ApplyIntervals()
+{
+    using Priority = ThrottlingController::Priority;
+    ThrottlingController::Intervals intervals = m_controller.GetIntervals();
+    CHECK_FAILURE(m_settings->put_PreferredForegroundTimerWakeIntervalInMilliseconds(
+        intervals[static_cast<size_t>(Priority::Foreground)]));
+    CHECK_FAILURE(m_settings->put_PreferredBackgroundTimerWakeIntervalInMilliseconds(
+        intervals[static_cast<size_t>(Priority::Background)]));
+    CHECK_FAILURE(m_settings->put_PreferredIntensiveTimerWakeIntervalInMilliseconds(
+        intervals[static_cast<size_t>(Priority::Intensive)]));
+    CHECK_FAILURE(m_settings->put_PreferredOverrideTimerWakeIntervalInMilliseconds(
+        intervals[static_cast<size_t>(Priority::Untrusted)]));
+}
+
+void ScenarioThrottlingControl::ShowReport()
+{
+    m_appWindow->AsyncMessageBox(ToUtf16(m_controller.GetReport()), L"Throttling Control");
+}
+
+bool ScenarioThrottlingControl::HandleWindowMessage(
+    HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result)
+{
+    if (message == WM_COMMAND && LOWORD(wParam) == IDM_SCENARIO_THROTTLING_CONTROL_REPORT)
+    {
+        ShowReport();
+        return true;
+    }
+    return false;
+}
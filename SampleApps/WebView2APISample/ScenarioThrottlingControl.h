@@ -6,5 +6,57 @@
 
 #include "stdafx.h"
 
+#include <map>
+#include <string>
+
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "ThrottlingController.h"
+
+// Opens the throttling control sample, whose monitor window sets the timer
+// wake intervals of the sample page. The untrusted frame is served from
+// another origin, so that the scenario moves it to the untrusted interval.
+// Scenario > Throttling Control > Show Report compares the timer delays the
+// frames report with the intervals.
+class ScenarioThrottlingControl : public ComponentBase
+{
+public:
+    ScenarioThrottlingControl(AppWindow* appWindow);
+    ~ScenarioThrottlingControl() override;
+
+    bool HandleWindowMessage(
+        HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result) override;
+
+private:
+    struct Frame
+    {
+        wil::com_ptr<ICoreWebView2Frame2> frame;
+        // What the frame reports its delays under.
+        std::string name;
+        EventRegistrationToken navigationStartingToken = {};
+        EventRegistrationToken destroyedToken = {};
+    };
+
+    void OnFrameCreated(ICoreWebView2Frame* frame);
+    void OnFrameDestroyed(UINT32 frameId);
+    void OnMonitorCreated();
+    void OnMonitorMessage(ICoreWebView2WebMessageReceivedEventArgs* args);
+    void ApplyIntervals();
+    void ShowReport();
+
+    AppWindow* m_appWindow = nullptr;
+    wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2ExperimentalSettings9> m_settings;
+    std::wstring m_sampleUri;
+    ThrottlingController m_controller;
+    // By frame ID, as several frames can have the same name or none.
+    std::map<UINT32, Frame> m_frames;
+
+    AppWindow* m_monitorAppWindow = nullptr;
+    wil::com_ptr<ICoreWebView2> m_monitorWebView;
+
+    EventRegistrationToken m_contentLoadingToken = {};
+    EventRegistrationToken m_frameCreatedToken = {};
+    EventRegistrationToken m_newWindowRequestedToken = {};
+    EventRegistrationToken m_monitorWebMessageReceivedToken = {};
+};
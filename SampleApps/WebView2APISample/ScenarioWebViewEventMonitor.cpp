@@ -496,64 +496,34 @@ void ScenarioWebViewEventMonitor::EnableWebResourceResponseReceivedEvent(bool en
 
 void ScenarioWebViewEventMonitor::EnableWebResourceRequestedEvent(bool enable)
 {
-    if (!enable && m_webResourceRequestedToken.value != 0)
+    WebResourceDispatcher* dispatcher = m_appWindowEventSource->GetWebResourceDispatcher();
+    if (!dispatcher)
     {
-        m_webviewEventSource->remove_WebResourceRequested(m_webResourceRequestedToken);
-        m_webResourceRequestedToken.value = 0;
+        return;
     }
-    else if (enable && m_webResourceRequestedToken.value == 0)
+    if (!enable && m_webResourceRequestedRouteId != WebResourceDispatcher::c_noRoute)
     {
-        m_webviewEventSource->AddWebResourceRequestedFilter(
-            L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL);
-
-        auto webView2_22 = m_webviewEventSource.try_query<ICoreWebView2_22>();
-        if (webView2_22)
-        {
-            webView2_22->AddWebResourceRequestedFilterWithRequestSourceKinds(
-                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-                COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL);
-        }
-
-        m_webviewEventSource->add_WebResourceRequested(
-            Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                [this](ICoreWebView2* webview, ICoreWebView2WebResourceRequestedEventArgs* args)
-                    -> HRESULT {
-                    wil::com_ptr<ICoreWebView2WebResourceRequest> webResourceRequest;
-                    CHECK_FAILURE(args->get_Request(&webResourceRequest));
-                    wil::com_ptr<ICoreWebView2WebResourceResponse> webResourceResponse;
-                    CHECK_FAILURE(args->get_Response(&webResourceResponse));
-
-                    std::wstring message =
-                        WebResourceRequestedToJsonString(webResourceRequest.get());
-
-                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs> argsPtr = args;
-                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2>
-                        webResourceRequestArgs =
-                            argsPtr.try_query<ICoreWebView2WebResourceRequestedEventArgs2>();
-                    if (webResourceRequestArgs)
-                    {
-                        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS requestedSourceKind =
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL;
-                        CHECK_FAILURE(webResourceRequestArgs->get_RequestedSourceKind(
-                            &requestedSourceKind));
-                        if (requestedSourceKind !=
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL)
-                        {
-                            std::wstring source = L", \"source\": " + WebResourceSourceToString(
-                                                                          requestedSourceKind);
-
-                            message = WebResourceRequestedToJsonString(
-                                webResourceRequest.get(), source);
-                        }
-                    }
-                    message += WebViewPropertiesToJsonString(m_webviewEventSource.get());
-                    message += L"}";
-                    PostEventMessage(message);
+        dispatcher->RemoveRoute(m_webResourceRequestedRouteId);
+        m_webResourceRequestedRouteId = WebResourceDispatcher::c_noRoute;
+    }
+    else if (enable && m_webResourceRequestedRouteId == WebResourceDispatcher::c_noRoute)
+    {
+        // An observer sees every request without taking it from the routes
+        // that answer requests. The dispatcher falls back to document requests
+        // if the WebView does not support other source kinds.
+        m_webResourceRequestedRouteId = dispatcher->AddObserver(
+            L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
+            [this](const WebResourceDispatcher::Request& request) -> HRESULT {
+                std::wstring source =
+                    L", \"source\": " + WebResourceSourceToString(request.sourceKind);
+                std::wstring message = WebResourceRequestedToJsonString(request.request, source);
+                message += WebViewPropertiesToJsonString(m_webviewEventSource.get());
+                message += L"}";
+                PostEventMessage(message);
 
-                    return S_OK;
-                })
-                .Get(),
-            &m_webResourceRequestedToken);
+                return S_OK;
+            },
+            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL);
     }
 }
 
@@ -589,6 +559,14 @@ void ScenarioWebViewEventMonitor::InitializeEventView(ICoreWebView2* webviewEven
                         {
                             EnableWebResourceResponseReceivedEvent(false);
                         }
+                        else if (wcscmp(webMessageAsString.get(), L"recordTrace,on") == 0)
+                        {
+                            EnableTraceRecording(true);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"recordTrace,off") == 0)
+                        {
+                            EnableTraceRecording(false);
+                        }
                     }
                 }
 
@@ -1176,10 +1154,36 @@ void ScenarioWebViewEventMonitor::InitializeFrameEventView(
 }
 void ScenarioWebViewEventMonitor::PostEventMessage(std::wstring message)
 {
-    HRESULT hr = m_webviewEventView->PostWebMessageAsJson(message.c_str());
+    if (m_trace.is_open())
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_traceStart);
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+        m_trace << "{\"timeMicros\":" << elapsed.count()
+                << ",\"event\":" << converter.to_bytes(message) << "}\n";
+    }
+    // Posted as a string rather than as JSON, so that the event view only
+    // parses the events it shows.
+    HRESULT hr = m_webviewEventView->PostWebMessageAsString(message.c_str());
     if (FAILED(hr))
     {
-        ShowFailure(hr, L"PostWebMessageAsJson failed:\n" + message);
+        ShowFailure(hr, L"PostWebMessageAsString failed:\n" + message);
+    }
+}
+
+void ScenarioWebViewEventMonitor::EnableTraceRecording(bool enable)
+{
+    if (!enable)
+    {
+        m_trace.close();
+        return;
+    }
+    if (!m_trace.is_open())
+    {
+        m_trace.open(
+            m_appWindowEventSource->GetLocalPath(L"EventMonitorTrace.jsonl", false),
+            std::ios::binary | std::ios::trunc);
+        m_traceStart = std::chrono::steady_clock::now();
     }
 }
 
@@ -6,8 +6,11 @@
 
 #include "stdafx.h"
 
+#include <chrono>
+#include <fstream>
 #include <string>
 #include "ComponentBase.h"
+#include "WebResourceDispatcher.h"
 
 std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status);
 
@@ -29,6 +32,10 @@ private:
     void EnableWebResourceRequestedEvent(bool enable);
 
     void EnableWebResourceResponseReceivedEvent(bool enable);
+    // Records the events sent to the event view to EventMonitorTrace.jsonl
+    // next to the executable, one JSON object per line with the time in
+    // microseconds since recording started, for replaying them later.
+    void EnableTraceRecording(bool enable);
     // Send information about an event to the event view.
     void PostEventMessage(std::wstring messageAsJson);
 
@@ -59,7 +66,7 @@ private:
     EventRegistrationToken m_DOMContentLoadedToken = {};
     EventRegistrationToken m_documentTitleChangedToken = {};
     EventRegistrationToken m_webMessageReceivedToken = {};
-    EventRegistrationToken m_webResourceRequestedToken = {};
+    uint32_t m_webResourceRequestedRouteId = WebResourceDispatcher::c_noRoute;
     EventRegistrationToken m_newWindowRequestedToken = {};
     EventRegistrationToken m_webResourceResponseReceivedToken = {};
     EventRegistrationToken m_downloadStartingToken = {};
@@ -72,6 +79,9 @@ private:
     EventRegistrationToken m_isDefaultDownloadDialogOpenChangedToken = {};
     EventRegistrationToken m_permissionRequestedToken = {};
 
+    std::ofstream m_trace;
+    std::chrono::steady_clock::time_point m_traceStart;
+
     // This event is registered with the event viewer so they
     // can communicate back to us for toggling the WebResourceRequested
     // event.
@@ -5,6 +5,8 @@
 #include "stdafx.h"
 
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -14,6 +16,7 @@
 #include "ScriptComponent.h"
 
 #include "CheckFailure.h"
+#include "StringConversion.h"
 #include "TextInputDialog.h"
 
 using namespace Microsoft::WRL;
@@ -90,9 +93,24 @@ const int64_t GetJSONIntegerField(PCWSTR JsonMessage, PCWSTR fieldName)
     return _wtoi64(message.substr(start).c_str());
 }
 
+// Console messages of all windows go to one buffer, drained to ConsoleLog.txt.
+static ConsoleLogBuffer& GetConsoleLogBuffer(AppWindow* appWindow)
+{
+    static ConsoleLogBuffer buffer(
+        [appWindow]
+        {
+            ConsoleLogBuffer::Options options;
+            options.path = appWindow->GetLocalPath(L"ConsoleLog.txt", false);
+            return options;
+        }());
+    return buffer;
+}
+
 ScriptComponent::ScriptComponent(AppWindow* appWindow)
-    : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView()),
+      m_consoleLog(&GetConsoleLogBuffer(appWindow))
 {
+    m_consoleMainTarget = m_consoleLog->InternTarget("page");
     HandleIFrames();
     HandleCDPTargets();
 }
@@ -104,6 +122,11 @@ bool ScriptComponent::HandleWindowMessage(
     LPARAM lParam,
     LRESULT* result)
 {
+    if (message == WM_TIMER && wParam == c_heapSamplingTimerId)
+    {
+        SampleHeapUsage();
+        return true;
+    }
     if (message == WM_COMMAND)
     {
         switch (LOWORD(wParam))
@@ -135,6 +158,15 @@ bool ScriptComponent::HandleWindowMessage(
         case IDM_COLLECT_HEAP_MEMORY_VIA_CDP:
             CollectHeapUsageViaCdp();
             return true;
+        case IDM_TOGGLE_HEAP_SAMPLING_VIA_CDP:
+            ToggleHeapSampling();
+            return true;
+        case IDM_SHOW_RECENT_CONSOLE_WARNINGS:
+            ShowRecentConsoleWarnings();
+            return true;
+        case IDM_EXPORT_HEAP_TRENDS:
+            ExportHeapTrends();
+            return true;
         case IDM_ADD_HOST_OBJECT:
             AddComObject();
             return true;
@@ -558,8 +590,10 @@ void ScriptComponent::HandleCDPTargets()
                 // Get console.log message details and which target it comes from.
                 wil::unique_cotaskmem_string parameterObjectAsJson;
                 CHECK_FAILURE(args->get_ParameterObjectAsJson(&parameterObjectAsJson));
-                std::wstring eventSourceLabel;
-                std::wstring eventDetails = parameterObjectAsJson.get();
+                // Leave the default target of top page, with no label, if the session is
+                // unknown.
+                uint32_t target = m_consoleMainTarget;
+                const std::wstring* eventSourceLabel = nullptr;
                 wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceivedEventArgs2> args2;
                 if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2))))
                 {
@@ -567,22 +601,34 @@ void ScriptComponent::HandleCDPTargets()
                     CHECK_FAILURE(args2->get_SessionId(&sessionId));
                     if (sessionId.get() && *sessionId.get())
                     {
-                        std::wstring targetId = m_devToolsSessionMap[sessionId.get()];
-                        eventSourceLabel = m_devToolsTargetLabelMap[targetId];
+                        auto it = m_consoleTargets.find(sessionId.get());
+                        if (it != m_consoleTargets.end())
+                        {
+                            target = it->second.id;
+                            eventSourceLabel = &it->second.label;
+                        }
                     }
                 }
-                // else, leave eventSourceLabel as empty string for the default target of top
-                // page.
 
                 // Log events to debug output, not using dialog as there could be a lot of
                 // console.log events.
                 std::wstring message = L"console.log Event: ";
-                if (!eventSourceLabel.empty())
+                if (eventSourceLabel)
                 {
-                    message = message + L"(from " + eventSourceLabel + L")";
+                    message = message + L"(from " + *eventSourceLabel + L")";
                 }
-                message += eventDetails + L"\n";
+                message += parameterObjectAsJson.get();
+                message += L"\n";
                 OutputDebugString(message.c_str());
+
+                // Also keep them in the buffer that ConsoleLog.txt is written from in the
+                // background. The UTF-8 copy reuses the same string, so that pushing
+                // doesn't allocate once it has grown to the largest message.
+                int64_t timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::system_clock::now().time_since_epoch())
+                                         .count();
+                ToUtf8(parameterObjectAsJson.get(), &m_consoleUtf8);
+                m_consoleLog->PushConsoleApiCalled(timeMicros, target, m_consoleUtf8);
                 return S_OK;
             })
             .Get(),
@@ -606,6 +652,20 @@ void ScriptComponent::HandleCDPTargets()
                 std::wstring type = GetJSONStringField(jsonMessage.get(), L"type");
                 std::wstring url = GetJSONStringField(jsonMessage.get(), L"url");
                 m_devToolsTargetLabelMap.insert_or_assign(targetId, type + L"," + url);
+                ConsoleTarget& consoleTarget = m_consoleTargets[sessionId];
+                uint32_t consoleTargetId =
+                    m_consoleLog->InternTarget(ToUtf8(type + L"," + url));
+                if (!consoleTarget.label.empty())
+                {
+                    // Attached again; drop the reference of the previous attach.
+                    m_consoleLog->ReleaseTarget(consoleTarget.id);
+                }
+                consoleTarget.id = consoleTargetId;
+                consoleTarget.label = type + L"," + url;
+                if (m_heapSampling)
+                {
+                    m_heapSampler.AddTarget(ToUtf8(sessionId), ToUtf8(type + L"," + url));
+                }
                 wil::com_ptr<ICoreWebView2_11> webview2 =
                     m_webView.try_query<ICoreWebView2_11>();
                 if (webview2)
@@ -644,6 +704,13 @@ void ScriptComponent::HandleCDPTargets()
                     m_devToolsTargetLabelMap.erase(session->second);
                     m_devToolsSessionMap.erase(session);
                 }
+                auto consoleTarget = m_consoleTargets.find(sessionId);
+                if (consoleTarget != m_consoleTargets.end())
+                {
+                    m_consoleLog->ReleaseTarget(consoleTarget->second.id);
+                    m_consoleTargets.erase(consoleTarget);
+                }
+                m_heapSampler.RemoveTarget(ToUtf8(sessionId));
                 return S_OK;
             })
             .Get(),
@@ -773,6 +840,120 @@ void ScriptComponent::HandleHeapUsageResult(std::wstring targetInfo, PCWSTR resu
     }
 }
 
+void ScriptComponent::ToggleHeapSampling()
+{
+    wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
+    CHECK_FEATURE_RETURN_EMPTY(webview2);
+    HWND mainWindow = m_appWindow->GetMainWindow();
+    m_heapSampling = !m_heapSampling;
+    if (!m_heapSampling)
+    {
+        KillTimer(mainWindow, c_heapSamplingTimerId);
+        m_appWindow->AsyncMessageBox(
+            L"Heap sampling stopped. Export Heap Trends still shows the samples taken.",
+            L"Heap Sampling");
+        return;
+    }
+    m_heapSampler.Clear();
+    m_heapSampler.AddTarget("", "Main Page");
+    for (const auto& target : m_devToolsSessionMap)
+    {
+        m_heapSampler.AddTarget(
+            ToUtf8(target.first), ToUtf8(m_devToolsTargetLabelMap[target.second]));
+    }
+    SetTimer(mainWindow, c_heapSamplingTimerId, c_heapSamplingTickMs, nullptr);
+    SampleHeapUsage();
+    m_appWindow->AsyncMessageBox(
+        L"Sampling the heap usage of every target periodically. Likely leaks are reported "
+        L"to the debug output.",
+        L"Heap Sampling");
+}
+
+void ScriptComponent::SampleHeapUsage()
+{
+    wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
+    for (const std::string& target : m_heapSampler.GetDueTargets(GetTickCount64()))
+    {
+        auto handler = Callback<ICoreWebView2CallDevToolsProtocolMethodCompletedHandler>(
+            [this, target](HRESULT error, PCWSTR resultJson) -> HRESULT
+            {
+                if (FAILED(error))
+                {
+                    m_heapSampler.OnSampleFailed(target);
+                    return S_OK;
+                }
+                // Results are folded into the trend as they arrive, so there
+                // is no fan-in to wait for.
+                bool leak = m_heapSampler.OnSample(
+                    target, GetTickCount64(),
+                    double(GetJSONIntegerField(resultJson, L"usedSize")),
+                    double(GetJSONIntegerField(resultJson, L"totalSize")));
+                if (leak)
+                {
+                    HeapUsageSampler::Trend trend = m_heapSampler.GetTrend(target);
+                    std::wstringstream message;
+                    message << L"Likely JS heap leak: " << ToUtf16(trend.label) << L" grows "
+                            << int64_t(trend.bytesPerSecond / 1024) << L" KB/s\n";
+                    OutputDebugString(message.str().c_str());
+                }
+                return S_OK;
+            });
+        if (target.empty())
+        {
+            m_webView->CallDevToolsProtocolMethod(
+                L"Runtime.getHeapUsage", L"{}", handler.Get());
+        }
+        else
+        {
+            webview2->CallDevToolsProtocolMethodForSession(
+                ToUtf16(target).c_str(), L"Runtime.getHeapUsage", L"{}", handler.Get());
+        }
+    }
+}
+
+void ScriptComponent::ExportHeapTrends()
+{
+    std::wstring path = m_appWindow->GetLocalPath(L"HeapTrends.json", false);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::string json = m_heapSampler.ExportJson();
+    out.write(json.data(), json.size());
+    out.close();
+
+    std::wstringstream message;
+    message << (out ? L"Exported heap trends to " : L"Failed to write ") << path << L"\n";
+    for (const HeapUsageSampler::Trend& trend : m_heapSampler.GetTrends())
+    {
+        message << L"\n" << (trend.likelyLeak ? L"[likely leak] " : L"")
+                << int64_t(trend.bytesPerSecond / 1024) << L" KB/s, used "
+                << int64_t(trend.usedSize / 1024) << L" KB, " << ToUtf16(trend.label);
+    }
+    m_appWindow->AsyncMessageBox(message.str(), L"Heap Trends");
+}
+
+void ScriptComponent::ShowRecentConsoleWarnings()
+{
+    const size_t maxCount = 20;
+    m_consoleLog->Flush();
+    std::vector<ConsoleLogBuffer::Record> records = m_consoleLog->Query(
+        ConsoleLogBuffer::c_anyTarget, ConsoleLogBuffer::Level::Warning, maxCount);
+    ConsoleLogBuffer::Counters counters = m_consoleLog->GetCounters();
+
+    std::wstringstream message;
+    message << counters.pushed << L" console messages, " << counters.written
+            << L" written to ConsoleLog.txt, " << counters.dropped << L" dropped.\n";
+    if (records.empty())
+    {
+        message << L"\nNo recent warnings or errors.";
+    }
+    for (const ConsoleLogBuffer::Record& record : records)
+    {
+        message << L"\n[" << ConsoleLogBuffer::GetLevelName(record.level) << L"] "
+                << ToUtf16(m_consoleLog->GetTargetName(record.target)) << L": "
+                << ToUtf16(record.args) << (record.truncated ? L"..." : L"");
+    }
+    m_appWindow->AsyncMessageBox(message.str(), L"Recent Console Warnings");
+}
+
     //! [DevToolsProtocolEventReceived]
 // Prompt the user to name a CDP event, and then subscribe to that event.
 void ScriptComponent::SubscribeToCdpEvent()
@@ -1284,6 +1465,10 @@ void ScriptComponent::OpenTaskManagerWindow()
 
 ScriptComponent::~ScriptComponent()
 {
+    if (m_heapSampling)
+    {
+        KillTimer(m_appWindow->GetMainWindow(), c_heapSamplingTimerId);
+    }
     for (auto& pair : m_devToolsProtocolEventReceivedTokenMap)
     {
         wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
@@ -1315,4 +1500,9 @@ ScriptComponent::~ScriptComponent()
             L"Runtime.consoleAPICalled", &receiver));
         receiver->remove_DevToolsProtocolEventReceived(m_consoleAPICalledToken);
     }
+    for (const auto& consoleTarget : m_consoleTargets)
+    {
+        m_consoleLog->ReleaseTarget(consoleTarget.second.id);
+    }
+    m_consoleLog->ReleaseTarget(m_consoleMainTarget);
 }
@@ -14,6 +14,8 @@
 
 #include "AppWindow.h"
 #include "ComponentBase.h"
+#include "ConsoleLogBuffer.h"
+#include "HeapUsageSampler.h"
 
 const std::wstring GetJSONStringField(PCWSTR jsonMessage, PCWSTR fieldName);
 
@@ -44,6 +46,10 @@ private:
     HRESULT CDPMethodCallback(HRESULT error, PCWSTR resultJson);
     void CollectHeapUsageViaCdp();
     void HandleHeapUsageResult(std::wstring targetInfo, PCWSTR resultJson);
+    void ToggleHeapSampling();
+    void SampleHeapUsage();
+    void ExportHeapTrends();
+    void ShowRecentConsoleWarnings();
     void AddComObject();
     void OpenTaskManagerWindow();
     void SendStringWebMessageIFrame();
@@ -75,6 +81,27 @@ private:
     std::map<std::wstring, std::wstring> m_devToolsTargetLabelMap;
     int m_pendingHeapUsageCollectionCount = 0;
     std::wstringstream m_heapUsageResult;
+
+    // The timer only wakes the sampler, which decides which targets are due.
+    static constexpr UINT_PTR c_heapSamplingTimerId = 0x4853;
+    static constexpr UINT c_heapSamplingTickMs = 1000;
+    bool m_heapSampling = false;
+    // Keyed by session ID, with an empty ID for the main page.
+    HeapUsageSampler m_heapSampler;
+
+    // Shared by all windows. Targets are interned when they attach, so logging
+    // a console message does not look up or build its label.
+    ConsoleLogBuffer* m_consoleLog = nullptr;
+    uint32_t m_consoleMainTarget = 0;
+    struct ConsoleTarget
+    {
+        uint32_t id = 0;
+        // "<target type>,<target url>", for the debug output.
+        std::wstring label;
+    };
+    // SessionId to interned target map
+    std::map<std::wstring, ConsoleTarget> m_consoleTargets;
+    std::string m_consoleUtf8;
 };
 
 #endif
@@ -6,16 +6,45 @@
 
 #include "SettingsComponent.h"
 
+#include "CertificateTrustStore.h"
 #include "CheckFailure.h"
+#include "FaviconCache.h"
 #include "ScenarioPermissionManagement.h"
+#include "StringConversion.h"
 #include "TextInputDialog.h"
 #include <gdiplus.h>
 #include <shellapi.h>
 #include <shlwapi.h>
+#include <sstream>
 #include <windows.h>
 
 using namespace Microsoft::WRL;
 
+// Decoded favicons shared by all windows, backed by FaviconCache.bin next to the
+// executable. GDI+ must be started before the first lookup.
+static FaviconCache<wil::unique_hicon>& GetFaviconCache(AppWindow* appWindow)
+{
+    static FaviconCache<wil::unique_hicon> s_cache(
+        appWindow->GetLocalPath(L"FaviconCache.bin", false),
+        [](const uint8_t* png, size_t size) -> std::shared_ptr<wil::unique_hicon>
+        {
+            wil::com_ptr<IStream> stream;
+            stream.attach(SHCreateMemStream(png, static_cast<UINT>(size)));
+            if (!stream)
+            {
+                return nullptr;
+            }
+            Gdiplus::Bitmap iconBitmap(stream.get());
+            auto icon = std::make_shared<wil::unique_hicon>();
+            if (iconBitmap.GetHICON(icon->put()) != Gdiplus::Status::Ok)
+            {
+                return nullptr;
+            }
+            return icon;
+        });
+    return s_cache;
+}
+
 SettingsComponent::SettingsComponent(
     AppWindow* appWindow, ICoreWebView2Environment* environment, SettingsComponent* old)
     : m_appWindow(appWindow), m_webViewEnvironment(environment),
@@ -226,31 +255,52 @@ SettingsComponent::SettingsComponent(
                         CHECK_FAILURE(webview2->get_FaviconUri(&url));
                         std::wstring strUrl(url.get());
 
+                        // Icons seen before, in this or another window, are used
+                        // without fetching and decoding them again. A stale one is
+                        // shown while it is fetched again, in case the site changed it.
+                        std::string cacheKey = ToUtf8(strUrl.c_str());
+                        bool stale = false;
+                        if (!cacheKey.empty())
+                        {
+                            if (auto icon = GetFaviconCache(m_appWindow).Find(cacheKey, &stale))
+                            {
+                                ShowFavicon(std::move(icon), strUrl);
+                                if (!stale)
+                                {
+                                    return S_OK;
+                                }
+                            }
+                        }
+
                         webview2->GetFavicon(
                             COREWEBVIEW2_FAVICON_IMAGE_FORMAT_PNG,
                             Callback<ICoreWebView2GetFaviconCompletedHandler>(
-                                [this,
-                                 strUrl](HRESULT errorCode, IStream* iconStream) -> HRESULT
+                                [this, strUrl, cacheKey, stale](
+                                    HRESULT errorCode, IStream* iconStream) -> HRESULT
                                 {
                                     CHECK_FAILURE(errorCode);
-                                    Gdiplus::Bitmap iconBitmap(iconStream);
-                                    wil::unique_hicon icon;
-                                    if (iconBitmap.GetHICON(&icon) == Gdiplus::Status::Ok)
+                                    std::vector<uint8_t> png;
+                                    BYTE buffer[4096];
+                                    ULONG read = 0;
+                                    while (SUCCEEDED(iconStream->Read(
+                                               buffer, sizeof(buffer), &read)) &&
+                                           read > 0)
                                     {
-                                        m_favicon = std::move(icon);
-                                        SendMessage(
-                                            m_appWindow->GetMainWindow(), WM_SETICON,
-                                            ICON_SMALL, (LPARAM)m_favicon.get());
-                                        m_statusBar.Show(strUrl);
+                                        png.insert(png.end(), buffer, buffer + read);
                                     }
-                                    else
+                                    std::shared_ptr<wil::unique_hicon> icon;
+                                    if (!cacheKey.empty() && !png.empty())
                                     {
-                                        SendMessage(
-                                            m_appWindow->GetMainWindow(), WM_SETICON,
-                                            ICON_SMALL, (LPARAM)IDC_NO);
-                                        m_statusBar.Show(L"No Icon");
+                                        icon = GetFaviconCache(m_appWindow)
+                                                   .Add(cacheKey, png.data(), png.size());
                                     }
-
+                                    // A revalidated icon that didn't change is
+                                    // already shown.
+                                    if (stale && (!icon || icon == m_favicon))
+                                    {
+                                        return S_OK;
+                                    }
+                                    ShowFavicon(std::move(icon), strUrl);
                                     return S_OK;
                                 })
                                 .Get());
@@ -1499,58 +1549,49 @@ bool SettingsComponent::ShouldBlockScriptForUri(PWSTR uri)
     return false;
 }
 
-// Turn on or off image blocking by adding or removing a WebResourceRequested handler
+// Turn on or off image blocking by adding or removing a web resource route
 // which selectively intercepts requests for images.
 void SettingsComponent::SetBlockImages(bool blockImages)
 {
     if (blockImages != m_blockImages)
     {
         m_blockImages = blockImages;
+        WebResourceDispatcher* dispatcher = m_appWindow->GetWebResourceDispatcher();
 
         //! [WebResourceRequested0]
         if (m_blockImages)
         {
-            m_webView->AddWebResourceRequestedFilter(
-                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE);
-            CHECK_FAILURE(m_webView->add_WebResourceRequested(
-                Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                    [this](
-                        ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
-                    {
-                        COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext;
-                        CHECK_FAILURE(args->get_ResourceContext(&resourceContext));
-                        // Ensure that the type is image
-                        if (resourceContext != COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE)
-                        {
-                            return E_INVALIDARG;
-                        }
-                        // Override the response with an empty one to block the image.
-                        // If put_Response is not called, the request will
-                        // continue as normal.
-                        wil::com_ptr<ICoreWebView2WebResourceResponse> response;
-                        wil::com_ptr<ICoreWebView2Environment> environment;
-                        wil::com_ptr<ICoreWebView2_2> webview2;
-                        CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
-                        CHECK_FAILURE(webview2->get_Environment(&environment));
-                        CHECK_FAILURE(environment->CreateWebResourceResponse(
-                            nullptr, 403 /*NoContent*/, L"Blocked", L"Content-Type: image/jpeg",
-                            &response));
-                        CHECK_FAILURE(args->put_Response(response.get()));
-                        return S_OK;
-                    })
-                    .Get(),
-                &m_webResourceRequestedTokenForImageBlocking));
+            // The dispatcher adds the filter, and only calls the handler for
+            // image requests.
+            m_imageBlockingRouteId = dispatcher->AddRoute(
+                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE,
+                [this](const WebResourceDispatcher::Request& request)
+                {
+                    // Override the response with an empty one to block the image.
+                    // If put_Response is not called, the request will
+                    // continue as normal.
+                    wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+                    wil::com_ptr<ICoreWebView2Environment> environment;
+                    wil::com_ptr<ICoreWebView2_2> webview2;
+                    CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
+                    CHECK_FAILURE(webview2->get_Environment(&environment));
+                    CHECK_FAILURE(environment->CreateWebResourceResponse(
+                        nullptr, 403 /*NoContent*/, L"Blocked", L"Content-Type: image/jpeg",
+                        &response));
+                    CHECK_FAILURE(request.args->put_Response(response.get()));
+                    return S_OK;
+                });
         }
         else
         {
-            CHECK_FAILURE(m_webView->remove_WebResourceRequested(
-                m_webResourceRequestedTokenForImageBlocking));
+            dispatcher->RemoveRoute(m_imageBlockingRouteId);
+            m_imageBlockingRouteId = WebResourceDispatcher::c_noRoute;
         }
         //! [WebResourceRequested0]
     }
 }
 
-// Turn on or off image replacing by adding or removing a WebResourceRequested handler
+// Turn on or off image replacing by adding or removing a web resource route
 // which selectively intercepts requests for images. It will replace all images with another
 // image.
 void SettingsComponent::SetReplaceImages(bool replaceImages)
@@ -1558,50 +1599,40 @@ void SettingsComponent::SetReplaceImages(bool replaceImages)
     if (replaceImages != m_replaceImages)
     {
         m_replaceImages = replaceImages;
+        WebResourceDispatcher* dispatcher = m_appWindow->GetWebResourceDispatcher();
         //! [WebResourceRequested1]
         if (m_replaceImages)
         {
-            m_webView->AddWebResourceRequestedFilter(
-                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE);
-            CHECK_FAILURE(m_webView->add_WebResourceRequested(
-                Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                    [this](
-                        ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
-                    {
-                        COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext;
-                        CHECK_FAILURE(args->get_ResourceContext(&resourceContext));
-                        // Ensure that the type is image
-                        if (resourceContext != COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE)
-                        {
-                            return E_INVALIDARG;
-                        }
-                        // Override the response with an another image.
-                        // If put_Response is not called, the request will
-                        // continue as normal.
-                        // It's not required for this scenario, but generally you should examine
-                        // relevant HTTP request headers just like an HTTP server would do when
-                        // producing a response stream.
-                        wil::com_ptr<IStream> stream;
-                        CHECK_FAILURE(SHCreateStreamOnFileEx(
-                            L"assets/EdgeWebView2-80.jpg", STGM_READ, FILE_ATTRIBUTE_NORMAL,
-                            FALSE, nullptr, &stream));
-                        wil::com_ptr<ICoreWebView2WebResourceResponse> response;
-                        wil::com_ptr<ICoreWebView2Environment> environment;
-                        wil::com_ptr<ICoreWebView2_2> webview2;
-                        CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
-                        CHECK_FAILURE(webview2->get_Environment(&environment));
-                        CHECK_FAILURE(environment->CreateWebResourceResponse(
-                            stream.get(), 200, L"OK", L"Content-Type: image/jpeg", &response));
-                        CHECK_FAILURE(args->put_Response(response.get()));
-                        return S_OK;
-                    })
-                    .Get(),
-                &m_webResourceRequestedTokenForImageReplacing));
+            // If image blocking is also on, the route added last gets the request.
+            m_imageReplacingRouteId = dispatcher->AddRoute(
+                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE,
+                [this](const WebResourceDispatcher::Request& request)
+                {
+                    // Override the response with an another image.
+                    // If put_Response is not called, the request will
+                    // continue as normal.
+                    // It's not required for this scenario, but generally you should examine
+                    // relevant HTTP request headers just like an HTTP server would do when
+                    // producing a response stream.
+                    wil::com_ptr<IStream> stream;
+                    CHECK_FAILURE(SHCreateStreamOnFileEx(
+                        L"assets/EdgeWebView2-80.jpg", STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE,
+                        nullptr, &stream));
+                    wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+                    wil::com_ptr<ICoreWebView2Environment> environment;
+                    wil::com_ptr<ICoreWebView2_2> webview2;
+                    CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
+                    CHECK_FAILURE(webview2->get_Environment(&environment));
+                    CHECK_FAILURE(environment->CreateWebResourceResponse(
+                        stream.get(), 200, L"OK", L"Content-Type: image/jpeg", &response));
+                    CHECK_FAILURE(request.args->put_Response(response.get()));
+                    return S_OK;
+                });
         }
         else
         {
-            CHECK_FAILURE(m_webView->remove_WebResourceRequested(
-                m_webResourceRequestedTokenForImageReplacing));
+            dispatcher->RemoveRoute(m_imageReplacingRouteId);
+            m_imageReplacingRouteId = WebResourceDispatcher::c_noRoute;
         }
         //! [WebResourceRequested1]
     }
@@ -1644,9 +1675,37 @@ void SettingsComponent::SetUserAgent(const std::wstring& userAgent)
     }
 }
 
+// The certificates this app trusts, shared by all windows. Loaded once from
+// TrustedCertificates.pem next to the executable, if there is one.
+static CertificateTrustStore& GetCertificateTrustStore(AppWindow* appWindow)
+{
+    static CertificateTrustStore* s_store = [appWindow]
+    {
+        auto store = new CertificateTrustStore();
+        wil::unique_hfile file(CreateFile(
+            appWindow->GetLocalPath(L"TrustedCertificates.pem", false).c_str(),
+            GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        LARGE_INTEGER size = {};
+        if (file && GetFileSizeEx(file.get(), &size) && size.QuadPart < 16 * 1024 * 1024)
+        {
+            std::string pem(static_cast<size_t>(size.QuadPart), '\0');
+            DWORD read = 0;
+            if (ReadFile(file.get(), &pem[0], static_cast<DWORD>(pem.size()), &read, nullptr))
+            {
+                pem.resize(read);
+                store->AddPemBundle(pem);
+            }
+        }
+        return store;
+    }();
+    return *s_store;
+}
+
 // Turn off client certificate selection dialog using ClientCertificateRequested event handler
 // that disables the dialog. This example hides the default client certificate dialog and
-// always chooses the last certificate without prompting the user.
+// chooses the first certificate issued by a certificate in the app's trust store, or the
+// last certificate if none is, without prompting the user.
 //! [ClientCertificateRequested1]
 void SettingsComponent::EnableCustomClientCertificateSelection()
 {
@@ -1672,10 +1731,29 @@ void SettingsComponent::EnableCustomClientCertificateSelection()
 
                         if (certificateCollectionCount > 0)
                         {
-                            // There is no significance to the order, picking a certificate
-                            // arbitrarily.
-                            CHECK_FAILURE(certificateCollection->GetValueAtIndex(
-                                certificateCollectionCount - 1, &certificate));
+                            // The order has no significance, so look the issuers up in the
+                            // trust store's issuer index first.
+                            CertificateTrustStore& trustStore =
+                                GetCertificateTrustStore(m_appWindow);
+                            for (UINT i = 0; i < certificateCollectionCount && !certificate;
+                                 i++)
+                            {
+                                wil::com_ptr<ICoreWebView2ClientCertificate> candidate;
+                                wil::unique_cotaskmem_string pem;
+                                CHECK_FAILURE(
+                                    certificateCollection->GetValueAtIndex(i, &candidate));
+                                CHECK_FAILURE(candidate->ToPemEncoding(&pem));
+                                if (trustStore.HasTrustedIssuer(ToUtf8(pem.get())))
+                                {
+                                    certificate = candidate;
+                                }
+                            }
+                            if (!certificate)
+                            {
+                                // Otherwise pick a certificate arbitrarily.
+                                CHECK_FAILURE(certificateCollection->GetValueAtIndex(
+                                    certificateCollectionCount - 1, &certificate));
+                            }
                             // Continue with the selected certificate to respond to the server.
                             CHECK_FAILURE(args->put_SelectedCertificate(certificate.get()));
                             CHECK_FAILURE(args->put_Handled(TRUE));
@@ -1703,21 +1781,19 @@ void SettingsComponent::EnableCustomClientCertificateSelection()
 
 // Function to validate the server certificate for untrusted root or self-signed certificate.
 // You may also choose to defer server certificate validation.
-static bool ValidateServerCertificate(ICoreWebView2Certificate* certificate)
+static bool ValidateServerCertificate(
+    CertificateTrustStore& trustStore, PCWSTR host, ICoreWebView2Certificate* certificate)
 {
     // You may want to validate certificates in different ways depending on your app and
-    // scenario. One way might be the following:
-    // First, get the list of host app trusted certificates and its thumbprint.
-    //
-    // Then get the last chain element using
-    // `ICoreWebView2Certificate::get_PemEncodedIssuerCertificateChain` that contains the raw
-    // data of the untrusted root CA/self-signed certificate. Get the untrusted root CA/self
-    // signed certificate thumbprint from the raw certificate data and validate the thumbprint
-    // against the host app trusted certificate list.
-    //
-    // Finally, return true if it exists in the host app's certificate trusted list, or
-    // otherwise return false.
-    return true;
+    // scenario. This example trusts the certificate only if its own SHA-256 thumbprint is
+    // in the host app's trusted list. The chain from
+    // `ICoreWebView2Certificate::get_PemEncodedIssuerCertificateChain` is sent by the
+    // server and isn't validated here, so a pinned certificate in it proves nothing.
+    wil::unique_cotaskmem_string leafPem;
+    CHECK_FAILURE(certificate->ToPemEncoding(&leafPem));
+
+    // Repeated errors from the same host are answered from the store's verdict cache.
+    return trustStore.IsTrusted(ToUtf8(host ? host : L""), ToUtf8(leafPem.get()));
 }
 
 //! [ServerCertificateErrorDetected1]
@@ -1742,13 +1818,19 @@ void SettingsComponent::ToggleCustomServerCertificateSupport()
                         wil::com_ptr<ICoreWebView2Certificate> certificate = nullptr;
                         CHECK_FAILURE(args->get_ServerCertificate(&certificate));
 
+                        wil::unique_cotaskmem_string requestUri;
+                        CHECK_FAILURE(args->get_RequestUri(&requestUri));
+                        wil::unique_bstr host = GetDomainOfUri(requestUri.get());
+
                         // Continues the request to a server with a TLS certificate if the error
                         // status is of type
                         // `COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_IS_INVALID` and trusted by
                         // the host app.
                         if (errorStatus ==
                                 COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_IS_INVALID &&
-                            ValidateServerCertificate(certificate.get()))
+                            ValidateServerCertificate(
+                                GetCertificateTrustStore(m_appWindow), host.get(),
+                                certificate.get()))
                         {
                             CHECK_FAILURE(args->put_Action(
                                 COREWEBVIEW2_SERVER_CERTIFICATE_ERROR_ACTION_ALWAYS_ALLOW));
@@ -1802,11 +1884,45 @@ void SettingsComponent::SetTrackingPreventionLevel(COREWEBVIEW2_TRACKING_PREVENT
 }
 //! [SetTrackingPreventionLevel]
 
+void SettingsComponent::ShowFavicon(
+    std::shared_ptr<wil::unique_hicon> icon, const std::wstring& faviconUri)
+{
+    if (icon)
+    {
+        // Keep the icon alive for as long as the window uses it.
+        m_favicon = std::move(icon);
+        SendMessage(
+            m_appWindow->GetMainWindow(), WM_SETICON, ICON_SMALL,
+            (LPARAM)m_favicon->get());
+        m_statusBar.Show(faviconUri);
+    }
+    else
+    {
+        SendMessage(m_appWindow->GetMainWindow(), WM_SETICON, ICON_SMALL, (LPARAM)IDC_NO);
+        m_statusBar.Show(L"No Icon");
+    }
+
+    auto counters = GetFaviconCache(m_appWindow).GetCounters();
+    std::wstringstream message;
+    message << L"Favicon cache: " << counters.memoryHits << L" memory hits, "
+            << counters.diskHits << L" disk hits, " << counters.misses << L" misses ("
+            << static_cast<int>(counters.GetHitRate() * 100) << L"%), "
+            << counters.deduplicatedIcons << L" duplicate icons, " << counters.decodes
+            << L" decodes in " << counters.decodeMilliseconds << L" ms\n";
+    OutputDebugString(message.str().c_str());
+}
+
 SettingsComponent::~SettingsComponent()
 {
     m_webView->remove_NavigationStarting(m_navigationStartingToken);
     m_webView->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
-    m_webView->remove_WebResourceRequested(m_webResourceRequestedTokenForImageBlocking);
+    // The dispatcher is gone if this component outlived its WebView to pass its
+    // settings on, and route IDs are not reused, so this is safe either way.
+    if (WebResourceDispatcher* dispatcher = m_appWindow->GetWebResourceDispatcher())
+    {
+        dispatcher->RemoveRoute(m_imageBlockingRouteId);
+        dispatcher->RemoveRoute(m_imageReplacingRouteId);
+    }
     m_webView->remove_ScriptDialogOpening(m_scriptDialogOpeningToken);
     m_webView->remove_PermissionRequested(m_permissionRequestedToken);
 }
@@ -7,6 +7,7 @@
 #include "stdafx.h"
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -51,6 +52,8 @@ public:
 private:
     HRESULT OnPermissionRequested(
         ICoreWebView2* sender, ICoreWebView2PermissionRequestedEventArgs* args);
+    // `icon` is null if the page has no favicon or it could not be decoded.
+    void ShowFavicon(std::shared_ptr<wil::unique_hicon> icon, const std::wstring& faviconUri);
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
     wil::com_ptr<ICoreWebView2_5> m_webView2_5;
@@ -86,7 +89,7 @@ private:
     std::wstring m_overridingUserAgent;
     ULONG_PTR gdiplusToken_;
     bool m_faviconChanged = false;
-    wil::unique_hicon m_favicon;
+    std::shared_ptr<wil::unique_hicon> m_favicon;
     CustomStatusBar m_statusBar;
     bool m_customStatusBar = false;
     bool m_raiseServerCertificateError = false;
@@ -94,8 +97,8 @@ private:
 
     EventRegistrationToken m_navigationStartingToken = {};
     EventRegistrationToken m_frameNavigationStartingToken = {};
-    EventRegistrationToken m_webResourceRequestedTokenForImageBlocking = {};
-    EventRegistrationToken m_webResourceRequestedTokenForImageReplacing = {};
+    uint32_t m_imageBlockingRouteId = WebResourceDispatcher::c_noRoute;
+    uint32_t m_imageReplacingRouteId = WebResourceDispatcher::c_noRoute;
     EventRegistrationToken m_webResourceRequestedTokenForUserAgent = {};
     EventRegistrationToken m_scriptDialogOpeningToken = {};
     EventRegistrationToken m_permissionRequestedToken = {};
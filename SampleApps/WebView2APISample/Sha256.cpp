@@ -0,0 +1,302 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHA256_TARGET
+#else
+#include <cpuid.h>
+#define SHA256_TARGET __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+namespace
+{
+alignas(16) constexpr uint32_t c_roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+    0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+    0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+    0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2};
+
+constexpr uint32_t c_initialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t RotateRight(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline uint32_t LoadBigEndian32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) |
+           uint32_t(p[3]);
+}
+
+void TransformPortable(uint32_t state[8], const uint8_t* data, size_t blocks)
+{
+    uint32_t w[64];
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = LoadBigEndian32(data + 4 * i);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^
+                          (w[i - 15] >> 3);
+            uint32_t s1 =
+                RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + c_roundConstants[i] + w[i];
+            uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if defined(SHA256_X86)
+bool DetectShaExtensions()
+{
+    // SHA is CPUID.(EAX=7,ECX=0):EBX[29]; the shuffles need SSSE3 and SSE4.1,
+    // CPUID.1:ECX[9] and [19].
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuidex(info, 1, 0);
+    bool sse = (info[2] & (1 << 9)) && (info[2] & (1 << 19));
+    __cpuidex(info, 7, 0);
+    return sse && (info[1] & (1 << 29));
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+    {
+        return false;
+    }
+    __cpuid_count(1, 0, eax, ebx, ecx, edx);
+    bool sse = (ecx & (1u << 9)) && (ecx & (1u << 19));
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return sse && (ebx & (1u << 29));
+#endif
+}
+
+// Runs rounds 4i..4i+3 with the schedule words in `wi`, and extends the
+// message schedule: `wNext` holds sha256msg1 of W(i-3), W(i-2) and becomes
+// W(i+1); `wPrev` holds W(i-1) and becomes the sha256msg1 input for W(i+3).
+// Written as a macro so each of the 16 expansions folds its bounds checks.
+#define SHA256_FOUR_ROUNDS(i, wi, wNext, wPrev)                                          \
+    {                                                                                    \
+        __m128i message = _mm_add_epi32(                                                 \
+            wi, _mm_load_si128(reinterpret_cast<const __m128i*>(c_roundConstants + 4 * i))); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, message);                         \
+        if (i >= 3 && i <= 14)                                                           \
+        {                                                                                \
+            wNext = _mm_sha256msg2_epu32(                                                \
+                _mm_add_epi32(wNext, _mm_alignr_epi8(wi, wPrev, 4)), wi);                \
+        }                                                                                \
+        message = _mm_shuffle_epi32(message, 0x0E);                                      \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, message);                         \
+        if (i >= 1 && i <= 12)                                                           \
+        {                                                                                \
+            wPrev = _mm_sha256msg1_epu32(wPrev, wi);                                     \
+        }                                                                                \
+    }
+
+SHA256_TARGET void TransformShaExtensions(uint32_t state[8], const uint8_t* data, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Rearrange the state into the ABEF/CDGH layout the instructions expect.
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i w0 = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), byteSwap);
+        __m128i w1 = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), byteSwap);
+        __m128i w2 = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), byteSwap);
+        __m128i w3 = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), byteSwap);
+        SHA256_FOUR_ROUNDS(0, w0, w1, w3);
+        SHA256_FOUR_ROUNDS(1, w1, w2, w0);
+        SHA256_FOUR_ROUNDS(2, w2, w3, w1);
+        SHA256_FOUR_ROUNDS(3, w3, w0, w2);
+        SHA256_FOUR_ROUNDS(4, w0, w1, w3);
+        SHA256_FOUR_ROUNDS(5, w1, w2, w0);
+        SHA256_FOUR_ROUNDS(6, w2, w3, w1);
+        SHA256_FOUR_ROUNDS(7, w3, w0, w2);
+        SHA256_FOUR_ROUNDS(8, w0, w1, w3);
+        SHA256_FOUR_ROUNDS(9, w1, w2, w0);
+        SHA256_FOUR_ROUNDS(10, w2, w3, w1);
+        SHA256_FOUR_ROUNDS(11, w3, w0, w2);
+        SHA256_FOUR_ROUNDS(12, w0, w1, w3);
+        SHA256_FOUR_ROUNDS(13, w1, w2, w0);
+        SHA256_FOUR_ROUNDS(14, w2, w3, w1);
+        SHA256_FOUR_ROUNDS(15, w3, w0, w2);
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+#undef SHA256_FOUR_ROUNDS
+#endif
+
+const bool s_hasShaExtensions =
+#if defined(SHA256_X86)
+    DetectShaExtensions();
+#else
+    false;
+#endif
+} // namespace
+
+Sha256::Sha256()
+{
+    std::memcpy(m_state, c_initialState, sizeof(m_state));
+}
+
+void Sha256::Update(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_totalBytes += size;
+    if (m_bufferSize > 0)
+    {
+        size_t take = (std::min)(size, sizeof(m_buffer) - m_bufferSize);
+        std::memcpy(m_buffer + m_bufferSize, bytes, take);
+        m_bufferSize += take;
+        bytes += take;
+        size -= take;
+        if (m_bufferSize < sizeof(m_buffer))
+        {
+            return;
+        }
+        Transform(m_buffer, 1);
+        m_bufferSize = 0;
+    }
+    // Hash whole blocks straight from the caller's buffer.
+    size_t blocks = size / 64;
+    if (blocks > 0)
+    {
+        Transform(bytes, blocks);
+        bytes += blocks * 64;
+        size -= blocks * 64;
+    }
+    std::memcpy(m_buffer, bytes, size);
+    m_bufferSize = size;
+}
+
+Sha256::Digest Sha256::Finish()
+{
+    uint64_t bitLength = m_totalBytes * 8;
+    uint8_t padding[72] = {0x80};
+    size_t padSize = (m_bufferSize < 56 ? 56 : 120) - m_bufferSize;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padSize + i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+    }
+    Update(padding, padSize + 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; i++)
+    {
+        digest[4 * i] = static_cast<uint8_t>(m_state[i] >> 24);
+        digest[4 * i + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+        digest[4 * i + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+        digest[4 * i + 3] = static_cast<uint8_t>(m_state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::Hash(const void* data, size_t size)
+{
+    Sha256 sha;
+    sha.Update(data, size);
+    return sha.Finish();
+}
+
+std::string Sha256::ToHex(const Digest& digest)
+{
+    static constexpr char c_hexDigits[] = "0123456789abcdef";
+    std::string hex(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); i++)
+    {
+        hex[2 * i] = c_hexDigits[digest[i] >> 4];
+        hex[2 * i + 1] = c_hexDigits[digest[i] & 0xF];
+    }
+    return hex;
+}
+
+bool Sha256::IsHardwareAccelerated()
+{
+    return s_hasShaExtensions;
+}
+
+void Sha256::Transform(const uint8_t* data, size_t blocks)
+{
+#if defined(SHA256_X86)
+    if (s_hasShaExtensions)
+    {
+        TransformShaExtensions(m_state, data, blocks);
+        return;
+    }
+#endif
+    TransformPortable(m_state, data, blocks);
+}
@@ -0,0 +1,39 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental SHA-256. Uses the x86 SHA extensions when the CPU has them and
+// falls back to a portable implementation otherwise. Has no dependency on
+// Win32 so it can be built and measured on any platform.
+class Sha256
+{
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    void Update(const void* data, size_t size);
+    // Returns the digest of everything passed to Update. The object must not
+    // be updated again afterwards.
+    Digest Finish();
+
+    static Digest Hash(const void* data, size_t size);
+    // Lower case hex, as printed by sha256sum.
+    static std::string ToHex(const Digest& digest);
+    static bool IsHardwareAccelerated();
+
+private:
+    void Transform(const uint8_t* data, size_t blocks);
+
+    uint32_t m_state[8];
+    uint8_t m_buffer[64];
+    size_t m_bufferSize = 0;
+    uint64_t m_totalBytes = 0;
+};
@@ -0,0 +1,61 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "StringConversion.h"
+
+namespace
+{
+void ConvertToUtf8(PCWSTR text, int length, std::string* result)
+{
+    int size = 0;
+    if (length > 0)
+    {
+        size = WideCharToMultiByte(CP_UTF8, 0, text, length, nullptr, 0, nullptr, nullptr);
+    }
+    result->resize(size > 0 ? size : 0);
+    if (size > 0)
+    {
+        WideCharToMultiByte(CP_UTF8, 0, text, length, &(*result)[0], size, nullptr, nullptr);
+    }
+}
+} // namespace
+
+std::string ToUtf8(PCWSTR text)
+{
+    std::string result;
+    ToUtf8(text, &result);
+    return result;
+}
+
+std::string ToUtf8(const std::wstring& text)
+{
+    std::string result;
+    ConvertToUtf8(text.c_str(), static_cast<int>(text.size()), &result);
+    return result;
+}
+
+void ToUtf8(PCWSTR text, std::string* result)
+{
+    ConvertToUtf8(text, static_cast<int>(wcslen(text)), result);
+}
+
+std::wstring ToUtf16(const std::string& text)
+{
+    std::wstring result;
+    if (text.empty())
+    {
+        return result;
+    }
+    int size = MultiByteToWideChar(
+        CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0);
+    if (size > 0)
+    {
+        result.resize(size);
+        MultiByteToWideChar(
+            CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), &result[0], size);
+    }
+    return result;
+}
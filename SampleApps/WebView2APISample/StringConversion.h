@@ -0,0 +1,21 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <string>
+
+// Conversions between the UTF-16 of the WebView2 and Win32 APIs and the UTF-8
+// that the portable helpers take.
+
+// `text` is null-terminated.
+std::string ToUtf8(PCWSTR text);
+std::string ToUtf8(const std::wstring& text);
+// Converts into `result`, reusing its capacity, for callers that convert on
+// every event.
+void ToUtf8(PCWSTR text, std::string* result);
+
+std::wstring ToUtf16(const std::string& text);
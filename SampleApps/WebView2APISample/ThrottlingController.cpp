@@ -0,0 +1,407 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ThrottlingController.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+// Finds "key": value in the flat objects the monitor posts and returns the
+// value, unquoted if it is a string. Nested objects are searched as well, as
+// the keys of a command are all distinct.
+bool FindJsonValue(std::string_view json, std::string_view key, std::string* value)
+{
+    size_t position = 0;
+    while ((position = json.find(key, position)) != std::string_view::npos)
+    {
+        size_t end = position + key.size();
+        bool quoted = position > 0 && json[position - 1] == '"' && end < json.size() &&
+                      json[end] == '"';
+        position = end;
+        if (!quoted)
+        {
+            continue;
+        }
+        end++;
+        while (end < json.size() && isspace(static_cast<unsigned char>(json[end])))
+        {
+            end++;
+        }
+        if (end >= json.size() || json[end] != ':')
+        {
+            continue;
+        }
+        end++;
+        while (end < json.size() && isspace(static_cast<unsigned char>(json[end])))
+        {
+            end++;
+        }
+        value->clear();
+        if (end < json.size() && json[end] == '"')
+        {
+            for (end++; end < json.size() && json[end] != '"'; end++)
+            {
+                if (json[end] == '\\' && end + 1 < json.size())
+                {
+                    end++;
+                }
+                value->push_back(json[end]);
+            }
+            return end < json.size();
+        }
+        while (end < json.size() && json[end] != ',' && json[end] != '}' &&
+               !isspace(static_cast<unsigned char>(json[end])))
+        {
+            value->push_back(json[end++]);
+        }
+        return !value->empty();
+    }
+    return false;
+}
+
+// Parses the whole of `text` as a finite, non-negative number.
+bool ParseNumber(const std::string& text, double* number)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end != text.c_str() + text.size() || !std::isfinite(value) || value < 0)
+    {
+        return false;
+    }
+    *number = value;
+    return true;
+}
+} // namespace
+
+ThrottlingController::ThrottlingController()
+    // The defaults of Chromium: foreground timers are not throttled, and the
+    // untrusted interval matches the background one.
+    : m_requested{0, 1000, 60 * 1000, 1000}
+{
+}
+
+bool ThrottlingController::ParseCommand(std::string_view json, Command* command)
+{
+    std::string name;
+    if (!FindJsonValue(json, "command", &name))
+    {
+        return false;
+    }
+    std::string value;
+    if (name == "set-interval")
+    {
+        double interval = 0;
+        if (!FindJsonValue(json, "priority", &value) ||
+            !ParsePriority(value, &command->priority) ||
+            !FindJsonValue(json, "intervalMs", &value) || !ParseNumber(value, &interval) ||
+            interval > c_maxIntervalMs)
+        {
+            return false;
+        }
+        command->kind = Command::Kind::SetInterval;
+        command->intervalMs = static_cast<uint32_t>(std::lround(interval));
+        return true;
+    }
+    if (name == "toggle-visibility")
+    {
+        command->kind = Command::Kind::ToggleVisibility;
+        return true;
+    }
+    if (name == "scenario")
+    {
+        if (!FindJsonValue(json, "label", &command->label))
+        {
+            return false;
+        }
+        command->kind = Command::Kind::Scenario;
+        return true;
+    }
+    if (name == "report-delay")
+    {
+        if (!FindJsonValue(json, "frameId", &command->frameName) ||
+            !FindJsonValue(json, "delayAvg", &value) || !ParseNumber(value, &command->delayMs))
+        {
+            return false;
+        }
+        command->kind = Command::Kind::ReportDelay;
+        return true;
+    }
+    return false;
+}
+
+bool ThrottlingController::ParsePriority(std::string_view name, Priority* priority)
+{
+    for (size_t i = 0; i < c_priorityCount; i++)
+    {
+        if (name == GetPriorityName(static_cast<Priority>(i)))
+        {
+            *priority = static_cast<Priority>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ThrottlingController::GetPriorityName(Priority priority)
+{
+    switch (priority)
+    {
+    case Priority::Foreground:
+        return "foreground";
+    case Priority::Background:
+        return "background";
+    case Priority::Intensive:
+        return "intensive";
+    case Priority::Untrusted:
+        return "untrusted";
+    }
+    return "";
+}
+
+std::string ThrottlingController::GetOrigin(std::string_view uri)
+{
+    size_t scheme = uri.find("://");
+    if (scheme == std::string_view::npos || scheme == 0)
+    {
+        return std::string();
+    }
+    size_t hostEnd = uri.find_first_of("/?#", scheme + 3);
+    std::string_view authority = uri.substr(
+        scheme + 3, hostEnd == std::string_view::npos ? std::string_view::npos
+                                                      : hostEnd - scheme - 3);
+    // Drop any user info.
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos)
+    {
+        authority.remove_prefix(at + 1);
+    }
+    if (authority.empty())
+    {
+        return std::string();
+    }
+    std::string origin(uri.substr(0, scheme + 3));
+    origin += authority;
+    std::transform(
+        origin.begin(), origin.end(), origin.begin(),
+        [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return origin;
+}
+
+void ThrottlingController::SetInterval(Priority priority, uint32_t intervalMs, int64_t nowMs)
+{
+    m_requested[static_cast<size_t>(priority)] = (std::min)(intervalMs, c_maxIntervalMs);
+    m_lastChangeMs = nowMs;
+}
+
+bool ThrottlingController::ApplyScenario(std::string_view label, int64_t nowMs)
+{
+    if (label == "interaction-throttle")
+    {
+        m_throttleWithoutInteraction = true;
+    }
+    else if (label == "interaction-reset")
+    {
+        m_throttleWithoutInteraction = false;
+    }
+    else if (label == "hidden-unthrottle")
+    {
+        m_unthrottleHidden = true;
+    }
+    else if (label == "hidden-reset")
+    {
+        m_unthrottleHidden = false;
+    }
+    else
+    {
+        return false;
+    }
+    m_lastChangeMs = nowMs;
+    return true;
+}
+
+ThrottlingController::Intervals ThrottlingController::GetIntervals() const
+{
+    Intervals intervals = m_requested;
+    uint32_t foreground = m_requested[static_cast<size_t>(Priority::Foreground)];
+    uint32_t background = m_requested[static_cast<size_t>(Priority::Background)];
+    if (m_throttleWithoutInteraction)
+    {
+        intervals[static_cast<size_t>(Priority::Foreground)] =
+            (std::max)(foreground, background);
+    }
+    if (m_unthrottleHidden)
+    {
+        intervals[static_cast<size_t>(Priority::Background)] = foreground;
+        intervals[static_cast<size_t>(Priority::Intensive)] = foreground;
+    }
+    return intervals;
+}
+
+void ThrottlingController::SetVisible(bool visible, int64_t nowMs)
+{
+    if (visible == m_visible)
+    {
+        return;
+    }
+    m_visible = visible;
+    m_hiddenSinceMs = nowMs;
+    m_lastChangeMs = nowMs;
+}
+
+void ThrottlingController::SetTopLevelUri(std::string_view uri, int64_t nowMs)
+{
+    std::string origin = GetOrigin(uri);
+    if (origin == m_topLevelOrigin)
+    {
+        return;
+    }
+    m_topLevelOrigin = std::move(origin);
+    for (auto& entry : m_frames)
+    {
+        Frame& frame = entry.second;
+        frame.untrusted = !IsTrustedOrigin(frame.origin);
+    }
+    m_lastChangeMs = nowMs;
+}
+
+void ThrottlingController::AddTrustedOrigin(std::string_view origin)
+{
+    m_trustedOrigins.insert(GetOrigin(origin));
+}
+
+bool ThrottlingController::IsTrustedOrigin(const std::string& origin) const
+{
+    // Frames without an origin, such as about:blank, belong to their parent.
+    return origin.empty() || origin == m_topLevelOrigin || m_trustedOrigins.count(origin) > 0;
+}
+
+bool ThrottlingController::UpdateFrame(
+    const std::string& name, std::string_view uri, int64_t nowMs)
+{
+    Frame& frame = m_frames[name];
+    frame.origin = GetOrigin(uri);
+    bool untrusted = !IsTrustedOrigin(frame.origin);
+    if (untrusted != frame.untrusted)
+    {
+        frame.untrusted = untrusted;
+        m_lastChangeMs = nowMs;
+    }
+    return untrusted;
+}
+
+void ThrottlingController::RemoveFrame(const std::string& name)
+{
+    m_frames.erase(name);
+}
+
+bool ThrottlingController::IsUntrusted(const std::string& name) const
+{
+    auto it = m_frames.find(name);
+    return it != m_frames.end() && it->second.untrusted;
+}
+
+ThrottlingController::Priority ThrottlingController::GetFramePriority(
+    const std::string& name, int64_t nowMs) const
+{
+    if (IsUntrusted(name))
+    {
+        return Priority::Untrusted;
+    }
+    if (m_visible)
+    {
+        return Priority::Foreground;
+    }
+    return nowMs - m_hiddenSinceMs >= c_intensiveAfterMs ? Priority::Intensive
+                                                         : Priority::Background;
+}
+
+bool ThrottlingController::RecordDelay(const std::string& name, double delayMs, int64_t nowMs)
+{
+    // The report averages the last c_stepsPerSample delays, which must all
+    // have run under the current policy.
+    int64_t startMs = nowMs - static_cast<int64_t>(std::ceil(delayMs * c_stepsPerSample));
+    Priority priority = GetFramePriority(name, nowMs);
+    if (startMs <= m_lastChangeMs || GetFramePriority(name, startMs) != priority)
+    {
+        m_dropped++;
+        return false;
+    }
+    uint32_t requested = GetIntervals()[static_cast<size_t>(priority)];
+    Stats& stats = m_frames[name].stats[{priority, requested}];
+    stats.min = stats.count == 0 ? delayMs : (std::min)(stats.min, delayMs);
+    stats.max = stats.count == 0 ? delayMs : (std::max)(stats.max, delayMs);
+    stats.count++;
+    stats.sum += delayMs;
+    return true;
+}
+
+double ThrottlingController::GetUnthrottledDelay() const
+{
+    double unthrottled = 0;
+    for (const auto& frame : m_frames)
+    {
+        for (const auto& entry : frame.second.stats)
+        {
+            if (entry.first.second == 0 && entry.second.count > 0)
+            {
+                double mean = entry.second.sum / entry.second.count;
+                unthrottled = unthrottled == 0 ? mean : (std::min)(unthrottled, mean);
+            }
+        }
+    }
+    return unthrottled > 0 ? unthrottled : c_defaultUnthrottledDelayMs;
+}
+
+std::string ThrottlingController::GetReport() const
+{
+    std::string report;
+    char line[256];
+    Intervals intervals = GetIntervals();
+    report += "Intervals:";
+    for (size_t i = 0; i < c_priorityCount; i++)
+    {
+        snprintf(
+            line, sizeof(line), " %s %u ms%s", GetPriorityName(static_cast<Priority>(i)),
+            intervals[i], i + 1 < c_priorityCount ? "," : "\n");
+        report += line;
+    }
+    double unthrottled = GetUnthrottledDelay();
+    snprintf(
+        line, sizeof(line), "Unthrottled delay %.2f ms, %llu reports dropped\n", unthrottled,
+        static_cast<unsigned long long>(m_dropped));
+    report += line;
+
+    for (const auto& frame : m_frames)
+    {
+        report += "\n" + frame.first + " (" +
+                  (frame.second.origin.empty() ? "no origin" : frame.second.origin) +
+                  (frame.second.untrusted ? ", untrusted" : "") + ")\n";
+        for (const auto& entry : frame.second.stats)
+        {
+            const Stats& stats = entry.second;
+            double mean = stats.sum / stats.count;
+            // Each wake-up costs about the same, so the wake-ups saved compared
+            // to unthrottled timers approximate the CPU saved.
+            double saved = mean > 0 ? (std::max)(0.0, 1 - unthrottled / mean) : 0;
+            snprintf(
+                line, sizeof(line),
+                "  %s at %u ms: %llu reports, mean %.2f ms (min %.2f, max %.2f), "
+                "%.1f wake-ups/s, %.0f%% fewer than unthrottled\n",
+                GetPriorityName(entry.first.first), entry.first.second,
+                static_cast<unsigned long long>(stats.count), mean, stats.min, stats.max,
+                mean > 0 ? 1000 / mean : 0.0, saved * 100);
+            report += line;
+        }
+    }
+    return report;
+}
@@ -0,0 +1,156 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// ThrottlingController holds the timer throttling policy of the Throttling
+// Control scenario and measures how well the WebView follows it.
+//
+// The policy is a preferred timer wake interval for each priority: frames of a
+// visible page run at the foreground interval, frames of a hidden page at the
+// background interval and, once the page has been hidden for a while, at the
+// intensive interval. Frames from origins other than the top-level document's
+// that are not trusted run at the untrusted interval whether the page is
+// visible or not. The host applies GetIntervals to the WebView's settings and
+// marks the frames UpdateFrame reports as untrusted.
+//
+// The frames report the average delay of a setInterval(..., 0) timer over
+// c_stepsPerSample steps. RecordDelay files each report under the interval the
+// frame was expected to run at, dropping reports that span a policy change,
+// and GetReport compares the measured delays with the requested intervals and
+// with the delay of unthrottled timers.
+//
+// Times are in milliseconds on any monotonic clock. Not thread-safe. Has no
+// dependency on Win32.
+class ThrottlingController
+{
+public:
+    enum class Priority
+    {
+        Foreground,
+        Background,
+        Intensive,
+        Untrusted,
+    };
+    static constexpr size_t c_priorityCount = 4;
+    using Intervals = std::array<uint32_t, c_priorityCount>;
+
+    // Chromium throttles chained timers of pages hidden for five minutes.
+    static constexpr int64_t c_intensiveAfterMs = 5 * 60 * 1000;
+    static constexpr uint32_t c_maxIntervalMs = 60 * 60 * 1000;
+    // As in ScenarioThrottlingControl.js.
+    static constexpr uint32_t c_stepsPerSample = 20;
+    // Used as the unthrottled delay until one has been measured: the minimum
+    // delay of nested timers in HTML.
+    static constexpr double c_defaultUnthrottledDelayMs = 4.0;
+
+    // A message posted by ScenarioThrottlingControlMonitor.js.
+    struct Command
+    {
+        enum class Kind
+        {
+            SetInterval,
+            ToggleVisibility,
+            Scenario,
+            ReportDelay,
+        };
+        Kind kind = Kind::ToggleVisibility;
+        // SetInterval
+        Priority priority = Priority::Foreground;
+        uint32_t intervalMs = 0;
+        // Scenario
+        std::string label;
+        // ReportDelay
+        std::string frameName;
+        double delayMs = 0;
+    };
+
+    ThrottlingController();
+
+    // Returns false if `json` is not a valid command.
+    static bool ParseCommand(std::string_view json, Command* command);
+    static bool ParsePriority(std::string_view name, Priority* priority);
+    static const char* GetPriorityName(Priority priority);
+    // Returns "scheme://host[:port]" in lower case, or an empty string.
+    static std::string GetOrigin(std::string_view uri);
+
+    void SetInterval(Priority priority, uint32_t intervalMs, int64_t nowMs);
+    uint32_t GetRequestedInterval(Priority priority) const
+    {
+        return m_requested[static_cast<size_t>(priority)];
+    }
+    // Scenarios of the monitor page: "interaction-throttle" throttles the
+    // foreground like the background while there is no user interaction,
+    // "hidden-unthrottle" keeps hidden pages at the foreground interval, and
+    // the "-reset" labels undo them. Returns false for unknown labels.
+    bool ApplyScenario(std::string_view label, int64_t nowMs);
+    // The intervals to apply, with the scenarios taken into account.
+    Intervals GetIntervals() const;
+
+    void SetVisible(bool visible, int64_t nowMs);
+    bool IsVisible() const
+    {
+        return m_visible;
+    }
+
+    void SetTopLevelUri(std::string_view uri, int64_t nowMs);
+    void AddTrustedOrigin(std::string_view origin);
+    // Returns whether the frame should use the untrusted interval now that it
+    // is at `uri`.
+    bool UpdateFrame(const std::string& name, std::string_view uri, int64_t nowMs);
+    void RemoveFrame(const std::string& name);
+    bool IsUntrusted(const std::string& name) const;
+    // The priority the frame's timers run at. Frames that were not updated are
+    // taken to be trusted.
+    Priority GetFramePriority(const std::string& name, int64_t nowMs) const;
+
+    // Returns false if the report was dropped because it spans a change.
+    bool RecordDelay(const std::string& name, double delayMs, int64_t nowMs);
+    uint64_t GetDroppedCount() const
+    {
+        return m_dropped;
+    }
+    std::string GetReport() const;
+
+private:
+    struct Stats
+    {
+        uint64_t count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+    };
+
+    struct Frame
+    {
+        std::string origin;
+        bool untrusted = false;
+        // By priority and requested interval.
+        std::map<std::pair<Priority, uint32_t>, Stats> stats;
+    };
+
+    bool IsTrustedOrigin(const std::string& origin) const;
+    double GetUnthrottledDelay() const;
+
+    Intervals m_requested;
+    bool m_throttleWithoutInteraction = false;
+    bool m_unthrottleHidden = false;
+    bool m_visible = true;
+    int64_t m_hiddenSinceMs = 0;
+    int64_t m_lastChangeMs = INT64_MIN;
+
+    std::string m_topLevelOrigin;
+    std::set<std::string> m_trustedOrigins;
+    std::map<std::string, Frame> m_frames;
+    uint64_t m_dropped = 0;
+};
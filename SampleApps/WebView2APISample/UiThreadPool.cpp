@@ -0,0 +1,301 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "UiThreadPool.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "App.h"
+
+namespace
+{
+constexpr wchar_t c_messageWindowClass[] = L"UiThreadPoolMessageWindow";
+// Posted to a thread's message window. Messages to a window, unlike thread
+// messages, are still dispatched while the thread runs a modal loop.
+constexpr UINT WM_CREATE_REQUESTED_WINDOWS = WM_APP + 1;
+constexpr UINT WM_PROBE = WM_APP + 2;
+constexpr UINT WM_SHUTDOWN = WM_APP + 3;
+
+double ElapsedMicros(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since)
+        .count();
+}
+} // namespace
+
+thread_local UiThreadPool::Thread* UiThreadPool::s_currentThread = nullptr;
+
+UiThreadPool& UiThreadPool::Get()
+{
+    static UiThreadPool s_pool;
+    return s_pool;
+}
+
+void UiThreadPool::SetThreadCount(size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadCount = (std::max)(size_t(1), (std::min)(count, c_maxThreadCount));
+}
+
+void UiThreadPool::OpenWindow(AppWindow* source)
+{
+    WindowRequest request = {
+        source->GetCreationModeId(), source->GetWebViewOption(),
+        std::chrono::steady_clock::now()};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Thread* best = nullptr;
+        double bestLoad = 0;
+        for (const auto& thread : m_threads)
+        {
+            if (thread->exited)
+            {
+                continue;
+            }
+            double load = thread->windows + thread->requests.size() +
+                          thread->latencyMs / c_latencyPerWindowMs;
+            if (!best || load < bestLoad)
+            {
+                best = thread.get();
+                bestLoad = load;
+            }
+        }
+        // Only start another thread when every running thread has a window.
+        bool bestIsIdle = best && !best->windows && best->requests.empty();
+        if (!bestIsIdle && m_threads.size() < m_threadCount && !m_shuttingDown)
+        {
+            if (Thread* started = StartThread())
+            {
+                best = started;
+            }
+        }
+        if (best)
+        {
+            best->requests.push_back(std::move(request));
+            // A thread that is still starting creates its windows once it
+            // has a message window.
+            if (best->messageWindow)
+            {
+                PostMessage(best->messageWindow, WM_CREATE_REQUESTED_WINDOWS, 0, 0);
+            }
+            return;
+        }
+    }
+    // No pool thread could be started, so open the window on this thread.
+    new AppWindow(request.creationModeId, request.option);
+}
+
+// Called with m_mutex held.
+UiThreadPool::Thread* UiThreadPool::StartThread()
+{
+    if (m_threads.empty())
+    {
+        WNDCLASSEXW windowClass = {};
+        windowClass.cbSize = sizeof(windowClass);
+        windowClass.lpfnWndProc = MessageWindowProc;
+        windowClass.hInstance = g_hInstance;
+        windowClass.lpszClassName = c_messageWindowClass;
+        RegisterClassExW(&windowClass);
+    }
+    auto thread = std::make_unique<Thread>();
+    thread->handle = CreateThread(
+        nullptr, 0, ThreadProc, thread.get(), STACK_SIZE_PARAM_IS_A_RESERVATION,
+        &thread->id);
+    if (!thread->handle)
+    {
+        return nullptr;
+    }
+    m_threads.push_back(std::move(thread));
+    return m_threads.back().get();
+}
+
+DWORD WINAPI UiThreadPool::ThreadProc(void* param)
+{
+    UiThreadPool& pool = Get();
+    Thread* thread = static_cast<Thread*>(param);
+    s_currentThread = thread;
+    HWND messageWindow = CreateWindowExW(
+        0, c_messageWindowClass, nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, g_hInstance,
+        nullptr);
+    SetTimer(messageWindow, c_probeTimerId, c_probeIntervalMs, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(pool.m_mutex);
+        thread->messageWindow = messageWindow;
+        // Shutdown may have started before there was a window to tell.
+        if (pool.m_shuttingDown)
+        {
+            PostMessage(messageWindow, WM_SHUTDOWN, 0, 0);
+        }
+    }
+    pool.CreateRequestedWindows(thread);
+
+    int result = 0;
+    for (;;)
+    {
+        // The pump returns whenever the last window of this thread closes,
+        // but the thread stays for later windows until the pool shuts down.
+        result = RunMessagePump();
+        std::lock_guard<std::mutex> lock(pool.m_mutex);
+        if (pool.m_shuttingDown && !thread->windows && thread->requests.empty())
+        {
+            thread->exited = true;
+            thread->messageWindow = nullptr;
+            break;
+        }
+    }
+    DestroyWindow(messageWindow);
+    return result;
+}
+
+void UiThreadPool::CreateRequestedWindows(Thread* thread)
+{
+    for (;;)
+    {
+        WindowRequest request;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (thread->requests.empty())
+            {
+                return;
+            }
+            request = std::move(thread->requests.front());
+            thread->requests.pop_front();
+            thread->windowRequestLatency.Record(
+                static_cast<uint64_t>(ElapsedMicros(request.requested)));
+        }
+        new AppWindow(request.creationModeId, request.option);
+    }
+}
+
+LRESULT CALLBACK
+UiThreadPool::MessageWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    UiThreadPool& pool = Get();
+    Thread* thread = s_currentThread;
+    switch (message)
+    {
+    case WM_CREATE_REQUESTED_WINDOWS:
+        pool.CreateRequestedWindows(thread);
+        return 0;
+    case WM_TIMER:
+        if (wParam == c_probeTimerId && !thread->probing)
+        {
+            // Only this thread reads and writes the probe state.
+            thread->probing = true;
+            thread->probeSent = std::chrono::steady_clock::now();
+            PostMessage(hWnd, WM_PROBE, 0, 0);
+        }
+        return 0;
+    case WM_PROBE:
+    {
+        double latencyMicros = ElapsedMicros(thread->probeSent);
+        thread->probing = false;
+        std::lock_guard<std::mutex> lock(pool.m_mutex);
+        thread->probeLatency.Record(static_cast<uint64_t>(latencyMicros));
+        thread->latencyMs += (latencyMicros / 1000 - thread->latencyMs) * c_latencySmoothing;
+        return 0;
+    }
+    case WM_SHUTDOWN:
+    {
+        std::lock_guard<std::mutex> lock(pool.m_mutex);
+        if (!thread->windows && thread->requests.empty())
+        {
+            PostQuitMessage(0);
+        }
+        return 0;
+    }
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+void UiThreadPool::OnWindowOpened()
+{
+    if (Thread* thread = s_currentThread)
+    {
+        std::lock_guard<std::mutex> lock(Get().m_mutex);
+        thread->windows++;
+    }
+}
+
+void UiThreadPool::OnWindowClosed()
+{
+    if (Thread* thread = s_currentThread)
+    {
+        std::lock_guard<std::mutex> lock(Get().m_mutex);
+        thread->windows--;
+    }
+}
+
+std::wstring UiThreadPool::GetMetricsReport()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::wstringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << L"Threads started: " << m_threads.size() << L" of " << m_threadCount
+           << L"\nWindows on the main thread are not included.\n";
+    for (const auto& thread : m_threads)
+    {
+        report << L"\nThread " << thread->id << L": " << thread->windows << L" windows"
+               << (thread->exited ? L", exited" : L"")
+               << L"\n  Queue latency: " << thread->latencyMs << L" ms smoothed, p50 "
+               << thread->probeLatency.GetValueAtPercentile(50) / 1000.0 << L" ms, p99 "
+               << thread->probeLatency.GetValueAtPercentile(99) / 1000.0 << L" ms, max "
+               << thread->probeLatency.GetMax() / 1000.0 << L" ms"
+               << L"\n  Window request wait: p50 "
+               << thread->windowRequestLatency.GetValueAtPercentile(50) / 1000.0
+               << L" ms, max " << thread->windowRequestLatency.GetMax() / 1000.0 << L" ms ("
+               << thread->windowRequestLatency.GetCount() << L" windows)";
+    }
+    return report.str();
+}
+
+void UiThreadPool::Shutdown()
+{
+    // No thread starts once shutting down, so the handles are fixed.
+    std::vector<HANDLE> handles;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shuttingDown = true;
+        for (const auto& thread : m_threads)
+        {
+            handles.push_back(thread->handle);
+            if (thread->messageWindow)
+            {
+                PostMessage(thread->messageWindow, WM_SHUTDOWN, 0, 0);
+            }
+        }
+    }
+
+    std::vector<HANDLE> running = handles;
+    while (!running.empty())
+    {
+        DWORD index = MsgWaitForMultipleObjects(
+            static_cast<DWORD>(running.size()), running.data(), FALSE, INFINITE, QS_ALLEVENTS);
+        if (index == WAIT_OBJECT_0 + running.size())
+        {
+            MSG msg;
+            while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+        }
+        else if (index < WAIT_OBJECT_0 + running.size())
+        {
+            running.erase(running.begin() + (index - WAIT_OBJECT_0));
+        }
+        else
+        {
+            break;
+        }
+    }
+    for (HANDLE handle : handles)
+    {
+        CloseHandle(handle);
+    }
+}
@@ -0,0 +1,94 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AppWindow.h"
+#include "HdrHistogram.h"
+
+// UiThreadPool hosts the windows opened with "Create New Thread" on a fixed
+// number of UI threads, each running its own message pump, instead of
+// starting a thread per window. Threads are started as windows need them, up
+// to the pool size, and stay for the life of the process.
+//
+// A new window goes to the thread with the lowest load: its open and pending
+// windows, plus its message queue latency as measured by a probe posted to
+// the thread every second, counting c_latencyPerWindowMs as one window.
+class UiThreadPool
+{
+public:
+    static constexpr size_t c_defaultThreadCount = 4;
+    // MsgWaitForMultipleObjects waits for at most MAXIMUM_WAIT_OBJECTS - 1.
+    static constexpr size_t c_maxThreadCount = 32;
+    static constexpr double c_latencyPerWindowMs = 16;
+
+    static UiThreadPool& Get();
+
+    // Takes effect for threads started afterwards.
+    void SetThreadCount(size_t count);
+    // Opens a copy of `source` on a pool thread.
+    void OpenWindow(AppWindow* source);
+    // Called by every AppWindow, on its thread, to count the windows of
+    // pool threads.
+    static void OnWindowOpened();
+    static void OnWindowClosed();
+
+    std::wstring GetMetricsReport();
+    // Called on the main thread once its own windows have closed. Waits for
+    // the windows of the pool threads to close, then for the threads to exit.
+    void Shutdown();
+
+private:
+    struct WindowRequest
+    {
+        UINT creationModeId;
+        WebViewCreateOption option;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    struct Thread
+    {
+        DWORD id = 0;
+        HANDLE handle = nullptr;
+        HWND messageWindow = nullptr;
+        size_t windows = 0;
+        std::deque<WindowRequest> requests;
+        bool exited = false;
+        // Smoothed probe latency, for placing windows.
+        double latencyMs = 0;
+        bool probing = false;
+        std::chrono::steady_clock::time_point probeSent;
+        // In microseconds.
+        HdrHistogram probeLatency;
+        HdrHistogram windowRequestLatency;
+    };
+
+    static constexpr UINT c_probeTimerId = 0x5450;
+    static constexpr UINT c_probeIntervalMs = 1000;
+    static constexpr double c_latencySmoothing = 0.25;
+
+    Thread* StartThread();
+    static DWORD WINAPI ThreadProc(void* param);
+    static LRESULT CALLBACK MessageWindowProc(
+        HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+    void CreateRequestedWindows(Thread* thread);
+
+    // The pool thread that is the current thread, if any.
+    static thread_local Thread* s_currentThread;
+
+    std::mutex m_mutex;
+    size_t m_threadCount = c_defaultThreadCount;
+    // Threads are never removed, so their addresses stay valid.
+    std::vector<std::unique_ptr<Thread>> m_threads;
+    bool m_shuttingDown = false;
+};
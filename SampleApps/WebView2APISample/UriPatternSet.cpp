@@ -0,0 +1,195 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UriPatternSet.h"
+
+#include <algorithm>
+
+uint32_t UriPatternSet::Add(std::string_view pattern)
+{
+    uint32_t id = m_nextId++;
+    m_patterns.emplace(id, std::string(pattern));
+    m_compiled = false;
+    return id;
+}
+
+void UriPatternSet::Remove(uint32_t id)
+{
+    if (m_patterns.erase(id))
+    {
+        m_compiled = false;
+    }
+}
+
+void UriPatternSet::Clear()
+{
+    m_patterns.clear();
+    m_compiled = false;
+}
+
+void UriPatternSet::Compile()
+{
+    m_nodes.assign(1, Node());
+    for (const auto& entry : m_patterns)
+    {
+        uint32_t node = 0;
+        for (char ch : entry.second)
+        {
+            unsigned char c = static_cast<unsigned char>(ch);
+            uint32_t next;
+            if (c == '*')
+            {
+                if (m_nodes[node].loops)
+                {
+                    // "**" is the same as "*".
+                    continue;
+                }
+                next = m_nodes[node].star;
+                if (next == c_none)
+                {
+                    next = static_cast<uint32_t>(m_nodes.size());
+                    m_nodes[node].star = next;
+                    m_nodes.emplace_back();
+                    m_nodes.back().loops = true;
+                }
+            }
+            else
+            {
+                next = GetChild(node, c);
+                if (next == c_none)
+                {
+                    next = static_cast<uint32_t>(m_nodes.size());
+                    auto& edges = m_nodes[node].edges;
+                    auto it = std::lower_bound(
+                        edges.begin(), edges.end(), std::make_pair(c, uint32_t(0)));
+                    edges.insert(it, {c, next});
+                    m_nodes.emplace_back();
+                }
+            }
+            node = next;
+        }
+        m_nodes[node].accepts.push_back(entry.first);
+    }
+    m_marks.assign(m_nodes.size(), 0);
+    m_generation = 0;
+    ClearStates();
+    m_compiled = true;
+}
+
+uint32_t UriPatternSet::GetChild(uint32_t node, unsigned char c) const
+{
+    const auto& edges = m_nodes[node].edges;
+    auto it = std::lower_bound(
+        edges.begin(), edges.end(), c,
+        [](const std::pair<unsigned char, uint32_t>& edge, unsigned char value)
+        { return edge.first < value; });
+    return it != edges.end() && it->first == c ? it->second : c_none;
+}
+
+void UriPatternSet::AddWithClosure(uint32_t node, std::vector<uint32_t>* nodes)
+{
+    // A '*' can match no characters, so the node after it is active as soon
+    // as the node before it is.
+    while (node != c_none && m_marks[node] != m_generation)
+    {
+        m_marks[node] = m_generation;
+        nodes->push_back(node);
+        node = m_nodes[node].star;
+    }
+}
+
+void UriPatternSet::ClearStates()
+{
+    m_states.clear();
+    m_stateIds.clear();
+    m_startState = c_none;
+    m_cacheEpoch++;
+}
+
+uint32_t UriPatternSet::GetStartState()
+{
+    if (m_startState == c_none)
+    {
+        m_generation++;
+        m_scratch.clear();
+        AddWithClosure(0, &m_scratch);
+        m_startState = InternState(m_scratch);
+    }
+    return m_startState;
+}
+
+uint32_t UriPatternSet::InternState(std::vector<uint32_t>& nodes)
+{
+    std::sort(nodes.begin(), nodes.end());
+    auto it = m_stateIds.find(nodes);
+    if (it != m_stateIds.end())
+    {
+        return it->second;
+    }
+    if (m_states.size() >= c_maxCachedStates)
+    {
+        // Start over rather than grow without bound on adversarial URIs. The
+        // caller only holds on to the state returned here.
+        ClearStates();
+    }
+    uint32_t id = static_cast<uint32_t>(m_states.size());
+    m_states.emplace_back();
+    State& state = m_states.back();
+    state.nodes = nodes;
+    state.next.fill(-1);
+    for (uint32_t node : nodes)
+    {
+        const auto& accepts = m_nodes[node].accepts;
+        state.accepts.insert(state.accepts.end(), accepts.begin(), accepts.end());
+    }
+    std::sort(state.accepts.begin(), state.accepts.end());
+    m_stateIds.emplace(nodes, id);
+    return id;
+}
+
+uint32_t UriPatternSet::Step(uint32_t state, unsigned char c)
+{
+    int32_t cached = m_states[state].next[c];
+    if (cached >= 0)
+    {
+        return static_cast<uint32_t>(cached);
+    }
+    m_generation++;
+    m_scratch.clear();
+    for (uint32_t node : m_states[state].nodes)
+    {
+        if (m_nodes[node].loops && m_marks[node] != m_generation)
+        {
+            m_marks[node] = m_generation;
+            m_scratch.push_back(node);
+        }
+        AddWithClosure(GetChild(node, c), &m_scratch);
+    }
+    uint32_t cacheEpoch = m_cacheEpoch;
+    uint32_t next = InternState(m_scratch);
+    // If interning started the cache over, `state` is gone.
+    if (cacheEpoch == m_cacheEpoch)
+    {
+        m_states[state].next[c] = static_cast<int32_t>(next);
+    }
+    return next;
+}
+
+const std::vector<uint32_t>& UriPatternSet::Match(std::string_view uri)
+{
+    if (!m_compiled)
+    {
+        Compile();
+    }
+    uint32_t state = GetStartState();
+    for (char ch : uri)
+    {
+        state = Step(state, static_cast<unsigned char>(ch));
+        if (m_states[state].nodes.empty())
+        {
+            return m_noMatches;
+        }
+    }
+    return m_states[state].accepts;
+}
@@ -0,0 +1,104 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// UriPatternSet matches URIs against a set of wildcard patterns at once, in
+// time linear in the length of the URI however many patterns there are.
+//
+// Patterns use the syntax of AddWebResourceRequestedFilter: they match the
+// whole URI, and '*' matches any run of characters, including none. All other
+// characters match themselves.
+//
+// The patterns are compiled into a trie, which is an automaton whose states
+// are trie nodes and where the node after a '*' loops on any character. Since
+// several nodes can be active at once, Match runs a DFA whose states are sets
+// of nodes. DFA states and their transitions are built as URIs need them and
+// cached, up to c_maxCachedStates, after which the cache is started over.
+//
+// Changing the set recompiles it on the next Match. Not thread-safe. Has no
+// dependency on Win32.
+class UriPatternSet
+{
+public:
+    static constexpr size_t c_maxCachedStates = 2048;
+
+    // Returns the ID of the pattern. IDs increase and are never reused.
+    uint32_t Add(std::string_view pattern);
+    void Remove(uint32_t id);
+    void Clear();
+    size_t GetCount() const
+    {
+        return m_patterns.size();
+    }
+
+    // Returns the IDs of the patterns matching all of `uri`, in increasing
+    // order. Valid until the set is changed or matched again.
+    const std::vector<uint32_t>& Match(std::string_view uri);
+
+    size_t GetNodeCount() const
+    {
+        return m_nodes.size();
+    }
+    size_t GetCachedStateCount() const
+    {
+        return m_states.size();
+    }
+
+private:
+    static constexpr uint32_t c_none = UINT32_MAX;
+
+    struct Node
+    {
+        // Sorted by character.
+        std::vector<std::pair<unsigned char, uint32_t>> edges;
+        // The node reached by a '*', which matches no characters as well.
+        uint32_t star = c_none;
+        // Set on nodes reached by a '*', which stay active on any character.
+        bool loops = false;
+        std::vector<uint32_t> accepts;
+    };
+
+    struct State
+    {
+        // Sorted node indices.
+        std::vector<uint32_t> nodes;
+        std::vector<uint32_t> accepts;
+        // Indices of the next states, or -1 where not built yet.
+        std::array<int32_t, 256> next;
+    };
+
+    void Compile();
+    uint32_t GetChild(uint32_t node, unsigned char c) const;
+    void AddWithClosure(uint32_t node, std::vector<uint32_t>* nodes);
+    uint32_t GetStartState();
+    uint32_t Step(uint32_t state, unsigned char c);
+    uint32_t InternState(std::vector<uint32_t>& nodes);
+    void ClearStates();
+
+    std::map<uint32_t, std::string> m_patterns;
+    uint32_t m_nextId = 0;
+    bool m_compiled = false;
+
+    std::vector<Node> m_nodes;
+    std::vector<State> m_states;
+    std::map<std::vector<uint32_t>, uint32_t> m_stateIds;
+    uint32_t m_startState = c_none;
+    // Changes whenever the cache is started over.
+    uint32_t m_cacheEpoch = 0;
+
+    // Marks the nodes already in the set being built.
+    std::vector<uint32_t> m_marks;
+    uint32_t m_generation = 0;
+    std::vector<uint32_t> m_scratch;
+    const std::vector<uint32_t> m_noMatches;
+};
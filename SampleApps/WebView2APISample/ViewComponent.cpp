@@ -339,6 +339,13 @@ bool ViewComponent::HandleWindowMessage(
         case IDM_GET_WEBVIEW_ZOOM:
             ShowWebViewZoom();
             return true;
+        case IDM_DRAG_SESSION_METRICS:
+            MessageBox(
+                m_appWindow->GetMainWindow(),
+                m_dropTarget ? m_dropTarget->GetReport().c_str()
+                             : L"Drags are only tracked in the visual hosting modes.",
+                L"Drag Sessions", MB_OK);
+            return true;
         case IDM_TOGGLE_CURSOR_HANDLING:
             m_useCursorId = !m_useCursorId;
             return true;
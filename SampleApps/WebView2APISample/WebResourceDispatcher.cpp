@@ -0,0 +1,252 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "WebResourceDispatcher.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+#include "CheckFailure.h"
+#include "StringConversion.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+// Shared by all dispatchers, on all UI threads.
+std::atomic<uint32_t> s_nextRouteId{1};
+
+int64_t ElapsedMicros(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+} // namespace
+
+WebResourceDispatcher::WebResourceDispatcher(ICoreWebView2* webView) : m_webView(webView)
+{
+    m_webView22 = m_webView.try_query<ICoreWebView2_22>();
+    CHECK_FAILURE(m_webView->add_WebResourceRequested(
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+            { return Dispatch(args); })
+            .Get(),
+        &m_webResourceRequestedToken));
+}
+
+WebResourceDispatcher::~WebResourceDispatcher()
+{
+    m_webView->remove_WebResourceRequested(m_webResourceRequestedToken);
+}
+
+uint32_t WebResourceDispatcher::AddRoute(
+    PCWSTR uriPattern,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+    Handler handler,
+    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds)
+{
+    return Add(uriPattern, context, std::move(handler), sourceKinds, false);
+}
+
+uint32_t WebResourceDispatcher::AddObserver(
+    PCWSTR uriPattern,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+    Handler handler,
+    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds)
+{
+    return Add(uriPattern, context, std::move(handler), sourceKinds, true);
+}
+
+uint32_t WebResourceDispatcher::Add(
+    PCWSTR uriPattern,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+    Handler handler,
+    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds,
+    bool observer)
+{
+    if (!m_webView22)
+    {
+        sourceKinds = COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT;
+    }
+    uint32_t id = s_nextRouteId++;
+    Route& route = m_routes[id];
+    route.pattern = uriPattern;
+    route.context = context;
+    route.sourceKinds = sourceKinds;
+    route.observer = observer;
+    route.handler = std::move(handler);
+    route.patternId = m_patterns.Add(ToUtf8(route.pattern));
+    m_routeIds[route.patternId] = id;
+    AddFilter({route.pattern, context, sourceKinds});
+    return id;
+}
+
+void WebResourceDispatcher::RemoveRoute(uint32_t id)
+{
+    auto it = m_routes.find(id);
+    if (it == m_routes.end())
+    {
+        return;
+    }
+    const Route& route = it->second;
+    RemoveFilter({route.pattern, route.context, route.sourceKinds});
+    m_patterns.Remove(route.patternId);
+    m_routeIds.erase(route.patternId);
+    m_routes.erase(it);
+}
+
+void WebResourceDispatcher::AddFilter(const FilterKey& filter)
+{
+    if (m_filterCounts[filter]++ > 0)
+    {
+        return;
+    }
+    const auto& [pattern, context, sourceKinds] = filter;
+    if (sourceKinds == COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT)
+    {
+        CHECK_FAILURE(m_webView->AddWebResourceRequestedFilter(pattern.c_str(), context));
+    }
+    else
+    {
+        CHECK_FAILURE(m_webView22->AddWebResourceRequestedFilterWithRequestSourceKinds(
+            pattern.c_str(), context, sourceKinds));
+    }
+}
+
+void WebResourceDispatcher::RemoveFilter(const FilterKey& filter)
+{
+    auto it = m_filterCounts.find(filter);
+    if (it == m_filterCounts.end() || --it->second > 0)
+    {
+        return;
+    }
+    m_filterCounts.erase(it);
+    const auto& [pattern, context, sourceKinds] = filter;
+    if (sourceKinds == COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT)
+    {
+        CHECK_FAILURE(m_webView->RemoveWebResourceRequestedFilter(pattern.c_str(), context));
+    }
+    else
+    {
+        CHECK_FAILURE(m_webView22->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
+            pattern.c_str(), context, sourceKinds));
+    }
+}
+
+bool WebResourceDispatcher::Accepts(const Route& route, const Request& request)
+{
+    return (route.context == COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL ||
+            route.context == request.context) &&
+           (route.sourceKinds & request.sourceKind) != 0;
+}
+
+HRESULT WebResourceDispatcher::Dispatch(ICoreWebView2WebResourceRequestedEventArgs* args)
+{
+    auto start = std::chrono::steady_clock::now();
+    m_requests++;
+
+    // Get the request's fields once for all routes.
+    wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+    CHECK_FAILURE(args->get_Request(&request));
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(request->get_Uri(&uri));
+    Request details = {
+        args, request.get(), uri.get(), COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT};
+    CHECK_FAILURE(args->get_ResourceContext(&details.context));
+    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2> args2;
+    if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2))))
+    {
+        CHECK_FAILURE(args2->get_RequestedSourceKind(&details.sourceKind));
+    }
+
+    int uriLength = static_cast<int>(wcslen(details.uri));
+    int size =
+        WideCharToMultiByte(CP_UTF8, 0, details.uri, uriLength, nullptr, 0, nullptr, nullptr);
+    m_uriUtf8.resize(size > 0 ? size : 0);
+    if (size > 0)
+    {
+        WideCharToMultiByte(
+            CP_UTF8, 0, details.uri, uriLength, &m_uriUtf8[0], size, nullptr, nullptr);
+    }
+
+    // Matching observers in the order they were added, then the most recently
+    // added matching route. Routes are looked up again below, in case a
+    // handler removes one.
+    m_matches.clear();
+    uint32_t owner = c_noRoute;
+    for (uint32_t patternId : m_patterns.Match(m_uriUtf8))
+    {
+        uint32_t id = m_routeIds[patternId];
+        const Route& route = m_routes.at(id);
+        if (!Accepts(route, details))
+        {
+            continue;
+        }
+        if (route.observer)
+        {
+            m_matches.push_back(id);
+        }
+        else
+        {
+            owner = id;
+        }
+    }
+    if (owner != c_noRoute)
+    {
+        m_matches.push_back(owner);
+    }
+    m_matchLatency.Record(static_cast<uint64_t>(ElapsedMicros(start)));
+    if (m_matches.empty())
+    {
+        m_unmatched++;
+        return S_OK;
+    }
+
+    for (uint32_t id : m_matches)
+    {
+        auto it = m_routes.find(id);
+        if (it == m_routes.end())
+        {
+            continue;
+        }
+        Route& route = it->second;
+        auto handlerStart = std::chrono::steady_clock::now();
+        // Copy the handler, as the handler may remove its own route.
+        Handler handler = route.handler;
+        handler(details);
+        it = m_routes.find(id);
+        if (it != m_routes.end())
+        {
+            it->second.hits++;
+            it->second.latency.Record(static_cast<uint64_t>(ElapsedMicros(handlerStart)));
+        }
+    }
+    return S_OK;
+}
+
+std::wstring WebResourceDispatcher::GetMetricsReport() const
+{
+    std::wstringstream report;
+    report << m_requests << L" requests, " << m_unmatched << L" unmatched, "
+           << m_routes.size() << L" routes, " << m_patterns.GetCachedStateCount()
+           << L" cached matcher states\n"
+           << L"Matching: p50 " << m_matchLatency.GetValueAtPercentile(50) << L" us, p99 "
+           << m_matchLatency.GetValueAtPercentile(99) << L" us\n";
+    for (const auto& entry : m_routes)
+    {
+        const Route& route = entry.second;
+        report << L"\n"
+               << (route.observer ? L"[observer] " : L"") << route.pattern << L" (context "
+               << route.context << L"): " << route.hits << L" hits, p50 "
+               << route.latency.GetValueAtPercentile(50) << L" us, p99 "
+               << route.latency.GetValueAtPercentile(99) << L" us, max "
+               << route.latency.GetMax() << L" us";
+    }
+    return report.str();
+}
@@ -0,0 +1,119 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "HdrHistogram.h"
+#include "UriPatternSet.h"
+
+// WebResourceDispatcher handles the WebResourceRequested event of a WebView
+// for all the components that intercept requests, so that each request is
+// only examined once rather than by every component's handler.
+//
+// A component adds a route with the URI pattern, resource context and source
+// kinds it would pass to AddWebResourceRequestedFilter, and the dispatcher
+// adds the filter. For each request, the dispatcher gets the URI, resource
+// context and source kind once and matches the URI against the patterns of
+// all routes with a UriPatternSet. The request goes to the most recently
+// added matching route, and to every matching observer before that, which
+// should only look at the request.
+//
+// AppWindow creates a dispatcher with each WebView and destroys it after the
+// WebView's components. Route IDs are unique across dispatchers, so removing
+// a route of an earlier WebView is a no-op.
+class WebResourceDispatcher
+{
+public:
+    struct Request
+    {
+        ICoreWebView2WebResourceRequestedEventArgs* args;
+        ICoreWebView2WebResourceRequest* request;
+        PCWSTR uri;
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKind;
+    };
+
+    using Handler = std::function<HRESULT(const Request& request)>;
+
+    static constexpr uint32_t c_noRoute = 0;
+
+    explicit WebResourceDispatcher(ICoreWebView2* webView);
+    ~WebResourceDispatcher();
+
+    // Returns the ID of the new route. Source kinds other than documents need
+    // ICoreWebView2_22; without it, the route only sees document requests.
+    uint32_t AddRoute(
+        PCWSTR uriPattern,
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+        Handler handler,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds =
+            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT);
+    uint32_t AddObserver(
+        PCWSTR uriPattern,
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+        Handler handler,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds =
+            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT);
+    void RemoveRoute(uint32_t id);
+
+    // Requests, unmatched requests and the time spent matching, and for each
+    // route its hits and the time spent in its handler.
+    std::wstring GetMetricsReport() const;
+
+private:
+    struct Route
+    {
+        std::wstring pattern;
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds;
+        bool observer;
+        Handler handler;
+        uint32_t patternId;
+        uint64_t hits = 0;
+        // Microseconds in the handler.
+        HdrHistogram latency;
+    };
+
+    using FilterKey = std::tuple<
+        std::wstring, COREWEBVIEW2_WEB_RESOURCE_CONTEXT,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS>;
+
+    uint32_t Add(
+        PCWSTR uriPattern,
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+        Handler handler,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds,
+        bool observer);
+    void AddFilter(const FilterKey& filter);
+    void RemoveFilter(const FilterKey& filter);
+    HRESULT Dispatch(ICoreWebView2WebResourceRequestedEventArgs* args);
+    static bool Accepts(const Route& route, const Request& request);
+
+    wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2_22> m_webView22;
+    EventRegistrationToken m_webResourceRequestedToken = {};
+
+    std::map<uint32_t, Route> m_routes;
+    // Pattern ID to route ID.
+    std::map<uint32_t, uint32_t> m_routeIds;
+    UriPatternSet m_patterns;
+    // Identical filters are only added to the WebView once.
+    std::map<FilterKey, size_t> m_filterCounts;
+
+    // Reused for each request to avoid allocating.
+    std::string m_uriUtf8;
+    std::vector<uint32_t> m_matches;
+
+    uint64_t m_requests = 0;
+    uint64_t m_unmatched = 0;
+    HdrHistogram m_matchLatency;
+};
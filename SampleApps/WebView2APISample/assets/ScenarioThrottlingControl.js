@@ -31,7 +31,8 @@ function reportAverageDelay(delay) {
     "frameId": frameId,
     "delayAvg": delay
   };
-  logger.postMessage(message);
+  // The untrusted frame is cross-origin to the main frame.
+  logger.postMessage(message, '*');
 }
 
 function onIterationCompleted(delayAvg) {
@@ -51,7 +52,7 @@ document.addEventListener("visibilitychange", () => {
     "frameId": frameId,
     "visibilityUpdate": document.visibilityState
   };
-  logger.postMessage(message);
+  logger.postMessage(message, '*');
 });
 
 window.addEventListener('message', (event) => {
@@ -65,8 +66,8 @@ window.addEventListener('message', (event) => {
 
     // fwd to embedded frames
     if (frameId == 'main') {
-      document.getElementById('trusted').contentWindow.postMessage(event.data);
-      document.getElementById('untrusted').contentWindow.postMessage(event.data);
+      document.getElementById('trusted').contentWindow.postMessage(event.data, '*');
+      document.getElementById('untrusted').contentWindow.postMessage(event.data, '*');
     }
   } else if (frameId == 'main') {
     // log from embedded frame, fwd to popup
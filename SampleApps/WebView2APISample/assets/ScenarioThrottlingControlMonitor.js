@@ -25,6 +25,15 @@ window.addEventListener('message', (event) => {
     // reporting delay
     let delayText = event.data.delayAvg.toFixed(2);
     logLine(frameId, `${delayText} ms`);
+
+    // let the host compare the delay with the interval it requested
+    chrome.webview.postMessage({
+      command: 'report-delay',
+      params: {
+        frameId: frameId,
+        delayAvg: event.data.delayAvg
+      }
+    });
   }
 });
 
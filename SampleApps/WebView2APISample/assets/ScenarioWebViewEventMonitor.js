@@ -0,0 +1,220 @@
+// Storage for ScenarioWebViewEventMonitor.html. Nothing here touches the DOM,
+// so that it can be loaded and measured outside of the page as well.
+
+// Maps each lower case trigram of the indexed texts to the increasing
+// sequence numbers of the events whose text contains it. Sequence numbers of
+// evicted events are dropped lazily, when a list is looked up or full.
+class TrigramIndex {
+    constructor() {
+        this.postings = new Map();
+    }
+
+    clear() {
+        this.postings.clear();
+    }
+
+    // Packs three UTF-16 code units into one number, so that keys are not
+    // allocated. Code units above 0xFF are folded, which only adds candidates.
+    static key(text, i) {
+        return ((text.charCodeAt(i) & 0xFF) << 16) |
+            ((text.charCodeAt(i + 1) & 0xFF) << 8) |
+            (text.charCodeAt(i + 2) & 0xFF);
+    }
+
+    add(sequence, text, oldest) {
+        for (let i = 0; i + 3 <= text.length; i++) {
+            const key = TrigramIndex.key(text, i);
+            let list = this.postings.get(key);
+            if (!list) {
+                list = { data: new Int32Array(4), start: 0, length: 0 };
+                this.postings.set(key, list);
+            } else if (list.length > list.start && list.data[list.length - 1] === sequence) {
+                // The trigram occurs more than once in this text.
+                continue;
+            }
+            if (list.length === list.data.length) {
+                this.prune(list, oldest);
+                // Reclaim the evicted prefix if that is most of the list, or grow.
+                const live = list.length - list.start;
+                if (live * 2 <= list.data.length) {
+                    list.data.copyWithin(0, list.start, list.length);
+                } else {
+                    const data = new Int32Array(list.data.length * 2);
+                    data.set(list.data.subarray(list.start, list.length));
+                    list.data = data;
+                }
+                list.length = live;
+                list.start = 0;
+            }
+            list.data[list.length++] = sequence;
+        }
+    }
+
+    // Returns the candidates for a query of three or more characters, in
+    // increasing order, or null for shorter queries. The candidates contain
+    // the rarest of the query's trigrams, and still need to be checked.
+    lookup(query, oldest) {
+        if (query.length < 3) {
+            return null;
+        }
+        let shortest = null;
+        for (let i = 0; i + 3 <= query.length; i++) {
+            const list = this.postings.get(TrigramIndex.key(query, i));
+            if (!list) {
+                return [];
+            }
+            this.prune(list, oldest);
+            if (!shortest || list.length - list.start < shortest.length - shortest.start) {
+                shortest = list;
+            }
+        }
+        return shortest.data.subarray(shortest.start, shortest.length);
+    }
+
+    prune(list, oldest) {
+        list.start = TrigramIndex.lowerBound(list.data, list.start, list.length, oldest);
+    }
+
+    static lowerBound(data, low, high, value) {
+        while (low < high) {
+            const middle = (low + high) >> 1;
+            if (data[middle] < value) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+}
+
+// Keeps the most recent `capacity` events in a ring of columns: the event
+// name as an index into a table of names, the time it was received, the lower
+// case URI of requests, which is indexed for filtering, and the event's JSON,
+// which is only parsed when the event is shown. Events are numbered in the
+// order they were pushed.
+class EventStore {
+    constructor(capacity) {
+        this.capacity = capacity;
+        this.nameIds = new Uint16Array(capacity);
+        this.times = new Float64Array(capacity);
+        this.uris = new Array(capacity).fill("");
+        this.payloads = new Array(capacity).fill("");
+        this.names = [];
+        this.lowerCaseNames = [];
+        this.nameToId = new Map();
+        this.index = new TrigramIndex();
+        this.total = 0;
+    }
+
+    get oldest() {
+        return Math.max(0, this.total - this.capacity);
+    }
+
+    get count() {
+        return this.total - this.oldest;
+    }
+
+    clear() {
+        // Numbering continues, so that a view of the old events is empty.
+        this.uris.fill("");
+        this.payloads.fill("");
+        this.index.clear();
+        this.total += this.capacity;
+    }
+
+    // Adds an event from its JSON text. Only the name and URI are read now.
+    push(json, time) {
+        const name = EventStore.findString(json, "name") || "(unknown)";
+        let nameId = this.nameToId.get(name);
+        if (nameId === undefined) {
+            nameId = this.names.length;
+            this.names.push(name);
+            this.lowerCaseNames.push(name.toLowerCase());
+            this.nameToId.set(name, nameId);
+        }
+        const uri = EventStore.findString(json, "uri").toLowerCase();
+        const sequence = this.total++;
+        const slot = sequence % this.capacity;
+        this.nameIds[slot] = nameId;
+        this.times[slot] = time;
+        this.uris[slot] = uri;
+        this.payloads[slot] = json;
+        this.index.add(sequence, uri, this.oldest);
+        return sequence;
+    }
+
+    has(sequence) {
+        return sequence >= this.oldest && sequence < this.total;
+    }
+
+    getName(sequence) {
+        return this.names[this.nameIds[sequence % this.capacity]];
+    }
+
+    getTime(sequence) {
+        return this.times[sequence % this.capacity];
+    }
+
+    getEvent(sequence) {
+        return JSON.parse(this.payloads[sequence % this.capacity]);
+    }
+
+    // Whether the event's name or URI contains the lower case query.
+    matches(sequence, query) {
+        const slot = sequence % this.capacity;
+        return this.lowerCaseNames[this.nameIds[slot]].includes(query) ||
+            this.uris[slot].includes(query);
+    }
+
+    // Returns the sequence numbers of the retained events matching the lower
+    // case query, in increasing order.
+    filter(query) {
+        const oldest = this.oldest;
+        const candidates = this.index.lookup(query, oldest);
+        const nameMatches = this.lowerCaseNames.map(name => name.includes(query));
+        const result = [];
+        if (candidates === null || nameMatches.includes(true)) {
+            // Names are not indexed, as there are few of them: scan the
+            // column of name IDs instead.
+            for (let sequence = oldest; sequence < this.total; sequence++) {
+                if (this.matches(sequence, query)) {
+                    result.push(sequence);
+                }
+            }
+            return result;
+        }
+        for (const sequence of candidates) {
+            if (this.uris[sequence % this.capacity].includes(query)) {
+                result.push(sequence);
+            }
+        }
+        return result;
+    }
+
+    // Returns the string value of the first "key" in the JSON text, without
+    // parsing the rest of it.
+    static findString(json, key) {
+        const pattern = "\"" + key + "\"";
+        let position = json.indexOf(pattern);
+        if (position < 0) {
+            return "";
+        }
+        position += pattern.length;
+        while (json[position] === " " || json[position] === ":") {
+            position++;
+        }
+        if (json[position] !== "\"") {
+            return "";
+        }
+        let end = position + 1;
+        while (end < json.length && json[end] !== "\"") {
+            end += json[end] === "\\" ? 2 : 1;
+        }
+        try {
+            return JSON.parse(json.substring(position, end + 1));
+        } catch (e) {
+            return "";
+        }
+    }
+}
@@ -18,10 +18,14 @@
 #define IDM_SAVE_SCREENSHOT             114
 #define IDM_TOGGLE_VISIBILITY           115
 #define IDM_CLOSE_WEBVIEW               116
+#define IDM_MONITOR_SCREENSHOTS         117
 #define IDM_NEW_WINDOW                  120
 #define IDM_PROCESS_INFO                121
 #define IDM_NEW_THREAD                  122
 #define IDM_REINIT                      123
+#define IDM_UI_THREAD_POOL_METRICS      124
+#define IDM_WEB_RESOURCE_ROUTE_METRICS  119
+#define IDM_DRAG_SESSION_METRICS        233
 #define IDM_CRASH_PROCESS               125
 #define IDM_INJECT_SCRIPT               126
 #define IDM_GET_WEBVIEW_BOUNDS          127
@@ -55,6 +59,7 @@
 #define IDM_OPEN_TASK_MANAGER_WINDOW    173
 #define IDM_OPEN_DEVTOOLS_WINDOW        174
 #define IDM_CLOSE_WEBVIEW_CLEANUP       175
+#define IDM_SHOW_USER_DATA_FOLDER_SIZES 118
 #define IDM_GET_USER_DATA_FOLDER   176
 #define IDM_AUTO_PREFERRED_COLOR_SCHEME   177
 #define IDM_LIGHT_PREFERRED_COLOR_SCHEME  178
@@ -99,6 +104,7 @@
 #define IDI_WEBVIEW2APISAMPLE_INPRIVATE 230
 #define IDM_TOGGLE_MUTE_STATE           231
 #define IDM_PERFORMANCE_INFO            232
+#define IDM_AUDIO_SESSION_REPORT        234
 #define IDM_PRINT_TO_PDF_PORTRAIT       235
 #define IDM_PRINT_TO_PDF_LANDSCAPE      236
 #define IDM_POST_WEB_MESSAGE_STRING_FRAME    237
@@ -109,6 +115,9 @@
 #define IDC_EDIT_DOWNLOAD_PATH          242
 #define IDM_CALL_CDP_METHOD_FOR_SESSION 243
 #define IDM_COLLECT_HEAP_MEMORY_VIA_CDP 244
+#define IDM_TOGGLE_HEAP_SAMPLING_VIA_CDP 248
+#define IDM_EXPORT_HEAP_TRENDS          249
+#define IDM_SHOW_RECENT_CONSOLE_WARNINGS 250
 #define IDM_INJECT_SCRIPT_WITH_RESULT   245
 #define IDM_TOGGLE_CUSTOM_CRASH_REPORTING  246
 #define IDM_GET_FAILURE_REPORT_FOLDER      247
@@ -121,6 +130,16 @@
 #define IDC_EDIT_PERMISSION_ORIGIN      257
 #define IDC_PERMISSION_KIND             258
 #define IDC_PERMISSION_STATE            259
+#define IDM_AUDIO_POLICY_ALLOW_ALL      260
+#define IDM_AUDIO_POLICY_FOCUSED_ONLY   261
+#define IDM_AUDIO_POLICY_MUTE_BACKGROUND 262
+#define IDM_PROCESS_FAILURE_REPORT      263
+#define IDM_PROCESS_RECOVERY_REPORT     264
+#define IDM_PROFILE_SESSION_REPORT      265
+#define IDM_PROFILE_BUDGET_UNLIMITED    266
+#define IDM_PROFILE_BUDGET_512MB        267
+#define IDM_PROFILE_BUDGET_1GB          268
+#define IDM_PROFILE_BUDGET_2GB          269
 #define IDM_TOGGLE_TOPMOST_WINDOW       300
 #define IDM_PROCESS_EXTENDED_INFO       301
 #define IDE_ADDRESSBAR                  1000
@@ -179,6 +198,12 @@
 #define IDM_SCENARIO_NON_CLIENT_REGION_SUPPORT 2038
 #define IDM_SCENARIO_NOTIFICATION 2039
 #define IDM_SCENARIO_ACCELERATOR_KEY_PRESSED 2042
+#define IDM_SCENARIO_QUEUE_PDF_STREAM_EXPORT 2043
+#define IDM_SCENARIO_NAVIGATION_TIMING_EXPORT_JSON 2044
+#define IDM_SCENARIO_NAVIGATION_TIMING_EXPORT_CSV 2045
+#define IDM_SCENARIO_NAVIGATION_TIMING_RESET 2046
+#define IDM_SCENARIO_THROTTLING_CONTROL 2047
+#define IDM_SCENARIO_THROTTLING_CONTROL_REPORT 2048
 #define IDM_CREATION_MODE_WINDOWED 3000
 #define IDM_CREATION_MODE_VISUAL_DCOMP 3001
 #define IDM_CREATION_MODE_TARGET_DCOMP 3002
@@ -0,0 +1,19 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+
+// Counts the allocations made with operator new on each thread. Programs that
+// link AllocationCounter.cpp get its replacement operator new; in others the
+// counts stay 0. Allocations with malloc, such as CoTaskMemAlloc strings, are
+// not counted.
+struct AllocationCount
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationCount GetThreadAllocationCount();
@@ -0,0 +1,218 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AudioSessionRegistry.h"
+#include "TestUtil.h"
+
+namespace
+{
+using Registry = AudioSessionRegistry;
+using Indicator = AudioSessionRegistry::Indicator;
+using Policy = AudioSessionRegistry::Policy;
+
+// Applies the mute changes the policy asks for, as the WebViews would, and
+// returns them by session.
+std::map<Registry::SessionId, bool> ApplyActions(Registry& registry, int64_t nowUs)
+{
+    std::map<Registry::SessionId, bool> applied;
+    for (const Registry::Action& action : registry.TakeActions())
+    {
+        applied[action.id] = action.muted;
+        registry.OnMutedChanged(action.id, action.muted, nowUs);
+    }
+    return applied;
+}
+
+void TestTitleDebounce()
+{
+    Registry registry;
+    Registry::SessionId id = registry.Add(false, false, true, 0);
+    Indicator indicator = Indicator::None;
+    CHECK(registry.GetTitleDueUs(id) == -1);
+
+    // Audio that stops and starts again between tracks.
+    registry.OnPlayingChanged(id, true, 0);
+    registry.OnPlayingChanged(id, false, 1000);
+    registry.OnPlayingChanged(id, true, 2000);
+    CHECK(registry.GetTitleDueUs(id) == Registry::c_titleDebounceUs);
+    CHECK(!registry.TakeTitleUpdate(id, 100000, &indicator));
+    CHECK(registry.TakeTitleUpdate(id, Registry::c_titleDebounceUs, &indicator));
+    CHECK(indicator == Indicator::Playing);
+
+    // Back where it was when the update is due: nothing to show.
+    registry.OnPlayingChanged(id, false, 300000);
+    registry.OnPlayingChanged(id, true, 310000);
+    CHECK(!registry.TakeTitleUpdate(id, 600000, &indicator));
+    CHECK(registry.GetTitleDueUs(id) == -1);
+
+    registry.OnMutedChanged(id, true, 700000);
+    CHECK(registry.TakeTitleUpdate(id, 700000 + Registry::c_titleDebounceUs, &indicator));
+    CHECK(indicator == Indicator::Muted);
+
+    // Events that don't change anything are ignored.
+    registry.OnMutedChanged(id, true, 1000000);
+    CHECK(registry.GetTitleDueUs(id) == -1);
+    CHECK(registry.GetReport().find("Events without a change: 1") != std::string::npos);
+}
+
+void TestFocusedOnly()
+{
+    Registry registry;
+    Registry::SessionId a = registry.Add(false, false, true, 0);
+    Registry::SessionId b = registry.Add(false, false, false, 0);
+    registry.SetPolicy(Policy::FocusedOnly);
+    CHECK(registry.TakeActions().empty());
+
+    // Background audio is muted.
+    registry.OnPlayingChanged(b, true, 0);
+    std::map<Registry::SessionId, bool> applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 1 && applied[b]);
+
+    // Activating b unmutes it and mutes a, once a plays.
+    registry.OnPlayingChanged(a, true, 0);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.empty());
+    registry.OnActivated(b);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 2 && applied[a] && !applied[b]);
+
+    // The user unmutes a in the background: it's left alone until activated.
+    registry.OnMutedChanged(a, false, 0);
+    registry.OnPlayingChanged(a, false, 0);
+    registry.OnPlayingChanged(a, true, 0);
+    CHECK(registry.TakeActions().empty());
+    CHECK(registry.GetReport().find("Unmuted by the user in the background: 1") !=
+          std::string::npos);
+    registry.OnActivated(a);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 1 && applied[b]);
+    registry.OnActivated(b);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 2 && applied[a] && !applied[b]);
+}
+
+void TestMuteBackgroundAndAllowAll()
+{
+    Registry registry;
+    Registry::SessionId a = registry.Add(true, false, true, 0);
+    Registry::SessionId b = registry.Add(true, false, false, 0);
+    Registry::SessionId c = registry.Add(false, false, false, 0);
+    registry.SetPolicy(Policy::FocusedOnly);
+    std::map<Registry::SessionId, bool> applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 1 && applied[b]);
+
+    // Silent background windows are muted as well.
+    registry.SetPolicy(Policy::MuteBackground);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 1 && applied[c]);
+
+    // Allowing all unmutes what the policy muted, and only that.
+    registry.OnMutedChanged(a, true, 0);
+    registry.SetPolicy(Policy::AllowAll);
+    applied = ApplyActions(registry, 0);
+    CHECK(applied.size() == 2 && !applied[b] && !applied[c]);
+
+    registry.Remove(c);
+    registry.OnPlayingChanged(c, true, 0);
+    CHECK(registry.GetPlayingCount() == 2);
+}
+
+// Eight windows whose pages start and stop audio at random, and are
+// activated now and then, under FocusedOnly. The host applies the actions
+// and updates the titles when they are due, as AudioComponent does.
+void TestSimulatedEventStream()
+{
+    constexpr int c_windowCount = 8;
+    constexpr int c_stepCount = 200000;
+    Registry registry;
+    std::vector<Registry::SessionId> ids;
+    for (int i = 0; i < c_windowCount; i++)
+    {
+        ids.push_back(registry.Add(false, false, i == 0, 0));
+    }
+    registry.SetPolicy(Policy::FocusedOnly);
+
+    std::mt19937 random(1);
+    std::map<Registry::SessionId, bool> playing;
+    std::map<Registry::SessionId, bool> muted;
+    std::map<Registry::SessionId, Indicator> shown;
+    Registry::SessionId active = ids[0];
+    uint64_t events = 0;
+    uint64_t titleUpdates = 0;
+    int64_t nowUs = 0;
+    for (int step = 0; step < c_stepCount; step++)
+    {
+        nowUs += 1000;
+        Registry::SessionId id = ids[random() % c_windowCount];
+        if (random() % 20 == 0)
+        {
+            registry.OnActivated(id);
+            active = id;
+        }
+        else
+        {
+            playing[id] = random() % 2 == 0;
+            registry.OnPlayingChanged(id, playing[id], nowUs);
+            events++;
+        }
+        for (const auto& action : ApplyActions(registry, nowUs))
+        {
+            muted[action.first] = action.second;
+        }
+        // Background windows are never heard.
+        for (Registry::SessionId session : ids)
+        {
+            CHECK(session == active || !playing[session] || muted[session]);
+        }
+        for (Registry::SessionId session : ids)
+        {
+            int64_t dueUs = registry.GetTitleDueUs(session);
+            Indicator indicator;
+            if (dueUs >= 0 && dueUs <= nowUs &&
+                registry.TakeTitleUpdate(session, nowUs, &indicator))
+            {
+                shown[session] = indicator;
+                titleUpdates++;
+            }
+        }
+    }
+    // Once the last updates are due, every title shows the session's state.
+    nowUs += Registry::c_titleDebounceUs;
+    for (Registry::SessionId session : ids)
+    {
+        Indicator indicator;
+        if (registry.TakeTitleUpdate(session, nowUs, &indicator))
+        {
+            shown[session] = indicator;
+            titleUpdates++;
+        }
+        Indicator expected = !playing[session] ? Indicator::None
+                             : muted[session]  ? Indicator::Muted
+                                               : Indicator::Playing;
+        CHECK(shown[session] == expected);
+    }
+    // A window's title changes at most once per debounce interval.
+    CHECK(titleUpdates <= uint64_t(c_windowCount * (nowUs / Registry::c_titleDebounceUs + 1)));
+    CHECK(titleUpdates * 10 < events);
+
+    std::printf(
+        "%llu events, %llu title updates\n%s\n", static_cast<unsigned long long>(events),
+        static_cast<unsigned long long>(titleUpdates), registry.GetReport().c_str());
+}
+} // namespace
+
+int main()
+{
+    TestTitleDebounce();
+    TestFocusedOnly();
+    TestMuteBackgroundAndAllowAll();
+    TestSimulatedEventStream();
+    return FinishTests("AudioSessionRegistryTests");
+}
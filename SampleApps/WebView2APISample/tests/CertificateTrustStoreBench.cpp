@@ -0,0 +1,270 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Builds chains of synthetic RSA-sized certificates, root to intermediate to
+// server, for thousands of hosts, pins some servers and roots, and replays the
+// certificate errors and client certificate requests SettingsComponent passes
+// to a CertificateTrustStore: each host's first error, repeated errors, hosts
+// that rotate their certificate, and chains with a pinned certificate
+// appended. Checks every verdict against the pins and the verdict cache
+// against its limit, and reports the time per call:
+//     CertificateTrustStoreBench [chain count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CertificateTrustStore.h"
+#include "PemCertificateScanner.h"
+
+namespace
+{
+using Bytes = std::vector<uint8_t>;
+
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+Bytes Der(uint8_t tag, const Bytes& content)
+{
+    Bytes der = {tag};
+    size_t size = content.size();
+    if (size < 0x80)
+    {
+        der.push_back(static_cast<uint8_t>(size));
+    }
+    else
+    {
+        int lengthBytes = size > 0xFFFF ? 3 : size > 0xFF ? 2 : 1;
+        der.push_back(static_cast<uint8_t>(0x80 | lengthBytes));
+        for (int i = lengthBytes - 1; i >= 0; i--)
+        {
+            der.push_back(static_cast<uint8_t>(size >> (8 * i)));
+        }
+    }
+    der.insert(der.end(), content.begin(), content.end());
+    return der;
+}
+
+Bytes Concat(std::initializer_list<Bytes> parts)
+{
+    Bytes bytes;
+    for (const Bytes& part : parts)
+    {
+        bytes.insert(bytes.end(), part.begin(), part.end());
+    }
+    return bytes;
+}
+
+Bytes RandomBytes(size_t size, std::mt19937& random)
+{
+    Bytes bytes(size);
+    for (uint8_t& byte : bytes)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    return bytes;
+}
+
+// Name ::= SEQUENCE { SET { SEQUENCE { commonName, UTF8String } } }
+Bytes Name(const std::string& commonName)
+{
+    Bytes oid = Der(0x06, {0x55, 0x04, 0x03});
+    Bytes value = Der(0x0C, Bytes(commonName.begin(), commonName.end()));
+    return Der(0x30, Der(0x31, Der(0x30, Concat({oid, value}))));
+}
+
+// A certificate shaped like an RSA-2048 one, with a random key and signature.
+Bytes MakeCertificate(
+    const std::string& issuer, const std::string& subject, std::mt19937& random)
+{
+    Bytes algorithm = Der(
+        0x30, Concat({Der(0x06, {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x0B}),
+                      Der(0x05, {})}));
+    std::string time = "260101000000Z";
+    Bytes validity =
+        Der(0x30, Concat({Der(0x17, Bytes(time.begin(), time.end())),
+                          Der(0x17, Bytes(time.begin(), time.end()))}));
+    Bytes key = Der(0x30, Concat({algorithm, Der(0x03, RandomBytes(271, random))}));
+    Bytes tbs = Der(
+        0x30, Concat({Der(0xA0, Der(0x02, {2})), Der(0x02, RandomBytes(16, random)), algorithm,
+                      Name(issuer), validity, Name(subject), key}));
+    return Der(0x30, Concat({tbs, algorithm, Der(0x03, RandomBytes(257, random))}));
+}
+
+std::string ToPem(const Bytes& der)
+{
+    static constexpr char c_alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string base64;
+    for (size_t i = 0; i < der.size(); i += 3)
+    {
+        uint32_t bits = der[i] << 16;
+        bits |= i + 1 < der.size() ? der[i + 1] << 8 : 0;
+        bits |= i + 2 < der.size() ? der[i + 2] : 0;
+        base64 += c_alphabet[bits >> 18];
+        base64 += c_alphabet[(bits >> 12) & 63];
+        base64 += i + 1 < der.size() ? c_alphabet[(bits >> 6) & 63] : '=';
+        base64 += i + 2 < der.size() ? c_alphabet[bits & 63] : '=';
+    }
+    std::string pem = "-----BEGIN CERTIFICATE-----\n";
+    for (size_t i = 0; i < base64.size(); i += 64)
+    {
+        pem += base64.substr(i, 64) + "\n";
+    }
+    return pem + "-----END CERTIFICATE-----\n";
+}
+
+struct Chain
+{
+    std::string host;
+    std::string serverPem;
+    std::string intermediatePem;
+    std::string rootPem;
+    // The server's own certificate is pinned.
+    bool serverPinned = false;
+    // The root is pinned, so the intermediate has a trusted issuer.
+    bool rootPinned = false;
+};
+
+double GetNanoseconds(std::chrono::steady_clock::time_point start, size_t calls)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() /
+           calls;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 4000;
+    std::mt19937 random(1);
+    using Clock = CertificateTrustStore::Clock;
+
+    // A root for every 50 hosts, an intermediate for every 10.
+    std::vector<Chain> chains(count);
+    std::string pinnedBundle;
+    for (size_t i = 0; i < count; i++)
+    {
+        Chain& chain = chains[i];
+        std::string root = "Root CA " + std::to_string(i / 50);
+        std::string intermediate = "Issuing CA " + std::to_string(i / 10);
+        chain.host = "host" + std::to_string(i) + ".example";
+        chain.serverPem = ToPem(MakeCertificate(intermediate, chain.host, random));
+        chain.intermediatePem = i % 10 == 0
+                                    ? ToPem(MakeCertificate(root, intermediate, random))
+                                    : chains[i - i % 10].intermediatePem;
+        chain.rootPem = i % 50 == 0 ? ToPem(MakeCertificate(root, root, random))
+                                    : chains[i - i % 50].rootPem;
+        chain.serverPinned = random() % 4 == 0;
+        chain.rootPinned = (i / 50) % 3 == 0;
+        if (chain.serverPinned)
+        {
+            pinnedBundle += chain.serverPem;
+        }
+        if (chain.rootPinned && i % 50 == 0)
+        {
+            pinnedBundle += chain.rootPem;
+        }
+    }
+
+    CertificateTrustStore store;
+    auto start = std::chrono::steady_clock::now();
+    size_t pinned = store.AddPemBundle(pinnedBundle);
+    double addNs = GetNanoseconds(start, pinned);
+    bool ok = Check(pinned == store.GetPinnedCount() && pinned > 0, "The bundle wasn't read.");
+
+    // Each host's first certificate error, then the same error again, which
+    // is answered from the cache unless there are more hosts than it holds.
+    Clock::time_point now = Clock::now();
+    double coldNs = 0;
+    double warmNs = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        start = std::chrono::steady_clock::now();
+        for (const Chain& chain : chains)
+        {
+            ok = Check(
+                     store.IsTrusted(chain.host, chain.serverPem, now) == chain.serverPinned,
+                     "A server got the wrong verdict.") &&
+                 ok;
+        }
+        (pass == 0 ? coldNs : warmNs) = GetNanoseconds(start, count);
+    }
+    CertificateTrustStore::Counters counters = store.GetCounters();
+    size_t limit = CertificateTrustStore::c_maxCachedVerdicts;
+    bool allCached = count > limit || counters.cacheHits == count;
+    ok = Check(allCached, "Repeated errors weren't cached.") &&
+         Check(store.GetCachedVerdictCount() <= limit, "The verdict cache is too big.") && ok;
+
+    // A server that sends someone else's pinned certificate after its own
+    // isn't trusted, nor is one that rotates to an unpinned certificate.
+    size_t rotations = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        const Chain& chain = chains[i];
+        const Chain& other = chains[(i * 7 + 3) % count];
+        std::string spoofed = chain.serverPem + other.serverPem;
+        ok = Check(
+                 store.IsTrusted(chain.host, spoofed, now) == chain.serverPinned,
+                 "An appended certificate changed a verdict.") &&
+             ok;
+        if (chain.serverPinned && other.serverPem != chain.serverPem && !other.serverPinned)
+        {
+            ok = Check(!store.IsTrusted(chain.host, other.serverPem, now),
+                       "A rotated certificate kept the old verdict.") &&
+                 ok;
+            rotations++;
+        }
+    }
+    double rotateNs = GetNanoseconds(start, count + rotations);
+
+    // Client certificates are picked by the issuer index: a server
+    // certificate's issuer is an intermediate, which is never pinned, and an
+    // intermediate's issuer is a root, which is for a third of the chains.
+    start = std::chrono::steady_clock::now();
+    for (const Chain& chain : chains)
+    {
+        ok = Check(!store.HasTrustedIssuer(chain.serverPem), "An issuer is wrongly trusted.") &&
+             Check(store.HasTrustedIssuer(chain.intermediatePem) == chain.rootPinned,
+                   "An issuer got the wrong verdict.") &&
+             ok;
+    }
+    double issuerNs = GetNanoseconds(start, 2 * count);
+
+    // More hosts than the cache holds: it stays within its limit, expired
+    // verdicts go first, and live ones are kept while there are any to drop.
+    CertificateTrustStore limited(std::chrono::seconds(10));
+    const std::string& pem = chains[0].serverPem;
+    for (size_t i = 0; i < limit; i++)
+    {
+        limited.IsTrusted("old" + std::to_string(i), pem, now);
+    }
+    limited.IsTrusted("fresh", pem, now + std::chrono::seconds(20));
+    ok = Check(limited.GetCachedVerdictCount() == 1, "Expired verdicts weren't dropped.") &&
+         ok;
+    for (size_t i = 0; i < 3 * limit && ok; i++)
+    {
+        limited.IsTrusted("new" + std::to_string(i), pem, now + std::chrono::seconds(25));
+        ok = Check(limited.GetCachedVerdictCount() <= limit, "The cache outgrew its limit.");
+    }
+
+    std::printf(
+        "%zu chains, %zu pinned certificates, %zu cached verdicts at most\n"
+        "%-28s %10.0f ns\n%-28s %10.0f ns\n%-28s %10.0f ns\n%-28s %10.0f ns\n"
+        "%-28s %10.0f ns\n",
+        count, pinned, limit, "pin a certificate", addNs, "first error of a host", coldNs,
+        "repeated error", warmNs, "spoofed or rotated chain", rotateNs,
+        "issuer lookup", issuerNs);
+    return ok ? 0 : 1;
+}
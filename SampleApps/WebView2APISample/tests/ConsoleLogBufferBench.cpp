@@ -0,0 +1,79 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures how fast threads push Runtime.consoleAPICalled parameters into a
+// ConsoleLogBuffer, including the extraction of their arguments, while the
+// drain thread writes them to a file:
+//     ConsoleLogBufferBench [messages per thread]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "ConsoleLogBuffer.h"
+
+int main(int argc, char** argv)
+{
+    int perThread = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const char* json = R"({"type":"log",)"
+                       R"("args":[{"type":"string","value":"hello world 12345"}],)"
+                       R"("executionContextId":1,"timestamp":1.7e12,)"
+                       R"("stackTrace":{"callFrames":[]}})";
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "ConsoleLogBufferBench.txt";
+    std::printf(
+        "%8s %12s %14s %12s %12s %14s\n", "threads", "M msg/s", "ns/msg/thread", "written",
+        "dropped", "allocs/push");
+    for (int threadCount : {1, 2, 4, 8})
+    {
+        ConsoleLogBuffer::Options options;
+        options.path = path;
+        options.maxFileBytes = 64 * 1024 * 1024;
+        options.maxFiles = 1;
+        ConsoleLogBuffer buffer(options);
+        uint32_t target = buffer.InternTarget("page");
+        std::vector<uint64_t> allocations(threadCount);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back(
+                [&, t]
+                {
+                    uint64_t before = GetThreadAllocationCount().count;
+                    for (int i = 0; i < perThread; i++)
+                    {
+                        buffer.PushConsoleApiCalled(i, target, json);
+                    }
+                    allocations[t] = GetThreadAllocationCount().count - before;
+                });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        buffer.Flush();
+        ConsoleLogBuffer::Counters counters = buffer.GetCounters();
+        uint64_t totalAllocations = 0;
+        for (uint64_t count : allocations)
+        {
+            totalAllocations += count;
+        }
+        std::printf(
+            "%8d %12.2f %14.1f %12llu %12llu %14.3f\n", threadCount,
+            threadCount * perThread / seconds / 1e6, seconds * 1e9 / perThread,
+            static_cast<unsigned long long>(counters.written),
+            static_cast<unsigned long long>(counters.dropped),
+            static_cast<double>(totalAllocations) / (double(threadCount) * perThread));
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
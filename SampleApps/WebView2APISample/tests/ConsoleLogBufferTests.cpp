@@ -0,0 +1,253 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConsoleLogBuffer.h"
+#include "TestUtil.h"
+
+namespace
+{
+namespace fs = std::filesystem;
+using Level = ConsoleLogBuffer::Level;
+
+fs::path GetTestDirectory()
+{
+    fs::path directory = fs::temp_directory_path() / "ConsoleLogBufferTests";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    return directory;
+}
+
+std::vector<std::string> ReadLines(const fs::path& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void TestFindJsonValue()
+{
+    std::string json = R"({"type":"warning","args":[{"type":"string","value":"a,]\"}"}],)"
+                       R"("executionContextId":1, "timestamp" : 2.5})";
+    CHECK(
+        ConsoleLogBuffer::FindJsonValue(json, "args") ==
+        R"([{"type":"string","value":"a,]\"}"}])");
+    CHECK(ConsoleLogBuffer::FindJsonValue(json, "type") == "\"warning\"");
+    CHECK(ConsoleLogBuffer::FindJsonValue(json, "executionContextId") == "1");
+    CHECK(ConsoleLogBuffer::FindJsonValue(json, "timestamp") == "2.5");
+    CHECK(ConsoleLogBuffer::FindJsonValue(json, "missing").empty());
+    // A key that only appears inside a value isn't found there.
+    CHECK(ConsoleLogBuffer::FindJsonValue(R"({"a":"value"})", "value").empty());
+
+    CHECK(ConsoleLogBuffer::ParseLevel("assert") == Level::Error);
+    CHECK(ConsoleLogBuffer::ParseLevel("warning") == Level::Warning);
+    CHECK(ConsoleLogBuffer::ParseLevel("trace") == Level::Debug);
+    CHECK(ConsoleLogBuffer::ParseLevel("table") == Level::Log);
+}
+
+void TestQuery()
+{
+    ConsoleLogBuffer buffer(ConsoleLogBuffer::Options{});
+    uint32_t page = buffer.InternTarget("page");
+    uint32_t worker = buffer.InternTarget("worker,https://example.com/w.js");
+    CHECK(page != worker);
+    CHECK(buffer.InternTarget("page") == page);
+    CHECK(buffer.GetTargetName(worker) == "worker,https://example.com/w.js");
+
+    buffer.PushConsoleApiCalled(
+        1, worker, R"({"type":"error","args":[{"type":"string","value":"boom"}]})");
+    buffer.Push(2, page, Level::Log, "[1]");
+    buffer.Push(3, page, Level::Warning, std::string(1000, 'x'));
+
+    std::vector<ConsoleLogBuffer::Record> records =
+        buffer.Query(ConsoleLogBuffer::c_anyTarget, Level::Warning, 10);
+    CHECK(records.size() == 2);
+    if (records.size() == 2)
+    {
+        // Newest first.
+        CHECK(records[0].timeMicros == 3);
+        CHECK(records[0].truncated);
+        CHECK(records[0].args.size() == ConsoleLogBuffer::c_maxArgsBytes);
+        CHECK(records[1].target == worker);
+        CHECK(records[1].level == Level::Error);
+        CHECK(records[1].args == R"([{"type":"string","value":"boom"}])");
+    }
+    CHECK(buffer.Query(page, Level::Debug, 10).size() == 2);
+    CHECK(buffer.Query(page, Level::Debug, 1).size() == 1);
+}
+
+void TestDrainAndRotate()
+{
+    fs::path directory = GetTestDirectory();
+    ConsoleLogBuffer::Options options;
+    options.path = directory / "ConsoleLog.txt";
+    options.maxFileBytes = 20000;
+    options.maxFiles = 3;
+    {
+        ConsoleLogBuffer buffer(options);
+        uint32_t page = buffer.InternTarget("page");
+        buffer.PushConsoleApiCalled(
+            1700000000123456, page, R"({"type":"info","args":[{"value":"hi"}]})");
+        buffer.Flush();
+        std::vector<std::string> lines = ReadLines(options.path);
+        CHECK(lines.size() == 1);
+        CHECK(!lines.empty() && lines[0] == "2023-11-14T22:13:20.123456Z\tINFO\tpage\t"
+                                            "[{\"value\":\"hi\"}]");
+
+        // Each line is about 500 bytes, so 200 of them rotate the file 4
+        // times, and only 3 files are kept.
+        for (int i = 0; i < 200; i++)
+        {
+            buffer.Push(i, page, Level::Error, std::string(1000, 'x'));
+        }
+        buffer.Flush();
+        ConsoleLogBuffer::Counters counters = buffer.GetCounters();
+        CHECK(counters.pushed == 201);
+        CHECK(counters.written == 201);
+        CHECK(counters.dropped == 0);
+    }
+    CHECK(fs::file_size(options.path) <= options.maxFileBytes);
+    CHECK(fs::exists(directory / "ConsoleLog.txt.1"));
+    CHECK(fs::exists(directory / "ConsoleLog.txt.2"));
+    CHECK(!fs::exists(directory / "ConsoleLog.txt.3"));
+    fs::remove_all(directory);
+}
+
+void TestOverrunCountsDropped()
+{
+    fs::path directory = GetTestDirectory();
+    ConsoleLogBuffer::Options options;
+    options.path = directory / "ConsoleLog.txt";
+    options.drainInterval = std::chrono::hours(1);
+    {
+        ConsoleLogBuffer buffer(options);
+        uint32_t page = buffer.InternTarget("page");
+        for (int i = 0; i < 10000; i++)
+        {
+            buffer.Push(i, page, Level::Log, "[]");
+        }
+        buffer.Flush();
+        ConsoleLogBuffer::Counters counters = buffer.GetCounters();
+        CHECK(counters.written == ConsoleLogBuffer::c_capacity);
+        CHECK(counters.dropped == 10000 - ConsoleLogBuffer::c_capacity);
+        // The oldest message that was kept is the first line.
+        std::vector<std::string> lines = ReadLines(options.path);
+        CHECK(lines.size() == ConsoleLogBuffer::c_capacity);
+    }
+    fs::remove_all(directory);
+}
+
+void TestReleasedTargetsAreReused()
+{
+    ConsoleLogBuffer buffer(ConsoleLogBuffer::Options{});
+    uint32_t page = buffer.InternTarget("page");
+    uint32_t first = buffer.InternTarget("iframe,a");
+    buffer.Push(0, first, Level::Log, "[]");
+    buffer.ReleaseTarget(first);
+    // The ring still holds a message of the released target, so its integer
+    // isn't reused yet and the message keeps its name.
+    uint32_t second = buffer.InternTarget("iframe,b");
+    CHECK(second != first);
+    CHECK(buffer.GetTargetName(first) == "iframe,a");
+    for (size_t i = 0; i < ConsoleLogBuffer::c_capacity; i++)
+    {
+        buffer.Push(0, page, Level::Log, "[]");
+    }
+    uint32_t third = buffer.InternTarget("iframe,c");
+    CHECK(third == first);
+    CHECK(buffer.GetTargetName(third) == "iframe,c");
+    CHECK(buffer.InternTarget("iframe,c") == third);
+
+    // Interning a released name again takes it back.
+    buffer.ReleaseTarget(second);
+    CHECK(buffer.InternTarget("iframe,b") == second);
+
+    // Frames that come and go, as on a page that keeps reloading its ads,
+    // don't grow the table: every integer stays below a small bound.
+    uint32_t largest = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        uint32_t frame = buffer.InternTarget("iframe,https://ads.example/" + std::to_string(i));
+        largest = (std::max)(largest, frame);
+        for (int j = 0; j < 10; j++)
+        {
+            buffer.Push(i, frame, Level::Log, "[]");
+        }
+        buffer.ReleaseTarget(frame);
+    }
+    CHECK(largest < 2 * ConsoleLogBuffer::c_capacity / 10);
+}
+
+void TestConcurrentWritersDrainCompletely()
+{
+    fs::path directory = GetTestDirectory();
+    ConsoleLogBuffer::Options options;
+    options.path = directory / "ConsoleLog.txt";
+    options.maxFileBytes = 64 * 1024 * 1024;
+    options.drainInterval = std::chrono::milliseconds(1);
+    const int threadCount = 8;
+    const int perThread = 200000;
+    {
+        ConsoleLogBuffer buffer(options);
+        uint32_t page = buffer.InternTarget("page");
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back(
+                [&]
+                {
+                    for (int i = 0; i < perThread; i++)
+                    {
+                        buffer.PushConsoleApiCalled(
+                            i, page, R"({"type":"log","args":[{"value":"x"}]})");
+                    }
+                });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        // Every message is written or counted as dropped. A slot left with
+        // an older record by a lapped writer is skipped rather than waited
+        // on forever.
+        ConsoleLogBuffer::Counters counters;
+        for (int attempt = 0; attempt < 100; attempt++)
+        {
+            buffer.Flush();
+            counters = buffer.GetCounters();
+            if (counters.written + counters.dropped == counters.pushed)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        CHECK(counters.pushed == uint64_t(threadCount) * perThread);
+        CHECK(counters.written + counters.dropped == counters.pushed);
+        CHECK(counters.written > 0);
+    }
+    fs::remove_all(directory);
+}
+} // namespace
+
+int main()
+{
+    TestFindJsonValue();
+    TestQuery();
+    TestDrainAndRotate();
+    TestOverrunCountsDropped();
+    TestReleasedTargetsAreReused();
+    TestConcurrentWritersDrainCompletely();
+    return FinishTests("ConsoleLogBufferTests");
+}
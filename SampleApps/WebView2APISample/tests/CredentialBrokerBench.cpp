@@ -0,0 +1,248 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Loads a CredentialBroker with credentials for 100k realms: hosts with one
+// realm, hosts with any realm and wildcard domains. Then replays ten times as
+// many BasicAuthenticationRequested events as the Authentication scenario
+// handles them, popular hosts far more often than the rest: the host of the
+// URI, the realm of the challenge, the answer, and the status of the response,
+// which now and then rejects the credentials until the retry limit. Checks
+// every answer against the credential the request was made for and reports
+// the time per request and the answer cache's hit rate:
+//     CredentialBrokerBench [realm count]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CredentialBroker.h"
+
+namespace
+{
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+// A request of the replay, with the user name it should be answered with.
+struct Request
+{
+    std::string uri;
+    std::string challenge;
+    // Empty if no credential covers the host and realm.
+    std::string expectedUser;
+    int64_t timeMs = 0;
+    // The server rejects the credentials it is supplied.
+    bool rejects = false;
+};
+
+// The retry attempts CredentialBroker should be counting, by host and realm.
+struct ExpectedAttempts
+{
+    uint32_t count = 0;
+    int64_t firstMs = 0;
+};
+
+double GetNanoseconds(std::chrono::steady_clock::time_point start, size_t calls)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() /
+           calls;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t realmCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+    size_t requestCount = realmCount * 10;
+    std::mt19937 random(1);
+    // Hosts are popular by Zipf's law.
+    auto zipf = [&random](size_t n)
+    { return static_cast<size_t>(std::pow(double(n), double(random()) / random.max())) - 1; };
+
+    // Half of the credentials are for one realm of a host, a quarter for any
+    // realm of a host and a quarter for the subdomains of a domain.
+    size_t exactCount = realmCount / 2;
+    size_t anyRealmCount = realmCount / 4;
+    size_t wildcardCount = realmCount - exactCount - anyRealmCount;
+    std::string store = "# host\trealm\tuser name\tpassword\n";
+    for (size_t i = 0; i < realmCount; i++)
+    {
+        std::string index = std::to_string(i);
+        if (i < exactCount)
+        {
+            store += "app" + index + ".site" + std::to_string(i % 97) + ".example\tRealm " +
+                     index;
+        }
+        else if (i < exactCount + anyRealmCount)
+        {
+            store += "Intranet" + index + ".corp.example\t*";
+        }
+        else
+        {
+            store += "*.team" + index + ".example\t*";
+        }
+        store += "\tuser" + index + "\tp@ss" + index + "\n";
+    }
+
+    CredentialBroker broker;
+    std::istringstream input(store);
+    auto start = std::chrono::steady_clock::now();
+    size_t loaded = broker.Load(input);
+    double loadNs = GetNanoseconds(start, realmCount);
+    bool ok = Check(loaded == realmCount && broker.GetCount() == realmCount,
+                    "The store wasn't loaded.");
+    CredentialBroker reloaded;
+    std::istringstream saved(broker.Save());
+    ok = Check(reloaded.Load(saved) == realmCount, "The saved store doesn't load.") && ok;
+
+    std::vector<Request> requests(requestCount);
+    int64_t nowMs = 1;
+    for (Request& request : requests)
+    {
+        size_t kind = random() % 10;
+        std::string realm = "Realm " + std::to_string(zipf(realmCount));
+        if (kind < 5)
+        {
+            size_t i = zipf(exactCount);
+            std::string index = std::to_string(i);
+            std::string host = "app" + index + ".site" + std::to_string(i % 97) + ".example";
+            // The host's own realm, or another one that it has no credential for.
+            bool ownRealm = random() % 8 != 0;
+            request.uri = "https://" + host + "/reports/" + index;
+            realm = ownRealm ? "Realm " + index : realm + " (other)";
+            request.expectedUser = ownRealm ? "user" + index : "";
+        }
+        else if (kind < 7)
+        {
+            size_t i = exactCount + zipf(anyRealmCount);
+            request.uri = "http://INTRANET" + std::to_string(i) + ".Corp.Example/";
+            request.expectedUser = "user" + std::to_string(i);
+        }
+        else if (kind < 9)
+        {
+            // Any depth of subdomain, but not the domain itself.
+            size_t i = exactCount + anyRealmCount + zipf(wildcardCount);
+            std::string domain = "team" + std::to_string(i) + ".example";
+            bool subdomain = random() % 10 != 0;
+            request.uri = "https://" +
+                          (subdomain ? "build" + std::to_string(random() % 4) +
+                                           (random() % 2 ? ".eu." : ".") + domain
+                                     : domain) +
+                          "/";
+            request.expectedUser = subdomain ? "user" + std::to_string(i) : "";
+        }
+        else
+        {
+            request.uri = "https://user@unknown" + std::to_string(zipf(realmCount)) +
+                          ".example:8443/login";
+        }
+        request.challenge = "Basic realm=\"" + realm + "\", charset=\"UTF-8\"";
+        nowMs += 1 + random() % 3;
+        request.timeMs = nowMs;
+        request.rejects = random() % 100 == 0;
+    }
+
+    // Replays the requests a few milliseconds apart. After a supplied
+    // credential, the server mostly accepts it; otherwise it rejects it until
+    // the broker stops supplying it.
+    std::vector<CredentialBroker::Answer> answers;
+    answers.reserve(requestCount * 2);
+    start = std::chrono::steady_clock::now();
+    for (const Request& request : requests)
+    {
+        std::string host = CredentialBroker::GetHost(request.uri);
+        std::string realm = CredentialBroker::GetRealm(request.challenge);
+        while (true)
+        {
+            answers.push_back(broker.Resolve(host, realm, request.timeMs));
+            if (answers.back().outcome != CredentialBroker::Outcome::Supply)
+            {
+                break;
+            }
+            broker.RecordResponse(host, request.rejects ? 401 : 200);
+            if (!request.rejects)
+            {
+                break;
+            }
+        }
+    }
+    double requestNs = GetNanoseconds(start, requestCount);
+    uint64_t hits = broker.GetCacheHits();
+    ok = Check(hits + broker.GetCacheMisses() == answers.size(), "Lookups went uncounted.") &&
+         ok;
+
+    // The answers again, from the credential each request was made for and
+    // the attempts the broker should be counting.
+    std::map<std::string, std::map<std::string, ExpectedAttempts>> expectedAttempts;
+    size_t retryLimits = 0;
+    auto answer = answers.begin();
+    auto next = [&]
+    {
+        bool more = Check(answer != answers.end(), "A request went unanswered.");
+        ok = more && ok;
+        return more ? *answer++ : CredentialBroker::Answer();
+    };
+    for (const Request& request : requests)
+    {
+        std::string host = CredentialBroker::GetHost(request.uri);
+        std::string realm = CredentialBroker::GetRealm(request.challenge);
+        if (request.expectedUser.empty())
+        {
+            ok = Check(next().outcome == CredentialBroker::Outcome::NoCredential,
+                       "A request without a credential got an answer.") &&
+                 ok;
+            continue;
+        }
+        ExpectedAttempts& attempts = expectedAttempts[host][realm];
+        if (request.timeMs - attempts.firstMs > CredentialBroker::c_retryWindowMs)
+        {
+            attempts = ExpectedAttempts();
+        }
+        // Supplied until the retry limit, unless the server accepts it.
+        bool accepted = false;
+        while (!accepted && attempts.count < CredentialBroker::c_maxAttempts)
+        {
+            CredentialBroker::Answer supplied = next();
+            ok = Check(supplied.outcome == CredentialBroker::Outcome::Supply &&
+                           supplied.credential &&
+                           supplied.credential->userName == request.expectedUser,
+                       "A request got the wrong credential.") &&
+                 ok;
+            if (attempts.count++ == 0)
+            {
+                attempts.firstMs = request.timeMs;
+            }
+            accepted = !request.rejects;
+        }
+        if (accepted)
+        {
+            expectedAttempts.erase(host);
+            continue;
+        }
+        ok = Check(next().outcome == CredentialBroker::Outcome::RetryLimit,
+                   "A retry loop wasn't stopped.") &&
+             ok;
+        retryLimits++;
+    }
+    ok = Check(answer == answers.end(), "The answers don't match the requests.") && ok;
+
+    std::printf(
+        "%zu credentials loaded in %.0f ns each\n"
+        "%zu requests in %.0f ns each, %zu lookups, %.1f%% answered from the cache, "
+        "%zu retry limits\n",
+        realmCount, loadNs, requestCount, requestNs, answers.size(),
+        100.0 * hits / answers.size(), retryLimits);
+    return ok ? 0 : 1;
+}
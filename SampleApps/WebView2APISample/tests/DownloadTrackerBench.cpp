@@ -0,0 +1,208 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs concurrent downloads of random sizes and bandwidths through a
+// DownloadTracker on a simulated clock, as ScenarioCustomDownloadExperience
+// feeds it: a progress event per received chunk, a UI update when the tracker
+// allows one, and now and then a pause, a resume or an interruption. Reports
+// the time per progress event and checks the tracker's running totals against
+// its table:
+//     DownloadTrackerBench [download count]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "DownloadTracker.h"
+
+namespace
+{
+struct SimulatedDownload
+{
+    int64_t totalBytes = 0;
+    int64_t bytesPerTick = 0;
+    int64_t bytesReceived = 0;
+    bool finished = false;
+    // Paused by the user until this tick, or 0.
+    uint64_t pausedUntilTick = 0;
+};
+
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+// Compares the tracker's summary with a walk over its downloads.
+bool CheckSummary(
+    const DownloadTracker& tracker, const std::vector<SimulatedDownload>& downloads,
+    size_t maxConcurrent)
+{
+    DownloadTracker::Summary summary = tracker.GetSummary();
+    size_t counts[3] = {};
+    int64_t bytesReceived = 0;
+    int64_t bytesRemaining = 0;
+    for (uint64_t id = 1; id < downloads.size(); id++)
+    {
+        const DownloadTracker::Download* download = tracker.Find(id);
+        if (!Check(!download == downloads[id].finished, "The tracker lost a download."))
+        {
+            return false;
+        }
+        if (download)
+        {
+            counts[static_cast<size_t>(download->state)]++;
+            bytesReceived += download->bytesReceived;
+            if (download->totalBytes >= 0)
+            {
+                bytesRemaining += download->totalBytes - download->bytesReceived;
+            }
+        }
+    }
+    return Check(summary.active <= maxConcurrent, "Too many downloads are active.") &&
+           Check(
+               summary.queued == counts[static_cast<size_t>(DownloadTracker::State::Queued)] &&
+                   summary.active ==
+                       counts[static_cast<size_t>(DownloadTracker::State::Active)] &&
+                   summary.paused ==
+                       counts[static_cast<size_t>(DownloadTracker::State::Paused)],
+               "The state counts are off.") &&
+           Check(summary.bytesReceived == bytesReceived, "The received total is off.") &&
+           Check(summary.bytesRemaining == bytesRemaining, "The remaining total is off.");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000;
+    DownloadTracker::Options options;
+    options.maxConcurrent = (std::max)(size_t(1), count / 4);
+    DownloadTracker tracker(options);
+    std::mt19937_64 random(1);
+    constexpr uint64_t c_tickMs = 10;
+
+    // Ids start at 1, as the scenario's do.
+    std::vector<SimulatedDownload> downloads(count + 1);
+    downloads[0].finished = true;
+    for (uint64_t id = 1; id <= count; id++)
+    {
+        SimulatedDownload& download = downloads[id];
+        download.totalBytes = 1024 * 1024 + random() % (32 * 1024 * 1024);
+        // From 64 KB/s to 4 MB/s.
+        download.bytesPerTick = (64 + random() % 4032) * 1024 * c_tickMs / 1000;
+        // One server in ten doesn't send a size.
+        tracker.Add(id, random() % 10 == 0 ? -1 : download.totalBytes, 0);
+    }
+    bool ok = CheckSummary(tracker, downloads, options.maxConcurrent);
+
+    uint64_t events = 0;
+    uint64_t publishes = 0;
+    uint64_t pauses = 0;
+    size_t mostActive = 0;
+    size_t finished = 0;
+    std::vector<uint64_t> toResume;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t tick = 0;
+    for (; finished < count && ok; tick++)
+    {
+        uint64_t nowMs = tick * c_tickMs;
+        for (uint64_t id = 1; id <= count; id++)
+        {
+            SimulatedDownload& download = downloads[id];
+            if (download.finished)
+            {
+                continue;
+            }
+            const DownloadTracker::Download* tracked = tracker.Find(id);
+            if (download.pausedUntilTick)
+            {
+                // Resumed from the page, which may leave it queued.
+                if (tick >= download.pausedUntilTick)
+                {
+                    download.pausedUntilTick = 0;
+                    tracker.Resume(id, nowMs);
+                }
+                continue;
+            }
+            if (tracked->state != DownloadTracker::State::Active)
+            {
+                continue;
+            }
+            uint64_t roll = random() % 100000;
+            if (roll < 5)
+            {
+                tracker.Pause(id, &toResume);
+                download.pausedUntilTick = tick + 1 + random() % 200;
+                pauses++;
+                continue;
+            }
+            download.bytesReceived =
+                (std::min)(download.totalBytes, download.bytesReceived + download.bytesPerTick);
+            tracker.UpdateBytes(id, download.bytesReceived, nowMs);
+            events++;
+            if (tracker.ShouldPublish(nowMs))
+            {
+                DownloadTracker::Summary summary = tracker.GetSummary();
+                mostActive = (std::max)(mostActive, summary.active);
+                publishes++;
+            }
+            if (download.bytesReceived == download.totalBytes || roll < 10)
+            {
+                download.finished = true;
+                finished++;
+                bool completed = download.bytesReceived == download.totalBytes;
+                tracker.Finish(id, completed, nowMs, &toResume);
+            }
+            for (uint64_t resumed : toResume)
+            {
+                ok = ok && Check(
+                               tracker.Find(resumed)->state == DownloadTracker::State::Active,
+                               "A promoted download isn't active.");
+            }
+            toResume.clear();
+        }
+        if (tick % 100 == 0)
+        {
+            ok = ok && CheckSummary(tracker, downloads, options.maxConcurrent);
+        }
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    DownloadTracker::Summary summary = tracker.GetSummary();
+    ok = ok && CheckSummary(tracker, downloads, options.maxConcurrent) &&
+         Check(tracker.GetCount() == 0, "Finished downloads are still tracked.") &&
+         Check(summary.completed + summary.interrupted == count, "Downloads went missing.") &&
+         Check(std::fabs(summary.bytesPerSecond) < 1, "The throughput didn't return to 0.") &&
+         Check(mostActive == options.maxConcurrent, "The slots weren't all used.");
+
+    // A steady download's smoothed throughput and ETA settle on its rate.
+    DownloadTracker steady;
+    steady.Add(1, 100 * 1024 * 1024, 0);
+    for (uint64_t ms = 100; ms <= 5000; ms += 100)
+    {
+        steady.UpdateBytes(1, static_cast<int64_t>(ms) * 1024 * 1024 / 1000, ms);
+    }
+    ok = ok &&
+         Check(
+             std::fabs(steady.Find(1)->bytesPerSecond - 1024 * 1024) < 1024,
+             "The smoothed throughput is off.") &&
+         Check(std::fabs(steady.GetEtaSeconds(1) - 95) < 0.1, "The ETA is off.");
+
+    std::printf(
+        "%zu downloads, %zu at a time: %llu progress events in %llu simulated s, "
+        "%.0f ns/event, %llu UI updates, %llu pauses, %zu completed, %zu interrupted\n",
+        count, options.maxConcurrent, static_cast<unsigned long long>(events),
+        static_cast<unsigned long long>(tick * c_tickMs / 1000), seconds * 1e9 / events,
+        static_cast<unsigned long long>(publishes), static_cast<unsigned long long>(pauses),
+        summary.completed, summary.interrupted);
+    return ok ? 0 : 1;
+}
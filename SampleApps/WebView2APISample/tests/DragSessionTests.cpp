@@ -0,0 +1,198 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "DragSession.h"
+#include "TestUtil.h"
+
+namespace
+{
+// An OLE drag event, as DropTarget receives it.
+struct DragEvent
+{
+    enum class Kind
+    {
+        Enter,
+        Over,
+        Leave,
+        Drop,
+    };
+    Kind kind;
+    int64_t timeUs;
+    DragSession::Point screen = {0, 0};
+    uint32_t keyState = 0;
+    uintptr_t data = 0;
+};
+
+// What the WebView received from a replay through the session.
+struct ReplayResult
+{
+    uint64_t forwarded = 0;
+    uint64_t answered = 0;
+    uint64_t snapshots = 0;
+    DragSession::Point lastForwarded = {0, 0};
+    int64_t lastForwardedUs = 0;
+};
+
+// Replays the events as DropTarget handles them, with a WebView that answers
+// every forwarded event with DROPEFFECT_COPY.
+ReplayResult Replay(
+    DragSession& session, const std::vector<DragEvent>& events, DragSession::Point offset,
+    int64_t frameIntervalUs)
+{
+    constexpr uint32_t c_effectCopy = 1;
+    ReplayResult result;
+    for (const DragEvent& event : events)
+    {
+        switch (event.kind)
+        {
+        case DragEvent::Kind::Enter:
+            if (session.Enter(
+                    event.data, offset, event.keyState, frameIntervalUs, event.timeUs))
+            {
+                session.SetFormats({{15, 1, "CF_HDROP"}, {49159, 1, "FileNameW"}});
+                result.snapshots++;
+            }
+            session.RecordForwarded(c_effectCopy, 30);
+            result.forwarded++;
+            result.lastForwarded = session.ToWebView(event.screen);
+            result.lastForwardedUs = event.timeUs;
+            break;
+        case DragEvent::Kind::Over:
+            if (session.ShouldForwardOver(event.keyState, event.timeUs))
+            {
+                session.RecordForwarded(c_effectCopy, 30);
+                result.forwarded++;
+                result.lastForwarded = session.ToWebView(event.screen);
+                result.lastForwardedUs = event.timeUs;
+            }
+            else
+            {
+                CHECK(session.GetLastEffect() == c_effectCopy);
+                result.answered++;
+            }
+            break;
+        case DragEvent::Kind::Leave:
+            session.Leave(event.timeUs);
+            session.Reset();
+            break;
+        case DragEvent::Kind::Drop:
+            session.GetFormats()[0].droppedBytes = 1234;
+            session.Drop(3, 500, event.timeUs);
+            session.Reset();
+            break;
+        }
+    }
+    return result;
+}
+
+// A drag across the window with a 1000 Hz mouse, which then holds still while
+// OLE keeps calling DragOver every 50 ms, `stillPolls` times.
+std::vector<DragEvent> MakeDrag(
+    uintptr_t data, int64_t startUs, int64_t durationUs, int stillPolls = 4)
+{
+    std::vector<DragEvent> events;
+    events.push_back({DragEvent::Kind::Enter, startUs, {0, 5}, 0, data});
+    int64_t endUs = startUs + durationUs;
+    for (int64_t timeUs = startUs + 1000; timeUs < endUs; timeUs += 1000)
+    {
+        events.push_back(
+            {DragEvent::Kind::Over, timeUs, {int32_t((timeUs - startUs) / 1000), 5}});
+    }
+    DragSession::Point stillAt = {int32_t((endUs - startUs) / 1000) - 1, 5};
+    for (int poll = 1; poll <= stillPolls; poll++)
+    {
+        events.push_back({DragEvent::Kind::Over, endUs + poll * 50000, stillAt});
+    }
+    return events;
+}
+
+void TestCoalescesToFrameRate()
+{
+    DragSession session;
+    std::vector<DragEvent> events = MakeDrag(1, 0, 2000000, 1);
+    ReplayResult result = Replay(session, events, {-10, -20}, 16667);
+    CHECK(session.GetOverCount() == events.size() - 1);
+    // One DragOver per frame, plus the still one.
+    CHECK(session.GetForwardedOverCount() <= 2000000 / 16667 + 2);
+    CHECK(session.GetForwardedOverCount() >= 2000000 / 16667 - 2);
+    CHECK(result.forwarded + result.answered == events.size());
+    // The position the mouse stopped at reaches the WebView with the first
+    // OLE poll, offset as taken when the drag entered.
+    CHECK(result.lastForwarded.x == 1999 - 10);
+    CHECK(result.lastForwarded.y == 5 - 20);
+    CHECK(result.lastForwardedUs == 2000000 + 50000);
+}
+
+void TestKeyChangesAreForwardedAtOnce()
+{
+    DragSession session;
+    CHECK(session.Enter(1, {0, 0}, 0, 16667, 0));
+    CHECK(!session.ShouldForwardOver(0, 1000));
+    // Pressing Shift changes the effect, so it can't wait for the frame.
+    CHECK(session.ShouldForwardOver(4, 2000));
+    CHECK(!session.ShouldForwardOver(4, 3000));
+    CHECK(session.ShouldForwardOver(0, 4000));
+    CHECK(session.ShouldForwardOver(0, 4000 + 16667));
+}
+
+void TestSnapshotsOncePerSession()
+{
+    DragSession session;
+    std::vector<DragEvent> events = MakeDrag(1, 0, 100000);
+    // The drag leaves and comes back: DropTarget doesn't hold the data past
+    // the leave, so it snapshots again.
+    events.push_back({DragEvent::Kind::Leave, 400000});
+    std::vector<DragEvent> back = MakeDrag(1, 500000, 100000);
+    events.insert(events.end(), back.begin(), back.end());
+    events.push_back({DragEvent::Kind::Drop, 800000});
+    ReplayResult result = Replay(session, events, {0, 0}, 16667);
+    CHECK(result.snapshots == 2);
+
+    // A DragEnter for the data of the session doesn't snapshot it again.
+    CHECK(session.Enter(7, {0, 0}, 0, 16667, 900000));
+    CHECK(!session.Enter(7, {0, 0}, 0, 16667, 900100));
+    session.Reset();
+    CHECK(session.Enter(7, {0, 0}, 0, 16667, 900200));
+    // 0 is no data and is never taken for the session's.
+    session.Reset();
+    CHECK(session.Enter(0, {0, 0}, 0, 16667, 900300));
+    CHECK(session.Enter(0, {0, 0}, 0, 16667, 900400));
+}
+
+void TestReport()
+{
+    DragSession session;
+    std::vector<DragEvent> events = MakeDrag(1, 0, 300000);
+    events.push_back({DragEvent::Kind::Drop, 600000});
+    Replay(session, events, {0, 0}, 16667);
+    std::string report = session.GetReport();
+    CHECK(report.find("1 drag enters, 1 format snapshots, 1 drops") != std::string::npos);
+    CHECK(report.find("forwarded at most every 16667 us") != std::string::npos);
+    CHECK(report.find("3 files at the last drop") != std::string::npos);
+    // Only measured formats have a size.
+    CHECK(report.find("CF_HDROP (15, media 1): 1234 bytes") != std::string::npos);
+    CHECK(report.find("FileNameW (49159, media 1)\n") != std::string::npos);
+}
+
+void TestDefaultFrameInterval()
+{
+    DragSession session;
+    CHECK(session.Enter(1, {0, 0}, 0, 0, 0));
+    CHECK(!session.ShouldForwardOver(0, DragSession::c_defaultFrameIntervalUs - 1));
+    CHECK(session.ShouldForwardOver(0, DragSession::c_defaultFrameIntervalUs));
+}
+} // namespace
+
+int main()
+{
+    TestCoalescesToFrameRate();
+    TestKeyChangesAreForwardedAtOnce();
+    TestSnapshotsOncePerSession();
+    TestReport();
+    TestDefaultFrameInterval();
+    return FinishTests("DragSessionTests");
+}
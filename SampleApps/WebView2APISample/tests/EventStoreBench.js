@@ -0,0 +1,188 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks and measures the EventStore of ScenarioWebViewEventMonitor.js against
+// keeping every event as a parsed object, as the monitor page used to:
+//     node --expose-gc EventStoreBench.js <ScenarioWebViewEventMonitor.js> [event count]
+// Without --expose-gc the heap figures are left out.
+
+"use strict";
+
+const fs = require("fs");
+const vm = require("vm");
+
+if (process.argv.length < 3) {
+    console.error("usage: EventStoreBench.js <ScenarioWebViewEventMonitor.js> [event count]");
+    process.exit(2);
+}
+vm.runInThisContext(fs.readFileSync(process.argv[2], "utf8") +
+    "\nglobalThis.EventStore = EventStore;");
+const eventCount = Number(process.argv[3] || 100000);
+
+let failures = 0;
+function check(condition, message) {
+    if (!condition) {
+        console.error("check failed: " + message);
+        failures++;
+    }
+}
+
+// Mostly resource requests, as in a recorded session of a typical page.
+const names = ["WebResourceRequested", "NavigationStarting", "ContentLoading",
+    "SourceChanged", "FrameNavigationStarting", "DOMContentLoaded"];
+function makeEvent(i) {
+    const uri = `https://cdn${i % 37}.example.com/assets/${i % 1000}/bundle-${i}.js?v=${i % 7}`;
+    return JSON.stringify({
+        kind: "event",
+        name: i % 10 < 8 ? names[0] : names[1 + i % 5],
+        args: {
+            request: {
+                uri: uri,
+                method: "GET",
+                headers: { Accept: "*/*", Referer: `https://www.example.com/page/${i % 100}` },
+            },
+            response: null,
+        },
+        webview: {
+            source: "https://www.example.com/",
+            documentTitle: `Example ${i % 100}`,
+            canGoBack: true,
+            canGoForward: false,
+        },
+    });
+}
+
+function scan(store, query) {
+    const result = [];
+    for (let sequence = store.oldest; sequence < store.total; sequence++) {
+        if (store.matches(sequence, query)) {
+            result.push(sequence);
+        }
+    }
+    return result;
+}
+
+function testFilterMatchesScan(events) {
+    // Small enough for the ring to wrap several times and the trigram lists
+    // to be pruned and compacted.
+    const store = new EventStore(1000);
+    const queries = ["cdn3.example", "ng", "bundle-49", "navigationstarting",
+        "assets/12/", "zz", "?v=3"];
+    for (let i = 0; i < Math.min(events.length, 5000); i++) {
+        store.push(events[i], i);
+        if (i % 997 === 0) {
+            for (const query of queries) {
+                const expected = JSON.stringify(scan(store, query));
+                check(JSON.stringify(store.filter(query)) === expected,
+                    `filter "${query}" after ${i + 1} events`);
+            }
+        }
+    }
+    const last = store.total - 1;
+    check(store.getEvent(last).args.request.uri.includes(`bundle-${last}.js`), "payload");
+    check(!store.has(store.oldest - 1) && store.has(last), "retained range");
+    store.clear();
+    check(store.count === 1000 && store.filter("cdn").length === 0, "clear");
+}
+
+function testFindString() {
+    check(EventStore.findString(`{"uri" : "a\\"b"}`, "uri") === "a\"b", "escaped quote");
+    check(EventStore.findString(`{"uri": null}`, "uri") === "", "not a string");
+    check(EventStore.findString(`{"name": "x"}`, "uri") === "", "missing key");
+}
+
+function getHeapUsed() {
+    if (!global.gc) {
+        return 0;
+    }
+    global.gc();
+    global.gc();
+    return process.memoryUsage().heapUsed;
+}
+
+// The heap a structure takes is measured as what dropping it frees, as other
+// garbage of the benchmark would be counted when comparing with the heap
+// before it was built.
+function formatHeap(used, released) {
+    return global.gc ? `, heap ${((used - released) / 1048576).toFixed(1)} MB` : "";
+}
+
+function nowMs() {
+    return Number(process.hrtime.bigint()) / 1e6;
+}
+
+function timeFilter(label, filter) {
+    const start = nowMs();
+    const matches = filter();
+    return `${label}: ${matches} in ${(nowMs() - start).toFixed(2)} ms`;
+}
+
+function benchStore(events, capacity, queries) {
+    let store = new EventStore(capacity);
+    // The page renders at most once per animation frame: each frame pushes
+    // the events that arrived and reads the 50 rows at the tail.
+    const eventsPerFrame = 500;
+    const frameMs = [];
+    const start = nowMs();
+    for (let first = 0; first < events.length; first += eventsPerFrame) {
+        const frameStart = nowMs();
+        const end = Math.min(events.length, first + eventsPerFrame);
+        for (let i = first; i < end; i++) {
+            store.push(events[i], i);
+        }
+        let characters = 0;
+        for (let sequence = Math.max(store.oldest, store.total - 50);
+            sequence < store.total; sequence++) {
+            characters += store.getName(sequence).length;
+        }
+        frameMs.push(nowMs() - frameStart);
+    }
+    const pushNanos = (nowMs() - start) * 1e6 / events.length;
+    frameMs.sort((a, b) => a - b);
+    const p50 = frameMs[frameMs.length >> 1];
+    const p99 = frameMs[Math.floor((frameMs.length - 1) * 0.99)];
+    const filters = queries.map(
+        query => timeFilter(query, () => store.filter(query).length)).join("; ");
+    const used = getHeapUsed();
+    store = null;
+    // The payloads are the strings of `events`, which stay, so this is the
+    // store's overhead.
+    console.log(`EventStore(${capacity}): push ${pushNanos.toFixed(0)} ns/event` +
+        `${formatHeap(used, getHeapUsed())}, frame of ${eventsPerFrame} events and 50 ` +
+        `rows p50 ${p50.toFixed(2)} ms p99 ${p99.toFixed(2)} ms`);
+    console.log("  " + filters);
+}
+
+function benchParsedObjects(events, queries) {
+    const start = nowMs();
+    let parsed = events.map(event => JSON.parse(event));
+    const parseNanos = (nowMs() - start) * 1e6 / events.length;
+    const filters = queries.map(query => timeFilter(query, () => parsed.filter(
+        event => (event.name + " " + JSON.stringify(event.args)).toLowerCase()
+            .includes(query)).length)).join("; ");
+    const used = getHeapUsed();
+    parsed = null;
+    console.log(`parsed objects: ${parseNanos.toFixed(0)} ns/event` +
+        formatHeap(used, getHeapUsed()));
+    console.log("  " + filters);
+}
+
+const events = [];
+for (let i = 0; i < eventCount; i++) {
+    events.push(makeEvent(i));
+}
+testFilterMatchesScan(events);
+testFindString();
+
+const queries = ["cdn12.example.com/assets/12", "bundle-99", "navigationstarting", "zz"];
+console.log(`${eventCount} events of ${(events.reduce((sum, event) => sum + event.length, 0) /
+    eventCount).toFixed(0)} characters`);
+benchStore(events, 100000, queries);
+benchStore(events, 20000, queries);
+benchParsedObjects(events, queries);
+
+if (failures) {
+    console.error(`EventStoreBench: ${failures} check(s) failed`);
+    process.exit(1);
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Appends failures to a FailureLog in batches as ProcessComponent does, opens
+// the log again and queries it, once without a size cap and once with one
+// small enough to rotate:
+//     FailureLogBench [record count]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FailureLog.h"
+
+namespace
+{
+constexpr int64_t c_startMs = 1700000000000;
+constexpr int64_t c_intervalMs = 50;
+constexpr int64_t c_dayMs = 24 * 60 * 60 * 1000;
+
+const char* const c_modules[] = {
+    "C:\\Program Files\\Microsoft\\Edge\\msedge.dll",
+    "C:\\Windows\\System32\\DriverStore\\nvwgf2umx.dll",
+    "C:\\Windows\\System32\\ntdll.dll",
+    "C:\\Users\\user\\AppData\\Local\\WidevineCdm\\Widevine.dll",
+    "C:\\Windows\\System32\\D3D11.DLL",
+    "",
+};
+
+double GetElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+FailureLog::Failure MakeFailure(int i, std::mt19937& random)
+{
+    FailureLog::Failure failure;
+    failure.timeMs = c_startMs + i * c_intervalMs;
+    failure.kind = static_cast<int32_t>(random() % 5);
+    failure.reason = static_cast<int32_t>(random() % 3);
+    failure.exitCode = -1073741819 + static_cast<int32_t>(random() % 2);
+    failure.module = c_modules[random() % std::size(c_modules)];
+    failure.description = "renderer";
+    return failure;
+}
+
+// Counts the modules of the last `recordCount` of the `count` failures, since
+// `sinceMs`, as GetTopModules should.
+std::map<std::string, uint64_t> CountModules(int count, uint64_t recordCount, int64_t sinceMs)
+{
+    std::map<std::string, uint64_t> counts;
+    std::mt19937 random(1);
+    for (int i = 0; i < count; i++)
+    {
+        FailureLog::Failure failure = MakeFailure(i, random);
+        if (uint64_t(count - i) <= recordCount && failure.timeMs >= sinceMs &&
+            !failure.module.empty())
+        {
+            counts[FailureLog::GetModuleName(failure.module)]++;
+        }
+    }
+    return counts;
+}
+
+bool Run(const std::filesystem::path& path, int count, uint64_t maxFileSize)
+{
+    std::filesystem::path previousPath = path;
+    previousPath += ".1";
+    std::filesystem::remove(path);
+    std::filesystem::remove(previousPath);
+
+    int flushes = 0;
+    uint64_t rotations = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        FailureLog log(path, maxFileSize);
+        std::mt19937 random(1);
+        for (int i = 0; i < count; i++)
+        {
+            FailureLog::Failure failure = MakeFailure(i, random);
+            log.Append(failure);
+            if (log.ShouldFlush(failure.timeMs))
+            {
+                if (!log.Flush())
+                {
+                    std::fprintf(stderr, "Flush failed.\n");
+                    return false;
+                }
+                flushes++;
+            }
+        }
+        log.Flush();
+        rotations = log.GetRotationCount();
+    }
+    double appendMs = GetElapsedMs(start);
+
+    // A record torn by a crash, which opening drops.
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write("\x30\0\0\0torn", 8);
+    }
+    start = std::chrono::steady_clock::now();
+    FailureLog log(path, maxFileSize);
+    double loadMs = GetElapsedMs(start);
+
+    int64_t nowMs = c_startMs + int64_t(count) * c_intervalMs;
+    constexpr int c_queryCount = 1000;
+    std::vector<FailureLog::ModuleCount> top;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < c_queryCount; i++)
+    {
+        top = log.GetTopModules(nowMs - c_dayMs - i, 5);
+    }
+    double queryMs = GetElapsedMs(start) / c_queryCount;
+
+    std::error_code error;
+    uint64_t previousSize = std::filesystem::file_size(previousPath, error);
+    uint64_t size = std::filesystem::file_size(path);
+    std::printf(
+        "%9d %10.0f %8d %6llu %10llu %10llu %9llu %8.0f %10.3f\n", count,
+        appendMs * 1e6 / count, flushes, static_cast<unsigned long long>(rotations),
+        static_cast<unsigned long long>(error ? 0 : previousSize),
+        static_cast<unsigned long long>(size),
+        static_cast<unsigned long long>(log.GetRecordCount()), loadMs, queryMs);
+
+    bool passed = true;
+    if (rotations == 0 && log.GetRecordCount() != uint64_t(count))
+    {
+        std::fprintf(
+            stderr, "Opening read %llu records.\n",
+            static_cast<unsigned long long>(log.GetRecordCount()));
+        passed = false;
+    }
+    if (size > maxFileSize || (!error && previousSize > maxFileSize))
+    {
+        std::fprintf(stderr, "The log is over its cap.\n");
+        passed = false;
+    }
+    std::map<std::string, uint64_t> expected =
+        CountModules(count, log.GetRecordCount(), nowMs - c_dayMs - (c_queryCount - 1));
+    for (const FailureLog::ModuleCount& module : top)
+    {
+        if (expected[module.module] != module.count)
+        {
+            std::fprintf(stderr, "Wrong count for %s.\n", module.module.c_str());
+            passed = false;
+        }
+    }
+
+    // Records appended after opening follow the last intact one.
+    FailureLog::Failure failure;
+    failure.timeMs = nowMs;
+    failure.module = "X.dll";
+    log.Append(failure);
+    log.Flush();
+    uint64_t recordCount = log.GetRecordCount();
+    uint64_t reopenedCount = FailureLog(path, maxFileSize).GetRecordCount();
+    if (log.GetRotationCount() == 0 && reopenedCount != recordCount)
+    {
+        std::fprintf(stderr, "The record appended after opening was lost.\n");
+        passed = false;
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(previousPath);
+    return passed;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "FailureLogBench.log";
+    std::printf(
+        "%9s %10s %8s %6s %10s %10s %9s %8s %10s\n", "records", "append ns", "flushes",
+        "rotate", "previous", "current", "loaded", "load ms", "query ms");
+    // Without a cap, then with generations of about a quarter of the records,
+    // or c_maxFileSize if that is smaller.
+    uint64_t cap = (std::min)(FailureLog::c_maxFileSize, uint64_t(count) * 12);
+    bool passed = Run(path, count, UINT64_MAX) && Run(path, count, cap);
+    return passed ? 0 : 1;
+}
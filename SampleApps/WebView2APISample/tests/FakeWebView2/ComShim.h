@@ -0,0 +1,288 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// The subset of COM, WRL and WIL that the sample's components use, so code
+// written like theirs builds without the Windows SDK. Interfaces derive
+// virtually from IUnknown and QueryInterface is replaced by dynamic_cast in
+// com_ptr::try_query. Strings returned through LPWSTR* are allocated with
+// CoTaskMemAlloc, as the WebView2 runtime does.
+
+using HRESULT = int32_t;
+using BOOL = int;
+using UINT = unsigned int;
+using UINT32 = uint32_t;
+using UINT64 = uint64_t;
+using INT64 = int64_t;
+using LPWSTR = wchar_t*;
+using LPCWSTR = const wchar_t*;
+
+constexpr BOOL TRUE = 1;
+constexpr BOOL FALSE = 0;
+
+constexpr HRESULT S_OK = 0;
+constexpr HRESULT S_FALSE = 1;
+constexpr HRESULT E_NOTIMPL = static_cast<HRESULT>(0x80004001);
+constexpr HRESULT E_NOINTERFACE = static_cast<HRESULT>(0x80004002);
+constexpr HRESULT E_POINTER = static_cast<HRESULT>(0x80004003);
+constexpr HRESULT E_FAIL = static_cast<HRESULT>(0x80004005);
+constexpr HRESULT E_UNEXPECTED = static_cast<HRESULT>(0x8000FFFF);
+constexpr HRESULT E_INVALIDARG = static_cast<HRESULT>(0x80070057);
+
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+
+// Like the sample's CHECK_FAILURE, fails fast, but reports to stderr.
+#define CHECK_FAILURE_FILE_LINE(file, line)                                                    \
+    ([](HRESULT hr)                                                                            \
+     {                                                                                         \
+         if (FAILED(hr))                                                                       \
+         {                                                                                     \
+             std::fprintf(stderr, "Failure 0x%08X at %s(%d)\n", static_cast<unsigned>(hr),  \
+                          file, line);                                                         \
+             std::abort();                                                                     \
+         }                                                                                     \
+     })
+#define CHECK_FAILURE CHECK_FAILURE_FILE_LINE(__FILE__, __LINE__)
+
+struct EventRegistrationToken
+{
+    int64_t value;
+};
+
+inline void* CoTaskMemAlloc(size_t size)
+{
+    return std::malloc(size);
+}
+
+inline void CoTaskMemFree(void* memory)
+{
+    std::free(memory);
+}
+
+// Returns a copy of `text` allocated with CoTaskMemAlloc in `result`.
+inline HRESULT CoTaskMemDuplicate(std::wstring_view text, LPWSTR* result)
+{
+    if (!result)
+    {
+        return E_POINTER;
+    }
+    *result = static_cast<LPWSTR>(CoTaskMemAlloc((text.size() + 1) * sizeof(wchar_t)));
+    std::memcpy(*result, text.data(), text.size() * sizeof(wchar_t));
+    (*result)[text.size()] = L'\0';
+    return S_OK;
+}
+
+// Converts between UTF-8 and wchar_t strings, which are UTF-16 on Windows and
+// UTF-32 elsewhere. Invalid input is replaced by U+FFFD.
+std::string ToUtf8(std::wstring_view text);
+std::wstring ToUtf16(std::string_view text);
+
+struct IUnknown
+{
+    virtual unsigned long AddRef() = 0;
+    virtual unsigned long Release() = 0;
+
+protected:
+    virtual ~IUnknown() = default;
+};
+
+namespace wil
+{
+template <typename T> class com_ptr
+{
+public:
+    com_ptr() = default;
+    com_ptr(std::nullptr_t)
+    {
+    }
+    com_ptr(T* pointer) : m_pointer(pointer)
+    {
+        if (m_pointer)
+        {
+            m_pointer->AddRef();
+        }
+    }
+    com_ptr(const com_ptr& other) : com_ptr(other.m_pointer)
+    {
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    com_ptr(const com_ptr<U>& other) : com_ptr(other.get())
+    {
+    }
+    com_ptr(com_ptr&& other) noexcept : m_pointer(std::exchange(other.m_pointer, nullptr))
+    {
+    }
+    com_ptr& operator=(com_ptr other) noexcept
+    {
+        std::swap(m_pointer, other.m_pointer);
+        return *this;
+    }
+    ~com_ptr()
+    {
+        reset();
+    }
+
+    T* get() const
+    {
+        return m_pointer;
+    }
+    T* Get() const
+    {
+        return m_pointer;
+    }
+    T* operator->() const
+    {
+        return m_pointer;
+    }
+    explicit operator bool() const
+    {
+        return m_pointer != nullptr;
+    }
+    void reset()
+    {
+        if (T* pointer = std::exchange(m_pointer, nullptr))
+        {
+            pointer->Release();
+        }
+    }
+    // Releases the pointer for an out parameter to fill.
+    T** put()
+    {
+        reset();
+        return &m_pointer;
+    }
+    T** operator&()
+    {
+        return put();
+    }
+    template <typename U> void copy_to(U** result) const
+    {
+        *result = m_pointer;
+        if (m_pointer)
+        {
+            m_pointer->AddRef();
+        }
+    }
+    // The pointer as interface `U`, or null if the object doesn't implement it.
+    template <typename U> com_ptr<U> try_query() const
+    {
+        return com_ptr<U>(dynamic_cast<U*>(m_pointer));
+    }
+
+private:
+    T* m_pointer = nullptr;
+};
+
+class unique_cotaskmem_string
+{
+public:
+    unique_cotaskmem_string() = default;
+    unique_cotaskmem_string(const unique_cotaskmem_string&) = delete;
+    unique_cotaskmem_string& operator=(const unique_cotaskmem_string&) = delete;
+    ~unique_cotaskmem_string()
+    {
+        reset();
+    }
+
+    LPWSTR get() const
+    {
+        return m_string;
+    }
+    void reset()
+    {
+        CoTaskMemFree(std::exchange(m_string, nullptr));
+    }
+    LPWSTR* put()
+    {
+        reset();
+        return &m_string;
+    }
+    LPWSTR* operator&()
+    {
+        return put();
+    }
+
+private:
+    LPWSTR m_string = nullptr;
+};
+} // namespace wil
+
+namespace Microsoft
+{
+namespace WRL
+{
+template <typename T> using ComPtr = wil::com_ptr<T>;
+
+// Implements the reference counting of `Interfaces`. Objects start with no
+// references; Make returns the first.
+template <typename... Interfaces> class RuntimeClass : public Interfaces...
+{
+public:
+    unsigned long AddRef() override
+    {
+        return ++m_refCount;
+    }
+    unsigned long Release() override
+    {
+        unsigned long refCount = --m_refCount;
+        if (refCount == 0)
+        {
+            delete this;
+        }
+        return refCount;
+    }
+
+private:
+    std::atomic<unsigned long> m_refCount{0};
+};
+
+template <typename T, typename... Args> ComPtr<T> Make(Args&&... args)
+{
+    return ComPtr<T>(new T(std::forward<Args>(args)...));
+}
+
+namespace Details
+{
+template <typename TDelegate, typename TInvoke> struct CallbackTraits;
+
+template <typename TDelegate, typename... Args>
+struct CallbackTraits<TDelegate, HRESULT (TDelegate::*)(Args...)>
+{
+    template <typename TCallback> class Implementation : public RuntimeClass<TDelegate>
+    {
+    public:
+        explicit Implementation(TCallback callback) : m_callback(std::move(callback))
+        {
+        }
+        HRESULT Invoke(Args... args) override
+        {
+            return m_callback(args...);
+        }
+
+    private:
+        TCallback m_callback;
+    };
+};
+} // namespace Details
+
+// Wraps `callback` in an object implementing the handler interface TDelegate.
+template <typename TDelegate, typename TCallback> ComPtr<TDelegate> Callback(TCallback callback)
+{
+    using Traits = Details::CallbackTraits<TDelegate, decltype(&TDelegate::Invoke)>;
+    return Make<typename Traits::template Implementation<TCallback>>(std::move(callback));
+}
+} // namespace WRL
+} // namespace Microsoft
@@ -0,0 +1,823 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FakeWebView2.h"
+
+#include <algorithm>
+
+using Microsoft::WRL::Make;
+using Microsoft::WRL::RuntimeClass;
+
+namespace
+{
+int s_owner = 0;
+FakeDispatchObserver* s_observer = nullptr;
+
+constexpr char32_t c_replacementCharacter = 0xFFFD;
+
+void AppendUtf8(std::string& result, char32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        result.push_back(static_cast<char>(codePoint));
+    }
+    else if (codePoint < 0x800)
+    {
+        result.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+        result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    else if (codePoint < 0x10000)
+    {
+        result.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+        result.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+    else
+    {
+        result.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+        result.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+void AppendWide(std::wstring& result, char32_t codePoint)
+{
+    if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+    {
+        codePoint -= 0x10000;
+        result.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+        result.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+    }
+    else
+    {
+        result.push_back(static_cast<wchar_t>(codePoint));
+    }
+}
+
+bool IsSurrogate(char32_t codePoint)
+{
+    return codePoint >= 0xD800 && codePoint <= 0xDFFF;
+}
+
+// Matches `text` against `pattern`, where '*' matches any run of characters,
+// as the runtime matches WebResourceRequested filters.
+bool MatchesWildcard(std::wstring_view pattern, std::wstring_view text)
+{
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::wstring_view::npos;
+    size_t starText = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && pattern[p] == L'*')
+        {
+            star = p++;
+            starText = t;
+        }
+        else if (p < pattern.size() && pattern[p] == text[t])
+        {
+            p++;
+            t++;
+        }
+        else if (star != std::wstring_view::npos)
+        {
+            p = star + 1;
+            t = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == L'*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+class NavigationStartingEventArgs
+    : public RuntimeClass<ICoreWebView2NavigationStartingEventArgs>
+{
+public:
+    NavigationStartingEventArgs(
+        const std::wstring& uri, UINT64 navigationId, bool isUserInitiated, bool isRedirected)
+        : m_uri(uri), m_navigationId(navigationId), m_isUserInitiated(isUserInitiated),
+          m_isRedirected(isRedirected)
+    {
+    }
+    HRESULT get_Uri(LPWSTR* uri) override
+    {
+        return CoTaskMemDuplicate(m_uri, uri);
+    }
+    HRESULT get_IsUserInitiated(BOOL* isUserInitiated) override
+    {
+        *isUserInitiated = m_isUserInitiated;
+        return S_OK;
+    }
+    HRESULT get_IsRedirected(BOOL* isRedirected) override
+    {
+        *isRedirected = m_isRedirected;
+        return S_OK;
+    }
+    HRESULT get_Cancel(BOOL* cancel) override
+    {
+        *cancel = m_cancel;
+        return S_OK;
+    }
+    HRESULT put_Cancel(BOOL cancel) override
+    {
+        m_cancel = cancel;
+        return S_OK;
+    }
+    HRESULT get_NavigationId(UINT64* navigationId) override
+    {
+        *navigationId = m_navigationId;
+        return S_OK;
+    }
+
+private:
+    std::wstring m_uri;
+    UINT64 m_navigationId;
+    BOOL m_isUserInitiated;
+    BOOL m_isRedirected;
+    BOOL m_cancel = FALSE;
+};
+
+class ContentLoadingEventArgs : public RuntimeClass<ICoreWebView2ContentLoadingEventArgs>
+{
+public:
+    ContentLoadingEventArgs(UINT64 navigationId, bool isErrorPage)
+        : m_navigationId(navigationId), m_isErrorPage(isErrorPage)
+    {
+    }
+    HRESULT get_IsErrorPage(BOOL* isErrorPage) override
+    {
+        *isErrorPage = m_isErrorPage;
+        return S_OK;
+    }
+    HRESULT get_NavigationId(UINT64* navigationId) override
+    {
+        *navigationId = m_navigationId;
+        return S_OK;
+    }
+
+private:
+    UINT64 m_navigationId;
+    BOOL m_isErrorPage;
+};
+
+class DOMContentLoadedEventArgs : public RuntimeClass<ICoreWebView2DOMContentLoadedEventArgs>
+{
+public:
+    explicit DOMContentLoadedEventArgs(UINT64 navigationId) : m_navigationId(navigationId)
+    {
+    }
+    HRESULT get_NavigationId(UINT64* navigationId) override
+    {
+        *navigationId = m_navigationId;
+        return S_OK;
+    }
+
+private:
+    UINT64 m_navigationId;
+};
+
+class NavigationCompletedEventArgs
+    : public RuntimeClass<ICoreWebView2NavigationCompletedEventArgs>
+{
+public:
+    NavigationCompletedEventArgs(
+        UINT64 navigationId, bool isSuccess, COREWEBVIEW2_WEB_ERROR_STATUS status)
+        : m_navigationId(navigationId), m_isSuccess(isSuccess), m_status(status)
+    {
+    }
+    HRESULT get_IsSuccess(BOOL* isSuccess) override
+    {
+        *isSuccess = m_isSuccess;
+        return S_OK;
+    }
+    HRESULT get_WebErrorStatus(COREWEBVIEW2_WEB_ERROR_STATUS* webErrorStatus) override
+    {
+        *webErrorStatus = m_status;
+        return S_OK;
+    }
+    HRESULT get_NavigationId(UINT64* navigationId) override
+    {
+        *navigationId = m_navigationId;
+        return S_OK;
+    }
+
+private:
+    UINT64 m_navigationId;
+    BOOL m_isSuccess;
+    COREWEBVIEW2_WEB_ERROR_STATUS m_status;
+};
+
+class SourceChangedEventArgs : public RuntimeClass<ICoreWebView2SourceChangedEventArgs>
+{
+public:
+    explicit SourceChangedEventArgs(bool isNewDocument) : m_isNewDocument(isNewDocument)
+    {
+    }
+    HRESULT get_IsNewDocument(BOOL* isNewDocument) override
+    {
+        *isNewDocument = m_isNewDocument;
+        return S_OK;
+    }
+
+private:
+    BOOL m_isNewDocument;
+};
+
+class EmptyEventArgs : public RuntimeClass<IUnknown>
+{
+};
+
+class WebResourceRequest : public RuntimeClass<ICoreWebView2WebResourceRequest>
+{
+public:
+    WebResourceRequest(const std::wstring& uri, const std::wstring& method)
+        : m_uri(uri), m_method(method)
+    {
+    }
+    HRESULT get_Uri(LPWSTR* uri) override
+    {
+        return CoTaskMemDuplicate(m_uri, uri);
+    }
+    HRESULT get_Method(LPWSTR* method) override
+    {
+        return CoTaskMemDuplicate(m_method, method);
+    }
+
+private:
+    std::wstring m_uri;
+    std::wstring m_method;
+};
+
+class WebResourceRequestedEventArgs
+    : public RuntimeClass<ICoreWebView2WebResourceRequestedEventArgs>
+{
+public:
+    WebResourceRequestedEventArgs(
+        const std::wstring& uri, const std::wstring& method,
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context)
+        : m_request(Make<WebResourceRequest>(uri, method)), m_context(context)
+    {
+    }
+    HRESULT get_Request(ICoreWebView2WebResourceRequest** request) override
+    {
+        m_request.copy_to(request);
+        return S_OK;
+    }
+    HRESULT get_ResourceContext(COREWEBVIEW2_WEB_RESOURCE_CONTEXT* context) override
+    {
+        *context = m_context;
+        return S_OK;
+    }
+
+private:
+    wil::com_ptr<ICoreWebView2WebResourceRequest> m_request;
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT m_context;
+};
+
+class DevToolsProtocolEventReceivedEventArgs
+    : public RuntimeClass<ICoreWebView2DevToolsProtocolEventReceivedEventArgs>
+{
+public:
+    explicit DevToolsProtocolEventReceivedEventArgs(const std::wstring& parameterObjectAsJson)
+        : m_parameterObjectAsJson(parameterObjectAsJson)
+    {
+    }
+    HRESULT get_ParameterObjectAsJson(LPWSTR* parameterObjectAsJson) override
+    {
+        return CoTaskMemDuplicate(m_parameterObjectAsJson, parameterObjectAsJson);
+    }
+
+private:
+    std::wstring m_parameterObjectAsJson;
+};
+
+class FrameCreatedEventArgs : public RuntimeClass<ICoreWebView2FrameCreatedEventArgs>
+{
+public:
+    explicit FrameCreatedEventArgs(ICoreWebView2Frame* frame) : m_frame(frame)
+    {
+    }
+    HRESULT get_Frame(ICoreWebView2Frame** frame) override
+    {
+        m_frame.copy_to(frame);
+        return S_OK;
+    }
+
+private:
+    wil::com_ptr<ICoreWebView2Frame> m_frame;
+};
+
+class Cookie : public RuntimeClass<ICoreWebView2Cookie>
+{
+public:
+    explicit Cookie(const FakeCookieManager::Cookie& cookie) : m_cookie(cookie)
+    {
+    }
+    HRESULT get_Name(LPWSTR* name) override
+    {
+        return CoTaskMemDuplicate(m_cookie.name, name);
+    }
+    HRESULT get_Value(LPWSTR* value) override
+    {
+        return CoTaskMemDuplicate(m_cookie.value, value);
+    }
+    HRESULT get_Domain(LPWSTR* domain) override
+    {
+        return CoTaskMemDuplicate(m_cookie.domain, domain);
+    }
+    HRESULT get_Path(LPWSTR* path) override
+    {
+        return CoTaskMemDuplicate(m_cookie.path, path);
+    }
+
+private:
+    FakeCookieManager::Cookie m_cookie;
+};
+
+class CookieList : public RuntimeClass<ICoreWebView2CookieList>
+{
+public:
+    explicit CookieList(std::vector<FakeCookieManager::Cookie> cookies)
+        : m_cookies(std::move(cookies))
+    {
+    }
+    HRESULT get_Count(UINT* count) override
+    {
+        *count = static_cast<UINT>(m_cookies.size());
+        return S_OK;
+    }
+    HRESULT GetValueAtIndex(UINT index, ICoreWebView2Cookie** cookie) override
+    {
+        if (index >= m_cookies.size())
+        {
+            return E_INVALIDARG;
+        }
+        Make<Cookie>(m_cookies[index]).copy_to(cookie);
+        return S_OK;
+    }
+
+private:
+    std::vector<FakeCookieManager::Cookie> m_cookies;
+};
+
+// Splits `uri` into its host and path, without a port or query.
+void SplitUri(std::wstring_view uri, std::wstring_view* host, std::wstring_view* path)
+{
+    size_t start = uri.find(L"://");
+    start = start == std::wstring_view::npos ? 0 : start + 3;
+    size_t end = uri.find_first_of(L"/?#", start);
+    std::wstring_view authority = uri.substr(start);
+    if (end != std::wstring_view::npos)
+    {
+        authority = authority.substr(0, end - start);
+    }
+    *host = authority.substr(0, authority.find(L':'));
+    if (end == std::wstring_view::npos || uri[end] != L'/')
+    {
+        *path = L"/";
+        return;
+    }
+    *path = uri.substr(end, uri.find_first_of(L"?#", end) - end);
+}
+
+bool DomainMatches(std::wstring_view domain, std::wstring_view host)
+{
+    if (!domain.empty() && domain[0] == L'.')
+    {
+        domain.remove_prefix(1);
+    }
+    if (host.size() < domain.size() ||
+        host.compare(host.size() - domain.size(), domain.size(), domain) != 0)
+    {
+        return false;
+    }
+    return host.size() == domain.size() || host[host.size() - domain.size() - 1] == L'.';
+}
+} // namespace
+
+std::string ToUtf8(std::wstring_view text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char32_t codePoint = static_cast<char32_t>(text[i]);
+        if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint < 0xDC00 &&
+            i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+        {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (text[++i] - 0xDC00);
+        }
+        else if (IsSurrogate(codePoint) || codePoint > 0x10FFFF)
+        {
+            codePoint = c_replacementCharacter;
+        }
+        AppendUtf8(result, codePoint);
+    }
+    return result;
+}
+
+std::wstring ToUtf16(std::string_view text)
+{
+    std::wstring result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size())
+    {
+        unsigned char lead = static_cast<unsigned char>(text[i]);
+        size_t length = lead < 0x80   ? 1
+                        : lead >= 0xF8 ? 0
+                        : lead >= 0xF0 ? 4
+                        : lead >= 0xE0 ? 3
+                        : lead >= 0xC0 ? 2
+                                       : 0;
+        char32_t codePoint = length == 1 ? lead : lead & (0x3F >> length);
+        bool valid = length > 0 && i + length <= text.size();
+        for (size_t k = 1; valid && k < length; k++)
+        {
+            unsigned char trail = static_cast<unsigned char>(text[i + k]);
+            valid = (trail & 0xC0) == 0x80;
+            codePoint = (codePoint << 6) | (trail & 0x3F);
+        }
+        if (!valid || IsSurrogate(codePoint) || codePoint > 0x10FFFF)
+        {
+            AppendWide(result, c_replacementCharacter);
+            i++;
+            continue;
+        }
+        AppendWide(result, codePoint);
+        i += length;
+    }
+    return result;
+}
+
+namespace FakeDispatch
+{
+void SetOwner(int owner)
+{
+    s_owner = owner;
+}
+
+int GetOwner()
+{
+    return s_owner;
+}
+
+void SetObserver(FakeDispatchObserver* observer)
+{
+    s_observer = observer;
+}
+
+FakeDispatchObserver* GetObserver()
+{
+    return s_observer;
+}
+} // namespace FakeDispatch
+
+void FakeCookieManager::SetCookie(const Cookie& cookie)
+{
+    for (Cookie& existing : m_cookies)
+    {
+        if (existing.name == cookie.name && existing.domain == cookie.domain &&
+            existing.path == cookie.path)
+        {
+            existing.value = cookie.value;
+            return;
+        }
+    }
+    m_cookies.push_back(cookie);
+}
+
+HRESULT FakeCookieManager::GetCookies(
+    LPCWSTR uri, ICoreWebView2GetCookiesCompletedHandler* handler)
+{
+    if (!handler)
+    {
+        return E_INVALIDARG;
+    }
+    std::vector<Cookie> cookies;
+    if (!uri || !*uri)
+    {
+        cookies = m_cookies;
+    }
+    else
+    {
+        std::wstring_view host;
+        std::wstring_view path;
+        SplitUri(uri, &host, &path);
+        for (const Cookie& cookie : m_cookies)
+        {
+            if (DomainMatches(cookie.domain, host) &&
+                path.compare(0, cookie.path.size(), cookie.path) == 0)
+            {
+                cookies.push_back(cookie);
+            }
+        }
+    }
+    wil::com_ptr<ICoreWebView2CookieList> list = Make<CookieList>(std::move(cookies));
+    handler->Invoke(S_OK, list.get());
+    return S_OK;
+}
+
+HRESULT FakeCookieManager::DeleteAllCookies()
+{
+    m_cookies.clear();
+    return S_OK;
+}
+
+FakeFrame::FakeFrame(std::wstring name, UINT32 id) : m_name(std::move(name)), m_id(id)
+{
+}
+
+HRESULT FakeFrame::get_Name(LPWSTR* name)
+{
+    return CoTaskMemDuplicate(m_name, name);
+}
+
+HRESULT FakeFrame::add_Destroyed(
+    ICoreWebView2FrameDestroyedEventHandler* handler, EventRegistrationToken* token)
+{
+    return m_destroyed.Add(handler, token);
+}
+
+HRESULT FakeFrame::remove_Destroyed(EventRegistrationToken token)
+{
+    return m_destroyed.Remove(token);
+}
+
+HRESULT FakeFrame::get_FrameId(UINT32* id)
+{
+    *id = m_id;
+    return S_OK;
+}
+
+void FakeFrame::RaiseDestroyed()
+{
+    if (m_isDestroyed)
+    {
+        return;
+    }
+    m_isDestroyed = true;
+    wil::com_ptr<IUnknown> args = Make<EmptyEventArgs>();
+    m_destroyed.Raise(static_cast<ICoreWebView2Frame*>(this), args.get());
+}
+
+// The receiver of one DevTools Protocol event.
+class FakeWebView2::DevToolsReceiver
+    : public RuntimeClass<ICoreWebView2DevToolsProtocolEventReceiver>
+{
+public:
+    HRESULT add_DevToolsProtocolEventReceived(
+        ICoreWebView2DevToolsProtocolEventReceivedEventHandler* handler,
+        EventRegistrationToken* token) override
+    {
+        return m_received.Add(handler, token);
+    }
+    HRESULT remove_DevToolsProtocolEventReceived(EventRegistrationToken token) override
+    {
+        return m_received.Remove(token);
+    }
+
+    FakeEvent<ICoreWebView2DevToolsProtocolEventReceivedEventHandler> m_received;
+};
+
+FakeWebView2::FakeWebView2() : m_cookieManager(Make<FakeCookieManager>())
+{
+}
+
+bool FakeWebView2::RaiseNavigationStarting(
+    const std::wstring& uri, UINT64 navigationId, bool isFrame, bool isUserInitiated,
+    bool isRedirected)
+{
+    auto args =
+        Make<NavigationStartingEventArgs>(uri, navigationId, isUserInitiated, isRedirected);
+    (isFrame ? m_frameNavigationStarting : m_navigationStarting)
+        .Raise(static_cast<ICoreWebView2*>(this), args.get());
+    BOOL cancel = FALSE;
+    args->get_Cancel(&cancel);
+    return cancel;
+}
+
+void FakeWebView2::RaiseContentLoading(UINT64 navigationId, bool isErrorPage)
+{
+    auto args = Make<ContentLoadingEventArgs>(navigationId, isErrorPage);
+    m_contentLoading.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+void FakeWebView2::RaiseDOMContentLoaded(UINT64 navigationId)
+{
+    auto args = Make<DOMContentLoadedEventArgs>(navigationId);
+    m_domContentLoaded.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+void FakeWebView2::RaiseNavigationCompleted(
+    UINT64 navigationId, bool isSuccess, bool isFrame, COREWEBVIEW2_WEB_ERROR_STATUS status)
+{
+    auto args = Make<NavigationCompletedEventArgs>(navigationId, isSuccess, status);
+    (isFrame ? m_frameNavigationCompleted : m_navigationCompleted)
+        .Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+void FakeWebView2::RaiseSourceChanged(const std::wstring& uri, bool isNewDocument)
+{
+    m_source = uri;
+    auto args = Make<SourceChangedEventArgs>(isNewDocument);
+    m_sourceChanged.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+void FakeWebView2::RaiseHistoryChanged(bool canGoBack, bool canGoForward)
+{
+    m_canGoBack = canGoBack;
+    m_canGoForward = canGoForward;
+    wil::com_ptr<IUnknown> args = Make<EmptyEventArgs>();
+    m_historyChanged.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+void FakeWebView2::RaiseDocumentTitleChanged(const std::wstring& title)
+{
+    m_documentTitle = title;
+    wil::com_ptr<IUnknown> args = Make<EmptyEventArgs>();
+    m_documentTitleChanged.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+bool FakeWebView2::RaiseWebResourceRequested(
+    const std::wstring& uri, const std::wstring& method,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT context)
+{
+    bool filtered = std::any_of(
+        m_filters.begin(), m_filters.end(),
+        [&](const Filter& filter)
+        {
+            return (filter.context == COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL ||
+                    filter.context == context) &&
+                   MatchesWildcard(filter.uri, uri);
+        });
+    if (!filtered)
+    {
+        return false;
+    }
+    auto args = Make<WebResourceRequestedEventArgs>(uri, method, context);
+    m_webResourceRequested.Raise(static_cast<ICoreWebView2*>(this), args.get());
+    return true;
+}
+
+void FakeWebView2::RaiseDevToolsProtocolEvent(
+    const std::wstring& eventName, const std::wstring& parameterObjectAsJson)
+{
+    auto receiver = m_devToolsReceivers.find(eventName);
+    if (receiver == m_devToolsReceivers.end())
+    {
+        return;
+    }
+    auto args = Make<DevToolsProtocolEventReceivedEventArgs>(parameterObjectAsJson);
+    receiver->second->m_received.Raise(static_cast<ICoreWebView2*>(this), args.get());
+}
+
+wil::com_ptr<FakeFrame> FakeWebView2::CreateFrame(const std::wstring& name, UINT32 id)
+{
+    wil::com_ptr<FakeFrame> frame = Make<FakeFrame>(name, id);
+    auto args = Make<FrameCreatedEventArgs>(frame.get());
+    m_frameCreated.Raise(static_cast<ICoreWebView2*>(this), args.get());
+    return frame;
+}
+
+size_t FakeWebView2::GetHandlerCount() const
+{
+    size_t count = m_navigationStarting.GetHandlerCount() +
+                   m_contentLoading.GetHandlerCount() + m_sourceChanged.GetHandlerCount() +
+                   m_historyChanged.GetHandlerCount() +
+                   m_navigationCompleted.GetHandlerCount() +
+                   m_frameNavigationStarting.GetHandlerCount() +
+                   m_frameNavigationCompleted.GetHandlerCount() +
+                   m_documentTitleChanged.GetHandlerCount() +
+                   m_webResourceRequested.GetHandlerCount() +
+                   m_domContentLoaded.GetHandlerCount() + m_frameCreated.GetHandlerCount();
+    for (const auto& receiver : m_devToolsReceivers)
+    {
+        count += receiver.second->m_received.GetHandlerCount();
+    }
+    return count;
+}
+
+HRESULT FakeWebView2::get_Source(LPWSTR* uri)
+{
+    return CoTaskMemDuplicate(m_source, uri);
+}
+
+HRESULT FakeWebView2::get_DocumentTitle(LPWSTR* title)
+{
+    return CoTaskMemDuplicate(m_documentTitle, title);
+}
+
+HRESULT FakeWebView2::get_CanGoBack(BOOL* canGoBack)
+{
+    *canGoBack = m_canGoBack;
+    return S_OK;
+}
+
+HRESULT FakeWebView2::get_CanGoForward(BOOL* canGoForward)
+{
+    *canGoForward = m_canGoForward;
+    return S_OK;
+}
+
+#define FAKE_WEBVIEW2_EVENT_METHODS(name, handler, member)                                     \
+    HRESULT FakeWebView2::add_##name(handler* eventHandler, EventRegistrationToken* token)    \
+    {                                                                                          \
+        return member.Add(eventHandler, token);                                                \
+    }                                                                                          \
+    HRESULT FakeWebView2::remove_##name(EventRegistrationToken token)                          \
+    {                                                                                          \
+        return member.Remove(token);                                                           \
+    }
+
+FAKE_WEBVIEW2_EVENT_METHODS(
+    NavigationStarting, ICoreWebView2NavigationStartingEventHandler, m_navigationStarting)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    ContentLoading, ICoreWebView2ContentLoadingEventHandler, m_contentLoading)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    SourceChanged, ICoreWebView2SourceChangedEventHandler, m_sourceChanged)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    HistoryChanged, ICoreWebView2HistoryChangedEventHandler, m_historyChanged)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    NavigationCompleted, ICoreWebView2NavigationCompletedEventHandler, m_navigationCompleted)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    FrameNavigationStarting, ICoreWebView2NavigationStartingEventHandler,
+    m_frameNavigationStarting)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    FrameNavigationCompleted, ICoreWebView2NavigationCompletedEventHandler,
+    m_frameNavigationCompleted)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    DocumentTitleChanged, ICoreWebView2DocumentTitleChangedEventHandler,
+    m_documentTitleChanged)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    WebResourceRequested, ICoreWebView2WebResourceRequestedEventHandler,
+    m_webResourceRequested)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    DOMContentLoaded, ICoreWebView2DOMContentLoadedEventHandler, m_domContentLoaded)
+FAKE_WEBVIEW2_EVENT_METHODS(
+    FrameCreated, ICoreWebView2FrameCreatedEventHandler, m_frameCreated)
+
+#undef FAKE_WEBVIEW2_EVENT_METHODS
+
+HRESULT FakeWebView2::AddWebResourceRequestedFilter(
+    LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext)
+{
+    if (!uri)
+    {
+        return E_INVALIDARG;
+    }
+    m_filters.push_back({uri, resourceContext});
+    return S_OK;
+}
+
+HRESULT FakeWebView2::RemoveWebResourceRequestedFilter(
+    LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext)
+{
+    auto filter = std::find_if(
+        m_filters.begin(), m_filters.end(), [&](const Filter& filter)
+        { return filter.uri == uri && filter.context == resourceContext; });
+    if (filter == m_filters.end())
+    {
+        return E_INVALIDARG;
+    }
+    m_filters.erase(filter);
+    return S_OK;
+}
+
+HRESULT FakeWebView2::GetDevToolsProtocolEventReceiver(
+    LPCWSTR eventName, ICoreWebView2DevToolsProtocolEventReceiver** receiver)
+{
+    if (!eventName || !receiver)
+    {
+        return E_INVALIDARG;
+    }
+    wil::com_ptr<DevToolsReceiver>& existing = m_devToolsReceivers[eventName];
+    if (!existing)
+    {
+        existing = Make<DevToolsReceiver>();
+    }
+    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver>(existing.get()).copy_to(receiver);
+    return S_OK;
+}
+
+HRESULT FakeWebView2::get_CookieManager(ICoreWebView2CookieManager** cookieManager)
+{
+    wil::com_ptr<ICoreWebView2CookieManager>(m_cookieManager.get()).copy_to(cookieManager);
+    return S_OK;
+}
+
+HRESULT FakeWebView2::get_FrameId(UINT32* id)
+{
+    // The runtime numbers frames from 1; the main frame is the first.
+    *id = 1;
+    return S_OK;
+}
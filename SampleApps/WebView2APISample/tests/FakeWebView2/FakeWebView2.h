@@ -0,0 +1,509 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ComShim.h"
+
+// A headless stand-in for the WebView2 runtime. It declares the members of the
+// WebView2 interfaces that the sample's components use, with the same names
+// and signatures, and implements them with a fake WebView whose events are
+// raised by the test or replay driver instead of by a browser.
+//
+// Versions of an interface whose members aren't faked are left out, so each
+// faked version derives from the previous faked one.
+
+enum COREWEBVIEW2_WEB_ERROR_STATUS
+{
+    COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN = 0,
+    COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE = 6,
+    COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT = 7,
+    COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED = 9,
+    COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED = 11,
+    COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED = 14,
+};
+
+enum COREWEBVIEW2_WEB_RESOURCE_CONTEXT
+{
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL = 0,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT = 1,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_STYLESHEET = 2,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE = 3,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MEDIA = 4,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FONT = 5,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT = 6,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_XML_HTTP_REQUEST = 7,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FETCH = 8,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_OTHER = 16,
+};
+
+struct ICoreWebView2;
+struct ICoreWebView2Frame;
+
+struct ICoreWebView2NavigationStartingEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_Uri(LPWSTR* uri) = 0;
+    virtual HRESULT get_IsUserInitiated(BOOL* isUserInitiated) = 0;
+    virtual HRESULT get_IsRedirected(BOOL* isRedirected) = 0;
+    virtual HRESULT get_Cancel(BOOL* cancel) = 0;
+    virtual HRESULT put_Cancel(BOOL cancel) = 0;
+    virtual HRESULT get_NavigationId(UINT64* navigationId) = 0;
+};
+
+struct ICoreWebView2ContentLoadingEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_IsErrorPage(BOOL* isErrorPage) = 0;
+    virtual HRESULT get_NavigationId(UINT64* navigationId) = 0;
+};
+
+struct ICoreWebView2DOMContentLoadedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_NavigationId(UINT64* navigationId) = 0;
+};
+
+struct ICoreWebView2NavigationCompletedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_IsSuccess(BOOL* isSuccess) = 0;
+    virtual HRESULT get_WebErrorStatus(COREWEBVIEW2_WEB_ERROR_STATUS* webErrorStatus) = 0;
+    virtual HRESULT get_NavigationId(UINT64* navigationId) = 0;
+};
+
+struct ICoreWebView2SourceChangedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_IsNewDocument(BOOL* isNewDocument) = 0;
+};
+
+struct ICoreWebView2WebResourceRequest : virtual IUnknown
+{
+    virtual HRESULT get_Uri(LPWSTR* uri) = 0;
+    virtual HRESULT get_Method(LPWSTR* method) = 0;
+};
+
+struct ICoreWebView2WebResourceRequestedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_Request(ICoreWebView2WebResourceRequest** request) = 0;
+    virtual HRESULT get_ResourceContext(COREWEBVIEW2_WEB_RESOURCE_CONTEXT* context) = 0;
+};
+
+struct ICoreWebView2DevToolsProtocolEventReceivedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_ParameterObjectAsJson(LPWSTR* parameterObjectAsJson) = 0;
+};
+
+struct ICoreWebView2FrameCreatedEventArgs : virtual IUnknown
+{
+    virtual HRESULT get_Frame(ICoreWebView2Frame** frame) = 0;
+};
+
+struct ICoreWebView2Cookie : virtual IUnknown
+{
+    virtual HRESULT get_Name(LPWSTR* name) = 0;
+    virtual HRESULT get_Value(LPWSTR* value) = 0;
+    virtual HRESULT get_Domain(LPWSTR* domain) = 0;
+    virtual HRESULT get_Path(LPWSTR* path) = 0;
+};
+
+struct ICoreWebView2CookieList : virtual IUnknown
+{
+    virtual HRESULT get_Count(UINT* count) = 0;
+    virtual HRESULT GetValueAtIndex(UINT index, ICoreWebView2Cookie** cookie) = 0;
+};
+
+#define FAKE_WEBVIEW2_HANDLER(name, ...)                                                       \
+    struct name : virtual IUnknown                                                             \
+    {                                                                                          \
+        virtual HRESULT Invoke(__VA_ARGS__) = 0;                                               \
+    }
+
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2NavigationStartingEventHandler, ICoreWebView2* sender,
+    ICoreWebView2NavigationStartingEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2ContentLoadingEventHandler, ICoreWebView2* sender,
+    ICoreWebView2ContentLoadingEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2DOMContentLoadedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2DOMContentLoadedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2NavigationCompletedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2NavigationCompletedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2SourceChangedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2SourceChangedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2HistoryChangedEventHandler, ICoreWebView2* sender, IUnknown* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2DocumentTitleChangedEventHandler, ICoreWebView2* sender, IUnknown* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2WebResourceRequestedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2WebResourceRequestedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2DevToolsProtocolEventReceivedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2FrameCreatedEventHandler, ICoreWebView2* sender,
+    ICoreWebView2FrameCreatedEventArgs* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2FrameDestroyedEventHandler, ICoreWebView2Frame* sender, IUnknown* args);
+FAKE_WEBVIEW2_HANDLER(
+    ICoreWebView2GetCookiesCompletedHandler, HRESULT result, ICoreWebView2CookieList* list);
+
+struct ICoreWebView2DevToolsProtocolEventReceiver : virtual IUnknown
+{
+    virtual HRESULT add_DevToolsProtocolEventReceived(
+        ICoreWebView2DevToolsProtocolEventReceivedEventHandler* handler,
+        EventRegistrationToken* token) = 0;
+    virtual HRESULT remove_DevToolsProtocolEventReceived(EventRegistrationToken token) = 0;
+};
+
+struct ICoreWebView2CookieManager : virtual IUnknown
+{
+    virtual HRESULT GetCookies(
+        LPCWSTR uri, ICoreWebView2GetCookiesCompletedHandler* handler) = 0;
+    virtual HRESULT DeleteAllCookies() = 0;
+};
+
+struct ICoreWebView2Frame : virtual IUnknown
+{
+    virtual HRESULT get_Name(LPWSTR* name) = 0;
+    virtual HRESULT add_Destroyed(
+        ICoreWebView2FrameDestroyedEventHandler* handler, EventRegistrationToken* token) = 0;
+    virtual HRESULT remove_Destroyed(EventRegistrationToken token) = 0;
+};
+
+struct ICoreWebView2Frame5 : ICoreWebView2Frame
+{
+    virtual HRESULT get_FrameId(UINT32* id) = 0;
+};
+
+#define FAKE_WEBVIEW2_EVENT(name, handler)                                                     \
+    virtual HRESULT add_##name(handler* eventHandler, EventRegistrationToken* token) = 0;      \
+    virtual HRESULT remove_##name(EventRegistrationToken token) = 0
+
+struct ICoreWebView2 : virtual IUnknown
+{
+    virtual HRESULT get_Source(LPWSTR* uri) = 0;
+    virtual HRESULT get_DocumentTitle(LPWSTR* title) = 0;
+    virtual HRESULT get_CanGoBack(BOOL* canGoBack) = 0;
+    virtual HRESULT get_CanGoForward(BOOL* canGoForward) = 0;
+    FAKE_WEBVIEW2_EVENT(NavigationStarting, ICoreWebView2NavigationStartingEventHandler);
+    FAKE_WEBVIEW2_EVENT(ContentLoading, ICoreWebView2ContentLoadingEventHandler);
+    FAKE_WEBVIEW2_EVENT(SourceChanged, ICoreWebView2SourceChangedEventHandler);
+    FAKE_WEBVIEW2_EVENT(HistoryChanged, ICoreWebView2HistoryChangedEventHandler);
+    FAKE_WEBVIEW2_EVENT(NavigationCompleted, ICoreWebView2NavigationCompletedEventHandler);
+    FAKE_WEBVIEW2_EVENT(FrameNavigationStarting, ICoreWebView2NavigationStartingEventHandler);
+    FAKE_WEBVIEW2_EVENT(
+        FrameNavigationCompleted, ICoreWebView2NavigationCompletedEventHandler);
+    FAKE_WEBVIEW2_EVENT(DocumentTitleChanged, ICoreWebView2DocumentTitleChangedEventHandler);
+    FAKE_WEBVIEW2_EVENT(WebResourceRequested, ICoreWebView2WebResourceRequestedEventHandler);
+    virtual HRESULT AddWebResourceRequestedFilter(
+        LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext) = 0;
+    virtual HRESULT RemoveWebResourceRequestedFilter(
+        LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext) = 0;
+    virtual HRESULT GetDevToolsProtocolEventReceiver(
+        LPCWSTR eventName, ICoreWebView2DevToolsProtocolEventReceiver** receiver) = 0;
+};
+
+struct ICoreWebView2_2 : ICoreWebView2
+{
+    FAKE_WEBVIEW2_EVENT(DOMContentLoaded, ICoreWebView2DOMContentLoadedEventHandler);
+    virtual HRESULT get_CookieManager(ICoreWebView2CookieManager** cookieManager) = 0;
+};
+
+struct ICoreWebView2_4 : ICoreWebView2_2
+{
+    FAKE_WEBVIEW2_EVENT(FrameCreated, ICoreWebView2FrameCreatedEventHandler);
+};
+
+struct ICoreWebView2_20 : ICoreWebView2_4
+{
+    virtual HRESULT get_FrameId(UINT32* id) = 0;
+};
+
+#undef FAKE_WEBVIEW2_EVENT
+#undef FAKE_WEBVIEW2_HANDLER
+
+// Observes every handler the fake runtime invokes, to account for its cost to
+// the component that added it.
+class FakeDispatchObserver
+{
+public:
+    virtual void OnInvoking(int owner) = 0;
+    virtual void OnInvoked(int owner) = 0;
+
+protected:
+    ~FakeDispatchObserver() = default;
+};
+
+namespace FakeDispatch
+{
+// Handlers added from now on are owned by `owner`, which is passed to the
+// observer when they are invoked. 0 until set.
+void SetOwner(int owner);
+int GetOwner();
+// Null, the default, invokes handlers unobserved.
+void SetObserver(FakeDispatchObserver* observer);
+FakeDispatchObserver* GetObserver();
+} // namespace FakeDispatch
+
+// The handlers of one event, with the tokens that remove them.
+template <typename THandler> class FakeEvent
+{
+public:
+    HRESULT Add(THandler* handler, EventRegistrationToken* token)
+    {
+        if (!handler || !token)
+        {
+            return E_INVALIDARG;
+        }
+        token->value = ++m_lastToken;
+        m_handlers.push_back({token->value, FakeDispatch::GetOwner(), handler});
+        return S_OK;
+    }
+
+    HRESULT Remove(EventRegistrationToken token)
+    {
+        for (auto it = m_handlers.begin(); it != m_handlers.end(); ++it)
+        {
+            if (it->token == token.value)
+            {
+                m_handlers.erase(it);
+                break;
+            }
+        }
+        // Like the runtime, removing an unknown token isn't an error.
+        return S_OK;
+    }
+
+    // Invokes the handlers in the order they were added. Handlers added or
+    // removed by a handler take effect from the next Raise.
+    template <typename... Args> void Raise(Args... args)
+    {
+        if (m_handlers.empty())
+        {
+            return;
+        }
+        std::vector<Registration> handlers = m_handlers;
+        for (const Registration& registration : handlers)
+        {
+            InvokeObserved(registration.owner, [&] { registration.handler->Invoke(args...); });
+        }
+    }
+
+    size_t GetHandlerCount() const
+    {
+        return m_handlers.size();
+    }
+
+private:
+    struct Registration
+    {
+        int64_t token;
+        int owner;
+        wil::com_ptr<THandler> handler;
+    };
+
+    template <typename TInvoke> static void InvokeObserved(int owner, const TInvoke& invoke);
+
+    std::vector<Registration> m_handlers;
+    int64_t m_lastToken = 0;
+};
+
+template <typename THandler>
+template <typename TInvoke>
+void FakeEvent<THandler>::InvokeObserved(int owner, const TInvoke& invoke)
+{
+    FakeDispatchObserver* observer = FakeDispatch::GetObserver();
+    if (observer)
+    {
+        observer->OnInvoking(owner);
+    }
+    invoke();
+    if (observer)
+    {
+        observer->OnInvoked(owner);
+    }
+}
+
+class FakeCookieManager : public Microsoft::WRL::RuntimeClass<ICoreWebView2CookieManager>
+{
+public:
+    struct Cookie
+    {
+        std::wstring name;
+        std::wstring value;
+        std::wstring domain;
+        std::wstring path = L"/";
+    };
+
+    // Adds the cookie, or replaces the one with the same name, domain and path.
+    void SetCookie(const Cookie& cookie);
+    size_t GetCookieCount() const
+    {
+        return m_cookies.size();
+    }
+
+    // An empty `uri` gets every cookie, as it does in the runtime. Otherwise
+    // the cookies whose domain matches the host of `uri` and whose path
+    // prefixes its path. The handler is invoked before GetCookies returns.
+    HRESULT GetCookies(LPCWSTR uri, ICoreWebView2GetCookiesCompletedHandler* handler) override;
+    HRESULT DeleteAllCookies() override;
+
+private:
+    std::vector<Cookie> m_cookies;
+};
+
+class FakeFrame : public Microsoft::WRL::RuntimeClass<ICoreWebView2Frame5>
+{
+public:
+    FakeFrame(std::wstring name, UINT32 id);
+
+    HRESULT get_Name(LPWSTR* name) override;
+    HRESULT add_Destroyed(
+        ICoreWebView2FrameDestroyedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_Destroyed(EventRegistrationToken token) override;
+    HRESULT get_FrameId(UINT32* id) override;
+
+    // Raises Destroyed the first time only, as the runtime does.
+    void RaiseDestroyed();
+
+private:
+    std::wstring m_name;
+    UINT32 m_id;
+    bool m_isDestroyed = false;
+    FakeEvent<ICoreWebView2FrameDestroyedEventHandler> m_destroyed;
+};
+
+// A fake WebView. Its Raise methods update the state its getters report, then
+// raise the event as the runtime would. Not thread-safe.
+class FakeWebView2 : public Microsoft::WRL::RuntimeClass<ICoreWebView2_20>
+{
+public:
+    FakeWebView2();
+
+    // Returns true if a handler canceled the navigation.
+    bool RaiseNavigationStarting(
+        const std::wstring& uri, UINT64 navigationId, bool isFrame = false,
+        bool isUserInitiated = false, bool isRedirected = false);
+    void RaiseContentLoading(UINT64 navigationId, bool isErrorPage = false);
+    void RaiseDOMContentLoaded(UINT64 navigationId);
+    void RaiseNavigationCompleted(
+        UINT64 navigationId, bool isSuccess, bool isFrame = false,
+        COREWEBVIEW2_WEB_ERROR_STATUS status = COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN);
+    void RaiseSourceChanged(const std::wstring& uri, bool isNewDocument);
+    void RaiseHistoryChanged(bool canGoBack, bool canGoForward);
+    void RaiseDocumentTitleChanged(const std::wstring& title);
+    // Returns false, without raising the event, if no filter matches the
+    // request, as the runtime only raises it for filtered requests.
+    bool RaiseWebResourceRequested(
+        const std::wstring& uri, const std::wstring& method,
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context);
+    // Raises the event on the receiver of `eventName`, if one was requested.
+    void RaiseDevToolsProtocolEvent(
+        const std::wstring& eventName, const std::wstring& parameterObjectAsJson);
+    wil::com_ptr<FakeFrame> CreateFrame(const std::wstring& name, UINT32 id);
+
+    FakeCookieManager* GetFakeCookieManager() const
+    {
+        return m_cookieManager.get();
+    }
+    // The handlers of all events, including those of DevTools receivers.
+    size_t GetHandlerCount() const;
+    size_t GetWebResourceRequestedFilterCount() const
+    {
+        return m_filters.size();
+    }
+
+    // ICoreWebView2_20
+    HRESULT get_Source(LPWSTR* uri) override;
+    HRESULT get_DocumentTitle(LPWSTR* title) override;
+    HRESULT get_CanGoBack(BOOL* canGoBack) override;
+    HRESULT get_CanGoForward(BOOL* canGoForward) override;
+    HRESULT add_NavigationStarting(
+        ICoreWebView2NavigationStartingEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_NavigationStarting(EventRegistrationToken token) override;
+    HRESULT add_ContentLoading(
+        ICoreWebView2ContentLoadingEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_ContentLoading(EventRegistrationToken token) override;
+    HRESULT add_SourceChanged(
+        ICoreWebView2SourceChangedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_SourceChanged(EventRegistrationToken token) override;
+    HRESULT add_HistoryChanged(
+        ICoreWebView2HistoryChangedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_HistoryChanged(EventRegistrationToken token) override;
+    HRESULT add_NavigationCompleted(
+        ICoreWebView2NavigationCompletedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_NavigationCompleted(EventRegistrationToken token) override;
+    HRESULT add_FrameNavigationStarting(
+        ICoreWebView2NavigationStartingEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_FrameNavigationStarting(EventRegistrationToken token) override;
+    HRESULT add_FrameNavigationCompleted(
+        ICoreWebView2NavigationCompletedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_FrameNavigationCompleted(EventRegistrationToken token) override;
+    HRESULT add_DocumentTitleChanged(
+        ICoreWebView2DocumentTitleChangedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_DocumentTitleChanged(EventRegistrationToken token) override;
+    HRESULT add_WebResourceRequested(
+        ICoreWebView2WebResourceRequestedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_WebResourceRequested(EventRegistrationToken token) override;
+    HRESULT AddWebResourceRequestedFilter(
+        LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext) override;
+    HRESULT RemoveWebResourceRequestedFilter(
+        LPCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext) override;
+    HRESULT GetDevToolsProtocolEventReceiver(
+        LPCWSTR eventName, ICoreWebView2DevToolsProtocolEventReceiver** receiver) override;
+    HRESULT add_DOMContentLoaded(
+        ICoreWebView2DOMContentLoadedEventHandler* handler,
+        EventRegistrationToken* token) override;
+    HRESULT remove_DOMContentLoaded(EventRegistrationToken token) override;
+    HRESULT get_CookieManager(ICoreWebView2CookieManager** cookieManager) override;
+    HRESULT add_FrameCreated(
+        ICoreWebView2FrameCreatedEventHandler* handler, EventRegistrationToken* token) override;
+    HRESULT remove_FrameCreated(EventRegistrationToken token) override;
+    HRESULT get_FrameId(UINT32* id) override;
+
+private:
+    class DevToolsReceiver;
+
+    struct Filter
+    {
+        std::wstring uri;
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+    };
+
+    std::wstring m_source = L"about:blank";
+    std::wstring m_documentTitle;
+    bool m_canGoBack = false;
+    bool m_canGoForward = false;
+
+    FakeEvent<ICoreWebView2NavigationStartingEventHandler> m_navigationStarting;
+    FakeEvent<ICoreWebView2ContentLoadingEventHandler> m_contentLoading;
+    FakeEvent<ICoreWebView2SourceChangedEventHandler> m_sourceChanged;
+    FakeEvent<ICoreWebView2HistoryChangedEventHandler> m_historyChanged;
+    FakeEvent<ICoreWebView2NavigationCompletedEventHandler> m_navigationCompleted;
+    FakeEvent<ICoreWebView2NavigationStartingEventHandler> m_frameNavigationStarting;
+    FakeEvent<ICoreWebView2NavigationCompletedEventHandler> m_frameNavigationCompleted;
+    FakeEvent<ICoreWebView2DocumentTitleChangedEventHandler> m_documentTitleChanged;
+    FakeEvent<ICoreWebView2WebResourceRequestedEventHandler> m_webResourceRequested;
+    FakeEvent<ICoreWebView2DOMContentLoadedEventHandler> m_domContentLoaded;
+    FakeEvent<ICoreWebView2FrameCreatedEventHandler> m_frameCreated;
+
+    std::vector<Filter> m_filters;
+    std::map<std::wstring, wil::com_ptr<DevToolsReceiver>> m_devToolsReceivers;
+    wil::com_ptr<FakeCookieManager> m_cookieManager;
+};
@@ -0,0 +1,355 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FakeWebView2.h"
+#include "TestUtil.h"
+
+using Microsoft::WRL::Callback;
+using Microsoft::WRL::Make;
+
+namespace
+{
+void TestTokensRemoveTheirHandler()
+{
+    auto webView = Make<FakeWebView2>();
+    int first = 0;
+    int second = 0;
+    EventRegistrationToken firstToken;
+    EventRegistrationToken secondToken;
+    CHECK(SUCCEEDED(webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2ContentLoadingEventArgs*) -> HRESULT
+            {
+                first++;
+                return S_OK;
+            })
+            .Get(),
+        &firstToken)));
+    CHECK(SUCCEEDED(webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2ContentLoadingEventArgs*) -> HRESULT
+            {
+                second++;
+                return S_OK;
+            })
+            .Get(),
+        &secondToken)));
+    CHECK(firstToken.value != secondToken.value);
+
+    webView->RaiseContentLoading(1);
+    CHECK(first == 1 && second == 1);
+    CHECK(SUCCEEDED(webView->remove_ContentLoading(firstToken)));
+    // Removing twice, or a token of another event, isn't an error.
+    CHECK(SUCCEEDED(webView->remove_ContentLoading(firstToken)));
+    CHECK(SUCCEEDED(webView->remove_NavigationStarting(secondToken)));
+    webView->RaiseContentLoading(2);
+    CHECK(first == 1 && second == 2);
+    CHECK(webView->GetHandlerCount() == 1);
+    CHECK(webView->add_ContentLoading(nullptr, &firstToken) == E_INVALIDARG);
+}
+
+void TestRemoveDuringRaise()
+{
+    auto webView = Make<FakeWebView2>();
+    int invocations = 0;
+    EventRegistrationToken tokens[2];
+    for (EventRegistrationToken& token : tokens)
+    {
+        CHECK(SUCCEEDED(webView->add_HistoryChanged(
+            Callback<ICoreWebView2HistoryChangedEventHandler>(
+                [&](ICoreWebView2* sender, IUnknown*) -> HRESULT
+                {
+                    invocations++;
+                    // Each handler removes both; the second still runs this
+                    // time, as removals take effect from the next raise.
+                    for (const EventRegistrationToken& remove : tokens)
+                    {
+                        sender->remove_HistoryChanged(remove);
+                    }
+                    return S_OK;
+                })
+                .Get(),
+            &token)));
+    }
+    webView->RaiseHistoryChanged(true, false);
+    CHECK(invocations == 2);
+    webView->RaiseHistoryChanged(true, false);
+    CHECK(invocations == 2);
+    CHECK(webView->GetHandlerCount() == 0);
+
+    BOOL canGoBack = FALSE;
+    CHECK(SUCCEEDED(webView->get_CanGoBack(&canGoBack)));
+    CHECK(canGoBack);
+}
+
+void TestNavigationArgsAndState()
+{
+    auto webView = Make<FakeWebView2>();
+    std::wstring startingUri;
+    UINT64 completedId = 0;
+    COREWEBVIEW2_WEB_ERROR_STATUS status = COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN;
+    EventRegistrationToken token;
+    CHECK(SUCCEEDED(webView->add_NavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2NavigationStartingEventArgs* args) -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(args->get_Uri(&uri));
+                startingUri = uri.get();
+                bool blocked = startingUri.find(L"blocked") != std::wstring::npos;
+                CHECK_FAILURE(args->put_Cancel(blocked));
+                return S_OK;
+            })
+            .Get(),
+        &token)));
+    CHECK(SUCCEEDED(webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT
+            {
+                CHECK_FAILURE(args->get_NavigationId(&completedId));
+                CHECK_FAILURE(args->get_WebErrorStatus(&status));
+                return S_OK;
+            })
+            .Get(),
+        &token)));
+
+    CHECK(!webView->RaiseNavigationStarting(L"https://example.com/", 7));
+    CHECK(startingUri == L"https://example.com/");
+    CHECK(webView->RaiseNavigationStarting(L"https://blocked.example/", 8));
+    webView->RaiseNavigationCompleted(8, false, false, COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
+    CHECK(completedId == 8);
+    CHECK(status == COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
+
+    webView->RaiseSourceChanged(L"https://example.com/a", true);
+    webView->RaiseDocumentTitleChanged(L"A");
+    wil::unique_cotaskmem_string source;
+    wil::unique_cotaskmem_string title;
+    CHECK(SUCCEEDED(webView->get_Source(&source)));
+    CHECK(SUCCEEDED(webView->get_DocumentTitle(&title)));
+    CHECK(std::wstring(source.get()) == L"https://example.com/a");
+    CHECK(std::wstring(title.get()) == L"A");
+}
+
+void TestWebResourceRequestedFilters()
+{
+    auto webView = Make<FakeWebView2>();
+    std::vector<std::wstring> requested;
+    EventRegistrationToken token;
+    CHECK(SUCCEEDED(webView->add_WebResourceRequested(
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2WebResourceRequestedEventArgs* args) -> HRESULT
+            {
+                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                CHECK_FAILURE(args->get_Request(&request));
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(request->get_Uri(&uri));
+                requested.push_back(uri.get());
+                return S_OK;
+            })
+            .Get(),
+        &token)));
+
+    // Without a filter, the event isn't raised.
+    CHECK(!webView->RaiseWebResourceRequested(
+        L"https://example.com/a.png", L"GET", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE));
+    CHECK(SUCCEEDED(webView->AddWebResourceRequestedFilter(
+        L"https://example.com/*.png", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE)));
+    CHECK(webView->RaiseWebResourceRequested(
+        L"https://example.com/a.png", L"GET", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE));
+    CHECK(!webView->RaiseWebResourceRequested(
+        L"https://example.com/a.png", L"GET", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT));
+    CHECK(!webView->RaiseWebResourceRequested(
+        L"https://example.com/a.js", L"GET", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE));
+    CHECK(SUCCEEDED(
+        webView->AddWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL)));
+    CHECK(webView->RaiseWebResourceRequested(
+        L"https://example.com/a.js", L"GET", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT));
+    CHECK(webView->GetWebResourceRequestedFilterCount() == 2);
+    CHECK(SUCCEEDED(webView->RemoveWebResourceRequestedFilter(
+        L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL)));
+    CHECK(webView->GetWebResourceRequestedFilterCount() == 1);
+    CHECK(requested.size() == 2);
+}
+
+void TestCookies()
+{
+    auto webView = Make<FakeWebView2>();
+    FakeCookieManager* fakeCookies = webView->GetFakeCookieManager();
+    fakeCookies->SetCookie({L"a", L"1", L".example.com"});
+    fakeCookies->SetCookie({L"b", L"2", L"www.example.com", L"/docs"});
+    fakeCookies->SetCookie({L"c", L"3", L"other.test"});
+    fakeCookies->SetCookie({L"a", L"4", L".example.com"});
+    CHECK(fakeCookies->GetCookieCount() == 3);
+
+    wil::com_ptr<ICoreWebView2CookieManager> cookieManager;
+    CHECK(SUCCEEDED(webView->get_CookieManager(&cookieManager)));
+    auto getNames = [&](const wchar_t* uri)
+    {
+        std::wstring names;
+        CHECK(SUCCEEDED(cookieManager->GetCookies(
+            uri, Callback<ICoreWebView2GetCookiesCompletedHandler>(
+                     [&](HRESULT result, ICoreWebView2CookieList* list) -> HRESULT
+                     {
+                         CHECK(SUCCEEDED(result));
+                         UINT count = 0;
+                         CHECK_FAILURE(list->get_Count(&count));
+                         for (UINT i = 0; i < count; i++)
+                         {
+                             wil::com_ptr<ICoreWebView2Cookie> cookie;
+                             CHECK_FAILURE(list->GetValueAtIndex(i, &cookie));
+                             wil::unique_cotaskmem_string name;
+                             CHECK_FAILURE(cookie->get_Name(&name));
+                             names += name.get();
+                         }
+                         return S_OK;
+                     })
+                     .Get())));
+        return names;
+    };
+    CHECK(getNames(L"https://www.example.com/docs/page") == L"ab");
+    CHECK(getNames(L"https://www.example.com/") == L"a");
+    CHECK(getNames(L"https://example.com/docs") == L"a");
+    CHECK(getNames(L"https://notexample.com/") == L"");
+    CHECK(getNames(L"").size() == 3);
+
+    CHECK(SUCCEEDED(cookieManager->DeleteAllCookies()));
+    CHECK(fakeCookies->GetCookieCount() == 0);
+}
+
+void TestDevToolsProtocolEventReceivers()
+{
+    auto webView = Make<FakeWebView2>();
+    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
+    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> sameReceiver;
+    CHECK(SUCCEEDED(
+        webView->GetDevToolsProtocolEventReceiver(L"Runtime.consoleAPICalled", &receiver)));
+    CHECK(SUCCEEDED(
+        webView->GetDevToolsProtocolEventReceiver(L"Runtime.consoleAPICalled", &sameReceiver)));
+    CHECK(receiver.get() == sameReceiver.get());
+
+    std::wstring received;
+    EventRegistrationToken token;
+    CHECK(SUCCEEDED(receiver->add_DevToolsProtocolEventReceived(
+        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string json;
+                CHECK_FAILURE(args->get_ParameterObjectAsJson(&json));
+                received += json.get();
+                return S_OK;
+            })
+            .Get(),
+        &token)));
+    webView->RaiseDevToolsProtocolEvent(L"Runtime.consoleAPICalled", L"{\"type\":\"log\"}");
+    webView->RaiseDevToolsProtocolEvent(L"Log.entryAdded", L"{}");
+    CHECK(received == L"{\"type\":\"log\"}");
+    CHECK(webView->GetHandlerCount() == 1);
+    CHECK(SUCCEEDED(receiver->remove_DevToolsProtocolEventReceived(token)));
+    CHECK(webView->GetHandlerCount() == 0);
+}
+
+void TestFrames()
+{
+    auto webView = Make<FakeWebView2>();
+    std::vector<UINT32> created;
+    int destroyed = 0;
+    EventRegistrationToken token;
+    CHECK(SUCCEEDED(webView->add_FrameCreated(
+        Callback<ICoreWebView2FrameCreatedEventHandler>(
+            [&](ICoreWebView2*, ICoreWebView2FrameCreatedEventArgs* args) -> HRESULT
+            {
+                wil::com_ptr<ICoreWebView2Frame> frame;
+                CHECK_FAILURE(args->get_Frame(&frame));
+                auto frame5 = frame.try_query<ICoreWebView2Frame5>();
+                CHECK(frame5);
+                UINT32 id = 0;
+                CHECK_FAILURE(frame5->get_FrameId(&id));
+                created.push_back(id);
+                EventRegistrationToken destroyedToken;
+                CHECK_FAILURE(frame->add_Destroyed(
+                    Callback<ICoreWebView2FrameDestroyedEventHandler>(
+                        [&](ICoreWebView2Frame*, IUnknown*) -> HRESULT
+                        {
+                            destroyed++;
+                            return S_OK;
+                        })
+                        .Get(),
+                    &destroyedToken));
+                return S_OK;
+            })
+            .Get(),
+        &token)));
+    wil::com_ptr<FakeFrame> first = webView->CreateFrame(L"first", 10);
+    wil::com_ptr<FakeFrame> second = webView->CreateFrame(L"second", 11);
+    CHECK((created == std::vector<UINT32>{10, 11}));
+    first->RaiseDestroyed();
+    CHECK(destroyed == 1);
+    // A destroyed frame doesn't raise Destroyed again.
+    first->RaiseDestroyed();
+    CHECK(destroyed == 1);
+    second->RaiseDestroyed();
+    CHECK(destroyed == 2);
+}
+
+void TestCallbackReferences()
+{
+    struct Tracker
+    {
+        explicit Tracker(int* deleted) : deleted(deleted)
+        {
+        }
+        int* deleted;
+        ~Tracker()
+        {
+            (*deleted)++;
+        }
+    };
+    int deleted = 0;
+    {
+        auto webView = Make<FakeWebView2>();
+        auto tracker = std::make_shared<Tracker>(&deleted);
+        EventRegistrationToken token;
+        CHECK(SUCCEEDED(webView->add_SourceChanged(
+            Callback<ICoreWebView2SourceChangedEventHandler>(
+                [tracker](ICoreWebView2*, ICoreWebView2SourceChangedEventArgs*) -> HRESULT
+                { return S_OK; })
+                .Get(),
+            &token)));
+        tracker.reset();
+        CHECK(deleted == 0);
+        // Removing the handler releases the callback and what it captured.
+        CHECK(SUCCEEDED(webView->remove_SourceChanged(token)));
+        CHECK(deleted == 1);
+    }
+}
+
+void TestUtf8Conversion()
+{
+    std::wstring wide = L"café 中文 \U0001f600";
+    std::string utf8 = ToUtf8(wide);
+    CHECK(utf8 == "caf\xc3\xa9 \xe4\xb8\xad\xe6\x96\x87 \xf0\x9f\x98\x80");
+    CHECK(ToUtf16(utf8) == wide);
+    // Invalid bytes become U+FFFD rather than being dropped.
+    CHECK(ToUtf16("a\xff" "b") == L"a�b");
+}
+} // namespace
+
+int main()
+{
+    TestTokensRemoveTheirHandler();
+    TestRemoveDuringRaise();
+    TestNavigationArgsAndState();
+    TestWebResourceRequestedFilters();
+    TestCookies();
+    TestDevToolsProtocolEventReceivers();
+    TestFrames();
+    TestCallbackReferences();
+    TestUtf8Conversion();
+    return FinishTests("FakeWebView2Tests");
+}
@@ -0,0 +1,424 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FaviconCache.h"
+#include "FaviconStore.h"
+#include "TestUtil.h"
+
+namespace
+{
+using Bytes = std::vector<uint8_t>;
+
+// What the test decodes PNGs into, in place of an HICON.
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Bytes pixels;
+};
+
+uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    static const std::vector<uint32_t> s_table = []
+    {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = s_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+void PutUint32(Bytes* out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        out->push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+uint32_t GetUint32(const uint8_t* data)
+{
+    return uint32_t(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+}
+
+void PutChunk(Bytes* png, const char* type, const Bytes& data)
+{
+    PutUint32(png, static_cast<uint32_t>(data.size()));
+    size_t start = png->size();
+    png->insert(png->end(), type, type + 4);
+    png->insert(png->end(), data.begin(), data.end());
+    PutUint32(png, Crc32(png->data() + start, png->size() - start));
+}
+
+// Encodes RGBA pixels as a PNG with stored (uncompressed) deflate blocks.
+Bytes EncodePng(uint32_t width, uint32_t height, const Bytes& pixels)
+{
+    Bytes raw;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        raw.push_back(0);
+        raw.insert(
+            raw.end(), pixels.begin() + y * width * 4, pixels.begin() + (y + 1) * width * 4);
+    }
+    Bytes zlib = {0x78, 0x01};
+    for (size_t offset = 0; offset < raw.size(); offset += 65535)
+    {
+        uint16_t size = static_cast<uint16_t>((std::min)(raw.size() - offset, size_t(65535)));
+        zlib.push_back(offset + size == raw.size() ? 1 : 0);
+        zlib.insert(zlib.end(), {uint8_t(size), uint8_t(size >> 8), uint8_t(~size),
+                                 uint8_t(~size >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutUint32(&zlib, b << 16 | a);
+
+    Bytes png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    Bytes header;
+    PutUint32(&header, width);
+    PutUint32(&header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    PutChunk(&png, "IHDR", header);
+    PutChunk(&png, "IDAT", zlib);
+    PutChunk(&png, "IEND", {});
+    return png;
+}
+
+// Decodes what EncodePng writes, checking every CRC. Returns null otherwise.
+std::shared_ptr<Image> DecodePng(const uint8_t* png, size_t size)
+{
+    static const uint8_t c_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size < 8 || std::memcmp(png, c_signature, 8) != 0)
+    {
+        return nullptr;
+    }
+    auto image = std::make_shared<Image>();
+    Bytes zlib;
+    bool ended = false;
+    for (size_t offset = 8; offset + 12 <= size && !ended;)
+    {
+        uint32_t length = GetUint32(png + offset);
+        if (offset + 12 + length > size ||
+            Crc32(png + offset + 4, length + 4) != GetUint32(png + offset + 8 + length))
+        {
+            return nullptr;
+        }
+        const uint8_t* data = png + offset + 8;
+        if (std::memcmp(png + offset + 4, "IHDR", 4) == 0 && length == 13)
+        {
+            image->width = GetUint32(data);
+            image->height = GetUint32(data + 4);
+        }
+        else if (std::memcmp(png + offset + 4, "IDAT", 4) == 0)
+        {
+            zlib.insert(zlib.end(), data, data + length);
+        }
+        ended = std::memcmp(png + offset + 4, "IEND", 4) == 0;
+        offset += 12 + length;
+    }
+    Bytes raw;
+    for (size_t offset = 2; ended && offset + 5 <= zlib.size();)
+    {
+        bool last = zlib[offset] & 1;
+        size_t length = zlib[offset + 1] | zlib[offset + 2] << 8;
+        raw.insert(
+            raw.end(), zlib.begin() + offset + 5,
+            zlib.begin() + (std::min)(zlib.size(), offset + 5 + length));
+        offset += 5 + length;
+        if (last)
+        {
+            break;
+        }
+    }
+    size_t rowSize = size_t(image->width) * 4 + 1;
+    if (!ended || image->width == 0 || raw.size() != rowSize * image->height)
+    {
+        return nullptr;
+    }
+    for (uint32_t y = 0; y < image->height; y++)
+    {
+        auto row = raw.begin() + y * rowSize;
+        image->pixels.insert(image->pixels.end(), row + 1, row + rowSize);
+    }
+    return image;
+}
+
+struct Icon
+{
+    uint32_t size = 0;
+    Bytes pixels;
+    Bytes png;
+};
+
+// An icon of a common size: a background, a border and a disc, as
+// site icons tend to be.
+Icon MakeIcon(std::mt19937& random)
+{
+    static const uint32_t c_sizes[] = {16, 32, 48, 64};
+    Icon icon;
+    icon.size = c_sizes[random() % 4];
+    icon.pixels.resize(size_t(icon.size) * icon.size * 4);
+    uint32_t background = static_cast<uint32_t>(random());
+    uint32_t foreground = static_cast<uint32_t>(random());
+    uint32_t cx = random() % icon.size;
+    uint32_t cy = random() % icon.size;
+    uint32_t radius = 2 + random() % (icon.size / 2);
+    for (uint32_t y = 0; y < icon.size; y++)
+    {
+        for (uint32_t x = 0; x < icon.size; x++)
+        {
+            bool border = x == 0 || y == 0 || x == icon.size - 1 || y == icon.size - 1;
+            int64_t dx = int64_t(x) - cx;
+            int64_t dy = int64_t(y) - cy;
+            bool inside = dx * dx + dy * dy <= int64_t(radius) * radius;
+            uint32_t color = border || inside ? foreground : background;
+            std::memcpy(&icon.pixels[(size_t(y) * icon.size + x) * 4], &color, 4);
+        }
+    }
+    icon.png = EncodePng(icon.size, icon.size, icon.pixels);
+    return icon;
+}
+
+bool ShowsIcon(const std::shared_ptr<Image>& image, const Icon& icon)
+{
+    return image && image->width == icon.size && image->height == icon.size &&
+           image->pixels == icon.pixels;
+}
+
+std::filesystem::path GetTestPath()
+{
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "FaviconCacheTests.bin";
+    std::filesystem::remove(path);
+    return path;
+}
+
+// A corpus of icons served from many URIs, some of them shared, e.g. a
+// hosting provider's default icon. Added in one run and found in the next,
+// where every icon is read from the pack and decoded once.
+void TestCorpus()
+{
+    std::filesystem::path path = GetTestPath();
+    std::mt19937 random(1);
+    std::vector<Icon> icons;
+    for (int i = 0; i < 200; i++)
+    {
+        icons.push_back(MakeIcon(random));
+        const Bytes& png = icons.back().png;
+        CHECK(ShowsIcon(DecodePng(png.data(), png.size()), icons.back()));
+    }
+    std::vector<size_t> iconOfUri;
+    for (int i = 0; i < 1500; i++)
+    {
+        iconOfUri.push_back(random() % 3 == 0 ? 0 : random() % icons.size());
+    }
+    auto uriOf = [](size_t i)
+    { return "https://site" + std::to_string(i) + ".example/favicon.ico"; };
+    size_t distinct = 0;
+    {
+        std::vector<bool> used(icons.size());
+        for (size_t icon : iconOfUri)
+        {
+            distinct += used[icon] ? 0 : 1;
+            used[icon] = true;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        FaviconCache<Image> cache(path, DecodePng, 1024);
+        for (size_t i = 0; i < iconOfUri.size(); i++)
+        {
+            const Icon& icon = icons[iconOfUri[i]];
+            CHECK(ShowsIcon(cache.Add(uriOf(i), icon.png.data(), icon.png.size()), icon));
+        }
+        for (size_t i = 0; i < iconOfUri.size(); i++)
+        {
+            bool stale = true;
+            CHECK(ShowsIcon(cache.Find(uriOf(i), &stale), icons[iconOfUri[i]]));
+            CHECK(!stale);
+        }
+        auto counters = cache.GetCounters();
+        CHECK(counters.decodes == distinct);
+        CHECK(counters.deduplicatedIcons == iconOfUri.size() - distinct);
+        CHECK(counters.memoryHits == iconOfUri.size() && counters.misses == 0);
+    }
+    double addSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    FaviconCache<Image> cache(path, DecodePng, 1024);
+    for (size_t i = 0; i < iconOfUri.size(); i++)
+    {
+        bool stale = false;
+        CHECK(ShowsIcon(cache.Find(uriOf(i), &stale), icons[iconOfUri[i]]));
+        CHECK(stale);
+    }
+    CHECK(!cache.Find("https://unknown.example/favicon.ico"));
+    double findSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto counters = cache.GetCounters();
+    CHECK(counters.decodes == distinct && counters.diskHits == distinct);
+    CHECK(counters.memoryHits == iconOfUri.size() - distinct && counters.misses == 1);
+    std::printf(
+        "%zu URIs, %zu icons: %.1f us per Add, %.1f us per Find after reopening\n",
+        iconOfUri.size(), distinct, addSeconds * 1e6 / iconOfUri.size(),
+        findSeconds * 1e6 / iconOfUri.size());
+    std::filesystem::remove(path);
+}
+
+// A site changes its icon: the cached one is stale after the interval, the
+// same bytes fetched again cost neither a decode nor a write, and new bytes
+// replace it.
+void TestRevalidation()
+{
+    std::filesystem::path path = GetTestPath();
+    std::mt19937 random(2);
+    Icon oldIcon = MakeIcon(random);
+    Icon newIcon = MakeIcon(random);
+    const std::string uri = "https://example.com/favicon.ico";
+    using Clock = FaviconCache<Image>::Clock;
+    Clock::time_point start = Clock::now();
+    FaviconCache<Image> cache(path, DecodePng, 16, std::chrono::minutes(10));
+    cache.Add(uri, oldIcon.png.data(), oldIcon.png.size(), start);
+
+    bool stale = true;
+    CHECK(ShowsIcon(cache.Find(uri, &stale, start + std::chrono::minutes(9)), oldIcon));
+    CHECK(!stale);
+    CHECK(ShowsIcon(cache.Find(uri, &stale, start + std::chrono::minutes(10)), oldIcon));
+    CHECK(stale);
+
+    uint64_t fileSize = std::filesystem::file_size(path);
+    auto now = start + std::chrono::minutes(10);
+    CHECK(ShowsIcon(cache.Add(uri, oldIcon.png.data(), oldIcon.png.size(), now), oldIcon));
+    CHECK(std::filesystem::file_size(path) == fileSize);
+    CHECK(cache.GetCounters().decodes == 1 && cache.GetCounters().changedIcons == 0);
+    CHECK(cache.GetCounters().deduplicatedIcons == 0);
+    cache.Find(uri, &stale, now + std::chrono::minutes(1));
+    CHECK(!stale);
+
+    now += std::chrono::minutes(20);
+    CHECK(ShowsIcon(cache.Add(uri, newIcon.png.data(), newIcon.png.size(), now), newIcon));
+    CHECK(cache.GetCounters().changedIcons == 1);
+    CHECK(ShowsIcon(cache.Find(uri, &stale, now), newIcon));
+    CHECK(!stale);
+    std::filesystem::remove(path);
+}
+
+// Icons that keep changing leave the pack mostly dead records, which opening
+// it drops; what is left still resolves every URI to its latest icon. A pack
+// that is small, or mostly live, is left alone, as is a torn last record.
+void TestCompaction()
+{
+    std::filesystem::path path = GetTestPath();
+    std::mt19937 random(3);
+    constexpr size_t c_uriCount = 100;
+    std::vector<Icon> latest(c_uriCount);
+    auto uriOf = [](size_t i)
+    { return "https://app" + std::to_string(i) + ".example/icon.png"; };
+    uint64_t fullSize = 0;
+    {
+        FaviconStore store(path);
+        for (int round = 0; round < 10; round++)
+        {
+            for (size_t i = 0; i < c_uriCount; i++)
+            {
+                latest[i] = MakeIcon(random);
+                store.Put(uriOf(i), latest[i].png.data(), latest[i].png.size());
+            }
+        }
+        CHECK(store.GetImageCount() == 10 * c_uriCount);
+        fullSize = store.GetFileSize();
+        CHECK(fullSize == std::filesystem::file_size(path));
+    }
+
+    uint64_t compactSize = 0;
+    {
+        FaviconStore store(path);
+        compactSize = store.GetFileSize();
+        CHECK(compactSize < fullSize / 5);
+        CHECK(compactSize == std::filesystem::file_size(path));
+        CHECK(store.GetUriCount() == c_uriCount && store.GetImageCount() == c_uriCount);
+        CHECK(!std::filesystem::exists(path.string() + ".compact"));
+        for (size_t i = 0; i < c_uriCount; i++)
+        {
+            FaviconStore::Digest digest;
+            Bytes png;
+            CHECK(store.Find(uriOf(i), &digest) && store.ReadPng(digest, &png));
+            CHECK(png == latest[i].png);
+        }
+        // Records appended after compaction land after the rewritten ones.
+        Icon icon = MakeIcon(random);
+        store.Put("https://late.example/icon.png", icon.png.data(), icon.png.size());
+        latest.push_back(icon);
+    }
+
+    // A crash in the middle of a record.
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x20\x00\x00\x00https://torn", 15);
+    }
+    FaviconStore store(path);
+    CHECK(store.GetUriCount() == c_uriCount + 1 && store.GetImageCount() == c_uriCount + 1);
+    CHECK(std::filesystem::file_size(path) == store.GetFileSize());
+    CHECK(store.GetFileSize() > compactSize);
+    FaviconStore::Digest digest;
+    Bytes png;
+    CHECK(store.Find("https://late.example/icon.png", &digest) && store.ReadPng(digest, &png));
+    CHECK(png == latest.back().png);
+    std::filesystem::remove(path);
+
+    // Below the minimum size nothing is rewritten, however dead.
+    {
+        FaviconStore small(path);
+        Icon icon = MakeIcon(random);
+        for (int i = 0; i < 20; i++)
+        {
+            icon.png.back() ^= 1;
+            small.Put("https://small.example/icon.png", icon.png.data(), icon.png.size());
+        }
+        CHECK(small.GetFileSize() < FaviconStore::c_minCompactSize);
+    }
+    uint64_t smallSize = std::filesystem::file_size(path);
+    CHECK(FaviconStore(path).GetFileSize() == smallSize);
+    std::filesystem::remove(path);
+}
+} // namespace
+
+int main()
+{
+    TestCorpus();
+    TestRevalidation();
+    TestCompaction();
+    return FinishTests("FaviconCacheTests");
+}
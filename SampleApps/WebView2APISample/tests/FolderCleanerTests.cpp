@@ -0,0 +1,217 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FolderCleaner.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const fs::path c_root = fs::temp_directory_path() / "FolderCleanerTests";
+
+// What a synthetic tree holds, per folder including its subfolders.
+struct TreeContents
+{
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t directories = 0;
+    // Keyed by the path relative to the tree, down to two levels.
+    std::map<fs::path, std::pair<uint64_t, uint64_t>> folders;
+};
+
+void WriteFile(const fs::path& path, size_t size)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << std::string(size, 'x');
+}
+
+// A tree shaped like a user data folder: a few wide folders of small files,
+// deep narrow chains, and empty folders.
+TreeContents MakeTree(const fs::path& folder, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    TreeContents contents;
+    std::vector<std::pair<fs::path, size_t>> pending = {{fs::path(), 0}};
+    while (!pending.empty())
+    {
+        fs::path relative = pending.back().first;
+        size_t depth = pending.back().second;
+        pending.pop_back();
+        fs::create_directories(folder / relative);
+        contents.directories++;
+        size_t files = random() % 4 == 0 ? 0 : random() % (depth == 2 ? 60 : 8);
+        for (size_t i = 0; i < files; i++)
+        {
+            size_t size = random() % 3 == 0 ? 0 : random() % 5000;
+            WriteFile(folder / relative / ("f" + std::to_string(i) + ".dat"), size);
+            contents.files++;
+            contents.bytes += size;
+            // The file counts toward each of its folders down to two levels.
+            fs::path prefix;
+            auto component = relative.begin();
+            for (size_t level = 0; level <= (std::min)(depth, size_t(2)); level++)
+            {
+                contents.folders[prefix].first++;
+                contents.folders[prefix].second += size;
+                if (component != relative.end())
+                {
+                    prefix /= *component++;
+                }
+            }
+        }
+        size_t subfolders = depth >= 6 ? 0 : depth < 2 ? 2 + random() % 4 : random() % 3;
+        for (size_t i = 0; i < subfolders; i++)
+        {
+            pending.push_back({relative / ("d" + std::to_string(i)), depth + 1});
+        }
+    }
+    return contents;
+}
+
+void TestMeasureTree()
+{
+    fs::remove_all(c_root);
+    TreeContents contents = MakeTree(c_root, 1);
+    FolderCleaner cleaner(4);
+    std::vector<FolderCleaner::FolderSize> sizes = cleaner.MeasureTree(c_root, 2);
+    CHECK(!sizes.empty() && sizes[0].path.empty());
+    CHECK(sizes[0].files == contents.files && sizes[0].bytes == contents.bytes);
+    size_t matched = 0;
+    for (const FolderCleaner::FolderSize& size : sizes)
+    {
+        CHECK(size.depth <= 2);
+        auto it = contents.folders.find(size.path);
+        // Folders without files anywhere below them are listed with none.
+        uint64_t files = it == contents.folders.end() ? 0 : it->second.first;
+        uint64_t bytes = it == contents.folders.end() ? 0 : it->second.second;
+        CHECK(size.files == files && size.bytes == bytes);
+        matched += it != contents.folders.end();
+    }
+    CHECK(matched == contents.folders.size());
+    // Measuring leaves the tree alone.
+    CHECK(cleaner.MeasureTree(c_root, 0)[0].files == contents.files);
+    fs::remove_all(c_root);
+}
+
+void TestDeleteTree()
+{
+    fs::remove_all(c_root);
+    TreeContents contents = MakeTree(c_root, 2);
+    FolderCleaner cleaner(4, std::chrono::milliseconds(1));
+    size_t doneCalls = 0;
+    FolderCleaner::Progress progress = cleaner.DeleteTree(
+        c_root, [&](const FolderCleaner::Progress& p) { doneCalls += p.done ? 1 : 0; });
+    CHECK(progress.done && !progress.cancelled && doneCalls == 1);
+    CHECK(progress.files == contents.files && progress.bytes == contents.bytes);
+    CHECK(progress.directories == contents.directories && progress.failures == 0);
+    CHECK(!fs::exists(c_root));
+}
+
+// Starts deleting the folder and returns the final progress, once the job is
+// done.
+std::future<FolderCleaner::Progress> StartDelete(
+    FolderCleaner& cleaner, const fs::path& folder, bool moveAside, bool* started)
+{
+    auto done = std::make_shared<std::promise<FolderCleaner::Progress>>();
+    std::future<FolderCleaner::Progress> result = done->get_future();
+    *started = cleaner.StartDelete(
+        folder, moveAside,
+        [done](const FolderCleaner::Progress& progress)
+        {
+            if (progress.done)
+            {
+                done->set_value(progress);
+            }
+        });
+    return result;
+}
+
+void TestStartDeleteMovesAsideAtOnce()
+{
+    fs::remove_all(c_root);
+    fs::path leftover = c_root;
+    leftover += ".deleting.1";
+    fs::remove_all(leftover);
+    TreeContents contents = MakeTree(c_root, 3);
+    // A folder that an earlier run moved aside but didn't finish deleting.
+    TreeContents leftoverContents = MakeTree(leftover, 4);
+
+    FolderCleaner cleaner(4);
+    bool started = false;
+    std::future<FolderCleaner::Progress> done = StartDelete(cleaner, c_root, true, &started);
+    CHECK(started);
+    // The path is free as soon as StartDelete returns, and what a new
+    // WebView puts there isn't deleted.
+    CHECK(!fs::exists(c_root));
+    fs::create_directories(c_root);
+    WriteFile(c_root / "new.dat", 10);
+
+    FolderCleaner::Progress progress = done.get();
+    CHECK(progress.files == contents.files + leftoverContents.files);
+    CHECK(progress.bytes == contents.bytes + leftoverContents.bytes);
+    CHECK(progress.failures == 0);
+    CHECK(FolderCleaner::FindMovedAside(c_root).empty());
+    CHECK(fs::exists(c_root / "new.dat"));
+    fs::remove_all(c_root);
+}
+
+void TestStartDeleteInPlace()
+{
+    fs::remove_all(c_root);
+    TreeContents contents = MakeTree(c_root, 5);
+    FolderCleaner cleaner(2);
+    bool started = false;
+    FolderCleaner::Progress progress = StartDelete(cleaner, c_root, false, &started).get();
+    CHECK(started && progress.files == contents.files);
+    CHECK(!fs::exists(c_root) && FolderCleaner::FindMovedAside(c_root).empty());
+}
+
+void TestStartDeleteWhileBusy()
+{
+    fs::remove_all(c_root);
+    MakeTree(c_root, 6);
+    FolderCleaner cleaner(2);
+    // The measuring job stays busy until it is released.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    CHECK(cleaner.StartMeasure(
+        c_root, 1,
+        [released](const std::vector<FolderCleaner::FolderSize>&) { released.wait(); }));
+    bool started = true;
+    StartDelete(cleaner, c_root, true, &started);
+    // Refused before anything was renamed.
+    CHECK(!started && cleaner.IsBusy());
+    CHECK(fs::exists(c_root) && FolderCleaner::FindMovedAside(c_root).empty());
+    release.set_value();
+
+    while (cleaner.IsBusy())
+    {
+        std::this_thread::yield();
+    }
+    std::future<FolderCleaner::Progress> done = StartDelete(cleaner, c_root, true, &started);
+    CHECK(started && done.get().failures == 0 && !fs::exists(c_root));
+}
+} // namespace
+
+int main()
+{
+    TestMeasureTree();
+    TestDeleteTree();
+    TestStartDeleteMovesAsideAtOnce();
+    TestStartDeleteInPlace();
+    TestStartDeleteWhileBusy();
+    return FinishTests("FolderCleanerTests");
+}
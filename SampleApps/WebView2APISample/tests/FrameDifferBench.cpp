@@ -0,0 +1,240 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Diffs 4K screenshots as the screenshot monitor of FileComponent does, with
+// the scalar and the SSE2 tile hashes, and checks that both find the tiles
+// whose pixels changed: an unchanged frame, a blinking caret, a repainted
+// block and a scroll that moves every line of text, on a padded stride and on
+// a width that leaves partial tiles. Reports the time per frame and the
+// hashing throughput:
+//     FrameDifferBench [frames per case]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "FrameDiffer.h"
+
+namespace
+{
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+// A frame of 32-bit pixels that owns them.
+struct Screenshot
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0;
+    std::vector<uint8_t> pixels;
+
+    Screenshot(uint32_t w, uint32_t h, size_t padding)
+        : width(w), height(h), stride(w * 4 + padding), pixels(stride * h)
+    {
+    }
+
+    FrameDiffer::Frame GetFrame() const
+    {
+        return {pixels.data(), width, height, stride};
+    }
+
+    void Fill(uint32_t left, uint32_t top, uint32_t w, uint32_t h, uint32_t color)
+    {
+        for (uint32_t y = top; y < top + h; y++)
+        {
+            for (uint32_t x = left; x < left + w; x++)
+            {
+                std::memcpy(&pixels[y * stride + x * 4], &color, 4);
+            }
+        }
+    }
+};
+
+// A page: a background, blocks of text-like noise and a few solid boxes.
+void PaintPage(Screenshot* screenshot, std::mt19937& random)
+{
+    screenshot->Fill(0, 0, screenshot->width, screenshot->height, 0xFFF3F3F3);
+    for (uint32_t y = 40; y + 20 < screenshot->height; y += 24)
+    {
+        for (uint32_t x = 40; x + 8 < screenshot->width - 40; x += 9)
+        {
+            if (random() % 6 != 0)
+            {
+                screenshot->Fill(x, y, 7, 14, 0xFF000000 | (random() % 0x404040));
+            }
+        }
+    }
+    for (int box = 0; box < 8; box++)
+    {
+        uint32_t w = 100 + random() % 400;
+        uint32_t h = 100 + random() % 300;
+        screenshot->Fill(
+            random() % (screenshot->width - w), random() % (screenshot->height - h), w, h,
+            0xFF000000 | static_cast<uint32_t>(random()));
+    }
+}
+
+double GetSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Case
+{
+    const char* name;
+    // Changes the second frame of each pair.
+    void (*change)(Screenshot* screenshot);
+};
+
+// The tiles whose pixels differ, found by comparing them.
+std::vector<uint32_t> CompareTiles(const Screenshot& before, const Screenshot& after)
+{
+    constexpr uint32_t c_tileSize = FrameDiffer::c_tileSize;
+    uint32_t tilesX = (before.width + c_tileSize - 1) / c_tileSize;
+    uint32_t tilesY = (before.height + c_tileSize - 1) / c_tileSize;
+    std::vector<uint32_t> changed;
+    for (uint32_t ty = 0; ty < tilesY; ty++)
+    {
+        for (uint32_t tx = 0; tx < tilesX; tx++)
+        {
+            uint32_t left = tx * c_tileSize;
+            uint32_t width = (std::min)(c_tileSize, before.width - left);
+            bool same = true;
+            for (uint32_t y = ty * c_tileSize;
+                 y < (std::min)(before.height, (ty + 1) * c_tileSize) && same; y++)
+            {
+                size_t offset = y * before.stride + left * 4;
+                const uint8_t* beforeRow = &before.pixels[offset];
+                same = std::memcmp(beforeRow, &after.pixels[offset], width * 4) == 0;
+            }
+            if (!same)
+            {
+                changed.push_back(ty * tilesX + tx);
+            }
+        }
+    }
+    return changed;
+}
+
+// Both hashes produce the same tiles, and a diff of the frame with itself is
+// empty while a diff with the changed frame finds exactly the tiles that
+// changed.
+bool CheckCase(const Screenshot& before, const Screenshot& after)
+{
+    bool ok = true;
+    for (const Screenshot* screenshot : {&before, &after})
+    {
+        std::vector<uint64_t> scalar;
+        std::vector<uint64_t> simd;
+        FrameDiffer::HashTiles(screenshot->GetFrame(), &scalar, false);
+        FrameDiffer::HashTiles(screenshot->GetFrame(), &simd, true);
+        ok = Check(scalar == simd, "The scalar and SIMD hashes differ.") && ok;
+    }
+    FrameDiffer differ;
+    FrameDiffer::Diff first = differ.Update(before.GetFrame());
+    size_t tiles = size_t(first.tilesX) * first.tilesY;
+    ok = Check(first.changedTiles.size() == tiles, "The first frame isn't all changed.") && ok;
+    ok = Check(!differ.Update(before.GetFrame()).HasChanges(), "An unchanged frame changed.") &&
+         ok;
+    FrameDiffer::Diff diff = differ.Update(after.GetFrame());
+    bool sameTiles = diff.changedTiles == CompareTiles(before, after);
+    return Check(sameTiles, "The wrong tiles changed.") && ok;
+}
+
+// Times diffing `frames` frames that alternate between `before` and `after`.
+double TimeFrames(
+    const Screenshot& before, const Screenshot& after, size_t frames, bool useSimd)
+{
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> previous;
+    FrameDiffer::HashTiles(before.GetFrame(), &previous, useSimd);
+    size_t changed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames; i++)
+    {
+        const Screenshot& frame = i % 2 ? before : after;
+        FrameDiffer::HashTiles(frame.GetFrame(), &hashes, useSimd);
+        for (size_t t = 0; t < hashes.size(); t++)
+        {
+            changed += hashes[t] != previous[t];
+        }
+        hashes.swap(previous);
+    }
+    double seconds = GetSeconds(start);
+    // Keeps the comparisons from being optimized away.
+    if (changed == SIZE_MAX)
+    {
+        std::printf("\n");
+    }
+    return seconds / frames;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t frames = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 60;
+    std::mt19937 random(1);
+    const Case cases[] = {
+        {"unchanged", [](Screenshot*) {}},
+        // A 2x20 caret inside one tile.
+        {"caret", [](Screenshot* s) { s->Fill(1000, 1000, 2, 20, 0xFF101010); }},
+        // 256x128 pixels on tile boundaries.
+        {"block", [](Screenshot* s) { s->Fill(640, 320, 256, 128, 0xFF2060C0); }},
+        // Everything moves up by a line of text.
+        {"scroll",
+         [](Screenshot* s)
+         {
+             size_t shift = 24 * s->stride;
+             std::memmove(s->pixels.data(), s->pixels.data() + shift, s->pixels.size() - shift);
+         }},
+    };
+    struct Size
+    {
+        uint32_t width;
+        uint32_t height;
+        size_t padding;
+    };
+    // 4K with a tight stride, 4K with a padded one, and a width and height
+    // that leave partial tiles.
+    const Size sizes[] = {{3840, 2160, 0}, {3840, 2160, 256}, {3838, 2150, 8}};
+
+    std::printf(
+        "SSE2: %s\n%-10s %-16s %12s %12s %10s %10s\n",
+        FrameDiffer::IsSimdAccelerated() ? "yes" : "no", "case", "frame", "scalar ms",
+        "SSE2 ms", "SSE2 GB/s", "speedup");
+    bool ok = true;
+    for (const Size& size : sizes)
+    {
+        Screenshot before(size.width, size.height, size.padding);
+        PaintPage(&before, random);
+        for (const Case& test : cases)
+        {
+            Screenshot after = before;
+            test.change(&after);
+            ok = CheckCase(before, after) && ok;
+            double scalar = TimeFrames(before, after, frames, false);
+            double simd = TimeFrames(before, after, frames, true);
+            double gigabytes = double(size.width) * size.height * 4 / 1e9;
+            char frameName[32];
+            std::snprintf(
+                frameName, sizeof(frameName), "%ux%u+%zu", size.width, size.height,
+                size.padding);
+            std::printf(
+                "%-10s %-16s %12.3f %12.3f %10.2f %9.2fx\n", test.name, frameName,
+                scalar * 1e3, simd * 1e3, gigabytes / simd, scalar / simd);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Builds FrameTrees of forests of frames in three shapes, in random order and
+// children first, then times an unchanged snapshot and the lookups of each
+// frame's ancestors against walking up the parents of each frame:
+//     FrameTreeBench [frame count]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameTree.h"
+
+namespace
+{
+enum class Shape
+{
+    // Main frames with 99 frames each, under random frames of the page.
+    Trees,
+    // Main frames with a chain of 999 nested frames each.
+    Chains,
+    // Main frames with 4999 children each.
+    Wide,
+};
+
+double GetElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+// Returns the parent of each frame, by frame ID from 1 to `count`, with
+// FrameTree::c_noFrame for main frames.
+std::vector<uint32_t> MakeForest(uint32_t count, Shape shape, std::mt19937& random)
+{
+    uint32_t pageSize = shape == Shape::Trees ? 100 : shape == Shape::Chains ? 1000 : 5000;
+    std::vector<uint32_t> parents(count + 1, FrameTree::c_noFrame);
+    for (uint32_t id = 1; id <= count; id++)
+    {
+        uint32_t mainFrameId = (id - 1) / pageSize * pageSize + 1;
+        if (id == mainFrameId)
+        {
+            continue;
+        }
+        switch (shape)
+        {
+        case Shape::Trees:
+            parents[id] = std::uniform_int_distribution<uint32_t>(mainFrameId, id - 1)(random);
+            break;
+        case Shape::Chains:
+            parents[id] = id - 1;
+            break;
+        case Shape::Wide:
+            parents[id] = mainFrameId;
+            break;
+        }
+    }
+    return parents;
+}
+
+struct Ancestors
+{
+    uint32_t mainFrameId = FrameTree::c_noFrame;
+    uint32_t firstLevelFrameId = FrameTree::c_noFrame;
+    uint32_t depth = 0;
+};
+
+// Walks up the parents of a frame, as the process info view did before it
+// kept a FrameTree.
+Ancestors Walk(const std::unordered_map<uint32_t, uint32_t>& parents, uint32_t id)
+{
+    Ancestors ancestors;
+    uint32_t parentId;
+    while ((parentId = parents.at(id)) != FrameTree::c_noFrame)
+    {
+        ancestors.firstLevelFrameId = id;
+        ancestors.depth++;
+        id = parentId;
+    }
+    ancestors.mainFrameId = id;
+    return ancestors;
+}
+
+bool CheckTree(const FrameTree& tree, const std::vector<uint32_t>& parents)
+{
+    std::unordered_map<uint32_t, uint32_t> parentMap;
+    for (uint32_t id = 1; id < parents.size(); id++)
+    {
+        parentMap[id] = parents[id];
+    }
+    if (tree.GetFrameCount() != parentMap.size())
+    {
+        std::fprintf(stderr, "The tree has %zu frames.\n", tree.GetFrameCount());
+        return false;
+    }
+    for (const auto& entry : parentMap)
+    {
+        const FrameTree::Frame* frame = tree.Find(entry.first);
+        Ancestors expected = Walk(parentMap, entry.first);
+        if (!frame || frame->parentId != entry.second ||
+            frame->mainFrameId != expected.mainFrameId ||
+            frame->firstLevelFrameId != expected.firstLevelFrameId ||
+            frame->depth != expected.depth)
+        {
+            std::fprintf(stderr, "Frame %u has the wrong ancestors.\n", entry.first);
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10000;
+    std::mt19937 random(1);
+    const char* shapeNames[] = {"trees of 100", "chains of 1000", "trees of 5000"};
+    std::printf(
+        "%-15s %10s %12s %12s %12s %10s %10s\n", "shape", "walks ms", "build ms",
+        "reverse ms", "snapshot ms", "lookup ms", "group ms");
+    for (Shape shape : {Shape::Trees, Shape::Chains, Shape::Wide})
+    {
+        std::vector<uint32_t> parents = MakeForest(count, shape, random);
+        std::vector<uint32_t> order;
+        for (uint32_t id = 1; id <= count; id++)
+        {
+            order.push_back(id);
+        }
+        std::shuffle(order.begin(), order.end(), random);
+
+        // Each frame's main frame and first-level frame, found by walking up
+        // its parents.
+        std::unordered_map<uint32_t, uint32_t> parentMap;
+        for (uint32_t id = 1; id <= count; id++)
+        {
+            parentMap[id] = parents[id];
+        }
+        uint64_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t id = 1; id <= count; id++)
+        {
+            Ancestors ancestors = Walk(parentMap, id);
+            sink += ancestors.mainFrameId + ancestors.firstLevelFrameId;
+        }
+        double walkMs = GetElapsedMs(start);
+
+        FrameTree tree;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t id : order)
+        {
+            tree.Insert(id, parents[id]);
+            tree.SetProcess(id, static_cast<int32_t>(1 + id % 8));
+        }
+        double buildMs = GetElapsedMs(start);
+
+        // Each frame before its parent, so that every insert of a parent sets
+        // the ancestors of the frames under it.
+        FrameTree reversed;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t id = count; id >= 1; id--)
+        {
+            reversed.Insert(id, parents[id]);
+        }
+        double reverseMs = GetElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        tree.BeginSnapshot();
+        for (uint32_t id : order)
+        {
+            tree.Insert(id, parents[id]);
+            tree.SetProcess(id, static_cast<int32_t>(1 + id % 8));
+        }
+        tree.EndSnapshot();
+        double snapshotMs = GetElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t id = 1; id <= count; id++)
+        {
+            const FrameTree::Frame* frame = tree.Find(id);
+            sink += frame->mainFrameId + frame->firstLevelFrameId;
+        }
+        double lookupMs = GetElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        size_t grouped = 0;
+        for (int32_t processId : tree.GetProcessIds())
+        {
+            grouped += tree.GetProcessFrames(processId).size();
+        }
+        double groupMs = GetElapsedMs(start);
+
+        std::printf(
+            "%-15s %10.2f %12.2f %12.2f %12.2f %10.3f %10.3f\n",
+            shapeNames[static_cast<int>(shape)], walkMs, buildMs, reverseMs, snapshotMs,
+            lookupMs, groupMs);
+        if (!CheckTree(tree, parents) || !CheckTree(reversed, parents) || grouped != count ||
+            sink == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HeapUsageSampler.h"
+#include "TestUtil.h"
+
+namespace
+{
+constexpr double c_megabyte = 1024 * 1024;
+
+// Samples `target` every second for `seconds` seconds with the used size the
+// series gives for the time in seconds. Returns the time in ms at which the
+// target was first flagged, or -1.
+int64_t RunSeries(
+    HeapUsageSampler& sampler, const std::string& target, int64_t seconds,
+    const std::function<double(double)>& series)
+{
+    int64_t flaggedMs = -1;
+    for (int64_t nowMs = 0; nowMs <= seconds * 1000; nowMs += 1000)
+    {
+        for (const std::string& due : sampler.GetDueTargets(nowMs))
+        {
+            double used = series(nowMs / 1000.0);
+            if (sampler.OnSample(due, nowMs, used, 64 * c_megabyte) && due == target &&
+                flaggedMs < 0)
+            {
+                flaggedMs = nowMs;
+            }
+        }
+    }
+    return flaggedMs;
+}
+
+HeapUsageSampler::Options GetOptions()
+{
+    HeapUsageSampler::Options options;
+    options.intervalMs = 1000;
+    return options;
+}
+
+void TestFitSlope()
+{
+    double rSquared = 0;
+    CHECK(std::abs(HeapUsageSampler::FitSlope({0, 1, 2, 3}, {1, 3, 5, 7}, &rSquared) - 2) <
+          1e-12);
+    CHECK(std::abs(rSquared - 1) < 1e-12);
+    // Flat and single-point series have no slope and no fit.
+    CHECK(HeapUsageSampler::FitSlope({0, 1, 2}, {5, 5, 5}, &rSquared) == 0);
+    CHECK(rSquared == 0);
+    CHECK(HeapUsageSampler::FitSlope({0}, {5}, &rSquared) == 0);
+    CHECK(HeapUsageSampler::FitSlope({1, 1}, {2, 3}, &rSquared) == 0);
+    // Large heap sizes keep their precision.
+    std::vector<double> x;
+    std::vector<double> y;
+    for (int i = 0; i < 60; i++)
+    {
+        x.push_back(i);
+        y.push_back(4e9 + 1000.0 * i);
+    }
+    CHECK(std::abs(HeapUsageSampler::FitSlope(x, y, &rSquared) - 1000) < 1e-6);
+    CHECK(rSquared > 0.999999);
+}
+
+void TestLinearGrowthIsFlagged()
+{
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("leak", "worker");
+    std::mt19937 random(3);
+    std::normal_distribution<double> noise(0, 200 * 1024);
+    int64_t flaggedMs = RunSeries(
+        sampler, "leak", 120, [&](double t) { return 10e6 + 50 * 1024 * t + noise(random); });
+    // Flagged once enough samples make the fit good, well within the window.
+    CHECK(flaggedMs >= 11000);
+    CHECK(flaggedMs <= 60000);
+    HeapUsageSampler::Trend trend = sampler.GetTrend("leak");
+    CHECK(trend.likelyLeak);
+    CHECK(trend.sampleCount == 60);
+    CHECK(std::abs(trend.bytesPerSecond - 50 * 1024) < 5 * 1024);
+}
+
+void TestNoisyFlatHeapIsNotFlagged()
+{
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("", "Main Page");
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0, 2 * c_megabyte);
+    CHECK(RunSeries(sampler, "", 600, [&](double) { return 20e6 + noise(random); }) < 0);
+    CHECK(!sampler.GetTrend("").likelyLeak);
+}
+
+void TestSawtoothIsNotFlagged()
+{
+    // Grows 200 KB/s, then a collection drops it back every 8 s. A window of
+    // minSamples or more spans a collection, so the fit stays poor. A cycle
+    // longer than minSamples intervals would look like a leak until its
+    // first collection.
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("gc", "iframe");
+    CHECK(
+        RunSeries(
+            sampler, "gc", 600, [](double t) { return 8e6 + std::fmod(t, 8) * 200 * 1024; }) <
+        0);
+    CHECK(sampler.GetTrend("gc").rSquared < 0.6);
+}
+
+void TestSlowGrowthIsNotFlagged()
+{
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("slow", "slow");
+    CHECK(RunSeries(sampler, "slow", 300, [](double t) { return 10e6 + 1024 * t; }) < 0);
+    HeapUsageSampler::Trend trend = sampler.GetTrend("slow");
+    CHECK(std::abs(trend.bytesPerSecond - 1024) < 1);
+    CHECK(trend.rSquared > 0.99);
+}
+
+void TestLeakThatStopsIsClearedByTheWindow()
+{
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("a", "a");
+    RunSeries(
+        sampler, "a", 240, [](double t) { return 10e6 + 100 * 1024 * (std::min)(t, 60.0); });
+    // The last 60 samples are flat, so the old growth has left the window.
+    CHECK(!sampler.GetTrend("a").likelyLeak);
+}
+
+void TestScheduling()
+{
+    HeapUsageSampler::Options options;
+    options.intervalMs = 5000;
+    options.lostAfterIntervals = 4;
+    HeapUsageSampler sampler(options);
+    sampler.AddTarget("a", "a");
+    CHECK(sampler.GetDueTargets(0).size() == 1);
+    // In flight, so not due again until the sample arrives or is lost.
+    CHECK(sampler.GetDueTargets(6000).empty());
+    CHECK(sampler.GetDueTargets(20000).empty());
+    CHECK(sampler.GetDueTargets(20001).size() == 1);
+    sampler.OnSampleFailed("a");
+    CHECK(sampler.GetDueTargets(20002).empty());
+    CHECK(sampler.GetDueTargets(25001).size() == 1);
+    CHECK(!sampler.OnSample("a", 25100, 1, 2));
+    CHECK(sampler.GetDueTargets(30000).empty());
+    CHECK(sampler.GetDueTargets(30001).size() == 1);
+
+    // Samples of removed or unknown targets are ignored.
+    sampler.RemoveTarget("a");
+    CHECK(!sampler.OnSample("a", 31000, 1, 2));
+    CHECK(sampler.GetTrends().empty());
+
+    // Re-adding updates the label and keeps the samples.
+    sampler.AddTarget("b", "old");
+    sampler.GetDueTargets(40000);
+    sampler.OnSample("b", 40000, 3, 4);
+    sampler.AddTarget("b", "new");
+    HeapUsageSampler::Trend trend = sampler.GetTrend("b");
+    CHECK(trend.label == "new");
+    CHECK(trend.sampleCount == 1);
+    CHECK(trend.usedSize == 3);
+}
+
+void TestExportJson()
+{
+    HeapUsageSampler sampler(GetOptions());
+    sampler.AddTarget("S1", "iframe,\"q\"\n");
+    sampler.GetDueTargets(0);
+    sampler.OnSample("S1", 0, 1000, 2000);
+    sampler.GetDueTargets(1000);
+    sampler.OnSample("S1", 1000, 1500, 2000);
+    std::string json = sampler.ExportJson();
+    CHECK(json.find("\"label\":\"iframe,\\\"q\\\"\\u000a\"") != std::string::npos);
+    CHECK(json.find("\"samples\":[[0,1000,2000],[1000,1500,2000]]") != std::string::npos);
+    CHECK(json.find("\"bytesPerSecond\":500") != std::string::npos);
+}
+} // namespace
+
+int main()
+{
+    TestFitSlope();
+    TestLinearGrowthIsFlagged();
+    TestNoisyFlatHeapIsNotFlagged();
+    TestSawtoothIsNotFlagged();
+    TestSlowGrowthIsNotFlagged();
+    TestLeakThatStopsIsClearedByTheWindow();
+    TestScheduling();
+    TestExportJson();
+    return FinishTests("HeapUsageSamplerTests");
+}
@@ -0,0 +1,230 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Fills a HistoryIndex with a year of synthetic browsing, popular sites far
+// more often than the rest, then replays address bar queries as they are
+// typed: every prefix of a URL or title word of a page picked by popularity,
+// and some text that matches nothing. Reports the latency distribution of the
+// queries and checks a sample of them against a scan of every page:
+//     HistoryIndexBench [page count] [query count]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HdrHistogram.h"
+#include "HistoryIndex.h"
+
+namespace
+{
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+struct Page
+{
+    std::string url;
+    std::string title;
+    // The score HistoryIndex should have for the page, computed the same way.
+    double score = 0;
+    bool visited = false;
+    std::vector<std::string> keys;
+};
+
+std::string MakeWord(std::mt19937& random)
+{
+    static const char c_consonants[] = "bcdfghjklmnprstvwz";
+    static const char c_vowels[] = "aeiou";
+    std::string word;
+    size_t syllables = 1 + random() % 3;
+    for (size_t i = 0; i < syllables; i++)
+    {
+        word += c_consonants[random() % (sizeof(c_consonants) - 1)];
+        word += c_vowels[random() % (sizeof(c_vowels) - 1)];
+    }
+    return word;
+}
+
+// The keys HistoryIndex indexes a page under: its normalized URL and each of
+// the first 16 title words of two or more characters.
+std::vector<std::string> GetKeys(const Page& page)
+{
+    std::vector<std::string> keys = {HistoryIndex::NormalizeUrl(page.url)};
+    std::string word;
+    for (size_t i = 0; i <= page.title.size() && keys.size() <= 16; i++)
+    {
+        char c = i < page.title.size() ? page.title[i] : ' ';
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            continue;
+        }
+        if (word.size() >= 2)
+        {
+            keys.push_back(word);
+        }
+        word.clear();
+    }
+    return keys;
+}
+
+// The best `count` scores of the pages matching `text`, by scanning them all.
+std::vector<double> ScanScores(
+    const std::vector<Page>& pages, const std::string& text, size_t count)
+{
+    std::string normalized = HistoryIndex::NormalizeUrl(text);
+    std::vector<double> scores;
+    // A scheme alone matches nothing.
+    if (normalized.empty())
+    {
+        return scores;
+    }
+    for (const Page& page : pages)
+    {
+        bool matches = false;
+        for (const std::string& key : page.keys)
+        {
+            matches = matches || key.compare(0, normalized.size(), normalized) == 0;
+        }
+        if (page.visited && matches)
+        {
+            scores.push_back(page.score);
+        }
+    }
+    std::sort(scores.begin(), scores.end(), std::greater<double>());
+    scores.resize((std::min)(scores.size(), count));
+    return scores;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t pageCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+    size_t queryCount = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 1000000;
+    std::mt19937 random(1);
+
+    std::vector<std::string> vocabulary(5000);
+    for (std::string& word : vocabulary)
+    {
+        word = MakeWord(random);
+    }
+    // Sites and words are popular by Zipf's law.
+    auto zipf = [&random](size_t n)
+    { return static_cast<size_t>(std::pow(double(n), double(random()) / random.max())) - 1; };
+
+    std::vector<Page> pages(pageCount);
+    size_t siteCount = (std::max)(size_t(1), pageCount / 20);
+    for (size_t i = 0; i < pageCount; i++)
+    {
+        Page& page = pages[i];
+        size_t site = zipf(siteCount);
+        std::string host = vocabulary[site % vocabulary.size()] + std::to_string(site) + ".com";
+        std::string scheme = random() % 2 ? "https://www." : "https://";
+        page.url = scheme + host + "/" + MakeWord(random) + "/" + std::to_string(i);
+        size_t words = 2 + random() % 8;
+        for (size_t w = 0; w < words; w++)
+        {
+            page.title += (w ? " " : "") + vocabulary[zipf(vocabulary.size())];
+            if (w == 0)
+            {
+                page.title[0] = static_cast<char>(std::toupper(page.title[0]));
+            }
+        }
+        page.keys = GetKeys(page);
+    }
+
+    // A year of visits, a tenth of them typed.
+    HistoryIndex index;
+    constexpr int64_t c_yearSeconds = 365 * 24 * 60 * 60;
+    size_t visitCount = pageCount * 5;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t v = 0; v < visitCount; v++)
+    {
+        Page& page = pages[zipf(pageCount)];
+        int64_t now = static_cast<int64_t>(v * c_yearSeconds / visitCount);
+        bool typed = random() % 10 == 0;
+        index.AddVisit(page.url, page.title, now, typed);
+        double visit = std::log(typed ? HistoryIndex::c_typedVisitWeight : 1.0) +
+                       now * (std::log(2.0) / HistoryIndex::c_halfLifeSeconds);
+        page.score = page.visited ? (std::max)(page.score, visit) +
+                                        std::log1p(std::exp(-std::fabs(page.score - visit)))
+                                  : visit;
+        page.visited = true;
+    }
+    double addSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Every prefix of what the user goes on to type, as each key is pressed.
+    std::vector<std::string> queries;
+    queries.reserve(queryCount);
+    while (queries.size() < queryCount)
+    {
+        std::string text;
+        if (random() % 20 == 0)
+        {
+            text = "zq" + MakeWord(random);
+        }
+        else
+        {
+            const Page& page = pages[zipf(pageCount)];
+            text = page.keys[random() % page.keys.size()];
+            if (random() % 4 == 0 && text.size() > 4)
+            {
+                text = std::string(page.url, 0, page.url.find('/', 8));
+            }
+        }
+        for (size_t length = 1; length <= text.size() && queries.size() < queryCount; length++)
+        {
+            queries.push_back(text.substr(0, length));
+        }
+    }
+
+    constexpr size_t c_suggestionCount = 8;
+    HdrHistogram latency;
+    size_t suggestions = 0;
+    bool ok = true;
+    for (size_t q = 0; q < queries.size(); q++)
+    {
+        auto queryStart = std::chrono::steady_clock::now();
+        std::vector<HistoryIndex::Suggestion> results =
+            index.Query(queries[q], c_suggestionCount);
+        auto elapsed = std::chrono::steady_clock::now() - queryStart;
+        latency.Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        suggestions += results.size();
+        if (q % 2000 == 0)
+        {
+            std::vector<double> expected = ScanScores(pages, queries[q], c_suggestionCount);
+            bool same = expected.size() == results.size();
+            for (size_t i = 0; same && i < results.size(); i++)
+            {
+                same = std::fabs(results[i].score - expected[i]) < 1e-9;
+            }
+            ok = Check(same, ("Wrong suggestions for " + queries[q]).c_str()) && ok;
+        }
+    }
+
+    std::printf(
+        "%zu pages, %zu visits in %.0f ns each, %zu trie nodes\n"
+        "%zu queries, %.1f suggestions each, latency in us: mean %.2f, p50 %.2f, p90 %.2f, "
+        "p99 %.2f, p99.9 %.2f, max %.2f\n",
+        index.GetEntryCount(), visitCount, addSeconds * 1e9 / visitCount, index.GetNodeCount(),
+        queries.size(), double(suggestions) / queries.size(), latency.GetMean() / 1e3,
+        latency.GetValueAtPercentile(50) / 1e3, latency.GetValueAtPercentile(90) / 1e3,
+        latency.GetValueAtPercentile(99) / 1e3, latency.GetValueAtPercentile(99.9) / 1e3,
+        latency.GetMax() / 1e3);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "KeyMap.h"
+#include "TestUtil.h"
+
+namespace
+{
+using ActionId = KeyMap::ActionId;
+
+uint16_t Keystroke(uint8_t key, uint8_t modifiers)
+{
+    return static_cast<uint16_t>(key * 8 + modifiers);
+}
+
+ActionId PressAll(
+    const KeyMap::Layout& layout, KeyMap::ChordState* chord,
+    std::initializer_list<std::pair<uint8_t, uint8_t>> keystrokes)
+{
+    ActionId action = KeyMap::c_noAction;
+    for (const auto& keystroke : keystrokes)
+    {
+        action = KeyMap::Press(layout, chord, keystroke.first, keystroke.second);
+    }
+    return action;
+}
+
+void TestParse()
+{
+    KeyMap map;
+    std::istringstream config(
+        "# Comment\n"
+        "Ctrl+W = close-webview\n"
+        "  control+shift+f5 = reload  \n"
+        "Alt+0x7B = devtools\n"
+        "Ctrl+Plus = zoom-in\n"
+        "Ctrl+K Ctrl+D = format\n"
+        "Ctrl+Super+X = nothing\n"
+        "F25 = nothing\n"
+        "Ctrl+A Ctrl+B Ctrl+C = nothing\n"
+        "Shift = nothing\n"
+        "Ctrl+E\n"
+        "[https://Example.com/page]\n"
+        "Ctrl+W = none\n"
+        "[not an origin]\n"
+        "[*]\n"
+        "Esc = stop\n");
+    std::vector<size_t> badLines;
+    CHECK(map.Load(config, &badLines) == 7);
+    CHECK((badLines == std::vector<size_t>{7, 8, 9, 10, 11, 14}));
+    CHECK(map.GetActionCount() == 7);
+    CHECK(map.GetActionName(map.GetActionId("reload")) == "reload");
+    CHECK(map.GetActionId("nothing") == KeyMap::c_noAction);
+    CHECK(map.GetActionName(1000) == "none");
+
+    CHECK(KeyMap::ParseKey("f12") == 0x7B && KeyMap::ParseKey("0x7b") == 0x7B);
+    CHECK(KeyMap::ParseKey("a") == 'A' && KeyMap::ParseKey("ESCAPE") == 0x1B);
+    CHECK(KeyMap::ParseKey("F0") == 0 && KeyMap::ParseKey("0x100") == 0);
+    CHECK(KeyMap::ParseKey("F1x") == 0 && KeyMap::ParseKey("Enterprise") == 0);
+    CHECK(KeyMap::GetOrigin("HTTPS://Example.COM:8443/a?b#c") == "https://example.com:8443");
+    CHECK(KeyMap::GetOrigin("https://") == "" && KeyMap::GetOrigin("about:blank") == "");
+
+    const KeyMap::Layout& layout = map.GetLayout("https://other.example/");
+    KeyMap::ChordState chord;
+    CHECK(map.GetActionName(KeyMap::Press(layout, &chord, 0x74, KeyMap::Control |
+                                                                   KeyMap::Shift)) == "reload");
+    CHECK(map.GetActionName(KeyMap::Press(layout, &chord, 0x7B, KeyMap::Alt)) == "devtools");
+    CHECK(map.GetActionName(KeyMap::Press(layout, &chord, 0xBB, KeyMap::Control)) == "zoom-in");
+    CHECK(map.GetActionName(KeyMap::Press(layout, &chord, 0x1B, KeyMap::None)) == "stop");
+    // Only the given modifiers match.
+    CHECK(KeyMap::Press(layout, &chord, 'W', KeyMap::Control | KeyMap::Alt) ==
+          KeyMap::c_noAction);
+}
+
+void TestLayers()
+{
+    KeyMap map;
+    CHECK(map.Bind("", "Ctrl+W", "close-webview"));
+    CHECK(map.Bind("", "Ctrl+S", "screenshot"));
+    CHECK(map.Bind("https://example.com", "Ctrl+W", "none"));
+    CHECK(map.Bind("https://example.com", "Ctrl+S", "save-page"));
+    CHECK(!map.Bind("", "Ctrl+Q", ""));
+    ActionId closeWebView = map.GetActionId("close-webview");
+    ActionId savePage = map.GetActionId("save-page");
+
+    const KeyMap::Layout& defaults = map.GetLayout("https://other.example/");
+    const KeyMap::Layout& example = map.GetLayout("HTTPS://EXAMPLE.com/a/b");
+    KeyMap::ChordState chord;
+    CHECK(KeyMap::Press(defaults, &chord, 'W', KeyMap::Control) == closeWebView);
+    CHECK(KeyMap::Press(example, &chord, 'W', KeyMap::Control) == KeyMap::c_noAction);
+    CHECK(KeyMap::Press(example, &chord, 'S', KeyMap::Control) == savePage);
+    // Origins without a layer, and URIs without an origin, share a layout.
+    CHECK(&map.GetLayout("https://third.example") == &defaults);
+    CHECK(&map.GetLayout("about:blank") == &defaults);
+    CHECK(&map.GetLayout("https://example.com/other") == &example);
+
+    // A new binding applies to the layouts from then on.
+    CHECK(map.Bind("", "Ctrl+T", "new-thread"));
+    const KeyMap::Layout& updated = map.GetLayout("https://example.com");
+    CHECK(KeyMap::Press(updated, &chord, 'T', KeyMap::Control) ==
+          map.GetActionId("new-thread"));
+}
+
+void TestChords()
+{
+    KeyMap map;
+    CHECK(map.Bind("", "Ctrl+K Ctrl+D", "format"));
+    CHECK(map.Bind("", "Ctrl+K D", "delete-line"));
+    CHECK(map.Bind("", "Ctrl+J Ctrl+J", "join"));
+    CHECK(map.Bind("", "Ctrl+D", "duplicate"));
+    CHECK(map.Bind("https://example.com", "Ctrl+L Ctrl+L", "select-line"));
+    CHECK(map.Bind("https://example.com", "Ctrl+M Ctrl+M", "mark"));
+    const KeyMap::Layout& layout = map.GetLayout("");
+    KeyMap::ChordState chord;
+
+    CHECK(KeyMap::Press(layout, &chord, 'K', KeyMap::Control) == KeyMap::c_chordPending);
+    // Releasing and pressing Ctrl again, or pressing Shift, keeps the chord.
+    CHECK(KeyMap::Press(layout, &chord, 0x11, KeyMap::Control) == KeyMap::c_chordPending);
+    CHECK(KeyMap::Press(layout, &chord, 0xA0, KeyMap::Shift) == KeyMap::c_chordPending);
+    CHECK(KeyMap::Press(layout, &chord, 'D', KeyMap::Control) == map.GetActionId("format"));
+    CHECK(PressAll(layout, &chord, {{'K', KeyMap::Control}, {'D', KeyMap::None}}) ==
+          map.GetActionId("delete-line"));
+    // An unbound second keystroke ends the chord without an action, and is
+    // not looked up on its own.
+    CHECK(PressAll(layout, &chord, {{'K', KeyMap::Control}, {'J', KeyMap::Control}}) ==
+          KeyMap::c_noAction);
+    CHECK(chord.prefix == KeyMap::c_noAction);
+    CHECK(KeyMap::Press(layout, &chord, 'D', KeyMap::Control) == map.GetActionId("duplicate"));
+    // Modifier presses without a chord do nothing.
+    CHECK(KeyMap::Press(layout, &chord, 0x11, KeyMap::Control) == KeyMap::c_noAction);
+
+    // A chord started on a layout with more chords than the current one.
+    const KeyMap::Layout& example = map.GetLayout("https://example.com");
+    CHECK(KeyMap::Press(example, &chord, 'M', KeyMap::Control) == KeyMap::c_chordPending);
+    CHECK(KeyMap::Press(layout, &chord, 'M', KeyMap::Control) == KeyMap::c_noAction);
+    CHECK(chord.prefix == KeyMap::c_noAction);
+}
+
+// What a keystroke of a layout is bound to: an action, or a chord with the
+// actions of its second keystrokes.
+struct ExpectedEntry
+{
+    std::string action = "none";
+    bool chord = false;
+    std::map<uint16_t, std::string> second;
+};
+
+struct ExpectedBinding
+{
+    std::vector<uint16_t> keystrokes;
+    std::string action;
+};
+
+using ExpectedLayout = std::map<uint16_t, ExpectedEntry>;
+
+// Later bindings win; a single keystroke replaces a chord of the same first
+// keystroke, whose second keystrokes are then forgotten.
+void ApplyExpected(const std::vector<ExpectedBinding>& bindings, ExpectedLayout* layout)
+{
+    for (const ExpectedBinding& binding : bindings)
+    {
+        ExpectedEntry& entry = (*layout)[binding.keystrokes[0]];
+        if (binding.keystrokes.size() == 1)
+        {
+            entry = ExpectedEntry();
+            entry.action = binding.action;
+            continue;
+        }
+        if (!entry.chord)
+        {
+            entry = ExpectedEntry();
+            entry.chord = true;
+        }
+        entry.second[binding.keystrokes[1]] = binding.action;
+    }
+}
+
+std::string FormatKeystroke(uint16_t keystroke, std::mt19937& random)
+{
+    static const char* const c_control[] = {"Ctrl", "ctrl", "Control"};
+    uint8_t key = static_cast<uint8_t>(keystroke / 8);
+    std::string text;
+    if (keystroke & KeyMap::Shift)
+    {
+        text += random() % 2 ? "Shift+" : "SHIFT+";
+    }
+    if (keystroke & KeyMap::Control)
+    {
+        text += c_control[random() % 3] + std::string("+");
+    }
+    if (keystroke & KeyMap::Alt)
+    {
+        text += "Alt+";
+    }
+    char name[8];
+    if ((key >= 'A' && key <= 'Z') || (key >= '0' && key <= '9'))
+    {
+        std::snprintf(name, sizeof(name), "%c", random() % 2 ? key : std::tolower(key));
+    }
+    else if (key >= 0x70 && key <= 0x87)
+    {
+        std::snprintf(name, sizeof(name), "F%d", key - 0x6F);
+    }
+    else
+    {
+        std::snprintf(name, sizeof(name), "0x%X", key);
+    }
+    return text + name;
+}
+
+// Replays random keystrokes, with navigations between origins, through the
+// layouts of a random config and checks each against the bindings.
+void TestKeystrokeReplay()
+{
+    std::mt19937 random(1);
+    // Few enough keys that bindings often replace each other.
+    std::vector<uint8_t> keys = {'A', 'D', 'K', 'W', '1', '9', 0x70, 0x74, 0x7B, 0x87,
+                                 0x1B, 0x25, 0x2E, 0xBB, 0xBD, 0x09, 0x0D, 0x20};
+    auto randomKeystroke = [&]
+    { return Keystroke(keys[random() % keys.size()], static_cast<uint8_t>(random() % 8)); };
+    const std::vector<std::string> origins = {"", "https://a.example", "https://b.example",
+                                              "http://b.example:8080", "https://c.example"};
+
+    std::map<std::string, std::vector<ExpectedBinding>> layers;
+    std::string config;
+    size_t bindingCount = 0;
+    for (size_t o = 0; o < origins.size(); o++)
+    {
+        if (o > 0)
+        {
+            // Sections name an origin by any URI of it, in any case.
+            std::string section = origins[o] + (random() % 2 ? "/some/page?q" : "");
+            for (size_t c = 0; c < 3; c++)
+            {
+                char& letter = section[random() % section.size()];
+                letter = static_cast<char>(toupper(static_cast<unsigned char>(letter)));
+            }
+            config += "[" + section + "]\n";
+        }
+        size_t count = o == 0 ? 300 : 60;
+        for (size_t b = 0; b < count; b++, bindingCount++)
+        {
+            ExpectedBinding binding;
+            binding.keystrokes.push_back(randomKeystroke());
+            if (random() % 3 == 0)
+            {
+                binding.keystrokes.push_back(randomKeystroke());
+            }
+            binding.action = random() % 10 == 0 ? "none" : "action-" +
+                                                                std::to_string(random() % 50);
+            config += FormatKeystroke(binding.keystrokes[0], random);
+            if (binding.keystrokes.size() == 2)
+            {
+                config += " " + FormatKeystroke(binding.keystrokes[1], random);
+            }
+            config += " = " + binding.action + "\n";
+            layers[origins[o]].push_back(binding);
+        }
+    }
+    KeyMap map;
+    std::istringstream input(config);
+    std::vector<size_t> badLines;
+    CHECK(map.Load(input, &badLines) == bindingCount && badLines.empty());
+
+    std::map<std::string, ExpectedLayout> expected;
+    for (const std::string& origin : origins)
+    {
+        ApplyExpected(layers[""], &expected[origin]);
+        if (!origin.empty())
+        {
+            ApplyExpected(layers[origin], &expected[origin]);
+        }
+    }
+
+    constexpr size_t c_keystrokeCount = 1000000;
+    size_t mismatches = 0;
+    size_t actions = 0;
+    size_t chords = 0;
+    double pressSeconds = 0;
+    size_t page = 0;
+    const KeyMap::Layout* layout = &map.GetLayout("");
+    KeyMap::ChordState chord;
+    const ExpectedEntry* pendingChord = nullptr;
+    for (size_t i = 0; i < c_keystrokeCount; i++)
+    {
+        if (random() % 50 == 0)
+        {
+            // Navigating ends any chord, as the focus moves to the new page.
+            page = random() % (origins.size() + 1);
+            std::string uri = page < origins.size() ? origins[page] + "/index.html"
+                                                    : "https://unbound.example/";
+            layout = &map.GetLayout(uri);
+            chord = KeyMap::ChordState();
+            pendingChord = nullptr;
+        }
+        const ExpectedLayout& expectedLayout =
+            expected[page < origins.size() ? origins[page] : ""];
+
+        // Mostly a second keystroke of the pending chord or a bound
+        // keystroke, sometimes a modifier or any key.
+        uint16_t keystroke = randomKeystroke();
+        uint32_t roll = random() % 10;
+        if (roll < 2)
+        {
+            static const uint8_t c_modifierKeys[] = {0x10, 0x11, 0x12, 0xA0, 0xA1, 0xA4};
+            keystroke = Keystroke(c_modifierKeys[random() % 6], KeyMap::Control);
+        }
+        else if (roll < 3)
+        {
+            keystroke = Keystroke(static_cast<uint8_t>(1 + random() % 255), random() % 8);
+        }
+        else if (pendingChord && !pendingChord->second.empty() && roll < 8)
+        {
+            auto second = pendingChord->second.begin();
+            std::advance(second, random() % pendingChord->second.size());
+            keystroke = second->first;
+        }
+        uint8_t key = static_cast<uint8_t>(keystroke / 8);
+        uint8_t modifiers = static_cast<uint8_t>(keystroke % 8);
+
+        std::string expectedAction = "none";
+        bool expectPending = false;
+        if ((key >= 0x10 && key <= 0x12) || (key >= 0xA0 && key <= 0xA5))
+        {
+            expectPending = pendingChord != nullptr;
+        }
+        else if (pendingChord)
+        {
+            auto second = pendingChord->second.find(keystroke);
+            expectedAction = second == pendingChord->second.end() ? "none" : second->second;
+            pendingChord = nullptr;
+        }
+        else
+        {
+            auto entry = expectedLayout.find(keystroke);
+            if (entry != expectedLayout.end())
+            {
+                expectPending = entry->second.chord;
+                expectedAction = entry->second.action;
+                pendingChord = entry->second.chord ? &entry->second : nullptr;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ActionId action = KeyMap::Press(*layout, &chord, key, modifiers);
+        pressSeconds +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool same = expectPending ? action == KeyMap::c_chordPending
+                                  : action != KeyMap::c_chordPending &&
+                                        map.GetActionName(action) == expectedAction;
+        mismatches += same ? 0 : 1;
+        actions += action != KeyMap::c_noAction && action != KeyMap::c_chordPending ? 1 : 0;
+        chords += action == KeyMap::c_chordPending ? 1 : 0;
+    }
+    CHECK(mismatches == 0);
+    // The replay covers actions and chords alike.
+    CHECK(actions > c_keystrokeCount / 10 && chords > c_keystrokeCount / 20);
+    std::printf(
+        "KeyMapTests: %zu keystrokes, %zu actions, %zu chord prefixes, %.0f ns per keystroke "
+        "with the clock reads\n",
+        c_keystrokeCount, actions, chords, pressSeconds * 1e9 / c_keystrokeCount);
+}
+} // namespace
+
+int main()
+{
+    TestParse();
+    TestLayers();
+    TestChords();
+    TestKeystrokeReplay();
+    return FinishTests("KeyMapTests");
+}
@@ -0,0 +1,337 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Feeds the navigation events of a million synthetic navigations, from 16
+// WebViews at once, to a NavigationTimingCollector: main frame and frame
+// navigations to hundreds of origins, with redirects, failures, pages served
+// from the back/forward cache, and navigations whose events stop coming.
+// Checks the counters and every origin's exported counts and percentiles
+// against exact statistics of the simulated times, and reports the time per
+// event and per export:
+//     NavigationTimingCollectorBench [navigation count]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "NavigationTimingCollector.h"
+
+namespace
+{
+using Phase = NavigationTimingCollector::Phase;
+constexpr size_t c_phaseCount = static_cast<size_t>(Phase::Count);
+
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+enum class EventType
+{
+    Starting,
+    ContentLoading,
+    DOMContentLoaded,
+    Completed,
+    Failed,
+};
+
+struct Event
+{
+    uint64_t time;
+    uint64_t navigationId;
+    uint32_t source;
+    uint32_t uri;
+    EventType type;
+    bool isFrame;
+};
+
+// The exact times the collector should have aggregated, per origin.
+struct ExpectedOrigin
+{
+    std::array<std::vector<uint64_t>, c_phaseCount> phases;
+};
+
+// A WebView that navigates again some time after each navigation ends.
+struct Source
+{
+    // The collector takes a time of 0 for an event that didn't happen.
+    uint64_t nextStart = 1;
+    uint64_t nextNavigationId = 1;
+};
+
+// Lognormal times around `medianMicros`.
+uint64_t DrawMicros(std::mt19937& random, double medianMicros)
+{
+    std::normal_distribution<double> normal(0, 0.6);
+    return 1 + static_cast<uint64_t>(medianMicros * std::exp(normal(random)));
+}
+
+// The value at `percentile` of sorted `values`, as HdrHistogram defines it.
+uint64_t GetPercentile(const std::vector<uint64_t>& values, double percentile)
+{
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100 * values.size()));
+    return values[(std::max)(rank, size_t(1)) - 1];
+}
+
+// Within the histogram's precision and the export's rounding to 1 us.
+bool IsClose(double exportedMs, uint64_t exactMicros)
+{
+    return std::fabs(exportedMs * 1000 - double(exactMicros)) <= exactMicros / 50.0 + 1;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t navigationCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000000;
+    std::mt19937 random(1);
+    NavigationTimingCollector::Limits limits;
+    NavigationTimingCollector collector(limits);
+
+    // Origins differ in case and port, which GetOrigin folds or keeps.
+    std::vector<std::string> uris;
+    std::vector<std::string> originOfUri;
+    for (int site = 0; site < 300; site++)
+    {
+        for (const char* form : {"https://site%d.example/", "HTTPS://Site%d.Example/a?b",
+                                 "https://site%d.example:8443/", "http://site%d.example/"})
+        {
+            char uri[64];
+            std::snprintf(uri, sizeof(uri), form, site);
+            uris.push_back(uri);
+            originOfUri.push_back(NavigationTimingCollector::GetOrigin(uri));
+        }
+    }
+    uris.push_back("about:blank");
+    originOfUri.push_back(NavigationTimingCollector::GetOrigin(uris.back()));
+    // Popular sites first: a few sites get most navigations.
+    std::geometric_distribution<size_t> popularity(0.02);
+
+    std::map<std::string, ExpectedOrigin> expected;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t abandoned = 0;
+    auto getExpected = [&](uint32_t uri) -> ExpectedOrigin&
+    {
+        const std::string& origin = originOfUri[uri];
+        auto it = expected.find(origin);
+        if (it != expected.end())
+        {
+            return it->second;
+        }
+        return expected[expected.size() >= limits.maxOrigins ? "(other)" : origin];
+    };
+
+    std::vector<Source> sources(16);
+    std::vector<Event> events;
+    size_t eventCount = 0;
+    double feedSeconds = 0;
+    for (size_t generated = 0; generated < navigationCount;)
+    {
+        // Navigations in batches, their events in time order across sources.
+        events.clear();
+        for (size_t batch = 0; batch < 50000 && generated < navigationCount;
+             batch++, generated++)
+        {
+            auto source = std::min_element(
+                sources.begin(), sources.end(),
+                [](const Source& a, const Source& b) { return a.nextStart < b.nextStart; });
+            uint32_t sourceId = static_cast<uint32_t>(source - sources.begin());
+            uint64_t id = source->nextNavigationId++;
+            bool isFrame = random() % 10 < 3;
+            uint32_t uri = static_cast<uint32_t>(
+                random() % 50 == 0 ? uris.size() - 1
+                                   : (std::min)(popularity(random), size_t(299)) * 4 +
+                                         random() % 4);
+            uint64_t start = source->nextStart;
+            auto add = [&](uint64_t time, EventType type, uint32_t eventUri)
+            { events.push_back({time, id, sourceId, eventUri, type, isFrame}); };
+            add(start, EventType::Starting, uri);
+            ExpectedOrigin& origin = getExpected(uri);
+
+            uint64_t time = start;
+            if (random() % 20 == 0)
+            {
+                // A redirect to another site keeps the first origin.
+                time += DrawMicros(random, 30000);
+                add(time, EventType::Starting, static_cast<uint32_t>(random() % uris.size()));
+            }
+            uint32_t roll = random() % 1000;
+            if (roll < 10)
+            {
+                // The rest of its events never arrive.
+                abandoned++;
+                source->nextStart = time + DrawMicros(random, 500000);
+                continue;
+            }
+            uint64_t end = time;
+            if (roll < 40)
+            {
+                end += DrawMicros(random, 200000);
+                add(end, EventType::Failed, uri);
+                failed++;
+            }
+            else if (isFrame)
+            {
+                end += DrawMicros(random, 150000);
+                add(end, EventType::Completed, uri);
+                origin.phases[static_cast<size_t>(Phase::FrameTotal)].push_back(end - start);
+                completed++;
+            }
+            else if (roll < 100)
+            {
+                // Served from the back/forward cache: no loading events.
+                end += DrawMicros(random, 5000);
+                add(end, EventType::Completed, uri);
+                origin.phases[static_cast<size_t>(Phase::Total)].push_back(end - start);
+                completed++;
+            }
+            else
+            {
+                uint64_t contentLoading = time + DrawMicros(random, 120000);
+                uint64_t domContentLoaded = contentLoading + DrawMicros(random, 250000);
+                end = domContentLoaded + DrawMicros(random, 400000);
+                add(contentLoading, EventType::ContentLoading, uri);
+                add(domContentLoaded, EventType::DOMContentLoaded, uri);
+                add(end, EventType::Completed, uri);
+                auto& phases = origin.phases;
+                phases[static_cast<size_t>(Phase::StartToContentLoading)].push_back(
+                    contentLoading - start);
+                phases[static_cast<size_t>(Phase::ContentLoadingToDOMContentLoaded)].push_back(
+                    domContentLoaded - contentLoading);
+                phases[static_cast<size_t>(Phase::DOMContentLoadedToCompleted)].push_back(
+                    end - domContentLoaded);
+                phases[static_cast<size_t>(Phase::Total)].push_back(end - start);
+                completed++;
+            }
+            source->nextStart = end + DrawMicros(random, 500000);
+        }
+        std::stable_sort(
+            events.begin(), events.end(),
+            [](const Event& a, const Event& b) { return a.time < b.time; });
+        // The start times of a batch's last navigations can be later than
+        // the next batch's first, so the next batch starts after this one.
+        uint64_t batchEnd = events.back().time;
+        for (Source& source : sources)
+        {
+            source.nextStart = (std::max)(source.nextStart, batchEnd + 1);
+        }
+
+        auto feedStart = std::chrono::steady_clock::now();
+        for (const Event& event : events)
+        {
+            switch (event.type)
+            {
+            case EventType::Starting:
+                collector.OnStarting(
+                    event.source, event.navigationId, uris[event.uri], event.isFrame,
+                    event.time);
+                break;
+            case EventType::ContentLoading:
+                collector.OnContentLoading(event.source, event.navigationId, event.time);
+                break;
+            case EventType::DOMContentLoaded:
+                collector.OnDOMContentLoaded(event.source, event.navigationId, event.time);
+                break;
+            case EventType::Completed:
+            case EventType::Failed:
+                collector.OnCompleted(
+                    event.source, event.navigationId, event.type == EventType::Completed,
+                    event.time);
+                break;
+            }
+        }
+        feedSeconds +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - feedStart).count();
+        eventCount += events.size();
+    }
+
+    const NavigationTimingCollector::Counters& counters = collector.GetCounters();
+    bool ok = Check(counters.completed == completed, "Completed navigations went missing.") &&
+              Check(counters.failed == failed, "Failed navigations went missing.") &&
+              Check(counters.unmatched == 0, "Events didn't find their navigation.") &&
+              Check(
+                  counters.dropped + collector.GetPendingCount() == abandoned,
+                  "Abandoned navigations weren't dropped.") &&
+              Check(collector.GetPendingCount() <= limits.maxPending, "Too much is pending.") &&
+              Check(
+                  collector.GetOriginCount() == expected.size() &&
+                      expected.size() == limits.maxOrigins + 1,
+                  "The origins don't match.");
+
+    auto exportStart = std::chrono::steady_clock::now();
+    std::string json = collector.ExportJson();
+    double jsonSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStart).count();
+    std::string csv = collector.ExportCsv();
+    ok = Check(json.size() > 2 && json.find("\"(other)\"") != std::string::npos,
+               "The JSON export is missing origins.") &&
+         ok;
+
+    // origin,phase,count,minMs,meanMs,p50Ms,p90Ms,p99Ms,maxMs
+    std::istringstream lines(csv);
+    std::string line;
+    std::getline(lines, line);
+    size_t rows = 0;
+    while (std::getline(lines, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream cells(line);
+        std::string cell;
+        while (std::getline(cells, cell, ','))
+        {
+            fields.push_back(cell);
+        }
+        auto origin = expected.find(fields[0]);
+        size_t phase = 0;
+        while (phase < c_phaseCount &&
+               fields[1] != NavigationTimingCollector::GetPhaseName(static_cast<Phase>(phase)))
+        {
+            phase++;
+        }
+        if (!Check(fields.size() == 9 && origin != expected.end() && phase < c_phaseCount,
+                   "The CSV export has an unknown row."))
+        {
+            ok = false;
+            continue;
+        }
+        std::vector<uint64_t>& values = origin->second.phases[phase];
+        std::sort(values.begin(), values.end());
+        ok = Check(std::stoull(fields[2]) == values.size(), "A phase count is off.") &&
+             Check(IsClose(std::stod(fields[3]), values.front()), "A minimum is off.") &&
+             Check(IsClose(std::stod(fields[5]), GetPercentile(values, 50)), "A p50 is off.") &&
+             Check(IsClose(std::stod(fields[6]), GetPercentile(values, 90)), "A p90 is off.") &&
+             Check(IsClose(std::stod(fields[7]), GetPercentile(values, 99)), "A p99 is off.") &&
+             Check(IsClose(std::stod(fields[8]), values.back()), "A maximum is off.") && ok;
+        rows++;
+    }
+    size_t expectedRows = 0;
+    for (const auto& origin : expected)
+    {
+        for (const std::vector<uint64_t>& values : origin.second.phases)
+        {
+            expectedRows += values.empty() ? 0 : 1;
+        }
+    }
+    ok = Check(rows == expectedRows, "The CSV export is missing rows.") && ok;
+
+    std::printf(
+        "%zu navigations, %zu events in %.0f ns each, %llu dropped, %zu origins, "
+        "JSON export of %zu bytes in %.0f us\n",
+        navigationCount, eventCount, feedSeconds * 1e9 / eventCount,
+        static_cast<unsigned long long>(counters.dropped), collector.GetOriginCount(),
+        json.size(), jsonSeconds * 1e6);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Submits notifications from growing numbers of origins to a
+// NotificationScheduler on a simulated clock, a quarter of them tagged, while
+// presenting and removing them as a host would, and reports the throughput:
+//     NotificationSchedulerBench [notification count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "NotificationScheduler.h"
+
+int main(int argc, char** argv)
+{
+    uint64_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    std::printf(
+        "%8s %12s %12s %10s %10s %10s %8s\n", "origins", "ns/submit", "submits/s", "queued",
+        "merged", "dropped", "buckets");
+    for (size_t originCount : {1, 100, 10000, 1000000})
+    {
+        std::vector<std::wstring> origins;
+        for (size_t i = 0; i < originCount && i < count; i++)
+        {
+            origins.push_back(L"https://site" + std::to_wstring(i) + L".example");
+        }
+        std::vector<std::wstring> tags = {L"", L"", L"", L"score"};
+        std::mt19937 random(1);
+        NotificationScheduler scheduler;
+        uint64_t queued = 0;
+        uint64_t nowMs = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t id = 1; id <= count; id++)
+        {
+            // A notification every 100 microseconds.
+            nowMs += id % 10 == 0;
+            const std::wstring& origin = origins[random() % origins.size()];
+            NotificationScheduler::SubmitResult result =
+                scheduler.Submit(id, origin, tags[id % tags.size()], false, nowMs);
+            queued += result.disposition == NotificationScheduler::Disposition::Queued;
+            // Each presented notification is closed a few submits later.
+            if (id % 4 == 0)
+            {
+                scheduler.Remove(scheduler.GetActiveId());
+            }
+            uint64_t presented = 0;
+            scheduler.PresentNext(&presented);
+        }
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const NotificationScheduler::Counters& counters = scheduler.GetCounters();
+        uint64_t dropped = counters.droppedRateLimited + counters.droppedQueueFull;
+        std::printf(
+            "%8zu %12.1f %12.0f %10llu %10llu %10llu %8zu\n", origins.size(),
+            seconds * 1e9 / count, count / seconds, static_cast<unsigned long long>(queued),
+            static_cast<unsigned long long>(counters.merged),
+            static_cast<unsigned long long>(dropped), scheduler.GetBucketCount());
+        if (counters.received != count || queued + counters.merged + dropped != count)
+        {
+            std::fprintf(stderr, "Notifications went missing.\n");
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "NotificationScheduler.h"
+#include "TestUtil.h"
+
+namespace
+{
+using Disposition = NotificationScheduler::Disposition;
+
+const std::wstring c_origin = L"https://news.example";
+
+void TestRateLimit()
+{
+    NotificationScheduler scheduler;
+    uint64_t id = 1;
+    auto submit = [&](const std::wstring& origin, uint64_t nowMs)
+    { return scheduler.Submit(id++, origin, L"", false, nowMs).disposition; };
+    // The burst is accepted, then one notification per second.
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK(submit(c_origin, 0) == Disposition::Queued);
+    }
+    CHECK(submit(c_origin, 0) == Disposition::RateLimited);
+    CHECK(submit(L"https://other.example", 0) == Disposition::Queued);
+    CHECK(submit(c_origin, 999) == Disposition::RateLimited);
+    CHECK(submit(c_origin, 1000) == Disposition::Queued);
+    CHECK(scheduler.GetCounters().droppedRateLimited == 2);
+
+    // A full queue drops whatever the origin's tokens.
+    NotificationScheduler::Limits limits;
+    limits.maxQueued = 2;
+    NotificationScheduler small(limits);
+    small.Submit(1, c_origin, L"", false, 0);
+    small.Submit(2, c_origin, L"", false, 0);
+    CHECK(small.Submit(3, c_origin, L"", false, 0).disposition == Disposition::QueueFull);
+    uint64_t presented = 0;
+    CHECK(small.PresentNext(&presented) && presented == 1);
+    CHECK(small.Submit(4, c_origin, L"", false, 0).disposition == Disposition::Queued);
+}
+
+void TestReplacement()
+{
+    NotificationScheduler scheduler;
+    scheduler.Submit(1, c_origin, L"score", false, 0);
+    scheduler.Submit(2, c_origin, L"chat", false, 0);
+    // A queued notification is replaced in place.
+    NotificationScheduler::SubmitResult result =
+        scheduler.Submit(3, c_origin, L"score", true, 10);
+    CHECK(result.disposition == Disposition::ReplacedQueued && result.replacedId == 1);
+    // The same tag from another origin is another notification.
+    CHECK(scheduler.Submit(4, L"https://other.example", L"score", false, 10).disposition ==
+          Disposition::Queued);
+    uint64_t id = 0;
+    CHECK(scheduler.PresentNext(&id) && id == 3);
+    CHECK(!scheduler.PresentNext(&id));
+
+    // The active notification is updated silently unless it asks to renotify.
+    result = scheduler.Submit(5, c_origin, L"score", false, 20);
+    CHECK(result.disposition == Disposition::ReplacedActive && result.replacedId == 3);
+    CHECK(scheduler.GetActiveId() == 5);
+    CHECK(scheduler.Submit(6, c_origin, L"score", true, 20).disposition == Disposition::Queued);
+    CHECK(scheduler.GetCounters().merged == 2);
+
+    CHECK(scheduler.Remove(5) && scheduler.GetActiveId() == 0);
+    CHECK(scheduler.Remove(4) && !scheduler.Remove(4));
+    CHECK(scheduler.PresentNext(&id) && id == 2);
+    CHECK(scheduler.GetQueuedCount() == 1);
+}
+
+void TestIdleBucketsDropped()
+{
+    NotificationScheduler scheduler;
+    // A notification from a new origin every 10 ms. A bucket refills in a
+    // second, so about 100 origins have a bucket that isn't full.
+    uint64_t nowMs = 0;
+    size_t mostBuckets = 0;
+    for (uint64_t id = 1; id <= 100000; id++)
+    {
+        nowMs += 10;
+        std::wstring origin = L"https://site" + std::to_wstring(id) + L".example";
+        Disposition disposition = scheduler.Submit(id, origin, L"", false, nowMs).disposition;
+        CHECK(disposition == Disposition::Queued);
+        uint64_t presented = 0;
+        scheduler.PresentNext(&presented);
+        scheduler.Remove(presented);
+        mostBuckets = (std::max)(mostBuckets, scheduler.GetBucketCount());
+    }
+    CHECK(mostBuckets <= 400);
+    std::printf("%zu buckets at most for 100000 origins\n", mostBuckets);
+}
+
+// Pages of a few origins send bursts of tagged and untagged notifications on
+// a simulated clock while the host presents them for a while each. Every
+// notification is accounted for, and no origin gets more accepted than its
+// bucket allows.
+void TestSimulatedClock()
+{
+    NotificationScheduler scheduler;
+    NotificationScheduler::Limits limits;
+    std::mt19937 random(5);
+    constexpr int c_originCount = 4;
+    std::vector<uint64_t> accepted(c_originCount, 0);
+    uint64_t queued = 0;
+    uint64_t nowMs = 0;
+    uint64_t activeUntilMs = 0;
+    uint64_t nextId = 1;
+    for (int step = 0; step < 200000; step++)
+    {
+        // One notification in eight comes in the same burst as the last.
+        nowMs += random() % 8 == 0 ? 0 : 1 + random() % 500;
+        if (scheduler.GetActiveId() != 0 && nowMs >= activeUntilMs)
+        {
+            CHECK(scheduler.Remove(scheduler.GetActiveId()));
+        }
+        uint64_t presented = 0;
+        if (scheduler.PresentNext(&presented))
+        {
+            activeUntilMs = nowMs + 50 + random() % 400;
+        }
+
+        int origin = static_cast<int>(random() % c_originCount);
+        std::wstring tag = random() % 2 ? L"" : L"tag" + std::to_wstring(random() % 3);
+        NotificationScheduler::SubmitResult result = scheduler.Submit(
+            nextId++, L"https://o" + std::to_wstring(origin) + L".example", tag,
+            random() % 4 == 0, nowMs);
+        if (result.disposition == Disposition::Queued)
+        {
+            accepted[origin]++;
+            queued++;
+        }
+        else if (
+            result.disposition == Disposition::ReplacedQueued ||
+            result.disposition == Disposition::ReplacedActive)
+        {
+            CHECK(result.replacedId != 0 && result.replacedId < nextId - 1);
+            CHECK(!tag.empty());
+        }
+        CHECK(scheduler.GetQueuedCount() <= limits.maxQueued);
+    }
+
+    const NotificationScheduler::Counters& counters = scheduler.GetCounters();
+    CHECK(
+        counters.received == queued + counters.merged + counters.droppedRateLimited +
+                                 counters.droppedQueueFull);
+    CHECK(counters.presented <= queued);
+    for (uint64_t count : accepted)
+    {
+        CHECK(count <= limits.burstSize + nowMs / 1000.0 * limits.tokensPerSecond);
+    }
+    std::printf(
+        "%llu received, %llu presented, %llu merged, %llu rate limited, %llu queue full\n",
+        static_cast<unsigned long long>(counters.received),
+        static_cast<unsigned long long>(counters.presented),
+        static_cast<unsigned long long>(counters.merged),
+        static_cast<unsigned long long>(counters.droppedRateLimited),
+        static_cast<unsigned long long>(counters.droppedQueueFull));
+}
+} // namespace
+
+int main()
+{
+    TestRateLimit();
+    TestReplacement();
+    TestIdleBucketsDropped();
+    TestSimulatedClock();
+    return FinishTests("NotificationSchedulerTests");
+}
@@ -0,0 +1,256 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PdfIndexScanner.h"
+#include "PdfStreamSink.h"
+#include "TestUtil.h"
+
+namespace
+{
+// A PDF with its expected index.
+struct SamplePdf
+{
+    std::string data;
+    PdfIndexScanner::Index index;
+};
+
+// Writes a PDF as the print backend does: a catalog, a page tree and the
+// pages, each with a content stream of `streamSize` bytes, then an xref table
+// and its trailer. `updates` appends incremental updates, each with its own
+// xref table. `tight` writes "/Type/Page" without the space.
+SamplePdf MakePdf(
+    int pageCount, size_t streamSize, int updates, bool tight, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    SamplePdf pdf;
+    std::string& data = pdf.data;
+    data = "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n";
+    std::vector<size_t> offsets;
+    auto object = [&](const std::string& body)
+    {
+        offsets.push_back(data.size());
+        data += std::to_string(offsets.size()) + " 0 obj\n" + body + "\nendobj\n";
+    };
+    object("<< /Type /Catalog /Pages 2 0 R >>");
+    std::string kids;
+    for (int page = 0; page < pageCount; page++)
+    {
+        kids += std::to_string(3 + 2 * page) + " 0 R ";
+    }
+    object(
+        "<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(pageCount) + " >>");
+    for (int page = 0; page < pageCount; page++)
+    {
+        object(
+            std::string(tight ? "<</Type/Page" : "<< /Type /Page") +
+            " /Parent 2 0 R /MediaBox [0 0 612 792] /Contents " +
+            std::to_string(4 + 2 * page) + " 0 R >>");
+        // Binary content that may contain anything but the keywords.
+        std::string stream(streamSize, '\0');
+        for (char& c : stream)
+        {
+            c = static_cast<char>(random() % 256);
+            if (c == '/' || c == 'x' || c == 's' || c == '%')
+            {
+                c = ' ';
+            }
+        }
+        object(
+            "<< /Length " + std::to_string(streamSize) + " >>\nstream\n" + stream +
+            "\nendstream");
+        pdf.index.pageCount++;
+    }
+    for (int update = 0; update <= updates; update++)
+    {
+        if (update > 0)
+        {
+            // An update that rewrites the catalog.
+            object("<< /Type /Catalog /Pages 2 0 R >>");
+        }
+        size_t xref = data.size();
+        pdf.index.xrefOffsets.push_back(xref);
+        data += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+        for (size_t offset : offsets)
+        {
+            char entry[32];
+            std::snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+            data += entry;
+        }
+        data += "trailer\n<< /Size " + std::to_string(offsets.size() + 1) +
+                " /Root 1 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+        pdf.index.startXref = static_cast<int64_t>(xref);
+    }
+    pdf.index.hasEofMarker = true;
+    pdf.index.bytes = data.size();
+    return pdf;
+}
+
+bool SameIndex(const PdfIndexScanner::Index& a, const PdfIndexScanner::Index& b)
+{
+    return a.bytes == b.bytes && a.pageCount == b.pageCount &&
+           a.xrefOffsets == b.xrefOffsets && a.startXref == b.startXref &&
+           a.hasEofMarker == b.hasEofMarker;
+}
+
+PdfIndexScanner::Index ScanInChunks(
+    const std::string& data, std::mt19937& random, size_t largestChunk)
+{
+    PdfIndexScanner scanner;
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        size_t size = (std::min)(data.size() - offset, 1 + random() % largestChunk);
+        scanner.Feed(data.data() + offset, size);
+        offset += size;
+    }
+    return scanner.Finish();
+}
+
+// The sample PDFs, whole and split into chunks of random sizes, from single
+// bytes up to larger than the document, so every keyword straddles a chunk
+// boundary at some point.
+void TestRandomChunks()
+{
+    std::vector<SamplePdf> samples = {
+        MakePdf(1, 100, 0, false, 1),
+        MakePdf(12, 2000, 0, true, 2),
+        MakePdf(40, 30000, 2, false, 3),
+        MakePdf(3, 10, 5, true, 4),
+    };
+    std::mt19937 random(7);
+    for (const SamplePdf& sample : samples)
+    {
+        PdfIndexScanner whole;
+        whole.Feed(sample.data.data(), sample.data.size());
+        CHECK(SameIndex(whole.Finish(), sample.index));
+        for (size_t largestChunk : {1, 7, 64, 4096, 1 << 20})
+        {
+            for (int round = 0; round < 20; round++)
+            {
+                PdfIndexScanner::Index index = ScanInChunks(sample.data, random, largestChunk);
+                CHECK(SameIndex(index, sample.index));
+            }
+        }
+    }
+
+    // "/Pages" isn't a page, nor is a keyword that doesn't start its line.
+    PdfIndexScanner scanner;
+    std::string text = "<< /Type /Pages >> %x xref\n<< /Type /Page>>\nxref\n";
+    scanner.Feed(text.data(), text.size());
+    const PdfIndexScanner::Index& index = scanner.Finish();
+    CHECK(index.pageCount == 1);
+    CHECK(index.xrefOffsets.size() == 1 && index.xrefOffsets[0] == text.size() - 5);
+    CHECK(index.startXref == -1 && !index.hasEofMarker);
+}
+
+// Reads `data` in pieces of random sizes, failing at `failAt` if it's set.
+PdfStreamSink::ReadFunction MakeReader(
+    const std::string& data, std::mt19937& random, size_t failAt = SIZE_MAX)
+{
+    auto offset = std::make_shared<size_t>(0);
+    return [&data, &random, offset, failAt](void* buffer, size_t size) -> int64_t
+    {
+        if (*offset >= failAt)
+        {
+            return -1;
+        }
+        size_t read = (std::min)(size, data.size() - *offset);
+        read = (std::min)(read, size_t(1 + random() % size));
+        std::memcpy(buffer, data.data() + *offset, read);
+        *offset += read;
+        return static_cast<int64_t>(read);
+    };
+}
+
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(
+        std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// The sink writes the document as read and indexes it on the way, and leaves
+// no file behind when the copy fails or is discarded.
+void TestStreamSink()
+{
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "PdfIndexScannerTests.pdf";
+    std::mt19937 random(9);
+    SamplePdf sample = MakePdf(20, 50000, 1, false, 5);
+    for (size_t chunkSize : {size_t(1000), PdfStreamSink::c_defaultChunkSize})
+    {
+        PdfStreamSink sink(MakeReader(sample.data, random), path, chunkSize);
+        while (sink.WriteChunk())
+        {
+        }
+        PdfStreamSink::Result result = sink.Finish();
+        CHECK(result.succeeded && result.bytes == sample.data.size());
+        CHECK(SameIndex(result.index, sample.index));
+        CHECK(ReadFile(path) == sample.data);
+    }
+
+    size_t failAt = sample.data.size() / 2;
+    PdfStreamSink failing(MakeReader(sample.data, random, failAt), path, 4096);
+    while (failing.WriteChunk())
+    {
+    }
+    CHECK(failing.HasFailed() && !failing.Finish().succeeded);
+    CHECK(!std::filesystem::exists(path));
+
+    PdfStreamSink discarded(MakeReader(sample.data, random), path, 4096);
+    CHECK(discarded.WriteChunk() && std::filesystem::exists(path));
+    discarded.Discard();
+    CHECK(!std::filesystem::exists(path));
+    CHECK(!discarded.WriteChunk());
+}
+
+// Copies a large PDF through the sink and reports the throughput.
+void TestThroughput()
+{
+    SamplePdf sample = MakePdf(2000, 32 * 1024, 0, false, 6);
+    std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "PdfIndexScannerTests.pdf";
+    std::mt19937 random(11);
+    auto start = std::chrono::steady_clock::now();
+    PdfIndexScanner scanner;
+    scanner.Feed(sample.data.data(), sample.data.size());
+    CHECK(SameIndex(scanner.Finish(), sample.index));
+    double scanSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PdfStreamSink sink(MakeReader(sample.data, random), path);
+    while (sink.WriteChunk())
+    {
+    }
+    PdfStreamSink::Result result = sink.Finish();
+    CHECK(result.succeeded && SameIndex(result.index, sample.index));
+    std::filesystem::remove(path);
+    double megabytes = sample.data.size() / (1024.0 * 1024);
+    std::printf(
+        "%.0f MB, %llu pages: scanned at %.0f MB/s, written at %.0f MB/s\n", megabytes,
+        static_cast<unsigned long long>(result.index.pageCount), megabytes / scanSeconds,
+        megabytes / result.seconds);
+}
+} // namespace
+
+int main()
+{
+    TestRandomChunks();
+    TestStreamSink();
+    TestThroughput();
+    return FinishTests("PdfIndexScannerTests");
+}
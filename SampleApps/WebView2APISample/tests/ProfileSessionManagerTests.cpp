@@ -0,0 +1,270 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ProfileSessionManager.h"
+#include "TestUtil.h"
+
+namespace
+{
+using Manager = ProfileSessionManager;
+
+constexpr uint64_t c_bytesPerMB = 1024 * 1024;
+
+void TestSharedProcesses()
+{
+    Manager manager;
+    manager.OnWebViewCreated(1, "Work", false, 0);
+    manager.OnWebViewCreated(2, "Work", false, 0);
+    manager.OnWebViewCreated(3, "Home", false, 0);
+    manager.SetProcesses(1, {{10, 300 * c_bytesPerMB}, {11, 100 * c_bytesPerMB}});
+    manager.SetProcesses(2, {{10, 300 * c_bytesPerMB}});
+    manager.SetProcesses(3, {{10, 300 * c_bytesPerMB}, {12, 50 * c_bytesPerMB}});
+    // Process 10 is split between the two profiles, whatever their windows.
+    CHECK(manager.GetMemoryBytes() == 450 * c_bytesPerMB);
+    CHECK(manager.GetProfileMemoryBytes("Work", false) == 250 * c_bytesPerMB);
+    CHECK(manager.GetProfileMemoryBytes("Home", false) == 200 * c_bytesPerMB);
+    CHECK(manager.GetProfileMemoryBytes("Home", true) == 0);
+
+    manager.OnWebViewClosed(3);
+    CHECK(manager.GetProfileMemoryBytes("Work", false) == 400 * c_bytesPerMB);
+    CHECK(manager.GetProcessCount() == 2);
+    // A sample of a closed window is dropped.
+    manager.SetProcesses(3, {{12, 50 * c_bytesPerMB}});
+    CHECK(manager.GetProcessCount() == 2);
+}
+
+void TestEvictsIdleProfilesFirst()
+{
+    Manager manager;
+    manager.SetBudget(500 * c_bytesPerMB);
+    manager.OnWebViewCreated(1, "Old", false, 0);
+    manager.OnWebViewCreated(2, "Downloading", false, 1000);
+    manager.OnWebViewCreated(3, "Recent", false, Manager::c_idleMs);
+    manager.OnActivated(3, Manager::c_idleMs);
+    manager.OnDownloadStarted(2);
+    manager.SetProcesses(1, {{10, 400 * c_bytesPerMB}});
+    manager.SetProcesses(2, {{11, 400 * c_bytesPerMB}});
+    manager.SetProcesses(3, {{12, 400 * c_bytesPerMB}});
+
+    // Only the idle profile without downloads goes, which isn't enough.
+    int64_t nowMs = Manager::c_idleMs + 1000;
+    std::vector<Manager::WindowId> evicted = manager.TakeEvictions(nowMs);
+    CHECK(evicted.size() == 1 && evicted[0] == 1);
+    CHECK(manager.IsEvicted(1) && manager.GetMemoryBytes() == 800 * c_bytesPerMB);
+    CHECK(manager.TakeEvictions(nowMs).empty());
+
+    // Once the download ends, that profile goes too.
+    manager.OnDownloadEnded(2, true, 1234);
+    evicted = manager.TakeEvictions(nowMs);
+    CHECK(evicted.size() == 1 && evicted[0] == 2);
+    CHECK(manager.GetMemoryBytes() == 400 * c_bytesPerMB);
+
+    // Activating an evicted window restores it.
+    manager.OnWebViewCreated(1, "Old", false, nowMs);
+    manager.OnActivated(1, nowMs);
+    CHECK(!manager.IsEvicted(1) && manager.GetWindowCount() == 3);
+    CHECK(manager.GetReport(nowMs).find("Old") != std::string::npos);
+}
+
+// A window of the simulated workload, as its ProfileComponent reports it.
+struct SimulatedWindow
+{
+    int profile = 0;
+    bool live = false;
+    bool evicted = false;
+    bool downloading = false;
+    std::vector<int32_t> processIds;
+};
+
+// Windows of many profiles opened, activated, sampled and closed at random,
+// with render processes that pairs of profiles share, under a budget the
+// processes take more than. Activations favor the profiles of the first
+// windows. After each sample the evictions are checked against the policy,
+// and the memory attributed to the profiles against the total.
+void TestSimulatedWorkload()
+{
+    constexpr int c_profileCount = 32;
+    constexpr int c_windowCount = 256;
+    constexpr int c_processesPerWindow = 3;
+    constexpr int c_stepCount = 1000000;
+    Manager manager;
+    manager.SetBudget(uint64_t(16) << 30);
+    std::mt19937_64 random(7);
+    std::vector<SimulatedWindow> windows(c_windowCount + 1);
+    for (int id = 1; id <= c_windowCount; id++)
+    {
+        windows[id].profile = (id - 1) / (c_windowCount / c_profileCount);
+    }
+    std::vector<int64_t> lastActiveMs(c_profileCount, 0);
+    Manager::WindowId activeId = Manager::c_noWindow;
+    int32_t nextProcessId = 100;
+    uint64_t samples = 0;
+    uint64_t evictions = 0;
+    uint64_t restores = 0;
+    int64_t nowMs = 1;
+
+    auto isEvictable = [&](int profile)
+    {
+        bool hasLiveWindow = false;
+        for (int id = 1; id <= c_windowCount; id++)
+        {
+            const SimulatedWindow& window = windows[id];
+            if (window.profile != profile)
+            {
+                continue;
+            }
+            if (window.downloading || Manager::WindowId(id) == activeId)
+            {
+                return false;
+            }
+            hasLiveWindow = hasLiveWindow || window.live;
+        }
+        return hasLiveWindow && nowMs - lastActiveMs[profile] >= Manager::c_idleMs;
+    };
+
+    for (int step = 0; step < c_stepCount; step++)
+    {
+        nowMs += 50;
+        int id = 1 + static_cast<int>(random() % c_windowCount);
+        int operation = static_cast<int>(random() % 100);
+        if (operation >= 2 && operation < 12 && random() % 1000 < 998)
+        {
+            id = 1 + static_cast<int>(random() % 32);
+        }
+        SimulatedWindow& window = windows[id];
+        std::string profile = "Profile" + std::to_string(window.profile);
+        bool inPrivate = window.profile % 8 == 0;
+        if (!window.live && !window.evicted)
+        {
+            manager.OnWebViewCreated(id, profile, inPrivate, nowMs);
+            lastActiveMs[window.profile] = nowMs;
+            window.live = true;
+        }
+        else if (operation < 2)
+        {
+            if (random() % 20 == 0)
+            {
+                manager.OnWindowClosed(id);
+                window = SimulatedWindow{window.profile, false, false, false, {}};
+                if (activeId == Manager::WindowId(id))
+                {
+                    activeId = Manager::c_noWindow;
+                }
+            }
+        }
+        else if (operation < 12)
+        {
+            if (window.evicted)
+            {
+                manager.OnWebViewCreated(id, profile, inPrivate, nowMs);
+                window.evicted = false;
+                window.live = true;
+                restores++;
+            }
+            manager.OnActivated(id, nowMs);
+            lastActiveMs[window.profile] = nowMs;
+            activeId = id;
+        }
+        else if (operation < 13)
+        {
+            if (window.live && !window.downloading && random() % 20 == 0)
+            {
+                manager.OnDownloadStarted(id);
+                window.downloading = true;
+            }
+        }
+        else if (operation < 16)
+        {
+            if (window.downloading)
+            {
+                manager.OnDownloadEnded(id, random() % 4 != 0, random() % (50 * c_bytesPerMB));
+                window.downloading = false;
+            }
+        }
+        else if (operation < 18)
+        {
+            if (manager.StartCookieSample(id, nowMs))
+            {
+                manager.SetCookieCount(id, random() % 5000);
+            }
+        }
+        else if (window.live)
+        {
+            // A navigation now and then moves the window to new processes,
+            // some of which are shared with the windows of two profiles.
+            if (window.processIds.empty() || random() % 10 == 0)
+            {
+                window.processIds.clear();
+                for (int k = 0; k < c_processesPerWindow; k++)
+                {
+                    bool shared = random() % 4 == 0;
+                    window.processIds.push_back(
+                        shared ? 100000 + window.profile / 2 * 8 + k : nextProcessId++);
+                }
+            }
+            std::vector<Manager::ProcessUsage> processes;
+            for (int32_t processId : window.processIds)
+            {
+                processes.push_back(
+                    {processId, 20 * c_bytesPerMB + random() % (200 * c_bytesPerMB)});
+            }
+            manager.SetProcesses(id, std::move(processes));
+            samples++;
+
+            for (Manager::WindowId evictedId : manager.TakeEvictions(nowMs))
+            {
+                SimulatedWindow& evictedWindow = windows[evictedId];
+                CHECK(evictedWindow.live && manager.IsEvicted(evictedId));
+                CHECK(isEvictable(evictedWindow.profile));
+                evictedWindow.live = false;
+                evictedWindow.evicted = true;
+                evictedWindow.processIds.clear();
+                evictions++;
+            }
+            // Over the budget only while no profile can be evicted.
+            if (manager.GetMemoryBytes() > manager.GetBudget())
+            {
+                for (int profileIndex = 0; profileIndex < c_profileCount; profileIndex++)
+                {
+                    CHECK(!isEvictable(profileIndex));
+                }
+            }
+        }
+
+        if (step % 97 == 0)
+        {
+            // Splitting a process's memory among its profiles rounds down.
+            uint64_t attributed = 0;
+            for (int profileIndex = 0; profileIndex < c_profileCount; profileIndex++)
+            {
+                attributed += manager.GetProfileMemoryBytes(
+                    "Profile" + std::to_string(profileIndex), profileIndex % 8 == 0);
+            }
+            CHECK(attributed <= manager.GetMemoryBytes());
+            CHECK(manager.GetMemoryBytes() - attributed <=
+                  manager.GetProcessCount() * c_profileCount);
+        }
+    }
+    CHECK(evictions > 0 && restores > 0);
+    std::printf(
+        "%llu samples, %llu evictions, %llu restores, %zu windows, %zu processes, %llu MB\n",
+        static_cast<unsigned long long>(samples), static_cast<unsigned long long>(evictions),
+        static_cast<unsigned long long>(restores), manager.GetWindowCount(),
+        manager.GetProcessCount(),
+        static_cast<unsigned long long>(manager.GetMemoryBytes() / c_bytesPerMB));
+}
+} // namespace
+
+int main()
+{
+    TestSharedProcesses();
+    TestEvictsIdleProfilesFirst();
+    TestSimulatedWorkload();
+    return FinishTests("ProfileSessionManagerTests");
+}
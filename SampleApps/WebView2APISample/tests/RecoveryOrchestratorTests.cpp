@@ -0,0 +1,246 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "RecoveryOrchestrator.h"
+#include "TestUtil.h"
+
+namespace
+{
+using Action = RecoveryOrchestrator::Action;
+using Failure = RecoveryOrchestrator::Failure;
+
+const std::string c_uri = "https://kiosk.example/menu#top";
+
+void TestEscalationAndCircuit()
+{
+    RecoveryOrchestrator orchestrator;
+    RecoveryOrchestrator::Decision decision =
+        orchestrator.OnFailure(c_uri, Failure::RenderExited, 0);
+    CHECK(decision.action == Action::Reload && decision.delayMs == 0);
+    // Failures while the recovery waits to run are folded into it.
+    CHECK(orchestrator.OnFailure(c_uri, Failure::FrameRenderExited, 5).action == Action::None);
+    orchestrator.OnActionRun();
+    CHECK(orchestrator.OnNavigationSucceeded("https://KIOSK.example/menu", 800));
+
+    // Failing again before the page ran stably escalates, with a backoff.
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, 10000);
+    CHECK(decision.action == Action::Reinitialize && decision.delayMs == 1000);
+    orchestrator.OnActionRun();
+    CHECK(orchestrator.GetRecoveringUri() == c_uri);
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, 20000);
+    CHECK(decision.action == Action::ReinitializeWithNewBrowser && decision.delayMs == 2000);
+    orchestrator.OnActionRun();
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, 30000);
+    CHECK(decision.action == Action::ReinitializeWithNewBrowser && decision.delayMs == 4000);
+    orchestrator.OnActionRun();
+
+    // The fifth failure within the window opens the circuit until the
+    // cooldown ends.
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, 40000);
+    CHECK(decision.action == Action::Suspend);
+    CHECK(decision.delayMs == RecoveryOrchestrator::c_cooldownMs);
+    CHECK(!orchestrator.IsRecovering());
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, 50000);
+    CHECK(decision.action == Action::Suspend);
+    CHECK(decision.delayMs == RecoveryOrchestrator::c_cooldownMs - 10000);
+
+    // Other origins recover as before.
+    decision = orchestrator.OnFailure(
+        "https://other.example/", Failure::RenderUnresponsive, 60000);
+    CHECK(decision.action == Action::Reinitialize && decision.delayMs == 0);
+    orchestrator.OnActionRun();
+    CHECK(!orchestrator.OnNavigationSucceeded(c_uri, 61000));
+    CHECK(orchestrator.OnNavigationSucceeded("https://other.example/x", 61000));
+}
+
+void TestTrialAfterCooldown()
+{
+    RecoveryOrchestrator orchestrator;
+    int64_t nowMs = 0;
+    for (size_t i = 0; i < RecoveryOrchestrator::c_maxFailures; i++)
+    {
+        nowMs += 1000;
+        orchestrator.OnFailure(c_uri, Failure::RenderExited, nowMs);
+        orchestrator.OnActionRun();
+    }
+    int64_t cooldownEndMs = nowMs + RecoveryOrchestrator::c_cooldownMs;
+    CHECK(orchestrator.OnCooldownEnded(cooldownEndMs - 1).action == Action::None);
+
+    // The cooldown timer recovers the failed page once more.
+    RecoveryOrchestrator::Decision decision = orchestrator.OnCooldownEnded(cooldownEndMs);
+    CHECK(decision.action == Action::Reinitialize);
+    CHECK(orchestrator.IsRecovering() && orchestrator.GetRecoveringUri() == c_uri);
+    CHECK(orchestrator.OnCooldownEnded(cooldownEndMs + 1).action == Action::None);
+    orchestrator.OnActionRun();
+    CHECK(orchestrator.OnNavigationSucceeded(c_uri, cooldownEndMs + 500));
+
+    // Failing on trial opens the circuit again.
+    decision = orchestrator.OnFailure(c_uri, Failure::RenderExited, cooldownEndMs + 1000);
+    CHECK(decision.action == Action::Suspend);
+
+    // Running stably after the trial closes it.
+    cooldownEndMs += 1000 + RecoveryOrchestrator::c_cooldownMs;
+    CHECK(orchestrator.OnCooldownEnded(cooldownEndMs).action == Action::Reinitialize);
+    orchestrator.OnActionRun();
+    orchestrator.OnNavigationSucceeded(c_uri, cooldownEndMs + 100);
+    decision = orchestrator.OnFailure(
+        c_uri, Failure::RenderExited, cooldownEndMs + RecoveryOrchestrator::c_stableMs);
+    CHECK(decision.action == Action::Reload && decision.delayMs == 0 && decision.attempt == 1);
+
+    // A failure after the cooldown, before the timer, takes the trial's place.
+    RecoveryOrchestrator early;
+    for (size_t i = 0; i < RecoveryOrchestrator::c_maxFailures; i++)
+    {
+        early.OnFailure(c_uri, Failure::RenderExited, 0);
+        early.OnActionRun();
+    }
+    int64_t cooldownMs = RecoveryOrchestrator::c_cooldownMs;
+    CHECK(early.OnFailure(c_uri, Failure::RenderExited, cooldownMs).action == Action::Reload);
+    CHECK(early.OnCooldownEnded(cooldownMs).action == Action::None);
+}
+
+void TestFailureWithoutUri()
+{
+    RecoveryOrchestrator orchestrator;
+    // The page that says recovery stopped has no origin and isn't kept.
+    CHECK(!orchestrator.OnNavigationSucceeded(c_uri, 0));
+    CHECK(!orchestrator.OnNavigationSucceeded("about:blank", 10));
+    CHECK(orchestrator.GetLastGoodUri() == c_uri);
+
+    // The browser process is gone, so the host can't read the URI.
+    RecoveryOrchestrator::Decision decision =
+        orchestrator.OnFailure("", Failure::BrowserExited, 1000);
+    CHECK(decision.action == Action::Reinitialize);
+    CHECK(orchestrator.GetRecoveringUri() == c_uri);
+    orchestrator.OnActionRun();
+    CHECK(orchestrator.OnNavigationSucceeded(c_uri, 3000));
+
+    // Before any page loaded, the recovery has no URI and ends with any load.
+    RecoveryOrchestrator first;
+    first.OnFailure("", Failure::BrowserExited, 0);
+    first.OnActionRun();
+    CHECK(first.GetRecoveringUri().empty());
+    CHECK(first.OnNavigationSucceeded("https://start.example/", 2000));
+}
+
+void TestSavedStates()
+{
+    RecoveryOrchestrator orchestrator;
+    orchestrator.SaveState(c_uri, "{\"y\":10}");
+    CHECK(orchestrator.FindState("https://kiosk.example/menu"));
+    CHECK(*orchestrator.FindState("https://kiosk.example/menu#x") == "{\"y\":10}");
+    for (size_t i = 0; i < RecoveryOrchestrator::c_maxSavedStates + 36; i++)
+    {
+        orchestrator.SaveState("https://a.example/" + std::to_string(i), "s");
+    }
+    CHECK(!orchestrator.FindState(c_uri));
+    CHECK(orchestrator.FindState("https://a.example/99"));
+}
+
+// Injects failures of every kind at random into a host that runs each
+// decision as ProcessComponent does: actions after their delay, trials when
+// the cooldown timer fires. Pages take the time of the action to load, and a
+// quarter of the loads fail. A third of the failures are of the browser
+// process, whose page the host can't read.
+void TestInjectedFailures()
+{
+    RecoveryOrchestrator orchestrator;
+    std::mt19937 random(3);
+    const std::string uri = "https://site.example/";
+    int64_t nowMs = 0;
+    int64_t actionDueMs = -1;
+    int64_t loadDueMs = -1;
+    int64_t cooldownDueMs = -1;
+    int64_t suspendedAtMs = -1;
+    Action pending = Action::None;
+    uint64_t suspensions = 0;
+    uint64_t trips = 0;
+    uint64_t trials = 0;
+    uint64_t recoveries = 0;
+    CHECK(!orchestrator.OnNavigationSucceeded(uri, nowMs));
+
+    auto decide = [&](const RecoveryOrchestrator::Decision& decision)
+    {
+        if (decision.action == Action::Suspend)
+        {
+            suspensions++;
+            trips += decision.delayMs == RecoveryOrchestrator::c_cooldownMs;
+            actionDueMs = -1;
+            suspendedAtMs = suspendedAtMs < 0 ? nowMs : suspendedAtMs;
+            cooldownDueMs = nowMs + decision.delayMs;
+        }
+        else if (decision.action != Action::None)
+        {
+            // Recovery doesn't resume while the circuit is open.
+            CHECK(suspendedAtMs < 0 ||
+                  nowMs - suspendedAtMs >= RecoveryOrchestrator::c_cooldownMs);
+            suspendedAtMs = -1;
+            pending = decision.action;
+            actionDueMs = nowMs + decision.delayMs;
+        }
+    };
+    constexpr int64_t c_endMs = 48 * 60 * 60 * 1000;
+    for (; nowMs < c_endMs + 2 * RecoveryOrchestrator::c_cooldownMs; nowMs += 100)
+    {
+        if (actionDueMs >= 0 && nowMs >= actionDueMs)
+        {
+            actionDueMs = -1;
+            orchestrator.OnActionRun();
+            loadDueMs = nowMs + (pending == Action::Reload ? 300 : 2000);
+        }
+        if (loadDueMs >= 0 && nowMs >= loadDueMs)
+        {
+            loadDueMs = -1;
+            if (nowMs >= c_endMs || random() % 4 != 0)
+            {
+                recoveries += orchestrator.OnNavigationSucceeded(uri, nowMs);
+            }
+        }
+        if (cooldownDueMs >= 0 && nowMs >= cooldownDueMs)
+        {
+            cooldownDueMs = -1;
+            RecoveryOrchestrator::Decision decision = orchestrator.OnCooldownEnded(nowMs);
+            trials += decision.action != Action::None;
+            decide(decision);
+        }
+        // A failure every five minutes on average, then none.
+        if (nowMs < c_endMs && random() % 3000 == 0)
+        {
+            auto failure = static_cast<Failure>(random() % 4);
+            bool isBrowser = random() % 3 == 0;
+            decide(orchestrator.OnFailure(
+                isBrowser ? std::string() : uri, isBrowser ? Failure::BrowserExited : failure,
+                nowMs));
+        }
+        // The recovered page is the failed one, even after browser failures.
+        CHECK(!orchestrator.IsRecovering() || orchestrator.GetRecoveringUri() == uri);
+    }
+    // Every suspension ended in a trial, and the last recovery held.
+    CHECK(trips > 0);
+    CHECK(trials == trips);
+    CHECK(!orchestrator.IsRecovering());
+    std::string report = orchestrator.GetReport(nowMs);
+    CHECK(report.find("suspended for") == std::string::npos);
+    CHECK(report.find("(no origin)") == std::string::npos);
+    std::printf(
+        "%llu recoveries, %llu suspensions, %llu trials\n%s",
+        static_cast<unsigned long long>(recoveries),
+        static_cast<unsigned long long>(suspensions), static_cast<unsigned long long>(trials),
+        report.c_str());
+}
+} // namespace
+
+int main()
+{
+    TestEscalationAndCircuit();
+    TestTrialAfterCooldown();
+    TestFailureWithoutUri();
+    TestSavedStates();
+    TestInjectedFailures();
+    return FinishTests("RecoveryOrchestratorTests");
+}
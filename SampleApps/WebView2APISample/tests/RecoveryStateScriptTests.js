@@ -0,0 +1,136 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs the scripts with which ProcessComponent saves and restores the state of
+// a page across a recovery against a minimal document:
+//     node RecoveryStateScriptTests.js <ProcessComponent.cpp>
+
+"use strict";
+
+const fs = require("fs");
+const vm = require("vm");
+
+if (process.argv.length < 3) {
+    console.error("usage: RecoveryStateScriptTests.js <ProcessComponent.cpp>");
+    process.exit(2);
+}
+const source = fs.readFileSync(process.argv[2], "utf8");
+function getScript(name) {
+    const match = new RegExp(name + '\\[\\] = LR"js\\(([\\s\\S]*?)\\)js"').exec(source);
+    if (!match) {
+        console.error(name + " not found");
+        process.exit(2);
+    }
+    return match[1];
+}
+const saveScript = getScript("c_saveStateScript");
+const restoreScript = getScript("c_restoreStateScript");
+
+let failures = 0;
+function check(condition, message) {
+    if (!condition) {
+        console.error("check failed: " + message);
+        failures++;
+    }
+}
+
+// A page with the given form fields, and a WebView host that keeps its
+// messages. Timers run when the test says.
+function makePage(fields, isTop = true) {
+    const page = {
+        listeners: {},
+        timers: [],
+        messages: [],
+        scroll: { x: 0, y: 0 },
+        elements: fields.map((field) => Object.assign({ name: "", value: "" }, field)),
+    };
+    const window = {
+        document: { querySelectorAll: () => page.elements },
+        chrome: { webview: { postMessage: (message) => page.messages.push(message) } },
+        addEventListener: (type, listener) => {
+            (page.listeners[type] = page.listeners[type] || []).push(listener);
+        },
+        setTimeout: (callback, delay) => page.timers.push({ callback, delay }),
+        scrollTo: (x, y) => {
+            page.scroll = { x, y };
+        },
+        get scrollX() {
+            return page.scroll.x;
+        },
+        get scrollY() {
+            return page.scroll.y;
+        },
+    };
+    window.window = window;
+    window.top = isTop ? window : {};
+    page.context = vm.createContext(window);
+    page.fire = (type) => (page.listeners[type] || []).forEach((listener) => listener({}));
+    page.runTimers = () => {
+        const timers = page.timers;
+        page.timers = [];
+        timers.forEach((timer) => timer.callback());
+    };
+    return page;
+}
+
+const fields = [
+    { type: "text", name: "query" },
+    { type: "password", name: "secret" },
+    { type: "checkbox", name: "agree", checked: false },
+    { tagName: "TEXTAREA", name: "notes" },
+    { type: "hidden", name: "token" },
+];
+
+// Saving, debounced across the events of one burst of input.
+const page = makePage(fields);
+vm.runInContext(saveScript, page.context);
+page.elements[0].value = "kiosk";
+page.elements[1].value = "hunter2";
+page.elements[2].checked = true;
+page.elements[3].value = "line\n\"quoted\"";
+page.elements[4].value = "abc";
+page.scroll = { x: 0, y: 640 };
+page.fire("input");
+page.fire("change");
+page.fire("scroll");
+check(page.timers.length === 1, "one save per burst");
+check(page.timers[0].delay === 500, "saved half a second after the last change");
+page.runTimers();
+check(page.messages.length === 1, "one message per save");
+const prefix = "RecoveryState ";
+check(page.messages[0].startsWith(prefix), "message prefix matches c_recoveryStateMessage");
+check(source.includes('c_recoveryStateMessage[] = L"' + prefix + '"'), "host prefix");
+const state = JSON.parse(page.messages[0].slice(prefix.length));
+check(state.y === 640, "scroll position saved");
+check(!page.messages[0].includes("hunter2"), "password left out");
+check(!page.messages[0].includes("abc"), "hidden field left out");
+check(state.fields.length === 3, "saved fields: " + JSON.stringify(state.fields));
+
+// Frames don't save.
+const frame = makePage(fields, false);
+vm.runInContext(saveScript, frame.context);
+frame.fire("input");
+check(frame.timers.length === 0 && !frame.listeners.input, "frames are left alone");
+
+// Restoring into the reloaded page, whose second text field was renamed. The
+// host passes the state as a string literal.
+const reloaded = makePage([
+    { type: "text", name: "query" },
+    { type: "password", name: "secret" },
+    { type: "checkbox", name: "agree", checked: false },
+    { tagName: "TEXTAREA", name: "comments" },
+]);
+const json = page.messages[0].slice(prefix.length);
+vm.runInContext(restoreScript + "(" + JSON.stringify(json) + ");", reloaded.context);
+check(reloaded.elements[0].value === "kiosk", "text field restored");
+check(reloaded.elements[1].value === "", "password not restored");
+check(reloaded.elements[2].checked === true, "checkbox restored");
+check(reloaded.elements[3].value === "", "renamed field not restored");
+check(reloaded.scroll.y === 640, "scroll position restored");
+
+if (failures) {
+    console.error(`RecoveryStateScriptTests: ${failures} check(s) failed`);
+    process.exit(1);
+}
+console.log("RecoveryStateScriptTests: passed");
@@ -0,0 +1,639 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ReplayComponents.h"
+
+#include <chrono>
+#include <ctime>
+
+using Microsoft::WRL::Callback;
+
+namespace
+{
+uint64_t GetNowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The statuses the fake defines; the others come out as "ERROR".
+std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status)
+{
+    switch (status)
+    {
+#define STATUS_ENTRY(statusValue)                                                              \
+    case statusValue:                                                                          \
+        return L"" #statusValue;
+
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED);
+
+#undef STATUS_ENTRY
+    }
+
+    return L"ERROR";
+}
+
+std::wstring BoolToString(BOOL value)
+{
+    return value ? L"true" : L"false";
+}
+
+std::wstring EncodeQuote(std::wstring raw)
+{
+    std::wstring encoded;
+    encoded.reserve(raw.length() + 10);
+    encoded.push_back(L'"');
+    for (size_t i = 0; i < raw.length(); ++i)
+    {
+        switch (raw[i])
+        {
+        case '\b':
+            encoded.append(L"\\b");
+            break;
+        case '\f':
+            encoded.append(L"\\f");
+            break;
+        case '\n':
+            encoded.append(L"\\n");
+            break;
+        case '\r':
+            encoded.append(L"\\r");
+            break;
+        case '\t':
+            encoded.append(L"\\t");
+            break;
+        case '\\':
+            encoded.append(L"\\\\");
+            break;
+        case '"':
+            encoded.append(L"\\\"");
+            break;
+        default:
+            encoded.push_back(raw[i]);
+        }
+    }
+    encoded.push_back(L'"');
+    return encoded;
+}
+
+std::wstring WebViewPropertiesToJsonString(ICoreWebView2* webview)
+{
+    wil::unique_cotaskmem_string documentTitle;
+    CHECK_FAILURE(webview->get_DocumentTitle(&documentTitle));
+    wil::unique_cotaskmem_string source;
+    CHECK_FAILURE(webview->get_Source(&source));
+    BOOL canGoBack = FALSE;
+    CHECK_FAILURE(webview->get_CanGoBack(&canGoBack));
+    BOOL canGoForward = FALSE;
+    CHECK_FAILURE(webview->get_CanGoForward(&canGoForward));
+
+    std::wstring result = L", \"webview\": {"
+                          L"\"documentTitle\": " +
+                          EncodeQuote(documentTitle.get()) + L", " + L"\"source\": " +
+                          EncodeQuote(source.get()) + L", " + L"\"canGoBack\": " +
+                          BoolToString(canGoBack) + L", " + L"\"canGoForward\": " +
+                          BoolToString(canGoForward) + L"}";
+    return result;
+}
+
+std::wstring NavigationStartingArgsToJsonString(
+    ICoreWebView2* webview, ICoreWebView2NavigationStartingEventArgs* args,
+    const std::wstring& eventName)
+{
+    BOOL cancel = FALSE;
+    CHECK_FAILURE(args->get_Cancel(&cancel));
+    BOOL isRedirected = FALSE;
+    CHECK_FAILURE(args->get_IsRedirected(&isRedirected));
+    BOOL isUserInitiated = FALSE;
+    CHECK_FAILURE(args->get_IsUserInitiated(&isUserInitiated));
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(args->get_Uri(&uri));
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    // The fake has no request headers, so the list is always empty.
+    std::wstring message =
+        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
+    message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
+    message += L"\"cancel\": " + BoolToString(cancel) + L", " + L"\"isRedirected\": " +
+               BoolToString(isRedirected) + L", " + L"\"isUserInitiated\": " +
+               BoolToString(isUserInitiated) + L", " + L"\"requestHeaders\": [], " +
+               L"\"uri\": " + EncodeQuote(uri.get()) + L" " + L"}" +
+               WebViewPropertiesToJsonString(webview) + L"}";
+    return message;
+}
+
+std::wstring NavigationCompletedArgsToJsonString(
+    ICoreWebView2* webview, ICoreWebView2NavigationCompletedEventArgs* args,
+    const std::wstring& eventName)
+{
+    BOOL isSuccess = FALSE;
+    CHECK_FAILURE(args->get_IsSuccess(&isSuccess));
+    COREWEBVIEW2_WEB_ERROR_STATUS webErrorStatus;
+    CHECK_FAILURE(args->get_WebErrorStatus(&webErrorStatus));
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    std::wstring message =
+        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
+    message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
+    message += L"\"isSuccess\": " + BoolToString(isSuccess) + L", " +
+               L"\"webErrorStatus\": " + EncodeQuote(WebErrorStatusToString(webErrorStatus)) +
+               L" " + L"}" +
+               WebViewPropertiesToJsonString(webview) + L"}";
+    return message;
+}
+
+std::wstring CookieToString(ICoreWebView2Cookie* cookie)
+{
+    wil::unique_cotaskmem_string name;
+    CHECK_FAILURE(cookie->get_Name(&name));
+    wil::unique_cotaskmem_string value;
+    CHECK_FAILURE(cookie->get_Value(&value));
+    wil::unique_cotaskmem_string domain;
+    CHECK_FAILURE(cookie->get_Domain(&domain));
+    wil::unique_cotaskmem_string path;
+    CHECK_FAILURE(cookie->get_Path(&path));
+
+    std::wstring result = L"{";
+    result += L"\"Name\": " + EncodeQuote(name.get()) + L", " + L"\"Value\": " +
+              EncodeQuote(value.get()) + L", " + L"\"Domain\": " + EncodeQuote(domain.get()) +
+              L", " + L"\"Path\": " + EncodeQuote(path.get());
+    return result + L"}";
+}
+} // namespace
+
+EventMonitorReplay::EventMonitorReplay(ICoreWebView2* webView) : m_webView(webView)
+{
+    CHECK_FAILURE(m_webView->add_NavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT
+            {
+                PostEventMessage(
+                    NavigationStartingArgsToJsonString(sender, args, L"NavigationStarting"));
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationStartingToken));
+
+    CHECK_FAILURE(m_webView->add_FrameNavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT
+            {
+                PostEventMessage(NavigationStartingArgsToJsonString(
+                    sender, args, L"FrameNavigationStarting"));
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationStartingToken));
+
+    CHECK_FAILURE(m_webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2ContentLoadingEventArgs* args)
+                -> HRESULT
+            {
+                BOOL isErrorPage = FALSE;
+                CHECK_FAILURE(args->get_IsErrorPage(&isErrorPage));
+                UINT64 navigationId = 0;
+                CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                std::wstring message =
+                    L"{ \"kind\": \"event\", \"name\": \"ContentLoading\", \"args\": {";
+                message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
+                message += L"\"isErrorPage\": " + BoolToString(isErrorPage) + L"}" +
+                           WebViewPropertiesToJsonString(sender) + L"}";
+                PostEventMessage(message);
+                return S_OK;
+            })
+            .Get(),
+        &m_contentLoadingToken));
+
+    CHECK_FAILURE(m_webView->add_SourceChanged(
+        Callback<ICoreWebView2SourceChangedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs* args)
+                -> HRESULT
+            {
+                BOOL isNewDocument = FALSE;
+                CHECK_FAILURE(args->get_IsNewDocument(&isNewDocument));
+                std::wstring message =
+                    L"{ \"kind\": \"event\", \"name\": \"SourceChanged\", \"args\": {";
+                message += L"\"isNewDocument\": " + BoolToString(isNewDocument) + L"}" +
+                           WebViewPropertiesToJsonString(sender) + L"}";
+                PostEventMessage(message);
+                return S_OK;
+            })
+            .Get(),
+        &m_sourceChangedToken));
+
+    CHECK_FAILURE(m_webView->add_HistoryChanged(
+        Callback<ICoreWebView2HistoryChangedEventHandler>(
+            [this](ICoreWebView2* sender, IUnknown*) -> HRESULT
+            {
+                std::wstring message =
+                    L"{ \"kind\": \"event\", \"name\": \"HistoryChanged\", \"args\": {";
+                message += L"}" + WebViewPropertiesToJsonString(sender) + L"}";
+                PostEventMessage(message);
+                return S_OK;
+            })
+            .Get(),
+        &m_historyChangedToken));
+
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                PostEventMessage(
+                    NavigationCompletedArgsToJsonString(sender, args, L"NavigationCompleted"));
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken));
+
+    CHECK_FAILURE(m_webView->add_FrameNavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                PostEventMessage(NavigationCompletedArgsToJsonString(
+                    sender, args, L"FrameNavigationCompleted"));
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationCompletedToken));
+
+    CHECK_FAILURE(m_webView->add_DocumentTitleChanged(
+        Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
+            [this](ICoreWebView2* sender, IUnknown*) -> HRESULT
+            {
+                std::wstring message =
+                    L"{ \"kind\": \"event\", \"name\": \"DocumentTitleChanged\", \"args\": {"
+                    L"}" +
+                    WebViewPropertiesToJsonString(sender) + L"}";
+                PostEventMessage(message);
+                return S_OK;
+            })
+            .Get(),
+        &m_documentTitleChangedToken));
+
+    // The event view's checkbox adds this filter.
+    CHECK_FAILURE(
+        m_webView->AddWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL));
+    CHECK_FAILURE(m_webView->add_WebResourceRequested(
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+                -> HRESULT
+            {
+                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                CHECK_FAILURE(args->get_Request(&request));
+                wil::unique_cotaskmem_string method;
+                CHECK_FAILURE(request->get_Method(&method));
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(request->get_Uri(&uri));
+                std::wstring message = L"{ \"kind\": \"event\", \"name\": "
+                                       L"\"WebResourceRequested\", \"args\": {"
+                                       L"\"request\": {\"content\": null, \"headers\": [], "
+                                       L"\"method\": " +
+                                       EncodeQuote(method.get()) + L", \"uri\": " +
+                                       EncodeQuote(uri.get()) + L" }, \"response\": null}" +
+                                       WebViewPropertiesToJsonString(sender) + L"}";
+                PostEventMessage(message);
+                return S_OK;
+            })
+            .Get(),
+        &m_webResourceRequestedToken));
+
+    if (auto webView2 = m_webView.try_query<ICoreWebView2_2>())
+    {
+        CHECK_FAILURE(webView2->add_DOMContentLoaded(
+            Callback<ICoreWebView2DOMContentLoadedEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
+                    -> HRESULT
+                {
+                    UINT64 navigationId = 0;
+                    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                    std::wstring message =
+                        L"{ \"kind\": \"event\", \"name\": \"DOMContentLoaded\", \"args\": {";
+                    message += L"\"navigationId\": " + std::to_wstring(navigationId);
+                    message += L"}" + WebViewPropertiesToJsonString(sender) + L"}";
+                    PostEventMessage(message);
+                    return S_OK;
+                })
+                .Get(),
+            &m_domContentLoadedToken));
+    }
+
+    if (auto webView4 = m_webView.try_query<ICoreWebView2_4>())
+    {
+        CHECK_FAILURE(webView4->add_FrameCreated(
+            Callback<ICoreWebView2FrameCreatedEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2FrameCreatedEventArgs* args)
+                    -> HRESULT
+                {
+                    wil::com_ptr<ICoreWebView2Frame> webviewFrame;
+                    CHECK_FAILURE(args->get_Frame(&webviewFrame));
+                    wil::unique_cotaskmem_string name;
+                    CHECK_FAILURE(webviewFrame->get_Name(&name));
+                    std::wstring message =
+                        L"{ \"kind\": \"event\", \"name\": \"FrameCreated\", \"args\": {";
+                    message += L"\"frame\": " + EncodeQuote(name.get());
+                    if (auto frame5 = webviewFrame.try_query<ICoreWebView2Frame5>())
+                    {
+                        UINT32 frameId = 0;
+                        CHECK_FAILURE(frame5->get_FrameId(&frameId));
+                        message += L",\"frame id\": " + std::to_wstring((int)frameId);
+                    }
+                    message += L"}" + WebViewPropertiesToJsonString(sender) + L"}";
+                    PostEventMessage(message);
+                    return S_OK;
+                })
+                .Get(),
+            &m_frameCreatedToken));
+    }
+}
+
+void EventMonitorReplay::PostEventMessage(const std::wstring& message)
+{
+    m_messageCount++;
+    m_messageCharacters += message.size();
+}
+
+std::string EventMonitorReplay::GetSummary() const
+{
+    return std::to_string(m_messageCount) + " messages, " +
+           std::to_string(m_messageCharacters) + " characters";
+}
+
+EventMonitorReplay::~EventMonitorReplay()
+{
+    m_webView->remove_NavigationStarting(m_navigationStartingToken);
+    m_webView->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
+    m_webView->remove_ContentLoading(m_contentLoadingToken);
+    m_webView->remove_SourceChanged(m_sourceChangedToken);
+    m_webView->remove_HistoryChanged(m_historyChangedToken);
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+    m_webView->remove_FrameNavigationCompleted(m_frameNavigationCompletedToken);
+    m_webView->remove_DocumentTitleChanged(m_documentTitleChangedToken);
+    m_webView->remove_WebResourceRequested(m_webResourceRequestedToken);
+    m_webView->RemoveWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL);
+    if (auto webView2 = m_webView.try_query<ICoreWebView2_2>())
+    {
+        webView2->remove_DOMContentLoaded(m_domContentLoadedToken);
+    }
+    if (auto webView4 = m_webView.try_query<ICoreWebView2_4>())
+    {
+        webView4->remove_FrameCreated(m_frameCreatedToken);
+    }
+}
+
+NavigationTimingReplay::NavigationTimingReplay(ICoreWebView2* webView)
+    : m_webView(webView), m_source(reinterpret_cast<uint64_t>(this))
+{
+    CHECK_FAILURE(m_webView->add_NavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2*, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT
+            {
+                OnNavigationStarting(args, false);
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationStartingToken));
+    CHECK_FAILURE(m_webView->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [this](ICoreWebView2*, ICoreWebView2ContentLoadingEventArgs* args)
+                -> HRESULT
+            {
+                uint64_t now = GetNowMicros();
+                UINT64 navigationId = 0;
+                CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                m_collector.OnContentLoading(m_source, navigationId, now);
+                return S_OK;
+            })
+            .Get(),
+        &m_contentLoadingToken));
+    if (auto webView2 = m_webView.try_query<ICoreWebView2_2>())
+    {
+        CHECK_FAILURE(webView2->add_DOMContentLoaded(
+            Callback<ICoreWebView2DOMContentLoadedEventHandler>(
+                [this](ICoreWebView2*, ICoreWebView2DOMContentLoadedEventArgs* args)
+                    -> HRESULT
+                {
+                    uint64_t now = GetNowMicros();
+                    UINT64 navigationId = 0;
+                    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+                    m_collector.OnDOMContentLoaded(m_source, navigationId, now);
+                    return S_OK;
+                })
+                .Get(),
+            &m_domContentLoadedToken));
+    }
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2*, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                OnNavigationCompleted(args);
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken));
+    CHECK_FAILURE(m_webView->add_FrameNavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2*, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT
+            {
+                OnNavigationStarting(args, true);
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationStartingToken));
+    CHECK_FAILURE(m_webView->add_FrameNavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2*, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                OnNavigationCompleted(args);
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationCompletedToken));
+}
+
+void NavigationTimingReplay::OnNavigationStarting(
+    ICoreWebView2NavigationStartingEventArgs* args, bool isFrame)
+{
+    uint64_t now = GetNowMicros();
+    UINT64 navigationId = 0;
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+    CHECK_FAILURE(args->get_Uri(&uri));
+    m_collector.OnStarting(m_source, navigationId, ToUtf8(uri.get()), isFrame, now);
+}
+
+void NavigationTimingReplay::OnNavigationCompleted(
+    ICoreWebView2NavigationCompletedEventArgs* args)
+{
+    uint64_t now = GetNowMicros();
+    UINT64 navigationId = 0;
+    BOOL success = FALSE;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+    CHECK_FAILURE(args->get_IsSuccess(&success));
+    m_collector.OnCompleted(m_source, navigationId, !!success, now);
+}
+
+std::string NavigationTimingReplay::GetSummary() const
+{
+    const NavigationTimingCollector::Counters& counters = m_collector.GetCounters();
+    return std::to_string(counters.completed) + " completed, " +
+           std::to_string(counters.failed) + " failed, " +
+           std::to_string(counters.unmatched) + " unmatched, " +
+           std::to_string(m_collector.GetOriginCount()) + " origins";
+}
+
+NavigationTimingReplay::~NavigationTimingReplay()
+{
+    m_webView->remove_NavigationStarting(m_navigationStartingToken);
+    m_webView->remove_ContentLoading(m_contentLoadingToken);
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+    m_webView->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
+    m_webView->remove_FrameNavigationCompleted(m_frameNavigationCompletedToken);
+    if (auto webView2 = m_webView.try_query<ICoreWebView2_2>())
+    {
+        webView2->remove_DOMContentLoaded(m_domContentLoadedToken);
+    }
+}
+
+HistoryReplay::HistoryReplay(ICoreWebView2* webView) : m_webView(webView)
+{
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                BOOL success;
+                CHECK_FAILURE(args->get_IsSuccess(&success));
+                if (!success)
+                {
+                    return S_OK;
+                }
+                wil::unique_cotaskmem_string uri;
+                wil::unique_cotaskmem_string title;
+                CHECK_FAILURE(sender->get_Source(&uri));
+                CHECK_FAILURE(sender->get_DocumentTitle(&title));
+                std::wstring_view url = uri.get();
+                if (url.compare(0, 7, L"http://") != 0 && url.compare(0, 8, L"https://") != 0)
+                {
+                    return S_OK;
+                }
+                m_index.AddVisit(ToUtf8(url), ToUtf8(title.get()), std::time(nullptr));
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken));
+}
+
+std::string HistoryReplay::GetSummary() const
+{
+    return std::to_string(m_index.GetEntryCount()) + " pages, " +
+           std::to_string(m_index.GetNodeCount()) + " trie nodes";
+}
+
+HistoryReplay::~HistoryReplay()
+{
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+}
+
+CookieReplay::CookieReplay(ICoreWebView2* webView) : m_webView(webView)
+{
+    if (auto webView2 = m_webView.try_query<ICoreWebView2_2>())
+    {
+        CHECK_FAILURE(webView2->get_CookieManager(&m_cookieManager));
+    }
+    CHECK_FAILURE(m_webView->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT
+            {
+                BOOL success;
+                CHECK_FAILURE(args->get_IsSuccess(&success));
+                if (success)
+                {
+                    wil::unique_cotaskmem_string uri;
+                    CHECK_FAILURE(sender->get_Source(&uri));
+                    GetCookiesHelper(uri.get());
+                }
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken));
+}
+
+void CookieReplay::GetCookiesHelper(const std::wstring& uri)
+{
+    if (!m_cookieManager)
+    {
+        return;
+    }
+    CHECK_FAILURE(m_cookieManager->GetCookies(
+        uri.c_str(),
+        Callback<ICoreWebView2GetCookiesCompletedHandler>(
+            [this, uri](HRESULT error_code, ICoreWebView2CookieList* list) -> HRESULT
+            {
+                CHECK_FAILURE(error_code);
+
+                std::wstring result;
+                UINT cookie_list_size;
+                CHECK_FAILURE(list->get_Count(&cookie_list_size));
+                if (cookie_list_size == 0)
+                {
+                    result += L"No cookies found.";
+                }
+                else
+                {
+                    result += std::to_wstring(cookie_list_size) + L" cookie(s) found";
+                    if (!uri.empty())
+                    {
+                        result += L" on " + uri;
+                    }
+                    result += L"\n\n[";
+                    for (UINT i = 0; i < cookie_list_size; ++i)
+                    {
+                        wil::com_ptr<ICoreWebView2Cookie> cookie;
+                        CHECK_FAILURE(list->GetValueAtIndex(i, &cookie));
+                        if (cookie.get())
+                        {
+                            result += CookieToString(cookie.get());
+                            if (i != cookie_list_size - 1)
+                            {
+                                result += L",\n";
+                            }
+                        }
+                    }
+                    result += L"]";
+                }
+                m_lookups++;
+                m_cookiesFound += cookie_list_size;
+                return S_OK;
+            })
+            .Get()));
+}
+
+std::string CookieReplay::GetSummary() const
+{
+    return std::to_string(m_lookups) + " lookups, " + std::to_string(m_cookiesFound) +
+           " cookies found";
+}
+
+CookieReplay::~CookieReplay()
+{
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+}
@@ -0,0 +1,125 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "FakeWebView2.h"
+#include "HistoryIndex.h"
+#include "NavigationTimingCollector.h"
+#include "ReplayDriver.h"
+
+// Headless versions of the sample's components for the replay driver. The
+// sample's components need Win32 for their UI, so these keep only what their
+// event handlers do: the same calls on the WebView, and the same portable
+// units fed with the results.
+
+// The handlers of ScenarioWebViewEventMonitor: each event is formatted into
+// the JSON message the event view receives.
+class EventMonitorReplay : public ReplayComponent
+{
+public:
+    explicit EventMonitorReplay(ICoreWebView2* webView);
+    ~EventMonitorReplay() override;
+
+    std::string GetSummary() const override;
+
+    uint64_t GetMessageCount() const
+    {
+        return m_messageCount;
+    }
+
+private:
+    void PostEventMessage(const std::wstring& message);
+
+    wil::com_ptr<ICoreWebView2> m_webView;
+    uint64_t m_messageCount = 0;
+    uint64_t m_messageCharacters = 0;
+
+    EventRegistrationToken m_navigationStartingToken = {};
+    EventRegistrationToken m_frameNavigationStartingToken = {};
+    EventRegistrationToken m_contentLoadingToken = {};
+    EventRegistrationToken m_domContentLoadedToken = {};
+    EventRegistrationToken m_navigationCompletedToken = {};
+    EventRegistrationToken m_frameNavigationCompletedToken = {};
+    EventRegistrationToken m_sourceChangedToken = {};
+    EventRegistrationToken m_historyChangedToken = {};
+    EventRegistrationToken m_documentTitleChangedToken = {};
+    EventRegistrationToken m_webResourceRequestedToken = {};
+    EventRegistrationToken m_frameCreatedToken = {};
+};
+
+// The handlers of NavigationTimingComponent, which time each navigation's
+// phases per origin in a NavigationTimingCollector.
+class NavigationTimingReplay : public ReplayComponent
+{
+public:
+    explicit NavigationTimingReplay(ICoreWebView2* webView);
+    ~NavigationTimingReplay() override;
+
+    std::string GetSummary() const override;
+
+    const NavigationTimingCollector& GetCollector() const
+    {
+        return m_collector;
+    }
+
+private:
+    void OnNavigationStarting(ICoreWebView2NavigationStartingEventArgs* args, bool isFrame);
+    void OnNavigationCompleted(ICoreWebView2NavigationCompletedEventArgs* args);
+
+    wil::com_ptr<ICoreWebView2> m_webView;
+    NavigationTimingCollector m_collector;
+    uint64_t m_source;
+
+    EventRegistrationToken m_navigationStartingToken = {};
+    EventRegistrationToken m_contentLoadingToken = {};
+    EventRegistrationToken m_domContentLoadedToken = {};
+    EventRegistrationToken m_navigationCompletedToken = {};
+    EventRegistrationToken m_frameNavigationStartingToken = {};
+    EventRegistrationToken m_frameNavigationCompletedToken = {};
+};
+
+// The NavigationCompleted handler of ControlComponent, which records each
+// successful http(s) navigation in the HistoryIndex behind the address bar.
+class HistoryReplay : public ReplayComponent
+{
+public:
+    explicit HistoryReplay(ICoreWebView2* webView);
+    ~HistoryReplay() override;
+
+    std::string GetSummary() const override;
+
+    const HistoryIndex& GetIndex() const
+    {
+        return m_index;
+    }
+
+private:
+    wil::com_ptr<ICoreWebView2> m_webView;
+    HistoryIndex m_index;
+    EventRegistrationToken m_navigationCompletedToken = {};
+};
+
+// ScenarioCookieManagement's GetCookies, run for the page after each
+// successful navigation, with the result formatted as the scenario shows it.
+class CookieReplay : public ReplayComponent
+{
+public:
+    explicit CookieReplay(ICoreWebView2* webView);
+    ~CookieReplay() override;
+
+    std::string GetSummary() const override;
+
+private:
+    void GetCookiesHelper(const std::wstring& uri);
+
+    wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2CookieManager> m_cookieManager;
+    uint64_t m_lookups = 0;
+    uint64_t m_cookiesFound = 0;
+    EventRegistrationToken m_navigationCompletedToken = {};
+};
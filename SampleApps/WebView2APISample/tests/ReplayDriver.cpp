@@ -0,0 +1,201 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ReplayDriver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+namespace
+{
+uint64_t GetWallNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The CPU time of the calling thread. Where there's no thread clock, the wall
+// clock stands in, which also counts time the thread wasn't running.
+uint64_t GetThreadCpuNanos()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return GetWallNanos();
+#endif
+}
+} // namespace
+
+ReplayDriver::ReplayDriver(FakeWebView2* webView) : m_webView(webView)
+{
+    FakeDispatch::SetObserver(this);
+}
+
+ReplayDriver::~ReplayDriver()
+{
+    while (!m_components.empty())
+    {
+        m_components.pop_back();
+    }
+    FakeDispatch::SetObserver(nullptr);
+}
+
+void ReplayDriver::OnInvoking(int)
+{
+    if (m_depth++ == 0)
+    {
+        m_startAllocations = GetThreadAllocationCount();
+        m_startCpuNanos = GetThreadCpuNanos();
+    }
+}
+
+void ReplayDriver::OnInvoked(int owner)
+{
+    if (--m_depth != 0 || owner <= 0 || owner > static_cast<int>(m_stats.size()))
+    {
+        return;
+    }
+    uint64_t cpuNanos = GetThreadCpuNanos() - m_startCpuNanos;
+    AllocationCount allocations = GetThreadAllocationCount();
+    ComponentStats& stats = m_stats[owner - 1];
+    stats.invocations++;
+    stats.cpuNanos += cpuNanos;
+    stats.allocations += allocations.count - m_startAllocations.count;
+    stats.allocatedBytes += allocations.bytes - m_startAllocations.bytes;
+}
+
+ReplayDriver::Result ReplayDriver::Replay(
+    const std::vector<ReplayEvent>& events, const Options& options)
+{
+    Result result;
+    if (events.empty())
+    {
+        return result;
+    }
+    uint64_t firstMicros = events.front().timeMicros;
+    uint64_t durationMicros = events.back().timeMicros - firstMicros;
+    uint64_t maxId = 0;
+    for (const ReplayEvent& event : events)
+    {
+        maxId = (std::max)(maxId, (std::max)(event.navigationId, uint64_t(event.frameId)));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startNanos = GetWallNanos();
+    for (uint32_t repetition = 0; repetition < options.repeat; repetition++)
+    {
+        for (const ReplayEvent& event : events)
+        {
+            if (options.rate > 0)
+            {
+                double traceMicros = static_cast<double>(
+                    event.timeMicros - firstMicros + repetition * durationMicros);
+                std::this_thread::sleep_until(
+                    start + std::chrono::microseconds(
+                                static_cast<int64_t>(traceMicros / options.rate)));
+            }
+            Raise(event, repetition * (maxId + 1), &result);
+        }
+        // The event monitor doesn't record which frame was destroyed, so they
+        // all go at the end of the trace.
+        for (const auto& frame : m_frames)
+        {
+            frame->RaiseDestroyed();
+        }
+        m_frames.clear();
+    }
+    result.wallNanos = GetWallNanos() - startNanos;
+    return result;
+}
+
+void ReplayDriver::Raise(const ReplayEvent& event, uint64_t idOffset, Result* result)
+{
+    result->events++;
+    UINT64 navigationId = event.navigationId + idOffset;
+    switch (event.kind)
+    {
+    case ReplayEvent::Kind::NavigationStarting:
+    case ReplayEvent::Kind::FrameNavigationStarting:
+        m_webView->RaiseNavigationStarting(
+            event.uri, navigationId, event.kind == ReplayEvent::Kind::FrameNavigationStarting,
+            event.isUserInitiated, event.isRedirected);
+        break;
+    case ReplayEvent::Kind::ContentLoading:
+        m_webView->RaiseContentLoading(navigationId, event.isErrorPage);
+        break;
+    case ReplayEvent::Kind::DOMContentLoaded:
+        m_webView->RaiseDOMContentLoaded(navigationId);
+        break;
+    case ReplayEvent::Kind::NavigationCompleted:
+    case ReplayEvent::Kind::FrameNavigationCompleted:
+        m_webView->RaiseNavigationCompleted(
+            navigationId, event.isSuccess,
+            event.kind == ReplayEvent::Kind::FrameNavigationCompleted, event.webErrorStatus);
+        break;
+    case ReplayEvent::Kind::SourceChanged:
+        m_webView->RaiseSourceChanged(event.uri, event.isNewDocument);
+        break;
+    case ReplayEvent::Kind::HistoryChanged:
+        m_webView->RaiseHistoryChanged(event.canGoBack, event.canGoForward);
+        break;
+    case ReplayEvent::Kind::DocumentTitleChanged:
+        m_webView->RaiseDocumentTitleChanged(event.documentTitle);
+        break;
+    case ReplayEvent::Kind::WebResourceRequested:
+        if (!m_webView->RaiseWebResourceRequested(
+                event.uri, event.method, event.resourceContext))
+        {
+            result->unfiltered++;
+        }
+        break;
+    case ReplayEvent::Kind::FrameCreated:
+        m_frames.push_back(m_webView->CreateFrame(
+            event.frameName, static_cast<UINT32>(event.frameId + idOffset)));
+        break;
+    case ReplayEvent::Kind::DevToolsProtocolEventReceived:
+        m_webView->RaiseDevToolsProtocolEvent(event.eventName, event.parameterObjectAsJson);
+        break;
+    }
+}
+
+std::string ReplayDriver::FormatReport(const Result& result) const
+{
+    char line[256];
+    std::snprintf(
+        line, sizeof(line), "%llu events in %.3f ms, %llu unfiltered requests\n\n",
+        static_cast<unsigned long long>(result.events), result.wallNanos / 1e6,
+        static_cast<unsigned long long>(result.unfiltered));
+    std::string report = line;
+    std::snprintf(
+        line, sizeof(line), "%-24s %10s %10s %10s %12s %10s %12s\n", "component", "handlers",
+        "cpu ms", "ns/handler", "allocations", "per handler", "bytes");
+    report += line;
+    for (const ComponentStats& stats : m_stats)
+    {
+        double invocations = stats.invocations ? static_cast<double>(stats.invocations) : 1;
+        std::snprintf(
+            line, sizeof(line), "%-24s %10llu %10.3f %10.0f %12llu %10.2f %12llu\n",
+            stats.name.c_str(), static_cast<unsigned long long>(stats.invocations),
+            stats.cpuNanos / 1e6, stats.cpuNanos / invocations,
+            static_cast<unsigned long long>(stats.allocations),
+            stats.allocations / invocations,
+            static_cast<unsigned long long>(stats.allocatedBytes));
+        report += line;
+    }
+    report += "\n";
+    for (size_t i = 0; i < m_components.size(); i++)
+    {
+        report += m_stats[i].name + ": " + m_components[i]->GetSummary() + "\n";
+    }
+    return report;
+}
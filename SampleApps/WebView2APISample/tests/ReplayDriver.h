@@ -0,0 +1,103 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "FakeWebView2.h"
+#include "ReplayTrace.h"
+
+// A component driven by the replay driver. Like the sample's components, it
+// adds its handlers to the WebView in its constructor and removes them in its
+// destructor.
+class ReplayComponent
+{
+public:
+    virtual ~ReplayComponent() = default;
+    // A line about the state the replay left the component in.
+    virtual std::string GetSummary() const = 0;
+};
+
+// Replays traces into a FakeWebView2 and accounts the thread CPU time and the
+// allocations of every handler to the component that added it. Handlers
+// invoked from other handlers are accounted to the outermost one.
+//
+// Not thread-safe: components, the WebView and the driver share one thread.
+class ReplayDriver : private FakeDispatchObserver
+{
+public:
+    struct Options
+    {
+        // 1 replays the trace at the speed it was recorded, 10 ten times as
+        // fast, and 0 as fast as possible.
+        double rate = 0;
+        // Replays the trace this many times back to back. Navigation and
+        // frame IDs are offset in each repetition to keep them unique.
+        uint32_t repeat = 1;
+    };
+
+    struct ComponentStats
+    {
+        std::string name;
+        uint64_t invocations = 0;
+        uint64_t cpuNanos = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+    };
+
+    struct Result
+    {
+        uint64_t events = 0;
+        // WebResourceRequested events that no component's filter matched.
+        uint64_t unfiltered = 0;
+        uint64_t wallNanos = 0;
+    };
+
+    // `webView` must outlive the driver, which deletes its components.
+    explicit ReplayDriver(FakeWebView2* webView);
+    ~ReplayDriver();
+
+    // Creates a component of type T with the WebView and `args`. The handlers
+    // it adds are accounted to `name`.
+    template <typename T, typename... Args> T* NewComponent(std::string name, Args&&... args)
+    {
+        m_stats.push_back({std::move(name)});
+        FakeDispatch::SetOwner(static_cast<int>(m_stats.size()));
+        auto component = std::make_unique<T>(m_webView, std::forward<Args>(args)...);
+        FakeDispatch::SetOwner(0);
+        T* result = component.get();
+        m_components.push_back(std::move(component));
+        return result;
+    }
+
+    Result Replay(const std::vector<ReplayEvent>& events, const Options& options);
+
+    // Statistics in the order the components were created. They add up over
+    // all replays.
+    const std::vector<ComponentStats>& GetStats() const
+    {
+        return m_stats;
+    }
+    // A table of the statistics of each component, then their summaries.
+    std::string FormatReport(const Result& result) const;
+
+private:
+    void OnInvoking(int owner) override;
+    void OnInvoked(int owner) override;
+    void Raise(const ReplayEvent& event, uint64_t idOffset, Result* result);
+
+    FakeWebView2* m_webView;
+    std::vector<std::unique_ptr<ReplayComponent>> m_components;
+    std::vector<ComponentStats> m_stats;
+    std::vector<wil::com_ptr<FakeFrame>> m_frames;
+
+    int m_depth = 0;
+    uint64_t m_startCpuNanos = 0;
+    AllocationCount m_startAllocations;
+};
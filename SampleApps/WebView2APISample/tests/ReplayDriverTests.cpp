@@ -0,0 +1,169 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <sstream>
+#include <string>
+
+#include "ReplayComponents.h"
+#include "ReplayDriver.h"
+#include "ReplayTrace.h"
+#include "TestUtil.h"
+
+using Microsoft::WRL::Callback;
+using Microsoft::WRL::Make;
+
+namespace
+{
+void TestParse()
+{
+    std::istringstream input(
+        "{\"timeMicros\": 20, \"event\": {\"kind\": \"event\", \"name\": "
+        "\"NavigationCompleted\", \"args\": {\"navigationId\": 3, \"isSuccess\": false, "
+        "\"webErrorStatus\": \"COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT\"}, \"webview\": "
+        "{\"documentTitle\": \"T\\u00e9\\ud83d\\ude00\", \"source\": \"https://a/\"}}}\n"
+        "not json\n"
+        "\n"
+        "{\"timeMicros\": 10, \"event\": {\"kind\": \"event\", \"name\": "
+        "\"NavigationStarting\", \"args\": {\"navigationId\": 3, \"isUserInitiated\": true, "
+        "\"uri\": \"https://a/\\\"q\\\"\"}}}\n"
+        "{\"timeMicros\": 30, \"event\": {\"kind\": \"event\", \"name\": "
+        "\"ZoomFactorChanged\"}}\n"
+        "{\"timeMicros\": 40, \"event\": {\"kind\": \"event\", \"name\": "
+        "\"DevToolsProtocolEventReceived\", \"args\": {\"eventName\": \"Log.entryAdded\", "
+        "\"parameterObjectAsJson\": \"{}\"}}}\n");
+    ReplayTrace trace = ParseReplayTrace(input);
+    CHECK(trace.events.size() == 3);
+    CHECK(trace.skippedLines == 2);
+    if (trace.events.size() != 3)
+    {
+        return;
+    }
+    // Sorted by time.
+    const ReplayEvent& starting = trace.events[0];
+    CHECK(starting.kind == ReplayEvent::Kind::NavigationStarting);
+    CHECK(starting.navigationId == 3);
+    CHECK(starting.isUserInitiated);
+    CHECK(starting.uri == L"https://a/\"q\"");
+    const ReplayEvent& completed = trace.events[1];
+    CHECK(completed.kind == ReplayEvent::Kind::NavigationCompleted);
+    CHECK(!completed.isSuccess);
+    CHECK(completed.webErrorStatus == COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
+    CHECK(completed.documentTitle == L"Té\U0001f600");
+    const ReplayEvent& devTools = trace.events[2];
+    CHECK(devTools.kind == ReplayEvent::Kind::DevToolsProtocolEventReceived);
+    CHECK(devTools.eventName == L"Log.entryAdded");
+    CHECK(devTools.parameterObjectAsJson == L"{}");
+}
+
+void TestSampleTrace(const std::string& path)
+{
+    ReplayTrace trace;
+    CHECK(LoadReplayTrace(path, &trace));
+    CHECK(trace.events.size() == 56);
+    CHECK(trace.skippedLines == 0);
+
+    auto webView = Make<FakeWebView2>();
+    webView->GetFakeCookieManager()->SetCookie({L"MUID", L"1", L".bing.com"});
+    webView->GetFakeCookieManager()->SetCookie({L"lang", L"en", L"learn.microsoft.com"});
+    {
+        ReplayDriver driver(webView.get());
+        auto* monitor = driver.NewComponent<EventMonitorReplay>("EventMonitor");
+        auto* timing = driver.NewComponent<NavigationTimingReplay>("NavigationTiming");
+        auto* history = driver.NewComponent<HistoryReplay>("History");
+        driver.NewComponent<CookieReplay>("Cookies");
+
+        ReplayDriver::Options options;
+        options.repeat = 3;
+        ReplayDriver::Result result = driver.Replay(trace.events, options);
+        CHECK(result.events == 3 * trace.events.size());
+        CHECK(result.unfiltered == 0);
+
+        // Every event of the trace reaches the event monitor.
+        CHECK(monitor->GetMessageCount() == result.events);
+        // Offset IDs keep the repetitions apart: 4 pages and 3 frames
+        // complete in each, one page fails, and nothing is left unmatched.
+        const NavigationTimingCollector::Counters& counters =
+            timing->GetCollector().GetCounters();
+        CHECK(counters.completed == 3 * 7);
+        CHECK(counters.failed == 3);
+        CHECK(counters.unmatched == 0);
+        // The failed navigation isn't recorded; the others are visits to the
+        // same four pages.
+        CHECK(history->GetIndex().GetEntryCount() == 4);
+
+        const std::vector<ReplayDriver::ComponentStats>& stats = driver.GetStats();
+        CHECK(stats.size() == 4);
+        CHECK(stats[0].invocations == result.events);
+        CHECK(stats[2].invocations == 3 * 5);
+        CHECK(stats[3].invocations == 3 * 5);
+        // Formatting the monitor's messages allocates; the counter sees it.
+        CHECK(stats[0].allocations > 0);
+        std::string report = driver.FormatReport(result);
+        CHECK(report.find("Cookies: 12 lookups, 12 cookies found") != std::string::npos);
+    }
+    // The components removed every handler and filter they added.
+    CHECK(webView->GetHandlerCount() == 0);
+    CHECK(webView->GetWebResourceRequestedFilterCount() == 0);
+}
+
+void TestNestedHandlersAccountToOutermost()
+{
+    // A handler of one component that raises an event into another is
+    // accounted to the first one only.
+    class Raiser : public ReplayComponent
+    {
+    public:
+        Raiser(ICoreWebView2* webView, FakeWebView2* fake) : m_webView(webView)
+        {
+            CHECK_FAILURE(m_webView->add_ContentLoading(
+                Callback<ICoreWebView2ContentLoadingEventHandler>(
+                    [fake](ICoreWebView2*, ICoreWebView2ContentLoadingEventArgs*) -> HRESULT
+                    {
+                        fake->RaiseDocumentTitleChanged(L"nested");
+                        return S_OK;
+                    })
+                    .Get(),
+                &m_token));
+        }
+        ~Raiser() override
+        {
+            m_webView->remove_ContentLoading(m_token);
+        }
+        std::string GetSummary() const override
+        {
+            return "";
+        }
+
+    private:
+        wil::com_ptr<ICoreWebView2> m_webView;
+        EventRegistrationToken m_token = {};
+    };
+
+    auto webView = Make<FakeWebView2>();
+    ReplayDriver driver(webView.get());
+    driver.NewComponent<Raiser>("Raiser", webView.get());
+    driver.NewComponent<EventMonitorReplay>("EventMonitor");
+    ReplayEvent event;
+    event.kind = ReplayEvent::Kind::ContentLoading;
+    event.navigationId = 1;
+    driver.Replay({event}, ReplayDriver::Options());
+    CHECK(driver.GetStats()[0].invocations == 1);
+    // The monitor's ContentLoading handler is accounted, its nested
+    // DocumentTitleChanged handler isn't.
+    CHECK(driver.GetStats()[1].invocations == 1);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "usage: ReplayDriverTests <EventMonitorTrace.jsonl>\n");
+        return 2;
+    }
+    TestParse();
+    TestSampleTrace(argv[1]);
+    TestNestedHandlersAccountToOutermost();
+    return FinishTests("ReplayDriverTests");
+}
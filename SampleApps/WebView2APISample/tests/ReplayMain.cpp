@@ -0,0 +1,78 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays a trace recorded by the event monitor into a FakeWebView2 with the
+// headless components attached, and prints what each of them cost:
+//     webview2_replay <trace.jsonl> [--rate R] [--repeat N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "ReplayComponents.h"
+#include "ReplayDriver.h"
+#include "ReplayTrace.h"
+
+namespace
+{
+int PrintUsage()
+{
+    std::fprintf(stderr, "usage: webview2_replay <trace.jsonl> [--rate R] [--repeat N]\n");
+    std::fprintf(stderr, "  --rate R    replay R times as fast as recorded; 0, the default,\n");
+    std::fprintf(stderr, "              replays as fast as possible\n");
+    std::fprintf(stderr, "  --repeat N  replay the trace N times back to back\n");
+    return 2;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    ReplayDriver::Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            options.rate = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            options.repeat = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (path.empty() && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            return PrintUsage();
+        }
+    }
+    if (path.empty() || options.rate < 0 || options.repeat == 0)
+    {
+        return PrintUsage();
+    }
+
+    ReplayTrace trace;
+    if (!LoadReplayTrace(path, &trace))
+    {
+        std::fprintf(stderr, "Can't read %s\n", path.c_str());
+        return 1;
+    }
+    std::printf(
+        "%s: %zu events, %zu lines skipped\n", path.c_str(), trace.events.size(),
+        trace.skippedLines);
+
+    auto webView = Microsoft::WRL::Make<FakeWebView2>();
+    ReplayDriver driver(webView.get());
+    driver.NewComponent<EventMonitorReplay>("EventMonitor");
+    driver.NewComponent<NavigationTimingReplay>("NavigationTiming");
+    driver.NewComponent<HistoryReplay>("History");
+    driver.NewComponent<CookieReplay>("Cookies");
+
+    ReplayDriver::Result result = driver.Replay(trace.events, options);
+    std::printf("%s", driver.FormatReport(result).c_str());
+    return 0;
+}
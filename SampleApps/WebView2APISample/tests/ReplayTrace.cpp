@@ -0,0 +1,465 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ReplayTrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+// A parsed JSON value. Objects keep their members in order.
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Boolean,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* Find(std::string_view key) const
+    {
+        for (const auto& member : members)
+        {
+            if (member.first == key)
+            {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// A recursive descent parser for one line of a trace.
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view text) : m_text(text)
+    {
+    }
+
+    // Returns false if the text isn't a single JSON value.
+    bool Parse(JsonValue* value)
+    {
+        if (!ParseValue(value, 0))
+        {
+            return false;
+        }
+        SkipSpace();
+        return m_position == m_text.size();
+    }
+
+private:
+    static constexpr int c_maxDepth = 64;
+
+    void SkipSpace()
+    {
+        while (m_position < m_text.size() &&
+               (m_text[m_position] == ' ' || m_text[m_position] == '\t' ||
+                m_text[m_position] == '\r' || m_text[m_position] == '\n'))
+        {
+            m_position++;
+        }
+    }
+
+    bool Consume(std::string_view token)
+    {
+        if (m_text.substr(m_position, token.size()) != token)
+        {
+            return false;
+        }
+        m_position += token.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue* value, int depth)
+    {
+        SkipSpace();
+        if (m_position == m_text.size() || depth > c_maxDepth)
+        {
+            return false;
+        }
+        switch (m_text[m_position])
+        {
+        case '{':
+            value->type = JsonValue::Type::Object;
+            return ParseObject(value, depth);
+        case '[':
+            value->type = JsonValue::Type::Array;
+            return ParseArray(value, depth);
+        case '"':
+            value->type = JsonValue::Type::String;
+            return ParseString(&value->string);
+        case 't':
+            value->type = JsonValue::Type::Boolean;
+            value->boolean = true;
+            return Consume("true");
+        case 'f':
+            value->type = JsonValue::Type::Boolean;
+            return Consume("false");
+        case 'n':
+            return Consume("null");
+        default:
+            value->type = JsonValue::Type::Number;
+            return ParseNumber(&value->number);
+        }
+    }
+
+    bool ParseObject(JsonValue* value, int depth)
+    {
+        m_position++;
+        SkipSpace();
+        if (Consume("}"))
+        {
+            return true;
+        }
+        do
+        {
+            SkipSpace();
+            std::pair<std::string, JsonValue> member;
+            if (!ParseString(&member.first))
+            {
+                return false;
+            }
+            SkipSpace();
+            if (!Consume(":") || !ParseValue(&member.second, depth + 1))
+            {
+                return false;
+            }
+            value->members.push_back(std::move(member));
+            SkipSpace();
+        } while (Consume(","));
+        return Consume("}");
+    }
+
+    bool ParseArray(JsonValue* value, int depth)
+    {
+        m_position++;
+        SkipSpace();
+        if (Consume("]"))
+        {
+            return true;
+        }
+        do
+        {
+            value->items.emplace_back();
+            if (!ParseValue(&value->items.back(), depth + 1))
+            {
+                return false;
+            }
+            SkipSpace();
+        } while (Consume(","));
+        return Consume("]");
+    }
+
+    bool ParseNumber(double* number)
+    {
+        size_t start = m_position;
+        while (m_position < m_text.size() &&
+               std::string_view("+-.0123456789eE").find(m_text[m_position]) !=
+                   std::string_view::npos)
+        {
+            m_position++;
+        }
+        if (start == m_position)
+        {
+            return false;
+        }
+        std::string digits(m_text.substr(start, m_position - start));
+        char* end = nullptr;
+        *number = std::strtod(digits.c_str(), &end);
+        return end == digits.c_str() + digits.size();
+    }
+
+    bool ParseHex4(uint32_t* codeUnit)
+    {
+        if (m_text.size() - m_position < 4)
+        {
+            return false;
+        }
+        *codeUnit = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = m_text[m_position++];
+            uint32_t digit = c >= '0' && c <= '9'   ? c - '0'
+                             : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                             : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                                    : 16;
+            if (digit == 16)
+            {
+                return false;
+            }
+            *codeUnit = *codeUnit * 16 + digit;
+        }
+        return true;
+    }
+
+    // Appends the UTF-8 encoding of a \u escape, combining surrogate pairs.
+    bool ParseUnicodeEscape(std::string* result)
+    {
+        uint32_t codePoint;
+        if (!ParseHex4(&codePoint))
+        {
+            return false;
+        }
+        if (codePoint >= 0xD800 && codePoint < 0xDC00 && Consume("\\u"))
+        {
+            uint32_t low;
+            if (!ParseHex4(&low) || low < 0xDC00 || low > 0xDFFF)
+            {
+                return false;
+            }
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+        }
+        std::wstring wide(1, static_cast<wchar_t>(codePoint));
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            wide = {
+                static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10)),
+                static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF))};
+        }
+        *result += ToUtf8(wide);
+        return true;
+    }
+
+    bool ParseString(std::string* result)
+    {
+        if (!Consume("\""))
+        {
+            return false;
+        }
+        while (m_position < m_text.size())
+        {
+            char c = m_text[m_position++];
+            if (c == '"')
+            {
+                return true;
+            }
+            if (c != '\\')
+            {
+                result->push_back(c);
+                continue;
+            }
+            if (m_position == m_text.size())
+            {
+                return false;
+            }
+            char escaped = m_text[m_position++];
+            switch (escaped)
+            {
+            case 'b':
+                result->push_back('\b');
+                break;
+            case 'f':
+                result->push_back('\f');
+                break;
+            case 'n':
+                result->push_back('\n');
+                break;
+            case 'r':
+                result->push_back('\r');
+                break;
+            case 't':
+                result->push_back('\t');
+                break;
+            case 'u':
+                if (!ParseUnicodeEscape(result))
+                {
+                    return false;
+                }
+                break;
+            default:
+                result->push_back(escaped);
+            }
+        }
+        return false;
+    }
+
+    std::string_view m_text;
+    size_t m_position = 0;
+};
+
+const JsonValue* FindPath(const JsonValue& value, std::initializer_list<std::string_view> path)
+{
+    const JsonValue* current = &value;
+    for (std::string_view key : path)
+    {
+        current = current->Find(key);
+        if (!current)
+        {
+            return nullptr;
+        }
+    }
+    return current;
+}
+
+std::wstring GetString(const JsonValue& value, std::initializer_list<std::string_view> path)
+{
+    const JsonValue* found = FindPath(value, path);
+    return found && found->type == JsonValue::Type::String ? ToUtf16(found->string)
+                                                           : std::wstring();
+}
+
+bool GetBool(const JsonValue& value, std::initializer_list<std::string_view> path)
+{
+    const JsonValue* found = FindPath(value, path);
+    return found && found->type == JsonValue::Type::Boolean && found->boolean;
+}
+
+uint64_t GetUInt(const JsonValue& value, std::initializer_list<std::string_view> path)
+{
+    const JsonValue* found = FindPath(value, path);
+    return found && found->type == JsonValue::Type::Number && found->number > 0
+               ? static_cast<uint64_t>(found->number)
+               : 0;
+}
+
+COREWEBVIEW2_WEB_ERROR_STATUS ParseWebErrorStatus(const std::wstring& name)
+{
+    static const std::pair<const wchar_t*, COREWEBVIEW2_WEB_ERROR_STATUS> c_statuses[] = {
+        {L"COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE",
+         COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE},
+        {L"COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT", COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT},
+        {L"COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED",
+         COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED},
+        {L"COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED",
+         COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED},
+        {L"COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED",
+         COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED},
+    };
+    for (const auto& status : c_statuses)
+    {
+        if (name == status.first)
+        {
+            return status.second;
+        }
+    }
+    return COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN;
+}
+
+bool ParseEventKind(std::string_view name, ReplayEvent::Kind* kind)
+{
+    static const std::pair<std::string_view, ReplayEvent::Kind> c_kinds[] = {
+        {"NavigationStarting", ReplayEvent::Kind::NavigationStarting},
+        {"FrameNavigationStarting", ReplayEvent::Kind::FrameNavigationStarting},
+        {"ContentLoading", ReplayEvent::Kind::ContentLoading},
+        {"DOMContentLoaded", ReplayEvent::Kind::DOMContentLoaded},
+        {"NavigationCompleted", ReplayEvent::Kind::NavigationCompleted},
+        {"FrameNavigationCompleted", ReplayEvent::Kind::FrameNavigationCompleted},
+        {"SourceChanged", ReplayEvent::Kind::SourceChanged},
+        {"HistoryChanged", ReplayEvent::Kind::HistoryChanged},
+        {"DocumentTitleChanged", ReplayEvent::Kind::DocumentTitleChanged},
+        {"WebResourceRequested", ReplayEvent::Kind::WebResourceRequested},
+        {"FrameCreated", ReplayEvent::Kind::FrameCreated},
+        {"DevToolsProtocolEventReceived", ReplayEvent::Kind::DevToolsProtocolEventReceived},
+    };
+    for (const auto& entry : c_kinds)
+    {
+        if (entry.first == name)
+        {
+            *kind = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseEvent(const JsonValue& line, ReplayEvent* event)
+{
+    const JsonValue* message = line.Find("event");
+    const JsonValue* name = message ? message->Find("name") : nullptr;
+    if (!name || name->type != JsonValue::Type::String ||
+        !ParseEventKind(name->string, &event->kind))
+    {
+        return false;
+    }
+    event->timeMicros = GetUInt(line, {"timeMicros"});
+    const JsonValue& m = *message;
+    event->navigationId = GetUInt(m, {"args", "navigationId"});
+    event->isUserInitiated = GetBool(m, {"args", "isUserInitiated"});
+    event->isRedirected = GetBool(m, {"args", "isRedirected"});
+    event->isErrorPage = GetBool(m, {"args", "isErrorPage"});
+    event->isSuccess = GetBool(m, {"args", "isSuccess"});
+    event->isNewDocument = GetBool(m, {"args", "isNewDocument"});
+    event->webErrorStatus = ParseWebErrorStatus(GetString(m, {"args", "webErrorStatus"}));
+    event->canGoBack = GetBool(m, {"webview", "canGoBack"});
+    event->canGoForward = GetBool(m, {"webview", "canGoForward"});
+    event->documentTitle = GetString(m, {"webview", "documentTitle"});
+    switch (event->kind)
+    {
+    case ReplayEvent::Kind::SourceChanged:
+        event->uri = GetString(m, {"webview", "source"});
+        break;
+    case ReplayEvent::Kind::WebResourceRequested:
+        event->uri = GetString(m, {"args", "request", "uri"});
+        event->method = GetString(m, {"args", "request", "method"});
+        break;
+    case ReplayEvent::Kind::FrameCreated:
+        event->frameName = GetString(m, {"args", "frame"});
+        event->frameId = static_cast<uint32_t>(GetUInt(m, {"args", "frame id"}));
+        break;
+    case ReplayEvent::Kind::DevToolsProtocolEventReceived:
+        event->eventName = GetString(m, {"args", "eventName"});
+        event->parameterObjectAsJson = GetString(m, {"args", "parameterObjectAsJson"});
+        break;
+    default:
+        event->uri = GetString(m, {"args", "uri"});
+        break;
+    }
+    return true;
+}
+} // namespace
+
+ReplayTrace ParseReplayTrace(std::istream& input)
+{
+    ReplayTrace trace;
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        JsonValue value;
+        ReplayEvent event;
+        if (JsonParser(line).Parse(&value) && ParseEvent(value, &event))
+        {
+            trace.events.push_back(std::move(event));
+        }
+        else
+        {
+            trace.skippedLines++;
+        }
+    }
+    std::stable_sort(
+        trace.events.begin(), trace.events.end(), [](const ReplayEvent& a, const ReplayEvent& b)
+        { return a.timeMicros < b.timeMicros; });
+    return trace;
+}
+
+bool LoadReplayTrace(const std::string& path, ReplayTrace* trace)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+    {
+        return false;
+    }
+    *trace = ParseReplayTrace(input);
+    return true;
+}
@@ -0,0 +1,71 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "FakeWebView2.h"
+
+// An event to raise on a FakeWebView2, parsed from a trace recorded by the
+// event monitor's "Record trace" button. Each line of such a trace is
+//     {"timeMicros": <time>, "event": <the message sent to the event view>}
+// Only the members used by the event's kind are set.
+struct ReplayEvent
+{
+    enum class Kind
+    {
+        NavigationStarting,
+        FrameNavigationStarting,
+        ContentLoading,
+        DOMContentLoaded,
+        NavigationCompleted,
+        FrameNavigationCompleted,
+        SourceChanged,
+        HistoryChanged,
+        DocumentTitleChanged,
+        WebResourceRequested,
+        FrameCreated,
+        // The event monitor doesn't record these; hand-written traces can add
+        //     {"name": "DevToolsProtocolEventReceived",
+        //      "args": {"eventName": ..., "parameterObjectAsJson": ...}}
+        DevToolsProtocolEventReceived,
+    };
+
+    uint64_t timeMicros = 0;
+    Kind kind = Kind::NavigationStarting;
+    uint64_t navigationId = 0;
+    bool isUserInitiated = false;
+    bool isRedirected = false;
+    bool isErrorPage = false;
+    bool isSuccess = false;
+    bool isNewDocument = false;
+    bool canGoBack = false;
+    bool canGoForward = false;
+    COREWEBVIEW2_WEB_ERROR_STATUS webErrorStatus = COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN;
+    // The navigation or request URI, or the WebView's source after SourceChanged.
+    std::wstring uri;
+    std::wstring documentTitle;
+    std::wstring method;
+    // The event monitor doesn't record it, so requests replay as OTHER.
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext = COREWEBVIEW2_WEB_RESOURCE_CONTEXT_OTHER;
+    std::wstring frameName;
+    uint32_t frameId = 0;
+    std::wstring eventName;
+    std::wstring parameterObjectAsJson;
+};
+
+struct ReplayTrace
+{
+    std::vector<ReplayEvent> events;
+    // Lines that aren't JSON, and events of kinds the fake can't raise.
+    size_t skippedLines = 0;
+};
+
+// Parses a trace. Events are sorted by time, as the event monitor writes them.
+ReplayTrace ParseReplayTrace(std::istream& input);
+bool LoadReplayTrace(const std::string& path, ReplayTrace* trace);
@@ -0,0 +1,184 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks Sha256 against the FIPS 180-2 test vectors and against itself fed in
+// random pieces, then reports its throughput on one thread, on every core at
+// once, and through DownloadVerifier::HashFile on a file in the page cache:
+//     Sha256Bench [megabytes per thread]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DownloadVerifier.h"
+#include "Sha256.h"
+
+namespace
+{
+bool Check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s\n", message);
+    }
+    return condition;
+}
+
+bool CheckVectors()
+{
+    struct Vector
+    {
+        std::string message;
+        const char* sha256;
+    };
+    const Vector vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopq"
+         "klmnopqrlmnopqrsmnopqrstnopqrstu",
+         "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+        {std::string(1000000, 'a'),
+         "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    bool ok = true;
+    for (const Vector& vector : vectors)
+    {
+        ok = Check(
+                 Sha256::ToHex(Sha256::Hash(vector.message.data(), vector.message.size())) ==
+                     vector.sha256,
+                 "A FIPS 180-2 vector doesn't match.") &&
+             ok;
+    }
+    return ok;
+}
+
+// Hashes the same bytes in one piece and in random pieces, which exercises
+// every offset into the block buffer.
+bool CheckPieces(const std::vector<uint8_t>& data, std::mt19937& random)
+{
+    Sha256::Digest expected = Sha256::Hash(data.data(), data.size());
+    for (int round = 0; round < 20; round++)
+    {
+        Sha256 sha;
+        size_t offset = 0;
+        while (offset < data.size())
+        {
+            size_t size = (std::min)(data.size() - offset, size_t(random() % 300));
+            sha.Update(data.data() + offset, size);
+            offset += size;
+        }
+        if (!Check(sha.Finish() == expected, "Hashing in pieces changes the digest."))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+double GetSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t megabytes = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1024;
+    std::mt19937 random(1);
+    std::vector<uint8_t> data(4 * 1024 * 1024);
+    for (uint8_t& byte : data)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    std::vector<uint8_t> piece(data.begin(), data.begin() + 100000);
+    bool ok = CheckVectors() && CheckPieces(piece, random);
+
+    // A manifest line with a byte outside ASCII is skipped, not misread.
+    DownloadVerifier verifier(1, nullptr);
+    std::istringstream manifest(
+        std::string(Sha256::ToHex(Sha256::Hash("abc", 3))) + "  abc.txt\n" +
+        std::string(63, 'a') + "\xE9  bad.txt\n");
+    ok = ok && Check(verifier.LoadManifest(manifest) == 1, "The manifest was misread.");
+
+    // Each thread hashes its own copy of the buffer, over and over.
+    size_t threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+    size_t repeats = (std::max)(size_t(1), megabytes / 4);
+    double bytesPerThread = double(repeats) * data.size();
+    std::printf(
+        "SHA extensions: %s\n%8s %10s %12s\n", Sha256::IsHardwareAccelerated() ? "yes" : "no",
+        "threads", "GB/s", "GB/s/core");
+    std::vector<size_t> threadCounts = {1};
+    if (threadCount > 1)
+    {
+        threadCounts.push_back(threadCount);
+    }
+    for (size_t threads : threadCounts)
+    {
+        std::atomic<uint32_t> sink{0};
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back(
+                [&, t]
+                {
+                    std::vector<uint8_t> copy(data);
+                    copy[0] = static_cast<uint8_t>(t);
+                    Sha256 sha;
+                    for (size_t i = 0; i < repeats; i++)
+                    {
+                        sha.Update(copy.data(), copy.size());
+                    }
+                    sink += sha.Finish()[0];
+                });
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        double seconds = GetSeconds(start);
+        double gigabytesPerSecond = bytesPerThread * threads / seconds / 1e9;
+        std::printf(
+            "%8zu %10.2f %12.2f\n", threads, gigabytesPerSecond, gigabytesPerSecond / threads);
+    }
+
+    // The same through the file reads of the verifier.
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "Sha256Bench.bin";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < (std::min)(repeats, size_t(64)); i++)
+        {
+            file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+    }
+    Sha256::Digest fileDigest;
+    uint64_t fileBytes = 0;
+    DownloadVerifier::HashFile(path, &fileDigest, &fileBytes);
+    auto start = std::chrono::steady_clock::now();
+    ok = Check(DownloadVerifier::HashFile(path, &fileDigest, &fileBytes), "HashFile failed.") &&
+         ok;
+    double seconds = GetSeconds(start);
+    Sha256 expected;
+    for (size_t i = 0; i < (std::min)(repeats, size_t(64)); i++)
+    {
+        expected.Update(data.data(), data.size());
+    }
+    ok = Check(fileDigest == expected.Finish(), "HashFile's digest is wrong.") && ok;
+    std::printf(
+        "HashFile: %.2f GB/s over %llu MB\n", fileBytes / seconds / 1e9,
+        static_cast<unsigned long long>(fileBytes >> 20));
+    std::filesystem::remove(path);
+    return ok ? 0 : 1;
+}
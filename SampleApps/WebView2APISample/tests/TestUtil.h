@@ -0,0 +1,44 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdio>
+
+// The checks of the test programs. A failed CHECK reports its condition and
+// carries on; the test program's main returns FinishTests() so that CTest sees
+// the failure.
+
+namespace TestUtil
+{
+inline int& GetFailureCount()
+{
+    static int s_failureCount = 0;
+    return s_failureCount;
+}
+} // namespace TestUtil
+
+#define CHECK(condition)                                                                       \
+    do                                                                                         \
+    {                                                                                          \
+        if (!(condition))                                                                      \
+        {                                                                                      \
+            std::fprintf(                                                                      \
+                stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #condition);         \
+            TestUtil::GetFailureCount()++;                                                     \
+        }                                                                                      \
+    } while (false)
+
+// Reports the result and returns the exit code of the test program.
+inline int FinishTests(const char* name)
+{
+    int failures = TestUtil::GetFailureCount();
+    if (failures)
+    {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures);
+        return 1;
+    }
+    std::printf("%s: passed\n", name);
+    return 0;
+}
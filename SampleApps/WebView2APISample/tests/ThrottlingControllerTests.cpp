@@ -0,0 +1,253 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "ThrottlingController.h"
+
+namespace
+{
+using Command = ThrottlingController::Command;
+using Priority = ThrottlingController::Priority;
+
+bool Contains(const std::string& text, const std::string& part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+void TestParseCommand()
+{
+    Command command;
+    CHECK(ThrottlingController::ParseCommand(
+        R"({"command":"set-interval","params":{"priority":"untrusted","intervalMs":"250"}})",
+        &command));
+    CHECK(command.kind == Command::Kind::SetInterval);
+    CHECK(command.priority == Priority::Untrusted);
+    CHECK(command.intervalMs == 250);
+    CHECK(!ThrottlingController::ParseCommand(
+        R"({"command":"set-interval","params":{"priority":"x","intervalMs":"250"}})",
+        &command));
+    CHECK(!ThrottlingController::ParseCommand(
+        R"({"command":"set-interval","params":{"priority":"foreground","intervalMs":"-1"}})",
+        &command));
+    CHECK(!ThrottlingController::ParseCommand(
+        R"({"command":"set-interval","params":{"priority":"foreground","intervalMs":"1e12"}})",
+        &command));
+    CHECK(!ThrottlingController::ParseCommand(
+        R"({"command":"set-interval","params":{"priority":"foreground","intervalMs":"abc"}})",
+        &command));
+
+    CHECK(ThrottlingController::ParseCommand(
+        R"({"command" : "report-delay", "params": {"frameId": "trusted", "delayAvg": 4.25}})",
+        &command));
+    CHECK(command.kind == Command::Kind::ReportDelay);
+    CHECK(command.frameName == "trusted");
+    CHECK(command.delayMs == 4.25);
+
+    CHECK(ThrottlingController::ParseCommand(R"({"command":"toggle-visibility"})", &command));
+    CHECK(command.kind == Command::Kind::ToggleVisibility);
+    CHECK(ThrottlingController::ParseCommand(
+        R"({"command":"scenario","params":{"label":"hidden-unthrottle"}})", &command));
+    CHECK(command.kind == Command::Kind::Scenario);
+    CHECK(command.label == "hidden-unthrottle");
+    CHECK(!ThrottlingController::ParseCommand(R"({"foo":1})", &command));
+}
+
+void TestGetOrigin()
+{
+    CHECK(
+        ThrottlingController::GetOrigin("HTTPS://user@Untrusted.Example:8080/a?b") ==
+        "https://untrusted.example:8080");
+    CHECK(ThrottlingController::GetOrigin("https://a.example") == "https://a.example");
+    CHECK(ThrottlingController::GetOrigin("about:blank").empty());
+    CHECK(ThrottlingController::GetOrigin("https:///path").empty());
+}
+
+void TestPolicy()
+{
+    ThrottlingController controller;
+    controller.SetTopLevelUri("https://appassets.example/ScenarioThrottlingControl.html", 0);
+    CHECK(!controller.UpdateFrame("trusted", "https://appassets.example/1PP.html", 0));
+    CHECK(controller.UpdateFrame("untrusted", "https://untrusted.example/3PP.html", 0));
+    CHECK(!controller.UpdateFrame("blank", "about:blank", 0));
+    controller.AddTrustedOrigin("https://partner.example/");
+    CHECK(!controller.UpdateFrame("partner", "https://partner.example/ad.html", 0));
+
+    CHECK(controller.GetFramePriority("untrusted", 0) == Priority::Untrusted);
+    CHECK(controller.GetFramePriority("trusted", 0) == Priority::Foreground);
+    // Frames not updated yet are taken to be trusted.
+    CHECK(controller.GetFramePriority("unknown", 0) == Priority::Foreground);
+
+    controller.SetVisible(false, 1000);
+    CHECK(controller.GetFramePriority("trusted", 1000) == Priority::Background);
+    CHECK(
+        controller.GetFramePriority(
+            "trusted", 1000 + ThrottlingController::c_intensiveAfterMs) ==
+        Priority::Intensive);
+    CHECK(controller.GetFramePriority("untrusted", 1000) == Priority::Untrusted);
+
+    controller.SetInterval(Priority::Foreground, 10, 2000);
+    controller.ApplyScenario("hidden-unthrottle", 2000);
+    ThrottlingController::Intervals intervals = controller.GetIntervals();
+    CHECK(intervals[static_cast<size_t>(Priority::Background)] == 10);
+    CHECK(intervals[static_cast<size_t>(Priority::Intensive)] == 10);
+    controller.ApplyScenario("hidden-reset", 2000);
+    controller.ApplyScenario("interaction-throttle", 2000);
+    intervals = controller.GetIntervals();
+    CHECK(intervals[static_cast<size_t>(Priority::Foreground)] == 1000);
+    CHECK(!controller.ApplyScenario("unknown", 2000));
+
+    // A new top-level origin makes the old one's frames untrusted.
+    controller.SetTopLevelUri("https://untrusted.example/", 3000);
+    CHECK(controller.IsUntrusted("trusted"));
+    CHECK(!controller.IsUntrusted("untrusted"));
+    controller.RemoveFrame("trusted");
+    CHECK(!controller.IsUntrusted("trusted"));
+}
+
+void TestDropsReportsSpanningChanges()
+{
+    ThrottlingController controller;
+    controller.SetInterval(Priority::Foreground, 100, 0);
+    // 20 steps of 100 ms that started before the change at 0.
+    CHECK(!controller.RecordDelay("main", 100, 1500));
+    CHECK(controller.RecordDelay("main", 100, 2500));
+    controller.SetVisible(false, 3000);
+    CHECK(!controller.RecordDelay("main", 100, 4000));
+    // Hidden long enough for the 20 steps to span the switch to intensive.
+    int64_t intensiveMs = 3000 + ThrottlingController::c_intensiveAfterMs;
+    CHECK(!controller.RecordDelay("main", 1000, intensiveMs + 10000));
+    CHECK(controller.RecordDelay("main", 1000, intensiveMs + 20000));
+    CHECK(controller.GetDroppedCount() == 3);
+}
+
+// A frame of the simulated browser: its setInterval(..., 0) wakes at the next
+// multiple of the interval of its priority, as aligned wake-ups do, or every
+// 4 ms when unthrottled, and reports the average delay of each 20 steps.
+struct SimulatedFrame
+{
+    std::string name;
+    int64_t sampleStartMs = 0;
+    uint32_t steps = 0;
+    int64_t nextWakeMs = 0;
+};
+
+class SimulatedBrowser
+{
+public:
+    explicit SimulatedBrowser(ThrottlingController* controller) : m_controller(controller)
+    {
+    }
+
+    void AddFrame(const std::string& name)
+    {
+        SimulatedFrame frame;
+        frame.name = name;
+        frame.sampleStartMs = m_nowMs;
+        frame.nextWakeMs = m_nowMs + c_unthrottledMs;
+        m_frames.push_back(frame);
+    }
+
+    // Runs the timers for `durationMs` and returns the number of wake-ups.
+    uint64_t Run(int64_t durationMs)
+    {
+        uint64_t wakeUps = 0;
+        for (int64_t endMs = m_nowMs + durationMs; m_nowMs < endMs; m_nowMs++)
+        {
+            for (SimulatedFrame& frame : m_frames)
+            {
+                if (m_nowMs < frame.nextWakeMs)
+                {
+                    continue;
+                }
+                wakeUps++;
+                if (++frame.steps == ThrottlingController::c_stepsPerSample)
+                {
+                    m_controller->RecordDelay(
+                        frame.name,
+                        double(m_nowMs - frame.sampleStartMs) /
+                            ThrottlingController::c_stepsPerSample,
+                        m_nowMs);
+                    frame.steps = 0;
+                    frame.sampleStartMs = m_nowMs;
+                }
+                Priority priority = m_controller->GetFramePriority(frame.name, m_nowMs);
+                int64_t interval = m_controller->GetIntervals()[static_cast<size_t>(priority)];
+                frame.nextWakeMs = interval > c_unthrottledMs
+                                       ? (m_nowMs / interval + 1) * interval
+                                       : m_nowMs + c_unthrottledMs;
+            }
+        }
+        return wakeUps;
+    }
+
+    int64_t GetNow() const
+    {
+        return m_nowMs;
+    }
+
+private:
+    static constexpr int64_t c_unthrottledMs = 4;
+
+    ThrottlingController* m_controller;
+    std::vector<SimulatedFrame> m_frames;
+    int64_t m_nowMs = 0;
+};
+
+void TestSimulatedTimers()
+{
+    ThrottlingController controller;
+    SimulatedBrowser browser(&controller);
+    const char* topLevelUri = "https://appassets.example/ScenarioThrottlingControl.html";
+    controller.SetTopLevelUri(topLevelUri, 0);
+    controller.UpdateFrame("main", topLevelUri, 0);
+    controller.UpdateFrame("trusted", "https://appassets.example/1PP.html", 0);
+    controller.UpdateFrame("untrusted", "https://untrusted.example/3PP.html", 0);
+    browser.AddFrame("main");
+    browser.AddFrame("trusted");
+    browser.AddFrame("untrusted");
+
+    // Visible with the defaults: the untrusted frame wakes once a second.
+    uint64_t unthrottled = browser.Run(60 * 1000);
+    CHECK(unthrottled > 2 * 60 * 250 - 10);
+    controller.SetInterval(Priority::Untrusted, 500, browser.GetNow());
+    browser.Run(120 * 1000);
+    // Hidden: the trusted frames drop to the background interval, then to the
+    // intensive one after five minutes.
+    controller.SetVisible(false, browser.GetNow());
+    uint64_t hidden = browser.Run(10 * 60 * 1000);
+    CHECK(hidden < 10 * 60 * 5);
+    controller.ApplyScenario("hidden-unthrottle", browser.GetNow());
+    browser.Run(60 * 1000);
+    controller.SetVisible(true, browser.GetNow());
+    controller.ApplyScenario("interaction-throttle", browser.GetNow());
+    uint64_t throttled = browser.Run(120 * 1000);
+    CHECK(throttled < 120 * 5);
+
+    std::string report = controller.GetReport();
+    std::printf("%s\n", report.c_str());
+    CHECK(Contains(report, "Unthrottled delay 4.00 ms"));
+    CHECK(Contains(report, "untrusted (https://untrusted.example, untrusted)"));
+    CHECK(Contains(report, "untrusted at 1000 ms: 2 reports, mean 1000.00 ms"));
+    CHECK(Contains(report, "untrusted at 500 ms: 86 reports, mean 500.00 ms"));
+    CHECK(Contains(report, "background at 1000 ms: 13 reports, mean 1000.00 ms"));
+    CHECK(Contains(report, "foreground at 1000 ms: 5 reports, mean 1000.00 ms"));
+    CHECK(Contains(report, "99% fewer than unthrottled"));
+    // One report per frame and change spans the change and is dropped.
+    CHECK(controller.GetDroppedCount() > 0 && controller.GetDroppedCount() <= 3 * 5 + 6);
+}
+} // namespace
+
+int main()
+{
+    TestParseCommand();
+    TestGetOrigin();
+    TestPolicy();
+    TestDropsReportsSpanningChanges();
+    TestSimulatedTimers();
+    return FinishTests("ThrottlingControllerTests");
+}
@@ -0,0 +1,129 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares UriPatternSet with matching each pattern in turn, for sets of
+// filter-like patterns of increasing size:
+//     UriPatternSetBench [largest pattern count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "UriPatternSet.h"
+#include "WildcardMatch.h"
+
+namespace
+{
+std::string MakePattern(int i)
+{
+    std::string n = std::to_string(i);
+    switch (i % 4)
+    {
+    case 0:
+        return "https://*.site" + n + ".com/*";
+    case 1:
+        return "*://cdn" + n + ".example/*.js";
+    case 2:
+        return "https://host" + n + ".org/api/*";
+    default:
+        return "*tracker" + n + "*";
+    }
+}
+
+std::string MakeUri(int i, int k)
+{
+    std::string n = std::to_string(k);
+    switch (i % 3)
+    {
+    case 0:
+        return "https://www.site" + n + ".com/index.html?q=" + std::to_string(i);
+    case 1:
+        return "https://cdn" + n + ".example/lib/app.js";
+    default:
+        return "https://news.example.net/article/" + n + "/img.png";
+    }
+}
+
+template <typename TMatch> double MeasureNanosPerUri(size_t uriCount, const TMatch& match)
+{
+    // Repeats until at least 200 ms have passed.
+    size_t iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do
+    {
+        match();
+        iterations++;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        seconds = std::chrono::duration<double>(elapsed).count();
+    } while (seconds < 0.2);
+    return seconds * 1e9 / (double(iterations) * uriCount);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int largest = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::mt19937 random(1);
+    std::printf(
+        "%8s %14s %14s %8s %8s %8s\n", "patterns", "set ns/uri", "linear ns/uri", "nodes",
+        "states", "matches");
+    for (int count : {100, 1000, 5000, 20000})
+    {
+        if (count > largest)
+        {
+            break;
+        }
+        UriPatternSet set;
+        std::vector<std::string> patterns;
+        for (int i = 0; i < count; i++)
+        {
+            patterns.push_back(MakePattern(i));
+            set.Add(patterns.back());
+        }
+        std::vector<std::string> uris;
+        for (int i = 0; i < 2000; i++)
+        {
+            uris.push_back(MakeUri(i, static_cast<int>(random() % (count * 2))));
+        }
+
+        size_t setMatches = 0;
+        double setNanos = MeasureNanosPerUri(
+            uris.size(),
+            [&]
+            {
+                setMatches = 0;
+                for (const std::string& uri : uris)
+                {
+                    setMatches += set.Match(uri).size();
+                }
+            });
+        size_t linearMatches = 0;
+        double linearNanos = MeasureNanosPerUri(
+            uris.size(),
+            [&]
+            {
+                linearMatches = 0;
+                for (const std::string& uri : uris)
+                {
+                    for (const std::string& pattern : patterns)
+                    {
+                        linearMatches += WildcardMatch(pattern, uri);
+                    }
+                }
+            });
+        if (setMatches != linearMatches)
+        {
+            std::fprintf(stderr, "The set and the linear scan disagree.\n");
+            return 1;
+        }
+        std::printf(
+            "%8d %14.0f %14.0f %8zu %8zu %8zu\n", count, setNanos, linearNanos,
+            set.GetNodeCount(), set.GetCachedStateCount(), setMatches);
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestUtil.h"
+#include "UriPatternSet.h"
+#include "WildcardMatch.h"
+
+namespace
+{
+using Ids = std::vector<uint32_t>;
+
+void TestFilterPatterns()
+{
+    UriPatternSet set;
+    uint32_t scheme = set.Add("custom-scheme*");
+    uint32_t all = set.Add("*");
+    uint32_t site = set.Add("https://*.example.com/*");
+    uint32_t images = set.Add("*.png");
+    CHECK(set.Match("custom-scheme:x") == (Ids{scheme, all}));
+    CHECK(set.Match("https://www.example.com/a") == (Ids{all, site}));
+    CHECK(set.Match("https://www.example.com/a.png") == (Ids{all, site, images}));
+    // Patterns match the whole URI.
+    CHECK(set.Match("https://example.com/") == (Ids{all}));
+    CHECK(set.Match("") == (Ids{all}));
+
+    set.Remove(all);
+    CHECK(set.Match("https://www.example.com/a") == (Ids{site}));
+    CHECK(set.Match("about:blank").empty());
+    // IDs aren't reused.
+    CHECK(set.Add("*") > images);
+    CHECK(set.GetCount() == 4);
+
+    // Identical patterns match together.
+    UriPatternSet same;
+    uint32_t first = same.Add("a*");
+    uint32_t second = same.Add("a*");
+    CHECK(same.Match("abc") == (Ids{first, second}));
+
+    set.Clear();
+    CHECK(set.GetCount() == 0);
+    CHECK(set.Match("https://www.example.com/a").empty());
+}
+
+// Random patterns over a small alphabet, so that they overlap a lot, matched
+// against the reference, with patterns removed and added between rounds.
+void TestEquivalence()
+{
+    std::mt19937 random(1);
+    auto randomString = [&](size_t maxLength, bool stars)
+    {
+        std::string text;
+        size_t length = random() % (maxLength + 1);
+        for (size_t i = 0; i < length; i++)
+        {
+            text += stars && random() % 4 == 0 ? '*' : char('a' + random() % 3);
+        }
+        return text;
+    };
+    size_t mismatches = 0;
+    for (int round = 0; round < 300; round++)
+    {
+        UriPatternSet set;
+        std::map<uint32_t, std::string> patterns;
+        for (size_t i = 1 + random() % 20; i > 0; i--)
+        {
+            std::string pattern = randomString(8, true);
+            patterns[set.Add(pattern)] = pattern;
+        }
+        for (int change = 0; change < 3; change++)
+        {
+            for (int query = 0; query < 100; query++)
+            {
+                std::string uri = randomString(12, false);
+                Ids expected;
+                for (const auto& pattern : patterns)
+                {
+                    if (WildcardMatch(pattern.second, uri))
+                    {
+                        expected.push_back(pattern.first);
+                    }
+                }
+                if (set.Match(uri) != expected)
+                {
+                    mismatches++;
+                }
+            }
+            auto removed = patterns.begin();
+            std::advance(removed, random() % patterns.size());
+            set.Remove(removed->first);
+            patterns.erase(removed);
+            std::string pattern = randomString(8, true);
+            patterns[set.Add(pattern)] = pattern;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Patterns with several stars make many DFA states. The cache starts over
+// when it's full, and matching stays correct across the restarts.
+void TestStateCacheIsBounded()
+{
+    std::mt19937 random(2);
+    UriPatternSet set;
+    std::vector<std::string> patterns;
+    for (int i = 0; i < 200; i++)
+    {
+        std::string pattern = "*";
+        for (int j = 0; j < 4; j++)
+        {
+            pattern += char('a' + random() % 8);
+            pattern += char('a' + random() % 8);
+            pattern += '*';
+        }
+        patterns.push_back(pattern);
+        set.Add(pattern);
+    }
+    size_t mismatches = 0;
+    size_t largestCache = 0;
+    for (int query = 0; query < 3000; query++)
+    {
+        std::string uri;
+        for (int i = 0; i < 64; i++)
+        {
+            uri += char('a' + random() % 8);
+        }
+        Ids expected;
+        for (uint32_t id = 0; id < patterns.size(); id++)
+        {
+            if (WildcardMatch(patterns[id], uri))
+            {
+                expected.push_back(id);
+            }
+        }
+        if (set.Match(uri) != expected)
+        {
+            mismatches++;
+        }
+        largestCache = (std::max)(largestCache, set.GetCachedStateCount());
+    }
+    CHECK(mismatches == 0);
+    CHECK(largestCache <= UriPatternSet::c_maxCachedStates);
+    // The workload is large enough to fill the cache at least once.
+    CHECK(largestCache > UriPatternSet::c_maxCachedStates / 2);
+}
+} // namespace
+
+int main()
+{
+    TestFilterPatterns();
+    TestEquivalence();
+    TestStateCacheIsBounded();
+    return FinishTests("UriPatternSetTests");
+}
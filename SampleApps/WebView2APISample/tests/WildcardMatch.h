@@ -0,0 +1,46 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// The reference for UriPatternSet: matches `text` against one wildcard
+// pattern, where '*' matches any run of characters, by backtracking to the
+// last '*'.
+inline bool WildcardMatch(std::string_view pattern, std::string_view text)
+{
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string_view::npos;
+    size_t starText = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            starText = t;
+        }
+        else if (p < pattern.size() && pattern[p] == text[t])
+        {
+            p++;
+            t++;
+        }
+        else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            t = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}